@@ -0,0 +1,71 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace benchmark {
+namespace {
+struct Benchmark {
+    std::string name;
+    Function function;
+};
+
+// Runs are repeated with more iterations until they take at least this long.
+constexpr auto min_run_time = std::chrono::milliseconds{200};
+
+std::vector<Benchmark>& GetBenchmarks() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+void RunBenchmark(const Benchmark& benchmark) {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t iterations = 1;
+    for (;;) {
+        State state{iterations};
+
+        const auto start = Clock::now();
+        benchmark.function(state);
+        const auto elapsed = Clock::now() - start;
+
+        if (elapsed < min_run_time && iterations < (uint64_t{1} << 40)) {
+            // Aim a little past the minimum so the next run is likely to be the last.
+            const auto elapsed_ns = std::max<int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 1);
+            const auto target_ns = std::chrono::nanoseconds{min_run_time}.count() * 3 / 2;
+            const auto scale = std::max<int64_t>(target_ns / elapsed_ns, 2);
+            iterations *= static_cast<uint64_t>(std::min<int64_t>(scale, 100));
+            continue;
+        }
+
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        std::printf("%-36s %12.1f ns/iter %12llu iters", benchmark.name.c_str(),
+                    seconds * 1e9 / static_cast<double>(iterations),
+                    static_cast<unsigned long long>(iterations));
+        if (state.GetItemsProcessed() != 0) {
+            std::printf(" %10.2f M items/s", static_cast<double>(state.GetItemsProcessed()) / seconds / 1e6);
+        }
+        for (const auto& [name, value] : state.GetCounters()) {
+            std::printf(" %s=%g", name.c_str(), value);
+        }
+        std::printf("\n");
+        return;
+    }
+}
+} // Anonymous namespace
+
+void RegisterBenchmark(std::string name, Function function) {
+    GetBenchmarks().push_back({std::move(name), std::move(function)});
+}
+
+void RunBenchmarks(const std::string& filter) {
+    for (const auto& benchmark : GetBenchmarks()) {
+        if (benchmark.name.find(filter) != std::string::npos) {
+            RunBenchmark(benchmark);
+        }
+    }
+}
+
+} // namespace benchmark
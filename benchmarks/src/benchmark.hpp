@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A minimal benchmarking harness, so that benchmarks can be
+// built without pulling in any dependencies.
+
+namespace benchmark {
+
+/**
+ * Per-run state handed to a benchmark.
+ *
+ * A benchmark performs Iterations() repetitions of the work being measured,
+ * and reports how many items (e.g. instructions) that covered, if applicable.
+ */
+class State {
+public:
+    explicit State(uint64_t iterations) noexcept : m_iterations{iterations} {}
+
+    /// The number of times the benchmarked work should be repeated.
+    [[nodiscard]] uint64_t Iterations() const noexcept { return m_iterations; }
+
+    /// Sets the total number of items processed across all iterations.
+    void SetItemsProcessed(uint64_t items) noexcept { m_items = items; }
+
+    /// Gets the total number of items processed across all iterations.
+    [[nodiscard]] uint64_t GetItemsProcessed() const noexcept { return m_items; }
+
+    /**
+     * Sets a named value to report alongside the timing, such as a code size.
+     *
+     * Counters are reported as-is, and aren't divided by the number of iterations.
+     */
+    void SetCounter(std::string name, double value) {
+        m_counters.emplace_back(std::move(name), value);
+    }
+
+    /// Gets all counters set during the run.
+    [[nodiscard]] const std::vector<std::pair<std::string, double>>& GetCounters() const noexcept {
+        return m_counters;
+    }
+
+private:
+    uint64_t m_iterations = 0;
+    uint64_t m_items = 0;
+    std::vector<std::pair<std::string, double>> m_counters;
+};
+
+using Function = std::function<void(State&)>;
+
+/// Registers a benchmark to be run by RunBenchmarks().
+void RegisterBenchmark(std::string name, Function function);
+
+/**
+ * Runs all registered benchmarks whose name contains the filter.
+ *
+ * Iteration counts are scaled up until a run takes long enough to be measured reliably.
+ */
+void RunBenchmarks(const std::string& filter);
+
+/// Prevents the compiler from optimizing away the computation of a value.
+template <typename T>
+void DoNotOptimize(const T& value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+namespace detail {
+struct Registrar {
+    Registrar(const char* name, Function function) {
+        RegisterBenchmark(name, std::move(function));
+    }
+};
+} // namespace detail
+
+} // namespace benchmark
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+
+/// Defines and registers a benchmark with the given name.
+#define BENCHMARK(name)                                                           \
+    static void name(::benchmark::State&);                                        \
+    static const ::benchmark::detail::Registrar BENCHMARK_CONCAT(name, _registrar){#name, name}; \
+    static void name(::benchmark::State& state)
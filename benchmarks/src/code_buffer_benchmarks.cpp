@@ -0,0 +1,57 @@
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_buffer.hpp>
+
+#include "benchmark.hpp"
+
+using namespace biscuit;
+
+// Cost of buffer management: growth, and toggling memory protection.
+// With BISCUIT_CODE_BUFFER_MMAP disabled, protection changes are no-ops.
+
+namespace {
+constexpr size_t initial_capacity = 4096;
+constexpr size_t grown_capacity = 1024 * 1024;
+} // Anonymous namespace
+
+BENCHMARK(CodeBufferGrow) {
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        CodeBuffer buffer{initial_capacity};
+        for (size_t capacity = initial_capacity * 2; capacity <= grown_capacity; capacity *= 2) {
+            buffer.Grow(capacity);
+        }
+        benchmark::DoNotOptimize(buffer.GetCapacity());
+    }
+}
+
+BENCHMARK(EmitIntoGrowableBuffer) {
+    constexpr uint64_t instructions = grown_capacity / 4;
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        Assembler as{initial_capacity};
+        as.GetCodeBuffer().SetGrowable(true);
+        for (uint64_t j = 0; j < instructions; j++) {
+            as.ADDI(a0, a0, 1);
+        }
+        benchmark::DoNotOptimize(*as.GetBufferPointer(0));
+    }
+
+    state.SetItemsProcessed(state.Iterations() * instructions);
+}
+
+BENCHMARK(CodeBufferSetExecutable) {
+    CodeBuffer buffer{64 * 1024};
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        buffer.SetExecutable();
+        buffer.SetWritable();
+    }
+}
+
+BENCHMARK(CodeBufferSetExecutableRange) {
+    CodeBuffer buffer{64 * 1024};
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        buffer.SetExecutable(8192, 4096);
+        buffer.SetWritable(8192, 4096);
+    }
+}
@@ -0,0 +1,62 @@
+#include <biscuit/assembler.hpp>
+
+#include "benchmark.hpp"
+
+using namespace biscuit;
+
+// Throughput of emitting straight-line streams of instructions. Each iteration
+// emits a fixed-size block into a preallocated buffer and rewinds it again.
+
+namespace {
+constexpr uint64_t instructions_per_block = 1024;
+
+template <typename Emitter>
+void RunEmitBenchmark(benchmark::State& state, Emitter&& emit_group, uint64_t group_size,
+                      bool auto_compression = false) {
+    Assembler as{instructions_per_block * 4};
+    as.SetAutoCompression(auto_compression);
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        for (uint64_t j = 0; j < instructions_per_block / group_size; j++) {
+            emit_group(as);
+        }
+        benchmark::DoNotOptimize(*as.GetBufferPointer(0));
+        as.RewindBuffer();
+    }
+
+    state.SetItemsProcessed(state.Iterations() * instructions_per_block);
+}
+
+void EmitScalarGroup(Assembler& as) {
+    as.ADD(a0, a1, a2);
+    as.ADDI(a3, a0, 16);
+    as.LD(a4, 8, sp);
+    as.SD(a4, 16, sp);
+}
+} // Anonymous namespace
+
+BENCHMARK(EmitScalar) {
+    RunEmitBenchmark(state, EmitScalarGroup, 4);
+}
+
+BENCHMARK(EmitScalarAutoCompressed) {
+    RunEmitBenchmark(state, EmitScalarGroup, 4, true);
+}
+
+BENCHMARK(EmitCompressed) {
+    RunEmitBenchmark(state, [](Assembler& as) {
+        as.C_ADDI(a0, 1);
+        as.C_LI(a1, 7);
+        as.C_MV(a2, a0);
+        as.C_ADD(a0, a1);
+    }, 4);
+}
+
+BENCHMARK(EmitVector) {
+    RunEmitBenchmark(state, [](Assembler& as) {
+        as.VSETVLI(t0, a2, SEW::E32, LMUL::M4, VTA::Yes, VMA::Yes);
+        as.VLE32(v8, a1);
+        as.VADD(v8, v8, v16);
+        as.VSE32(v8, a0);
+    }, 4);
+}
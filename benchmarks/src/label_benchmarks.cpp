@@ -0,0 +1,78 @@
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+
+#include "benchmark.hpp"
+
+using namespace biscuit;
+
+// Cost of linking and resolving labels. Forward references have to be
+// recorded and patched once their label is bound, whereas backward
+// references are resolved immediately.
+
+namespace {
+// Small enough that every forward branch stays within the range of a B-type branch.
+constexpr uint64_t labels_per_block = 128;
+constexpr uint64_t refs_per_label = 4;
+} // Anonymous namespace
+
+BENCHMARK(ForwardBranches) {
+    Assembler as{labels_per_block * refs_per_label * 8};
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        std::vector<Label> labels(labels_per_block);
+        for (auto& label : labels) {
+            for (uint64_t j = 0; j < refs_per_label; j++) {
+                as.BNE(a0, a1, &label);
+            }
+        }
+        for (auto& label : labels) {
+            as.Bind(&label);
+            as.NOP();
+        }
+        benchmark::DoNotOptimize(*as.GetBufferPointer(0));
+        as.RewindBuffer();
+    }
+
+    state.SetItemsProcessed(state.Iterations() * labels_per_block * refs_per_label);
+}
+
+BENCHMARK(BackwardBranches) {
+    Assembler as{labels_per_block * refs_per_label * 8};
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        std::vector<Label> labels(labels_per_block);
+        for (auto& label : labels) {
+            as.Bind(&label);
+            for (uint64_t j = 0; j < refs_per_label; j++) {
+                as.BNE(a0, a1, &label);
+            }
+        }
+        benchmark::DoNotOptimize(*as.GetBufferPointer(0));
+        as.RewindBuffer();
+    }
+
+    state.SetItemsProcessed(state.Iterations() * labels_per_block * refs_per_label);
+}
+
+BENCHMARK(ForwardJumpsRelaxed) {
+    Assembler as{labels_per_block * refs_per_label * 16};
+    as.SetBranchRelaxation(true);
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        std::vector<Label> labels(labels_per_block);
+        for (auto& label : labels) {
+            for (uint64_t j = 0; j < refs_per_label; j++) {
+                as.BEQ(a0, a1, &label);
+            }
+        }
+        for (auto& label : labels) {
+            as.Bind(&label);
+            as.NOP();
+        }
+        benchmark::DoNotOptimize(*as.GetBufferPointer(0));
+        as.RewindBuffer();
+    }
+
+    state.SetItemsProcessed(state.Iterations() * labels_per_block * refs_per_label);
+}
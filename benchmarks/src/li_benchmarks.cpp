@@ -0,0 +1,91 @@
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+
+#include "benchmark.hpp"
+
+using namespace biscuit;
+
+// Emission speed and quality of LI. Along with the time taken, each
+// benchmark reports the average length of the emitted sequences, so
+// changes to constant materialization show up as changes in code size.
+
+namespace {
+// Constants covering the shapes LI handles differently: 12-bit immediates,
+// 32-bit values, shifted masks, sign-extended values and arbitrary 64-bit values.
+std::vector<uint64_t> MakeConstantCorpus() {
+    std::vector<uint64_t> corpus{
+        0, 1, 0x7FF, 0xFFFFFFFFFFFFF800, 0x800, 0x12345, 0x7FFFFFFF, 0x80000000,
+        0xFFFFFFFF, 0xFFFFFFFF80000000, 0x100000000, 0x1000000000000,
+        0x8000000000000000, 0x7FFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+        0x00FF00FF00FF00FF, 0x0123456789ABCDEF, 0xDEADBEEFCAFEBABE,
+    };
+
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        corpus.push_back(uint64_t{0xFFF} << shift);
+        corpus.push_back(~(uint64_t{0xFFF} << shift));
+    }
+
+    // xorshift64, for a deterministic spread of arbitrary values.
+    uint64_t state = 0x9E3779B97F4A7C15;
+    for (int i = 0; i < 64; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        corpus.push_back(state);
+        corpus.push_back(state >> 32);
+    }
+
+    return corpus;
+}
+
+// Counts the instructions in a stream of 16-bit and 32-bit instructions.
+size_t CountInstructions(const uint8_t* code, size_t size) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; count++) {
+        i += (code[i] & 0b11) == 0b11 ? 4 : 2;
+    }
+    return count;
+}
+
+void RunLIBenchmark(benchmark::State& state, ArchFeature features, ExtensionSet extensions) {
+    const auto corpus = MakeConstantCorpus();
+    Assembler as{corpus.size() * 8 * 4};
+    as.SetArchFeatures(features);
+    as.SetExtensions(extensions);
+
+    for (uint64_t i = 0; i < state.Iterations(); i++) {
+        for (const auto value : corpus) {
+            as.LI(a0, value);
+        }
+        benchmark::DoNotOptimize(*as.GetBufferPointer(0));
+        if (i + 1 != state.Iterations()) {
+            as.RewindBuffer();
+        }
+    }
+
+    const auto size = as.GetCodeBuffer().GetSizeInBytes();
+    const auto instructions = CountInstructions(as.GetBufferPointer(0), size);
+    const auto constants = static_cast<double>(corpus.size());
+
+    state.SetItemsProcessed(state.Iterations() * corpus.size());
+    state.SetCounter("insts/LI", static_cast<double>(instructions) / constants);
+    state.SetCounter("bytes/LI", static_cast<double>(size) / constants);
+}
+} // Anonymous namespace
+
+BENCHMARK(LIConstantCorpus64) {
+    RunLIBenchmark(state, ArchFeature::RV64, {});
+}
+
+BENCHMARK(LIConstantCorpus64Zb) {
+    RunLIBenchmark(state, ArchFeature::RV64, {Extension::Zba, Extension::Zbb, Extension::Zbs});
+}
+
+BENCHMARK(LIConstantCorpus64Compressed) {
+    RunLIBenchmark(state, ArchFeature::RV64, {Extension::C});
+}
+
+BENCHMARK(LIConstantCorpus32) {
+    RunLIBenchmark(state, ArchFeature::RV32, {});
+}
@@ -0,0 +1,11 @@
+#include <string>
+
+#include "benchmark.hpp"
+
+// Usage: biscuit_benchmarks [filter]
+//
+// Only benchmarks with names containing the filter are run.
+int main(int argc, char** argv) {
+    benchmark::RunBenchmarks(argc > 1 ? argv[1] : "");
+    return 0;
+}
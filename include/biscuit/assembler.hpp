@@ -1,13 +1,22 @@
 #pragma once
 
+#include <biscuit/assert.hpp>
 #include <biscuit/code_buffer.hpp>
 #include <biscuit/csr.hpp>
+#include <biscuit/encoding.hpp>
+#include <biscuit/extensions.hpp>
 #include <biscuit/isa.hpp>
 #include <biscuit/label.hpp>
 #include <biscuit/registers.hpp>
+#include <biscuit/relocation.hpp>
 #include <biscuit/vector.hpp>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
 
 namespace biscuit {
 
@@ -27,6 +36,35 @@ enum class ArchFeature : uint32_t {
     RV128, //< 128-bit RISC-V
 };
 
+/**
+ * Describes what padding inserted for alignment is filled with.
+ */
+enum class AlignFill : uint32_t {
+    /// NOPs, using a C.NOP for any 2-byte remainder. For padding that may be executed.
+    Nop,
+
+    /// Zero bytes, which decode as illegal instructions. For data and padding that's never executed.
+    Zero,
+};
+
+/**
+ * Describes what the unused end of a reassembled region is filled with.
+ */
+enum class RegionFill : uint32_t {
+    /// NOPs that fall through to the end of the region.
+    Nop,
+
+    /**
+     * A jump to the end of the region, followed by zero bytes. Skipping over a
+     * long remainder is cheaper than executing NOPs through it. Remainders too
+     * small to hold a jump are filled with NOPs.
+     */
+    Jump,
+};
+
+class InstructionScheduler;
+struct TuningModel;
+
 /**
  * Code generator for RISC-V code.
  *
@@ -85,6 +123,34 @@ public:
         m_features = features;
     }
 
+    /// Gets the features that the assembler takes into account.
+    [[nodiscard]] ArchFeature GetArchFeatures() const noexcept {
+        return m_features;
+    }
+
+    /**
+     * Tells the assembler which ISA extensions it may make use of.
+     *
+     * This doesn't restrict which instructions can be emitted. It only
+     * lets the assembler transparently pick alternative encodings when
+     * it's emitting code on its own behalf. e.g. With the C extension,
+     * relaxed branches and jumps start out as their compressed forms,
+     * and LI takes Zba/Zbb/Zbs into account when searching for the
+     * shortest sequence.
+     *
+     * The set can be a fixed profile (e.g. ExtensionSet::RVA23U64()) when
+     * targeting known hardware, or CPUInfo::GetExtensions() to match
+     * the host at runtime.
+     */
+    void SetExtensions(ExtensionSet extensions) noexcept {
+        m_extensions = extensions;
+    }
+
+    /// Gets the ISA extensions that the assembler may make use of.
+    [[nodiscard]] ExtensionSet GetExtensions() const noexcept {
+        return m_extensions;
+    }
+
     /// Gets the underlying code buffer being managed by this assembler.
     CodeBuffer& GetCodeBuffer();
 
@@ -107,10 +173,59 @@ public:
      *
      * @note The offset may not be larger than the current cursor offset
      *       and may not be less than the current buffer starting address.
+     *
+     * @note Rewinding to the beginning of the buffer also releases all labels
+     *       created with NewLabel(), as if ReleaseLabels() had been called.
      */
-    void RewindBuffer(ptrdiff_t offset = 0) {
-        m_buffer.RewindCursor(offset);
-    }
+    void RewindBuffer(ptrdiff_t offset = 0);
+
+    /**
+     * Resets the assembler for emitting new code from the beginning of its buffer.
+     *
+     * Along with rewinding the cursor, all state tied to previously emitted code is
+     * dropped, such as labels created with NewLabel(), pending branch relaxations,
+     * literal pools, deferred cold blocks, recorded relocations, tracked vector
+     * configuration and any emission statistics attached to the code buffer.
+     * Settings made on the assembler (e.g. extensions or whether relaxation is
+     * enabled) are kept.
+     *
+     * Code released from the buffer (e.g. by a CodeStream) is forgotten as well, so
+     * offsets start over from zero. A stream over the previous code must not be
+     * flushed afterwards, though a new one may be created for the new code.
+     *
+     * All memory held by the assembler, including the code buffer itself, is
+     * retained, so reusing a reset assembler avoids both reallocating the buffer
+     * and regrowing internal containers.
+     *
+     * @par
+     * An example of a scratch assembler reused by each compilation on a thread:
+     *
+     * @code{.cpp}
+     * thread_local Assembler as{64 * 1024};
+     * as.Reset();
+     * // Emit code...
+     * @endcode
+     *
+     * @note Labels not created with NewLabel() that still have references into the
+     *       previous code must be reset or destroyed by their owner without being used.
+     */
+    void Reset() noexcept;
+
+    /**
+     * Retrieves the offset up to which the emitted code is final.
+     *
+     * Nothing before this offset will be written to again by the assembler, as it
+     * only comes before the earliest reference to a label that's yet to be bound,
+     * data reference waiting on its label, reference that relaxation may still grow,
+     * and code that has yet to be scheduled. It's the cursor offset if there's none.
+     *
+     * The code before the offset may be copied out and released from the code buffer
+     * (see CodeBuffer::ReleaseBefore() and CodeStream).
+     *
+     * @note Code can still be modified explicitly, e.g. with RetargetCall()
+     *       or by rewinding the buffer. That's up to whoever does so.
+     */
+    [[nodiscard]] ptrdiff_t GetFinalizedOffset() const noexcept;
 
     /// Retrieves the cursor pointer for the underlying code buffer.
     [[nodiscard]] uint8_t* GetCursorPointer() noexcept {
@@ -139,6 +254,586 @@ public:
      */
     void Bind(Label* label);
 
+    /**
+     * Pads the code buffer until the cursor is aligned to a given boundary.
+     *
+     * @param alignment The alignment in bytes. Must be a power of two.
+     * @param fill      What the padding is filled with.
+     *
+     * @note The alignment is that of the cursor's address, not its offset.
+     *       With memory not allocated by the code buffer itself, the
+     *       two may differ.
+     *
+     * @note With branch relaxation enabled, the padding is adjusted whenever
+     *       relaxation moves the code before it, so the alignment is kept.
+     *       A label bound right before the padding, with nothing emitted in
+     *       between, is treated as being bound after it.
+     */
+    void Align(size_t alignment, AlignFill fill = AlignFill::Nop);
+
+    /**
+     * Pads the code buffer to a given boundary, then binds a label there.
+     *
+     * This is the same as calling Align() followed by Bind(), and is intended
+     * for loop headers and call targets that benefit from being aligned to
+     * the fetch width of the processor.
+     *
+     * @param label     A non-null valid label to bind.
+     * @param alignment The alignment in bytes. Must be a power of two.
+     * @param fill      What the padding is filled with.
+     */
+    void BindAligned(Label* label, size_t alignment, AlignFill fill = AlignFill::Nop);
+
+    /**
+     * Creates a new label owned by the assembler.
+     *
+     * Labels are handed out from contiguous blocks of storage that are
+     * reused after ReleaseLabels(), so code generators that create many
+     * labels per compilation unit don't have to allocate each one.
+     *
+     * @returns A pointer to an unbound label. The pointer remains valid until
+     *          the labels are released or the assembler is destroyed.
+     */
+    [[nodiscard]] Label* NewLabel();
+
+    /**
+     * Releases all labels created with NewLabel() at once.
+     *
+     * Any references those labels still have are dropped rather than
+     * asserted on, as this is intended to be done when the code referencing
+     * them is being thrown away (e.g. between compilation units).
+     *
+     * @note Pointers to released labels must not be used afterwards.
+     *       The storage itself is retained for future calls to NewLabel().
+     */
+    void ReleaseLabels() noexcept;
+
+    /// Retrieves the number of labels currently handed out by NewLabel().
+    [[nodiscard]] size_t GetLabelCount() const noexcept {
+        return m_label_count;
+    }
+
+    /**
+     * Enables or disables branch relaxation.
+     *
+     * When enabled, conditional branches and jumps that reference labels are
+     * emitted in their shortest form and transparently rewritten into a longer
+     * sequence if their label ends up being out of range:
+     *
+     * - Bxx becomes an inverted Bxx over a JAL (+-1MiB), and then an
+     *   inverted Bxx over an AUIPC+JALR pair (+-2GiB).
+     * - JAL becomes an AUIPC+JALR pair (+-2GiB).
+     *
+     * If the C extension is within the assembler's extension set, then
+     * BEQ/BNE against x0 with a register in x8-x15 start out as C.BEQZ/C.BNEZ,
+     * J starts out as C.J, and JAL with x1 as the link register starts out
+     * as C.JAL on RV32. These grow into their regular forms if they can't reach.
+     *
+     * Rewriting a branch moves all code emitted after it. Every label and every
+     * label reference made through the assembler is adjusted to account for this.
+     *
+     * @param enabled Whether or not to relax branches.
+     * @param scratch Register that AUIPC+JALR sequences may clobber when there is
+     *                no link register to use instead (i.e. for Bxx and J).
+     *                If this is x0, branches that would need such a sequence
+     *                will assert like they do when relaxation is disabled.
+     *
+     * @note Relaxation should be enabled before any code referencing labels is emitted.
+     *
+     * @note Offsets or addresses that aren't tracked by labels (e.g. immediates given
+     *       to the non-label overloads of branch instructions, or pointers retrieved
+     *       with GetCursorPointer()) are *not* adjusted when code gets moved around.
+     */
+    void SetBranchRelaxation(bool enabled, GPR scratch = x0) noexcept;
+
+    /// Whether or not branch relaxation is enabled.
+    [[nodiscard]] bool IsBranchRelaxationEnabled() const noexcept {
+        return m_relax_branches;
+    }
+
+    /**
+     * Retrieves the current location of a label.
+     *
+     * Unlike Label::GetLocation(), this takes into account any code that has
+     * been moved by branch relaxation since the label was bound.
+     *
+     * @param label A non-null valid label.
+     */
+    [[nodiscard]] Label::Location GetLabelLocation(Label* label) noexcept;
+
+    /**
+     * Enables or disables recording of relocations.
+     *
+     * When enabled, every reference to a label made through the assembler
+     * (branches, jumps, AUIPC pairs, addresses and jump table entries) is
+     * recorded along with how its value is encoded. Together with the labels
+     * themselves, this describes everything position-dependent in the code,
+     * so that it can be moved or persisted without regenerating it.
+     *
+     * Relocations refer to labels by pointer, so labels must outlive the relocations
+     * referring to them (or be discarded with ClearRelocations() first). The exception
+     * is local labels (see Label::Local()), which are referred to by their location
+     * once they're bound. Such labels are used for everything internal to code emitted
+     * by the library, such as literal pools and the loops within kernels.
+     *
+     * @note Relocation recording can't be combined with branch relaxation,
+     *       since relaxation moves code after references have been made.
+     */
+    void SetRelocationRecording(bool enabled) noexcept;
+
+    /// Whether or not relocations are being recorded.
+    [[nodiscard]] bool IsRecordingRelocations() const noexcept {
+        return m_record_relocations;
+    }
+
+    /// Retrieves all relocations recorded so far, in the order they were made.
+    [[nodiscard]] std::span<const Relocation> GetRelocations() const noexcept {
+        return m_relocations;
+    }
+
+    /// Discards all recorded relocations.
+    void ClearRelocations() noexcept {
+        m_relocations.clear();
+    }
+
+    /**
+     * Emits the 64-bit absolute address of a label.
+     *
+     * @param label A non-null valid label.
+     *
+     * @note The address is that of the label at the time it's resolved. If the
+     *       code buffer is moved afterwards (e.g. grown), its relocation has to
+     *       be applied again with ApplyRelocation().
+     */
+    void EmitAddress(Label* label);
+
+    /**
+     * Emits the 32-bit absolute address of a label, for RV32 code.
+     *
+     * @param label A non-null valid label.
+     *
+     * @note The same caveat about moving the code buffer as with EmitAddress() applies.
+     */
+    void EmitAddress32(Label* label);
+
+    /**
+     * Emits a 32-bit jump table entry.
+     *
+     * @param target A non-null valid label for the target of the entry.
+     * @param table  A non-null bound label for the start of the table. The
+     *               entry holds the offset of `target` relative to it.
+     */
+    void EmitJumpTableEntry(Label* target, Label* table);
+
+    /**
+     * Enables or disables patchable slots.
+     *
+     * When enabled, conditional branches, JAL, CALL and TAIL that reference labels
+     * are padded with a C.NOP if necessary, so that every instruction that may be
+     * retargeted later starts on a 4-byte boundary. This is what allows
+     * RetargetBranch() and RetargetCall() to replace them with a single atomic store.
+     *
+     * @note Patchable slots can't be combined with branch relaxation, since
+     *       relaxation moves code after it's been emitted.
+     *
+     * @note Overloads that take an immediate offset are never padded, since
+     *       that would change what their offset refers to.
+     */
+    void SetPatchableSlots(bool enabled) noexcept;
+
+    /// Whether or not patchable slots are enabled.
+    [[nodiscard]] bool IsPatchableSlotsEnabled() const noexcept {
+        return m_patchable_slots;
+    }
+
+    /**
+     * Atomically retargets a conditional branch or JAL while it may be executing.
+     *
+     * The instruction is replaced with a single aligned 32-bit store and made
+     * visible to instruction fetch on all harts, so any hart executing it
+     * either takes the old or the new target.
+     *
+     * @param offset The offset of the instruction within the code buffer.
+     *               Its address must be 4-byte aligned.
+     * @param target The address of the new target.
+     *
+     * @returns Whether or not the target was within range of the instruction.
+     *          If it wasn't, the instruction is left unmodified.
+     *
+     * @note The code buffer's memory must be writable. Patching live code under W^X
+     *       requires a dual-mapped buffer (see CodeBufferMapping::Dual).
+     */
+    bool RetargetBranch(ptrdiff_t offset, uintptr_t target);
+
+    /**
+     * Atomically retargets an AUIPC+JALR pair (e.g. emitted by CALL or TAIL) while
+     * it may be executing.
+     *
+     * Only the second instruction of the pair is ever modified. If the target can't be
+     * reached from the existing AUIPC with the JALR's 12-bit offset, the JALR is replaced
+     * with a JAL (with the same link register) instead. Either way, the change is made
+     * with a single aligned 32-bit store, so any hart executing the pair either calls
+     * the old or the new target.
+     *
+     * @param offset The offset of the AUIPC within the code buffer.
+     *               Its address must be 4-byte aligned.
+     * @param target The address of the new target.
+     *
+     * @returns Whether or not the target could be reached within a single store.
+     *          If it couldn't, the pair is left unmodified, and has to be rewritten
+     *          while no other hart is executing it.
+     *
+     * @note The code buffer's memory must be writable. Patching live code under W^X
+     *       requires a dual-mapped buffer (see CodeBufferMapping::Dual).
+     */
+    bool RetargetCall(ptrdiff_t offset, uintptr_t target);
+
+    /**
+     * Enables or disables automatic compression.
+     *
+     * When enabled, common base integer, load/store and floating-point load/store
+     * instructions (e.g. ADD, ADDI, MV, LD and SD) are emitted in their compressed
+     * form whenever their operands allow it. This only takes effect if the C extension
+     * is part of the assembler's extension set (see SetExtensions()). Forms added by
+     * Zcb are only selected if Zcb is part of it as well, and C.FLD/C.FSD and their
+     * stack-pointer-relative forms aren't selected if Zcmp or Zcmt are, since
+     * those extensions reuse their encodings.
+     *
+     * @note Instructions that are part of a PC-relative pair referencing a label (e.g. LA,
+     *       CALL, TAIL and label-based loads and stores), as well as NOPs, always keep their
+     *       full-size encoding, so that their relocations and retargeting keep working.
+     *       Explicitly compressed instructions (e.g. C_ADD) are unaffected by this setting.
+     */
+    void SetAutoCompression(bool enabled) noexcept {
+        m_auto_compress = enabled;
+    }
+
+    /// Whether or not automatic compression is enabled.
+    [[nodiscard]] bool IsAutoCompressionEnabled() const noexcept {
+        return m_auto_compress;
+    }
+
+    /**
+     * Enables or disables elimination of redundant vector configuration.
+     *
+     * When enabled, the assembler keeps track of the vtype and vl set up by VSETVLI
+     * and VSETIVLI within straight-line code, and skips configuration that's already
+     * in effect. A VSETIVLI that would only change vtype while keeping the same vl
+     * is emitted as a `VSETVLI x0, x0` instead. Only configuration that doesn't write
+     * vl to a register (i.e. with x0 as the destination) is ever skipped.
+     *
+     * Tracked state is forgotten whenever a label is bound, around calls and jumps,
+     * and after anything else that may change vl or vtype (VSETVL, fault-only-first
+     * loads and ECALL).
+     *
+     * @note Code that can be reached by a branch or jump with an immediate offset
+     *       has to be preceded by a call to InvalidateVTypeState(), since there's
+     *       no label to tell the assembler that it may be entered from elsewhere.
+     */
+    void SetVTypeTracking(bool enabled) noexcept {
+        m_vtype_tracking = enabled;
+        InvalidateVTypeState();
+    }
+
+    /// Whether or not redundant vector configuration is eliminated.
+    [[nodiscard]] bool IsVTypeTrackingEnabled() const noexcept {
+        return m_vtype_tracking;
+    }
+
+    /// Forgets the vector configuration currently tracked, if any.
+    void InvalidateVTypeState() noexcept {
+        m_vtype_state = {};
+    }
+
+    /// Default number of instructions LI may expand to before a literal pool load is used instead.
+    static constexpr uint32_t literal_pool_default_max_inline = 4;
+
+    /// Default distance from the first pending pool reference at which the pool is flushed automatically.
+    static constexpr ptrdiff_t literal_pool_default_max_distance = ptrdiff_t{1} << 30;
+
+    /**
+     * Enables or disables the literal pool.
+     *
+     * When enabled, LI on RV64 compares the number of instructions needed to
+     * materialize a constant inline against an AUIPC+LD from a pool of 64-bit
+     * literals, and uses the pool load if the inline sequence would be longer
+     * than the given limit. Identical constants share a single pool entry.
+     *
+     * Pending literals are emitted with FlushLiteralPool(). If a new literal
+     * would otherwise end up too far away from the first pending reference,
+     * the pool is flushed automatically at that point, along with a jump over it.
+     *
+     * @param enabled      Whether or not LI may load constants from the pool.
+     * @param max_inline   Maximum number of instructions LI may emit inline
+     *                     before falling back to a pool load.
+     * @param max_distance Maximum distance in bytes from the first pending pool
+     *                     reference before the pool is flushed automatically.
+     *
+     * @note Any literals still pending when the assembler is destroyed will
+     *       trigger an assertion, just like unbound labels with references do.
+     *
+     * @note Literals are aligned to 8 bytes when flushed, as if by Align().
+     */
+    void SetLiteralPool(bool enabled,
+                        uint32_t max_inline = literal_pool_default_max_inline,
+                        ptrdiff_t max_distance = literal_pool_default_max_distance) noexcept;
+
+    /// Whether or not the literal pool is enabled.
+    [[nodiscard]] bool IsLiteralPoolEnabled() const noexcept {
+        return m_literal_pool_enabled;
+    }
+
+    /**
+     * Emits all pending literals at the current location.
+     *
+     * @param branch_over Whether or not to emit a jump over the literals. This may be
+     *                    omitted if the pool is placed somewhere control flow can't
+     *                    reach, such as after an unconditional jump or return.
+     */
+    void FlushLiteralPool(bool branch_over = true);
+
+    /// Retrieves the number of literals waiting to be emitted by FlushLiteralPool().
+    [[nodiscard]] size_t GetPendingLiteralCount() const noexcept {
+        return m_literals.size() - m_literals_first_pending;
+    }
+
+    /// Emits code into the cold section. See Cold().
+    using ColdBlock = std::function<void()>;
+
+    /**
+     * Moves a block of code out of line, into the cold section.
+     *
+     * Rarely executed code, such as slow paths and deoptimization exits, dilutes the
+     * instruction cache when it's emitted inline between hot instructions. Cold blocks
+     * are instead deferred until FlushColdSection(), which emits all of them back to
+     * back wherever it's called, typically past the end of a function (or a batch of
+     * functions), so that hot code stays densely packed.
+     *
+     * Labels work across sections as usual. Since the cold section usually ends up far
+     * away from the code branching into it, branch relaxation should be enabled, which
+     * turns out-of-range branches into JAL or AUIPC+JALR sequences as needed.
+     *
+     * @par
+     * An example of moving a slow path out of line:
+     *
+     * @code{.cpp}
+     * Label slow_path;
+     * Label resume;
+     * as.BNEZ(a0, &slow_path);
+     * as.Cold([&] {
+     *     as.Bind(&slow_path);
+     *     // Emit the slow path...
+     *     as.J(&resume);
+     * });
+     * as.Bind(&resume);
+     * // Emit the rest of the function...
+     * as.RET();
+     * as.FlushColdSection();
+     * @endcode
+     *
+     * @param block Emits the cold code using this assembler. It's invoked by
+     *              FlushColdSection(), so anything it captures by reference must
+     *              stay alive until then. It may itself defer further cold blocks.
+     *
+     * @note Code doesn't fall through from the hot section into the cold section or
+     *       between cold blocks, so each block has to end with a jump or return.
+     */
+    void Cold(ColdBlock block);
+
+    /**
+     * Emits all deferred cold blocks at the current location, in the order they were deferred.
+     *
+     * @returns The range of the emitted cold section, which is empty if there were no cold blocks.
+     *
+     * @note Control flow must not be able to reach the current location, as with
+     *       FlushLiteralPool() without a jump over the pool.
+     */
+    CodeRange FlushColdSection();
+
+    /// Retrieves the number of cold blocks waiting to be emitted by FlushColdSection().
+    [[nodiscard]] size_t GetPendingColdBlockCount() const noexcept {
+        return m_cold_blocks.size();
+    }
+
+    /// Emits the code of a region. See ReassembleRegion().
+    using RegionEmitter = std::function<void(Assembler&)>;
+
+    /**
+     * Reserves a fixed-size region at the cursor, to be filled in with ReassembleRegion().
+     *
+     * Regions allow part of a function (e.g. a specialized block guarded by a check)
+     * to be regenerated later on, without regenerating the rest of the function.
+     * The region starts out filled with NOPs.
+     *
+     * @param label An optional label to bind to the start of the region.
+     * @param size  The size of the region in bytes. Must be a multiple of 2.
+     *
+     * @returns The range of the region.
+     *
+     * @note Branch relaxation must be disabled, since it could move the region.
+     */
+    CodeRange ReserveRegion(Label* label, size_t size);
+
+    /**
+     * Replaces the code within a region reserved with ReserveRegion().
+     *
+     * The code is emitted through a separate assembler whose code buffer is a view over
+     * the region (see CodeBuffer::CreateView()), with the same offsets as this one's and
+     * the same architectural features and extensions. Nothing outside the region is
+     * touched, so the cost is proportional to the size of the region rather than that of
+     * the surrounding code. The rest of the region is filled as specified afterwards, and
+     * the region is made visible to instruction fetch.
+     *
+     * @par
+     * An example of re-specializing a block after a guard failed:
+     *
+     * @code{.cpp}
+     * const auto region = as.ReserveRegion(&block, 64);
+     * as.Cold([&] {
+     *     as.Bind(&deopt);
+     *     // Emit the deoptimization exit...
+     * });
+     * ...
+     * as.ReassembleRegion(region, [&](Assembler& region_as) {
+     *     region_as.BNE(a0, a1, &deopt);
+     *     // Emit the new specialization...
+     * });
+     * @endcode
+     *
+     * @param region The region to reassemble.
+     * @param emit   Emits the region's code. It may reference labels of this assembler,
+     *               as long as they're already bound, and labels of its own, as long as
+     *               it binds them itself.
+     * @param fill   What the unused end of the region is filled with.
+     *
+     * @pre The code must fit within the region.
+     *
+     * @note Recorded relocations within the region are replaced with those of the new code.
+     *       References to labels the emitter binds are recorded by location, as with
+     *       local labels (see Label::Local()), since its labels don't outlive it.
+     *
+     * @note The region is rewritten without any atomicity, so it must not
+     *       be executing while it's reassembled.
+     */
+    void ReassembleRegion(const CodeRange& region, const RegionEmitter& emit, RegionFill fill = RegionFill::Jump);
+
+    /**
+     * Attaches an instruction scheduler, or detaches it if null.
+     *
+     * With a scheduler attached, emitted code is buffered up until the next label
+     * is bound. The scheduler then reorders the instructions emitted since, which
+     * form a basic block, to avoid stalls on in-order cores. Branches and jumps
+     * within the block stay where they are. See InstructionScheduler for what
+     * else is kept in place.
+     *
+     * Code emitted after the last label is only scheduled by FlushSchedule(),
+     * though it's correct (if not scheduled) either way.
+     *
+     * @par
+     * An example of scheduling a function for a dual-issue in-order core:
+     *
+     * @code{.cpp}
+     * InstructionScheduler scheduler;
+     * as.SetScheduler(&scheduler);
+     * // Emit code...
+     * as.FlushSchedule();
+     * @endcode
+     *
+     * @param scheduler The scheduler to use. It's not owned by the assembler,
+     *                  and may be shared between assemblers on the same thread.
+     *
+     * @note Offsets of instructions within a block, other than those of instructions
+     *       that are never moved, may change once the block is scheduled.
+     *
+     * @note Data can't be told apart from instructions. Data emitted straight into
+     *       the code buffer must be followed by SkipSchedule(), so it doesn't get
+     *       scheduled as part of the block it's in. Data emitted by the assembler
+     *       itself (e.g. literal pools and EmitAddress()) is already taken care of.
+     */
+    void SetScheduler(InstructionScheduler* scheduler);
+
+    /// Retrieves the attached instruction scheduler, if any.
+    [[nodiscard]] InstructionScheduler* GetScheduler() const noexcept {
+        return m_scheduler;
+    }
+
+    /// Schedules all code emitted since the last label was bound, if a scheduler is attached.
+    void FlushSchedule();
+
+    /**
+     * Excludes all code emitted since the last label was bound (or the
+     * last flush) from scheduling, leaving it in its original order.
+     */
+    void SkipSchedule() noexcept {
+        m_schedule_start = m_buffer.GetCursorOffset();
+    }
+
+    /**
+     * Attaches the model of the core to tune code for, or detaches it if null.
+     *
+     * Macro-ops with several equivalent lowerings pick the cheapest one for the
+     * core, as noted on each of them. Without a model, they're tuned for no core
+     * in particular.
+     *
+     * @par
+     * An example of tuning code for the host:
+     *
+     * @code{.cpp}
+     * const auto model = GetHostTuningModel(CPUInfo{}.GetSnapshot());
+     * as.SetTuningModel(&model);
+     * @endcode
+     *
+     * @param model The model to use. It's not owned by the assembler, and must
+     *              outlive it (or be detached first).
+     *
+     * @note The model doesn't affect the scheduler (see SetScheduler()),
+     *       which is given its own model when it's constructed.
+     */
+    void SetTuningModel(const TuningModel* model) noexcept {
+        m_tuning = model;
+    }
+
+    /// Retrieves the attached tuning model, if any.
+    [[nodiscard]] const TuningModel* GetTuningModel() const noexcept {
+        return m_tuning;
+    }
+
+    // Branchless conditional operations.
+    //
+    // These pick the shortest branch-free sequence available within the assembler's
+    // extension set (see SetExtensions()): Zbb's MIN/MAX family and Zicond's CZERO pairs
+    // where they apply, and a mask-based sequence using only the base ISA otherwise.
+    // Unlike branches, they can't be mispredicted on data-dependent conditions.
+    //
+    // The exception is cores whose tuning model (see SetTuningModel()) has the
+    // Fusion::ShortForwardBranch fusion. They execute a branch over a single move
+    // as a predicated move, which is shorter than any of the sequences above.
+    //
+    // Each takes a scratch register that may be clobbered, which must be distinct
+    // from every other operand. All other operands may alias each other.
+
+    /// rd = (cond != 0) ? a : b
+    void SELECT(GPR rd, GPR cond, GPR a, GPR b, GPR scratch) noexcept;
+
+    /// rd = min(a, b), comparing as signed integers.
+    void SELECT_MIN(GPR rd, GPR a, GPR b, GPR scratch) noexcept;
+    /// rd = max(a, b), comparing as signed integers.
+    void SELECT_MAX(GPR rd, GPR a, GPR b, GPR scratch) noexcept;
+    /// rd = min(a, b), comparing as unsigned integers.
+    void SELECT_MINU(GPR rd, GPR a, GPR b, GPR scratch) noexcept;
+    /// rd = max(a, b), comparing as unsigned integers.
+    void SELECT_MAXU(GPR rd, GPR a, GPR b, GPR scratch) noexcept;
+
+    /// rd = min(max(rs, lo), hi), comparing as signed integers. lo must not be greater than hi.
+    void CLAMP(GPR rd, GPR rs, GPR lo, GPR hi, GPR scratch) noexcept;
+    /// rd = min(max(rs, lo), hi), comparing as unsigned integers. lo must not be greater than hi.
+    void CLAMPU(GPR rd, GPR rs, GPR lo, GPR hi, GPR scratch) noexcept;
+
+    /// rd = a + b, saturating to the largest unsigned value on overflow.
+    void SATURATING_ADDU(GPR rd, GPR a, GPR b, GPR scratch) noexcept;
+    /// rd = a - b, saturating to zero on underflow.
+    void SATURATING_SUBU(GPR rd, GPR a, GPR b, GPR scratch) noexcept;
+
     // RV32I Instructions
 
     void ADD(GPR rd, GPR lhs, GPR rhs) noexcept;
@@ -182,6 +877,7 @@ public:
     void BNE(GPR rs1, GPR rs2, int32_t imm) noexcept;
     void BNEZ(GPR rs, int32_t imm) noexcept;
 
+    void CALL(Label* label) noexcept;
     void CALL(int32_t offset) noexcept;
 
     void EBREAK() noexcept;
@@ -203,6 +899,20 @@ public:
     void JALR(GPR rd, int32_t imm, GPR rs1) noexcept;
     void JR(GPR rs) noexcept;
 
+    // Label-relative addressing. These emit an AUIPC that is paired with
+    // the instruction itself, giving a range of +-2GiB from the AUIPC.
+    // Stores need a temporary register to hold the upper bits of the address in.
+
+    void LA(GPR rd, Label* label) noexcept;
+    void LB(GPR rd, Label* label) noexcept;
+    void LBU(GPR rd, Label* label) noexcept;
+    void LH(GPR rd, Label* label) noexcept;
+    void LHU(GPR rd, Label* label) noexcept;
+    void LW(GPR rd, Label* label) noexcept;
+    void SB(GPR rs2, Label* label, GPR temp) noexcept;
+    void SH(GPR rs2, Label* label, GPR temp) noexcept;
+    void SW(GPR rs2, Label* label, GPR temp) noexcept;
+
     void LB(GPR rd, int32_t imm, GPR rs) noexcept;
     void LBU(GPR rd, int32_t imm, GPR rs) noexcept;
     void LH(GPR rd, int32_t imm, GPR rs) noexcept;
@@ -249,6 +959,9 @@ public:
 
     void SUB(GPR rd, GPR lhs, GPR rhs) noexcept;
 
+    void TAIL(Label* label) noexcept;
+    void TAIL(int32_t offset) noexcept;
+
     void XOR(GPR rd, GPR lhs, GPR rhs) noexcept;
     void XORI(GPR rd, GPR rs, uint32_t imm) noexcept;
 
@@ -256,6 +969,10 @@ public:
 
     void ADDIW(GPR rd, GPR rs, int32_t imm) noexcept;
     void ADDW(GPR rd, GPR lhs, GPR rhs) noexcept;
+    void LD(GPR rd, Label* label) noexcept;
+    void LWU(GPR rd, Label* label) noexcept;
+    void SD(GPR rs2, Label* label, GPR temp) noexcept;
+
     void LD(GPR rd, int32_t imm, GPR rs) noexcept;
     void LWU(GPR rd, int32_t imm, GPR rs) noexcept;
     void SD(GPR rs2, int32_t imm, GPR rs1) noexcept;
@@ -431,6 +1148,7 @@ public:
     void FLE_S(GPR rd, FPR rs1, FPR rs2) noexcept;
     void FLT_S(GPR rd, FPR rs1, FPR rs2) noexcept;
     void FLW(FPR rd, int32_t offset, GPR rs) noexcept;
+    void FLW(FPR rd, Label* label, GPR temp) noexcept;
     void FMADD_S(FPR rd, FPR rs1, FPR rs2, FPR rs3, RMode rmode = RMode::DYN) noexcept;
     void FMAX_S(FPR rd, FPR rs1, FPR rs2) noexcept;
     void FMIN_S(FPR rd, FPR rs1, FPR rs2) noexcept;
@@ -446,6 +1164,7 @@ public:
     void FSQRT_S(FPR rd, FPR rs1, RMode rmode = RMode::DYN) noexcept;
     void FSUB_S(FPR rd, FPR rs1, FPR rs2, RMode rmode = RMode::DYN) noexcept;
     void FSW(FPR rs2, int32_t offset, GPR rs1) noexcept;
+    void FSW(FPR rs2, Label* label, GPR temp) noexcept;
 
     void FABS_S(FPR rd, FPR rs) noexcept;
     void FMV_S(FPR rd, FPR rs) noexcept;
@@ -473,6 +1192,7 @@ public:
     void FLE_D(GPR rd, FPR rs1, FPR rs2) noexcept;
     void FLT_D(GPR rd, FPR rs1, FPR rs2) noexcept;
     void FLD(FPR rd, int32_t offset, GPR rs) noexcept;
+    void FLD(FPR rd, Label* label, GPR temp) noexcept;
     void FMADD_D(FPR rd, FPR rs1, FPR rs2, FPR rs3, RMode rmode = RMode::DYN) noexcept;
     void FMAX_D(FPR rd, FPR rs1, FPR rs2) noexcept;
     void FMIN_D(FPR rd, FPR rs1, FPR rs2) noexcept;
@@ -486,6 +1206,7 @@ public:
     void FSQRT_D(FPR rd, FPR rs1, RMode rmode = RMode::DYN) noexcept;
     void FSUB_D(FPR rd, FPR rs1, FPR rs2, RMode rmode = RMode::DYN) noexcept;
     void FSD(FPR rs2, int32_t offset, GPR rs1) noexcept;
+    void FSD(FPR rs2, Label* label, GPR temp) noexcept;
 
     void FABS_D(FPR rd, FPR rs) noexcept;
     void FMV_D(FPR rd, FPR rs) noexcept;
@@ -1480,19 +2201,411 @@ public:
     void VFWMACCBF16(Vec vd, Vec vs1, Vec vs2, VecMask mask = VecMask::No) noexcept;
 
 private:
-    // Binds a label to a given offset.
+    // Binds a label to a given offset, which mustn't be within already scheduled code.
     void BindToOffset(Label* label, Label::LocationOffset offset);
 
     // Links the given label and returns the offset to it.
-    ptrdiff_t LinkAndGetOffset(Label* label);
+    // The kind describes how the offset is going to be encoded.
+    ptrdiff_t LinkAndGetOffset(Label* label, RelocationKind kind);
+
+    // Links the given label to an AUIPC pair about to be emitted
+    // and returns the offset to it.
+    int32_t LinkAndGetPCRelOffset(Label* label);
 
     // Resolves all label offsets and patches any necessary
     // branch offsets into the branch instructions that
     // requires them.
     void ResolveLabelOffsets(Label* label);
 
+    // Adds a reference to an unbound label, keeping track of the earliest one.
+    void AddLabelOffset(Label* label, ptrdiff_t offset);
+
+    // Stops tracking the earliest reference to a label, which is
+    // about to be resolved or dropped. The label must be synced.
+    void UntrackLabelOffsets(const Label* label) noexcept;
+
+    // Encoding forms that a label reference can take under branch relaxation.
+    // These are ordered by size, and a reference only ever grows into a later form.
+    enum class RelaxForm : uint32_t {
+        Fixed,      // Instruction emitted outside of relaxation. Only its offset is patched.
+        Compressed, // C.BEQZ/C.BNEZ or C.J/C.JAL
+        Short,      // Bxx or JAL
+        Near,       // Inverted Bxx over a JAL
+        Far,        // Inverted Bxx over an AUIPC+JALR, or AUIPC+JALR for jumps
+    };
+
+    // A label reference tracked while branch relaxation is enabled.
+    struct RelaxedRef {
+        ptrdiff_t offset = 0;           // Offset of the referencing instruction sequence.
+        ptrdiff_t target = 0;           // Offset of the referenced label, if bound.
+        RelaxForm form = RelaxForm::Fixed;
+        uint32_t funct3 = 0;            // Branch condition. Unused for jumps.
+        GPR rs1;                        // First branch operand, or the link register for jumps.
+        GPR rs2;                        // Second branch operand. Unused for jumps.
+        bool is_jump = false;
+        bool is_bound = false;
+    };
+
+    // Bytes inserted into (or removed from, if negative) the code buffer at a given
+    // offset while relaxing a reference.
+    struct RelaxShift {
+        ptrdiff_t offset;
+        ptrdiff_t size;
+    };
+
+    // Emits a conditional branch or jump to a label, with relaxation applied.
+    void EmitRelaxedBranch(uint32_t funct3, GPR rs1, GPR rs2, Label* label);
+    void EmitRelaxedJump(GPR rd, Label* label);
+
+    // Starts tracking a label reference, if it can possibly be affected by relaxation.
+    void TrackRelaxedRef(const RelaxedRef& ref);
+
+    // Brings the offsets held within a label up to date with any relaxation shifts.
+    void SyncLabel(Label* label) noexcept;
+
+    // Resolves all references to a label emitted while relaxation was enabled.
+    void ResolveRelaxedRefs(Label* label);
+
+    // Grows references that are out of range until every bound reference fits, given the
+    // indices of the references that were just bound. Returns whether any code moved.
+    bool RelaxRefs(std::span<const size_t> bound);
+
+    // Grows a single reference into the given form, moving all code after it.
+    void GrowRelaxedRef(size_t index, RelaxForm form);
+
+    // Determines whether or not a reference can start out in its compressed form.
+    [[nodiscard]] bool IsCompressibleRef(const RelaxedRef& ref) const noexcept;
+
+    // Determines the smallest form, starting at the reference's current one, that reaches its target.
+    [[nodiscard]] RelaxForm GetRelaxedForm(const RelaxedRef& ref) const noexcept;
+
+    // Retrieves the size of a relaxed reference's instruction sequence in bytes.
+    [[nodiscard]] static size_t GetRelaxedRefSize(const RelaxedRef& ref) noexcept;
+
+    // Emits the instruction sequence for a relaxed reference into the given buffer.
+    void EncodeRelaxedRef(CodeBuffer& buffer, const RelaxedRef& ref) const noexcept;
+
+    // Rewrites the instruction sequence of a relaxed reference in place.
+    void PatchRelaxedRef(const RelaxedRef& ref) noexcept;
+
+    // Padding inserted by Align() while relaxation may still move the code before it.
+    struct RelaxAlign {
+        ptrdiff_t offset = 0; // Offset of the padding.
+        size_t size = 0;      // Size of the padding in bytes.
+        size_t alignment = 0;
+        AlignFill fill = AlignFill::Nop;
+    };
+
+    // Moves all code at or beyond the given offset by the given (possibly negative) number of bytes.
+    void ShiftRelaxedCode(ptrdiff_t offset, ptrdiff_t size);
+
+    // Recomputes the padding of every tracked alignment after code has been moved.
+    void RealignRelaxedCode();
+
+    // Discards tracked references and alignments at or beyond the given offset.
+    void DiscardRelaxedRefs(ptrdiff_t offset) noexcept;
+
+    // A 64-bit constant within the literal pool, along with the label it's bound to.
+    // Literals move around as the pool grows, so they can't be referred to by relocations.
+    struct Literal {
+        uint64_t value = 0;
+        Label label = Label::Local();
+    };
+
+    // Retrieves the pool label for a literal, creating a pending one if necessary.
+    Label* GetLiteralLabel(uint64_t value);
+
+    // Discards literals and literal references at or beyond the given offset.
+    void DiscardLiterals(ptrdiff_t offset) noexcept;
+
+    // Records a relocation, if recording is enabled.
+    void RecordRelocation(RelocationKind kind, ptrdiff_t offset, const Label* label, ptrdiff_t base = 0);
+
+    // Emits data referencing a label, patching it in once the label is bound.
+    void EmitDataReference(RelocationKind kind, Label* label, ptrdiff_t base);
+
+    // Patches all pending data references to a label that was just bound.
+    void ResolveDataReferences(const Label* label);
+
+    // Whether relocations refer to a label's location rather than the label itself.
+    [[nodiscard]] bool IsLocalLabel(const Label* label) const noexcept;
+
+    // Rewrites the relocation recorded for a reference to a local label
+    // that was just bound to refer to the label's location instead.
+    void DetachLabelReference(const Label* label, ptrdiff_t offset) noexcept;
+
+    // Discards relocations and data references at or beyond the given offset.
+    void DiscardRelocations(ptrdiff_t offset) noexcept;
+
+    // Schedules a range of code as a single basic block.
+    void ScheduleRange(ptrdiff_t begin, ptrdiff_t end);
+
+    // Pads the cursor to a 4-byte boundary, if patchable slots are enabled.
+    void AlignPatchSlot() noexcept;
+
+    // rd = (condition != 0) ? a : b, where condition is either 0 or 1 and is clobbered.
+    void EmitSelect(GPR rd, GPR condition, GPR a, GPR b) noexcept;
+
+    // rd = (condition != 0) ? a : b, as a branch over a single move.
+    // Returns false without emitting anything if the operands don't allow it.
+    bool TryEmitShortForwardSelect(GPR rd, GPR condition, GPR a, GPR b);
+
+    // Emits an instruction, replacing it with its compressed form if
+    // automatic compression is enabled and its operands allow it.
+    void EmitCompressible(uint32_t instruction) noexcept {
+        if (m_auto_compress) [[unlikely]] {
+            if (TryEmitCompressed(instruction)) {
+                return;
+            }
+        }
+        m_buffer.Emit32(instruction);
+    }
+
+    // Emits the compressed equivalent of an instruction, if there is one.
+    // Returns false without emitting anything otherwise.
+    bool TryEmitCompressed(uint32_t instruction) noexcept;
+
     CodeBuffer m_buffer;
     ArchFeature m_features = ArchFeature::RV64;
+    ExtensionSet m_extensions;
+
+    // Branch relaxation state.
+    std::vector<RelaxedRef> m_relaxed_refs;
+    std::vector<RelaxShift> m_relax_shifts;
+    std::vector<RelaxAlign> m_relax_aligns;
+    size_t m_relax_pending = 0;
+    std::vector<size_t> m_relax_worklist; // Indices of the references bound by the current Bind().
+    GPR m_relax_scratch;
+    bool m_relax_branches = false;
+
+    // Literal pool state. Literals before m_literals_first_pending have been
+    // emitted, and may be reused while they're in range.
+    std::vector<Literal> m_literals;
+    std::unordered_map<uint64_t, size_t> m_literal_indices;
+    size_t m_literals_first_pending = 0;
+    ptrdiff_t m_literals_first_ref = 0;
+    ptrdiff_t m_literal_pool_max_distance = literal_pool_default_max_distance;
+    uint32_t m_literal_pool_max_inline = literal_pool_default_max_inline;
+    bool m_literal_pool_enabled = false;
+
+    // Cold blocks deferred until the cold section is flushed.
+    std::vector<ColdBlock> m_cold_blocks;
+
+    // Scheduling state. Code from m_schedule_start up to the cursor has yet to be scheduled.
+    InstructionScheduler* m_scheduler = nullptr;
+    ptrdiff_t m_schedule_start = 0;
+
+    // The core to tune macro-ops for, if any.
+    const TuningModel* m_tuning = nullptr;
+
+    // Sorted offsets of the earliest reference to each unbound label.
+    std::vector<ptrdiff_t> m_unresolved_refs;
+
+    // Relocation state. Data references waiting on their label to be
+    // bound are always tracked, regardless of whether recording is enabled.
+    std::vector<Relocation> m_relocations;
+    std::vector<Relocation> m_pending_data_refs;
+
+    // For assemblers reassembling a region, the labels bound so far. These
+    // are the region emitter's own, so they're treated as local.
+    bool m_reassembling = false;
+    std::vector<const Label*> m_region_labels;
+    bool m_record_relocations = false;
+
+    bool m_patchable_slots = false;
+    bool m_auto_compress = false;
+
+    // Vector configuration tracking state.
+    struct VTypeState {
+        uint32_t vtype = 0;
+        uint32_t avl = 0;         // The immediate AVL vl was set from, if vl is known.
+        bool vtype_known = false;
+        bool vl_known = false;
+    };
+    VTypeState m_vtype_state;
+    bool m_vtype_tracking = false;
+
+    // Label arena state. Labels are allocated in fixed-size
+    // blocks so that handed out pointers stay stable.
+    static constexpr size_t label_block_size = 256;
+    std::vector<std::unique_ptr<Label[]>> m_label_blocks;
+    size_t m_label_count = 0;
 };
 
+// The most commonly emitted base integer instructions are defined inline, so that
+// encoding them can be constant folded into a single store when the operands
+// are known at compile time, without relying on link-time optimization.
+
+inline void Assembler::ADD(GPR rd, GPR lhs, GPR rhs) noexcept {
+    EmitCompressible(enc::ADD(rd, lhs, rhs));
+}
+
+inline void Assembler::ADDI(GPR rd, GPR rs, int32_t imm) noexcept {
+    EmitCompressible(enc::ADDI(rd, rs, imm));
+}
+
+inline void Assembler::AND(GPR rd, GPR lhs, GPR rhs) noexcept {
+    EmitCompressible(enc::AND(rd, lhs, rhs));
+}
+
+inline void Assembler::ANDI(GPR rd, GPR rs, uint32_t imm) noexcept {
+    EmitCompressible(enc::ANDI(rd, rs, imm));
+}
+
+inline void Assembler::AUIPC(GPR rd, int32_t imm) noexcept {
+    m_buffer.Emit32(enc::AUIPC(rd, imm));
+}
+
+inline void Assembler::LB(GPR rd, int32_t imm, GPR rs) noexcept {
+    m_buffer.Emit32(enc::LB(rd, imm, rs));
+}
+
+inline void Assembler::LBU(GPR rd, int32_t imm, GPR rs) noexcept {
+    EmitCompressible(enc::LBU(rd, imm, rs));
+}
+
+inline void Assembler::LH(GPR rd, int32_t imm, GPR rs) noexcept {
+    EmitCompressible(enc::LH(rd, imm, rs));
+}
+
+inline void Assembler::LHU(GPR rd, int32_t imm, GPR rs) noexcept {
+    EmitCompressible(enc::LHU(rd, imm, rs));
+}
+
+inline void Assembler::LUI(GPR rd, uint32_t imm) noexcept {
+    EmitCompressible(enc::LUI(rd, imm));
+}
+
+inline void Assembler::LW(GPR rd, int32_t imm, GPR rs) noexcept {
+    EmitCompressible(enc::LW(rd, imm, rs));
+}
+
+inline void Assembler::MV(GPR rd, GPR rs) noexcept {
+    ADDI(rd, rs, 0);
+}
+
+inline void Assembler::NOP() noexcept {
+    ADDI(x0, x0, 0);
+}
+
+inline void Assembler::OR(GPR rd, GPR lhs, GPR rhs) noexcept {
+    EmitCompressible(enc::OR(rd, lhs, rhs));
+}
+
+inline void Assembler::ORI(GPR rd, GPR rs, uint32_t imm) noexcept {
+    m_buffer.Emit32(enc::ORI(rd, rs, imm));
+}
+
+inline void Assembler::SB(GPR rs2, int32_t imm, GPR rs1) noexcept {
+    EmitCompressible(enc::SB(rs2, imm, rs1));
+}
+
+inline void Assembler::SH(GPR rs2, int32_t imm, GPR rs1) noexcept {
+    EmitCompressible(enc::SH(rs2, imm, rs1));
+}
+
+inline void Assembler::SW(GPR rs2, int32_t imm, GPR rs1) noexcept {
+    EmitCompressible(enc::SW(rs2, imm, rs1));
+}
+
+inline void Assembler::SLL(GPR rd, GPR lhs, GPR rhs) noexcept {
+    m_buffer.Emit32(enc::SLL(rd, lhs, rhs));
+}
+
+inline void Assembler::SLLI(GPR rd, GPR rs, uint32_t shift) noexcept {
+    if (m_features == ArchFeature::RV32) {
+        BISCUIT_ASSERT(shift <= 31);
+        EmitCompressible(EncodeIType(shift & 0x1F, rs, 0b001, rd, 0b0010011));
+    } else {
+        BISCUIT_ASSERT(shift <= 63);
+        EmitCompressible(EncodeIType(shift & 0x3F, rs, 0b001, rd, 0b0010011));
+    }
+}
+
+inline void Assembler::SLT(GPR rd, GPR lhs, GPR rhs) noexcept {
+    m_buffer.Emit32(enc::SLT(rd, lhs, rhs));
+}
+
+inline void Assembler::SLTI(GPR rd, GPR rs, int32_t imm) noexcept {
+    m_buffer.Emit32(enc::SLTI(rd, rs, imm));
+}
+
+inline void Assembler::SLTIU(GPR rd, GPR rs, int32_t imm) noexcept {
+    m_buffer.Emit32(enc::SLTIU(rd, rs, imm));
+}
+
+inline void Assembler::SLTU(GPR rd, GPR lhs, GPR rhs) noexcept {
+    m_buffer.Emit32(enc::SLTU(rd, lhs, rhs));
+}
+
+inline void Assembler::SRA(GPR rd, GPR lhs, GPR rhs) noexcept {
+    m_buffer.Emit32(enc::SRA(rd, lhs, rhs));
+}
+
+inline void Assembler::SRAI(GPR rd, GPR rs, uint32_t shift) noexcept {
+    if (m_features == ArchFeature::RV32) {
+        BISCUIT_ASSERT(shift <= 31);
+        EmitCompressible(EncodeIType((0b0100000 << 5) | (shift & 0x1F), rs, 0b101, rd, 0b0010011));
+    } else {
+        BISCUIT_ASSERT(shift <= 63);
+        EmitCompressible(EncodeIType((0b0100000 << 5) | (shift & 0x3F), rs, 0b101, rd, 0b0010011));
+    }
+}
+
+inline void Assembler::SRL(GPR rd, GPR lhs, GPR rhs) noexcept {
+    m_buffer.Emit32(enc::SRL(rd, lhs, rhs));
+}
+
+inline void Assembler::SRLI(GPR rd, GPR rs, uint32_t shift) noexcept {
+    if (m_features == ArchFeature::RV32) {
+        BISCUIT_ASSERT(shift <= 31);
+        EmitCompressible(EncodeIType(shift & 0x1F, rs, 0b101, rd, 0b0010011));
+    } else {
+        BISCUIT_ASSERT(shift <= 63);
+        EmitCompressible(EncodeIType(shift & 0x3F, rs, 0b101, rd, 0b0010011));
+    }
+}
+
+inline void Assembler::SUB(GPR rd, GPR lhs, GPR rhs) noexcept {
+    EmitCompressible(enc::SUB(rd, lhs, rhs));
+}
+
+inline void Assembler::XOR(GPR rd, GPR lhs, GPR rhs) noexcept {
+    EmitCompressible(enc::XOR(rd, lhs, rhs));
+}
+
+inline void Assembler::XORI(GPR rd, GPR rs, uint32_t imm) noexcept {
+    EmitCompressible(enc::XORI(rd, rs, imm));
+}
+
+inline void Assembler::ADDIW(GPR rd, GPR rs, int32_t imm) noexcept {
+    BISCUIT_ASSERT(m_features == ArchFeature::RV64);
+    EmitCompressible(enc::ADDIW(rd, rs, imm));
+}
+
+inline void Assembler::ADDW(GPR rd, GPR lhs, GPR rhs) noexcept {
+    BISCUIT_ASSERT(m_features == ArchFeature::RV64);
+    EmitCompressible(enc::ADDW(rd, lhs, rhs));
+}
+
+inline void Assembler::LD(GPR rd, int32_t imm, GPR rs) noexcept {
+    BISCUIT_ASSERT(m_features == ArchFeature::RV64);
+    EmitCompressible(enc::LD(rd, imm, rs));
+}
+
+inline void Assembler::LWU(GPR rd, int32_t imm, GPR rs) noexcept {
+    BISCUIT_ASSERT(m_features == ArchFeature::RV64);
+    m_buffer.Emit32(enc::LWU(rd, imm, rs));
+}
+
+inline void Assembler::SD(GPR rs2, int32_t imm, GPR rs1) noexcept {
+    BISCUIT_ASSERT(m_features == ArchFeature::RV64);
+    EmitCompressible(enc::SD(rs2, imm, rs1));
+}
+
+inline void Assembler::SUBW(GPR rd, GPR lhs, GPR rhs) noexcept {
+    BISCUIT_ASSERT(m_features == ArchFeature::RV64);
+    EmitCompressible(enc::SUBW(rd, lhs, rhs));
+}
+
 } // namespace biscuit
@@ -3,6 +3,18 @@
 #include <cstdio>
 #include <cstdlib>
 
+// Defining BISCUIT_DISABLE_ASSERTS turns every assertion into a no-op.
+// This removes the per-instruction operand and range checks from release
+// builds, at the cost of invalid input silently producing broken code.
+//
+// The condition is still evaluated for any side effects it has, but
+// anything side-effect free is trivially optimized away.
+#if defined(BISCUIT_DISABLE_ASSERTS)
+#define BISCUIT_ASSERT(condition)                                        \
+  do {                                                                   \
+    static_cast<void>(condition);                                        \
+  } while (false)
+#else
 #define BISCUIT_ASSERT(condition)                                        \
   do {                                                                   \
     if (!(condition)) {                                                  \
@@ -12,3 +24,4 @@
       std::abort();                                                      \
     }                                                                    \
   } while (false)
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <biscuit/code_buffer.hpp>
+#include <biscuit/relocation.hpp>
+
+namespace biscuit {
+
+class Label;
+
+// Serialization of code into a position-independent binary blob,
+// suitable for persisting generated code across runs.
+//
+// A blob consists of a fixed-size header, the code itself (aligned to
+// code_blob_code_alignment within the blob) and a table of the relocations
+// needed to load it at a new address. All fields are stored in the byte order
+// of the host. Since the code is stored as-is, a blob can also be loaded
+// straight out of a memory-mapped file.
+//
+// Only relocations that actually depend on the load address are stored.
+// PC-relative references between two locations within the code always
+// stay valid, so they're left out entirely.
+
+/// Version of the blob format. Blobs with any other version are rejected when loading.
+inline constexpr uint32_t code_blob_version = 1;
+
+/// Alignment of the code within a blob, relative to the start of the blob.
+inline constexpr size_t code_blob_code_alignment = 16;
+
+/**
+ * Maps a label referenced by the code onto an external symbol ID.
+ *
+ * Returning an ID marks references to the label as references to something
+ * outside of the code, which must be resolved again when the blob is loaded.
+ * Returning an empty optional treats the label as a location within the code.
+ */
+using CodeBlobSymbolMapper = std::function<std::optional<uint32_t>(const Label*)>;
+
+/// Retrieves the address of an external symbol while a blob is being loaded.
+using CodeBlobSymbolResolver = std::function<uintptr_t(uint32_t)>;
+
+/**
+ * Serializes all code within a code buffer into a blob.
+ *
+ * @param buffer      The code buffer containing the code.
+ * @param relocations All relocations recorded while emitting the code.
+ * @param get_symbol  Optional mapper for labels that refer to external symbols.
+ * @param tag         An arbitrary value identifying what the code was generated for
+ *                    (e.g. a hash of the ISA extensions and generator version).
+ *
+ * @pre Every label referred to by the relocations must still exist, and must
+ *      either be bound within the code buffer, or be mapped onto an external symbol.
+ *      References to local labels (see Label::Local()) are always within the code.
+ * @pre None of the code may have been released with CodeBuffer::ReleaseBefore(),
+ *      since relocations are recorded as offsets from the start of the buffer.
+ *
+ * @par
+ * An example of persisting and reloading code:
+ *
+ * @code{.cpp}
+ * as.SetRelocationRecording(true);
+ * // Emit code...
+ *
+ * const auto blob = SerializeCode(as.GetCodeBuffer(), as.GetRelocations(), get_symbol);
+ * // Write the blob out...
+ *
+ * // On a later run, after reading the blob back in:
+ * const auto offset = LoadCode(code_buffer, blob, resolve_symbol);
+ * if (!offset) {
+ *     // Stale or corrupted blob. Regenerate the code.
+ * }
+ * @endcode
+ */
+[[nodiscard]] std::vector<uint8_t> SerializeCode(const CodeBuffer& buffer,
+                                                 std::span<const Relocation> relocations,
+                                                 const CodeBlobSymbolMapper& get_symbol = {},
+                                                 uint64_t tag = 0);
+
+/**
+ * Loads the code within a blob into a code buffer, at its cursor.
+ *
+ * The code is copied into the buffer in one go, after which every stored
+ * relocation is applied in a single pass over the relocation table.
+ *
+ * @param buffer         The code buffer to load the code into.
+ * @param blob           The blob to load.
+ * @param resolve_symbol Resolver for the blob's external symbols. May be empty
+ *                       if the blob doesn't refer to any.
+ * @param tag            The tag the blob is expected to have been serialized with.
+ *
+ * @returns The offset the code was loaded at, or an empty optional if the blob is
+ *          malformed, has a different version, was serialized with a different tag,
+ *          or doesn't fit into a buffer that can't grow. Nothing is written into the
+ *          buffer in that case, though a growable buffer may have grown.
+ *
+ * @note Making the loaded code visible to instruction fetch (e.g. with
+ *       CodeBuffer::FlushInstructionCache()) is up to the caller.
+ */
+[[nodiscard]] std::optional<ptrdiff_t> LoadCode(CodeBuffer& buffer,
+                                                std::span<const uint8_t> blob,
+                                                const CodeBlobSymbolResolver& resolve_symbol = {},
+                                                uint64_t tag = 0);
+
+} // namespace biscuit
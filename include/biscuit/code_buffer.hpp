@@ -3,12 +3,67 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <span>
 #include <type_traits>
 
 #include <biscuit/assert.hpp>
 
 namespace biscuit {
 
+/**
+ * Describes how the memory of a managed code buffer is mapped.
+ */
+enum class CodeBufferMapping : uint32_t {
+    /// The memory is mapped once, and has to be toggled between writable and executable.
+    Single,
+
+    /**
+     * The same memory is mapped twice: once as read/write and once as read/execute.
+     *
+     * Code is emitted through the writable mapping, while all addresses handed out
+     * by the buffer (e.g. GetOffsetAddress()) refer to the executable mapping.
+     * This allows for patching code under W^X without ever changing page protections.
+     *
+     * @note Only supported on Linux with BISCUIT_CODE_BUFFER_MMAP enabled.
+     */
+    Dual,
+};
+
+/**
+ * Describes the pages backing the memory of a managed code buffer.
+ */
+enum class CodeBufferPages : uint32_t {
+    /// Regular pages.
+    Default,
+
+    /**
+     * Huge pages (CodeBuffer::huge_page_size), which greatly reduce iTLB misses
+     * when executing large amounts of code.
+     *
+     * Explicit huge pages (MAP_HUGETLB, or MFD_HUGETLB for dual-mapped buffers) are
+     * tried first. If none are available, regular pages aligned to the huge page size
+     * are used instead, with transparent huge pages requested for them through
+     * madvise(MADV_HUGEPAGE). Either way, the capacity is rounded up to a multiple of
+     * the huge page size.
+     *
+     * @note Only has an effect on Linux with BISCUIT_CODE_BUFFER_MMAP enabled.
+     *       Otherwise, regular memory is used.
+     */
+    Huge,
+};
+
+/**
+ * A range of bytes within a code buffer, described as an offset
+ * from the start of the buffer and a size in bytes.
+ */
+struct CodeRange {
+    ptrdiff_t offset = 0;
+    size_t size = 0;
+};
+
+class CodeReservation;
+class EmissionStats;
+
 /**
  * An arbitrarily sized buffer that code is written into.
  *
@@ -20,12 +75,23 @@ public:
     // Default capacity of 4KB.
     static constexpr size_t default_capacity = 4096;
 
+    // Granularity of ReleaseBefore(). Releasing whole multiples of it keeps the
+    // distance between addresses and offsets a multiple of any alignment up to it.
+    static constexpr size_t release_granularity = 4096;
+
+    // Size of the huge pages requested by CodeBufferPages::Huge.
+    static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
     /**
      * Constructor
      *
      * @param capacity The initial capacity of the code buffer in bytes.
+     * @param mapping  How the memory of the code buffer should be mapped.
+     * @param pages    The pages the memory of the code buffer should be backed by.
      */
-    explicit CodeBuffer(size_t capacity = default_capacity);
+    explicit CodeBuffer(size_t capacity = default_capacity,
+                        CodeBufferMapping mapping = CodeBufferMapping::Single,
+                        CodeBufferPages pages = CodeBufferPages::Default);
 
     /**
      * Constructor
@@ -61,9 +127,93 @@ public:
     /// Returns whether or not the memory is managed by the code buffer.
     [[nodiscard]] bool IsManaged() const noexcept { return m_is_managed; }
 
+    /// Returns whether or not the code buffer's memory is mapped as separate writable and executable views.
+    [[nodiscard]] bool IsDualMapped() const noexcept { return m_mapping == CodeBufferMapping::Dual; }
+
+    /// Returns whether or not dual-mapped code buffers are supported in this build.
+    [[nodiscard]] static bool IsDualMappingSupported() noexcept;
+
+    /**
+     * Returns whether or not the code buffer's memory is backed by explicit huge pages.
+     *
+     * This is only ever the case for buffers constructed with CodeBufferPages::Huge,
+     * and only when explicit huge pages were available. Whether transparent huge
+     * pages back the memory instead is up to the kernel, and can't be queried.
+     *
+     * @note Protection changes (e.g. SetExecutable(ptrdiff_t, size_t)) to buffers
+     *       backed by explicit huge pages apply to whole huge pages at a time.
+     */
+    [[nodiscard]] bool IsHugePageBacked() const noexcept { return m_huge_pages; }
+
+    /// Returns whether or not the code buffer automatically grows when it runs out of space.
+    [[nodiscard]] bool IsGrowable() const noexcept { return m_is_growable; }
+
+    /**
+     * Sets whether or not the code buffer should automatically grow
+     * when emitting data into it would exceed its capacity.
+     *
+     * Growth is geometric (the capacity is doubled until the data fits),
+     * so emitting N bytes only ever results in O(log N) reallocations.
+     *
+     * @pre The underlying memory of the code buffer *must* be managed
+     *      by the code buffer itself in order to enable growth.
+     *
+     * @note Growing may move the underlying memory. Offsets into the buffer
+     *       (and thus labels) stay valid, but any pointers or addresses
+     *       previously retrieved from the buffer should be considered stale.
+     */
+    void SetGrowable(bool growable) noexcept {
+        BISCUIT_ASSERT(!growable || IsManaged());
+        m_is_growable = growable;
+    }
+
+    /**
+     * Sets the statistics that emission into the code buffer is recorded into.
+     *
+     * Every 16-bit and 32-bit value emitted is recorded as an instruction,
+     * along with every time the buffer grows.
+     *
+     * @param stats The statistics to record into, or nullptr to stop recording.
+     *
+     * @note Recording is only compiled in when BISCUIT_EMISSION_STATS is enabled.
+     *       Otherwise this does nothing, and the emission path is left untouched.
+     */
+    void SetEmissionStats([[maybe_unused]] EmissionStats* stats) noexcept {
+#ifdef BISCUIT_EMISSION_STATS
+        m_stats = stats;
+#endif
+    }
+
+    /// Retrieves the statistics emission is recorded into, if any.
+    [[nodiscard]] EmissionStats* GetEmissionStats() const noexcept {
+#ifdef BISCUIT_EMISSION_STATS
+        return m_stats;
+#else
+        return nullptr;
+#endif
+    }
+
+    /// Returns whether or not emission statistics are compiled into this build.
+    [[nodiscard]] static constexpr bool IsEmissionStatsSupported() noexcept {
+#ifdef BISCUIT_EMISSION_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
     /// Retrieves the current cursor position within the buffer.
     [[nodiscard]] ptrdiff_t GetCursorOffset() const noexcept {
-        return m_cursor - m_buffer;
+        return m_base + (m_cursor - m_buffer);
+    }
+
+    /**
+     * Retrieves the offset of the first byte still held by the buffer.
+     *
+     * This is zero unless the start of the buffer has been released with ReleaseBefore().
+     */
+    [[nodiscard]] ptrdiff_t GetBaseOffset() const noexcept {
+        return m_base;
     }
 
     /// Retrieves the current address of the cursor within the buffer.
@@ -81,21 +231,44 @@ public:
         return GetOffsetPointer(GetCursorOffset());
     }
 
-    /// Retrieves the address of an arbitrary offset within the buffer.
+    /**
+     * Retrieves the address of an arbitrary offset within the buffer.
+     *
+     * @note For dual-mapped buffers, this is the address of the offset
+     *       within the executable mapping.
+     *
+     * @note Offsets that have been released with ReleaseBefore() still have an address,
+     *       as if the memory was still there, so that distances between offsets stay the same.
+     *       The same goes for offsets past the end of views (see CreateView()).
+     */
     [[nodiscard]] uintptr_t GetOffsetAddress(ptrdiff_t offset) const noexcept {
-        return reinterpret_cast<uintptr_t>(GetOffsetPointer(offset));
+        const auto* const base = m_exec_buffer != nullptr ? m_exec_buffer : m_buffer;
+        BISCUIT_ASSERT(offset >= 0 && (offset <= GetCursorOffset() || m_is_view));
+        return reinterpret_cast<uintptr_t>(base) + static_cast<uintptr_t>(offset - m_base);
+    }
+
+    /**
+     * Retrieves the pointer to an arbitrary location within the buffer
+     * that's suitable for executing the code at that location.
+     *
+     * @note For buffers that aren't dual-mapped, this is the same as GetOffsetPointer().
+     */
+    [[nodiscard]] const uint8_t* GetExecutableOffsetPointer(ptrdiff_t offset) const noexcept {
+        const auto* const base = m_exec_buffer != nullptr ? m_exec_buffer : m_buffer;
+        BISCUIT_ASSERT(offset >= m_base && offset <= GetCursorOffset());
+        return base + (offset - m_base);
     }
 
     /// Retrieves the pointer to an arbitrary location within the buffer.
     [[nodiscard]] uint8_t* GetOffsetPointer(ptrdiff_t offset) noexcept {
-        BISCUIT_ASSERT(offset >= 0 && offset <= GetCursorOffset());
-        return m_buffer + offset;
+        BISCUIT_ASSERT(offset >= m_base && offset <= GetCursorOffset());
+        return m_buffer + (offset - m_base);
     }
 
     /// Retrieves the pointer to an arbitrary location within the buffer.
     [[nodiscard]] const uint8_t* GetOffsetPointer(ptrdiff_t offset) const noexcept {
-        BISCUIT_ASSERT(offset >= 0 && offset <= GetCursorOffset());
-        return m_buffer + offset;
+        BISCUIT_ASSERT(offset >= m_base && offset <= GetCursorOffset());
+        return m_buffer + (offset - m_base);
     }
 
     /**
@@ -108,13 +281,65 @@ public:
      *
      * @note The offset may not be larger than the current cursor offset
      *       and may not be less than the current buffer starting address.
+     *       That is, the base offset if the buffer's start has been released.
      */
     void RewindCursor(ptrdiff_t offset = 0) noexcept {
-        auto* rewound = m_buffer + offset;
-        BISCUIT_ASSERT(m_buffer <= rewound && rewound <= m_cursor);
-        m_cursor = rewound;
+        BISCUIT_ASSERT(m_base <= offset && offset <= GetCursorOffset());
+        m_cursor = m_buffer + (offset - m_base);
+    }
+
+    /**
+     * Discards all data within the buffer, including anything released
+     * with ReleaseBefore(), so that offsets start over from zero.
+     *
+     * @note Views (see CreateView()) keep their base offset, since
+     *       their offsets are tied to the buffer they were created from.
+     */
+    void Reset() noexcept {
+        m_cursor = m_buffer;
+        if (!m_is_view) {
+            m_base = 0;
+        }
     }
 
+    /**
+     * Releases everything before an offset from the buffer, making its memory
+     * available to code emitted from then on.
+     *
+     * The data after the offset is moved to the start of the buffer, while offsets
+     * stay the same. i.e. The cursor offset doesn't change, and offsets before the
+     * base offset may no longer be read or written. This allows emitting an arbitrary
+     * amount of code through a buffer of bounded size, as long as finished code is
+     * copied elsewhere before being released (see CodeStream).
+     *
+     * @param offset The offset to release everything before. It's rounded down
+     *               to a multiple of release_granularity.
+     *
+     * @returns The new base offset.
+     *
+     * @note Since released memory is reused, addresses retrieved from the
+     *       buffer shouldn't be executed or stored once anything is released.
+     */
+    ptrdiff_t ReleaseBefore(ptrdiff_t offset) noexcept;
+
+    /**
+     * Creates a code buffer over part of this buffer's memory.
+     *
+     * The view's offsets are the same as this buffer's, with its base offset (see
+     * GetBaseOffset()) being the start of the range, and its cursor starting out
+     * there. Emitting into the view overwrites the range, while addresses of offsets
+     * outside of it still refer to this buffer's memory. This allows a separate
+     * assembler to regenerate part of the code in place (see Assembler::ReassembleRegion()).
+     *
+     * @param range The range to create a view over.
+     *
+     * @pre The range must lie within the data held by this buffer.
+     *
+     * @note The view doesn't own its memory, and must not outlive this buffer,
+     *       nor be used after this buffer grows.
+     */
+    [[nodiscard]] CodeBuffer CreateView(const CodeRange& range) noexcept;
+
     /**
      * Whether or not the underlying buffer has enough room for the
      * given number of bytes.
@@ -125,12 +350,21 @@ public:
         return GetRemainingBytes() >= num_bytes;
     }
 
-    /// Returns the size of the data written to the buffer in bytes.
+    /**
+     * Returns the size of the data written to the buffer in bytes.
+     *
+     * @note Data released with ReleaseBefore() isn't counted.
+     */
     [[nodiscard]] size_t GetSizeInBytes() const noexcept {
         EnsureBufferRange();
         return static_cast<size_t>(m_cursor - m_buffer);
     }
 
+    /// Returns the total capacity of the buffer in bytes.
+    [[nodiscard]] size_t GetCapacity() const noexcept {
+        return m_capacity;
+    }
+
     /// Returns the total number of remaining bytes in the buffer.
     [[nodiscard]] size_t GetRemainingBytes() const noexcept {
         EnsureBufferRange();
@@ -150,9 +384,26 @@ public:
      * @note Calling this with a new capacity that is less than or equal
      *       to the current capacity of the buffer will result in
      *       this function doing nothing.
+     *
+     * @note Failing to allocate the new memory results in an assertion being hit,
+     *       since buffers may also grow from within emission (see SetGrowable()).
      */
     void Grow(size_t new_capacity);
 
+    /**
+     * Ensures that the code buffer can hold the given number of additional bytes.
+     *
+     * If the buffer is growable, it'll grow to fit the bytes if necessary.
+     * Otherwise this asserts that there's enough space remaining.
+     *
+     * @param num_bytes The number of bytes about to be stored in the buffer.
+     */
+    void EnsureSpaceFor(size_t num_bytes) noexcept {
+        if (!HasSpaceForFast(num_bytes)) [[unlikely]] {
+            GrowToFit(num_bytes);
+        }
+    }
+
     /**
      * Emits a given value into the code buffer.
      *
@@ -163,7 +414,7 @@ public:
     void Emit(T value) noexcept {
         static_assert(std::is_trivially_copyable_v<T>,
                       "It's undefined behavior to memcpy a non-trivially-copyable type.");
-        BISCUIT_ASSERT(HasSpaceFor(sizeof(T)));
+        EnsureSpaceFor(sizeof(T));
 
         std::memcpy(m_cursor, &value, sizeof(T));
         m_cursor += sizeof(T);
@@ -172,19 +423,39 @@ public:
     /// Emits a 16-bit value into the code buffer.
     void Emit16(uint32_t value) noexcept {
         Emit(static_cast<uint16_t>(value));
+        RecordInstruction(value, 2);
     }
 
     /// Emits a 32-bit value into the code buffer.
     void Emit32(uint32_t value) noexcept {
         Emit(value);
+        RecordInstruction(value, 4);
     }
 
+    /**
+     * Reserves space for a run of data that's about to be emitted.
+     *
+     * The capacity check (and any growth) happens exactly once, here.
+     * Everything emitted through the returned reservation is then stored
+     * without further checks, and the buffer's cursor is only updated
+     * once the reservation is committed or goes out of scope.
+     *
+     * @param num_bytes The maximum number of bytes that will be emitted.
+     *
+     * @note Nothing else may be emitted into the code buffer, nor may it be
+     *       grown, rewound, etc. while the reservation is alive.
+     */
+    [[nodiscard]] CodeReservation Reserve(size_t num_bytes) noexcept;
+
     /**
      * Sets the internal code buffer to be executable.
      *
      * @note This will make the contained region of memory non-writable
      *       to satisfy operating under W^X contexts. To make the
      *       region writable again, use SetWritable().
+     *
+     * @note Dual-mapped buffers are always both writable and executable
+     *       through their respective mappings, so this does nothing for them.
      */
     void SetExecutable();
 
@@ -194,18 +465,228 @@ public:
      * @note This will make the contained region of memory non-executable
      *       to satisfy operating under W^X contexts. To make the region
      *       executable again, use SetExecutable().
+     *
+     * @note Dual-mapped buffers are always both writable and executable
+     *       through their respective mappings, so this does nothing for them.
      */
     void SetWritable();
 
+    /**
+     * Sets a subrange of the code buffer to be executable.
+     *
+     * @param offset The offset of the start of the range.
+     * @param size   The size of the range in bytes.
+     *
+     * @note The range is expanded outwards to page boundaries, so any other
+     *       code or data sharing those pages is affected as well.
+     *
+     * @note This does nothing for dual-mapped buffers, or for buffers
+     *       not allocated with mmap, as their protection can't be changed.
+     */
+    void SetExecutable(ptrdiff_t offset, size_t size);
+
+    /**
+     * Sets a subrange of the code buffer to be writable.
+     *
+     * @param offset The offset of the start of the range.
+     * @param size   The size of the range in bytes.
+     *
+     * @note The range is expanded outwards to page boundaries, so any other
+     *       code or data sharing those pages is affected as well.
+     *
+     * @note This does nothing for dual-mapped buffers, or for buffers
+     *       not allocated with mmap, as their protection can't be changed.
+     */
+    void SetWritable(ptrdiff_t offset, size_t size);
+
+    /**
+     * Makes all code emitted so far visible to instruction fetch.
+     *
+     * @see FlushInstructionCache(std::span<const CodeRange>)
+     */
+    void FlushInstructionCache() const;
+
+    /**
+     * Makes newly written or patched code visible to instruction fetch.
+     *
+     * @param ranges The ranges of the buffer that have been modified.
+     *
+     * @note All of the given ranges are synchronized with a single flush
+     *       where the platform allows it. Batching many small patches into
+     *       one call is considerably cheaper than flushing after each one.
+     */
+    void FlushInstructionCache(std::span<const CodeRange> ranges) const;
+
+    /**
+     * Atomically replaces a single 32-bit instruction while it may be executing.
+     *
+     * The instruction is written with a single naturally aligned store, so other
+     * harts fetch either the old or the new instruction and never a mix of both.
+     * It's then made visible to instruction fetch on all harts before returning
+     * (through the kernel's remote FENCE.I on RISC-V Linux).
+     *
+     * @param offset      The offset of the instruction to replace.
+     * @param instruction The new instruction.
+     *
+     * @pre The address of the instruction must be 4-byte aligned.
+     * @pre The instruction must lie within the code written to the buffer so far.
+     *
+     * @note The memory must be writable. Dual-mapped buffers always are.
+     */
+    void PatchInstruction(ptrdiff_t offset, uint32_t instruction);
+
 private:
+    friend class CodeReservation;
+
     void EnsureBufferRange() const noexcept {
         BISCUIT_ASSERT(m_cursor >= m_buffer && m_cursor <= m_buffer + m_capacity);
     }
 
+    // Capacity check used on the emission path. Unlike HasSpaceFor(), this
+    // boils down to a single comparison, since the cursor is always kept in range.
+    [[nodiscard]] bool HasSpaceForFast(size_t num_bytes) const noexcept {
+        return static_cast<size_t>((m_buffer + m_capacity) - m_cursor) >= num_bytes;
+    }
+
+    // Slow path of EnsureSpaceFor(). Grows the buffer geometrically until it
+    // can fit the given number of additional bytes. Allocation failures assert
+    // rather than throw.
+    void GrowToFit(size_t num_bytes) noexcept;
+
+    // Creates both mappings of a dual-mapped buffer.
+    void MapDual(size_t capacity);
+
+    // Maps both views of a dual-mapped buffer's backing file.
+    void MapDualViews(size_t capacity);
+
+    // Records an emitted instruction into the emission statistics, if any.
+    void RecordInstruction([[maybe_unused]] uint32_t encoding, [[maybe_unused]] size_t length) noexcept {
+#ifdef BISCUIT_EMISSION_STATS
+        if (m_stats != nullptr) [[unlikely]] {
+            RecordInstructionSlow(encoding, length);
+        }
+#endif
+    }
+
+#ifdef BISCUIT_EMISSION_STATS
+    void RecordInstructionSlow(uint32_t encoding, size_t length) noexcept;
+#endif
+
     uint8_t* m_buffer = nullptr;
     uint8_t* m_cursor = nullptr;
     size_t m_capacity = 0;
+    ptrdiff_t m_base = 0;
     bool m_is_managed = false;
+    bool m_is_growable = false;
+    bool m_is_view = false;
+
+    // Executable view of the buffer's memory and the file backing
+    // both views. Only used by dual-mapped buffers.
+    uint8_t* m_exec_buffer = nullptr;
+    int m_memfd = -1;
+    CodeBufferMapping m_mapping = CodeBufferMapping::Single;
+    CodeBufferPages m_pages = CodeBufferPages::Default;
+    bool m_huge_pages = false;
+
+#ifdef BISCUIT_EMISSION_STATS
+    EmissionStats* m_stats = nullptr;
+#endif
 };
 
+/**
+ * A block of space reserved within a code buffer.
+ *
+ * Created through CodeBuffer::Reserve(). Emitting through a reservation
+ * is a plain store and pointer increment, which makes it suitable for
+ * stamping out long straight-line sequences of pre-encoded instructions.
+ */
+class CodeReservation {
+public:
+    CodeReservation(const CodeReservation&) = delete;
+    CodeReservation& operator=(const CodeReservation&) = delete;
+    CodeReservation(CodeReservation&&) = delete;
+    CodeReservation& operator=(CodeReservation&&) = delete;
+
+    ~CodeReservation() noexcept {
+        Commit();
+    }
+
+    /**
+     * Emits a given value into the reserved space.
+     *
+     * @param value The value to emit into the reserved space.
+     * @tparam T    A trivially-copyable type.
+     */
+    template <typename T>
+    void Emit(T value) noexcept {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "It's undefined behavior to memcpy a non-trivially-copyable type.");
+        BISCUIT_ASSERT(static_cast<size_t>(m_end - m_cursor) >= sizeof(T));
+
+        std::memcpy(m_cursor, &value, sizeof(T));
+        m_cursor += sizeof(T);
+    }
+
+    /// Emits a 16-bit value into the reserved space.
+    void Emit16(uint32_t value) noexcept {
+        Emit(static_cast<uint16_t>(value));
+        m_buffer.RecordInstruction(value, 2);
+    }
+
+    /// Emits a 32-bit value into the reserved space.
+    void Emit32(uint32_t value) noexcept {
+        Emit(value);
+        m_buffer.RecordInstruction(value, 4);
+    }
+
+    /**
+     * Copies a block of bytes into the reserved space.
+     *
+     * @param data A pointer to the bytes to copy.
+     * @param size The number of bytes to copy.
+     */
+    void EmitBytes(const void* data, size_t size) noexcept {
+        BISCUIT_ASSERT(static_cast<size_t>(m_end - m_cursor) >= size);
+
+        std::memcpy(m_cursor, data, size);
+        m_cursor += size;
+    }
+
+    /// Retrieves the offset within the code buffer that will be emitted to next.
+    [[nodiscard]] ptrdiff_t GetCursorOffset() const noexcept {
+        return m_buffer.m_base + (m_cursor - m_buffer.m_buffer);
+    }
+
+    /// Returns the number of reserved bytes that haven't been emitted to yet.
+    [[nodiscard]] size_t GetRemainingBytes() const noexcept {
+        return static_cast<size_t>(m_end - m_cursor);
+    }
+
+    /**
+     * Moves the code buffer's cursor past everything emitted so far.
+     *
+     * @note Emitting may continue afterwards. Committing again will
+     *       then only move the cursor past the newly emitted data.
+     */
+    void Commit() noexcept {
+        BISCUIT_ASSERT(m_buffer.m_cursor <= m_cursor);
+        m_buffer.m_cursor = m_cursor;
+    }
+
+private:
+    friend class CodeBuffer;
+
+    CodeReservation(CodeBuffer& buffer, size_t num_bytes) noexcept
+        : m_buffer{buffer}, m_cursor{buffer.m_cursor}, m_end{buffer.m_cursor + num_bytes} {}
+
+    CodeBuffer& m_buffer;
+    uint8_t* m_cursor;
+    uint8_t* m_end;
+};
+
+inline CodeReservation CodeBuffer::Reserve(size_t num_bytes) noexcept {
+    EnsureSpaceFor(num_bytes);
+    return CodeReservation{*this, num_bytes};
+}
+
 } // namespace biscuit
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+
+#include <biscuit/code_buffer.hpp>
+
+namespace biscuit {
+
+/**
+ * A large contiguous region of memory that code buffers can be sub-allocated from.
+ *
+ * Rather than each function getting its own allocation, a code cache reserves
+ * one region up front and hands out aligned slices of it as (unmanaged) code buffers.
+ * Slices can be freed for reuse, and live slices can be compacted to combat fragmentation.
+ *
+ * Since the region is never larger than 2GiB, any two slices are always within
+ * range of each other for AUIPC-based sequences (e.g. AUIPC+JALR calls).
+ *
+ * @par
+ * An example of allocating a slice:
+ *
+ * @code{.cpp}
+ * CodeCache cache;
+ *
+ * auto buffer = cache.Allocate(256);
+ * Assembler as{buffer->GetOffsetPointer(0), buffer->GetCapacity()};
+ * // Emit code...
+ *
+ * cache.Free(*buffer);
+ * @endcode
+ */
+class CodeCache {
+public:
+    // Default capacity of 64MB.
+    static constexpr size_t default_capacity = 64 * 1024 * 1024;
+
+    // Largest capacity that keeps every slice within AUIPC range of every other slice.
+    // AUIPC pairs reach slightly less than 2GiB forward, and staying a multiple of the
+    // huge page size keeps rounding up to huge pages from going past it.
+    static constexpr size_t max_capacity = (size_t{1} << 31) - CodeBuffer::huge_page_size;
+
+    // Default alignment for slices, which is enough for RISC-V fetch blocks on most cores.
+    static constexpr size_t default_alignment = 16;
+
+    /**
+     * Invoked for every slice moved during compaction.
+     *
+     * The first argument is the old location of the slice, the second is the
+     * new location of it, and the final argument is the size of the slice.
+     */
+    using RelocationCallback = std::function<void(uint8_t*, uint8_t*, size_t)>;
+
+    /**
+     * Constructor
+     *
+     * @param capacity The size of the region to reserve in bytes.
+     * @param pages    The pages to back the region with. With huge pages, the
+     *                 capacity is rounded up to a multiple of the huge page size.
+     *
+     * @pre capacity must not be larger than max_capacity.
+     */
+    explicit CodeCache(size_t capacity = default_capacity,
+                       CodeBufferPages pages = CodeBufferPages::Default);
+
+    // Copying a code cache makes no sense, since the slices handed out reference it.
+    CodeCache(const CodeCache&) = delete;
+    CodeCache& operator=(const CodeCache&) = delete;
+
+    // Moving is fine, since the underlying memory itself doesn't move.
+    CodeCache(CodeCache&& other) noexcept;
+    CodeCache& operator=(CodeCache&& other) noexcept;
+
+    /// Destructor. Releases the entire region, including any slices still in use.
+    ~CodeCache() noexcept;
+
+    /**
+     * Allocates a slice of the cache.
+     *
+     * @param size      The size of the slice in bytes.
+     * @param alignment The alignment of the slice. Must be a power of two.
+     *
+     * @returns A code buffer over the slice, or an empty optional if the
+     *          cache doesn't have a large enough free range.
+     */
+    [[nodiscard]] std::optional<CodeBuffer> Allocate(size_t size, size_t alignment = default_alignment);
+
+    /**
+     * Frees a slice, making its memory available for future allocations.
+     *
+     * @param ptr A pointer to the beginning of the slice.
+     *
+     * @pre ptr must point to the beginning of a slice allocated from this cache.
+     */
+    void Free(const uint8_t* ptr);
+
+    /**
+     * Frees a slice, making its memory available for future allocations.
+     *
+     * @param buffer A code buffer previously returned from Allocate().
+     */
+    void Free(const CodeBuffer& buffer);
+
+    /**
+     * Moves all live slices towards the beginning of the cache, merging
+     * all free space into a single range at the end of it.
+     *
+     * @param relocate Invoked for every slice that was moved.
+     *
+     * @note Code buffers handed out for moved slices no longer point at valid slices,
+     *       so they should be recreated by the relocation callback's user.
+     *       Code within a moved slice that refers to itself PC-relatively stays
+     *       valid, while references into or out of the slice need to be adjusted.
+     */
+    void Compact(const RelocationCallback& relocate);
+
+    /// Whether or not the given pointer points within the cache's region.
+    [[nodiscard]] bool Contains(const uint8_t* ptr) const noexcept {
+        return ptr >= m_region && ptr < m_region + m_capacity;
+    }
+
+    /// Returns a pointer to the beginning of the cache's region.
+    [[nodiscard]] uint8_t* GetRegionPointer() noexcept { return m_region; }
+
+    /// Returns a pointer to the beginning of the cache's region.
+    [[nodiscard]] const uint8_t* GetRegionPointer() const noexcept { return m_region; }
+
+    /// Returns the total capacity of the cache in bytes.
+    [[nodiscard]] size_t GetCapacity() const noexcept { return m_capacity; }
+
+    /// Returns the number of bytes currently allocated to slices.
+    [[nodiscard]] size_t GetUsedBytes() const noexcept { return m_used_bytes; }
+
+    /// Returns the size of the largest slice that can currently be allocated with minimal alignment.
+    [[nodiscard]] size_t GetLargestFreeRange() const noexcept;
+
+    /// Returns the number of slices currently allocated.
+    [[nodiscard]] size_t GetAllocationCount() const noexcept { return m_allocations.size(); }
+
+    /**
+     * Sets the entire region to be executable.
+     *
+     * @see CodeBuffer::SetExecutable()
+     */
+    void SetExecutable();
+
+    /**
+     * Sets the entire region to be writable.
+     *
+     * @see CodeBuffer::SetWritable()
+     */
+    void SetWritable();
+
+private:
+    struct Allocation {
+        size_t size;
+        size_t alignment;
+    };
+
+    // Aligns an offset into the region such that the resulting address is aligned.
+    [[nodiscard]] size_t AlignOffset(size_t offset, size_t alignment) const noexcept;
+
+    // Removes a range from the free list, splitting the free range containing it.
+    void ClaimRange(size_t offset, size_t size);
+
+    // Returns a range to the free list, merging it with any adjacent free ranges.
+    void ReleaseRange(size_t offset, size_t size);
+
+    uint8_t* m_region = nullptr;
+    size_t m_capacity = 0;
+    size_t m_used_bytes = 0;
+
+    // Both map region offsets to their respective ranges.
+    std::map<size_t, Allocation> m_allocations;
+    std::map<size_t, size_t> m_free_ranges;
+};
+
+} // namespace biscuit
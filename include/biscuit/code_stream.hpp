@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <span>
+
+#include <biscuit/assembler.hpp>
+
+namespace biscuit {
+
+/**
+ * Streams the code emitted by an assembler out to a sink as it's finalized.
+ *
+ * Each Flush() hands the code that's become final since the last one (see
+ * Assembler::GetFinalizedOffset()) to the sink, then releases it from the
+ * assembler's code buffer (see CodeBuffer::ReleaseBefore()). The buffer only
+ * ever has to hold the code trailing the earliest pending fixup, so arbitrarily
+ * large images can be generated with bounded memory, e.g. by ahead-of-time
+ * compilers writing straight to a file or pipe.
+ *
+ * Offsets keep counting from the start of the stream, so labels, relocations and
+ * branches back into code that has already been streamed out work as usual.
+ *
+ * @par
+ * An example of writing out an image one function at a time:
+ *
+ * @code{.cpp}
+ * Assembler as{64 * 1024};
+ * as.GetCodeBuffer().SetGrowable(true);
+ * CodeStream stream{as, file};
+ *
+ * for (const auto& function : functions) {
+ *     EmitFunction(as, function);
+ *     if (!stream.Flush()) {
+ *         // Handle the write error...
+ *     }
+ * }
+ * @endcode
+ *
+ * @note The code buffer should be growable, since the amount of code held back by
+ *       a pending fixup (e.g. a forward branch to a label bound much later) can't be
+ *       known up front. Memory use is then bounded by the longest such stretch.
+ *
+ * @note Streamed code is never executed from the buffer, so addresses taken from it
+ *       (e.g. by absolute data references) refer to memory that's reused once it's
+ *       released. Record relocations to place such references in the final image.
+ */
+class CodeStream {
+public:
+    /**
+     * Receives the next chunk of finalized code.
+     *
+     * @param code The bytes to write, which directly follow those of the previous chunk.
+     *
+     * @returns Whether or not the chunk was written out successfully.
+     */
+    using Sink = std::function<bool(std::span<const uint8_t> code)>;
+
+    /**
+     * Constructor
+     *
+     * @param as   The assembler to stream code out of. Code already emitted
+     *             and still held by its code buffer is streamed out as well.
+     * @param sink The sink to hand finalized code to.
+     */
+    explicit CodeStream(Assembler& as, Sink sink);
+
+    /**
+     * Constructor
+     *
+     * @param as   The assembler to stream code out of. Code already emitted
+     *             and still held by its code buffer is streamed out as well.
+     * @param file The file to write finalized code to. Descriptors of files or
+     *             pipes can be wrapped with fdopen().
+     *
+     * @note The file isn't flushed or closed by the stream.
+     */
+    explicit CodeStream(Assembler& as, std::FILE* file);
+
+    // The assembler's code is streamed from where the stream left off.
+    CodeStream(const CodeStream&) = delete;
+    CodeStream& operator=(const CodeStream&) = delete;
+    CodeStream(CodeStream&&) = delete;
+    CodeStream& operator=(CodeStream&&) = delete;
+
+    /**
+     * Writes all code finalized since the last flush to the sink,
+     * and releases it from the assembler's code buffer.
+     *
+     * @returns False if the sink failed to write the code out. Nothing is
+     *          released in that case, so flushing may be retried later.
+     *
+     * @note Everything is written out once all labels are bound and nothing is
+     *       pending anymore, so the literal pool and cold section (if any) should
+     *       be flushed before the last call.
+     */
+    [[nodiscard]] bool Flush();
+
+    /// Gets the offset up to which code has been written to the sink.
+    [[nodiscard]] ptrdiff_t GetFlushedOffset() const noexcept {
+        return m_flushed;
+    }
+
+    /// Gets the number of bytes emitted that have yet to be written to the sink.
+    [[nodiscard]] size_t GetPendingSize() const noexcept {
+        return static_cast<size_t>(m_as.GetCodeBuffer().GetCursorOffset() - m_flushed);
+    }
+
+private:
+    Assembler& m_as;
+    Sink m_sink;
+    ptrdiff_t m_flushed = 0;
+};
+
+} // namespace biscuit
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <biscuit/assembler.hpp>
+#include <biscuit/extensions.hpp>
 #include <biscuit/registers.hpp>
 #include <cstddef>
 #include <cstdint>
@@ -57,6 +58,18 @@ enum class RISCVExtension : uint64_t {
     V = COMPAT_HWCAP_ISA_V
 };
 
+/**
+ * How the CPU handles misaligned scalar memory accesses,
+ * as reported by the kernel.
+ */
+enum class MisalignedAccess : uint32_t {
+    Unknown,     //< Performance of misaligned accesses is unknown.
+    Emulated,    //< Misaligned accesses trap and are emulated by software (i.e. very slow).
+    Slow,        //< Misaligned accesses are supported in hardware, but slower than aligned ones.
+    Fast,        //< Misaligned accesses are as fast or faster than splitting them up.
+    Unsupported, //< Misaligned accesses are not supported at all.
+};
+
 template <CSR csr>
 struct CSRReader : public biscuit::Assembler {
     // Buffer capacity exactly for 2 instructions.
@@ -82,11 +95,42 @@ struct CSRReader : public biscuit::Assembler {
     }
 };
 
+/**
+ * Everything CPUInfo detects about the host CPU.
+ */
+struct CPUSnapshot {
+    /// Detected ISA extensions.
+    ExtensionSet extensions;
+
+    /// How misaligned scalar memory accesses are handled.
+    MisalignedAccess misaligned_access = MisalignedAccess::Unknown;
+
+    /// Value of the mvendorid CSR, or 0 if unknown.
+    uint64_t vendor_id = 0;
+
+    /// Value of the marchid CSR, or 0 if unknown.
+    uint64_t arch_id = 0;
+
+    /// Value of the mimpid CSR, or 0 if unknown.
+    uint64_t impl_id = 0;
+
+    /// Vector register length in bytes, or 0 if V isn't available.
+    uint32_t vlenb = 0;
+};
+
 /**
  * Class that detects information about a RISC-V CPU.
+ *
+ * All detection happens once, the first time any information is requested,
+ * and is thread-safe. Every query after that is a plain read of the cached
+ * results. Calling GetSnapshot() at startup ensures no detection work
+ * happens on any hot path later on.
  */
 class CPUInfo {
 public:
+    /// Retrieves all detected information about the host CPU.
+    const CPUSnapshot& GetSnapshot() const;
+
     /**
      * Checks if a particular RISC-V extension is available.
      *
@@ -94,6 +138,30 @@ public:
      */
     bool Has(RISCVExtension extension) const;
 
+    /**
+     * Retrieves the set of detected extensions, suitable for
+     * handing to Assembler::SetExtensions().
+     *
+     * @note On Linux, the extensions reported by the riscv_hwprobe syscall
+     *       are combined with the single-letter ones from the auxiliary vector.
+     *       On other platforms, the set is empty.
+     *
+     * @note Detection only happens once. The result is cached afterwards.
+     */
+    ExtensionSet GetExtensions() const;
+
+    /// Retrieves how the CPU handles misaligned scalar memory accesses.
+    MisalignedAccess GetMisalignedAccess() const;
+
+    /// Retrieves the value of the mvendorid CSR, or 0 if unknown.
+    uint64_t GetVendorID() const;
+
+    /// Retrieves the value of the marchid CSR, or 0 if unknown.
+    uint64_t GetArchID() const;
+
+    /// Retrieves the value of the mimpid CSR, or 0 if unknown.
+    uint64_t GetImplID() const;
+
     /// Returns the vector register length in bytes.
     uint32_t GetVlenb() const;
 };
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/kernels.hpp>
+
+namespace biscuit {
+
+/**
+ * AES key sizes supported by the AES kernels.
+ */
+enum class AESKeySize : uint32_t {
+    AES128, //< 128-bit keys (10 rounds)
+    AES256, //< 256-bit keys (14 rounds)
+};
+
+/**
+ * Whether an AES-GCM kernel encrypts or decrypts.
+ *
+ * Both directions hash the ciphertext, so they only differ in
+ * whether it's hashed after or before the keystream is applied.
+ */
+enum class GCMDirection : uint32_t {
+    Encrypt,
+    Decrypt,
+};
+
+/**
+ * Signature of the AES key expansion kernel.
+ *
+ * Expands `key` into the full key schedule, with round keys laid out one after
+ * another in the same byte order as FIPS-197 (i.e. 176 bytes for AES-128,
+ * and 240 bytes for AES-256).
+ */
+using AESKeyExpansionKernel = void (*)(const uint8_t* key, uint8_t* round_keys);
+
+/**
+ * Signature of the AES-CTR kernel.
+ *
+ * Encrypts (or equivalently, decrypts) `blocks` 16-byte blocks from `in` into `out`.
+ * `counter` is the initial counter block, with its last 4 bytes being a big-endian
+ * block counter as used by GCM. It's advanced past the blocks processed on return,
+ * so consecutive calls continue the same keystream.
+ */
+using AESCTRKernel = void (*)(const uint8_t* round_keys, const uint8_t* in, uint8_t* out,
+                              size_t blocks, uint8_t* counter);
+
+/**
+ * Signature of the AES-GCM kernel.
+ *
+ * Behaves like the AES-CTR kernel, while also folding the ciphertext into the GHASH
+ * state pointed to by `ghash`. The state is 32 bytes, consisting of the current hash
+ * followed by the hash subkey H. Lengths and the final tag are left to the caller,
+ * as they only affect a single block.
+ */
+using AESGCMKernel = void (*)(const uint8_t* round_keys, const uint8_t* in, uint8_t* out,
+                              size_t blocks, uint8_t* counter, uint8_t* ghash);
+
+/**
+ * Signature of the GHASH kernel.
+ *
+ * Folds `blocks` 16-byte blocks of `data` into `hash`, using the hash subkey `subkey`.
+ */
+using GHASHKernel = void (*)(uint8_t* hash, const uint8_t* subkey, const uint8_t* data, size_t blocks);
+
+/**
+ * Signature of the SHA-256 compression kernel.
+ *
+ * Compresses `blocks` 64-byte message blocks into the eight state words in `state` (a-h).
+ */
+using SHA256Kernel = void (*)(uint32_t* state, const uint8_t* data, size_t blocks);
+
+/**
+ * Signature of the SM4 key expansion kernel.
+ *
+ * Expands the 16-byte `key` into the 32 encryption round keys.
+ */
+using SM4KeyExpansionKernel = void (*)(const uint8_t* key, uint32_t* round_keys);
+
+/**
+ * Signature of the SM4 kernel.
+ *
+ * Encrypts `blocks` 16-byte blocks from `in` into `out` (i.e. ECB).
+ */
+using SM4Kernel = void (*)(const uint32_t* round_keys, const uint8_t* in, uint8_t* out, size_t blocks);
+
+//
+// All crypto kernels require every pointer they're given to be 4-byte aligned, as
+// they access memory with 32-bit element loads and stores. Kernels that need vector
+// extensions the assembler's extension set doesn't contain aren't emitted, and an
+// empty optional is returned instead, so that callers can fall back to other code.
+// Offsets returned by the emitters can be turned into callable pointers with GetKernel().
+//
+// Multi-block kernels process as many blocks at once as the vector registers
+// hold, so they scale with the VLEN of the executing hardware. KernelOptions only
+// narrows the register groups used when the typical size is known to be small.
+//
+
+/**
+ * Emits an AES key expansion kernel at the cursor.
+ *
+ * Requires Zvkned.
+ */
+std::optional<ptrdiff_t> EmitAESKeyExpansionKernel(Assembler& as, AESKeySize key_size);
+
+/**
+ * Emits an AES-CTR kernel at the cursor.
+ *
+ * Requires Zvkned, and Zvkb (or Zvbb) for byte-swapping block counters.
+ */
+std::optional<ptrdiff_t> EmitAESCTRKernel(Assembler& as, AESKeySize key_size,
+                                          const KernelOptions& options);
+
+/**
+ * Emits an AES-GCM kernel at the cursor.
+ *
+ * Each group of blocks is encrypted in parallel, and the serial GHASH chain over
+ * the group sits between its AES rounds and those of the next group, so that
+ * out-of-order cores can overlap the two.
+ *
+ * Requires the same extensions as the AES-CTR kernel, along with Zvkg.
+ */
+std::optional<ptrdiff_t> EmitAESGCMKernel(Assembler& as, AESKeySize key_size, GCMDirection direction,
+                                          const KernelOptions& options);
+
+/**
+ * Emits a GHASH kernel at the cursor.
+ *
+ * Requires Zvkg.
+ */
+std::optional<ptrdiff_t> EmitGHASHKernel(Assembler& as);
+
+/**
+ * Emits a SHA-256 compression kernel at the cursor.
+ *
+ * The round constants are placed right after the kernel's code.
+ *
+ * Requires Zvknha (or Zvknhb), and Zvkb (or Zvbb) for byte-swapping message words.
+ */
+std::optional<ptrdiff_t> EmitSHA256Kernel(Assembler& as);
+
+/**
+ * Emits an SM4 key expansion kernel at the cursor.
+ *
+ * The system parameter FK is placed right after the kernel's code.
+ *
+ * Requires Zvksed, and Zvkb (or Zvbb) for byte-swapping key words.
+ */
+std::optional<ptrdiff_t> EmitSM4KeyExpansionKernel(Assembler& as);
+
+/**
+ * Emits an SM4 encryption kernel at the cursor.
+ *
+ * Requires Zvksed, and Zvkb (or Zvbb) for byte-swapping data words.
+ */
+std::optional<ptrdiff_t> EmitSM4Kernel(Assembler& as, const KernelOptions& options);
+
+} // namespace biscuit
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/extensions.hpp>
+
+namespace biscuit {
+
+/**
+ * The encoding format of an instruction, which determines
+ * where each of its operands are located.
+ */
+enum class InstructionFormat : uint32_t {
+    Unknown, //< Not a recognized encoding.
+
+    // 32-bit formats
+    R,       //< Register-register operations.
+    R4,      //< Fused multiply-add operations with three source registers.
+    I,       //< Register-immediate operations, loads, JALR and system instructions.
+    S,       //< Stores.
+    B,       //< Conditional branches.
+    U,       //< LUI and AUIPC.
+    J,       //< JAL.
+    VArith,  //< Vector arithmetic, including vector cryptography.
+    VLoad,   //< Vector loads.
+    VStore,  //< Vector stores.
+    VConfig, //< VSETVLI, VSETIVLI and VSETVL.
+
+    // 16-bit formats
+    CR,   //< Compressed register operations.
+    CI,   //< Compressed immediate operations and stack-pointer-relative loads.
+    CSS,  //< Compressed stack-pointer-relative stores.
+    CIW,  //< C.ADDI4SPN.
+    CL,   //< Compressed loads.
+    CS,   //< Compressed stores.
+    CA,   //< Compressed arithmetic.
+    CB,   //< Compressed branches and immediate arithmetic.
+    CJ,   //< Compressed jumps.
+    CLB,  //< Zcb byte loads.
+    CLH,  //< Zcb halfword loads.
+    CSB,  //< Zcb byte stores.
+    CSH,  //< Zcb halfword stores.
+    CU,   //< Zcb unary operations.
+    CMPP, //< Zcmp push and pop.
+    CMMV, //< Zcmp register moves.
+    CMJT, //< Zcmt table jumps.
+};
+
+/**
+ * Determines the length of an instruction in bytes from its first 16-bit parcel.
+ *
+ * @returns 2 for compressed instructions, 4 for regular instructions, 6 and 8 for
+ *          the longer encodings, or 0 for encodings longer than 64 bits.
+ */
+[[nodiscard]] constexpr size_t GetInstructionLength(uint16_t parcel) noexcept {
+    if ((parcel & 0b11) != 0b11) {
+        return 2;
+    }
+    if ((parcel & 0b11100) != 0b11100) {
+        return 4;
+    }
+    if ((parcel & 0b111111) == 0b011111) {
+        return 6;
+    }
+    if ((parcel & 0b1111111) == 0b0111111) {
+        return 8;
+    }
+    return 0;
+}
+
+/**
+ * A decoded instruction.
+ *
+ * Register operands are given as indices into the register file the
+ * instruction operates on (e.g. vector registers for vector instructions).
+ * 3-bit compressed register fields are expanded into full indices.
+ * Implicit operands (like sp for stack-pointer-relative loads, or ra
+ * for C.JAL) aren't filled in.
+ *
+ * Fields different instructions place in the same location are named after
+ * the location. For example, vector loads and stores keep their number of fields
+ * (nf) in `imm`, and VSETIVLI keeps its immediate AVL in `rs1`. Instruction bits
+ * that aren't operands (e.g. rounding modes, vector masking, memory ordering)
+ * can be read straight from the encoding.
+ */
+struct DecodedInstruction {
+    /// The instruction's mnemonic, as written in assembly (e.g. "addi" or "vadd.vv").
+    std::string_view mnemonic;
+
+    /// The encoding format of the instruction.
+    InstructionFormat format = InstructionFormat::Unknown;
+
+    /// The raw encoding of the instruction.
+    uint32_t encoding = 0;
+
+    /// The length of the instruction in bytes.
+    uint32_t length = 0;
+
+    /// The destination register, or the register stored by vector stores.
+    uint32_t rd = 0;
+
+    /// The first source register.
+    uint32_t rs1 = 0;
+
+    /// The second source register.
+    uint32_t rs2 = 0;
+
+    /// The third source register of R4-type instructions.
+    uint32_t rs3 = 0;
+
+    /**
+     * The decoded immediate.
+     *
+     * For branches and jumps, this is the offset from the instruction to its target.
+     * Immediates of instructions that encode additional fields within the immediate's
+     * range (e.g. shifts and AMOs) only contain the bits not used by those fields.
+     */
+    int64_t imm = 0;
+};
+
+/**
+ * A table-driven instruction decoder covering the same ISA as the assembler.
+ *
+ * Decoding allows emitted code to be inspected and patched directly,
+ * without keeping separate metadata about what's been emitted where.
+ */
+class Decoder {
+public:
+    /**
+     * Constructor
+     *
+     * @param features   The base ISA to decode for. This determines how the encodings
+     *                   that differ between RV32 and RV64 are interpreted.
+     * @param extensions Extensions that change how otherwise ambiguous encodings
+     *                   are interpreted. Currently, Zcmp and Zcmt take over the
+     *                   encodings of C.FSDSP when present.
+     */
+    explicit Decoder(ArchFeature features = ArchFeature::RV64, ExtensionSet extensions = {}) noexcept
+        : m_features{features}, m_extensions{extensions} {}
+
+    /**
+     * Decodes a single instruction.
+     *
+     * @param encoding The instruction's encoding. For compressed instructions,
+     *                 only the lower 16 bits are used.
+     *
+     * @returns The decoded instruction, or an empty optional if the encoding
+     *          isn't recognized.
+     */
+    [[nodiscard]] std::optional<DecodedInstruction> Decode(uint32_t encoding) const noexcept;
+
+    /**
+     * Decodes the instruction at the start of a block of code.
+     *
+     * @returns The decoded instruction, or an empty optional if the encoding isn't
+     *          recognized or the block of code is too short to contain it.
+     */
+    [[nodiscard]] std::optional<DecodedInstruction> Decode(std::span<const uint8_t> code) const noexcept;
+
+    /**
+     * Determines the format of an instruction without fully decoding it.
+     *
+     * This only looks at the major opcode (and some function bits for compressed
+     * instructions), so it's considerably cheaper than Decode(). It doesn't verify
+     * that the encoding is an actual instruction.
+     *
+     * @param encoding The instruction's encoding. For compressed instructions,
+     *                 only the lower 16 bits are used.
+     */
+    [[nodiscard]] InstructionFormat GetFormat(uint32_t encoding) const noexcept;
+
+private:
+    ArchFeature m_features;
+    ExtensionSet m_extensions;
+};
+
+} // namespace biscuit
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_buffer.hpp>
+#include <biscuit/decoder.hpp>
+
+namespace biscuit {
+
+/**
+ * Broad classes of instructions, roughly corresponding to the extensions
+ * that introduce them.
+ *
+ * Instructions are classified by their major opcode (along with a few function
+ * fields), so extensions that share encoding space are grouped together.
+ */
+enum class InstructionClass : uint32_t {
+    Base,          //< Base integer instructions, including fences, cache-block operations and ECALL.
+    Compressed,    //< C and the Zc* extensions.
+    Multiply,      //< M
+    Atomic,        //< A, Zacas and Zabha.
+    FloatingPoint, //< F, D, Q, Zfh and Zfa, including floating-point loads and stores.
+    BitManip,      //< Zb*, Zbk*, Zk* and Zicond.
+    CSR,           //< Zicsr
+    Vector,        //< V, Zvbb and Zvbc, including vector loads and stores.
+    VectorCrypto,  //< Zvkg, Zvkned, Zvknh[ab], Zvksed and Zvksh.
+    Unknown,       //< Anything else, such as custom opcodes or data.
+};
+
+/// The number of instruction formats counted by emission statistics.
+constexpr size_t instruction_format_count = static_cast<size_t>(InstructionFormat::CMJT) + 1;
+
+/// The number of instruction classes counted by emission statistics.
+constexpr size_t instruction_class_count = static_cast<size_t>(InstructionClass::Unknown) + 1;
+
+/**
+ * Classifies an instruction.
+ *
+ * @param encoding The instruction's encoding. For compressed instructions,
+ *                 only the lower 16 bits are considered.
+ */
+[[nodiscard]] InstructionClass ClassifyInstruction(uint32_t encoding) noexcept;
+
+/**
+ * Totals recorded by emission statistics.
+ */
+struct EmissionTotals {
+    /// Instructions emitted, indexed by InstructionFormat.
+    std::array<uint64_t, instruction_format_count> formats{};
+
+    /// Instructions emitted, indexed by InstructionClass.
+    std::array<uint64_t, instruction_class_count> classes{};
+
+    /// The number of 16-bit instructions emitted.
+    uint64_t compressed = 0;
+
+    /// The number of 32-bit instructions emitted.
+    uint64_t uncompressed = 0;
+
+    /// The number of bytes of instructions emitted.
+    uint64_t bytes = 0;
+
+    /// The number of times the code buffer grew.
+    uint64_t grow_events = 0;
+
+    /// The number of labels bound.
+    uint64_t labels_bound = 0;
+
+    /// The number of references to labels that were patched once their label was bound.
+    uint64_t label_fixups = 0;
+
+    /// Gets the number of instructions emitted with the given format.
+    [[nodiscard]] uint64_t GetCount(InstructionFormat format) const noexcept {
+        return formats[static_cast<size_t>(format)];
+    }
+
+    /// Gets the number of instructions emitted of the given class.
+    [[nodiscard]] uint64_t GetCount(InstructionClass instruction_class) const noexcept {
+        return classes[static_cast<size_t>(instruction_class)];
+    }
+};
+
+/**
+ * Statistics about the code emitted into a code buffer.
+ *
+ * Attach them with CodeBuffer::SetEmissionStats() (or Assembler::GetCodeBuffer())
+ * in builds with BISCUIT_EMISSION_STATS enabled. The assembler then additionally
+ * records labels as they're bound, which splits emitted code into regions
+ * that can be inspected with GetLabelRegions().
+ *
+ * @par
+ * An example of finding the largest region of emitted code:
+ *
+ * @code{.cpp}
+ * EmissionStats stats;
+ * as.GetCodeBuffer().SetEmissionStats(&stats);
+ * ...
+ * const auto regions = stats.GetLabelRegions(as.GetCodeBuffer().GetCursorOffset());
+ * const auto largest = std::max_element(regions.begin(), regions.end(),
+ *                                       [](const auto& a, const auto& b) { return a.size < b.size; });
+ * @endcode
+ *
+ * @note 16-bit and 32-bit data emitted through Emit16() and Emit32() can't be told
+ *       apart from instructions, and is counted as such.
+ */
+class EmissionStats {
+public:
+    /**
+     * Constructor
+     *
+     * @param features The architecture emitted code is for, which determines
+     *                 how compressed instructions are decoded.
+     */
+    explicit EmissionStats(ArchFeature features = ArchFeature::RV64) noexcept
+        : m_decoder{features} {}
+
+    /// Records an emitted instruction.
+    void RecordInstruction(uint32_t encoding, size_t length) noexcept;
+
+    /// Records the code buffer growing.
+    void RecordGrow() noexcept {
+        m_totals.grow_events++;
+    }
+
+    /**
+     * Records a label being bound.
+     *
+     * @param offset The offset the label was bound to.
+     * @param fixups The number of references to the label that had to be patched.
+     */
+    void RecordLabel(ptrdiff_t offset, size_t fixups);
+
+    /// Gets the totals recorded so far.
+    [[nodiscard]] const EmissionTotals& GetTotals() const noexcept {
+        return m_totals;
+    }
+
+    /**
+     * Gets the number of bytes emitted between consecutive labels.
+     *
+     * Each region starts at a bound label (or the start of the buffer) and extends
+     * up to the next one, with the last one extending up to `end`. Empty regions
+     * (e.g. from several labels bound to the same location) are left out.
+     *
+     * @param end The end of the emitted code, usually the buffer's cursor offset.
+     *
+     * @note With branch relaxation enabled, code after a label may be moved when
+     *       a branch is widened. Regions reflect the offsets labels were bound at.
+     */
+    [[nodiscard]] std::vector<CodeRange> GetLabelRegions(ptrdiff_t end) const;
+
+    /// Clears all recorded statistics.
+    void Reset() noexcept {
+        m_totals = {};
+        m_label_offsets.clear();
+    }
+
+private:
+    Decoder m_decoder;
+    EmissionTotals m_totals;
+    std::vector<ptrdiff_t> m_label_offsets;
+};
+
+} // namespace biscuit
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <biscuit/assert.hpp>
+#include <biscuit/registers.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Encoders for the base 32-bit RISC-V instruction formats, along with
+// encoders for individual instructions built on top of them.
+//
+// These only compute instruction words and never touch a code buffer,
+// which allows them to be used within constant expressions and to be
+// inlined into the hottest instruction emitters.
+
+namespace biscuit {
+
+// S-type and I-type immediates are 12 bits in size
+[[nodiscard]] constexpr bool IsValidSigned12BitImm(ptrdiff_t value) {
+    return value >= -2048 && value <= 2047;
+}
+
+// B-type immediates only provide -4KiB to +4KiB range branches.
+[[nodiscard]] constexpr bool IsValidBTypeImm(ptrdiff_t value) {
+    return value >= -4096 && value <= 4095;
+}
+
+// J-type immediates only provide -1MiB to +1MiB range branches.
+[[nodiscard]] constexpr bool IsValidJTypeImm(ptrdiff_t value) {
+    return value >= -0x80000 && value <= 0x7FFFF;
+}
+
+// Transforms a regular value into an immediate encoded in a B-type instruction.
+[[nodiscard]] constexpr uint32_t TransformToBTypeImm(uint32_t imm) {
+    // clang-format off
+    return ((imm & 0x07E0) << 20) |
+           ((imm & 0x1000) << 19) |
+           ((imm & 0x001E) << 7) |
+           ((imm & 0x0800) >> 4);
+    // clang-format on
+}
+
+// Transforms a regular value into an immediate encoded in a J-type instruction.
+[[nodiscard]] constexpr uint32_t TransformToJTypeImm(uint32_t imm) {
+    // clang-format off
+    return ((imm & 0x0FF000) >> 0) |
+           ((imm & 0x000800) << 9) |
+           ((imm & 0x0007FE) << 20) |
+           ((imm & 0x100000) << 11);
+    // clang-format on
+}
+
+// Encodes a B type RISC-V instruction. These consist of:
+// imm[12|10:5] | rs2 | rs1 | funct3 | imm[4:1] | imm[11] | opcode
+[[nodiscard]] constexpr uint32_t EncodeBType(uint32_t imm, GPR rs2, GPR rs1,
+                                             uint32_t funct3, uint32_t opcode) {
+    imm &= 0x1FFE;
+
+    return TransformToBTypeImm(imm) | (rs2.Index() << 20) | (rs1.Index() << 15) |
+           ((funct3 & 0b111) << 12) | (opcode & 0x7F);
+}
+
+// Encodes a I type RISC-V instruction. These consist of:
+// imm[11:0] | rs1 | funct3 | rd | opcode
+[[nodiscard]] constexpr uint32_t EncodeIType(uint32_t imm, Register rs1, uint32_t funct3,
+                                             Register rd, uint32_t opcode) {
+    imm &= 0xFFF;
+
+    return (imm << 20) | (rs1.Index() << 15) | ((funct3 & 0b111) << 12) |
+           (rd.Index() << 7) | (opcode & 0x7F);
+}
+
+// Encodes a J type RISC-V instruction. These consist of:
+// imm[20|10:1|11|19:12] | rd | opcode
+[[nodiscard]] constexpr uint32_t EncodeJType(uint32_t imm, GPR rd, uint32_t opcode) {
+    imm &= 0x1FFFFE;
+
+    return TransformToJTypeImm(imm) | rd.Index() << 7 | (opcode & 0x7F);
+}
+
+// Encodes a R type RISC instruction. These consist of:
+// funct7 | rs2 | rs1 | funct3 | rd | opcode
+[[nodiscard]] constexpr uint32_t EncodeRType(uint32_t funct7, Register rs2, Register rs1,
+                                             uint32_t funct3, Register rd, uint32_t opcode) {
+    // clang-format off
+    return ((funct7 & 0xFF) << 25) |
+           (rs2.Index() << 20) |
+           (rs1.Index() << 15) |
+           ((funct3 & 0b111) << 12) |
+           (rd.Index() << 7) |
+           (opcode & 0x7F);
+    // clang-format on
+}
+
+// Encodes a S type RISC-V instruction. These consist of:
+// imm[11:5] | rs2 | rs1 | funct3 | imm[4:0] | opcode
+[[nodiscard]] constexpr uint32_t EncodeSType(uint32_t imm, Register rs2, GPR rs1,
+                                             uint32_t funct3, uint32_t opcode) {
+    imm &= 0xFFF;
+
+    // clang-format off
+    const auto new_imm = ((imm & 0x01F) << 7) |
+                         ((imm & 0xFE0) << 20);
+    // clang-format on
+
+    return new_imm | (rs2.Index() << 20) | (rs1.Index() << 15) |
+           ((funct3 & 0b111) << 12) | (opcode & 0x7F);
+}
+
+// Encodes a U type RISC-V instruction. These consist of:
+// imm[31:12] | rd | opcode
+[[nodiscard]] constexpr uint32_t EncodeUType(uint32_t imm, GPR rd, uint32_t opcode) {
+    return (imm & 0x000FFFFF) << 12 | rd.Index() << 7 | (opcode & 0x7F);
+}
+
+/**
+ * Encoders for individual instructions.
+ *
+ * Each function returns the encoded instruction word, taking its operands
+ * in the same order as the corresponding Assembler member function. Since
+ * they're constexpr, fixed sequences can be built entirely at compile time:
+ *
+ * @code
+ * constexpr std::array thunk{
+ *     enc::LD(t0, 8, a0),
+ *     enc::JR(t0),
+ * };
+ * @endcode
+ *
+ * @note Branch and jump immediates are byte offsets relative to the
+ *       instruction itself. Operand validation is performed the same way
+ *       as the Assembler does it, so an invalid operand within a constant
+ *       expression results in a compilation error.
+ */
+namespace enc {
+
+// RV32I Instructions
+
+[[nodiscard]] constexpr uint32_t ADD(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b000, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t ADDI(GPR rd, GPR rs, int32_t imm) {
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b000, rd, 0b0010011);
+}
+
+[[nodiscard]] constexpr uint32_t AND(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b111, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t ANDI(GPR rd, GPR rs, uint32_t imm) {
+    return EncodeIType(imm, rs, 0b111, rd, 0b0010011);
+}
+
+[[nodiscard]] constexpr uint32_t AUIPC(GPR rd, int32_t imm) {
+    return EncodeUType(static_cast<uint32_t>(imm), rd, 0b0010111);
+}
+
+[[nodiscard]] constexpr uint32_t BEQ(GPR rs1, GPR rs2, int32_t imm) {
+    BISCUIT_ASSERT(IsValidBTypeImm(imm));
+    return EncodeBType(static_cast<uint32_t>(imm), rs2, rs1, 0b000, 0b1100011);
+}
+
+[[nodiscard]] constexpr uint32_t BGE(GPR rs1, GPR rs2, int32_t imm) {
+    BISCUIT_ASSERT(IsValidBTypeImm(imm));
+    return EncodeBType(static_cast<uint32_t>(imm), rs2, rs1, 0b101, 0b1100011);
+}
+
+[[nodiscard]] constexpr uint32_t BGEU(GPR rs1, GPR rs2, int32_t imm) {
+    BISCUIT_ASSERT(IsValidBTypeImm(imm));
+    return EncodeBType(static_cast<uint32_t>(imm), rs2, rs1, 0b111, 0b1100011);
+}
+
+[[nodiscard]] constexpr uint32_t BLT(GPR rs1, GPR rs2, int32_t imm) {
+    BISCUIT_ASSERT(IsValidBTypeImm(imm));
+    return EncodeBType(static_cast<uint32_t>(imm), rs2, rs1, 0b100, 0b1100011);
+}
+
+[[nodiscard]] constexpr uint32_t BLTU(GPR rs1, GPR rs2, int32_t imm) {
+    BISCUIT_ASSERT(IsValidBTypeImm(imm));
+    return EncodeBType(static_cast<uint32_t>(imm), rs2, rs1, 0b110, 0b1100011);
+}
+
+[[nodiscard]] constexpr uint32_t BNE(GPR rs1, GPR rs2, int32_t imm) {
+    BISCUIT_ASSERT(IsValidBTypeImm(imm));
+    return EncodeBType(static_cast<uint32_t>(imm), rs2, rs1, 0b001, 0b1100011);
+}
+
+[[nodiscard]] constexpr uint32_t EBREAK() {
+    return 0x00100073;
+}
+
+[[nodiscard]] constexpr uint32_t ECALL() {
+    return 0x00000073;
+}
+
+[[nodiscard]] constexpr uint32_t JAL(GPR rd, int32_t imm) {
+    BISCUIT_ASSERT(IsValidJTypeImm(imm));
+    return EncodeJType(static_cast<uint32_t>(imm), rd, 0b1101111);
+}
+
+[[nodiscard]] constexpr uint32_t JALR(GPR rd, int32_t imm, GPR rs1) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs1, 0b000, rd, 0b1100111);
+}
+
+[[nodiscard]] constexpr uint32_t LB(GPR rd, int32_t imm, GPR rs) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b000, rd, 0b0000011);
+}
+
+[[nodiscard]] constexpr uint32_t LBU(GPR rd, int32_t imm, GPR rs) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b100, rd, 0b0000011);
+}
+
+[[nodiscard]] constexpr uint32_t LH(GPR rd, int32_t imm, GPR rs) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b001, rd, 0b0000011);
+}
+
+[[nodiscard]] constexpr uint32_t LHU(GPR rd, int32_t imm, GPR rs) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b101, rd, 0b0000011);
+}
+
+[[nodiscard]] constexpr uint32_t LUI(GPR rd, uint32_t imm) {
+    return EncodeUType(imm, rd, 0b0110111);
+}
+
+[[nodiscard]] constexpr uint32_t LW(GPR rd, int32_t imm, GPR rs) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b010, rd, 0b0000011);
+}
+
+[[nodiscard]] constexpr uint32_t OR(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b110, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t ORI(GPR rd, GPR rs, uint32_t imm) {
+    return EncodeIType(imm, rs, 0b110, rd, 0b0010011);
+}
+
+[[nodiscard]] constexpr uint32_t SB(GPR rs2, int32_t imm, GPR rs1) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeSType(static_cast<uint32_t>(imm), rs2, rs1, 0b000, 0b0100011);
+}
+
+[[nodiscard]] constexpr uint32_t SH(GPR rs2, int32_t imm, GPR rs1) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeSType(static_cast<uint32_t>(imm), rs2, rs1, 0b001, 0b0100011);
+}
+
+[[nodiscard]] constexpr uint32_t SW(GPR rs2, int32_t imm, GPR rs1) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeSType(static_cast<uint32_t>(imm), rs2, rs1, 0b010, 0b0100011);
+}
+
+[[nodiscard]] constexpr uint32_t SLL(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b001, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t SLT(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b010, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t SLTI(GPR rd, GPR rs, int32_t imm) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b010, rd, 0b0010011);
+}
+
+[[nodiscard]] constexpr uint32_t SLTIU(GPR rd, GPR rs, int32_t imm) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b011, rd, 0b0010011);
+}
+
+[[nodiscard]] constexpr uint32_t SLTU(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b011, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t SRA(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0100000, rhs, lhs, 0b101, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t SRL(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b101, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t SUB(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0100000, rhs, lhs, 0b000, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t XOR(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b100, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t XORI(GPR rd, GPR rs, uint32_t imm) {
+    return EncodeIType(imm, rs, 0b100, rd, 0b0010011);
+}
+
+// Immediate shifts accept the full 6-bit shift amount used by RV64.
+// When targeting RV32, the shift amount must be less than 32.
+
+[[nodiscard]] constexpr uint32_t SLLI(GPR rd, GPR rs, uint32_t shift) {
+    BISCUIT_ASSERT(shift <= 63);
+    return EncodeIType((shift & 0x3f), rs, 0b001, rd, 0b0010011);
+}
+
+[[nodiscard]] constexpr uint32_t SRAI(GPR rd, GPR rs, uint32_t shift) {
+    BISCUIT_ASSERT(shift <= 63);
+    return EncodeIType((0b0100000 << 5) | (shift & 0x3f), rs, 0b101, rd, 0b0010011);
+}
+
+[[nodiscard]] constexpr uint32_t SRLI(GPR rd, GPR rs, uint32_t shift) {
+    BISCUIT_ASSERT(shift <= 63);
+    return EncodeIType((shift & 0x3f), rs, 0b101, rd, 0b0010011);
+}
+
+// RV32I Pseudo-instructions
+
+[[nodiscard]] constexpr uint32_t J(int32_t imm) {
+    return JAL(x0, imm);
+}
+
+[[nodiscard]] constexpr uint32_t JR(GPR rs) {
+    return JALR(x0, 0, rs);
+}
+
+[[nodiscard]] constexpr uint32_t MV(GPR rd, GPR rs) {
+    return ADDI(rd, rs, 0);
+}
+
+[[nodiscard]] constexpr uint32_t NEG(GPR rd, GPR rs) {
+    return SUB(rd, x0, rs);
+}
+
+[[nodiscard]] constexpr uint32_t NOP() {
+    return ADDI(x0, x0, 0);
+}
+
+[[nodiscard]] constexpr uint32_t NOT(GPR rd, GPR rs) {
+    return XORI(rd, rs, UINT32_MAX);
+}
+
+[[nodiscard]] constexpr uint32_t RET() {
+    return JALR(x0, 0, x1);
+}
+
+// RV64I Instructions
+
+[[nodiscard]] constexpr uint32_t ADDIW(GPR rd, GPR rs, int32_t imm) {
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b000, rd, 0b0011011);
+}
+
+[[nodiscard]] constexpr uint32_t ADDW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b000, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t LD(GPR rd, int32_t imm, GPR rs) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b011, rd, 0b0000011);
+}
+
+[[nodiscard]] constexpr uint32_t LWU(GPR rd, int32_t imm, GPR rs) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeIType(static_cast<uint32_t>(imm), rs, 0b110, rd, 0b0000011);
+}
+
+[[nodiscard]] constexpr uint32_t SD(GPR rs2, int32_t imm, GPR rs1) {
+    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
+    return EncodeSType(static_cast<uint32_t>(imm), rs2, rs1, 0b011, 0b0100011);
+}
+
+[[nodiscard]] constexpr uint32_t SLLIW(GPR rd, GPR rs, uint32_t shift) {
+    BISCUIT_ASSERT(shift <= 31);
+    return EncodeIType((shift & 0x1f), rs, 0b001, rd, 0b0011011);
+}
+
+[[nodiscard]] constexpr uint32_t SRAIW(GPR rd, GPR rs, uint32_t shift) {
+    BISCUIT_ASSERT(shift <= 31);
+    return EncodeIType((0b0100000 << 5) | (shift & 0x1f), rs, 0b101, rd, 0b0011011);
+}
+
+[[nodiscard]] constexpr uint32_t SRLIW(GPR rd, GPR rs, uint32_t shift) {
+    BISCUIT_ASSERT(shift <= 31);
+    return EncodeIType((shift & 0x1f), rs, 0b101, rd, 0b0011011);
+}
+
+[[nodiscard]] constexpr uint32_t SLLW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b001, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t SRAW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0100000, rhs, lhs, 0b101, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t SRLW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000000, rhs, lhs, 0b101, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t SUBW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0100000, rhs, lhs, 0b000, rd, 0b0111011);
+}
+
+// RV32M Instructions
+
+[[nodiscard]] constexpr uint32_t DIV(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b100, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t DIVU(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b101, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t MUL(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b000, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t MULH(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b001, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t MULHSU(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b010, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t MULHU(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b011, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t REM(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b110, rd, 0b0110011);
+}
+
+[[nodiscard]] constexpr uint32_t REMU(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b111, rd, 0b0110011);
+}
+
+// RV64M Instructions
+
+[[nodiscard]] constexpr uint32_t DIVUW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b101, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t DIVW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b100, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t MULW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b000, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t REMUW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b111, rd, 0b0111011);
+}
+
+[[nodiscard]] constexpr uint32_t REMW(GPR rd, GPR lhs, GPR rhs) {
+    return EncodeRType(0b0000001, rhs, lhs, 0b110, rd, 0b0111011);
+}
+
+} // namespace enc
+
+} // namespace biscuit
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+
+namespace biscuit {
+
+/**
+ * ISA extensions that an assembler instance can take advantage of
+ * when deciding how to emit particular code sequences.
+ *
+ * Extensions not listed here are still usable through their
+ * respective instruction functions. This only serves as a way to
+ * let the assembler pick faster or smaller encodings on its own.
+ *
+ * @note The base ISA width is still described by ArchFeature.
+ */
+enum class Extension : uint32_t {
+    C,           //< Compressed instructions
+    Zba,         //< Address generation instructions
+    Zbb,         //< Basic bit-manipulation instructions
+    Zbs,         //< Single-bit instructions
+    M,           //< Integer multiplication and division
+    A,           //< Atomic instructions
+    F,           //< Single-precision floating-point
+    D,           //< Double-precision floating-point
+    V,           //< Vector instructions
+    Zawrs,       //< Wait-on-reservation-set instructions
+    Zcb,         //< Additional compressed instructions
+    Zcmop,       //< Compressed may-be-operations
+    Zfa,         //< Additional floating-point instructions
+    Zfhmin,      //< Minimal half-precision floating-point
+    Zicbom,      //< Cache-block management instructions
+    Zicbop,      //< Cache-block prefetch instructions
+    Zicboz,      //< Cache-block zero instructions
+    Zicond,      //< Integer conditional operations
+    Zihintntl,   //< Non-temporal locality hints
+    Zihintpause, //< Pause hint
+    Zimop,       //< May-be-operations
+    Zkt,         //< Data-independent execution latency
+    Zvbb,        //< Vector basic bit-manipulation instructions
+    Zvfhmin,     //< Minimal vector half-precision floating-point
+    Zvkt,        //< Vector data-independent execution latency
+    Zacas,       //< Atomic compare-and-swap instructions
+    Zbc,         //< Carry-less multiplication
+    Zbkb,        //< Bit-manipulation for cryptography
+    Zbkc,        //< Carry-less multiplication for cryptography
+    Zbkx,        //< Crossbar permutations
+    Zfh,         //< Half-precision floating-point
+    Zknd,        //< NIST suite: AES decryption
+    Zkne,        //< NIST suite: AES encryption
+    Zknh,        //< NIST suite: Hash function instructions
+    Zksed,       //< ShangMi suite: SM4 block cipher instructions
+    Zksh,        //< ShangMi suite: SM3 hash function instructions
+    Ztso,        //< Total store ordering
+    Zvbc,        //< Vector carry-less multiplication
+    Zvfh,        //< Vector half-precision floating-point
+    Zvkb,        //< Vector cryptography bit-manipulation
+    Zvkg,        //< Vector GCM/GMAC
+    Zvkned,      //< Vector AES block cipher
+    Zvknha,      //< Vector SHA-2 (SHA-256)
+    Zvknhb,      //< Vector SHA-2 (SHA-256 and SHA-512)
+    Zvksed,      //< Vector SM4 block cipher
+    Zvksh,       //< Vector SM3 hash function
+    Zcmp,        //< Compressed push/pop and register moves
+    Zcmt,        //< Compressed table jumps
+};
+
+// ExtensionSet stores one bit per extension. Check against the last one.
+static_assert(static_cast<uint32_t>(Extension::Zcmt) < 64, "Extension set has run out of bits");
+
+/**
+ * A set of ISA extensions.
+ */
+class ExtensionSet {
+public:
+    /// Constructs an empty extension set.
+    constexpr ExtensionSet() noexcept = default;
+
+    /// Constructs an extension set containing all of the given extensions.
+    constexpr ExtensionSet(std::initializer_list<Extension> extensions) noexcept {
+        for (const auto extension : extensions) {
+            Add(extension);
+        }
+    }
+
+    /// Whether or not the given extension is within the set.
+    [[nodiscard]] constexpr bool Has(Extension extension) const noexcept {
+        return (m_bits & ToBit(extension)) != 0;
+    }
+
+    /// Adds an extension to the set.
+    constexpr ExtensionSet& Add(Extension extension) noexcept {
+        m_bits |= ToBit(extension);
+        return *this;
+    }
+
+    /// Removes an extension from the set.
+    constexpr ExtensionSet& Remove(Extension extension) noexcept {
+        m_bits &= ~ToBit(extension);
+        return *this;
+    }
+
+    /// Whether or not every extension within the given set is also within this set.
+    [[nodiscard]] constexpr bool HasAll(ExtensionSet extensions) const noexcept {
+        return (m_bits & extensions.m_bits) == extensions.m_bits;
+    }
+
+    /// Whether or not the set contains any extensions.
+    [[nodiscard]] constexpr bool IsEmpty() const noexcept {
+        return m_bits == 0;
+    }
+
+    /**
+     * The extensions mandated by the RVA20U64 profile
+     * that the assembler is able to take into account.
+     */
+    [[nodiscard]] static constexpr ExtensionSet RVA20U64() noexcept {
+        return {Extension::M, Extension::A, Extension::F, Extension::D, Extension::C};
+    }
+
+    /**
+     * The extensions mandated by the RVA22U64 profile
+     * that the assembler is able to take into account.
+     */
+    [[nodiscard]] static constexpr ExtensionSet RVA22U64() noexcept {
+        return RVA20U64() | ExtensionSet{
+            Extension::Zba,    Extension::Zbb,    Extension::Zbs,
+            Extension::Zfhmin, Extension::Zicbom, Extension::Zicbop,
+            Extension::Zicboz, Extension::Zihintpause, Extension::Zkt,
+        };
+    }
+
+    /**
+     * The extensions mandated by the RVA23U64 profile
+     * that the assembler is able to take into account.
+     */
+    [[nodiscard]] static constexpr ExtensionSet RVA23U64() noexcept {
+        return RVA22U64() | ExtensionSet{
+            Extension::V,     Extension::Zawrs,     Extension::Zcb,
+            Extension::Zcmop, Extension::Zfa,       Extension::Zicond,
+            Extension::Zihintntl, Extension::Zimop, Extension::Zvbb,
+            Extension::Zvfhmin,   Extension::Zvkt,
+        };
+    }
+
+    friend constexpr ExtensionSet operator|(ExtensionSet lhs, ExtensionSet rhs) noexcept {
+        lhs.m_bits |= rhs.m_bits;
+        return lhs;
+    }
+
+    friend constexpr ExtensionSet operator&(ExtensionSet lhs, ExtensionSet rhs) noexcept {
+        lhs.m_bits &= rhs.m_bits;
+        return lhs;
+    }
+
+    friend constexpr bool operator==(ExtensionSet, ExtensionSet) = default;
+
+private:
+    [[nodiscard]] static constexpr uint64_t ToBit(Extension extension) noexcept {
+        return uint64_t{1} << static_cast<uint32_t>(extension);
+    }
+
+    uint64_t m_bits = 0;
+};
+
+} // namespace biscuit
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/label.hpp>
+#include <biscuit/registers.hpp>
+
+namespace biscuit {
+
+/**
+ * How a FrameBuilder saves and restores callee-saved registers.
+ */
+enum class FrameStrategy : uint32_t {
+    /**
+     * Picks Push if Zcmp is part of the assembler's extension set, Stubs if
+     * shared stubs were provided, and Inline otherwise.
+     */
+    Auto,
+
+    /// A single CM.PUSH in the prologue and CM.POPRET in the epilogue. Requires Zcmp.
+    Push,
+
+    /// Individual stores and loads, using their compressed forms if C is available.
+    Inline,
+
+    /**
+     * Calls into shared out-of-line save and restore stubs (see FrameStubs).
+     *
+     * This trades a jump in and out of each stub for the smallest
+     * prologues and epilogues possible without Zcmp.
+     */
+    Stubs,
+};
+
+/**
+ * Shared save and restore routines that frames built with FrameStrategy::Stubs call into.
+ *
+ * There's one pair of stubs for each number of saved s-registers. Save stubs are
+ * called with t0 as the link register, allocate the register save area and store
+ * ra and s0 onwards into it. Restore stubs are jumped to, load the registers back,
+ * deallocate the save area and return to the caller of the frame.
+ *
+ * Only stubs that have been referenced by a frame are emitted.
+ *
+ * @note Since frames reference stubs with JAL, stubs must be emitted within
+ *       1MiB of every frame that makes use of them.
+ */
+class FrameStubs {
+public:
+    FrameStubs() = default;
+
+    // Frames hold onto the stubs' labels.
+    FrameStubs(const FrameStubs&) = delete;
+    FrameStubs& operator=(const FrameStubs&) = delete;
+    FrameStubs(FrameStubs&&) = delete;
+    FrameStubs& operator=(FrameStubs&&) = delete;
+
+    /**
+     * Emits every stub that's been referenced, but not emitted yet, at the cursor.
+     *
+     * @param as The assembler that the referencing frames were emitted with.
+     */
+    void Emit(Assembler& as);
+
+private:
+    friend class FrameBuilder;
+
+    // ra along with s0 through s11.
+    static constexpr size_t max_stubs = 13;
+
+    std::array<Label, max_stubs> m_save;
+    std::array<Label, max_stubs> m_restore;
+    uint32_t m_referenced = 0;
+    uint32_t m_emitted = 0;
+};
+
+/**
+ * Emits the prologue and epilogue of a function.
+ *
+ * The frame consists of the callee-saved registers the function makes use of and
+ * an area for its locals, with the whole frame kept 16-byte aligned as required by
+ * the calling convention. The locals live at the bottom of the frame, starting at sp
+ * once the prologue has run. Saved registers are stored above them in the same layout
+ * CM.PUSH uses, with the highest numbered s-register at the top of the frame and ra
+ * at the bottom of the register save area.
+ *
+ * @par
+ * An example of building a function's frame:
+ *
+ * @code{.cpp}
+ * const std::array<GPR, 3> saved{ra, s0, s1};
+ * FrameBuilder frame{as, saved, 32};
+ *
+ * frame.EmitPrologue();
+ * // Function body, with 32 bytes of locals at 0(sp).
+ * frame.EmitEpilogue();
+ * @endcode
+ */
+class FrameBuilder {
+public:
+    /**
+     * Constructor
+     *
+     * @param as          The assembler to emit the prologue and epilogue with.
+     * @param saved       The callee-saved registers (ra and s0-s11) the function clobbers.
+     * @param locals_size The size of the function's locals in bytes.
+     * @param strategy    How the registers are saved and restored.
+     * @param stubs       The shared stubs to use with FrameStrategy::Stubs.
+     *
+     * @note Push and Stubs can only save ra along with a contiguous range of s-registers
+     *       starting at s0, so they save every s-register up to the highest numbered one
+     *       in `saved`, and always save ra. Push also saves s11 if s10 is saved,
+     *       since the two can only be pushed together.
+     */
+    FrameBuilder(Assembler& as, std::span<const GPR> saved, uint32_t locals_size,
+                 FrameStrategy strategy = FrameStrategy::Auto, FrameStubs* stubs = nullptr);
+
+    /// Allocates the frame and saves the callee-saved registers.
+    void EmitPrologue();
+
+    /// Restores the callee-saved registers, deallocates the frame and returns.
+    void EmitEpilogue();
+
+    /// Gets the strategy in use, with FrameStrategy::Auto resolved.
+    [[nodiscard]] FrameStrategy GetStrategy() const noexcept {
+        return m_strategy;
+    }
+
+    /// Gets the total size of the frame in bytes.
+    [[nodiscard]] uint32_t GetFrameSize() const noexcept {
+        return m_frame_size;
+    }
+
+    /**
+     * Gets where a register is saved within the frame.
+     *
+     * @returns The offset of the register's slot from sp once the prologue has run,
+     *          or an empty optional if the register isn't saved by the frame.
+     */
+    [[nodiscard]] std::optional<int32_t> GetSaveSlot(GPR reg) const noexcept;
+
+private:
+    Assembler& m_assembler;
+    FrameStubs* m_stubs;
+    FrameStrategy m_strategy;
+
+    // Bitmask of the saved registers, indexed by register number.
+    uint32_t m_saved = 0;
+
+    // Number of s-registers saved by Push and Stubs.
+    uint32_t m_s_count = 0;
+
+    // Size of the 16-byte aligned area that's allocated along with saving the registers.
+    uint32_t m_save_size = 0;
+
+    uint32_t m_frame_size = 0;
+};
+
+} // namespace biscuit
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/label.hpp>
+#include <biscuit/registers.hpp>
+
+namespace biscuit {
+
+/**
+ * Manages the table of targets that Zcmt's CM.JT and CM.JALT jump through.
+ *
+ * Each entry of the table holds the XLEN-wide absolute address of a target, with
+ * the first 32 entries being reachable by CM.JT (plain jumps) and the rest by
+ * CM.JALT (calls that link through ra). Once the table is emitted and the jvt CSR
+ * points at it, jumps and calls to any of its targets only take up 2 bytes.
+ *
+ * @par
+ * An example of dispatching a call through the table:
+ *
+ * @code{.cpp}
+ * JumpVectorTable table;
+ * const auto index = table.AddCall(&helper);
+ *
+ * table.EmitSetup(as, t0);
+ * as.CM_JALT(*index);
+ * ...
+ * table.Emit(as);
+ * @endcode
+ *
+ * @note Entries for labels are relocated like EmitAddress(), so if the code
+ *       buffer moves afterwards, the table's relocations have to be applied again.
+ */
+class JumpVectorTable {
+public:
+    /// The number of entries reachable by CM.JT.
+    static constexpr uint32_t jump_entry_count = 32;
+
+    /// The maximum number of entries a table can have.
+    static constexpr uint32_t max_entry_count = 256;
+
+    /// The alignment jvt requires of the table.
+    static constexpr size_t table_alignment = 64;
+
+    /**
+     * Constructor
+     *
+     * @param entry_count The number of entries in the table. Entries beyond the first
+     *                    32 are the only ones available to AddCall(), so this should be
+     *                    64 unless more than 32 call targets are needed.
+     */
+    explicit JumpVectorTable(uint32_t entry_count = 64);
+
+    // The assembler holds onto the table's label while it's unbound.
+    JumpVectorTable(const JumpVectorTable&) = delete;
+    JumpVectorTable& operator=(const JumpVectorTable&) = delete;
+    JumpVectorTable(JumpVectorTable&&) = delete;
+    JumpVectorTable& operator=(JumpVectorTable&&) = delete;
+
+    /**
+     * Adds a jump target to the table, for use with CM.JT.
+     *
+     * @returns The index to pass to CM_JT(), or an empty optional if all
+     *          jump entries are in use. Adding the same target more
+     *          than once returns the same index.
+     */
+    std::optional<uint32_t> AddJump(Label* target);
+    std::optional<uint32_t> AddJump(uintptr_t target);
+
+    /**
+     * Adds a call target to the table, for use with CM.JALT.
+     *
+     * @returns The index to pass to CM_JALT(), or an empty optional if all
+     *          call entries are in use. Adding the same target more
+     *          than once returns the same index.
+     */
+    std::optional<uint32_t> AddCall(Label* target);
+    std::optional<uint32_t> AddCall(uintptr_t target);
+
+    /**
+     * Emits code that points jvt at the table.
+     *
+     * The table doesn't need to have been emitted yet.
+     *
+     * @param as      The assembler to emit the setup code with.
+     * @param scratch The register to hold the table's address in.
+     */
+    void EmitSetup(Assembler& as, GPR scratch);
+
+    /**
+     * Emits the table at the cursor, padding it to the alignment required by jvt.
+     *
+     * Entries that haven't been added are filled with zero.
+     *
+     * @note Targets can't be added after the table has been emitted.
+     */
+    void Emit(Assembler& as);
+
+    /// Gets the label bound to the start of the table once it's emitted.
+    [[nodiscard]] Label* GetLabel() noexcept {
+        return &m_label;
+    }
+
+    /// Gets the number of entries in the table.
+    [[nodiscard]] uint32_t GetEntryCount() const noexcept {
+        return static_cast<uint32_t>(m_entries.size());
+    }
+
+private:
+    struct Entry {
+        Label* label = nullptr;
+        uintptr_t address = 0;
+    };
+
+    // Adds an entry within [first, last), reusing an existing one with the same target.
+    std::optional<uint32_t> AddEntry(const Entry& entry, uint32_t first, uint32_t last);
+
+    std::vector<Entry> m_entries;
+    std::vector<bool> m_used;
+    Label m_label;
+};
+
+} // namespace biscuit
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_buffer.hpp>
+
+namespace biscuit {
+
+/// Signature of the memcpy kernel. Matches the C library's memcpy.
+using MemcpyKernel = void* (*)(void* dst, const void* src, size_t size);
+
+/// Signature of the memset kernel. Matches the C library's memset.
+using MemsetKernel = void* (*)(void* dst, int value, size_t size);
+
+/// Signature of the memcmp kernel. Matches the C library's memcmp.
+using MemcmpKernel = int (*)(const void* lhs, const void* rhs, size_t size);
+
+/// Signature of the strlen kernel. Matches the C library's strlen.
+using StrlenKernel = size_t (*)(const char* str);
+
+/**
+ * Signature of the CRC-32 kernel. Matches zlib's crc32, so passing
+ * the result of a previous call continues the checksum.
+ */
+using CRC32Kernel = uint32_t (*)(uint32_t crc, const void* data, size_t size);
+
+/**
+ * Describes the hardware and workload kernels are specialized for.
+ */
+struct KernelOptions {
+    /// The vector register length in bytes (e.g. from CPUInfo::GetVlenb()).
+    uint32_t vlenb = 0;
+
+    /// The typical size in bytes kernels are called with, or 0 if unknown.
+    size_t typical_size = 0;
+};
+
+/**
+ * Emits a vectorized memcpy at the cursor.
+ *
+ * @returns The offset of the kernel within the code buffer.
+ */
+ptrdiff_t EmitMemcpyKernel(Assembler& as, const KernelOptions& options);
+
+/**
+ * Emits a vectorized memset at the cursor.
+ *
+ * @returns The offset of the kernel within the code buffer.
+ */
+ptrdiff_t EmitMemsetKernel(Assembler& as, const KernelOptions& options);
+
+/**
+ * Emits a vectorized memcmp at the cursor.
+ *
+ * @returns The offset of the kernel within the code buffer.
+ */
+ptrdiff_t EmitMemcmpKernel(Assembler& as, const KernelOptions& options);
+
+/**
+ * Emits a vectorized strlen at the cursor.
+ *
+ * Strings are read with fault-only-first loads, so reading
+ * ahead of the terminator never crosses into unmapped memory.
+ *
+ * @returns The offset of the kernel within the code buffer.
+ */
+ptrdiff_t EmitStrlenKernel(Assembler& as, const KernelOptions& options);
+
+/**
+ * Emits a CRC-32 (as used by zlib, Ethernet, etc.) at the cursor.
+ *
+ * Eight bytes are folded into the checksum at a time with a Barrett reduction
+ * that carries out its carry-less multiplications with Zvbc's VCLMUL and VCLMULH.
+ *
+ * @returns The offset of the kernel within the code buffer, or an empty optional
+ *          if Zvbc isn't part of the assembler's extension set or the assembler
+ *          isn't targeting RV64.
+ */
+std::optional<ptrdiff_t> EmitCRC32Kernel(Assembler& as);
+
+/**
+ * Gets a callable pointer to a kernel.
+ *
+ * @param buffer The code buffer the kernel was emitted into.
+ * @param offset The offset returned when emitting the kernel.
+ *
+ * @note The buffer has to be made executable before the kernel is called,
+ *       and the pointer becomes stale if the buffer's memory moves.
+ */
+template <typename Kernel>
+[[nodiscard]] Kernel GetKernel(const CodeBuffer& buffer, ptrdiff_t offset) noexcept {
+    return reinterpret_cast<Kernel>(buffer.GetOffsetAddress(offset));
+}
+
+/**
+ * The full set of runtime kernels.
+ */
+struct RuntimeKernels {
+    MemcpyKernel memcpy = nullptr;
+    MemsetKernel memset = nullptr;
+    MemcmpKernel memcmp = nullptr;
+    StrlenKernel strlen = nullptr;
+
+    /// Null if the CRC-32 kernel isn't supported (see EmitCRC32Kernel()).
+    CRC32Kernel crc32 = nullptr;
+};
+
+/**
+ * Emits every runtime kernel at the cursor.
+ *
+ * @par
+ * An example of setting up kernels for the host:
+ *
+ * @code{.cpp}
+ * CPUInfo cpu;
+ * Assembler as;
+ * as.SetExtensions(cpu.GetExtensions());
+ *
+ * const auto kernels = EmitRuntimeKernels(as, {.vlenb = cpu.GetVlenb()});
+ * as.GetCodeBuffer().SetExecutable();
+ * kernels.memcpy(dst, src, size);
+ * @endcode
+ *
+ * @note Pointers are taken once all kernels are emitted. The same
+ *       requirements as with GetKernel() apply to them.
+ */
+[[nodiscard]] RuntimeKernels EmitRuntimeKernels(Assembler& as, const KernelOptions& options);
+
+} // namespace biscuit
@@ -1,9 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <optional>
-#include <set>
 #include <biscuit/assert.hpp>
+#include <biscuit/small_vector.hpp>
 
 namespace biscuit {
 
@@ -49,6 +50,22 @@ public:
      */
     explicit Label() = default;
 
+    /**
+     * Creates a label that's local to the code referencing it.
+     *
+     * Relocations (see Assembler::SetRelocationRecording()) normally refer to labels
+     * by pointer, so labels have to outlive them. References to a local label are
+     * recorded by the label's location instead, once it's bound, so it may be destroyed
+     * while the relocations are still around. This suits labels internal to a sequence
+     * of code, like the loops within an emitted routine, at the cost of relocations
+     * no longer identifying the label (e.g. for mapping it onto an external symbol).
+     */
+    [[nodiscard]] static Label Local() noexcept {
+        Label label;
+        label.m_local = true;
+        return label;
+    }
+
     /// Destructor
     ~Label() noexcept {
         // It's a logic bug if something references a label and hasn't been handled.
@@ -104,6 +121,11 @@ public:
         return !IsResolved();
     }
 
+    /// Determines whether or not this label was created with Local().
+    [[nodiscard]] bool IsLocal() const noexcept {
+        return m_local;
+    }
+
     /**
      * Retrieves the location for this label.
      *
@@ -153,7 +175,13 @@ private:
         BISCUIT_ASSERT(!IsBound());
         BISCUIT_ASSERT(IsNewOffset(offset));
 
-        m_offsets.insert(offset);
+        // Offsets are kept sorted. References are almost always made in
+        // increasing order, so this is nearly always a plain append.
+        if (m_offsets.empty() || m_offsets.back() < offset) {
+            m_offsets.push_back(offset);
+        } else {
+            m_offsets.insert(std::lower_bound(m_offsets.begin(), m_offsets.end(), offset), offset);
+        }
     }
 
     // Clears all the underlying offsets for this label.
@@ -161,13 +189,31 @@ private:
         m_offsets.clear();
     }
 
+    // Returns the label to the state it was constructed in, dropping any offsets.
+    void Reset() noexcept {
+        m_offsets.clear();
+        m_location.reset();
+        m_relax_epoch = 0;
+    }
+
     // Determines whether or not this address has already been added before.
     [[nodiscard]] bool IsNewOffset(LocationOffset offset) const noexcept {
-        return m_offsets.find(offset) == m_offsets.cend();
+        return !std::binary_search(m_offsets.cbegin(), m_offsets.cend(), offset);
     }
 
-    std::set<LocationOffset> m_offsets;
+    // Most labels only ever have a few references to them before being bound,
+    // so these are kept inline to avoid allocating for each reference.
+    static constexpr size_t inline_offset_count = 4;
+
+    SmallVector<LocationOffset, inline_offset_count> m_offsets;
     Location m_location;
+
+    // Number of branch relaxation shifts the assembler has already
+    // applied to the location and offsets within this label.
+    size_t m_relax_epoch = 0;
+
+    // Whether relocations refer to the label's location rather than the label itself.
+    bool m_local = false;
 };
 
 } // namespace biscuit
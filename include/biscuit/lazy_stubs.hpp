@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/label.hpp>
+
+namespace biscuit {
+
+/**
+ * Trampolines that compile functions the first time they're called.
+ *
+ * Each stub is a small AUIPC+JALR pair into a shared resolver, followed by the stub's ID.
+ * The first call through a stub enters the resolver, which saves the argument registers
+ * and invokes the compile callback with the stub's ID. The stub is then atomically
+ * retargeted at the compiled code (see Assembler::RetargetCall()) and the call carries
+ * on into it, as if it had been made to the compiled code directly. Later calls through
+ * the stub go straight to the compiled code.
+ *
+ * Stubs are entered with the calling convention of the function they stand in for and
+ * clobber t0 and t1, which the calling convention doesn't preserve across calls anyway.
+ * The resolver preserves ra, a0-a7 and, if F or D is part of the assembler's extension
+ * set, fa0-fa7. Vector arguments aren't preserved.
+ *
+ * @par
+ * An example of calling a function that's compiled on demand:
+ *
+ * @code{.cpp}
+ * LazyStubs stubs{as, [&](uint32_t id) {
+ *     return CompileFunction(id);
+ * }};
+ *
+ * stubs.EmitResolver();
+ * Label function;
+ * const auto id = stubs.EmitStub(&function);
+ * ...
+ * as.CALL(&function);
+ * @endcode
+ *
+ * @note The compile callback is invoked with the stubs' lock held, so it's never
+ *       invoked concurrently, and each stub is only ever compiled once. It may emit
+ *       further stubs itself.
+ *
+ * @note Stubs are patched while they may be executing, so the code buffer's memory
+ *       must stay writable. Under W^X, this requires a dual-mapped buffer
+ *       (see CodeBufferMapping::Dual).
+ */
+class LazyStubs {
+public:
+    /**
+     * Compiles the function behind a stub.
+     *
+     * @param id The ID of the stub being called.
+     *
+     * @returns The address of the compiled function.
+     */
+    using CompileCallback = std::function<uintptr_t(uint32_t id)>;
+
+    /// The size of a stub in bytes.
+    static constexpr size_t stub_size = 12;
+
+    /**
+     * Constructor
+     *
+     * @param as      The assembler to emit the resolver and stubs with, and to patch
+     *                the stubs through. It must outlive every call made through a stub.
+     * @param compile Invoked the first time each stub is called.
+     */
+    LazyStubs(Assembler& as, CompileCallback compile);
+
+    // The resolver refers to the stubs by address.
+    LazyStubs(const LazyStubs&) = delete;
+    LazyStubs& operator=(const LazyStubs&) = delete;
+    LazyStubs(LazyStubs&&) = delete;
+    LazyStubs& operator=(LazyStubs&&) = delete;
+
+    /**
+     * Emits the resolver that stubs call into at the cursor.
+     *
+     * @pre Must be called once, before any stubs are emitted.
+     */
+    void EmitResolver();
+
+    /**
+     * Emits a stub at the cursor, padding it to a 4-byte boundary if necessary.
+     *
+     * @param entry A label to bind to the start of the stub, if any.
+     *
+     * @returns The ID of the stub, which is handed to the compile callback.
+     *          IDs are handed out sequentially, starting at zero.
+     *
+     * @pre The resolver must be within 2GiB of the stub.
+     */
+    uint32_t EmitStub(Label* entry = nullptr);
+
+    /**
+     * Compiles the function behind a stub if it hasn't been already,
+     * and retargets the stub at it.
+     *
+     * This is what the resolver calls on the first call through a stub,
+     * but it can also be used to compile a function ahead of time.
+     *
+     * @param id The ID of the stub.
+     *
+     * @returns The address of the compiled function.
+     *
+     * @note If the compiled function is out of range of the stub, the stub is left
+     *       pointing at the resolver, which keeps forwarding calls to the function
+     *       without invoking the compile callback again.
+     */
+    uintptr_t Resolve(uint32_t id);
+
+    /// Gets the offset of a stub within the code buffer.
+    [[nodiscard]] ptrdiff_t GetStubOffset(uint32_t id) const;
+
+    /// Gets the address of the compiled function behind a stub, if it's been compiled.
+    [[nodiscard]] std::optional<uintptr_t> GetTarget(uint32_t id) const;
+
+    /// Gets the number of stubs emitted.
+    [[nodiscard]] size_t GetStubCount() const;
+
+    /// Gets the offset of the resolver within the code buffer, if it's been emitted.
+    [[nodiscard]] std::optional<ptrdiff_t> GetResolverOffset() const noexcept {
+        return m_resolver_offset;
+    }
+
+private:
+    struct Stub {
+        ptrdiff_t offset;
+        uintptr_t target;
+    };
+
+    // Called by the resolver, with the calling convention of regular functions.
+    static uintptr_t ResolveThunk(LazyStubs* stubs, uint32_t id);
+
+    Assembler& m_assembler;
+    CompileCallback m_compile;
+    std::optional<ptrdiff_t> m_resolver_offset;
+
+    // Recursive, so the compile callback may emit further stubs.
+    mutable std::recursive_mutex m_mutex;
+    std::vector<Stub> m_stubs;
+};
+
+} // namespace biscuit
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <biscuit/code_buffer.hpp>
+
+namespace biscuit {
+
+class Label;
+
+// Registration of generated code with Linux perf.
+//
+// perf can't attribute samples within anonymous memory on its own, so code emitted
+// at runtime shows up as [unknown]. It supports two ways of describing such code:
+//
+// - Perf maps (/tmp/perf-<pid>.map), a text file of address ranges and symbol names.
+//   perf report picks these up automatically.
+//
+// - Jitdump files (jit-<pid>.dump), a binary log that also contains a copy of the
+//   code itself and optional line tables. These need an extra pass with perf inject
+//   after recording (e.g. `perf record -k mono ...` followed by `perf inject --jit`),
+//   but allow annotating the generated code even after it's been freed or overwritten.
+//
+// Both writers can additionally break a symbol down using labels bound within it,
+// which is useful for attributing samples to individual basic blocks.
+
+/**
+ * A named label within a symbol, used to break symbols down into smaller regions.
+ *
+ * Labels that are unbound, or bound outside of the symbol they're given with, are ignored.
+ */
+struct PerfLabel {
+    const Label* label = nullptr;
+    std::string_view name;
+};
+
+/**
+ * Writer for perf map files.
+ *
+ * @par
+ * An example of registering a function:
+ *
+ * @code{.cpp}
+ * PerfMap perf_map;
+ *
+ * const auto start = as.GetCodeBuffer().GetCursorOffset();
+ * // Emit code...
+ * const auto end = as.GetCodeBuffer().GetCursorOffset();
+ *
+ * perf_map.AddSymbol(as.GetCodeBuffer(), {start, static_cast<size_t>(end - start)}, "my_function");
+ * @endcode
+ */
+class PerfMap {
+public:
+    /// Constructor. Opens /tmp/perf-<pid>.map, where perf expects the map for the current process.
+    PerfMap();
+
+    /**
+     * Constructor
+     *
+     * @param path The path of the map file to write.
+     *
+     * @note Existing files are appended to, so that multiple writers in
+     *       the same process can register their code in the same map.
+     */
+    explicit PerfMap(std::string path);
+
+    // Copying would result in symbols being written out of order.
+    PerfMap(const PerfMap&) = delete;
+    PerfMap& operator=(const PerfMap&) = delete;
+
+    PerfMap(PerfMap&& other) noexcept;
+    PerfMap& operator=(PerfMap&& other) noexcept;
+
+    /// Destructor. Flushes and closes the file.
+    ~PerfMap() noexcept;
+
+    /// Whether or not the file was successfully opened.
+    [[nodiscard]] bool IsOpen() const noexcept { return m_file != nullptr; }
+
+    /// Returns the path of the file being written.
+    [[nodiscard]] const std::string& GetPath() const noexcept { return m_path; }
+
+    /**
+     * Adds a symbol for an arbitrary range of code.
+     *
+     * @param address The address of the code.
+     * @param size    The size of the code in bytes.
+     * @param name    The name of the symbol.
+     */
+    void AddSymbol(uintptr_t address, size_t size, std::string_view name);
+
+    /**
+     * Adds a symbol for a range of code within a code buffer.
+     *
+     * @param buffer The code buffer containing the code.
+     * @param range  The range of the code within the buffer.
+     * @param name   The name of the symbol.
+     * @param labels Labels to break the symbol down with. The code from each label to
+     *               the next one (or the end of the range) is given its own symbol, named
+     *               `name:label`, while code before the first label keeps the plain name.
+     *
+     * @note Symbols are registered at the buffer's executable addresses,
+     *       which matters for dual-mapped buffers.
+     */
+    void AddSymbol(const CodeBuffer& buffer, CodeRange range, std::string_view name,
+                   std::span<const PerfLabel> labels = {});
+
+    /// Flushes all symbols added so far out to the file.
+    void Flush();
+
+private:
+    std::FILE* m_file = nullptr;
+    std::string m_path;
+};
+
+/**
+ * Writer for jitdump files.
+ *
+ * Timestamps are taken from the monotonic clock, so recordings
+ * need to be made with `perf record -k mono` to line up with them.
+ */
+class JitDump {
+public:
+    /// Constructor. Opens /tmp/jit-<pid>.dump.
+    JitDump();
+
+    /**
+     * Constructor
+     *
+     * @param path The path of the dump file to write. perf inject only recognizes
+     *             files named jit-<pid>.dump, though they can be in any directory.
+     *
+     * @note Existing files are truncated, as a dump can only have one header.
+     */
+    explicit JitDump(std::string path);
+
+    JitDump(const JitDump&) = delete;
+    JitDump& operator=(const JitDump&) = delete;
+
+    JitDump(JitDump&& other) noexcept;
+    JitDump& operator=(JitDump&& other) noexcept;
+
+    /// Destructor. Writes the closing record and closes the file.
+    ~JitDump() noexcept;
+
+    /// Whether or not the file was successfully opened.
+    [[nodiscard]] bool IsOpen() const noexcept { return m_file != nullptr; }
+
+    /// Returns the path of the file being written.
+    [[nodiscard]] const std::string& GetPath() const noexcept { return m_path; }
+
+    /**
+     * Adds a record for an arbitrary range of code, copying the code into the dump.
+     *
+     * @param address The address the code executes at.
+     * @param code    The code itself. May differ from address for dual-mapped memory.
+     * @param size    The size of the code in bytes.
+     * @param name    The name of the symbol.
+     */
+    void AddSymbol(uintptr_t address, const uint8_t* code, size_t size, std::string_view name);
+
+    /**
+     * Adds a record for a range of code within a code buffer.
+     *
+     * @param buffer The code buffer containing the code.
+     * @param range  The range of the code within the buffer.
+     * @param name   The name of the symbol.
+     * @param labels Labels to break the symbol down with. Rather than becoming separate
+     *               symbols as with perf maps, they're written out as a line table, in which
+     *               the code from each label onwards maps to the label's name as a file name
+     *               and the label's (1-based) index as a line number.
+     */
+    void AddSymbol(const CodeBuffer& buffer, CodeRange range, std::string_view name,
+                   std::span<const PerfLabel> labels = {});
+
+    /// Flushes all records added so far out to the file.
+    void Flush();
+
+private:
+    void Close() noexcept;
+    void WriteHeader();
+
+    std::FILE* m_file = nullptr;
+    std::string m_path;
+    uint64_t m_code_index = 0;
+
+    // perf only notices dumps that the process has mapped as executable.
+    void* m_marker = nullptr;
+    size_t m_marker_size = 0;
+};
+
+} // namespace biscuit
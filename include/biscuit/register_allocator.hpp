@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/registers.hpp>
+
+namespace biscuit {
+
+/**
+ * A virtual general-purpose register, which is assigned
+ * a physical register by a RegisterAllocator.
+ */
+class VReg {
+public:
+    constexpr VReg() noexcept = default;
+
+    /// Gets the index of this virtual register.
+    [[nodiscard]] constexpr uint32_t Index() const noexcept {
+        return m_index;
+    }
+
+    friend constexpr bool operator==(VReg, VReg) = default;
+
+private:
+    friend class RegisterAllocator;
+
+    constexpr explicit VReg(uint32_t index) noexcept
+        : m_index{index} {}
+
+    uint32_t m_index = 0;
+};
+
+/**
+ * How an operation accesses one of its virtual registers.
+ */
+struct VRegOperand {
+    VReg reg;
+    bool is_def = false;
+    bool is_use = false;
+};
+
+/**
+ * A linear-scan register allocator for virtual general-purpose registers.
+ *
+ * Code is written once as a body that operates on virtual registers, and the allocator
+ * runs it twice. The first run (Analyze()) computes the live range of every virtual
+ * register from the operations it's used in, extending ranges that are live into a loop
+ * across the whole loop by looking for backward branches in the emitted code. Registers
+ * are then assigned by linear scan, with ranges that don't fit spilled to the stack for
+ * their whole lifetime. The second run (Generate()) emits the code for real, with every
+ * virtual register replaced by its physical register, reloading and storing spilled ones
+ * around each operation using them.
+ *
+ * Between the two runs, the callee-saved registers that were assigned and the size of
+ * the spill area are known, so the frame can be set up with a FrameBuilder. Spill slots
+ * are addressed relative to sp within the frame's locals.
+ *
+ * @par
+ * An example of a function summing an array, with its frame built around it:
+ *
+ * @code{.cpp}
+ * RegisterAllocator alloc{as};
+ * const auto body = [](Assembler& as, RegisterAllocator& alloc) {
+ *     using RA = RegisterAllocator;
+ *     const auto sum = alloc.NewVReg();
+ *     const auto value = alloc.NewVReg();
+ *
+ *     alloc.Emit([&](GPR d) { as.LI(d, 0); }, RA::Def(sum));
+ *     Label loop;
+ *     as.Bind(&loop);
+ *     alloc.Emit([&](GPR d) { as.LD(d, 0, a0); }, RA::Def(value));
+ *     alloc.Emit([&](GPR d, GPR s) { as.ADD(d, d, s); }, RA::UseDef(sum), RA::Use(value));
+ *     as.ADDI(a0, a0, 8);
+ *     as.BNE(a0, a1, &loop);
+ *     alloc.Emit([&](GPR s) { as.MV(a0, s); }, RA::Use(sum));
+ * };
+ *
+ * alloc.Analyze(body);
+ * const auto saved = alloc.GetUsedCalleeSaved();
+ * FrameBuilder frame{as, saved, alloc.GetSpillAreaSize()};
+ * frame.EmitPrologue();
+ * alloc.Generate(body);
+ * frame.EmitEpilogue();
+ * @endcode
+ *
+ * @note The body must emit the same operations with the same virtual registers in the
+ *       same order on both runs. Since the first run's code is discarded by rewinding
+ *       the buffer, labels the body references that live outside of it must already be
+ *       bound, and starting at offset 0 releases labels created with NewLabel(),
+ *       just as with Assembler::RewindBuffer().
+ */
+class RegisterAllocator {
+public:
+    /// Emits code operating on virtual registers.
+    using Body = std::function<void(Assembler&, RegisterAllocator&)>;
+
+    /// The registers allocated by default: the temporaries t0-t3 first, then s1-s11.
+    static constexpr std::array<GPR, 15> default_allocatable{
+        t0, t1, t2, t3, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10, s11,
+    };
+
+    /// The registers spilled virtual registers are loaded into by default.
+    static constexpr std::array<GPR, 3> default_scratch{t4, t5, t6};
+
+    /// The largest number of virtual registers a single operation may access.
+    static constexpr size_t max_operands = 8;
+
+    /**
+     * Constructor
+     *
+     * @param as           The assembler to emit code with.
+     * @param allocatable  The registers that may be assigned, in order of preference.
+     * @param scratch      The registers spilled virtual registers are loaded into. A single
+     *                     operation can access as many spilled registers as are given here.
+     * @param spill_offset The offset from sp at which the spill area starts.
+     *
+     * @note The body must not use any of the allocatable or scratch registers itself.
+     */
+    explicit RegisterAllocator(Assembler& as, std::span<const GPR> allocatable = default_allocatable,
+                               std::span<const GPR> scratch = default_scratch, int32_t spill_offset = 0);
+
+    /// Describes an operation writing to a virtual register.
+    [[nodiscard]] static constexpr VRegOperand Def(VReg reg) noexcept {
+        return {.reg = reg, .is_def = true};
+    }
+
+    /// Describes an operation reading from a virtual register.
+    [[nodiscard]] static constexpr VRegOperand Use(VReg reg) noexcept {
+        return {.reg = reg, .is_use = true};
+    }
+
+    /// Describes an operation both reading from and writing to a virtual register.
+    [[nodiscard]] static constexpr VRegOperand UseDef(VReg reg) noexcept {
+        return {.reg = reg, .is_def = true, .is_use = true};
+    }
+
+    /**
+     * Creates a new virtual register. May only be called from within a body.
+     */
+    [[nodiscard]] VReg NewVReg();
+
+    /**
+     * Emits an operation on virtual registers.
+     *
+     * @param emitter  Emits the operation. It's given one physical register for each
+     *                 operand, in the same order, and may emit any number of instructions.
+     * @param operands The virtual registers the operation accesses. A virtual register
+     *                 given more than once is given the same physical register each time.
+     *
+     * @pre May only be called from within a body.
+     */
+    template <typename Emitter, typename... Operands>
+    void Emit(Emitter&& emitter, Operands... operands) {
+        static_assert(sizeof...(Operands) <= max_operands, "Too many operands");
+
+        const std::array<VRegOperand, sizeof...(Operands)> ops{operands...};
+        std::array<GPR, sizeof...(Operands)> regs{};
+        BeginOperation(ops, regs);
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            emitter(regs[I]...);
+        }(std::index_sequence_for<Operands...>{});
+        EndOperation(ops, regs);
+    }
+
+    /**
+     * Runs a body for analysis, and assigns registers to its virtual registers.
+     *
+     * The code emitted by the body is discarded afterwards by rewinding the buffer.
+     */
+    void Analyze(const Body& body);
+
+    /**
+     * Runs a body to emit its code with registers assigned.
+     *
+     * @pre Analyze() must have been run on the same body at the same location,
+     *      barring any code emitted in between, like a prologue.
+     */
+    void Generate(const Body& body);
+
+    /// Gets the physical register assigned to a virtual register, if it wasn't spilled.
+    [[nodiscard]] std::optional<GPR> GetAssignment(VReg reg) const noexcept;
+
+    /// Gets the number of virtual registers created by the analyzed body.
+    [[nodiscard]] size_t GetVRegCount() const noexcept {
+        return m_intervals.size();
+    }
+
+    /// Gets the number of virtual registers that were spilled.
+    [[nodiscard]] size_t GetSpillCount() const noexcept {
+        return m_spill_count;
+    }
+
+    /// Gets the size in bytes of the spill area, which the frame's locals have to cover.
+    [[nodiscard]] uint32_t GetSpillAreaSize() const noexcept;
+
+    /// Gets the callee-saved registers that were assigned, which the frame has to save.
+    [[nodiscard]] std::vector<GPR> GetUsedCalleeSaved() const;
+
+private:
+    enum class Pass : uint32_t {
+        None,
+        Analyze,
+        Generate,
+    };
+
+    struct Interval {
+        uint32_t start = UINT32_MAX;
+        uint32_t end = 0;
+        std::optional<GPR> reg;
+        uint32_t spill_slot = 0;
+    };
+
+    void BeginOperation(std::span<const VRegOperand> operands, std::span<GPR> regs);
+    void EndOperation(std::span<const VRegOperand> operands, std::span<const GPR> regs);
+
+    // Extends intervals that are live into loops found within the analyzed code.
+    void ExtendAcrossLoops(ptrdiff_t begin, ptrdiff_t end);
+    void AssignRegisters();
+
+    [[nodiscard]] int32_t GetSpillSlotOffset(uint32_t slot) const noexcept;
+
+    Assembler& m_assembler;
+    std::vector<GPR> m_allocatable;
+    std::vector<GPR> m_scratch;
+    int32_t m_spill_offset;
+
+    Pass m_pass = Pass::None;
+    uint32_t m_vreg_count = 0;
+    uint32_t m_operation = 0;
+
+    // Offsets of each operation within the analyzed code.
+    std::vector<ptrdiff_t> m_operation_offsets;
+
+    std::vector<Interval> m_intervals;
+    size_t m_spill_count = 0;
+};
+
+} // namespace biscuit
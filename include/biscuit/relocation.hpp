@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace biscuit {
+
+class Label;
+
+/**
+ * Describes how the value of a relocation is stored.
+ */
+enum class RelocationKind : uint32_t {
+    /// The 13-bit PC-relative offset of a conditional branch.
+    BType,
+
+    /// The 21-bit PC-relative offset of JAL.
+    JType,
+
+    /// The 9-bit PC-relative offset of C.BEQZ and C.BNEZ.
+    CBType,
+
+    /// The 12-bit PC-relative offset of C.J and C.JAL.
+    CJType,
+
+    /**
+     * The 32-bit PC-relative offset of an AUIPC, split across the AUIPC itself
+     * (upper 20 bits) and the I-type or S-type instruction directly after it
+     * (lower 12 bits).
+     */
+    PCRelPair,
+
+    /// A 64-bit absolute address.
+    Absolute64,
+
+    /// A 32-bit offset of the target relative to the base of the jump table.
+    JumpTableEntry,
+
+    /// A 32-bit absolute address, for RV32 code.
+    Absolute32,
+};
+
+/**
+ * A record of a location within code that refers to a target.
+ *
+ * Relocations allow code to be moved (e.g. when a code cache is compacted)
+ * or persisted and reloaded elsewhere, without having to regenerate it.
+ * Everything position-dependent within the code is described by them.
+ */
+struct Relocation {
+    /// How the value is stored at the location.
+    RelocationKind kind = RelocationKind::BType;
+
+    /// The offset of the instruction or data being relocated.
+    ptrdiff_t offset = 0;
+
+    /**
+     * The label the location refers to, or null if it refers to `target` instead.
+     *
+     * Labels are referred to by pointer, so they must outlive the relocation.
+     * References to local labels (see Label::Local()) have a null label,
+     * once the label is bound.
+     */
+    const Label* label = nullptr;
+
+    /// For relocations without a label, the offset of the target within the code.
+    ptrdiff_t target = 0;
+
+    /// For jump table entries, the offset of the table the entry is relative to.
+    ptrdiff_t base = 0;
+
+    /// A constant added to the address of the target.
+    int64_t addend = 0;
+};
+
+/**
+ * Writes a value into the location described by a relocation kind.
+ *
+ * @param ptr   A pointer to the instruction or data being relocated.
+ * @param kind  How the value is stored at the location.
+ * @param value The value to write. For PC-relative kinds, this is the
+ *              offset from the instruction to its target.
+ *
+ * @note Any value already stored at the location is replaced. Instruction
+ *       bits that aren't part of the value are preserved.
+ */
+void PatchRelocation(uint8_t* ptr, RelocationKind kind, int64_t value);
+
+/**
+ * Checks whether a value can be stored in the location described by a relocation kind.
+ *
+ * @param kind  How the value would be stored at the location.
+ * @param value The value to check, as would be passed to PatchRelocation().
+ */
+[[nodiscard]] bool IsValidRelocationValue(RelocationKind kind, int64_t value) noexcept;
+
+/**
+ * Checks whether a relocation can be applied to a block of code,
+ * i.e. whether its target is within reach of its encoding.
+ *
+ * @param code_address The address the block of code will execute at.
+ * @param relocation   The relocation to check.
+ * @param target       The address of the relocation's target.
+ */
+[[nodiscard]] bool CanApplyRelocation(uintptr_t code_address, const Relocation& relocation,
+                                      uintptr_t target) noexcept;
+
+/**
+ * Applies a relocation to a block of code.
+ *
+ * @param code         A pointer to the start of the (writable) block of code.
+ * @param code_address The address the block of code will execute at.
+ * @param relocation   The relocation to apply, with an offset relative to `code`.
+ * @param target       The address of the relocation's target.
+ *
+ * @pre The target must be within reach (see CanApplyRelocation()).
+ */
+void ApplyRelocation(uint8_t* code, uintptr_t code_address,
+                     const Relocation& relocation, uintptr_t target);
+
+} // namespace biscuit
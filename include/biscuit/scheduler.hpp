@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+
+namespace biscuit {
+
+/**
+ * Classes of instructions that share the same latency and execution resources
+ * within a scheduling model.
+ */
+enum class SchedulingClass : uint32_t {
+    ALU,                 //< Integer arithmetic, logic, shifts and bit-manipulation.
+    Multiply,            //< Integer multiplication.
+    Divide,              //< Integer division and remainder.
+    Load,                //< Integer and floating-point loads.
+    Store,               //< Integer and floating-point stores.
+    FloatingPoint,       //< Floating-point arithmetic, conversions and moves.
+    FloatingPointDivide, //< Floating-point division and square roots.
+};
+
+/// The number of scheduling classes.
+constexpr size_t scheduling_class_count = static_cast<size_t>(SchedulingClass::FloatingPointDivide) + 1;
+
+/**
+ * Describes the pipeline of the core code is scheduled for.
+ *
+ * The defaults approximate a dual-issue in-order core like the SiFive U74.
+ * Other cores can be described by adjusting the tables.
+ */
+struct SchedulingModel {
+    /// The number of instructions the core may issue per cycle.
+    uint32_t issue_width = 2;
+
+    /// The number of cycles until an instruction's result can be used, indexed by SchedulingClass.
+    std::array<uint32_t, scheduling_class_count> latencies{1, 3, 20, 3, 1, 5, 20};
+
+    /**
+     * The number of instructions of each class that may issue in the same cycle,
+     * indexed by SchedulingClass. Zero means only the issue width limits them.
+     */
+    std::array<uint32_t, scheduling_class_count> units_per_cycle{0, 1, 1, 1, 1, 1, 1};
+
+    /// Gets the latency of a class of instructions.
+    [[nodiscard]] uint32_t GetLatency(SchedulingClass scheduling_class) const noexcept {
+        return latencies[static_cast<size_t>(scheduling_class)];
+    }
+
+    /// Gets the number of instructions of a class that may issue in the same cycle.
+    [[nodiscard]] uint32_t GetUnitsPerCycle(SchedulingClass scheduling_class) const noexcept {
+        const auto units = units_per_cycle[static_cast<size_t>(scheduling_class)];
+        return units == 0 ? issue_width : units;
+    }
+};
+
+/**
+ * A list scheduler for straight-line code, aimed at in-order cores.
+ *
+ * In-order cores stall whenever an instruction needs the result of one issued just
+ * before it, which is common in code like LI sequences or loads followed by their use.
+ * The scheduler reorders instructions within a basic block so that independent work
+ * fills those gaps, preferring instructions on the longest dependency chain.
+ *
+ * Code is scheduled in place after it's been emitted, so it works with any code
+ * the assembler produces. Only scalar integer and floating-point instructions
+ * are moved. Everything else stays where it is and nothing moves across it, including:
+ *
+ * - Branches, jumps and anything else PC-relative (along with the instruction
+ *   following an AUIPC), so label references and relocations stay valid.
+ * - Atomics, fences, CSR accesses and other system instructions.
+ * - Vector instructions, as they depend on the vector configuration.
+ * - Hints, NOPs and anything else writing to x0, which keeps alignment padding in place.
+ *
+ * Loads and stores keep their order relative to stores.
+ *
+ * Usually, the scheduler is attached to an assembler with Assembler::SetScheduler(),
+ * which schedules each basic block as labels are bound, but it can also be used
+ * on its own with Schedule().
+ */
+class InstructionScheduler {
+public:
+    /// The largest number of instructions considered for reordering with each other at once.
+    static constexpr size_t window_size = 64;
+
+    /**
+     * Constructor
+     *
+     * @param model The pipeline to schedule for.
+     */
+    explicit InstructionScheduler(const SchedulingModel& model = {}) noexcept
+        : m_model{model} {}
+
+    /**
+     * Schedules a basic block in place.
+     *
+     * @param code     The code to schedule. Control flow may only enter it at the start,
+     *                 but may leave it anywhere. It must consist of instructions only.
+     * @param features The architecture of the code, which determines how
+     *                 compressed instructions are decoded.
+     *
+     * @returns The number of instructions that were moved.
+     */
+    size_t Schedule(std::span<uint8_t> code, ArchFeature features = ArchFeature::RV64);
+
+    /// Gets the model being scheduled for.
+    [[nodiscard]] const SchedulingModel& GetModel() const noexcept {
+        return m_model;
+    }
+
+    /// Sets the model to schedule for.
+    void SetModel(const SchedulingModel& model) noexcept {
+        m_model = model;
+    }
+
+private:
+    struct Node {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        SchedulingClass scheduling_class{};
+        uint8_t def = 0;
+        std::array<uint8_t, 3> uses{};
+        bool is_barrier = false;
+    };
+
+    struct Edge {
+        uint8_t from = 0;
+        uint8_t to = 0;
+        uint8_t latency = 0;
+    };
+
+    // Schedules a run of movable instructions, returning how many moved.
+    size_t ScheduleWindow(uint8_t* code, std::span<const Node> nodes);
+
+    SchedulingModel m_model;
+
+    // Scratch space kept around between invocations to avoid reallocating.
+    std::vector<Node> m_nodes;
+    std::vector<Edge> m_edges;
+    std::vector<uint8_t> m_scratch;
+};
+
+} // namespace biscuit
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_buffer.hpp>
+
+namespace biscuit {
+
+/**
+ * A code region shared by multiple threads compiling code in parallel.
+ *
+ * Unlike CodeCache, which keeps track of individual allocations so they can be
+ * freed and compacted, a shared code cache only ever hands out memory by bumping
+ * an atomic offset. Allocation never takes a lock, so threads can allocate
+ * concurrently without contending on more than a single cache line. Memory is only
+ * released once the whole cache is destroyed.
+ *
+ * Threads usually don't allocate from the cache directly, but through a
+ * ThreadCodeArena each, which claims large chunks at a time and sub-allocates
+ * functions from them without any synchronization at all.
+ *
+ * Calls between functions compiled on different threads go through stubs provided
+ * by the cache. A stub is a small piece of code that jumps to whatever target
+ * it currently points at. Targets are kept in a data table next to the code rather
+ * than being encoded into the stub's instructions, so retargeting a stub is a
+ * single atomic store that never modifies code. Code can therefore call a function
+ * through its stub before that function has finished compiling, and the stub can
+ * be published once it has.
+ *
+ * Since the region is never larger than 2GiB, any two locations within it, including
+ * stubs, are always within range of each other for AUIPC-based sequences (e.g. CALL).
+ *
+ * @par
+ * An example of compiling functions in parallel:
+ *
+ * @code{.cpp}
+ * SharedCodeCache cache;
+ * const auto stub = *cache.CreateStub(resolver_address);
+ *
+ * // On each worker thread:
+ * ThreadCodeArena arena{cache};
+ * if (arena.BeginFunction(max_function_size)) {
+ *     auto& as = arena.GetAssembler();
+ *     // Emit code, calling into other functions with arena.CallStub(stub)...
+ *     const auto function = arena.EndFunction();
+ *     cache.SetStubTarget(stub, function);
+ * }
+ * @endcode
+ */
+class SharedCodeCache {
+public:
+    // Default capacity of 64MB.
+    static constexpr size_t default_capacity = 64 * 1024 * 1024;
+
+    // Largest capacity that keeps every location within AUIPC range of every other location.
+    // AUIPC pairs reach slightly less than 2GiB forward, and staying a multiple of the
+    // huge page size keeps rounding up to huge pages from going past it.
+    static constexpr size_t max_capacity = (size_t{1} << 31) - CodeBuffer::huge_page_size;
+
+    // Default number of stubs that can be created.
+    static constexpr size_t default_stub_capacity = 4096;
+
+    // Default alignment for allocations, which is enough for RISC-V fetch blocks on most cores.
+    static constexpr size_t default_alignment = 16;
+
+    // Size of a single stub's code in bytes.
+    static constexpr size_t stub_size = 16;
+
+    /// Identifies a stub created by CreateStub().
+    using StubID = uint32_t;
+
+    /**
+     * Constructor
+     *
+     * @param capacity      The size of the region to reserve in bytes, including stubs.
+     * @param stub_capacity The maximum number of stubs that can be created.
+     * @param features      The architecture stubs are emitted for.
+     * @param pages         The pages to back the region with. With huge pages, the capacity
+     *                      is rounded up to a multiple of the huge page size, and the stub
+     *                      target table occupies a huge page of its own.
+     *
+     * @pre capacity must not be larger than max_capacity, and must be
+     *      large enough to hold the stub tables.
+     */
+    explicit SharedCodeCache(size_t capacity = default_capacity,
+                             size_t stub_capacity = default_stub_capacity,
+                             ArchFeature features = ArchFeature::RV64,
+                             CodeBufferPages pages = CodeBufferPages::Default);
+
+    // Neither copying nor moving makes sense, as threads may be allocating concurrently.
+    SharedCodeCache(const SharedCodeCache&) = delete;
+    SharedCodeCache& operator=(const SharedCodeCache&) = delete;
+    SharedCodeCache(SharedCodeCache&&) = delete;
+    SharedCodeCache& operator=(SharedCodeCache&&) = delete;
+
+    /// Destructor. Releases the entire region.
+    ~SharedCodeCache() noexcept;
+
+    /**
+     * Allocates memory from the cache. Safe to call from any thread.
+     *
+     * @param size      The size of the allocation in bytes.
+     * @param alignment The alignment of the allocation. Must be a power of two.
+     *
+     * @returns An (unmanaged) code buffer over the allocation, or an empty
+     *          optional if the cache doesn't have enough space left.
+     */
+    [[nodiscard]] std::optional<CodeBuffer> Allocate(size_t size, size_t alignment = default_alignment);
+
+    /**
+     * Creates a stub that jumps to the given target. Safe to call from any thread.
+     *
+     * @param target The address the stub initially jumps to.
+     *
+     * @returns The ID of the new stub, or an empty optional if the maximum
+     *          number of stubs has already been created.
+     *
+     * @note The stub is made visible to instruction fetch before this returns, but other
+     *       threads may only call it once they've been handed the ID by this thread.
+     *
+     * @note The cache's code must be writable, as the stub's code is written out.
+     *       Creating stubs up front keeps them usable after SetExecutable().
+     */
+    [[nodiscard]] std::optional<StubID> CreateStub(uintptr_t target);
+
+    /**
+     * Retargets a stub. Safe to call from any thread, even while the stub is executing.
+     *
+     * Any hart jumping through the stub either goes to the old or the new target.
+     *
+     * @param stub   The stub to retarget.
+     * @param target The new target of the stub.
+     *
+     * @pre The new target must already be visible to instruction fetch on every hart
+     *      (e.g. through ThreadCodeArena::EndFunction() or CodeBuffer::FlushInstructionCache()).
+     */
+    void SetStubTarget(StubID stub, uintptr_t target) noexcept;
+
+    /// Gets the current target of a stub.
+    [[nodiscard]] uintptr_t GetStubTarget(StubID stub) const noexcept;
+
+    /// Gets the address of a stub's code, which is what callers of the stub should call.
+    [[nodiscard]] uintptr_t GetStubAddress(StubID stub) const noexcept;
+
+    /// Whether or not the given pointer points within the cache's region.
+    [[nodiscard]] bool Contains(const uint8_t* ptr) const noexcept {
+        return ptr >= m_region && ptr < m_region + m_capacity;
+    }
+
+    /// Returns the total capacity of the cache in bytes, including stubs.
+    [[nodiscard]] size_t GetCapacity() const noexcept { return m_capacity; }
+
+    /// Returns the number of bytes allocated so far, including stubs.
+    [[nodiscard]] size_t GetUsedBytes() const noexcept {
+        return m_next.load(std::memory_order_relaxed);
+    }
+
+    /// Returns the number of stubs created so far.
+    [[nodiscard]] size_t GetStubCount() const noexcept;
+
+    /// Returns the maximum number of stubs that can be created.
+    [[nodiscard]] size_t GetStubCapacity() const noexcept { return m_stub_capacity; }
+
+    /**
+     * Sets all code within the cache (including stubs) to be executable.
+     *
+     * The stub target table is left writable, so stubs can still be retargeted.
+     *
+     * @note This must not be called while any thread is still emitting into the
+     *       cache. Threads that keep compiling alongside executing code need to
+     *       leave the region writable (and executable) instead.
+     *
+     * @see CodeBuffer::SetExecutable()
+     */
+    void SetExecutable();
+
+    /**
+     * Sets all code within the cache (including stubs) to be writable.
+     *
+     * @see CodeBuffer::SetWritable()
+     */
+    void SetWritable();
+
+private:
+    // Gets the slot holding a stub's target.
+    [[nodiscard]] uintptr_t& GetStubSlot(StubID stub) const noexcept;
+
+    uint8_t* m_region = nullptr;
+    size_t m_capacity = 0;
+    size_t m_stub_capacity = 0;
+    ArchFeature m_features{};
+
+    // The region starts with the stub target table, followed by the stubs' code.
+    // Allocations start at the first page past it, so the table can stay writable
+    // while code is made executable.
+    uint8_t* m_stub_code = nullptr;
+    size_t m_code_start = 0;
+
+    // Kept on separate cache lines, as every allocation touches m_next
+    // and every stub creation touches m_stub_count.
+    alignas(64) std::atomic<size_t> m_next{0};
+    alignas(64) std::atomic<size_t> m_stub_count{0};
+};
+
+/**
+ * A single thread's view of a shared code cache.
+ *
+ * Claims chunks from the cache as needed and sub-allocates functions out of them,
+ * so that threads only synchronize with each other once per chunk rather than once
+ * per function. Each arena owns an assembler that emits into its current chunk.
+ *
+ * @note An arena may only be used by one thread at a time.
+ */
+class ThreadCodeArena {
+public:
+    // Default chunk size of 256KB.
+    static constexpr size_t default_chunk_size = 256 * 1024;
+
+    /**
+     * Constructor
+     *
+     * @param cache      The cache to allocate chunks from.
+     * @param chunk_size The size of the chunks claimed from the cache.
+     * @param features   The architecture of the arena's assembler.
+     */
+    explicit ThreadCodeArena(SharedCodeCache& cache, size_t chunk_size = default_chunk_size,
+                             ArchFeature features = ArchFeature::RV64);
+
+    ThreadCodeArena(const ThreadCodeArena&) = delete;
+    ThreadCodeArena& operator=(const ThreadCodeArena&) = delete;
+
+    /**
+     * Gets the assembler emitting into the arena.
+     *
+     * Settings made on it (e.g. extensions) persist across functions and chunks.
+     */
+    [[nodiscard]] Assembler& GetAssembler() noexcept { return m_assembler; }
+
+    /**
+     * Begins a new function, making sure there's enough space to emit it
+     * into the current chunk. Claims a new chunk if there isn't.
+     *
+     * @param max_size  The largest size in bytes the function may become.
+     * @param alignment The alignment of the function's start. Must be a power of two.
+     *
+     * @returns Whether or not there was enough space left. If there wasn't, there's
+     *          no function in progress, and nothing may be emitted.
+     *
+     * @pre No other function may be in progress.
+     */
+    [[nodiscard]] bool BeginFunction(size_t max_size, size_t alignment = SharedCodeCache::default_alignment);
+
+    /**
+     * Ends the function in progress, making it visible to instruction fetch.
+     *
+     * @returns The address of the start of the function.
+     *
+     * @pre All labels used within the function must be resolved.
+     */
+    uintptr_t EndFunction();
+
+    /// Emits a call to a stub of the arena's cache.
+    void CallStub(SharedCodeCache::StubID stub);
+
+    /// Emits a tail call to a stub of the arena's cache.
+    void TailStub(SharedCodeCache::StubID stub);
+
+    /// Whether or not a function is in progress.
+    [[nodiscard]] bool IsInFunction() const noexcept { return m_function_start.has_value(); }
+
+private:
+    // Gets the PC-relative offset from the cursor to a stub.
+    [[nodiscard]] int32_t GetStubOffset(SharedCodeCache::StubID stub) noexcept;
+
+    SharedCodeCache& m_cache;
+    size_t m_chunk_size;
+    Assembler m_assembler;
+    std::optional<ptrdiff_t> m_function_start;
+};
+
+} // namespace biscuit
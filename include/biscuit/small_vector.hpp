@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <biscuit/assert.hpp>
+
+namespace biscuit {
+
+/**
+ * A vector that stores up to N elements inline before
+ * falling back to a heap allocation.
+ *
+ * Intended for bookkeeping that is almost always small (e.g. the handful
+ * of references to a label), where a node or heap allocation per
+ * element would dominate the cost of the actual work.
+ *
+ * @note Only trivially copyable element types are supported, which
+ *       allows growing and moving to be done with plain memory copies.
+ */
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "SmallVector only supports trivially copyable types");
+    static_assert(N > 0, "SmallVector must have a non-zero inline capacity");
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() noexcept = default;
+
+    ~SmallVector() noexcept = default;
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    SmallVector(SmallVector&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            m_heap.reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+    [[nodiscard]] size_t capacity() const noexcept { return m_heap ? m_capacity : N; }
+
+    [[nodiscard]] T* data() noexcept { return m_heap ? m_heap.get() : m_inline; }
+    [[nodiscard]] const T* data() const noexcept { return m_heap ? m_heap.get() : m_inline; }
+
+    [[nodiscard]] iterator begin() noexcept { return data(); }
+    [[nodiscard]] iterator end() noexcept { return data() + m_size; }
+    [[nodiscard]] const_iterator begin() const noexcept { return data(); }
+    [[nodiscard]] const_iterator end() const noexcept { return data() + m_size; }
+    [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+    [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+    [[nodiscard]] T& operator[](size_t index) noexcept {
+        BISCUIT_ASSERT(index < m_size);
+        return data()[index];
+    }
+    [[nodiscard]] const T& operator[](size_t index) const noexcept {
+        BISCUIT_ASSERT(index < m_size);
+        return data()[index];
+    }
+
+    [[nodiscard]] T& back() noexcept { return (*this)[m_size - 1]; }
+    [[nodiscard]] const T& back() const noexcept { return (*this)[m_size - 1]; }
+
+    /// Appends an element to the end of the vector.
+    void push_back(const T& value) {
+        if (m_size == capacity()) {
+            Grow();
+        }
+        data()[m_size++] = value;
+    }
+
+    /// Inserts an element before the given position.
+    iterator insert(const_iterator pos, const T& value) {
+        const auto index = static_cast<size_t>(pos - begin());
+        BISCUIT_ASSERT(index <= m_size);
+
+        if (m_size == capacity()) {
+            Grow();
+        }
+
+        auto* const elements = data();
+        std::memmove(elements + index + 1, elements + index, (m_size - index) * sizeof(T));
+        elements[index] = value;
+        m_size++;
+        return elements + index;
+    }
+
+    /// Removes the last element.
+    void pop_back() noexcept {
+        BISCUIT_ASSERT(m_size != 0);
+        m_size--;
+    }
+
+    /**
+     * Removes all elements.
+     *
+     * @note Any heap storage is kept around for reuse.
+     */
+    void clear() noexcept {
+        m_size = 0;
+    }
+
+private:
+    void Grow() {
+        const auto new_capacity = capacity() * 2;
+        auto new_heap = std::make_unique_for_overwrite<T[]>(new_capacity);
+        std::memcpy(new_heap.get(), data(), m_size * sizeof(T));
+        m_heap = std::move(new_heap);
+        m_capacity = new_capacity;
+    }
+
+    void MoveFrom(SmallVector& other) noexcept {
+        m_size = std::exchange(other.m_size, size_t{0});
+        m_capacity = std::exchange(other.m_capacity, size_t{0});
+        m_heap = std::move(other.m_heap);
+
+        if (!m_heap) {
+            std::memcpy(m_inline, other.m_inline, m_size * sizeof(T));
+        }
+    }
+
+    T m_inline[N];
+    std::unique_ptr<T[]> m_heap;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
+
+} // namespace biscuit
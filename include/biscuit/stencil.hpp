@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_buffer.hpp>
+
+namespace biscuit {
+
+/**
+ * The part of an instruction that a stencil hole fills in.
+ */
+enum class StencilField : uint32_t {
+    /// The destination register (bits 11:7).
+    Rd,
+
+    /// The first source register (bits 19:15).
+    Rs1,
+
+    /// The second source register (bits 24:20).
+    Rs2,
+
+    /// The 12-bit immediate of an I-type instruction.
+    IImm,
+
+    /// The 12-bit immediate of an S-type instruction.
+    SImm,
+
+    /// The 20-bit immediate of a U-type instruction.
+    UImm,
+
+    /**
+     * The target of a branch, jump or AUIPC pair.
+     *
+     * The argument for this field is the offset of the target within the
+     * code buffer being instantiated into. The instruction is patched
+     * the same way label references are.
+     */
+    Target,
+};
+
+/**
+ * A location within a stencil that's filled in when it's instantiated.
+ */
+struct StencilHole {
+    /// Offset of the instruction containing the hole, relative to the start of the stencil.
+    uint32_t offset = 0;
+
+    /// The part of the instruction to fill in.
+    StencilField field = StencilField::Rd;
+
+    /// Index of the instantiation argument that fills in the hole.
+    uint32_t argument = 0;
+};
+
+/**
+ * A pre-assembled, relocatable sequence of code with holes in it.
+ *
+ * Instantiating a stencil copies its code and then patches every hole
+ * with its argument, which is considerably cheaper than re-running
+ * the assembler for each instruction of the sequence.
+ *
+ * Stencils are created with a StencilBuilder.
+ *
+ * @par
+ * An example of building and instantiating a stencil:
+ *
+ * @code{.cpp}
+ * StencilBuilder builder;
+ * auto& as = builder.GetAssembler();
+ *
+ * // Argument 0 is the destination, argument 1 the value to add.
+ * as.ADDI(x0, a0, 0);
+ * builder.MarkHole(StencilField::Rd, 0);
+ * builder.MarkHole(StencilField::IImm, 1);
+ * as.RET();
+ *
+ * const auto stencil = builder.Build();
+ *
+ * const std::array<int64_t, 2> args{a1.Index(), 16};
+ * stencil.Instantiate(code_buffer, args);
+ * @endcode
+ */
+class Stencil {
+public:
+    Stencil() = default;
+
+    /// Retrieves the size of the stencil's code in bytes.
+    [[nodiscard]] size_t GetSize() const noexcept {
+        return m_code.size();
+    }
+
+    /// Retrieves the number of arguments needed to instantiate the stencil.
+    [[nodiscard]] size_t GetArgumentCount() const noexcept {
+        return m_argument_count;
+    }
+
+    /// Retrieves all of the holes within the stencil.
+    [[nodiscard]] std::span<const StencilHole> GetHoles() const noexcept {
+        return m_holes;
+    }
+
+    /// Retrieves the unpatched code of the stencil.
+    [[nodiscard]] std::span<const uint8_t> GetCode() const noexcept {
+        return m_code;
+    }
+
+    /**
+     * Copies the stencil into a code buffer at its cursor and fills in its holes.
+     *
+     * @param buffer The code buffer to instantiate the stencil into.
+     * @param args   The values to fill the holes with. Register holes take
+     *               register indices, and target holes take the offset of
+     *               the target within `buffer`.
+     *
+     * @pre `args` must contain at least GetArgumentCount() values.
+     *
+     * @return The offset the stencil was instantiated at.
+     */
+    ptrdiff_t Instantiate(CodeBuffer& buffer, std::span<const int64_t> args) const;
+
+    /**
+     * Copies the stencil into an assembler's code buffer and fills in its holes.
+     *
+     * @see Instantiate(CodeBuffer&, std::span<const int64_t>)
+     */
+    ptrdiff_t Instantiate(Assembler& as, std::span<const int64_t> args) const {
+        return Instantiate(as.GetCodeBuffer(), args);
+    }
+
+private:
+    friend class StencilBuilder;
+
+    std::vector<uint8_t> m_code;
+    std::vector<StencilHole> m_holes;
+    size_t m_argument_count = 0;
+};
+
+/**
+ * Records a sequence of code into a Stencil.
+ *
+ * Code is emitted through the builder's assembler as usual, using any
+ * placeholder for operands that are to become holes. Labels may be used
+ * freely within the sequence, as long as they're all bound by the time
+ * the stencil is built.
+ *
+ * @note Branch relaxation and the literal pool shouldn't be enabled on the
+ *       builder's assembler, since they can move code after holes are marked.
+ */
+class StencilBuilder {
+public:
+    /**
+     * Constructor
+     *
+     * @param features Architectural features to assemble the stencil for.
+     */
+    explicit StencilBuilder(ArchFeature features = ArchFeature::RV64);
+
+    /// Retrieves the assembler to record code with.
+    [[nodiscard]] Assembler& GetAssembler() noexcept {
+        return m_assembler;
+    }
+
+    /**
+     * Marks a part of the most recently emitted instruction as a hole.
+     *
+     * The instruction is assumed to be a 32-bit instruction ending at the cursor.
+     *
+     * @param field    The part of the instruction to turn into a hole.
+     * @param argument The index of the instantiation argument that fills it in.
+     *
+     * @note Target holes within compressed branches and jumps have to be
+     *       marked with the offset-based overload instead.
+     */
+    void MarkHole(StencilField field, uint32_t argument);
+
+    /**
+     * Marks a part of an instruction at a given offset as a hole.
+     *
+     * @param offset   The offset of the instruction from the start of the stencil.
+     * @param field    The part of the instruction to turn into a hole.
+     * @param argument The index of the instantiation argument that fills it in.
+     *
+     * @note Only target holes may refer to compressed instructions.
+     */
+    void MarkHole(ptrdiff_t offset, StencilField field, uint32_t argument);
+
+    /**
+     * Creates a stencil out of everything recorded so far.
+     *
+     * @pre Every label referenced by the recorded code must be bound, since
+     *      references to it would otherwise be left unpatched in the stencil.
+     * @pre None of the recorded code may have been released with
+     *      CodeBuffer::ReleaseBefore(), since holes are recorded as offsets
+     *      from the start of the buffer.
+     *
+     * @note The builder may continue to be used afterwards. Any stencils built
+     *       later on will contain everything recorded before them as well.
+     */
+    [[nodiscard]] Stencil Build();
+
+private:
+    Assembler m_assembler;
+    std::vector<StencilHole> m_holes;
+};
+
+} // namespace biscuit
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/label.hpp>
+#include <biscuit/registers.hpp>
+
+namespace biscuit {
+
+/**
+ * How a switch dispatches to its cases.
+ */
+enum class SwitchStrategy : uint32_t {
+    /**
+     * Picks JumpTable if the cases are dense enough for the table to stay
+     * small, and BinarySearch otherwise. BinarySearch is always picked while
+     * branch relaxation is enabled (see Assembler::SetBranchRelaxation()).
+     */
+    Auto,
+
+    /**
+     * A bounds check followed by an indirect jump through a table of 32-bit
+     * offsets, indexed by the value. Dispatch takes constant time, with the
+     * table taking up 4 bytes for every value between the lowest and highest case.
+     *
+     * Can't be used with branch relaxation, since the table's entries are data
+     * that wouldn't be adjusted when relaxation moves code.
+     */
+    JumpTable,
+
+    /**
+     * A balanced tree of compare-and-branch sequences over the sorted cases, taking
+     * a logarithmic number of branches. Small ranges of cases fall back to a linear
+     * chain of comparisons at the leaves of the tree.
+     */
+    BinarySearch,
+};
+
+/**
+ * Lowers a switch over an integer value into efficient dispatch code.
+ *
+ * Cases are collected first, after which Emit() picks a strategy based on how
+ * densely they cover the range of values between the lowest and highest case.
+ *
+ * @par
+ * An example of dispatching on an opcode:
+ *
+ * @code{.cpp}
+ * Label add, sub, mul, unknown;
+ * SwitchBuilder builder{&unknown};
+ * builder.AddCase(0x00, &add);
+ * builder.AddCase(0x01, &sub);
+ * builder.AddCase(0x02, &mul);
+ *
+ * builder.Emit(as, a0, t0, t1);
+ * as.Bind(&add);
+ * ...
+ * @endcode
+ *
+ * @note Jump tables are emitted inline, directly after the indirect jump, and hold
+ *       offsets relative to the table. They're recorded as relocations like any other
+ *       data reference (see RelocationKind::JumpTableEntry), but don't need to be
+ *       adjusted if the code buffer is moved, since they're position-independent.
+ */
+class SwitchBuilder {
+public:
+    /// The smallest number of cases Auto picks a jump table for.
+    static constexpr size_t min_table_cases = 4;
+
+    /**
+     * The largest number of entries Auto picks a jump table for, per case.
+     * e.g. With 3, at least a third of a table's entries correspond to cases.
+     */
+    static constexpr size_t max_table_entries_per_case = 3;
+
+    /// The largest number of entries a jump table may have.
+    static constexpr size_t max_table_entries = 1U << 16;
+
+    /// The largest number of cases compared one after the other at the leaves of a binary search.
+    static constexpr size_t linear_search_cases = 3;
+
+    /**
+     * Constructor
+     *
+     * @param default_target The label to jump to when the value doesn't match any case.
+     */
+    explicit SwitchBuilder(Label* default_target);
+
+    // The assembler holds onto the table's label while it's unbound.
+    SwitchBuilder(const SwitchBuilder&) = delete;
+    SwitchBuilder& operator=(const SwitchBuilder&) = delete;
+    SwitchBuilder(SwitchBuilder&&) = delete;
+    SwitchBuilder& operator=(SwitchBuilder&&) = delete;
+
+    /**
+     * Adds a case to the switch.
+     *
+     * @param value  The value of the case. Each value may only be added once.
+     * @param target The label to jump to when the switch's value matches.
+     */
+    void AddCase(int64_t value, Label* target);
+
+    /// Gets the strategy Auto resolves to for the current set of cases.
+    [[nodiscard]] SwitchStrategy PickStrategy() const noexcept;
+
+    /**
+     * Emits the dispatch code at the cursor.
+     *
+     * @param as       The assembler to emit the code with.
+     * @param value    The register holding the value to dispatch on. It's left unmodified.
+     * @param scratch1 A register that may be clobbered.
+     * @param scratch2 A register that may be clobbered. Only jump tables make use of it.
+     * @param strategy The strategy to use.
+     *
+     * @returns The strategy used, with Auto resolved.
+     *
+     * @note Values are compared as signed XLEN-wide integers, so on RV32
+     *       case values must fit within 32 bits.
+     *
+     * @pre With branch relaxation enabled, the strategy must not be JumpTable.
+     *
+     * @note Control flow never falls through the emitted code, since the jump table
+     *       that may follow the dispatch code is data.
+     *
+     * @pre Emit() may only be called once per builder.
+     */
+    SwitchStrategy Emit(Assembler& as, GPR value, GPR scratch1, GPR scratch2,
+                        SwitchStrategy strategy = SwitchStrategy::Auto);
+
+    /// Gets the number of cases added.
+    [[nodiscard]] size_t GetCaseCount() const noexcept {
+        return m_cases.size();
+    }
+
+    /// Gets the label bound to the start of the jump table, if one was emitted.
+    [[nodiscard]] Label* GetTableLabel() noexcept {
+        return &m_table;
+    }
+
+private:
+    struct Case {
+        int64_t value;
+        Label* target;
+    };
+
+    // Gets the number of table entries needed to cover all cases.
+    [[nodiscard]] uint64_t GetRange() const noexcept;
+
+    void EmitJumpTable(Assembler& as, GPR value, GPR scratch1, GPR scratch2);
+    void EmitBinarySearch(Assembler& as, GPR value, GPR scratch, std::span<const Case> cases);
+
+    // Loads a case value into scratch, returning the register to compare against.
+    static GPR LoadCaseValue(Assembler& as, GPR scratch, int64_t value);
+
+    Label* m_default;
+    Label m_table = Label::Local();
+    std::vector<Case> m_cases;
+};
+
+} // namespace biscuit
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <biscuit/cpuinfo.hpp>
+#include <biscuit/scheduler.hpp>
+#include <biscuit/vector.hpp>
+
+namespace biscuit {
+
+/**
+ * Pairs of adjacent instructions a core fuses into a single operation.
+ *
+ * These are bit flags, and may be combined within TuningModel::fusions.
+ */
+enum class Fusion : uint32_t {
+    /// LUI followed by an ADDI(W) of the same register, as emitted by LI.
+    LuiAddi = 1U << 0,
+
+    /// AUIPC followed by an ADDI of the same register, as emitted by LA.
+    AuipcAddi = 1U << 1,
+
+    /// AUIPC followed by a JALR through the same register, as emitted by CALL and TAIL.
+    AuipcJalr = 1U << 2,
+
+    /// SLLI followed by an SRLI of the same register, zero-extending it.
+    ShiftZeroExtend = 1U << 3,
+
+    /**
+     * A conditional branch over a single ALU instruction, which is executed
+     * as a predicated instruction rather than predicted like a branch.
+     */
+    ShortForwardBranch = 1U << 4,
+};
+
+/**
+ * Describes the microarchitecture code is tuned for.
+ *
+ * Macro-ops that have several equivalent lowerings consult the model attached
+ * to the assembler (see Assembler::SetTuningModel()) to pick the cheapest one.
+ * Presets for common cores are available through GetTuningModel(), and the
+ * host's can be picked with GetHostTuningModel().
+ *
+ * The defaults describe no core in particular: the generic scheduling model,
+ * no fusion, and no vector unit.
+ */
+struct TuningModel {
+    /// A short name for the core, for diagnostics.
+    const char* name = "generic";
+
+    /// Instruction latencies and throughputs, for use with InstructionScheduler.
+    SchedulingModel scheduling;
+
+    /// The Fusion pairs the core supports, combined as bit flags.
+    uint32_t fusions = 0;
+
+    /// How the core handles misaligned scalar memory accesses.
+    MisalignedAccess misaligned_access = MisalignedAccess::Unknown;
+
+    /// The vector register length in bytes, or 0 if the core has no vector unit.
+    uint32_t vlenb = 0;
+
+    /**
+     * The largest register group multiplier worth using. Cores that crack
+     * register groups into one operation per register gain little from
+     * larger groups beyond the registers they tie up.
+     */
+    LMUL preferred_lmul = LMUL::M1;
+
+    /// Checks whether the core fuses a pair of instructions.
+    [[nodiscard]] bool HasFusion(Fusion fusion) const noexcept {
+        return (fusions & static_cast<uint32_t>(fusion)) != 0;
+    }
+
+    /// Checks whether misaligned scalar accesses are known to be as fast as aligned ones.
+    [[nodiscard]] bool HasFastMisalignedAccess() const noexcept {
+        return misaligned_access == MisalignedAccess::Fast;
+    }
+};
+
+/**
+ * Cores with a TuningModel preset.
+ */
+enum class TuningCore : uint32_t {
+    Generic,     //< No core in particular. The default TuningModel.
+    SiFiveU74,   //< SiFive U74, a dual-issue in-order core (e.g. in the JH7110).
+    SiFiveP670,  //< SiFive P670, an out-of-order core with a 128-bit vector unit.
+    THeadC910,   //< T-Head C910, a triple-issue out-of-order core (e.g. in the TH1520).
+    THeadC920,   //< T-Head C920, the C910 with a 128-bit vector unit (e.g. in the SG2042).
+    SpacemiTX60, //< SpacemiT X60, a dual-issue in-order core with a 256-bit vector unit (e.g. in the K1).
+};
+
+/**
+ * Retrieves the preset model of a core.
+ *
+ * @note The latencies and throughputs are approximations taken
+ *       from public documentation and measurements, not exact figures.
+ */
+[[nodiscard]] const TuningModel& GetTuningModel(TuningCore core) noexcept;
+
+/**
+ * Identifies the core described by a CPU snapshot from its mvendorid,
+ * marchid and mimpid values (e.g. from CPUInfo::GetSnapshot()).
+ *
+ * @returns TuningCore::Generic if the core isn't recognized.
+ *
+ * @note Cores that don't report a distinct marchid can't be told apart this way.
+ *       T-Head's C910 and C920 both report zero, so the vector length is used
+ *       to tell them apart, and SiFive's P670 isn't recognized at all.
+ */
+[[nodiscard]] TuningCore IdentifyTuningCore(const CPUSnapshot& snapshot) noexcept;
+
+/**
+ * Builds the model for the core described by a CPU snapshot.
+ *
+ * This is the preset of the identified core (see IdentifyTuningCore()), with the
+ * vector length taken from the snapshot, and the misaligned access speed too if it's
+ * known. Both vary between chips built around the same core, and a vector unit
+ * can only be used if the kernel reports it.
+ *
+ * @param snapshot The CPU to describe, e.g. from CPUInfo::GetSnapshot().
+ */
+[[nodiscard]] TuningModel GetHostTuningModel(const CPUSnapshot& snapshot) noexcept;
+
+/**
+ * Picks the register group multiplier for a strip-mined loop on a core.
+ *
+ * This is ChooseLoopLMUL() with the core's vector length, limited
+ * to the core's preferred multiplier. Fractional preferences are treated as
+ * LMUL::M1, since they wouldn't free up any registers.
+ *
+ * @param model          The core to pick the multiplier for.
+ * @param sew            The element width of the loop.
+ * @param live_groups    The number of register groups the loop body needs at once.
+ * @param typical_count  The typical number of elements processed, or 0 if unknown.
+ */
+[[nodiscard]] LMUL ChooseLoopLMUL(const TuningModel& model, SEW sew, uint32_t live_groups,
+                                  size_t typical_count = 0) noexcept;
+
+} // namespace biscuit
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/registers.hpp>
+#include <biscuit/small_vector.hpp>
+#include <biscuit/vector.hpp>
+
+namespace biscuit {
+
+/**
+ * Picks the register group multiplier for a strip-mined loop.
+ *
+ * The largest multiplier that leaves enough vector registers for every group the
+ * loop body keeps live is chosen, since that processes the most elements per iteration.
+ * If the typical number of elements is known, the multiplier is reduced for as long as
+ * a single iteration still covers all of them, as larger groups don't speed up loops
+ * that only iterate once.
+ *
+ * @param vlenb          The vector register length in bytes (e.g. from CPUInfo::GetVlenb()).
+ * @param sew            The element width of the loop.
+ * @param live_groups    The number of register groups the loop body needs at once.
+ * @param typical_count  The typical number of elements processed, or 0 if unknown.
+ *
+ * @returns LMUL::M1 if the length is 0 (i.e. the host has no vector unit).
+ *
+ * @note v0 is kept free, since it's the only register that can hold masks.
+ */
+[[nodiscard]] LMUL ChooseLoopLMUL(uint32_t vlenb, SEW sew, uint32_t live_groups,
+                                  size_t typical_count = 0) noexcept;
+
+/**
+ * Emits the canonical vector-length-agnostic (strip-mined) loop:
+ *
+ * @code
+ * loop:
+ *     vsetvli vl, count, sew, lmul, ta, ma
+ *     <body>
+ *     sub     count, count, vl
+ *     <advance each pointer by vl elements>
+ *     bnez    count, loop
+ * @endcode
+ *
+ * Pointers are advanced with SH1ADD/SH2ADD/SH3ADD when Zba is part of the
+ * assembler's extension set, and with a shift into the scratch register
+ * followed by an ADD otherwise. A count of zero is handled without a separate
+ * check, since VSETVLI then sets vl to zero.
+ *
+ * @par
+ * An example of a memcpy kernel:
+ *
+ * @code{.cpp}
+ * VectorLoopBuilder loop{as, SEW::E8, LMUL::M8};
+ * loop.AddPointer(a0);
+ * loop.AddPointer(a1);
+ * loop.Emit(a2, t0, t1, [](Assembler& as, GPR) {
+ *     as.VLE8(v8, a1);
+ *     as.VSE8(v8, a0);
+ * });
+ * @endcode
+ */
+class VectorLoopBuilder {
+public:
+    /// Emits the body of the loop. It's given the register holding vl.
+    using Body = std::function<void(Assembler&, GPR)>;
+
+    /**
+     * Constructor
+     *
+     * @param as   The assembler to emit the loop with.
+     * @param sew  The element width the loop processes.
+     * @param lmul The register group multiplier to process elements with.
+     */
+    VectorLoopBuilder(Assembler& as, SEW sew, LMUL lmul = LMUL::M1) noexcept
+        : m_assembler{as}, m_sew{sew}, m_lmul{lmul} {}
+
+    /**
+     * Sets the tail and mask policies of the loop.
+     *
+     * Both are agnostic by default, which leaves hardware free to
+     * avoid preserving elements the loop doesn't care about.
+     */
+    void SetPolicy(VTA vta, VMA vma) noexcept {
+        m_vta = vta;
+        m_vma = vma;
+    }
+
+    /**
+     * Adds a pointer that's advanced past the elements processed by each iteration.
+     *
+     * @param reg           The register holding the pointer.
+     * @param element_width The width of the elements the pointer walks over. This only
+     *                      differs from the loop's element width in widening or
+     *                      narrowing loops.
+     *
+     * @pre reg must not already have been added as a pointer.
+     */
+    void AddPointer(GPR reg, SEW element_width);
+
+    /// Adds a pointer that walks over elements of the loop's element width.
+    void AddPointer(GPR reg) {
+        AddPointer(reg, m_sew);
+    }
+
+    /**
+     * Emits the loop.
+     *
+     * @param count   The register holding the number of elements to process.
+     *                It's zero once the loop finishes.
+     * @param vl      The register to hold the number of elements processed by each iteration.
+     * @param scratch A register to clobber while advancing pointers. It's only needed
+     *                if Zba isn't available and a pointer walks over elements
+     *                wider than a byte.
+     * @param body    Emits the body of the loop.
+     *
+     * @pre count, vl, scratch and the pointers must all be distinct registers.
+     */
+    void Emit(GPR count, GPR vl, GPR scratch, const Body& body);
+
+private:
+    struct Pointer {
+        GPR reg = x0;
+        uint32_t shift = 0;
+    };
+
+    Assembler& m_assembler;
+    SEW m_sew;
+    LMUL m_lmul;
+    VTA m_vta = VTA::Yes;
+    VMA m_vma = VMA::Yes;
+    SmallVector<Pointer, 4> m_pointers;
+};
+
+} // namespace biscuit
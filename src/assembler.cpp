@@ -1,6 +1,11 @@
 #include <biscuit/assert.hpp>
 #include <biscuit/assembler.hpp>
+#include <biscuit/emission_stats.hpp>
+#include <biscuit/scheduler.hpp>
+#include <biscuit/tuning.hpp>
 
+#include <algorithm>
+#include <array>
 #include <bit>
 #include <cstring>
 #include <utility>
@@ -8,6 +13,42 @@
 #include "assembler_util.hpp"
 
 namespace biscuit {
+namespace {
+// Determines the number of bytes needed to align an address to the given boundary.
+size_t GetPaddingSize(uintptr_t address, size_t alignment) noexcept {
+    return static_cast<size_t>(-address) & (alignment - 1);
+}
+
+// Emits padding of the given size.
+void EmitPadding(CodeBuffer& buffer, size_t size, AlignFill fill) noexcept {
+    if (fill == AlignFill::Zero) {
+        for (size_t i = 0; i < size; i++) {
+            buffer.Emit(uint8_t{0});
+        }
+        return;
+    }
+
+    // Anything other than a multiple of 4 bytes is only possible after compressed
+    // instructions, so the remainder goes first to keep the NOPs after it aligned.
+    BISCUIT_ASSERT(size % 2 == 0);
+    if (size % 4 != 0) {
+        buffer.Emit16(0x0001);
+        size -= 2;
+    }
+    for (; size != 0; size -= 4) {
+        buffer.Emit32(enc::NOP());
+    }
+}
+
+// Patches a data reference in relative to its own location, since
+// the start of the buffer may have been released.
+void ApplyDataReference(CodeBuffer& buffer, const Relocation& ref, uintptr_t target) {
+    auto local = ref;
+    local.offset = 0;
+    local.base = ref.base - ref.offset;
+    ApplyRelocation(buffer.GetOffsetPointer(ref.offset), buffer.GetOffsetAddress(ref.offset), local, target);
+}
+} // Anonymous namespace
 
 Assembler::Assembler(size_t capacity)
     : m_buffer(capacity) {}
@@ -22,111 +63,240 @@ CodeBuffer& Assembler::GetCodeBuffer() {
 }
 
 CodeBuffer Assembler::SwapCodeBuffer(CodeBuffer&& buffer) noexcept {
-    return std::exchange(m_buffer, std::move(buffer));
+    // Code in the new buffer may be reached with any vector configuration.
+    InvalidateVTypeState();
+    FlushSchedule();
+    DiscardRelaxedRefs(0);
+    DiscardLiterals(0);
+    DiscardRelocations(0);
+    m_unresolved_refs.clear();
+
+    auto old_buffer = std::exchange(m_buffer, std::move(buffer));
+    SkipSchedule();
+    return old_buffer;
+}
+
+void Assembler::RewindBuffer(ptrdiff_t offset) {
+    InvalidateVTypeState();
+    m_buffer.RewindCursor(offset);
+    m_schedule_start = std::min(m_schedule_start, offset);
+    DiscardRelaxedRefs(offset);
+    DiscardLiterals(offset);
+    DiscardRelocations(offset);
+
+    // References from discarded code are gone, so labels with
+    // nothing but those can't hold anything up anymore.
+    m_unresolved_refs.erase(std::lower_bound(m_unresolved_refs.begin(), m_unresolved_refs.end(), offset),
+                            m_unresolved_refs.end());
+
+    if (offset == 0) {
+        ReleaseLabels();
+    }
+}
+
+void Assembler::Reset() noexcept {
+    InvalidateVTypeState();
+    m_buffer.Reset();
+
+    // Everything is discarded, so containers are cleared in place to keep their storage.
+    m_relaxed_refs.clear();
+    m_relax_shifts.clear();
+    m_relax_aligns.clear();
+    m_relax_pending = 0;
+
+    for (auto& literal : m_literals) {
+        literal.label.Reset();
+    }
+    m_literals.clear();
+    m_literal_indices.clear();
+    m_literals_first_pending = 0;
+    m_literals_first_ref = 0;
+
+    m_cold_blocks.clear();
+    m_schedule_start = 0;
+
+    m_relocations.clear();
+    m_pending_data_refs.clear();
+    m_unresolved_refs.clear();
+
+    ReleaseLabels();
+
+#ifdef BISCUIT_EMISSION_STATS
+    if (auto* const stats = m_buffer.GetEmissionStats(); stats != nullptr) {
+        stats->Reset();
+    }
+#endif
 }
 
 void Assembler::Bind(Label* label) {
     BindToOffset(label, m_buffer.GetCursorOffset());
 }
 
-void Assembler::ADD(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b000, rd, 0b0110011);
+void Assembler::Align(size_t alignment, AlignFill fill) {
+    BISCUIT_ASSERT(std::has_single_bit(alignment));
+
+    const auto offset = m_buffer.GetCursorOffset();
+    const auto size = GetPaddingSize(m_buffer.GetCursorAddress(), alignment);
+    EmitPadding(m_buffer, size, fill);
+
+    // Relaxing a pending reference moves everything after it,
+    // so the padding has to be adjusted whenever that happens.
+    if (m_relax_branches && m_relax_pending != 0) {
+        m_relax_aligns.push_back({
+            .offset = offset,
+            .size = size,
+            .alignment = alignment,
+            .fill = fill,
+        });
+    }
+}
+
+void Assembler::BindAligned(Label* label, size_t alignment, AlignFill fill) {
+    Align(alignment, fill);
+    Bind(label);
 }
 
-void Assembler::ADDI(GPR rd, GPR rs, int32_t imm) noexcept {
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b000, rd, 0b0010011);
+Label* Assembler::NewLabel() {
+    const auto block = m_label_count / label_block_size;
+    const auto index = m_label_count % label_block_size;
+
+    if (block == m_label_blocks.size()) {
+        m_label_blocks.push_back(std::make_unique<Label[]>(label_block_size));
+    }
+
+    m_label_count++;
+    return &m_label_blocks[block][index];
 }
 
-void Assembler::AND(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b111, rd, 0b0110011);
+void Assembler::ReleaseLabels() noexcept {
+    for (size_t i = 0; i < m_label_count; i++) {
+        auto& label = m_label_blocks[i / label_block_size][i % label_block_size];
+        if (label.IsUnresolved()) {
+            SyncLabel(&label);
+            UntrackLabelOffsets(&label);
+        }
+        label.Reset();
+    }
+    m_label_count = 0;
 }
 
-void Assembler::ANDI(GPR rd, GPR rs, uint32_t imm) noexcept {
-    EmitIType(m_buffer, imm, rs, 0b111, rd, 0b0010011);
+void Assembler::SetBranchRelaxation(bool enabled, GPR scratch) noexcept {
+    BISCUIT_ASSERT(!enabled || !m_record_relocations);
+    BISCUIT_ASSERT(!enabled || !m_patchable_slots);
+    m_relax_branches = enabled;
+    m_relax_scratch = scratch;
 }
 
-void Assembler::AUIPC(GPR rd, int32_t imm) noexcept {
-    EmitUType(m_buffer, static_cast<uint32_t>(imm), rd, 0b0010111);
+Label::Location Assembler::GetLabelLocation(Label* label) noexcept {
+    BISCUIT_ASSERT(label != nullptr);
+    SyncLabel(label);
+    return label->GetLocation();
 }
 
 void Assembler::BEQ(GPR rs1, GPR rs2, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    if (m_relax_branches) {
+        EmitRelaxedBranch(0b000, rs1, rs2, label);
+        return;
+    }
+
+    AlignPatchSlot();
+    const auto address = LinkAndGetOffset(label, RelocationKind::BType);
     BEQ(rs1, rs2, static_cast<int32_t>(address));
 }
 
 void Assembler::BEQZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BEQZ(rs, static_cast<int32_t>(address));
+    BEQ(rs, x0, label);
 }
 
 void Assembler::BGE(GPR rs1, GPR rs2, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    if (m_relax_branches) {
+        EmitRelaxedBranch(0b101, rs1, rs2, label);
+        return;
+    }
+
+    AlignPatchSlot();
+    const auto address = LinkAndGetOffset(label, RelocationKind::BType);
     BGE(rs1, rs2, static_cast<int32_t>(address));
 }
 
 void Assembler::BGEU(GPR rs1, GPR rs2, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    if (m_relax_branches) {
+        EmitRelaxedBranch(0b111, rs1, rs2, label);
+        return;
+    }
+
+    AlignPatchSlot();
+    const auto address = LinkAndGetOffset(label, RelocationKind::BType);
     BGEU(rs1, rs2, static_cast<int32_t>(address));
 }
 
 void Assembler::BGEZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BGEZ(rs, static_cast<int32_t>(address));
+    BGE(rs, x0, label);
 }
 
 void Assembler::BGT(GPR rs, GPR rt, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BGT(rs, rt, static_cast<int32_t>(address));
+    BLT(rt, rs, label);
 }
 
 void Assembler::BGTU(GPR rs, GPR rt, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BGTU(rs, rt, static_cast<int32_t>(address));
+    BLTU(rt, rs, label);
 }
 
 void Assembler::BGTZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BGTZ(rs, static_cast<int32_t>(address));
+    BLT(x0, rs, label);
 }
 
 void Assembler::BLE(GPR rs, GPR rt, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BLE(rs, rt, static_cast<int32_t>(address));
+    BGE(rt, rs, label);
 }
 
 void Assembler::BLEU(GPR rs, GPR rt, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BLEU(rs, rt, static_cast<int32_t>(address));
+    BGEU(rt, rs, label);
 }
 
 void Assembler::BLEZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BLEZ(rs, static_cast<int32_t>(address));
+    BGE(x0, rs, label);
 }
 
 void Assembler::BLT(GPR rs1, GPR rs2, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    if (m_relax_branches) {
+        EmitRelaxedBranch(0b100, rs1, rs2, label);
+        return;
+    }
+
+    AlignPatchSlot();
+    const auto address = LinkAndGetOffset(label, RelocationKind::BType);
     BLT(rs1, rs2, static_cast<int32_t>(address));
 }
 
 void Assembler::BLTU(GPR rs1, GPR rs2, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    if (m_relax_branches) {
+        EmitRelaxedBranch(0b110, rs1, rs2, label);
+        return;
+    }
+
+    AlignPatchSlot();
+    const auto address = LinkAndGetOffset(label, RelocationKind::BType);
     BLTU(rs1, rs2, static_cast<int32_t>(address));
 }
 
 void Assembler::BLTZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BLTZ(rs, static_cast<int32_t>(address));
+    BLT(rs, x0, label);
 }
 
 void Assembler::BNE(GPR rs1, GPR rs2, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    if (m_relax_branches) {
+        EmitRelaxedBranch(0b001, rs1, rs2, label);
+        return;
+    }
+
+    AlignPatchSlot();
+    const auto address = LinkAndGetOffset(label, RelocationKind::BType);
     BNE(rs1, rs2, static_cast<int32_t>(address));
 }
 
 void Assembler::BNEZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BNEZ(rs, static_cast<int32_t>(address));
+    BNE(x0, rs, label);
 }
 
 void Assembler::BEQ(GPR rs1, GPR rs2, int32_t imm) noexcept {
@@ -199,19 +369,18 @@ void Assembler::BNEZ(GPR rs, int32_t imm) noexcept {
     BNE(x0, rs, imm);
 }
 
-void Assembler::CALL(int32_t offset) noexcept {
-    const auto uimm = static_cast<uint32_t>(offset);
-    const auto lower = uimm & 0xFFF;
-    const auto upper = (uimm & 0xFFFFF000) >> 12;
-    const auto needs_increment = (uimm & 0x800) != 0;
+void Assembler::CALL(Label* label) noexcept {
+    AlignPatchSlot();
+    CALL(LinkAndGetPCRelOffset(label));
+}
 
-    // Sign-extend the lower portion if the MSB of it is set.
-    const auto new_lower = needs_increment ? static_cast<int32_t>(lower << 20) >> 20
-                                           : static_cast<int32_t>(lower);
-    const auto new_upper = needs_increment ? upper + 1 : upper;
+void Assembler::CALL(int32_t offset) noexcept {
+    InvalidateVTypeState();
+    AUIPC(x1, static_cast<int32_t>(GetPCRelHi20(offset)));
 
-    AUIPC(x1, static_cast<int32_t>(new_upper));
-    JALR(x1, new_lower, x1);
+    // The second instruction of a PC-relative pair is never compressed, so that
+    // it stays in place for relocations and RetargetCall() to patch.
+    m_buffer.Emit32(enc::JALR(x1, GetPCRelLo12(offset), x1));
 }
 
 void Assembler::EBREAK() noexcept {
@@ -219,6 +388,7 @@ void Assembler::EBREAK() noexcept {
 }
 
 void Assembler::ECALL() noexcept {
+    InvalidateVTypeState();
     m_buffer.Emit32(0x00000073);
 }
 
@@ -239,19 +409,22 @@ void Assembler::FENCETSO() noexcept {
 }
 
 void Assembler::J(Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BISCUIT_ASSERT(IsValidJTypeImm(address));
-    J(static_cast<int32_t>(address));
+    JAL(x0, label);
 }
 
 void Assembler::JAL(Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
-    BISCUIT_ASSERT(IsValidJTypeImm(address));
-    JAL(static_cast<int32_t>(address));
+    JAL(x1, label);
 }
 
 void Assembler::JAL(GPR rd, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    InvalidateVTypeState();
+    if (m_relax_branches) {
+        EmitRelaxedJump(rd, label);
+        return;
+    }
+
+    AlignPatchSlot();
+    const auto address = LinkAndGetOffset(label, RelocationKind::JType);
     BISCUIT_ASSERT(IsValidJTypeImm(address));
     JAL(rd, static_cast<int32_t>(address));
 }
@@ -263,11 +436,13 @@ void Assembler::J(int32_t imm) noexcept {
 
 void Assembler::JAL(int32_t imm) noexcept {
     BISCUIT_ASSERT(IsValidJTypeImm(imm));
+    InvalidateVTypeState();
     EmitJType(m_buffer, static_cast<uint32_t>(imm), x1, 0b1101111);
 }
 
 void Assembler::JAL(GPR rd, int32_t imm) noexcept {
     BISCUIT_ASSERT(IsValidJTypeImm(imm));
+    InvalidateVTypeState();
     EmitJType(m_buffer, static_cast<uint32_t>(imm), rd, 0b1101111);
 }
 
@@ -277,270 +452,491 @@ void Assembler::JALR(GPR rs) noexcept {
 
 void Assembler::JALR(GPR rd, int32_t imm, GPR rs1) noexcept {
     BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs1, 0b000, rd, 0b1100111);
+    InvalidateVTypeState();
+    EmitCompressible(EncodeIType(static_cast<uint32_t>(imm), rs1, 0b000, rd, 0b1100111));
 }
 
 void Assembler::JR(GPR rs) noexcept {
     JALR(x0, 0, rs);
 }
 
-void Assembler::LB(GPR rd, int32_t imm, GPR rs) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b000, rd, 0b0000011);
-}
+namespace {
+// Instructions that LI makes use of when materializing a constant.
+enum class LIOp : uint32_t {
+    LUI,
+    ADDI,
+    ADDIW,
+    SLLI,
+    SRLI,
+    ADDUW,  // Zba, as ZEXT.W
+    SH1ADD, // Zba, multiplying by 3
+    SH2ADD, // Zba, multiplying by 5
+    SH3ADD, // Zba, multiplying by 9
+    RORI,   // Zbb
+    BSETI,  // Zbs
+    BCLRI,  // Zbs
+};
+
+// A single instruction within a constant materialization sequence.
+struct LIStep {
+    LIOp op;
+    int32_t imm;
+};
+
+// The instructions needed to materialize a constant. The first instruction
+// operates on x0 (or doesn't read a source at all), and every following
+// instruction operates on the result of the previous one.
+struct LISequence {
+    // The longest sequence the base ISA ever needs. Candidates that
+    // don't fit are never going to be the cheapest option anyway.
+    std::array<LIStep, 8> steps{};
+    size_t size = 0;
+    bool overflowed = false;
+
+    void Add(LIOp op, int32_t imm) noexcept {
+        if (size == steps.size()) {
+            overflowed = true;
+            return;
+        }
+        steps[size++] = LIStep{op, imm};
+    }
+};
 
-void Assembler::LBU(GPR rd, int32_t imm, GPR rs) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b100, rd, 0b0000011);
-}
+void GenerateLI32(LISequence& seq, uint32_t imm) noexcept {
+    // Depending on imm, the following instructions are emitted.
+    // hi20 == 0              -> ADDI
+    // lo12 == 0 && hi20 != 0 -> LUI
+    // otherwise              -> LUI+ADDI
 
-void Assembler::LH(GPR rd, int32_t imm, GPR rs) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b001, rd, 0b0000011);
-}
+    // Add 0x800 to cancel out the signed extension of ADDI.
+    const auto hi20 = (imm + 0x800) >> 12 & 0xFFFFF;
+    const auto lo12 = static_cast<int32_t>(imm << 20) >> 20;
 
-void Assembler::LHU(GPR rd, int32_t imm, GPR rs) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b101, rd, 0b0000011);
+    if (hi20 != 0) {
+        seq.Add(LIOp::LUI, static_cast<int32_t>(hi20));
+    }
+
+    if (lo12 != 0 || hi20 == 0) {
+        seq.Add(LIOp::ADDI, lo12);
+    }
 }
 
-void Assembler::LI(GPR rd, uint64_t imm) noexcept {
-    if (IsRV32(m_features)) {
+void GenerateLI64(LISequence& seq, uint64_t imm) noexcept {
+    // For 64-bit imm, a sequence of up to 8 instructions (i.e. LUI+ADDIW+SLLI+
+    // ADDI+SLLI+ADDI+SLLI+ADDI) is generated.
+    // In the following, imm is processed from LSB to MSB while instruction generation
+    // is performed from MSB to LSB by calling GenerateLI64() recursively. In each
+    // recursion, the lowest 12 bits are removed from imm and the optimal shift amount
+    // is calculated. Then, the remaining part of imm is processed recursively until
+    // it fits into 32 bits.
+
+    if (static_cast<uint64_t>(static_cast<int64_t>(imm << 32) >> 32) == imm) {
         // Depending on imm, the following instructions are emitted.
-        // hi20 == 0              -> ADDI
+        // hi20 == 0              -> ADDIW
         // lo12 == 0 && hi20 != 0 -> LUI
-        // otherwise              -> LUI+ADDI
+        // otherwise              -> LUI+ADDIW
 
-        // Add 0x800 to cancel out the signed extension of ADDI.
-        const auto uimm32 = static_cast<uint32_t>(imm);
-        const auto hi20 = (uimm32 + 0x800) >> 12 & 0xFFFFF;
-        const auto lo12 = static_cast<int32_t>(uimm32) & 0xFFF;
-        GPR rs1 = zero;
+        // Add 0x800 to cancel out the signed extension of ADDIW.
+        const auto hi20 = (static_cast<uint32_t>(imm) + 0x800) >> 12 & 0xFFFFF;
+        const auto lo12 = static_cast<int32_t>(static_cast<uint32_t>(imm) << 20) >> 20;
 
         if (hi20 != 0) {
-            LUI(rd, hi20);
-            rs1 = rd;
+            seq.Add(LIOp::LUI, static_cast<int32_t>(hi20));
         }
 
         if (lo12 != 0 || hi20 == 0) {
-            ADDI(rd, rs1, lo12);
+            seq.Add(LIOp::ADDIW, lo12);
         }
-    } else {
-        // For 64-bit imm, a sequence of up to 8 instructions (i.e. LUI+ADDIW+SLLI+
-        // ADDI+SLLI+ADDI+SLLI+ADDI) is emitted.
-        // In the following, imm is processed from LSB to MSB while instruction emission
-        // is performed from MSB to LSB by calling LI() recursively. In each recursion,
-        // the lowest 12 bits are removed from imm and the optimal shift amount is
-        // calculated. Then, the remaining part of imm is processed recursively and
-        // LI() get called as soon as it fits into 32 bits.
-
-        if (static_cast<uint64_t>(static_cast<int64_t>(imm << 32) >> 32) == imm) {
-            // Depending on imm, the following instructions are emitted.
-            // hi20 == 0              -> ADDIW
-            // lo12 == 0 && hi20 != 0 -> LUI
-            // otherwise              -> LUI+ADDIW
-
-            // Add 0x800 to cancel out the signed extension of ADDIW.
-            const auto hi20 = (static_cast<uint32_t>(imm) + 0x800) >> 12 & 0xFFFFF;
-            const auto lo12 = static_cast<int32_t>(imm) & 0xFFF;
-            GPR rs1 = zero;
-
-            if (hi20 != 0) {
-                LUI(rd, hi20);
-                rs1 = rd;
-            }
+        return;
+    }
 
-            if (lo12 != 0 || hi20 == 0) {
-                ADDIW(rd, rs1, lo12);
-            }
-            return;
-        }
+    const auto lo12 = static_cast<int32_t>(static_cast<int64_t>(imm << 52) >> 52);
+    // Add 0x800 to cancel out the signed extension of ADDI.
+    uint64_t hi52 = (imm + 0x800) >> 12;
+    const uint32_t shift = 12 + static_cast<uint32_t>(std::countr_zero(hi52));
+    hi52 = static_cast<uint64_t>((static_cast<int64_t>(hi52 >> (shift - 12)) << shift) >> shift);
+    GenerateLI64(seq, hi52);
+    seq.Add(LIOp::SLLI, static_cast<int32_t>(shift));
+    if (lo12 != 0) {
+        seq.Add(LIOp::ADDI, lo12);
+    }
+}
+
+// Determines whether or not a step can be emitted as a compressed instruction.
+bool IsCompressibleLIStep(const LIStep& step, bool is_first, GPR rd) noexcept {
+    if (rd == x0) {
+        return false;
+    }
 
-        const auto lo12 = static_cast<int32_t>(static_cast<int64_t>(imm << 52) >> 52);
-        // Add 0x800 to cancel out the signed extension of ADDI.
-        uint64_t hi52 = (imm + 0x800) >> 12;
-        const uint32_t shift = 12 + static_cast<uint32_t>(std::countr_zero(hi52));
-        hi52 = static_cast<uint64_t>((static_cast<int64_t>(hi52 >> (shift - 12)) << shift) >> shift);
-        LI(rd, hi52);
-        SLLI(rd, rd, shift);
-        if (lo12 != 0) {
-            ADDI(rd, rd, lo12);
+    switch (step.op) {
+    case LIOp::LUI: {
+        // C.LUI takes a sign-extended 6-bit immediate.
+        const auto hi20 = static_cast<uint32_t>(step.imm);
+        return rd != x2 && (hi20 - 1 < 0x1F || hi20 >= 0xFFFE0);
+    }
+    case LIOp::ADDI:
+        if (is_first) {
+            return IsValidSigned6BitImm(step.imm);
         }
+        return step.imm != 0 && IsValidSigned6BitImm(step.imm);
+    case LIOp::ADDIW:
+        return IsValidSigned6BitImm(step.imm);
+    case LIOp::SLLI:
+        return true;
+    case LIOp::SRLI:
+        return IsValid3BitCompressedReg(rd);
+    default:
+        return false;
     }
 }
 
-void Assembler::LUI(GPR rd, uint32_t imm) noexcept {
-    EmitUType(m_buffer, imm, rd, 0b0110111);
-}
+// Cost of emitting a sequence. Instruction count is what matters most, as each
+// one is a link in a serial dependency chain. Size is used to break ties.
+struct LICost {
+    size_t instructions;
+    size_t bytes;
 
-void Assembler::LW(GPR rd, int32_t imm, GPR rs) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b010, rd, 0b0000011);
-}
+    [[nodiscard]] bool operator<(const LICost& other) const noexcept {
+        if (instructions != other.instructions) {
+            return instructions < other.instructions;
+        }
+        return bytes < other.bytes;
+    }
+};
 
-void Assembler::MV(GPR rd, GPR rs) noexcept {
-    ADDI(rd, rs, 0);
+LICost GetLICost(const LISequence& seq, GPR rd, bool use_compressed) noexcept {
+    LICost cost{seq.size, 0};
+    for (size_t i = 0; i < seq.size; i++) {
+        const auto compressed = use_compressed && IsCompressibleLIStep(seq.steps[i], i == 0, rd);
+        cost.bytes += compressed ? 2 : 4;
+    }
+    return cost;
 }
 
-void Assembler::NEG(GPR rd, GPR rs) noexcept {
-    SUB(rd, x0, rs);
-}
+// Searches for the cheapest sequence that materializes a 64-bit constant,
+// taking advantage of any available bit-manipulation extensions.
+//
+// Along the lines of LLVM's RISCVMatInt, every candidate is built around
+// the base sequence of a related constant, which is then fixed up with a
+// short tail of instructions.
+LISequence GenerateBestLI64(uint64_t imm, GPR rd, ExtensionSet extensions) noexcept {
+    const auto use_compressed = extensions.Has(Extension::C);
 
-void Assembler::NOP() noexcept {
-    ADDI(x0, x0, 0);
-}
+    LISequence best;
+    GenerateLI64(best, imm);
+    auto best_cost = GetLICost(best, rd, use_compressed);
 
-void Assembler::NOT(GPR rd, GPR rs) noexcept {
-    XORI(rd, rs, UINT32_MAX);
-}
+    const auto consider = [&](const LISequence& candidate) {
+        if (candidate.overflowed) {
+            return;
+        }
+        const auto cost = GetLICost(candidate, rd, use_compressed);
+        if (cost < best_cost) {
+            best = candidate;
+            best_cost = cost;
+        }
+    };
 
-void Assembler::OR(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b110, rd, 0b0110011);
-}
+    if (best.size <= 1) {
+        return best;
+    }
 
-void Assembler::ORI(GPR rd, GPR rs, uint32_t imm) noexcept {
-    EmitIType(m_buffer, imm, rs, 0b110, rd, 0b0010011);
-}
+    // Build a value with its leading zeros shifted out, then shift it back in.
+    // Filling the vacated low bits with ones may make the value cheaper,
+    // since it can turn into a sign-extended negative number.
+    if (const auto leading_zeros = static_cast<uint32_t>(std::countl_zero(imm));
+        leading_zeros > 0 && leading_zeros < 64) {
+        const auto shifted = imm << leading_zeros;
+        const auto fill = (uint64_t{1} << leading_zeros) - 1;
+
+        for (const auto value : {shifted, shifted | fill}) {
+            LISequence candidate;
+            GenerateLI64(candidate, value);
+            candidate.Add(LIOp::SRLI, static_cast<int32_t>(leading_zeros));
+            consider(candidate);
+        }
+    }
 
-void Assembler::PAUSE() noexcept {
-    m_buffer.Emit32(0x0100000F);
-}
+    if (extensions.Has(Extension::Zba)) {
+        // Zero-extend a sign-extended 32-bit value.
+        if ((imm >> 32) == 0 && (imm & 0x80000000) != 0) {
+            LISequence candidate;
+            GenerateLI64(candidate, static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(imm))));
+            candidate.Add(LIOp::ADDUW, 0);
+            consider(candidate);
+        }
 
-void Assembler::RET() noexcept {
-    JALR(x0, 0, x1);
-}
+        // Multiply a cheaper value by 3, 5 or 9.
+        const auto simm = static_cast<int64_t>(imm);
+        for (const auto& [divisor, op] : {std::pair{3, LIOp::SH1ADD},
+                                         std::pair{5, LIOp::SH2ADD},
+                                         std::pair{9, LIOp::SH3ADD}}) {
+            if (simm % divisor != 0) {
+                continue;
+            }
 
-void Assembler::SB(GPR rs2, int32_t imm, GPR rs1) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitSType(m_buffer, static_cast<uint32_t>(imm), rs2, rs1, 0b000, 0b0100011);
-}
+            LISequence candidate;
+            GenerateLI64(candidate, static_cast<uint64_t>(simm / divisor));
+            candidate.Add(op, 0);
+            consider(candidate);
+        }
+    }
 
-void Assembler::SEQZ(GPR rd, GPR rs) noexcept {
-    SLTIU(rd, rs, 1);
-}
+    if (extensions.Has(Extension::Zbb)) {
+        // Rotate a 12-bit signed value into place.
+        for (uint32_t rotate = 1; rotate < 64; rotate++) {
+            const auto rotated = static_cast<int64_t>(std::rotl(imm, static_cast<int>(rotate)));
+            if (!IsValidSigned12BitImm(rotated)) {
+                continue;
+            }
 
-void Assembler::SGTZ(GPR rd, GPR rs) noexcept {
-    SLT(rd, x0, rs);
-}
+            LISequence candidate;
+            candidate.Add(LIOp::ADDI, static_cast<int32_t>(rotated));
+            candidate.Add(LIOp::RORI, static_cast<int32_t>(rotate));
+            consider(candidate);
+            break;
+        }
+    }
 
-void Assembler::SH(GPR rs2, int32_t imm, GPR rs1) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitSType(m_buffer, static_cast<uint32_t>(imm), rs2, rs1, 0b001, 0b0100011);
-}
+    if (extensions.Has(Extension::Zbs)) {
+        constexpr uint64_t upper_mask = 0xFFFFFFFF80000000ULL;
+
+        // Set individual upper bits on top of a positive 32-bit value.
+        {
+            LISequence candidate;
+            if (const auto lower = imm & ~upper_mask; lower != 0) {
+                GenerateLI64(candidate, lower);
+            }
+            for (auto bits = imm & upper_mask; bits != 0; bits &= bits - 1) {
+                candidate.Add(LIOp::BSETI, std::countr_zero(bits));
+            }
+            consider(candidate);
+        }
+
+        // Clear individual upper bits from a negative 32-bit value.
+        {
+            LISequence candidate;
+            GenerateLI64(candidate, imm | upper_mask);
+            for (auto bits = ~imm & upper_mask; bits != 0; bits &= bits - 1) {
+                candidate.Add(LIOp::BCLRI, std::countr_zero(bits));
+            }
+            consider(candidate);
+        }
+    }
 
-void Assembler::SLL(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b001, rd, 0b0110011);
+    return best;
 }
+} // Anonymous namespace
 
-void Assembler::SLLI(GPR rd, GPR rs, uint32_t shift) noexcept {
+void Assembler::LI(GPR rd, uint64_t imm) noexcept {
+    LISequence seq;
     if (IsRV32(m_features)) {
-        BISCUIT_ASSERT(shift <= 31);
-        EmitIType(m_buffer, shift & 0x1F, rs, 0b001, rd, 0b0010011);
+        GenerateLI32(seq, static_cast<uint32_t>(imm));
+    } else if (IsRV64(m_features)) {
+        seq = GenerateBestLI64(imm, rd, m_extensions);
     } else {
-        BISCUIT_ASSERT(shift <= 63);
-        EmitIType(m_buffer, shift & 0x3F, rs, 0b001, rd, 0b0010011);
+        GenerateLI64(seq, imm);
+    }
+
+    // An AUIPC+LD pair is cheaper than a long serial chain of ALU operations.
+    if (m_literal_pool_enabled && IsRV64(m_features) && rd != x0 &&
+        seq.size > m_literal_pool_max_inline) {
+        LD(rd, GetLiteralLabel(imm));
+        return;
+    }
+
+    const auto use_compressed = m_extensions.Has(Extension::C);
+
+    GPR rs1 = zero;
+    for (size_t i = 0; i < seq.size; i++) {
+        const auto& step = seq.steps[i];
+        const auto value = step.imm;
+        const auto compressed = use_compressed && IsCompressibleLIStep(step, i == 0, rd);
+
+        switch (step.op) {
+        case LIOp::LUI:
+            if (compressed) {
+                C_LUI(rd, static_cast<uint32_t>(value) << 12);
+            } else {
+                LUI(rd, static_cast<uint32_t>(value));
+            }
+            break;
+        case LIOp::ADDI:
+            if (compressed && i == 0) {
+                C_LI(rd, value);
+            } else if (compressed) {
+                C_ADDI(rd, value);
+            } else {
+                ADDI(rd, rs1, value);
+            }
+            break;
+        case LIOp::ADDIW:
+            if (compressed && i == 0) {
+                C_LI(rd, value);
+            } else if (compressed) {
+                C_ADDIW(rd, value);
+            } else {
+                ADDIW(rd, rs1, value);
+            }
+            break;
+        case LIOp::SLLI:
+            if (compressed) {
+                C_SLLI(rd, static_cast<uint32_t>(value));
+            } else {
+                SLLI(rd, rs1, static_cast<uint32_t>(value));
+            }
+            break;
+        case LIOp::SRLI:
+            if (compressed) {
+                C_SRLI(rd, static_cast<uint32_t>(value));
+            } else {
+                SRLI(rd, rs1, static_cast<uint32_t>(value));
+            }
+            break;
+        case LIOp::ADDUW:
+            ADDUW(rd, rs1, zero);
+            break;
+        case LIOp::SH1ADD:
+            SH1ADD(rd, rs1, rs1);
+            break;
+        case LIOp::SH2ADD:
+            SH2ADD(rd, rs1, rs1);
+            break;
+        case LIOp::SH3ADD:
+            SH3ADD(rd, rs1, rs1);
+            break;
+        case LIOp::RORI:
+            RORI(rd, rs1, static_cast<uint32_t>(value));
+            break;
+        case LIOp::BSETI:
+            BSETI(rd, rs1, static_cast<uint32_t>(value));
+            break;
+        case LIOp::BCLRI:
+            BCLRI(rd, rs1, static_cast<uint32_t>(value));
+            break;
+        }
+
+        rs1 = rd;
     }
 }
 
-void Assembler::SLT(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b010, rd, 0b0110011);
+void Assembler::LA(GPR rd, Label* label) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::ADDI(rd, rd, GetPCRelLo12(offset)));
 }
 
-void Assembler::SLTI(GPR rd, GPR rs, int32_t imm) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b010, rd, 0b0010011);
+void Assembler::LB(GPR rd, Label* label) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::LB(rd, GetPCRelLo12(offset), rd));
 }
 
-void Assembler::SLTIU(GPR rd, GPR rs, int32_t imm) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b011, rd, 0b0010011);
+void Assembler::LBU(GPR rd, Label* label) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::LBU(rd, GetPCRelLo12(offset), rd));
 }
 
-void Assembler::SLTU(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b011, rd, 0b0110011);
+void Assembler::LH(GPR rd, Label* label) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::LH(rd, GetPCRelLo12(offset), rd));
 }
 
-void Assembler::SLTZ(GPR rd, GPR rs) noexcept {
-    SLT(rd, rs, x0);
+void Assembler::LHU(GPR rd, Label* label) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::LHU(rd, GetPCRelLo12(offset), rd));
 }
 
-void Assembler::SNEZ(GPR rd, GPR rs) noexcept {
-    SLTU(rd, x0, rs);
+void Assembler::LW(GPR rd, Label* label) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::LW(rd, GetPCRelLo12(offset), rd));
+}
+
+void Assembler::NEG(GPR rd, GPR rs) noexcept {
+    SUB(rd, x0, rs);
 }
 
-void Assembler::SRA(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0100000, rhs, lhs, 0b101, rd, 0b0110011);
+void Assembler::NOT(GPR rd, GPR rs) noexcept {
+    XORI(rd, rs, UINT32_MAX);
 }
 
-void Assembler::SRAI(GPR rd, GPR rs, uint32_t shift) noexcept {
-    if (IsRV32(m_features)) {
-        BISCUIT_ASSERT(shift <= 31);
-        EmitIType(m_buffer, (0b0100000 << 5) | (shift & 0x1F), rs, 0b101, rd, 0b0010011);
-    } else {
-        BISCUIT_ASSERT(shift <= 63);
-        EmitIType(m_buffer, (0b0100000 << 5) | (shift & 0x3F), rs, 0b101, rd, 0b0010011);
-    }
+void Assembler::PAUSE() noexcept {
+    m_buffer.Emit32(0x0100000F);
 }
 
-void Assembler::SRL(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b101, rd, 0b0110011);
+void Assembler::RET() noexcept {
+    JALR(x0, 0, x1);
 }
 
-void Assembler::SRLI(GPR rd, GPR rs, uint32_t shift) noexcept {
-    if (IsRV32(m_features)) {
-        BISCUIT_ASSERT(shift <= 31);
-        EmitIType(m_buffer, shift & 0x1F, rs, 0b101, rd, 0b0010011);
-    } else {
-        BISCUIT_ASSERT(shift <= 63);
-        EmitIType(m_buffer, shift & 0x3F, rs, 0b101, rd, 0b0010011);
-    }
+void Assembler::SEQZ(GPR rd, GPR rs) noexcept {
+    SLTIU(rd, rs, 1);
 }
 
-void Assembler::SUB(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0100000, rhs, lhs, 0b000, rd, 0b0110011);
+void Assembler::SGTZ(GPR rd, GPR rs) noexcept {
+    SLT(rd, x0, rs);
 }
 
-void Assembler::SW(GPR rs2, int32_t imm, GPR rs1) noexcept {
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitSType(m_buffer, static_cast<uint32_t>(imm), rs2, rs1, 0b010, 0b0100011);
+void Assembler::SLTZ(GPR rd, GPR rs) noexcept {
+    SLT(rd, rs, x0);
+}
+
+void Assembler::SNEZ(GPR rd, GPR rs) noexcept {
+    SLTU(rd, x0, rs);
 }
 
-void Assembler::XOR(GPR rd, GPR lhs, GPR rhs) noexcept {
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b100, rd, 0b0110011);
+void Assembler::SB(GPR rs2, Label* label, GPR temp) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::SB(rs2, GetPCRelLo12(offset), temp));
 }
 
-void Assembler::XORI(GPR rd, GPR rs, uint32_t imm) noexcept {
-    EmitIType(m_buffer, imm, rs, 0b100, rd, 0b0010011);
+void Assembler::SH(GPR rs2, Label* label, GPR temp) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::SH(rs2, GetPCRelLo12(offset), temp));
 }
 
-// RV64I Instructions
+void Assembler::SW(GPR rs2, Label* label, GPR temp) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::SW(rs2, GetPCRelLo12(offset), temp));
+}
 
-void Assembler::ADDIW(GPR rd, GPR rs, int32_t imm) noexcept {
-    BISCUIT_ASSERT(IsRV64(m_features));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b000, rd, 0b0011011);
+void Assembler::TAIL(Label* label) noexcept {
+    AlignPatchSlot();
+    TAIL(LinkAndGetPCRelOffset(label));
 }
 
-void Assembler::ADDW(GPR rd, GPR lhs, GPR rhs) noexcept {
-    BISCUIT_ASSERT(IsRV64(m_features));
-    EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b000, rd, 0b0111011);
+void Assembler::TAIL(int32_t offset) noexcept {
+    AUIPC(x6, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::JALR(x0, GetPCRelLo12(offset), x6));
 }
 
-void Assembler::LD(GPR rd, int32_t imm, GPR rs) noexcept {
+// RV64I Instructions
+
+void Assembler::LD(GPR rd, Label* label) noexcept {
     BISCUIT_ASSERT(IsRV64(m_features));
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b011, rd, 0b0000011);
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::LD(rd, GetPCRelLo12(offset), rd));
 }
 
-void Assembler::LWU(GPR rd, int32_t imm, GPR rs) noexcept {
+void Assembler::LWU(GPR rd, Label* label) noexcept {
     BISCUIT_ASSERT(IsRV64(m_features));
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitIType(m_buffer, static_cast<uint32_t>(imm), rs, 0b110, rd, 0b0000011);
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(rd, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::LWU(rd, GetPCRelLo12(offset), rd));
 }
 
-void Assembler::SD(GPR rs2, int32_t imm, GPR rs1) noexcept {
+void Assembler::SD(GPR rs2, Label* label, GPR temp) noexcept {
     BISCUIT_ASSERT(IsRV64(m_features));
-    BISCUIT_ASSERT(IsValidSigned12BitImm(imm));
-    EmitSType(m_buffer, static_cast<uint32_t>(imm), rs2, rs1, 0b011, 0b0100011);
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    m_buffer.Emit32(enc::SD(rs2, GetPCRelLo12(offset), temp));
 }
 
 void Assembler::SLLIW(GPR rd, GPR rs, uint32_t shift) noexcept {
@@ -572,11 +968,6 @@ void Assembler::SRLW(GPR rd, GPR lhs, GPR rhs) noexcept {
     EmitRType(m_buffer, 0b0000000, rhs, lhs, 0b101, rd, 0b0111011);
 }
 
-void Assembler::SUBW(GPR rd, GPR lhs, GPR rhs) noexcept {
-    BISCUIT_ASSERT(IsRV64(m_features));
-    EmitRType(m_buffer, 0b0100000, rhs, lhs, 0b000, rd, 0b0111011);
-}
-
 // Zawrs Extension Instructions
 
 void Assembler::WRS_NTO() noexcept {
@@ -831,7 +1222,7 @@ void Assembler::DIVU(GPR rd, GPR rs1, GPR rs2) noexcept {
     EmitRType(m_buffer, 0b0000001, rs2, rs1, 0b101, rd, 0b0110011);
 }
 void Assembler::MUL(GPR rd, GPR rs1, GPR rs2) noexcept {
-    EmitRType(m_buffer, 0b0000001, rs2, rs1, 0b000, rd, 0b0110011);
+    EmitCompressible(EncodeRType(0b0000001, rs2, rs1, 0b000, rd, 0b0110011));
 }
 void Assembler::MULH(GPR rd, GPR rs1, GPR rs2) noexcept {
     EmitRType(m_buffer, 0b0000001, rs2, rs1, 0b001, rd, 0b0110011);
@@ -954,7 +1345,7 @@ void Assembler::SC_D(Ordering ordering, GPR rd, GPR rs2, GPR rs1) noexcept {
 
 void Assembler::ADDUW(GPR rd, GPR rs1, GPR rs2) noexcept {
     BISCUIT_ASSERT(IsRV64(m_features));
-    EmitRType(m_buffer, 0b0000100, rs2, rs1, 0b000, rd, 0b0111011);
+    EmitCompressible(EncodeRType(0b0000100, rs2, rs1, 0b000, rd, 0b0111011));
 }
 
 void Assembler::ANDN(GPR rd, GPR rs1, GPR rs2) noexcept {
@@ -1022,7 +1413,7 @@ void Assembler::BSETI(GPR rd, GPR rs, uint32_t bit) noexcept {
     }
 
     const auto imm = (0b001010U << 6) | bit;
-    EmitIType(m_buffer, imm, rs, 0b001, rd, 0b0110011);
+    EmitIType(m_buffer, imm, rs, 0b001, rd, 0b0010011);
 }
 
 void Assembler::CLMUL(GPR rd, GPR rs1, GPR rs2) noexcept {
@@ -1141,11 +1532,11 @@ void Assembler::RORW(GPR rd, GPR rs1, GPR rs2) noexcept {
 }
 
 void Assembler::SEXTB(GPR rd, GPR rs) noexcept {
-    EmitIType(m_buffer, 0b011000000100, rs, 0b001, rd, 0b0010011);
+    EmitCompressible(EncodeIType(0b011000000100, rs, 0b001, rd, 0b0010011));
 }
 
 void Assembler::SEXTH(GPR rd, GPR rs) noexcept {
-    EmitIType(m_buffer, 0b011000000101, rs, 0b001, rd, 0b0010011);
+    EmitCompressible(EncodeIType(0b011000000101, rs, 0b001, rd, 0b0010011));
 }
 
 void Assembler::SH1ADD(GPR rd, GPR rs1, GPR rs2) noexcept {
@@ -1201,9 +1592,9 @@ void Assembler::XPERM8(GPR rd, GPR rs1, GPR rs2) noexcept {
 
 void Assembler::ZEXTH(GPR rd, GPR rs) noexcept {
     if (IsRV32(m_features)) {
-        EmitIType(m_buffer, 0b000010000000, rs, 0b100, rd, 0b0110011);
+        EmitCompressible(EncodeIType(0b000010000000, rs, 0b100, rd, 0b0110011));
     } else {
-        EmitIType(m_buffer, 0b000010000000, rs, 0b100, rd, 0b0111011);
+        EmitCompressible(EncodeIType(0b000010000000, rs, 0b100, rd, 0b0111011));
     }
 }
 
@@ -1367,13 +1758,66 @@ void Assembler::BindToOffset(Label* label, Label::LocationOffset offset) {
     BISCUIT_ASSERT(label != nullptr);
     BISCUIT_ASSERT(offset >= 0 && offset <= m_buffer.GetCursorOffset());
 
+    // Code at a label may be reached with any vector configuration.
+    InvalidateVTypeState();
+
+    // The label starts a new basic block, so nothing may be moved across it. Code before
+    // the start of the schedule may already have been, unless it's been rewound away.
+    BISCUIT_ASSERT(m_scheduler == nullptr || offset >= std::min(m_schedule_start, m_buffer.GetCursorOffset()));
+    if (m_scheduler != nullptr && offset > m_schedule_start) {
+        ScheduleRange(m_schedule_start, offset);
+        m_schedule_start = offset;
+    }
+    FlushSchedule();
+
+    SyncLabel(label);
     label->Bind(offset);
-    ResolveLabelOffsets(label);
+    if (m_reassembling && m_record_relocations) {
+        m_region_labels.push_back(label);
+    }
+
+    if (m_relax_branches) {
+        ResolveRelaxedRefs(label);
+    } else {
+        ResolveLabelOffsets(label);
+    }
+
+    if (!m_relocations.empty() && IsLocalLabel(label)) {
+        for (const auto ref : label->m_offsets) {
+            DetachLabelReference(label, ref);
+        }
+    }
+
+    ResolveDataReferences(label);
+
+    // Relaxation may have moved code, which has already been scheduled.
+    SkipSchedule();
+
+    UntrackLabelOffsets(label);
+
+#ifdef BISCUIT_EMISSION_STATS
+    if (auto* const stats = m_buffer.GetEmissionStats(); stats != nullptr) {
+        stats->RecordLabel(offset, label->m_offsets.size());
+    }
+#endif
+
     label->ClearOffsets();
 }
 
-ptrdiff_t Assembler::LinkAndGetOffset(Label* label) {
+ptrdiff_t Assembler::LinkAndGetOffset(Label* label, RelocationKind kind) {
     BISCUIT_ASSERT(label != nullptr);
+    RecordRelocation(kind, m_buffer.GetCursorOffset(), label);
+
+    // Even if the instruction using the label can't be relaxed itself,
+    // its offset may still need to be adjusted when code is moved.
+    if (m_relax_branches) {
+        SyncLabel(label);
+        RelaxedRef ref;
+        ref.offset = m_buffer.GetCursorOffset();
+        ref.target = label->GetLocation().value_or(0);
+        ref.is_bound = label->IsBound();
+        TrackRelaxedRef(ref);
+    }
 
     // If we have a bound label, then it's straightforward to calculate
     // the offsets.
@@ -1387,79 +1831,1141 @@ ptrdiff_t Assembler::LinkAndGetOffset(Label* label) {
     // While the emitter will emit a bogus branch instruction initially,
     // the offset will be patched over once the label has been properly
     // bound to a location.
-    label->AddOffset(m_buffer.GetCursorOffset());
+    AddLabelOffset(label, m_buffer.GetCursorOffset());
     return 0;
 }
 
-void Assembler::ResolveLabelOffsets(Label* label) {
-    // Conditional branch instructions make use of the B-type immediate encoding for offsets.
-    const auto is_b_type = [](uint32_t instruction) {
-        return (instruction & 0x7F) == 0b1100011;
-    };
-    // JAL makes use of the J-type immediate encoding for offsets.
-    const auto is_j_type = [](uint32_t instruction) {
-        return (instruction & 0x7F) == 0b1101111;
-    };
-    // C.BEQZ and C.BNEZ make use of this encoding type.
-    const auto is_cb_type = [](uint32_t instruction) {
-        const auto op = instruction & 0b11;
-        const auto funct3 = instruction & 0xE000;
-        return op == 0b01 && funct3 >= 0xC000;
-    };
-    // C.JAL and C.J make use of this encoding type.
-    const auto is_cj_type = [](uint32_t instruction) {
-        const auto op = instruction & 0b11;
-        const auto funct3 = instruction & 0xE000;
-        return op == 0b01 && (funct3 == 0x2000 || funct3 == 0xA000);
-    };
-    // If we know an instruction is a compressed branch, then it's a 16-bit instruction
-    // Otherwise it's a regular-sized 32-bit instruction.
-    const auto determine_inst_size = [&](uint32_t instruction) -> size_t {
-        if (is_cj_type(instruction) || is_cb_type(instruction)) {
-            return 2;
-        } else {
-            return 4;
-        }
-    };
+int32_t Assembler::LinkAndGetPCRelOffset(Label* label) {
+    const auto offset = LinkAndGetOffset(label, RelocationKind::PCRelPair);
+    BISCUIT_ASSERT(IsValidPCRelPairImm(offset));
+    return static_cast<int32_t>(offset);
+}
+
+void PatchLabelReference(uint8_t* ptr, ptrdiff_t encoded_offset) {
+    const auto instruction = uint32_t{*ptr} | (uint32_t{*(ptr + 1)} << 8);
+    const auto opcode = instruction & 0x7F;
+
+    // Compressed branches and jumps are identified by their quadrant and funct3.
+    const auto op = instruction & 0b11;
+    const auto funct3 = instruction & 0xE000;
+
+    RelocationKind kind{};
+    if (op == 0b01 && funct3 >= 0xC000) {
+        kind = RelocationKind::CBType;
+    } else if (op == 0b01 && (funct3 == 0x2000 || funct3 == 0xA000)) {
+        kind = RelocationKind::CJType;
+    } else if (opcode == 0b1100011) {
+        kind = RelocationKind::BType;
+    } else if (opcode == 0b1101111) {
+        kind = RelocationKind::JType;
+    } else if (opcode == 0b0010111) {
+        kind = RelocationKind::PCRelPair;
+    } else {
+        return;
+    }
+
+    PatchRelocation(ptr, kind, encoded_offset);
+}
 
+void Assembler::ResolveLabelOffsets(Label* label) {
     const auto label_location = *label->GetLocation();
 
     for (const auto offset : label->m_offsets) {
-        const auto address = m_buffer.GetOffsetAddress(offset);
-        auto* const ptr = reinterpret_cast<uint8_t*>(address);
-        const auto inst_size = determine_inst_size(uint32_t{*ptr} | (uint32_t{*(ptr + 1)} << 8));
-
-        uint32_t instruction = 0;
-        std::memcpy(&instruction, ptr, inst_size);
-
-        // Given all branch instructions we need to patch have 0 encoded as
-        // their branch offset, we don't need to worry about any masking work.
-        //
-        // It's enough to verify that the immediate is going to be valid
-        // and then OR it into the instruction.
-
-        const auto encoded_offset = label_location - offset;
-
-        if (inst_size == sizeof(uint32_t)) {
-            if (is_b_type(instruction)) {
-                BISCUIT_ASSERT(IsValidBTypeImm(encoded_offset));
-                instruction |= TransformToBTypeImm(static_cast<uint32_t>(encoded_offset));
-            } else if (is_j_type(instruction)) {
-                BISCUIT_ASSERT(IsValidJTypeImm(encoded_offset));
-                instruction |= TransformToJTypeImm(static_cast<uint32_t>(encoded_offset));
-            }
-        } else {
-            if (is_cb_type(instruction)) {
-                BISCUIT_ASSERT(IsValidCBTypeImm(encoded_offset));
-                instruction |= TransformToCBTypeImm(static_cast<uint32_t>(encoded_offset));
-            } else if (is_cj_type(instruction)) {
-                BISCUIT_ASSERT(IsValidCJTypeImm(encoded_offset));
-                instruction |= TransformToCJTypeImm(static_cast<uint32_t>(encoded_offset));
-            }
+        PatchLabelReference(m_buffer.GetOffsetPointer(offset), label_location - offset);
+    }
+}
+
+void Assembler::AddLabelOffset(Label* label, ptrdiff_t offset) {
+    const auto is_first = label->IsResolved();
+    const auto previous = is_first ? offset : label->m_offsets[0];
+    label->AddOffset(offset);
+
+    // Later references don't change where the label holds up finalized code.
+    if (!is_first) {
+        if (offset > previous) {
+            return;
         }
+        UntrackLabelOffsets(label);
+    }
+
+    if (m_unresolved_refs.empty() || m_unresolved_refs.back() <= offset) {
+        m_unresolved_refs.push_back(offset);
+    } else {
+        m_unresolved_refs.insert(std::upper_bound(m_unresolved_refs.begin(), m_unresolved_refs.end(), offset),
+                                 offset);
+    }
+}
+
+void Assembler::UntrackLabelOffsets(const Label* label) noexcept {
+    if (label->IsResolved()) {
+        return;
+    }
 
-        std::memcpy(ptr, &instruction, inst_size);
+    // References to a label that precede rewinding the buffer aren't tracked anymore.
+    const auto iter = std::lower_bound(m_unresolved_refs.begin(), m_unresolved_refs.end(), label->m_offsets[0]);
+    if (iter != m_unresolved_refs.end() && *iter == label->m_offsets[0]) {
+        m_unresolved_refs.erase(iter);
     }
 }
 
+ptrdiff_t Assembler::GetFinalizedOffset() const noexcept {
+    auto offset = m_buffer.GetCursorOffset();
+
+    if (!m_unresolved_refs.empty()) {
+        offset = std::min(offset, m_unresolved_refs.front());
+    }
+
+    // Anything after a reference that may still grow may still move.
+    if (!m_relaxed_refs.empty()) {
+        offset = std::min(offset, m_relaxed_refs.front().offset);
+    }
+
+    for (const auto& ref : m_pending_data_refs) {
+        offset = std::min(offset, ref.offset);
+    }
+
+    if (m_scheduler != nullptr) {
+        offset = std::min(offset, m_schedule_start);
+    }
+
+    return offset;
+}
+
+void Assembler::EmitRelaxedBranch(uint32_t funct3, GPR rs1, GPR rs2, Label* label) {
+    BISCUIT_ASSERT(label != nullptr);
+    SyncLabel(label);
+
+    RelaxedRef ref;
+    ref.offset = m_buffer.GetCursorOffset();
+    ref.target = label->GetLocation().value_or(0);
+    ref.form = RelaxForm::Short;
+    ref.funct3 = funct3;
+    ref.rs1 = rs1;
+    ref.rs2 = rs2;
+    ref.is_bound = label->IsBound();
+
+    if (IsCompressibleRef(ref)) {
+        ref.form = RelaxForm::Compressed;
+    }
+
+    if (ref.is_bound) {
+        ref.form = GetRelaxedForm(ref);
+    } else {
+        AddLabelOffset(label, ref.offset);
+    }
+
+    TrackRelaxedRef(ref);
+    EncodeRelaxedRef(m_buffer, ref);
+}
+
+void Assembler::EmitRelaxedJump(GPR rd, Label* label) {
+    BISCUIT_ASSERT(label != nullptr);
+    SyncLabel(label);
+
+    RelaxedRef ref;
+    ref.offset = m_buffer.GetCursorOffset();
+    ref.target = label->GetLocation().value_or(0);
+    ref.form = RelaxForm::Short;
+    ref.rs1 = rd;
+    ref.is_jump = true;
+    ref.is_bound = label->IsBound();
+
+    if (IsCompressibleRef(ref)) {
+        ref.form = RelaxForm::Compressed;
+    }
+
+    if (ref.is_bound) {
+        ref.form = GetRelaxedForm(ref);
+    } else {
+        AddLabelOffset(label, ref.offset);
+    }
+
+    TrackRelaxedRef(ref);
+    EncodeRelaxedRef(m_buffer, ref);
+}
+
+void Assembler::TrackRelaxedRef(const RelaxedRef& ref) {
+    if (!ref.is_bound) {
+        m_relax_pending++;
+    } else if (m_relax_pending == 0) {
+        // Code only ever moves when a pending reference is relaxed, and pending
+        // references made from here on out can only come after this one.
+        // So there's no point in keeping track of it.
+        return;
+    }
+
+    m_relaxed_refs.push_back(ref);
+}
+
+void Assembler::SyncLabel(Label* label) noexcept {
+    const auto epoch = m_relax_shifts.size();
+
+    for (auto i = label->m_relax_epoch; i < epoch; i++) {
+        const auto [shift_offset, shift_size] = m_relax_shifts[i];
+
+        if (label->m_location && *label->m_location >= shift_offset) {
+            *label->m_location += shift_size;
+        }
+
+        if (label->m_offsets.empty() || label->m_offsets.back() < shift_offset) {
+            continue;
+        }
+
+        // Shifting everything past a point keeps the offsets sorted.
+        for (auto& offset : label->m_offsets) {
+            if (offset >= shift_offset) {
+                offset += shift_size;
+            }
+        }
+    }
+
+    label->m_relax_epoch = epoch;
+}
+
+void Assembler::ResolveRelaxedRefs(Label* label) {
+    const auto location = *label->GetLocation();
+
+    m_relax_worklist.clear();
+    for (const auto offset : label->m_offsets) {
+        const auto iter = std::lower_bound(m_relaxed_refs.begin(), m_relaxed_refs.end(), offset,
+                                           [](const RelaxedRef& ref, ptrdiff_t value) {
+                                               return ref.offset < value;
+                                           });
+
+        // Referenced before relaxation was enabled, so we have nothing tracking it.
+        if (iter == m_relaxed_refs.end() || iter->offset != offset) {
+            PatchLabelReference(m_buffer.GetOffsetPointer(offset), location - offset);
+            continue;
+        }
+
+        iter->target = location;
+        iter->is_bound = true;
+        m_relax_pending--;
+        m_relax_worklist.push_back(static_cast<size_t>(iter - m_relaxed_refs.begin()));
+    }
+
+    // If nothing moved, then only the references to this label need to be patched.
+    // Otherwise, anything spanning across moved code may need to be patched as well.
+    if (RelaxRefs(m_relax_worklist)) {
+        for (const auto& ref : m_relaxed_refs) {
+            if (ref.is_bound) {
+                PatchRelaxedRef(ref);
+            }
+        }
+    } else {
+        for (const auto index : m_relax_worklist) {
+            PatchRelaxedRef(m_relaxed_refs[index]);
+        }
+    }
+
+    // Pick up any shifts applied to the label itself.
+    SyncLabel(label);
+
+    if (m_relax_pending == 0) {
+        m_relaxed_refs.clear();
+        m_relax_aligns.clear();
+    }
+}
+
+bool Assembler::RelaxRefs(std::span<const size_t> bound) {
+    // The distance covered by every other bound reference stays the same
+    // until code moves, so only the newly bound ones need to be checked.
+    const auto needs_growing = [this](size_t index) {
+        const auto& ref = m_relaxed_refs[index];
+        return ref.form != RelaxForm::Fixed && GetRelaxedForm(ref) != ref.form;
+    };
+    if (std::none_of(bound.begin(), bound.end(), needs_growing)) {
+        return false;
+    }
+
+    bool moved = false;
+
+    // Growing a reference may push other references out of range,
+    // so keep going until everything settles. Since references only
+    // ever grow, this is guaranteed to terminate.
+    for (bool changed = true; changed;) {
+        changed = false;
+
+        for (size_t i = 0; i < m_relaxed_refs.size(); i++) {
+            const auto& ref = m_relaxed_refs[i];
+            if (!ref.is_bound || ref.form == RelaxForm::Fixed) {
+                continue;
+            }
+
+            const auto form = GetRelaxedForm(ref);
+            if (form != ref.form) {
+                GrowRelaxedRef(i, form);
+                changed = true;
+                moved = true;
+            }
+        }
+    }
+
+    return moved;
+}
+
+void Assembler::GrowRelaxedRef(size_t index, RelaxForm form) {
+    auto& ref = m_relaxed_refs[index];
+    const auto old_size = GetRelaxedRefSize(ref);
+    ref.form = form;
+
+    const auto shift_offset = ref.offset + static_cast<ptrdiff_t>(old_size);
+    const auto shift_size = static_cast<ptrdiff_t>(GetRelaxedRefSize(ref) - old_size);
+
+    ShiftRelaxedCode(shift_offset, shift_size);
+    RealignRelaxedCode();
+}
+
+void Assembler::ShiftRelaxedCode(ptrdiff_t offset, ptrdiff_t size) {
+    const auto cursor = m_buffer.GetCursorOffset();
+    const auto tail_size = static_cast<size_t>(cursor - offset);
+
+    // Make room at the end of the buffer, then move everything after the offset over.
+    for (ptrdiff_t i = 0; i < size; i += 2) {
+        m_buffer.Emit16(0);
+    }
+
+    auto* const tail = m_buffer.GetOffsetPointer(offset);
+    std::memmove(tail + size, tail, tail_size);
+
+    if (size < 0) {
+        m_buffer.RewindCursor(cursor + size);
+    }
+
+    for (auto& other : m_relaxed_refs) {
+        if (other.offset >= offset) {
+            other.offset += size;
+        }
+        if (other.is_bound && other.target >= offset) {
+            other.target += size;
+        }
+    }
+
+    for (auto& align : m_relax_aligns) {
+        if (align.offset >= offset) {
+            align.offset += size;
+        }
+    }
+
+    // Shifting everything past a point keeps the offsets sorted.
+    for (auto& ref : m_unresolved_refs) {
+        if (ref >= offset) {
+            ref += size;
+        }
+    }
+
+    m_relax_shifts.push_back({offset, size});
+}
+
+void Assembler::RealignRelaxedCode() {
+    for (auto& align : m_relax_aligns) {
+        const auto offset = align.offset;
+        const auto size = GetPaddingSize(m_buffer.GetOffsetAddress(offset), align.alignment);
+        if (size == align.size) {
+            continue;
+        }
+
+        // Everything after the padding moves, including anything bound right at its end.
+        // Empty padding starts where it ends, so its own offset has to be restored afterwards.
+        const auto end = offset + static_cast<ptrdiff_t>(align.size);
+        ShiftRelaxedCode(end, static_cast<ptrdiff_t>(size) - static_cast<ptrdiff_t>(align.size));
+        align.offset = offset;
+        align.size = size;
+
+        CodeBuffer padding{m_buffer.GetOffsetPointer(offset), size};
+        EmitPadding(padding, size, align.fill);
+    }
+}
+
+bool Assembler::IsCompressibleRef(const RelaxedRef& ref) const noexcept {
+    if (!m_extensions.Has(Extension::C)) {
+        return false;
+    }
+
+    if (ref.is_jump) {
+        // C.JAL only exists on RV32.
+        return ref.rs1 == x0 || (ref.rs1 == x1 && IsRV32(m_features));
+    }
+
+    // Only BEQ and BNE against zero have compressed equivalents.
+    if (ref.funct3 != 0b000 && ref.funct3 != 0b001) {
+        return false;
+    }
+
+    return (ref.rs2 == x0 && IsValid3BitCompressedReg(ref.rs1)) ||
+           (ref.rs1 == x0 && IsValid3BitCompressedReg(ref.rs2));
+}
+
+Assembler::RelaxForm Assembler::GetRelaxedForm(const RelaxedRef& ref) const noexcept {
+    const auto displacement = ref.target - ref.offset;
+    const auto reaches = [&](RelaxForm form) {
+        switch (form) {
+        case RelaxForm::Fixed:
+        case RelaxForm::Far:
+            return true;
+        case RelaxForm::Compressed:
+            return ref.is_jump ? IsValidCJTypeImm(displacement) : IsValidCBTypeImm(displacement);
+        case RelaxForm::Short:
+            return ref.is_jump ? IsValidJTypeImm(displacement) : IsValidBTypeImm(displacement);
+        case RelaxForm::Near:
+            return !ref.is_jump && IsValidJTypeImm(displacement - 4);
+        }
+        return true;
+    };
+
+    auto form = ref.form;
+    while (!reaches(form)) {
+        form = static_cast<RelaxForm>(static_cast<uint32_t>(form) + 1);
+    }
+
+    // AUIPC+JALR needs a register to hold the upper bits of the address.
+    if (form == RelaxForm::Far) {
+        BISCUIT_ASSERT(m_relax_scratch != x0 || (ref.is_jump && ref.rs1 != x0));
+    }
+
+    return form;
+}
+
+size_t Assembler::GetRelaxedRefSize(const RelaxedRef& ref) noexcept {
+    switch (ref.form) {
+    case RelaxForm::Compressed:
+        return 2;
+    case RelaxForm::Fixed:
+    case RelaxForm::Short:
+        return 4;
+    case RelaxForm::Near:
+        return 8;
+    case RelaxForm::Far:
+        return ref.is_jump ? 8 : 12;
+    }
+    return 4;
+}
+
+void Assembler::EncodeRelaxedRef(CodeBuffer& buffer, const RelaxedRef& ref) const noexcept {
+    const auto displacement = ref.is_bound ? ref.target - ref.offset : 0;
+
+    if (ref.is_jump) {
+        const GPR rd = ref.rs1;
+
+        if (ref.form == RelaxForm::Compressed) {
+            // C.J or C.JAL
+            BISCUIT_ASSERT(IsValidCJTypeImm(displacement));
+            const auto funct3 = rd == x0 ? 0b101U : 0b001U;
+            buffer.Emit16(TransformToCJTypeImm(static_cast<uint32_t>(displacement)) | (funct3 << 13) | 0b01);
+        } else if (ref.form == RelaxForm::Short) {
+            BISCUIT_ASSERT(IsValidJTypeImm(displacement));
+            EmitJType(buffer, static_cast<uint32_t>(displacement), rd, 0b1101111);
+        } else {
+            BISCUIT_ASSERT(IsValidPCRelPairImm(displacement));
+            const auto offset = static_cast<int32_t>(displacement);
+            const GPR link = rd != x0 ? rd : m_relax_scratch;
+
+            EmitUType(buffer, GetPCRelHi20(offset), link, 0b0010111);
+            EmitIType(buffer, static_cast<uint32_t>(GetPCRelLo12(offset)), link, 0b000, rd, 0b1100111);
+        }
+        return;
+    }
+
+    // Branch conditions come in pairs that only differ in the lowest bit,
+    // so flipping it gives us the inverse condition (e.g. BEQ <-> BNE).
+    const auto inverted_funct3 = ref.funct3 ^ 1;
+
+    switch (ref.form) {
+    case RelaxForm::Compressed: {
+        // C.BEQZ or C.BNEZ
+        BISCUIT_ASSERT(IsValidCBTypeImm(displacement));
+        const GPR rs = ref.rs1 == x0 ? ref.rs2 : ref.rs1;
+        const auto funct3 = 0b110 | ref.funct3;
+        buffer.Emit16((funct3 << 13) | TransformToCBTypeImm(static_cast<uint32_t>(displacement)) |
+                      (CompressedRegTo3BitEncoding(rs) << 7) | 0b01);
+        break;
+    }
+    case RelaxForm::Fixed:
+    case RelaxForm::Short:
+        BISCUIT_ASSERT(IsValidBTypeImm(displacement));
+        EmitBType(buffer, static_cast<uint32_t>(displacement), ref.rs2, ref.rs1, ref.funct3, 0b1100011);
+        break;
+    case RelaxForm::Near:
+        BISCUIT_ASSERT(IsValidJTypeImm(displacement - 4));
+        EmitBType(buffer, 8, ref.rs2, ref.rs1, inverted_funct3, 0b1100011);
+        EmitJType(buffer, static_cast<uint32_t>(displacement - 4), x0, 0b1101111);
+        break;
+    case RelaxForm::Far: {
+        BISCUIT_ASSERT(IsValidPCRelPairImm(displacement - 4));
+        const auto offset = static_cast<int32_t>(displacement - 4);
+
+        EmitBType(buffer, 12, ref.rs2, ref.rs1, inverted_funct3, 0b1100011);
+        EmitUType(buffer, GetPCRelHi20(offset), m_relax_scratch, 0b0010111);
+        EmitIType(buffer, static_cast<uint32_t>(GetPCRelLo12(offset)), m_relax_scratch, 0b000, x0, 0b1100111);
+        break;
+    }
+    }
+}
+
+void Assembler::PatchRelaxedRef(const RelaxedRef& ref) noexcept {
+    auto* const ptr = m_buffer.GetOffsetPointer(ref.offset);
+
+    if (ref.form == RelaxForm::Fixed) {
+        PatchLabelReference(ptr, ref.target - ref.offset);
+        return;
+    }
+
+    CodeBuffer patch{ptr, GetRelaxedRefSize(ref)};
+    EncodeRelaxedRef(patch, ref);
+}
+
+void Assembler::DiscardRelaxedRefs(ptrdiff_t offset) noexcept {
+    while (!m_relaxed_refs.empty() && m_relaxed_refs.back().offset >= offset) {
+        if (!m_relaxed_refs.back().is_bound) {
+            m_relax_pending--;
+        }
+        m_relaxed_refs.pop_back();
+    }
+
+    while (!m_relax_aligns.empty() && m_relax_aligns.back().offset >= offset) {
+        m_relax_aligns.pop_back();
+    }
+}
+
+void Assembler::SetLiteralPool(bool enabled, uint32_t max_inline, ptrdiff_t max_distance) noexcept {
+    BISCUIT_ASSERT(max_distance > 0 && IsValidPCRelPairImm(max_distance));
+
+    m_literal_pool_enabled = enabled;
+    m_literal_pool_max_inline = max_inline;
+    m_literal_pool_max_distance = max_distance;
+}
+
+void Assembler::FlushLiteralPool(bool branch_over) {
+    if (GetPendingLiteralCount() == 0) {
+        return;
+    }
+
+    auto skip = Label::Local();
+    if (branch_over) {
+        J(&skip);
+    }
+
+    // Keep the literals naturally aligned for LD. The padding is never
+    // executed, so it's filled with illegal instructions.
+    Align(sizeof(uint64_t), AlignFill::Zero);
+
+    for (size_t i = m_literals_first_pending; i < m_literals.size(); i++) {
+        auto& literal = m_literals[i];
+        Bind(&literal.label);
+        m_buffer.Emit(literal.value);
+        SkipSchedule();
+    }
+    m_literals_first_pending = m_literals.size();
+
+    if (branch_over) {
+        Bind(&skip);
+    }
+}
+
+void Assembler::SetScheduler(InstructionScheduler* scheduler) {
+    FlushSchedule();
+    m_scheduler = scheduler;
+    SkipSchedule();
+}
+
+void Assembler::FlushSchedule() {
+    if (m_scheduler == nullptr) {
+        return;
+    }
+
+    const auto cursor = m_buffer.GetCursorOffset();
+    ScheduleRange(m_schedule_start, cursor);
+    m_schedule_start = cursor;
+}
+
+void Assembler::ScheduleRange(ptrdiff_t begin, ptrdiff_t end) {
+    // The buffer may have been replaced through GetCodeBuffer() since the last flush.
+    begin = std::min(begin, end);
+    if (end - begin < 4) {
+        return;
+    }
+
+    const auto size = static_cast<size_t>(end - begin);
+    m_scheduler->Schedule({m_buffer.GetOffsetPointer(begin), size}, m_features);
+}
+
+void Assembler::Cold(ColdBlock block) {
+    BISCUIT_ASSERT(block != nullptr);
+    m_cold_blocks.push_back(std::move(block));
+}
+
+CodeRange Assembler::FlushColdSection() {
+    const auto start = m_buffer.GetCursorOffset();
+
+    // Blocks may defer further blocks while being emitted, which land at the end of the list.
+    for (size_t i = 0; i < m_cold_blocks.size(); i++) {
+        // Cold blocks are only ever entered through branches, as is the section itself.
+        InvalidateVTypeState();
+
+        // Moved out first, since emitting may grow the list and invalidate references into it.
+        auto block = std::move(m_cold_blocks[i]);
+        block();
+    }
+    m_cold_blocks.clear();
+
+    return {start, static_cast<size_t>(m_buffer.GetCursorOffset() - start)};
+}
+
+CodeRange Assembler::ReserveRegion(Label* label, size_t size) {
+    BISCUIT_ASSERT(size % 2 == 0);
+    // The region is only known by its offset, which relaxation may change.
+    BISCUIT_ASSERT(!m_relax_branches);
+
+    // The region's contents are swapped out behind the scheduler's back.
+    FlushSchedule();
+
+    const auto offset = m_buffer.GetCursorOffset();
+    if (label != nullptr) {
+        Bind(label);
+    }
+    EmitPadding(m_buffer, size, AlignFill::Nop);
+    SkipSchedule();
+
+    // Whatever the region ends up containing may change the vector configuration.
+    InvalidateVTypeState();
+
+    return {offset, size};
+}
+
+void Assembler::ReassembleRegion(const CodeRange& region, const RegionEmitter& emit, RegionFill fill) {
+    BISCUIT_ASSERT(region.size % 2 == 0);
+    const auto end = region.offset + static_cast<ptrdiff_t>(region.size);
+
+    Assembler region_as{size_t{0}};
+    region_as.SwapCodeBuffer(m_buffer.CreateView(region));
+    region_as.m_features = m_features;
+    region_as.m_extensions = m_extensions;
+    region_as.m_auto_compress = m_auto_compress;
+    region_as.m_patchable_slots = m_patchable_slots;
+    region_as.m_record_relocations = m_record_relocations;
+    region_as.m_tuning = m_tuning;
+    region_as.m_reassembling = true;
+
+    emit(region_as);
+
+    // References to labels bound later on would patch the region's previous
+    // contents from then on, so everything has to be resolved by now.
+    auto& buffer = region_as.m_buffer;
+    BISCUIT_ASSERT(region_as.GetFinalizedOffset() == buffer.GetCursorOffset());
+
+    const auto remaining = static_cast<size_t>(end - buffer.GetCursorOffset());
+    if (fill == RegionFill::Jump && remaining > sizeof(uint32_t)) {
+        BISCUIT_ASSERT(IsValidJTypeImm(static_cast<ptrdiff_t>(remaining)));
+        buffer.Emit32(enc::J(static_cast<int32_t>(remaining)));
+        EmitPadding(buffer, remaining - sizeof(uint32_t), AlignFill::Zero);
+    } else {
+        EmitPadding(buffer, remaining, AlignFill::Nop);
+    }
+
+    if (m_record_relocations) {
+        std::erase_if(m_relocations, [&](const Relocation& relocation) {
+            return relocation.offset >= region.offset && relocation.offset < end;
+        });
+
+        // Keep the relocations sorted by offset.
+        const auto position = std::lower_bound(m_relocations.begin(), m_relocations.end(), region.offset,
+                                               [](const Relocation& relocation, ptrdiff_t value) {
+                                                   return relocation.offset < value;
+                                               });
+        m_relocations.insert(position, region_as.m_relocations.begin(), region_as.m_relocations.end());
+    }
+
+    m_buffer.FlushInstructionCache({&region, 1});
+}
+
+Label* Assembler::GetLiteralLabel(uint64_t value) {
+    // Flush before the pending literals drift out of range of their first reference.
+    if (GetPendingLiteralCount() != 0 &&
+        m_buffer.GetCursorOffset() - m_literals_first_ref > m_literal_pool_max_distance) {
+        FlushLiteralPool(true);
+    }
+
+    const auto cursor = m_buffer.GetCursorOffset();
+
+    if (const auto iter = m_literal_indices.find(value); iter != m_literal_indices.end()) {
+        auto& literal = m_literals[iter->second];
+
+        // Literals that have already been emitted can be reused while they're within reach.
+        if (!literal.label.IsBound() ||
+            cursor - *GetLabelLocation(&literal.label) <= m_literal_pool_max_distance) {
+            return &literal.label;
+        }
+    }
+
+    if (GetPendingLiteralCount() == 0) {
+        m_literals_first_ref = cursor;
+    }
+
+    m_literal_indices[value] = m_literals.size();
+    auto& literal = m_literals.emplace_back();
+    literal.value = value;
+    return &literal.label;
+}
+
+void Assembler::DiscardLiterals(ptrdiff_t offset) noexcept {
+    if (m_literals.empty()) {
+        return;
+    }
+
+    std::vector<Literal> kept;
+    kept.reserve(m_literals.size());
+
+    size_t first_pending = 0;
+    for (auto& literal : m_literals) {
+        SyncLabel(&literal.label);
+
+        if (literal.label.IsBound()) {
+            const auto location = *literal.label.GetLocation();
+            if (location + static_cast<ptrdiff_t>(sizeof(uint64_t)) > offset) {
+                continue;
+            }
+
+            kept.push_back(std::move(literal));
+            first_pending = kept.size();
+            continue;
+        }
+
+        // Drop references made from within the discarded code. Offsets are
+        // kept sorted, so these are always at the end.
+        auto& offsets = literal.label.m_offsets;
+        while (!offsets.empty() && offsets.back() >= offset) {
+            offsets.pop_back();
+        }
+
+        if (!offsets.empty()) {
+            kept.push_back(std::move(literal));
+        }
+    }
+
+    m_literals = std::move(kept);
+    m_literals_first_pending = first_pending;
+
+    m_literal_indices.clear();
+    for (size_t i = 0; i < m_literals.size(); i++) {
+        m_literal_indices[m_literals[i].value] = i;
+    }
+
+    if (GetPendingLiteralCount() != 0) {
+        m_literals_first_ref = m_literals[m_literals_first_pending].label.m_offsets[0];
+        for (size_t i = m_literals_first_pending; i < m_literals.size(); i++) {
+            m_literals_first_ref = std::min(m_literals_first_ref, m_literals[i].label.m_offsets[0]);
+        }
+    }
+}
+
+void Assembler::SetRelocationRecording(bool enabled) noexcept {
+    BISCUIT_ASSERT(!enabled || !m_relax_branches);
+    m_record_relocations = enabled;
+}
+
+void Assembler::EmitAddress(Label* label) {
+    EmitDataReference(RelocationKind::Absolute64, label, 0);
+}
+
+void Assembler::EmitAddress32(Label* label) {
+    EmitDataReference(RelocationKind::Absolute32, label, 0);
+}
+
+void Assembler::EmitJumpTableEntry(Label* target, Label* table) {
+    BISCUIT_ASSERT(table != nullptr);
+    BISCUIT_ASSERT(table->IsBound());
+    EmitDataReference(RelocationKind::JumpTableEntry, target, *table->GetLocation());
+}
+
+void Assembler::SetPatchableSlots(bool enabled) noexcept {
+    BISCUIT_ASSERT(!enabled || !m_relax_branches);
+    m_patchable_slots = enabled;
+}
+
+bool Assembler::RetargetBranch(ptrdiff_t offset, uintptr_t target) {
+    uint32_t instruction = 0;
+    std::memcpy(&instruction, m_buffer.GetOffsetPointer(offset), sizeof(instruction));
+
+    const auto value = static_cast<ptrdiff_t>(target - m_buffer.GetOffsetAddress(offset));
+    const auto opcode = instruction & 0x7F;
+
+    RelocationKind kind{};
+    if (opcode == 0b1100011) {
+        if (!IsValidBTypeImm(value)) {
+            return false;
+        }
+        kind = RelocationKind::BType;
+    } else {
+        BISCUIT_ASSERT(opcode == 0b1101111);
+        if (!IsValidJTypeImm(value)) {
+            return false;
+        }
+        kind = RelocationKind::JType;
+    }
+
+    PatchRelocation(reinterpret_cast<uint8_t*>(&instruction), kind, value);
+    m_buffer.PatchInstruction(offset, instruction);
+    return true;
+}
+
+bool Assembler::RetargetCall(ptrdiff_t offset, uintptr_t target) {
+    std::array<uint32_t, 2> pair{};
+    std::memcpy(pair.data(), m_buffer.GetOffsetPointer(offset), sizeof(pair));
+
+    const auto [auipc, jump] = pair;
+    BISCUIT_ASSERT((auipc & 0x7F) == 0b0010111);
+    BISCUIT_ASSERT((jump & 0x7F) == 0b1100111 || (jump & 0x7F) == 0b1101111);
+
+    const GPR base{(auipc >> 7) & 0x1F};
+    const GPR link{(jump >> 7) & 0x1F};
+
+    // The AUIPC stays as-is, so the JALR can only reach targets within
+    // its 12-bit offset of the address the AUIPC already produces.
+    const auto value = static_cast<ptrdiff_t>(target - m_buffer.GetOffsetAddress(offset));
+    const auto upper = static_cast<ptrdiff_t>(static_cast<int32_t>(auipc & 0xFFFFF000));
+    const auto lower = value - upper;
+
+    // Otherwise a JAL in place of the JALR can take over. The AUIPC
+    // still writes to its register as before, it just goes unused.
+    const auto jal_offset = value - 4;
+
+    uint32_t replacement = 0;
+    if (IsValidSigned12BitImm(lower)) {
+        replacement = enc::JALR(link, static_cast<int32_t>(lower), base);
+    } else if (IsValidJTypeImm(jal_offset)) {
+        replacement = enc::JAL(link, static_cast<int32_t>(jal_offset));
+    } else {
+        return false;
+    }
+
+    m_buffer.PatchInstruction(offset + 4, replacement);
+    return true;
+}
+
+void Assembler::AlignPatchSlot() noexcept {
+    if (!m_patchable_slots) {
+        return;
+    }
+
+    Align(4);
+}
+
+void Assembler::SELECT(GPR rd, GPR cond, GPR a, GPR b, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != cond && scratch != a && scratch != b);
+
+    if (a == b) {
+        if (rd != a) {
+            MV(rd, a);
+        }
+    } else if (TryEmitShortForwardSelect(rd, cond, a, b)) {
+        // The condition is branched on directly, so it needn't be normalized.
+    } else if (m_extensions.Has(Extension::Zicond)) {
+        // Both halves read the condition before rd is written.
+        CZERO_EQZ(scratch, a, cond);
+        CZERO_NEZ(rd, b, cond);
+        OR(rd, rd, scratch);
+    } else {
+        SNEZ(scratch, cond);
+        EmitSelect(rd, scratch, a, b);
+    }
+}
+
+void Assembler::SELECT_MIN(GPR rd, GPR a, GPR b, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != a && scratch != b);
+
+    if (m_extensions.Has(Extension::Zbb)) {
+        MIN(rd, a, b);
+    } else {
+        SLT(scratch, a, b);
+        EmitSelect(rd, scratch, a, b);
+    }
+}
+
+void Assembler::SELECT_MAX(GPR rd, GPR a, GPR b, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != a && scratch != b);
+
+    if (m_extensions.Has(Extension::Zbb)) {
+        MAX(rd, a, b);
+    } else {
+        SLT(scratch, a, b);
+        EmitSelect(rd, scratch, b, a);
+    }
+}
+
+void Assembler::SELECT_MINU(GPR rd, GPR a, GPR b, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != a && scratch != b);
+
+    if (m_extensions.Has(Extension::Zbb)) {
+        MINU(rd, a, b);
+    } else {
+        SLTU(scratch, a, b);
+        EmitSelect(rd, scratch, a, b);
+    }
+}
+
+void Assembler::SELECT_MAXU(GPR rd, GPR a, GPR b, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != a && scratch != b);
+
+    if (m_extensions.Has(Extension::Zbb)) {
+        MAXU(rd, a, b);
+    } else {
+        SLTU(scratch, a, b);
+        EmitSelect(rd, scratch, b, a);
+    }
+}
+
+void Assembler::CLAMP(GPR rd, GPR rs, GPR lo, GPR hi, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != rs && scratch != lo && scratch != hi);
+
+    // With lo <= hi, clamping from either side first gives the same result,
+    // so the order is picked to not overwrite the bound that's needed second.
+    if (rd != hi) {
+        SELECT_MAX(rd, rs, lo, scratch);
+        SELECT_MIN(rd, rd, hi, scratch);
+    } else if (rd != lo) {
+        SELECT_MIN(rd, rs, hi, scratch);
+        SELECT_MAX(rd, rd, lo, scratch);
+    }
+}
+
+void Assembler::CLAMPU(GPR rd, GPR rs, GPR lo, GPR hi, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != rs && scratch != lo && scratch != hi);
+
+    if (rd != hi) {
+        SELECT_MAXU(rd, rs, lo, scratch);
+        SELECT_MINU(rd, rd, hi, scratch);
+    } else if (rd != lo) {
+        SELECT_MINU(rd, rs, hi, scratch);
+        SELECT_MAXU(rd, rd, lo, scratch);
+    }
+}
+
+void Assembler::SATURATING_ADDU(GPR rd, GPR a, GPR b, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != a && scratch != b);
+
+    // The sum wraps around exactly when it ends up less than either operand,
+    // so it's compared against whichever one survives the addition.
+    if (rd != a) {
+        ADD(rd, a, b);
+        SLTU(scratch, rd, a);
+    } else if (rd != b) {
+        ADD(rd, a, b);
+        SLTU(scratch, rd, b);
+    } else {
+        // Doubling a value wraps around exactly when its top bit is set.
+        SLTZ(scratch, a);
+        ADD(rd, a, a);
+    }
+    NEG(scratch, scratch);
+    OR(rd, rd, scratch);
+}
+
+void Assembler::SATURATING_SUBU(GPR rd, GPR a, GPR b, GPR scratch) noexcept {
+    BISCUIT_ASSERT(scratch != rd && scratch != a && scratch != b);
+
+    // max(a, b) - b is a - b, unless that would wrap around.
+    if (m_extensions.Has(Extension::Zbb) && rd != b) {
+        MAXU(rd, a, b);
+        SUB(rd, rd, b);
+        return;
+    }
+
+    SLTU(scratch, a, b);
+    SUB(rd, a, b);
+    if (m_extensions.Has(Extension::Zicond)) {
+        CZERO_NEZ(rd, rd, scratch);
+    } else {
+        ADDI(scratch, scratch, -1);
+        AND(rd, rd, scratch);
+    }
+}
+
+void Assembler::EmitSelect(GPR rd, GPR condition, GPR a, GPR b) noexcept {
+    if (a == b) {
+        if (rd != a) {
+            MV(rd, a);
+        }
+        return;
+    }
+
+    if (TryEmitShortForwardSelect(rd, condition, a, b)) {
+        return;
+    }
+
+    // Whichever of a and b rd aliases has to be read before rd is written.
+    if (m_extensions.Has(Extension::Zicond)) {
+        if (rd != a) {
+            CZERO_NEZ(rd, b, condition);
+            CZERO_EQZ(condition, a, condition);
+        } else {
+            CZERO_EQZ(rd, a, condition);
+            CZERO_NEZ(condition, b, condition);
+        }
+        OR(rd, rd, condition);
+        return;
+    }
+
+    // b ^ ((a ^ b) & mask) selects a where the mask is all ones, and b where it's zero.
+    // If rd aliases b, the roles swap around and the mask is inverted instead.
+    if (rd != b) {
+        NEG(condition, condition);
+        XOR(rd, a, b);
+        AND(rd, rd, condition);
+        XOR(rd, rd, b);
+    } else {
+        ADDI(condition, condition, -1);
+        XOR(rd, a, b);
+        AND(rd, rd, condition);
+        XOR(rd, rd, a);
+    }
+}
+
+bool Assembler::TryEmitShortForwardSelect(GPR rd, GPR condition, GPR a, GPR b) {
+    if (m_tuning == nullptr || !m_tuning->HasFusion(Fusion::ShortForwardBranch)) {
+        return false;
+    }
+
+    // If rd already holds one of the values, the move of the other one is skipped
+    // when it isn't wanted. Otherwise rd starts out as b, which is only possible
+    // if that doesn't overwrite the condition.
+    auto skip = Label::Local();
+    if (rd == a) {
+        BNEZ(condition, &skip);
+        MV(rd, b);
+    } else if (rd == b) {
+        BEQZ(condition, &skip);
+        MV(rd, a);
+    } else if (rd != condition) {
+        MV(rd, b);
+        BEQZ(condition, &skip);
+        MV(rd, a);
+    } else {
+        return false;
+    }
+    Bind(&skip);
+    return true;
+}
+
+void Assembler::RecordRelocation(RelocationKind kind, ptrdiff_t offset,
+                                 const Label* label, ptrdiff_t base) {
+    if (!m_record_relocations) {
+        return;
+    }
+
+    // References to local labels that are already bound can be recorded by location
+    // right away. Those made before the label is bound are detached once it is.
+    if (label != nullptr && label->IsBound() && IsLocalLabel(label)) {
+        m_relocations.push_back({
+            .kind = kind,
+            .offset = offset,
+            .target = *label->GetLocation(),
+            .base = base,
+        });
+        return;
+    }
+
+    m_relocations.push_back({
+        .kind = kind,
+        .offset = offset,
+        .label = label,
+        .base = base,
+    });
+}
+
+void Assembler::EmitDataReference(RelocationKind kind, Label* label, ptrdiff_t base) {
+    BISCUIT_ASSERT(label != nullptr);
+    // Data isn't tracked by relaxation, so it'd go stale once code moves.
+    BISCUIT_ASSERT(!m_relax_branches);
+
+    // Data ends the current block, and must not be scheduled itself.
+    FlushSchedule();
+
+    const auto offset = m_buffer.GetCursorOffset();
+    RecordRelocation(kind, offset, label, base);
+
+    if (kind == RelocationKind::Absolute64) {
+        m_buffer.Emit(uint64_t{0});
+    } else {
+        m_buffer.Emit32(0);
+    }
+    SkipSchedule();
+
+    const Relocation ref{
+        .kind = kind,
+        .offset = offset,
+        .label = label,
+        .base = base,
+    };
+
+    if (label->IsBound()) {
+        ApplyDataReference(m_buffer, ref, m_buffer.GetOffsetAddress(*label->GetLocation()));
+    } else {
+        m_pending_data_refs.push_back(ref);
+    }
+}
+
+void Assembler::ResolveDataReferences(const Label* label) {
+    if (m_pending_data_refs.empty()) {
+        return;
+    }
+
+    const auto target = m_buffer.GetOffsetAddress(*label->GetLocation());
+
+    const auto is_local = !m_relocations.empty() && IsLocalLabel(label);
+
+    std::erase_if(m_pending_data_refs, [&](const Relocation& ref) {
+        if (ref.label != label) {
+            return false;
+        }
+
+        ApplyDataReference(m_buffer, ref, target);
+        if (is_local) {
+            DetachLabelReference(label, ref.offset);
+        }
+        return true;
+    });
+}
+
+bool Assembler::IsLocalLabel(const Label* label) const noexcept {
+    return label->IsLocal() ||
+           std::find(m_region_labels.begin(), m_region_labels.end(), label) != m_region_labels.end();
+}
+
+void Assembler::DetachLabelReference(const Label* label, ptrdiff_t offset) noexcept {
+    // Only the offset is compared, since the label may have moved since the reference
+    // was made (like literals do as the pool grows). Each instruction or data
+    // reference has a single relocation, so the offset alone identifies it.
+    const auto matches = [offset](const Relocation& relocation) {
+        return relocation.offset == offset && relocation.label != nullptr;
+    };
+
+    // Relocations are recorded as code is emitted, so they're sorted by offset. Code
+    // written over through the code buffer directly may break that, in which case
+    // everything is searched.
+    auto iter = std::lower_bound(m_relocations.begin(), m_relocations.end(), offset,
+                                 [](const Relocation& relocation, ptrdiff_t value) {
+                                     return relocation.offset < value;
+                                 });
+    if (iter == m_relocations.end() || !matches(*iter)) {
+        iter = std::find_if(m_relocations.begin(), m_relocations.end(), matches);
+    }
+
+    // The reference may have been made while recording was disabled.
+    if (iter == m_relocations.end()) {
+        return;
+    }
+
+    iter->label = nullptr;
+    iter->target = *label->GetLocation();
+}
+
+void Assembler::DiscardRelocations(ptrdiff_t offset) noexcept {
+    const auto is_discarded = [offset](const Relocation& relocation) {
+        return relocation.offset >= offset;
+    };
+
+    std::erase_if(m_relocations, is_discarded);
+    std::erase_if(m_pending_data_refs, is_discarded);
+}
+
 } // namespace biscuit
@@ -248,7 +248,7 @@ void Assembler::C_BEQZ(GPR rs, int32_t offset) noexcept {
 }
 
 void Assembler::C_BEQZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    const auto address = LinkAndGetOffset(label, RelocationKind::CBType);
     C_BEQZ(rs, static_cast<int32_t>(address));
 }
 
@@ -257,7 +257,7 @@ void Assembler::C_BNEZ(GPR rs, int32_t offset) noexcept {
 }
 
 void Assembler::C_BNEZ(GPR rs, Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    const auto address = LinkAndGetOffset(label, RelocationKind::CBType);
     C_BNEZ(rs, static_cast<int32_t>(address));
 }
 
@@ -333,7 +333,7 @@ void Assembler::C_FSDSP(FPR rs, uint32_t imm) noexcept {
 }
 
 void Assembler::C_J(Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    const auto address = LinkAndGetOffset(label, RelocationKind::CJType);
     C_J(static_cast<int32_t>(address));
 }
 
@@ -342,12 +342,13 @@ void Assembler::C_J(int32_t offset) noexcept {
 }
 
 void Assembler::C_JAL(Label* label) noexcept {
-    const auto address = LinkAndGetOffset(label);
+    const auto address = LinkAndGetOffset(label, RelocationKind::CJType);
     C_JAL(static_cast<int32_t>(address));
 }
 
 void Assembler::C_JAL(int32_t offset) noexcept {
     BISCUIT_ASSERT(IsRV32(m_features));
+    InvalidateVTypeState();
     EmitCompressedJump(m_buffer, 0b001, offset, 0b01);
 }
 
@@ -376,6 +377,7 @@ void Assembler::C_FSWSP(FPR rs, uint32_t imm) noexcept {
 
 void Assembler::C_JALR(GPR rs) noexcept {
     BISCUIT_ASSERT(rs != x0);
+    InvalidateVTypeState();
     m_buffer.Emit16(0x9002 | (rs.Index() << 7));
 }
 
@@ -662,6 +664,7 @@ void Assembler::C_NOT(GPR rd) noexcept {
 
 void Assembler::CM_JALT(uint32_t index) noexcept {
     BISCUIT_ASSERT(index >= 32 && index <= 255);
+    InvalidateVTypeState();
     EmitCMJTType(m_buffer, 0b101000, index, 0b10);
 }
 void Assembler::CM_JT(uint32_t index) noexcept {
@@ -693,4 +696,377 @@ void Assembler::CM_PUSH(PushPopList reg_list, int32_t stack_adj) noexcept {
     EmitCMPPType(m_buffer, 0b101110, 0b00, reg_list, stack_adj, 0b10, m_features);
 }
 
+// Auto-compression
+
+bool Assembler::TryEmitCompressed(uint32_t instruction) noexcept {
+    if (!m_extensions.Has(Extension::C)) {
+        return false;
+    }
+
+    const auto opcode = instruction & 0x7F;
+    const auto funct3 = (instruction >> 12) & 0b111;
+    const auto funct7 = instruction >> 25;
+    const auto rd_index = (instruction >> 7) & 0x1F;
+    const auto rs1_index = (instruction >> 15) & 0x1F;
+    const auto rs2_index = (instruction >> 20) & 0x1F;
+    const GPR rd{rd_index};
+    const GPR rs1{rs1_index};
+    const GPR rs2{rs2_index};
+
+    const auto imm_i = static_cast<int32_t>(instruction) >> 20;
+    const auto imm_s = ((static_cast<int32_t>(instruction) >> 25) << 5) | static_cast<int32_t>(rd_index);
+    const auto shamt = (instruction >> 20) & 0x3F;
+
+    const bool has_zcb = m_extensions.Has(Extension::Zcb);
+    const auto is_creg = [](Register reg) { return IsValid3BitCompressedReg(reg); };
+
+    // Zcmp and Zcmt reuse the encodings of the compressed double-precision loads and stores.
+    const bool has_zcd = IsRV32OrRV64(m_features) &&
+                         !m_extensions.Has(Extension::Zcmp) && !m_extensions.Has(Extension::Zcmt);
+
+    // Checks whether a load/store offset fits an unsigned, scaled compressed immediate.
+    const auto fits = [](int32_t imm, int32_t scale, int32_t max) {
+        return imm >= 0 && imm <= max && imm % scale == 0;
+    };
+
+    switch (opcode) {
+    case 0b0010011: // OP-IMM
+        switch (funct3) {
+        case 0b000: // ADDI
+            // NOPs and hints keep their size.
+            if (rd == x0) {
+                return false;
+            }
+            if (rs1 == x0 && IsValidSigned6BitImm(imm_i)) {
+                C_LI(rd, imm_i);
+                return true;
+            }
+            if (rs1 != x0 && imm_i == 0) {
+                C_MV(rd, rs1);
+                return true;
+            }
+            if (rd == rs1 && rd == x2 && imm_i >= -512 && imm_i <= 496 && imm_i % 16 == 0) {
+                C_ADDI16SP(imm_i);
+                return true;
+            }
+            if (rd == rs1 && IsValidSigned6BitImm(imm_i)) {
+                C_ADDI(rd, imm_i);
+                return true;
+            }
+            if (rs1 == x2 && is_creg(rd) && imm_i != 0 && fits(imm_i, 4, 1020)) {
+                C_ADDI4SPN(rd, static_cast<uint32_t>(imm_i));
+                return true;
+            }
+            return false;
+        case 0b001:
+            if (rd != rs1 || rd == x0) {
+                return false;
+            }
+            // SLLI, as opposed to the Zbb and Zbs instructions sharing its encoding.
+            if ((instruction >> 26) == 0 && shamt != 0) {
+                C_SLLI(rd, shamt);
+                return true;
+            }
+            if (has_zcb && is_creg(rd) && (instruction >> 20) == 0x604) {
+                C_SEXT_B(rd);
+                return true;
+            }
+            if (has_zcb && is_creg(rd) && (instruction >> 20) == 0x605) {
+                C_SEXT_H(rd);
+                return true;
+            }
+            return false;
+        case 0b101:
+            if (rd != rs1 || !is_creg(rd) || shamt == 0) {
+                return false;
+            }
+            if ((instruction >> 26) == 0b000000) {
+                C_SRLI(rd, shamt);
+                return true;
+            }
+            if ((instruction >> 26) == 0b010000) {
+                C_SRAI(rd, shamt);
+                return true;
+            }
+            return false;
+        case 0b100: // XORI
+            if (has_zcb && rd == rs1 && is_creg(rd) && imm_i == -1) {
+                C_NOT(rd);
+                return true;
+            }
+            return false;
+        case 0b111: // ANDI
+            if (rd != rs1 || !is_creg(rd)) {
+                return false;
+            }
+            if (IsValidSigned6BitImm(imm_i)) {
+                C_ANDI(rd, static_cast<uint32_t>(imm_i));
+                return true;
+            }
+            if (has_zcb && imm_i == 0xFF) {
+                C_ZEXT_B(rd);
+                return true;
+            }
+            return false;
+        default:
+            return false;
+        }
+
+    case 0b0011011: // OP-IMM-32
+        if (funct3 == 0b000 && rd == rs1 && rd != x0 && IsValidSigned6BitImm(imm_i)) {
+            C_ADDIW(rd, imm_i);
+            return true;
+        }
+        return false;
+
+    case 0b0110111: { // LUI
+        const auto imm = static_cast<int32_t>(instruction) >> 12;
+        if (rd != x0 && rd != x2 && imm != 0 && IsValidSigned6BitImm(imm)) {
+            C_LUI(rd, static_cast<uint32_t>(imm) << 12);
+            return true;
+        }
+        return false;
+    }
+
+    case 0b0110011:   // OP
+    case 0b0111011: { // OP-32
+        const bool is_word = opcode == 0b0111011;
+
+        // Zcb's unary forms only have a single register, with rs2 being fixed as x0.
+        if (has_zcb && funct7 == 0b0000100 && rs2 == x0 && rd == rs1 && is_creg(rd)) {
+            // ZEXT.H is an OP-32 encoding on RV64, where the OP encoding zero-extends words instead.
+            if (funct3 == 0b100 && is_word == IsRV64OrRV128(m_features)) { // ZEXT.H
+                C_ZEXT_H(rd);
+                return true;
+            }
+            if (funct3 == 0b000 && is_word) { // ADD.UW rd, rs, zero (ZEXT.W)
+                C_ZEXT_W(rd);
+                return true;
+            }
+            return false;
+        }
+
+        if (funct7 == 0b0000000 && funct3 == 0b000 && !is_word) { // ADD
+            if (rd == x0) {
+                return false;
+            }
+            if (rs1 == x0 && rs2 != x0) {
+                C_MV(rd, rs2);
+            } else if (rs2 == x0 && rs1 != x0) {
+                C_MV(rd, rs1);
+            } else if (rd == rs1 && rs2 != x0) {
+                C_ADD(rd, rs2);
+            } else if (rd == rs2 && rs1 != x0) {
+                C_ADD(rd, rs1);
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        if (!is_creg(rd) || !is_creg(rs1) || !is_creg(rs2)) {
+            return false;
+        }
+
+        // Subtraction is the only one of these where the operands can't be swapped around.
+        const bool commutative = funct7 != 0b0100000;
+        if (rd != rs1 && !(commutative && rd == rs2)) {
+            return false;
+        }
+        const GPR other = rd == rs1 ? rs2 : rs1;
+
+        switch ((funct7 << 3) | funct3) {
+        case (0b0000000 << 3) | 0b000: // ADDW
+            C_ADDW(rd, other);
+            return true;
+        case (0b0100000 << 3) | 0b000: // SUB, SUBW
+            if (is_word) {
+                C_SUBW(rd, rs2);
+            } else {
+                C_SUB(rd, rs2);
+            }
+            return true;
+        case (0b0000000 << 3) | 0b100: // XOR
+            if (is_word) {
+                return false;
+            }
+            C_XOR(rd, other);
+            return true;
+        case (0b0000000 << 3) | 0b110: // OR
+            if (is_word) {
+                return false;
+            }
+            C_OR(rd, other);
+            return true;
+        case (0b0000000 << 3) | 0b111: // AND
+            if (is_word) {
+                return false;
+            }
+            C_AND(rd, other);
+            return true;
+        case (0b0000001 << 3) | 0b000: // MUL
+            if (is_word || !has_zcb) {
+                return false;
+            }
+            C_MUL(rd, other);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    case 0b1100111: // JALR
+        if (funct3 != 0b000 || imm_i != 0 || rs1 == x0) {
+            return false;
+        }
+        if (rd == x0) {
+            C_JR(rs1);
+            return true;
+        }
+        if (rd == x1) {
+            C_JALR(rs1);
+            return true;
+        }
+        return false;
+
+    case 0b0000011: // LOAD
+        switch (funct3) {
+        case 0b010: // LW
+            if (rs1 == x2 && rd != x0 && fits(imm_i, 4, 252)) {
+                C_LWSP(rd, static_cast<uint32_t>(imm_i));
+                return true;
+            }
+            if (is_creg(rd) && is_creg(rs1) && fits(imm_i, 4, 124)) {
+                C_LW(rd, static_cast<uint32_t>(imm_i), rs1);
+                return true;
+            }
+            return false;
+        case 0b011: // LD
+            if (!IsRV64OrRV128(m_features)) {
+                return false;
+            }
+            if (rs1 == x2 && rd != x0 && fits(imm_i, 8, 504)) {
+                C_LDSP(rd, static_cast<uint32_t>(imm_i));
+                return true;
+            }
+            if (is_creg(rd) && is_creg(rs1) && fits(imm_i, 8, 248)) {
+                C_LD(rd, static_cast<uint32_t>(imm_i), rs1);
+                return true;
+            }
+            return false;
+        case 0b100: // LBU
+            if (has_zcb && is_creg(rd) && is_creg(rs1) && fits(imm_i, 1, 3)) {
+                C_LBU(rd, static_cast<uint32_t>(imm_i), rs1);
+                return true;
+            }
+            return false;
+        case 0b001: // LH
+        case 0b101: // LHU
+            if (!has_zcb || !is_creg(rd) || !is_creg(rs1) || !fits(imm_i, 2, 2)) {
+                return false;
+            }
+            if (funct3 == 0b001) {
+                C_LH(rd, static_cast<uint32_t>(imm_i), rs1);
+            } else {
+                C_LHU(rd, static_cast<uint32_t>(imm_i), rs1);
+            }
+            return true;
+        default:
+            return false;
+        }
+
+    case 0b0100011: // STORE
+        switch (funct3) {
+        case 0b010: // SW
+            if (rs1 == x2 && fits(imm_s, 4, 252)) {
+                C_SWSP(rs2, static_cast<uint32_t>(imm_s));
+                return true;
+            }
+            if (is_creg(rs1) && is_creg(rs2) && fits(imm_s, 4, 124)) {
+                C_SW(rs2, static_cast<uint32_t>(imm_s), rs1);
+                return true;
+            }
+            return false;
+        case 0b011: // SD
+            if (!IsRV64OrRV128(m_features)) {
+                return false;
+            }
+            if (rs1 == x2 && fits(imm_s, 8, 504)) {
+                C_SDSP(rs2, static_cast<uint32_t>(imm_s));
+                return true;
+            }
+            if (is_creg(rs1) && is_creg(rs2) && fits(imm_s, 8, 248)) {
+                C_SD(rs2, static_cast<uint32_t>(imm_s), rs1);
+                return true;
+            }
+            return false;
+        case 0b000: // SB
+            if (has_zcb && is_creg(rs1) && is_creg(rs2) && fits(imm_s, 1, 3)) {
+                C_SB(rs2, static_cast<uint32_t>(imm_s), rs1);
+                return true;
+            }
+            return false;
+        case 0b001: // SH
+            if (has_zcb && is_creg(rs1) && is_creg(rs2) && fits(imm_s, 2, 2)) {
+                C_SH(rs2, static_cast<uint32_t>(imm_s), rs1);
+                return true;
+            }
+            return false;
+        default:
+            return false;
+        }
+
+    case 0b0000111: { // LOAD-FP
+        const FPR frd{rd_index};
+        if (funct3 == 0b011 && has_zcd) { // FLD
+            if (rs1 == x2 && fits(imm_i, 8, 504)) {
+                C_FLDSP(frd, static_cast<uint32_t>(imm_i));
+                return true;
+            }
+            if (is_creg(frd) && is_creg(rs1) && fits(imm_i, 8, 248)) {
+                C_FLD(frd, static_cast<uint32_t>(imm_i), rs1);
+                return true;
+            }
+        } else if (funct3 == 0b010 && IsRV32(m_features)) { // FLW
+            if (rs1 == x2 && fits(imm_i, 4, 252)) {
+                C_FLWSP(frd, static_cast<uint32_t>(imm_i));
+                return true;
+            }
+            if (is_creg(frd) && is_creg(rs1) && fits(imm_i, 4, 124)) {
+                C_FLW(frd, static_cast<uint32_t>(imm_i), rs1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    case 0b0100111: { // STORE-FP
+        const FPR frs2{rs2_index};
+        if (funct3 == 0b011 && has_zcd) { // FSD
+            if (rs1 == x2 && fits(imm_s, 8, 504)) {
+                C_FSDSP(frs2, static_cast<uint32_t>(imm_s));
+                return true;
+            }
+            if (is_creg(frs2) && is_creg(rs1) && fits(imm_s, 8, 248)) {
+                C_FSD(frs2, static_cast<uint32_t>(imm_s), rs1);
+                return true;
+            }
+        } else if (funct3 == 0b010 && IsRV32(m_features)) { // FSW
+            if (rs1 == x2 && fits(imm_s, 4, 252)) {
+                C_FSWSP(frs2, static_cast<uint32_t>(imm_s));
+                return true;
+            }
+            if (is_creg(frs2) && is_creg(rs1) && fits(imm_s, 4, 124)) {
+                C_FSW(frs2, static_cast<uint32_t>(imm_s), rs1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    default:
+        return false;
+    }
+}
+
 } // namespace biscuit
@@ -46,7 +46,12 @@ void Assembler::FLT_S(GPR rd, FPR rs1, FPR rs2) noexcept {
 }
 void Assembler::FLW(FPR rd, int32_t offset, GPR rs) noexcept {
     BISCUIT_ASSERT(IsValidSigned12BitImm(offset));
-    EmitIType(m_buffer, static_cast<uint32_t>(offset), rs, 0b010, rd, 0b0000111);
+    EmitCompressible(EncodeIType(static_cast<uint32_t>(offset), rs, 0b010, rd, 0b0000111));
+}
+void Assembler::FLW(FPR rd, Label* label, GPR temp) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    EmitIType(m_buffer, static_cast<uint32_t>(GetPCRelLo12(offset)), temp, 0b010, rd, 0b0000111);
 }
 void Assembler::FMADD_S(FPR rd, FPR rs1, FPR rs2, FPR rs3, RMode rmode) noexcept {
     EmitR4Type(m_buffer, rs3, 0b00, rs2, rs1, rmode, rd, 0b1000011);
@@ -92,7 +97,12 @@ void Assembler::FSUB_S(FPR rd, FPR rs1, FPR rs2, RMode rmode) noexcept {
 }
 void Assembler::FSW(FPR rs2, int32_t offset, GPR rs1) noexcept {
     BISCUIT_ASSERT(IsValidSigned12BitImm(offset));
-    EmitSType(m_buffer, static_cast<uint32_t>(offset), rs2, rs1, 0b010, 0b0100111);
+    EmitCompressible(EncodeSType(static_cast<uint32_t>(offset), rs2, rs1, 0b010, 0b0100111));
+}
+void Assembler::FSW(FPR rs2, Label* label, GPR temp) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    EmitSType(m_buffer, static_cast<uint32_t>(GetPCRelLo12(offset)), rs2, temp, 0b010, 0b0100111);
 }
 
 void Assembler::FABS_S(FPR rd, FPR rs) noexcept {
@@ -164,7 +174,12 @@ void Assembler::FLT_D(GPR rd, FPR rs1, FPR rs2) noexcept {
 }
 void Assembler::FLD(FPR rd, int32_t offset, GPR rs) noexcept {
     BISCUIT_ASSERT(IsValidSigned12BitImm(offset));
-    EmitIType(m_buffer, static_cast<uint32_t>(offset), rs, 0b011, rd, 0b0000111);
+    EmitCompressible(EncodeIType(static_cast<uint32_t>(offset), rs, 0b011, rd, 0b0000111));
+}
+void Assembler::FLD(FPR rd, Label* label, GPR temp) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    EmitIType(m_buffer, static_cast<uint32_t>(GetPCRelLo12(offset)), temp, 0b011, rd, 0b0000111);
 }
 void Assembler::FMADD_D(FPR rd, FPR rs1, FPR rs2, FPR rs3, RMode rmode) noexcept {
     EmitR4Type(m_buffer, rs3, 0b01, rs2, rs1, rmode, rd, 0b1000011);
@@ -204,7 +219,12 @@ void Assembler::FSUB_D(FPR rd, FPR rs1, FPR rs2, RMode rmode) noexcept {
 }
 void Assembler::FSD(FPR rs2, int32_t offset, GPR rs1) noexcept {
     BISCUIT_ASSERT(IsValidSigned12BitImm(offset));
-    EmitSType(m_buffer, static_cast<uint32_t>(offset), rs2, rs1, 0b011, 0b0100111);
+    EmitCompressible(EncodeSType(static_cast<uint32_t>(offset), rs2, rs1, 0b011, 0b0100111));
+}
+void Assembler::FSD(FPR rs2, Label* label, GPR temp) noexcept {
+    const auto offset = LinkAndGetPCRelOffset(label);
+    AUIPC(temp, static_cast<int32_t>(GetPCRelHi20(offset)));
+    EmitSType(m_buffer, static_cast<uint32_t>(GetPCRelLo12(offset)), rs2, temp, 0b011, 0b0100111);
 }
 
 void Assembler::FABS_D(FPR rd, FPR rs) noexcept {
@@ -2,6 +2,7 @@
 
 #include <biscuit/assert.hpp>
 #include <biscuit/code_buffer.hpp>
+#include <biscuit/encoding.hpp>
 #include <biscuit/registers.hpp>
 
 #include <cstddef>
@@ -16,21 +17,6 @@ namespace biscuit {
     return value >= -32 && value <= 31;
 }
 
-// S-type and I-type immediates are 12 bits in size
-[[nodiscard]] constexpr bool IsValidSigned12BitImm(ptrdiff_t value) {
-    return value >= -2048 && value <= 2047;
-}
-
-// B-type immediates only provide -4KiB to +4KiB range branches.
-[[nodiscard]] constexpr bool IsValidBTypeImm(ptrdiff_t value) {
-    return value >= -4096 && value <= 4095;
-}
-
-// J-type immediates only provide -1MiB to +1MiB range branches.
-[[nodiscard]] constexpr bool IsValidJTypeImm(ptrdiff_t value) {
-    return value >= -0x80000 && value <= 0x7FFFF;
-}
-
 // CB-type immediates only provide -256B to +256B range branches.
 [[nodiscard]] constexpr bool IsValidCBTypeImm(ptrdiff_t value) {
     return value >= -256 && value <= 255;
@@ -41,6 +27,24 @@ namespace biscuit {
     return IsValidSigned12BitImm(value);
 }
 
+// AUIPC paired with an I-type or S-type instruction provides a -2GiB to +2GiB range.
+[[nodiscard]] constexpr bool IsValidPCRelPairImm(ptrdiff_t value) {
+    return value >= -0x80000800LL && value <= 0x7FFFF7FFLL;
+}
+
+// Retrieves the upper 20 bits of a PC-relative offset, as used by AUIPC.
+//
+// 0x800 is added to cancel out the sign extension of the lower 12 bits
+// when they're used as the immediate of the following instruction.
+[[nodiscard]] constexpr uint32_t GetPCRelHi20(int32_t offset) {
+    return ((static_cast<uint32_t>(offset) + 0x800) >> 12) & 0xFFFFF;
+}
+
+// Retrieves the sign-extended lower 12 bits of a PC-relative offset.
+[[nodiscard]] constexpr int32_t GetPCRelLo12(int32_t offset) {
+    return static_cast<int32_t>(static_cast<uint32_t>(offset) << 20) >> 20;
+}
+
 // Determines whether or not the register fits in 3-bit compressed encoding.
 [[nodiscard]] constexpr bool IsValid3BitCompressedReg(Register reg) {
     const auto index = reg.Index();
@@ -57,26 +61,6 @@ namespace biscuit {
     return reg.Index() - 8;
 }
 
-// Transforms a regular value into an immediate encoded in a B-type instruction.
-[[nodiscard]] constexpr uint32_t TransformToBTypeImm(uint32_t imm) {
-    // clang-format off
-    return ((imm & 0x07E0) << 20) |
-           ((imm & 0x1000) << 19) |
-           ((imm & 0x001E) << 7) |
-           ((imm & 0x0800) >> 4);
-    // clang-format on
-}
-
-// Transforms a regular value into an immediate encoded in a J-type instruction.
-[[nodiscard]] constexpr uint32_t TransformToJTypeImm(uint32_t imm) {
-    // clang-format off
-    return ((imm & 0x0FF000) >> 0) |
-           ((imm & 0x000800) << 9) |
-           ((imm & 0x0007FE) << 20) |
-           ((imm & 0x100000) << 11);
-    // clang-format on
-}
-
 // Transforms a regular value into an immediate encoded in a CB-type instruction.
 [[nodiscard]] constexpr uint32_t TransformToCBTypeImm(uint32_t imm) {
     // clang-format off
@@ -106,44 +90,27 @@ namespace biscuit {
 // imm[12|10:5] | rs2 | rs1 | funct3 | imm[4:1] | imm[11] | opcode
 inline void EmitBType(CodeBuffer& buffer, uint32_t imm, GPR rs2, GPR rs1,
                       uint32_t funct3, uint32_t opcode) {
-    imm &= 0x1FFE;
-
-    buffer.Emit32(TransformToBTypeImm(imm) | (rs2.Index() << 20) | (rs1.Index() << 15) |
-                  ((funct3 & 0b111) << 12) | (opcode & 0x7F));
+    buffer.Emit32(EncodeBType(imm, rs2, rs1, funct3, opcode));
 }
 
 // Emits a I type RISC-V instruction. These consist of:
 // imm[11:0] | rs1 | funct3 | rd | opcode
 inline void EmitIType(CodeBuffer& buffer, uint32_t imm, Register rs1, uint32_t funct3,
                       Register rd, uint32_t opcode) {
-    imm &= 0xFFF;
-
-    buffer.Emit32((imm << 20) | (rs1.Index() << 15) | ((funct3 & 0b111) << 12) |
-                  (rd.Index() << 7) | (opcode & 0x7F));
+    buffer.Emit32(EncodeIType(imm, rs1, funct3, rd, opcode));
 }
 
 // Emits a J type RISC-V instruction. These consist of:
 // imm[20|10:1|11|19:12] | rd | opcode
 inline void EmitJType(CodeBuffer& buffer, uint32_t imm, GPR rd, uint32_t opcode) {
-    imm &= 0x1FFFFE;
-
-    buffer.Emit32(TransformToJTypeImm(imm) | rd.Index() << 7 | (opcode & 0x7F));
+    buffer.Emit32(EncodeJType(imm, rd, opcode));
 }
 
 // Emits a R type RISC instruction. These consist of:
 // funct7 | rs2 | rs1 | funct3 | rd | opcode
 inline void EmitRType(CodeBuffer& buffer, uint32_t funct7, Register rs2, Register rs1,
                       uint32_t funct3, Register rd, uint32_t opcode) {
-    // clang-format off
-    const auto value = ((funct7 & 0xFF) << 25) |
-                       (rs2.Index() << 20) |
-                       (rs1.Index() << 15) |
-                       ((funct3 & 0b111) << 12) |
-                       (rd.Index() << 7) |
-                       (opcode & 0x7F);
-    // clang-format off
-
-    buffer.Emit32(value);
+    buffer.Emit32(EncodeRType(funct7, rs2, rs1, funct3, rd, opcode));
 }
 
 // Emits a R type RISC instruction. These consist of:
@@ -166,21 +133,13 @@ inline void EmitR4Type(CodeBuffer& buffer, FPR rs3, uint32_t funct2, FPR rs2, FP
 // imm[11:5] | rs2 | rs1 | funct3 | imm[4:0] | opcode
 inline void EmitSType(CodeBuffer& buffer, uint32_t imm, Register rs2, GPR rs1,
                       uint32_t funct3, uint32_t opcode) {
-    imm &= 0xFFF;
-
-    // clang-format off
-    const auto new_imm = ((imm & 0x01F) << 7) |
-                         ((imm & 0xFE0) << 20);
-    // clang-format on
-
-    buffer.Emit32(new_imm | (rs2.Index() << 20) | (rs1.Index() << 15) |
-                  ((funct3 & 0b111) << 12) | (opcode & 0x7F));
+    buffer.Emit32(EncodeSType(imm, rs2, rs1, funct3, opcode));
 }
 
 // Emits a U type RISC-V instruction. These consist of:
 // imm[31:12] | rd | opcode
 inline void EmitUType(CodeBuffer& buffer, uint32_t imm, GPR rd, uint32_t opcode) {
-    buffer.Emit32((imm & 0x000FFFFF) << 12 | rd.Index() << 7 | (opcode & 0x7F));
+    buffer.Emit32(EncodeUType(imm, rd, opcode));
 }
 
 // Emits an atomic instruction.
@@ -204,6 +163,13 @@ inline void EmitFENCE(CodeBuffer& buffer, uint32_t fm, FenceOrder pred, FenceOrd
     // clang-format on
 }
 
+// Patches the offset of an already emitted instruction that references a label.
+//
+// Handles B-type and J-type instructions, AUIPC pairs, and compressed
+// branches and jumps. Any offset that's already encoded within the
+// instruction is replaced.
+void PatchLabelReference(uint8_t* ptr, ptrdiff_t encoded_offset);
+
 // Internal helpers for siloing away particular comparisons for behavior.
 constexpr bool IsRV32(ArchFeature feature) {
     return feature == ArchFeature::RV32;
@@ -242,6 +242,15 @@ void EmitVectorOPFVF(CodeBuffer& buffer, uint32_t funct6, VecMask vm, Vec vs2, F
 
     buffer.Emit32(value | 0b1010111);
 }
+
+// Gets log2(SEW/LMUL) from a vtype immediate. Configurations with the
+// same ratio have the same VLMAX, and so result in the same vl.
+int32_t GetVTypeRatio(uint32_t vtype) {
+    const auto lmul = static_cast<int32_t>(vtype & 0b111);
+    const auto sew = static_cast<int32_t>((vtype >> 3) & 0b111);
+    const auto lmul_log2 = lmul < 4 ? lmul : lmul - 8;
+    return sew - lmul_log2;
+}
 } // Anonymous namespace
 
 // Vector Integer Arithmetic Instructions
@@ -1573,21 +1582,25 @@ void Assembler::VLUXEI64(Vec vd, GPR rs, Vec vs, VecMask mask) noexcept {
 }
 
 void Assembler::VLE8FF(Vec vd, GPR rs, VecMask mask) noexcept {
+    InvalidateVTypeState();
     EmitVectorLoad(m_buffer, 0b000, false, AddressingMode::UnitStride, mask,
                    UnitStrideLoadAddressingMode::LoadFaultOnlyFirst, rs, WidthEncoding::E8, vd);
 }
 
 void Assembler::VLE16FF(Vec vd, GPR rs, VecMask mask) noexcept {
+    InvalidateVTypeState();
     EmitVectorLoad(m_buffer, 0b000, false, AddressingMode::UnitStride, mask,
                    UnitStrideLoadAddressingMode::LoadFaultOnlyFirst, rs, WidthEncoding::E16, vd);
 }
 
 void Assembler::VLE32FF(Vec vd, GPR rs, VecMask mask) noexcept {
+    InvalidateVTypeState();
     EmitVectorLoad(m_buffer, 0b000, false, AddressingMode::UnitStride, mask,
                    UnitStrideLoadAddressingMode::LoadFaultOnlyFirst, rs, WidthEncoding::E32, vd);
 }
 
 void Assembler::VLE64FF(Vec vd, GPR rs, VecMask mask) noexcept {
+    InvalidateVTypeState();
     EmitVectorLoad(m_buffer, 0b000, false, AddressingMode::UnitStride, mask,
                    UnitStrideLoadAddressingMode::LoadFaultOnlyFirst, rs, WidthEncoding::E64, vd);
 }
@@ -1939,10 +1952,35 @@ void Assembler::VSETIVLI(GPR rd, uint32_t imm, SEW sew, LMUL lmul, VTA vta, VMA
                       (static_cast<uint32_t>(vma) << 7);
     // clang-format on
 
+    if (m_vtype_tracking) {
+        auto& state = m_vtype_state;
+        if (rd == x0 && state.vl_known && state.avl == imm) {
+            if (state.vtype == zimm) {
+                return;
+            }
+
+            // The same AVL with the same VLMAX results in the same vl, so only vtype has
+            // to change. Cores can handle that without waiting on a new vl to be computed.
+            if (GetVTypeRatio(state.vtype) == GetVTypeRatio(zimm)) {
+                m_buffer.Emit32(0x00007057U | (zimm << 20));
+                state.vtype = zimm;
+                return;
+            }
+        }
+
+        state = {
+            .vtype = zimm,
+            .avl = imm,
+            .vtype_known = true,
+            .vl_known = true,
+        };
+    }
+
     m_buffer.Emit32(0xC0007057U | (zimm << 20) | (imm << 15) | (rd.Index() << 7));
 }
 
 void Assembler::VSETVL(GPR rd, GPR rs1, GPR rs2) noexcept {
+    InvalidateVTypeState();
     m_buffer.Emit32(0x80007057U | (rs2.Index() << 20) | (rs1.Index() << 15) | (rd.Index() << 7));
 }
 
@@ -1954,6 +1992,23 @@ void Assembler::VSETVLI(GPR rd, GPR rs, SEW sew, LMUL lmul, VTA vta, VMA vma) no
                       (static_cast<uint32_t>(vma) << 7);
     // clang-format on
 
+    if (m_vtype_tracking) {
+        auto& state = m_vtype_state;
+        if (rd == x0 && rs == x0) {
+            if (state.vtype_known && state.vtype == zimm) {
+                return;
+            }
+
+            // vl is kept, but only stays valid as long as VLMAX doesn't change.
+            state.vl_known = state.vl_known && GetVTypeRatio(state.vtype) == GetVTypeRatio(zimm);
+        } else {
+            state.vl_known = false;
+        }
+
+        state.vtype = zimm;
+        state.vtype_known = true;
+    }
+
     m_buffer.Emit32(0x00007057U | (zimm << 20) | (rs.Index() << 15) | (rd.Index() << 7));
 }
 
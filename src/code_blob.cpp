@@ -0,0 +1,216 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/code_blob.hpp>
+#include <biscuit/label.hpp>
+
+#include <cstring>
+
+namespace biscuit {
+namespace {
+// "BSCB" when stored little-endian.
+constexpr uint32_t blob_magic = 0x42435342;
+
+// Symbol index used by relocations that target a location within the code.
+constexpr uint32_t internal_symbol = UINT32_MAX;
+
+// Layout of the blob header.
+struct BlobHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t tag;
+    uint32_t code_offset;
+    uint32_t code_size;
+    uint32_t relocation_offset;
+    uint32_t relocation_count;
+};
+
+// Layout of a relocation within the blob.
+struct BlobRelocation {
+    uint32_t kind;
+    uint32_t offset;
+    uint32_t symbol;   // External symbol ID, or internal_symbol.
+    uint32_t target;   // Offset of the target within the code, for internal symbols.
+    int64_t base;
+    int64_t addend;
+};
+
+constexpr size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Whether or not a relocation's value depends on where the code itself is located.
+constexpr bool IsPCRelative(RelocationKind kind) {
+    return kind != RelocationKind::Absolute32 && kind != RelocationKind::Absolute64;
+}
+
+constexpr bool IsValidKind(uint32_t kind) {
+    return kind <= static_cast<uint32_t>(RelocationKind::Absolute32);
+}
+
+// Number of bytes of code a relocation of the given kind patches.
+constexpr size_t GetPatchSize(RelocationKind kind) {
+    switch (kind) {
+    case RelocationKind::CBType:
+    case RelocationKind::CJType:
+        return 2;
+    case RelocationKind::PCRelPair:
+    case RelocationKind::Absolute64:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+Relocation ToRelocation(const BlobRelocation& stored) {
+    return {
+        .kind = static_cast<RelocationKind>(stored.kind),
+        .offset = static_cast<ptrdiff_t>(stored.offset),
+        .base = static_cast<ptrdiff_t>(stored.base),
+        .addend = stored.addend,
+    };
+}
+} // Anonymous namespace
+
+std::vector<uint8_t> SerializeCode(const CodeBuffer& buffer,
+                                   std::span<const Relocation> relocations,
+                                   const CodeBlobSymbolMapper& get_symbol,
+                                   uint64_t tag) {
+    const auto code_size = buffer.GetSizeInBytes();
+    BISCUIT_ASSERT(buffer.GetBaseOffset() == 0);
+    BISCUIT_ASSERT(code_size <= UINT32_MAX);
+
+    std::vector<BlobRelocation> stored;
+    stored.reserve(relocations.size());
+
+    for (const auto& relocation : relocations) {
+        const auto* const label = relocation.label;
+        const auto symbol = get_symbol && label != nullptr ? get_symbol(label) : std::nullopt;
+        if (!symbol) {
+            BISCUIT_ASSERT(label == nullptr || label->IsBound());
+
+            // References within the code stay valid wherever it's loaded.
+            if (IsPCRelative(relocation.kind)) {
+                continue;
+            }
+        }
+
+        BISCUIT_ASSERT(!symbol || *symbol != internal_symbol);
+        const auto target = symbol || label == nullptr ? relocation.target : *label->GetLocation();
+        stored.push_back({
+            .kind = static_cast<uint32_t>(relocation.kind),
+            .offset = static_cast<uint32_t>(relocation.offset),
+            .symbol = symbol.value_or(internal_symbol),
+            .target = symbol ? 0 : static_cast<uint32_t>(target),
+            .base = relocation.base,
+            .addend = relocation.addend,
+        });
+    }
+
+    const auto code_offset = AlignUp(sizeof(BlobHeader), code_blob_code_alignment);
+    const auto relocation_offset = AlignUp(code_offset + code_size, alignof(BlobRelocation));
+    const auto relocation_bytes = stored.size() * sizeof(BlobRelocation);
+
+    const BlobHeader header{
+        .magic = blob_magic,
+        .version = code_blob_version,
+        .tag = tag,
+        .code_offset = static_cast<uint32_t>(code_offset),
+        .code_size = static_cast<uint32_t>(code_size),
+        .relocation_offset = static_cast<uint32_t>(relocation_offset),
+        .relocation_count = static_cast<uint32_t>(stored.size()),
+    };
+
+    std::vector<uint8_t> blob(relocation_offset + relocation_bytes);
+    std::memcpy(blob.data(), &header, sizeof(header));
+    if (code_size != 0) {
+        std::memcpy(blob.data() + code_offset, buffer.GetOffsetPointer(0), code_size);
+    }
+    if (relocation_bytes != 0) {
+        std::memcpy(blob.data() + relocation_offset, stored.data(), relocation_bytes);
+    }
+
+    return blob;
+}
+
+std::optional<ptrdiff_t> LoadCode(CodeBuffer& buffer,
+                                  std::span<const uint8_t> blob,
+                                  const CodeBlobSymbolResolver& resolve_symbol,
+                                  uint64_t tag) {
+    if (blob.size() < sizeof(BlobHeader)) {
+        return std::nullopt;
+    }
+
+    BlobHeader header;
+    std::memcpy(&header, blob.data(), sizeof(header));
+
+    if (header.magic != blob_magic || header.version != code_blob_version || header.tag != tag) {
+        return std::nullopt;
+    }
+
+    const auto code_end = size_t{header.code_offset} + header.code_size;
+    const auto relocations_end = size_t{header.relocation_offset} +
+                                 size_t{header.relocation_count} * sizeof(BlobRelocation);
+    if (header.code_offset < sizeof(BlobHeader) || code_end > blob.size() ||
+        header.relocation_offset < code_end || relocations_end > blob.size()) {
+        return std::nullopt;
+    }
+
+    // Validate every relocation up front, so a bad blob never leaves
+    // partially relocated code behind in the buffer.
+    const auto* const relocation_data = blob.data() + header.relocation_offset;
+    for (uint32_t i = 0; i < header.relocation_count; i++) {
+        BlobRelocation relocation;
+        std::memcpy(&relocation, relocation_data + i * sizeof(BlobRelocation), sizeof(relocation));
+
+        if (!IsValidKind(relocation.kind)) {
+            return std::nullopt;
+        }
+
+        const auto size = GetPatchSize(static_cast<RelocationKind>(relocation.kind));
+        const bool target_valid = relocation.symbol != internal_symbol
+                                      ? static_cast<bool>(resolve_symbol)
+                                      : relocation.target <= header.code_size;
+        if (size_t{relocation.offset} + size > header.code_size || !target_valid) {
+            return std::nullopt;
+        }
+    }
+
+    if (!buffer.IsGrowable() && !buffer.HasSpaceFor(header.code_size)) {
+        return std::nullopt;
+    }
+
+    // Growing the buffer may move it, so make room first to know where the code ends up.
+    buffer.EnsureSpaceFor(header.code_size);
+    const auto base = buffer.GetCursorOffset();
+    const auto code_address = buffer.GetOffsetAddress(base);
+
+    // External symbols may be anywhere, and thus out of reach.
+    std::vector<uintptr_t> targets(header.relocation_count);
+    for (uint32_t i = 0; i < header.relocation_count; i++) {
+        BlobRelocation relocation;
+        std::memcpy(&relocation, relocation_data + i * sizeof(BlobRelocation), sizeof(relocation));
+
+        targets[i] = relocation.symbol == internal_symbol
+                         ? code_address + relocation.target
+                         : resolve_symbol(relocation.symbol);
+        if (!CanApplyRelocation(code_address, ToRelocation(relocation), targets[i])) {
+            return std::nullopt;
+        }
+    }
+
+    {
+        auto reservation = buffer.Reserve(header.code_size);
+        reservation.EmitBytes(blob.data() + header.code_offset, header.code_size);
+    }
+
+    auto* const code = buffer.GetOffsetPointer(base);
+
+    for (uint32_t i = 0; i < header.relocation_count; i++) {
+        BlobRelocation stored;
+        std::memcpy(&stored, relocation_data + i * sizeof(BlobRelocation), sizeof(stored));
+        ApplyRelocation(code, code_address, ToRelocation(stored), targets[i]);
+    }
+
+    return base;
+}
+
+} // namespace biscuit
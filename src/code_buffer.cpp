@@ -1,29 +1,116 @@
 #include <biscuit/assert.hpp>
 #include <biscuit/code_buffer.hpp>
+#include <biscuit/emission_stats.hpp>
 
+#include "code_memory.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <new>
 #include <utility>
 
 #ifdef BISCUIT_CODE_BUFFER_MMAP
 #include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(BISCUIT_CODE_BUFFER_MMAP) && defined(__linux__)
+#define BISCUIT_CODE_BUFFER_DUAL_MAPPING
+#endif
+
+#if defined(__riscv) && defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 
 namespace biscuit {
+namespace {
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+// Changes the protection of the pages spanning [begin, begin + size).
+void ProtectPages(uint8_t* begin, size_t size, int protection, bool huge_pages) {
+    static const auto system_page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto page_size = huge_pages ? uintptr_t{CodeBuffer::huge_page_size} : system_page_size;
+
+    const auto start = reinterpret_cast<uintptr_t>(begin) & ~(page_size - 1);
+    const auto end = (reinterpret_cast<uintptr_t>(begin) + size + page_size - 1) & ~(page_size - 1);
+
+    const auto result = mprotect(reinterpret_cast<void*>(start), end - start, protection);
+    BISCUIT_ASSERT(result == 0);
+}
+#endif
+
+#ifdef BISCUIT_CODE_BUFFER_DUAL_MAPPING
+// Maps both views of a dual-mapped buffer's file, failing if either can't be mapped.
+bool MapViews(int fd, size_t size, uint8_t** rw, uint8_t** rx) {
+    auto* const writable = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (writable == MAP_FAILED) {
+        return false;
+    }
+
+    auto* const executable = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+    if (executable == MAP_FAILED) {
+        munmap(writable, size);
+        return false;
+    }
+
+    *rw = static_cast<uint8_t*>(writable);
+    *rx = static_cast<uint8_t*>(executable);
+    return true;
+}
+#endif
+
+#ifndef BISCUIT_CODE_BUFFER_MMAP
+// Allocates zeroed memory for a buffer. Buffers grow on the (noexcept) emission path,
+// so running out of memory is treated like failing to map memory is, rather than thrown.
+uint8_t* AllocateBufferMemory(size_t size) noexcept {
+    auto* const memory = new (std::nothrow) uint8_t[size]();
+    BISCUIT_ASSERT(memory != nullptr);
+    return memory;
+}
+#endif
+
+// Synchronizes the instruction stream with the data written to [begin, end).
+void FlushRange(const uint8_t* begin, const uint8_t* end) {
+#if defined(__riscv) && defined(__linux__) && defined(__NR_riscv_flush_icache)
+    // Goes through the kernel so that every hart (including ones the
+    // current thread later migrates to) observes the new code.
+    syscall(__NR_riscv_flush_icache, begin, end, 0UL);
+#elif defined(__riscv)
+    (void)begin;
+    (void)end;
+    asm volatile("fence.i" ::: "memory");
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin___clear_cache(const_cast<char*>(reinterpret_cast<const char*>(begin)),
+                            const_cast<char*>(reinterpret_cast<const char*>(end)));
+#else
+    (void)begin;
+    (void)end;
+#endif
+}
+} // Anonymous namespace
+
+CodeBuffer::CodeBuffer(size_t capacity, CodeBufferMapping mapping, CodeBufferPages pages)
+    : m_capacity{capacity}, m_is_managed{true}, m_mapping{mapping}, m_pages{pages} {
+    BISCUIT_ASSERT(mapping == CodeBufferMapping::Single || IsDualMappingSupported());
 
-CodeBuffer::CodeBuffer(size_t capacity)
-    : m_capacity{capacity}, m_is_managed{true} {
     if (capacity == 0) {
         return;
     }
 
+    if (mapping == CodeBufferMapping::Dual) {
+        MapDual(capacity);
+        m_cursor = m_buffer;
+        return;
+    }
+
 #ifdef BISCUIT_CODE_BUFFER_MMAP
-    m_buffer = static_cast<uint8_t*>(mmap(nullptr, capacity,
-                                          PROT_READ | PROT_WRITE,
-                                          MAP_PRIVATE | MAP_ANONYMOUS,
-                                          -1, 0));
-    BISCUIT_ASSERT(m_buffer != nullptr);
+    const auto memory = MapCodeMemory(capacity, pages);
+    m_buffer = memory.memory;
+    m_capacity = memory.size;
+    m_huge_pages = memory.huge_pages;
 #else
-    m_buffer = new uint8_t[capacity]();
+    m_buffer = AllocateBufferMemory(capacity);
 #endif
 
     m_cursor = m_buffer;
@@ -38,7 +125,19 @@ CodeBuffer::CodeBuffer(CodeBuffer&& other) noexcept
     : m_buffer{std::exchange(other.m_buffer, nullptr)}
     , m_cursor{std::exchange(other.m_cursor, nullptr)}
     , m_capacity{std::exchange(other.m_capacity, size_t{0})}
-    , m_is_managed{std::exchange(other.m_is_managed, false)} {}
+    , m_base{std::exchange(other.m_base, ptrdiff_t{0})}
+    , m_is_managed{std::exchange(other.m_is_managed, false)}
+    , m_is_growable{std::exchange(other.m_is_growable, false)}
+    , m_is_view{std::exchange(other.m_is_view, false)}
+    , m_exec_buffer{std::exchange(other.m_exec_buffer, nullptr)}
+    , m_memfd{std::exchange(other.m_memfd, -1)}
+    , m_mapping{std::exchange(other.m_mapping, CodeBufferMapping::Single)}
+    , m_pages{std::exchange(other.m_pages, CodeBufferPages::Default)}
+    , m_huge_pages{std::exchange(other.m_huge_pages, false)}
+#ifdef BISCUIT_EMISSION_STATS
+    , m_stats{std::exchange(other.m_stats, nullptr)}
+#endif
+{}
 
 CodeBuffer& CodeBuffer::operator=(CodeBuffer&& other) noexcept {
     if (this == &other) {
@@ -48,7 +147,18 @@ CodeBuffer& CodeBuffer::operator=(CodeBuffer&& other) noexcept {
     std::swap(m_buffer, other.m_buffer);
     std::swap(m_cursor, other.m_cursor);
     std::swap(m_capacity, other.m_capacity);
+    std::swap(m_base, other.m_base);
     std::swap(m_is_managed, other.m_is_managed);
+    std::swap(m_is_growable, other.m_is_growable);
+    std::swap(m_is_view, other.m_is_view);
+    std::swap(m_exec_buffer, other.m_exec_buffer);
+    std::swap(m_memfd, other.m_memfd);
+    std::swap(m_mapping, other.m_mapping);
+    std::swap(m_pages, other.m_pages);
+    std::swap(m_huge_pages, other.m_huge_pages);
+#ifdef BISCUIT_EMISSION_STATS
+    std::swap(m_stats, other.m_stats);
+#endif
     return *this;
 }
 
@@ -57,6 +167,17 @@ CodeBuffer::~CodeBuffer() noexcept {
         return;
     }
 
+#ifdef BISCUIT_CODE_BUFFER_DUAL_MAPPING
+    if (IsDualMapped()) {
+        if (m_buffer != nullptr) {
+            munmap(m_buffer, m_capacity);
+            munmap(m_exec_buffer, m_capacity);
+            close(m_memfd);
+        }
+        return;
+    }
+#endif
+
 #ifdef BISCUIT_CODE_BUFFER_MMAP
     munmap(m_buffer, m_capacity);
 #else
@@ -64,6 +185,20 @@ CodeBuffer::~CodeBuffer() noexcept {
 #endif
 }
 
+bool CodeBuffer::IsDualMappingSupported() noexcept {
+#ifdef BISCUIT_CODE_BUFFER_DUAL_MAPPING
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef BISCUIT_EMISSION_STATS
+void CodeBuffer::RecordInstructionSlow(uint32_t encoding, size_t length) noexcept {
+    m_stats->RecordInstruction(encoding, length);
+}
+#endif
+
 void CodeBuffer::Grow(size_t new_capacity) {
     BISCUIT_ASSERT(IsManaged());
 
@@ -71,39 +206,272 @@ void CodeBuffer::Grow(size_t new_capacity) {
     if (new_capacity <= m_capacity) {
         return;
     }
+    new_capacity = GetCodeMemorySize(new_capacity, m_pages);
+
+    const auto size = GetSizeInBytes();
+
+#ifdef BISCUIT_EMISSION_STATS
+    if (m_stats != nullptr) {
+        m_stats->RecordGrow();
+    }
+#endif
 
-    const auto cursor_offset = GetCursorOffset();
+    // A buffer constructed with no capacity has no memory to carry over.
+    if (m_buffer == nullptr) {
+        const auto is_growable = m_is_growable;
+        auto* const stats = GetEmissionStats();
+        *this = CodeBuffer{new_capacity, m_mapping, m_pages};
+        m_is_growable = is_growable;
+        SetEmissionStats(stats);
+        return;
+    }
+
+#ifdef BISCUIT_CODE_BUFFER_DUAL_MAPPING
+    if (IsDualMapped()) {
+        // Grow the backing file first, then both views of it.
+        const auto truncated = ftruncate(m_memfd, static_cast<off_t>(new_capacity));
+        BISCUIT_ASSERT(truncated == 0);
+
+        if (m_pages == CodeBufferPages::Huge) {
+            // The contents live in the file, so the views can simply be recreated
+            // rather than remapped (which isn't supported for huge pages everywhere).
+            munmap(m_buffer, m_capacity);
+            munmap(m_exec_buffer, m_capacity);
+            MapDualViews(new_capacity);
+        } else {
+            auto* const rw = mremap(m_buffer, m_capacity, new_capacity, MREMAP_MAYMOVE);
+            auto* const rx = mremap(m_exec_buffer, m_capacity, new_capacity, MREMAP_MAYMOVE);
+            BISCUIT_ASSERT(rw != MAP_FAILED);
+            BISCUIT_ASSERT(rx != MAP_FAILED);
+
+            m_buffer = static_cast<uint8_t*>(rw);
+            m_exec_buffer = static_cast<uint8_t*>(rx);
+        }
+        m_capacity = new_capacity;
+        m_cursor = m_buffer + size;
+        return;
+    }
+#endif
 
 #ifdef BISCUIT_CODE_BUFFER_MMAP
-    auto* new_buffer = static_cast<uint8_t*>(mremap(m_buffer, m_capacity, new_capacity, MREMAP_MAYMOVE));
-    BISCUIT_ASSERT(new_buffer != nullptr);
+    uint8_t* new_buffer = nullptr;
+    if (m_pages == CodeBufferPages::Huge) {
+        // Remapping could move the memory to an address that isn't huge page aligned.
+        const auto memory = MapCodeMemory(new_capacity, m_pages);
+        std::memcpy(memory.memory, m_buffer, m_capacity);
+        munmap(m_buffer, m_capacity);
+        new_buffer = memory.memory;
+        m_huge_pages = memory.huge_pages;
+    } else {
+        auto* const remapped = mremap(m_buffer, m_capacity, new_capacity, MREMAP_MAYMOVE);
+        BISCUIT_ASSERT(remapped != MAP_FAILED);
+        new_buffer = static_cast<uint8_t*>(remapped);
+    }
 #else
-    auto* new_buffer = new uint8_t[new_capacity]();
+    auto* new_buffer = AllocateBufferMemory(new_capacity);
     std::memcpy(new_buffer, m_buffer, m_capacity);
     delete[] m_buffer;
 #endif
 
     m_buffer = new_buffer;
     m_capacity = new_capacity;
-    m_cursor = m_buffer + cursor_offset;
+    m_cursor = m_buffer + size;
+}
+
+ptrdiff_t CodeBuffer::ReleaseBefore(ptrdiff_t offset) noexcept {
+    BISCUIT_ASSERT(offset <= GetCursorOffset());
+
+    constexpr auto granularity = static_cast<ptrdiff_t>(release_granularity);
+    const auto released = offset / granularity * granularity - m_base;
+    if (released <= 0) {
+        return m_base;
+    }
+
+    const auto kept = static_cast<size_t>(m_cursor - m_buffer) - static_cast<size_t>(released);
+    std::memmove(m_buffer, m_buffer + released, kept);
+    m_cursor = m_buffer + kept;
+    m_base += released;
+    return m_base;
+}
+
+void CodeBuffer::GrowToFit(size_t num_bytes) noexcept {
+    BISCUIT_ASSERT(IsGrowable());
+
+    const auto required = GetSizeInBytes() + num_bytes;
+    auto new_capacity = m_capacity == 0 ? default_capacity : m_capacity;
+    while (new_capacity < required) {
+        new_capacity *= 2;
+    }
+
+    Grow(new_capacity);
+}
+
+CodeBuffer CodeBuffer::CreateView(const CodeRange& range) noexcept {
+    const auto end = range.offset + static_cast<ptrdiff_t>(range.size);
+    BISCUIT_ASSERT(range.offset >= m_base && end <= GetCursorOffset());
+
+    CodeBuffer view{GetOffsetPointer(range.offset), range.size};
+    view.m_base = range.offset;
+    view.m_is_view = true;
+    view.m_mapping = m_mapping;
+    view.m_huge_pages = m_huge_pages;
+    if (m_exec_buffer != nullptr) {
+        view.m_exec_buffer = m_exec_buffer + (range.offset - m_base);
+    }
+    return view;
 }
 
 void CodeBuffer::SetExecutable() {
+    if (IsDualMapped()) {
+        return;
+    }
+
 #ifdef BISCUIT_CODE_BUFFER_MMAP
     const auto result = mprotect(m_buffer, m_capacity, PROT_READ | PROT_EXEC);
     BISCUIT_ASSERT(result == 0);
-#else
-    // Unimplemented/Unnecessary for new
-    BISCUIT_ASSERT(false);
+#endif
+    // Memory from new can't have its protection changed, so there's nothing to do.
+}
+
+void CodeBuffer::SetExecutable([[maybe_unused]] ptrdiff_t offset, [[maybe_unused]] size_t size) {
+    offset -= m_base;
+    BISCUIT_ASSERT(offset >= 0);
+    BISCUIT_ASSERT(static_cast<size_t>(offset) + size <= m_capacity);
+
+    if (IsDualMapped() || size == 0) {
+        return;
+    }
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    ProtectPages(m_buffer + offset, size, PROT_READ | PROT_EXEC, m_huge_pages);
 #endif
 }
 
 void CodeBuffer::SetWritable() {
+    if (IsDualMapped()) {
+        return;
+    }
+
 #ifdef BISCUIT_CODE_BUFFER_MMAP
     const auto result = mprotect(m_buffer, m_capacity, PROT_READ | PROT_WRITE);
     BISCUIT_ASSERT(result == 0);
+#endif
+    // Memory from new can't have its protection changed, so there's nothing to do.
+}
+
+void CodeBuffer::SetWritable([[maybe_unused]] ptrdiff_t offset, [[maybe_unused]] size_t size) {
+    offset -= m_base;
+    BISCUIT_ASSERT(offset >= 0);
+    BISCUIT_ASSERT(static_cast<size_t>(offset) + size <= m_capacity);
+
+    if (IsDualMapped() || size == 0) {
+        return;
+    }
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    ProtectPages(m_buffer + offset, size, PROT_READ | PROT_WRITE, m_huge_pages);
+#endif
+}
+
+void CodeBuffer::FlushInstructionCache() const {
+    const CodeRange range{m_base, GetSizeInBytes()};
+    FlushInstructionCache({&range, 1});
+}
+
+void CodeBuffer::FlushInstructionCache(std::span<const CodeRange> ranges) const {
+    if (ranges.empty()) {
+        return;
+    }
+
+    const auto* const base = m_exec_buffer != nullptr ? m_exec_buffer : m_buffer;
+
+    // Ranges are given in offsets, which only start at the
+    // beginning of the memory if nothing has been released.
+    const auto to_memory = [this](const CodeRange& range) {
+        BISCUIT_ASSERT(range.offset >= m_base);
+        BISCUIT_ASSERT(static_cast<size_t>(range.offset - m_base) + range.size <= m_capacity);
+        return static_cast<size_t>(range.offset - m_base);
+    };
+
+#if defined(__riscv) && defined(__linux__)
+    // The kernel flushes whole harts rather than individual lines, so a
+    // single call spanning all of the ranges is as good as one per range.
+    auto begin = to_memory(ranges.front());
+    auto end = begin + ranges.front().size;
+    for (const auto& range : ranges) {
+        const auto start = to_memory(range);
+        begin = std::min(begin, start);
+        end = std::max(end, start + range.size);
+    }
+    FlushRange(base + begin, base + end);
+#else
+    for (const auto& range : ranges) {
+        const auto start = to_memory(range);
+        if (range.size != 0) {
+            FlushRange(base + start, base + start + range.size);
+        }
+    }
+#endif
+}
+
+void CodeBuffer::PatchInstruction(ptrdiff_t offset, uint32_t instruction) {
+    BISCUIT_ASSERT(offset >= m_base);
+    BISCUIT_ASSERT(offset + static_cast<ptrdiff_t>(sizeof(uint32_t)) <= GetCursorOffset());
+    BISCUIT_ASSERT(GetOffsetAddress(offset) % alignof(uint32_t) == 0);
+    BISCUIT_ASSERT(reinterpret_cast<uintptr_t>(GetOffsetPointer(offset)) % alignof(uint32_t) == 0);
+
+    // Naturally aligned 32-bit stores are single-copy atomic, unlike
+    // the memcpy that regular emission and label patching go through.
+    auto& slot = *reinterpret_cast<uint32_t*>(GetOffsetPointer(offset));
+    std::atomic_ref<uint32_t>{slot}.store(instruction, std::memory_order_release);
+
+    const CodeRange range{offset, sizeof(uint32_t)};
+    FlushInstructionCache({&range, 1});
+}
+
+void CodeBuffer::MapDual([[maybe_unused]] size_t capacity) {
+#ifdef BISCUIT_CODE_BUFFER_DUAL_MAPPING
+    capacity = GetCodeMemorySize(capacity, m_pages);
+
+#ifdef MFD_HUGETLB
+    // Huge pages are only reserved once the file is mapped, so
+    // that's where running short of them forces a fallback.
+    if (m_pages == CodeBufferPages::Huge) {
+        if (const auto fd = memfd_create("biscuit-code", MFD_CLOEXEC | MFD_HUGETLB); fd >= 0) {
+            if (ftruncate(fd, static_cast<off_t>(capacity)) == 0 &&
+                MapViews(fd, capacity, &m_buffer, &m_exec_buffer)) {
+                m_memfd = fd;
+                m_capacity = capacity;
+                m_huge_pages = true;
+                return;
+            }
+            close(fd);
+        }
+    }
+#endif
+
+    m_memfd = memfd_create("biscuit-code", MFD_CLOEXEC);
+    BISCUIT_ASSERT(m_memfd >= 0);
+    const auto truncated = ftruncate(m_memfd, static_cast<off_t>(capacity));
+    BISCUIT_ASSERT(truncated == 0);
+
+    m_capacity = capacity;
+    MapDualViews(capacity);
+#else
+    BISCUIT_ASSERT(false);
+#endif
+}
+
+void CodeBuffer::MapDualViews([[maybe_unused]] size_t capacity) {
+#ifdef BISCUIT_CODE_BUFFER_DUAL_MAPPING
+    const auto mapped = MapViews(m_memfd, capacity, &m_buffer, &m_exec_buffer);
+    BISCUIT_ASSERT(mapped);
+
+    if (m_pages == CodeBufferPages::Huge && !m_huge_pages) {
+        AdviseHugePages(m_buffer, capacity);
+        AdviseHugePages(m_exec_buffer, capacity);
+    }
 #else
-    // Unimplemented/Unnecessary for new
     BISCUIT_ASSERT(false);
 #endif
 }
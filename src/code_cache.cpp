@@ -0,0 +1,219 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/code_cache.hpp>
+
+#include "code_memory.hpp"
+
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+#include <sys/mman.h>
+#endif
+
+namespace biscuit {
+namespace {
+constexpr size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr bool IsPowerOfTwo(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+} // Anonymous namespace
+
+CodeCache::CodeCache(size_t capacity, [[maybe_unused]] CodeBufferPages pages)
+    : m_capacity{capacity} {
+    BISCUIT_ASSERT(capacity != 0);
+    BISCUIT_ASSERT(capacity <= max_capacity);
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    // Only reserve the address space. Pages are only backed once they're touched.
+    int flags = 0;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+
+    const auto memory = MapCodeMemory(capacity, pages, flags);
+    m_region = memory.memory;
+    m_capacity = memory.size;
+#else
+    m_region = new uint8_t[capacity];
+#endif
+    BISCUIT_ASSERT(m_capacity <= max_capacity);
+
+    m_free_ranges.emplace(0, m_capacity);
+}
+
+CodeCache::CodeCache(CodeCache&& other) noexcept
+    : m_region{std::exchange(other.m_region, nullptr)}
+    , m_capacity{std::exchange(other.m_capacity, size_t{0})}
+    , m_used_bytes{std::exchange(other.m_used_bytes, size_t{0})}
+    , m_allocations{std::move(other.m_allocations)}
+    , m_free_ranges{std::move(other.m_free_ranges)} {
+    other.m_allocations.clear();
+    other.m_free_ranges.clear();
+}
+
+CodeCache& CodeCache::operator=(CodeCache&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    std::swap(m_region, other.m_region);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_used_bytes, other.m_used_bytes);
+    std::swap(m_allocations, other.m_allocations);
+    std::swap(m_free_ranges, other.m_free_ranges);
+    return *this;
+}
+
+CodeCache::~CodeCache() noexcept {
+    if (m_region == nullptr) {
+        return;
+    }
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    munmap(m_region, m_capacity);
+#else
+    delete[] m_region;
+#endif
+}
+
+std::optional<CodeBuffer> CodeCache::Allocate(size_t size, size_t alignment) {
+    BISCUIT_ASSERT(size != 0);
+    BISCUIT_ASSERT(IsPowerOfTwo(alignment));
+
+    // First-fit. Slices are usually similarly sized, so this tends to be good enough.
+    for (const auto& [range_offset, range_size] : m_free_ranges) {
+        const auto offset = AlignOffset(range_offset, alignment);
+        if (offset + size > range_offset + range_size) {
+            continue;
+        }
+
+        ClaimRange(offset, size);
+        m_allocations.emplace(offset, Allocation{size, alignment});
+        m_used_bytes += size;
+        return CodeBuffer{m_region + offset, size};
+    }
+
+    return std::nullopt;
+}
+
+void CodeCache::Free(const uint8_t* ptr) {
+    BISCUIT_ASSERT(Contains(ptr));
+
+    const auto offset = static_cast<size_t>(ptr - m_region);
+    const auto iter = m_allocations.find(offset);
+    BISCUIT_ASSERT(iter != m_allocations.end());
+
+    const auto size = iter->second.size;
+    m_allocations.erase(iter);
+    m_used_bytes -= size;
+    ReleaseRange(offset, size);
+}
+
+void CodeCache::Free(const CodeBuffer& buffer) {
+    Free(buffer.GetOffsetPointer(0));
+}
+
+void CodeCache::Compact(const RelocationCallback& relocate) {
+    std::map<size_t, Allocation> compacted;
+    size_t next_offset = 0;
+
+    for (const auto& [offset, allocation] : m_allocations) {
+        const auto new_offset = AlignOffset(next_offset, allocation.alignment);
+        next_offset = new_offset + allocation.size;
+        compacted.emplace(new_offset, allocation);
+
+        if (new_offset == offset) {
+            continue;
+        }
+
+        // Slices only ever move down, and are visited in ascending order,
+        // so a moved slice can only ever overlap its own old location.
+        std::memmove(m_region + new_offset, m_region + offset, allocation.size);
+        if (relocate) {
+            relocate(m_region + offset, m_region + new_offset, allocation.size);
+        }
+    }
+
+    m_allocations = std::move(compacted);
+    m_free_ranges.clear();
+    if (next_offset < m_capacity) {
+        m_free_ranges.emplace(next_offset, m_capacity - next_offset);
+    }
+}
+
+size_t CodeCache::AlignOffset(size_t offset, size_t alignment) const noexcept {
+    // Alignment is in terms of addresses, since the region itself may not be aligned.
+    const auto base = reinterpret_cast<uintptr_t>(m_region);
+    return AlignUp(base + offset, alignment) - base;
+}
+
+size_t CodeCache::GetLargestFreeRange() const noexcept {
+    size_t largest = 0;
+    for (const auto& [offset, size] : m_free_ranges) {
+        if (size > largest) {
+            largest = size;
+        }
+    }
+    return largest;
+}
+
+void CodeCache::SetExecutable() {
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    const auto result = mprotect(m_region, m_capacity, PROT_READ | PROT_EXEC);
+    BISCUIT_ASSERT(result == 0);
+#endif
+    // Memory from new can't have its protection changed, so there's nothing to do.
+}
+
+void CodeCache::SetWritable() {
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    const auto result = mprotect(m_region, m_capacity, PROT_READ | PROT_WRITE);
+    BISCUIT_ASSERT(result == 0);
+#endif
+    // Memory from new can't have its protection changed, so there's nothing to do.
+}
+
+void CodeCache::ClaimRange(size_t offset, size_t size) {
+    // Find the free range that contains the claimed range.
+    auto iter = m_free_ranges.upper_bound(offset);
+    BISCUIT_ASSERT(iter != m_free_ranges.begin());
+    --iter;
+
+    const auto range_offset = iter->first;
+    const auto range_end = range_offset + iter->second;
+    BISCUIT_ASSERT(offset + size <= range_end);
+
+    m_free_ranges.erase(iter);
+    if (range_offset < offset) {
+        m_free_ranges.emplace(range_offset, offset - range_offset);
+    }
+    if (offset + size < range_end) {
+        m_free_ranges.emplace(offset + size, range_end - (offset + size));
+    }
+}
+
+void CodeCache::ReleaseRange(size_t offset, size_t size) {
+    auto [iter, inserted] = m_free_ranges.emplace(offset, size);
+    BISCUIT_ASSERT(inserted);
+
+    // Merge with the following range.
+    if (const auto next = std::next(iter); next != m_free_ranges.end() && offset + size == next->first) {
+        iter->second += next->second;
+        m_free_ranges.erase(next);
+    }
+
+    // Merge with the preceding range.
+    if (iter != m_free_ranges.begin()) {
+        const auto prev = std::prev(iter);
+        if (prev->first + prev->second == offset) {
+            prev->second += iter->second;
+            m_free_ranges.erase(iter);
+        }
+    }
+}
+
+} // namespace biscuit
@@ -0,0 +1,68 @@
+#include <biscuit/assert.hpp>
+
+#include "code_memory.hpp"
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+#include <sys/mman.h>
+#endif
+
+namespace biscuit {
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+CodeMemory MapCodeMemory(size_t size, CodeBufferPages pages, int flags) {
+    constexpr int protection = PROT_READ | PROT_WRITE;
+    flags |= MAP_PRIVATE | MAP_ANONYMOUS;
+    size = GetCodeMemorySize(size, pages);
+
+    if (pages != CodeBufferPages::Huge) {
+        auto* const memory = mmap(nullptr, size, protection, flags, -1, 0);
+        BISCUIT_ASSERT(memory != MAP_FAILED);
+        return {static_cast<uint8_t*>(memory), size, false};
+    }
+
+#ifdef MAP_HUGETLB
+    // Explicit huge pages come out of a reserved pool. Mapping them without a reservation
+    // would turn running out of them into a SIGBUS, rather than a failure to fall back from.
+    int huge_flags = flags | MAP_HUGETLB;
+#ifdef MAP_NORESERVE
+    huge_flags &= ~MAP_NORESERVE;
+#endif
+#ifdef MAP_HUGE_2MB
+    huge_flags |= MAP_HUGE_2MB;
+#endif
+
+    if (auto* const memory = mmap(nullptr, size, protection, huge_flags, -1, 0); memory != MAP_FAILED) {
+        return {static_cast<uint8_t*>(memory), size, true};
+    }
+#endif
+
+    // Transparent huge pages are only used for huge page aligned ranges,
+    // so map enough to carve one out and trim off the rest.
+    auto* const mapping = mmap(nullptr, size + CodeBuffer::huge_page_size, protection, flags, -1, 0);
+    BISCUIT_ASSERT(mapping != MAP_FAILED);
+
+    auto* const raw = static_cast<uint8_t*>(mapping);
+    const auto address = reinterpret_cast<uintptr_t>(raw);
+    const auto head = GetCodeMemorySize(address, CodeBufferPages::Huge) - address;
+    const auto tail = CodeBuffer::huge_page_size - head;
+    if (head != 0) {
+        munmap(raw, head);
+    }
+    if (tail != 0) {
+        munmap(raw + head + size, tail);
+    }
+
+    auto* const memory = raw + head;
+    AdviseHugePages(memory, size);
+    return {memory, size, false};
+}
+
+void AdviseHugePages([[maybe_unused]] void* memory, [[maybe_unused]] size_t size) noexcept {
+#ifdef MADV_HUGEPAGE
+    // Purely advisory, so failing (e.g. with THP disabled) is fine.
+    madvise(memory, size, MADV_HUGEPAGE);
+#endif
+}
+#endif
+
+} // namespace biscuit
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <biscuit/code_buffer.hpp>
+
+// Helpers for mapping memory that code is emitted into, shared
+// between code buffers and the code caches.
+
+namespace biscuit {
+
+/// Memory mapped by MapCodeMemory().
+struct CodeMemory {
+    uint8_t* memory = nullptr;
+    size_t size = 0;
+
+    // Whether or not the memory is backed by explicit huge pages.
+    bool huge_pages = false;
+};
+
+/// Rounds a size up to what mapping memory with the given pages requires.
+[[nodiscard]] constexpr size_t GetCodeMemorySize(size_t size, CodeBufferPages pages) noexcept {
+    if (pages != CodeBufferPages::Huge) {
+        return size;
+    }
+    return (size + CodeBuffer::huge_page_size - 1) & ~(CodeBuffer::huge_page_size - 1);
+}
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+/**
+ * Maps private read/write memory, backed by the requested pages where possible.
+ *
+ * @param size  The size of the memory in bytes. Rounded up with GetCodeMemorySize().
+ * @param pages The pages to back the memory with.
+ * @param flags Additional mmap flags (e.g. MAP_NORESERVE). Flags that don't work
+ *              with explicit huge pages are only applied to regular pages.
+ */
+[[nodiscard]] CodeMemory MapCodeMemory(size_t size, CodeBufferPages pages, int flags = 0);
+
+/// Requests transparent huge pages for a range of memory, if the platform supports them.
+void AdviseHugePages(void* memory, size_t size) noexcept;
+#endif
+
+} // namespace biscuit
@@ -0,0 +1,36 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/code_stream.hpp>
+
+#include <utility>
+
+namespace biscuit {
+
+CodeStream::CodeStream(Assembler& as, Sink sink)
+    : m_as{as}, m_sink{std::move(sink)}, m_flushed{as.GetCodeBuffer().GetBaseOffset()} {
+    BISCUIT_ASSERT(m_sink);
+}
+
+CodeStream::CodeStream(Assembler& as, std::FILE* file)
+    : CodeStream{as, [file](std::span<const uint8_t> code) {
+          return std::fwrite(code.data(), 1, code.size(), file) == code.size();
+      }} {
+    BISCUIT_ASSERT(file != nullptr);
+}
+
+bool CodeStream::Flush() {
+    auto& buffer = m_as.GetCodeBuffer();
+    const auto finalized = m_as.GetFinalizedOffset();
+
+    if (finalized > m_flushed) {
+        const auto size = static_cast<size_t>(finalized - m_flushed);
+        if (!m_sink({buffer.GetOffsetPointer(m_flushed), size})) {
+            return false;
+        }
+        m_flushed = finalized;
+    }
+
+    buffer.ReleaseBefore(m_flushed);
+    return true;
+}
+
+} // namespace biscuit
@@ -6,7 +6,174 @@
 
 #include <biscuit/cpuinfo.hpp>
 
+#include <array>
+#include <utility>
+
+#if defined(__linux__) && defined(__riscv)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace biscuit {
+namespace {
+
+// Keys and values of the riscv_hwprobe syscall. These match the kernel's
+// <asm/hwprobe.h>, and are spelled out here so that building doesn't
+// depend on having recent kernel headers installed.
+constexpr int64_t hwprobe_key_mvendorid = 0;
+constexpr int64_t hwprobe_key_marchid = 1;
+constexpr int64_t hwprobe_key_mimpid = 2;
+constexpr int64_t hwprobe_key_ima_ext_0 = 4;
+constexpr int64_t hwprobe_key_cpuperf_0 = 5;
+constexpr int64_t hwprobe_key_misaligned_scalar_perf = 9;
+
+constexpr uint64_t hwprobe_misaligned_mask = 7;
+
+// Bits of the IMA_EXT_0 key, along with the extensions they correspond to.
+constexpr std::array hwprobe_ima_ext_0_bits{
+    std::pair{0, Extension::F}, // Also implies D. Handled separately.
+    std::pair{1, Extension::C},
+    std::pair{2, Extension::V},
+    std::pair{3, Extension::Zba},
+    std::pair{4, Extension::Zbb},
+    std::pair{5, Extension::Zbs},
+    std::pair{6, Extension::Zicboz},
+    std::pair{7, Extension::Zbc},
+    std::pair{8, Extension::Zbkb},
+    std::pair{9, Extension::Zbkc},
+    std::pair{10, Extension::Zbkx},
+    std::pair{11, Extension::Zknd},
+    std::pair{12, Extension::Zkne},
+    std::pair{13, Extension::Zknh},
+    std::pair{14, Extension::Zksed},
+    std::pair{15, Extension::Zksh},
+    std::pair{16, Extension::Zkt},
+    std::pair{17, Extension::Zvbb},
+    std::pair{18, Extension::Zvbc},
+    std::pair{19, Extension::Zvkb},
+    std::pair{20, Extension::Zvkg},
+    std::pair{21, Extension::Zvkned},
+    std::pair{22, Extension::Zvknha},
+    std::pair{23, Extension::Zvknhb},
+    std::pair{24, Extension::Zvksed},
+    std::pair{25, Extension::Zvksh},
+    std::pair{26, Extension::Zvkt},
+    std::pair{27, Extension::Zfh},
+    std::pair{28, Extension::Zfhmin},
+    std::pair{29, Extension::Zihintntl},
+    std::pair{30, Extension::Zvfh},
+    std::pair{31, Extension::Zvfhmin},
+    std::pair{32, Extension::Zfa},
+    std::pair{33, Extension::Ztso},
+    std::pair{34, Extension::Zacas},
+    std::pair{35, Extension::Zicond},
+    std::pair{36, Extension::Zihintpause},
+    std::pair{42, Extension::Zimop},
+    std::pair{44, Extension::Zcb},
+    std::pair{47, Extension::Zcmop},
+    std::pair{48, Extension::Zawrs},
+};
+
+// Layout of struct riscv_hwprobe.
+struct HWProbePair {
+    int64_t key;
+    uint64_t value;
+};
+
+// Queries the given keys, returning false if the syscall isn't available.
+// Keys unknown to the running kernel have their key replaced with -1.
+template <size_t N>
+bool HWProbe([[maybe_unused]] std::array<HWProbePair, N>& pairs) {
+#if defined(__linux__) && defined(__riscv) && defined(__NR_riscv_hwprobe)
+    return syscall(__NR_riscv_hwprobe, pairs.data(), pairs.size(), 0, nullptr, 0) == 0;
+#else
+    return false;
+#endif
+}
+
+// Reads the vector register length.
+uint32_t ReadVlenb() {
+#if defined(__riscv) && (defined(__GNUC__) || defined(__clang__))
+    // Spelled out numerically, so this doesn't depend on V being
+    // enabled for the translation unit.
+    unsigned long vlenb = 0;
+    asm volatile("csrr %0, 0xC22" : "=r"(vlenb));
+    return static_cast<uint32_t>(vlenb);
+#elif defined(BISCUIT_CODE_BUFFER_MMAP)
+    // Without inline assembly, the read has to be generated at runtime.
+    CSRReader<CSR::VLenb> reader;
+    return reader.GetCode<uint32_t (*)()>()();
+#else
+    return 0;
+#endif
+}
+
+CPUSnapshot DetectSnapshot(const CPUInfo& cpu) {
+    CPUSnapshot info;
+
+    // Single-letter extensions from the auxiliary vector.
+    const auto add_if_present = [&](RISCVExtension detected, Extension extension) {
+        if (cpu.Has(detected)) {
+            info.extensions.Add(extension);
+        }
+    };
+
+    add_if_present(RISCVExtension::M, Extension::M);
+    add_if_present(RISCVExtension::A, Extension::A);
+    add_if_present(RISCVExtension::F, Extension::F);
+    add_if_present(RISCVExtension::D, Extension::D);
+    add_if_present(RISCVExtension::C, Extension::C);
+    add_if_present(RISCVExtension::V, Extension::V);
+
+    std::array<HWProbePair, 6> pairs{{
+        {hwprobe_key_mvendorid, 0},
+        {hwprobe_key_marchid, 0},
+        {hwprobe_key_mimpid, 0},
+        {hwprobe_key_ima_ext_0, 0},
+        {hwprobe_key_misaligned_scalar_perf, 0},
+        {hwprobe_key_cpuperf_0, 0},
+    }};
+
+    if (cpu.Has(RISCVExtension::V)) {
+        info.vlenb = ReadVlenb();
+    }
+
+    if (!HWProbe(pairs)) {
+        return info;
+    }
+
+    info.vendor_id = pairs[0].value;
+    info.arch_id = pairs[1].value;
+    info.impl_id = pairs[2].value;
+
+    if (pairs[3].key != -1) {
+        const auto bits = pairs[3].value;
+        for (const auto& [bit, extension] : hwprobe_ima_ext_0_bits) {
+            if ((bits & (uint64_t{1} << bit)) != 0) {
+                info.extensions.Add(extension);
+            }
+        }
+
+        // IMA_FD indicates both F and D.
+        if ((bits & 1) != 0) {
+            info.extensions.Add(Extension::D);
+        }
+    }
+
+    // Older kernels only know about CPUPERF_0, which newer ones deprecate
+    // in favor of MISALIGNED_SCALAR_PERF. Both share the same values.
+    const auto& perf = pairs[4].key != -1 ? pairs[4] : pairs[5];
+    if (perf.key != -1) {
+        const auto value = perf.value & hwprobe_misaligned_mask;
+        if (value <= static_cast<uint64_t>(MisalignedAccess::Unsupported)) {
+            info.misaligned_access = static_cast<MisalignedAccess>(value);
+        }
+    }
+
+    return info;
+}
+
+} // Anonymous namespace
 
 bool CPUInfo::Has(RISCVExtension extension) const {
 #if defined(__linux__) && defined(__riscv)
@@ -26,14 +193,33 @@ bool CPUInfo::Has(RISCVExtension extension) const {
     return (features & static_cast<uint64_t>(extension)) != 0;
 }
 
-uint32_t CPUInfo::GetVlenb() const {
-    if(Has(RISCVExtension::V)) {
-        static CSRReader<CSR::VLenb> csrReader;
-        const static auto getVLEN = csrReader.GetCode<uint32_t (*)()>();
-        return getVLEN();
-    }
+const CPUSnapshot& CPUInfo::GetSnapshot() const {
+    static const CPUSnapshot snapshot = DetectSnapshot(*this);
+    return snapshot;
+}
 
-    return 0;
+ExtensionSet CPUInfo::GetExtensions() const {
+    return GetSnapshot().extensions;
+}
+
+MisalignedAccess CPUInfo::GetMisalignedAccess() const {
+    return GetSnapshot().misaligned_access;
+}
+
+uint64_t CPUInfo::GetVendorID() const {
+    return GetSnapshot().vendor_id;
+}
+
+uint64_t CPUInfo::GetArchID() const {
+    return GetSnapshot().arch_id;
+}
+
+uint64_t CPUInfo::GetImplID() const {
+    return GetSnapshot().impl_id;
+}
+
+uint32_t CPUInfo::GetVlenb() const {
+    return GetSnapshot().vlenb;
 }
 
 } // namespace biscuit
@@ -0,0 +1,455 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/crypto_kernels.hpp>
+#include <biscuit/label.hpp>
+#include <biscuit/vector_loop.hpp>
+
+#include <array>
+#include <utility>
+
+namespace biscuit {
+namespace {
+// SHA-256 round constants.
+constexpr std::array<uint32_t, 64> sha256_round_constants{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+// SM4 system parameter FK.
+constexpr std::array<uint32_t, 4> sm4_fk{
+    0xA3B1BAC6, 0x56AA3350, 0x677D9197, 0xB27022DC,
+};
+
+// Byte offsets of {f, e, b, a} within the SHA-256 state (and of {h, g, d, c} from c),
+// packed into the layout vsha2c[hl] expects as four 8-bit indices.
+constexpr uint32_t sha256_state_indices = 0x00041014;
+
+// Round keys are kept in v1 onwards, leaving v16-v31 for block data.
+constexpr uint32_t first_round_key = 1;
+
+// Register groups holding blocks.
+constexpr Vec counter_group{16};
+constexpr Vec keystream_group{20};
+constexpr Vec data_group{24};
+constexpr Vec setup_group{28};
+
+// GHASH state, kept within the setup group once it's no longer needed.
+constexpr Vec ghash_hash{28};
+constexpr Vec ghash_subkey{29};
+constexpr Vec ghash_block{30};
+
+bool HasByteSwap(const Assembler& as) {
+    const auto extensions = as.GetExtensions();
+    return extensions.Has(Extension::Zvkb) || extensions.Has(Extension::Zvbb);
+}
+
+uint32_t GetAESRounds(AESKeySize key_size) {
+    return key_size == AESKeySize::AES128 ? 10 : 14;
+}
+
+// Register groups for block data have to live within v16-v31, so they can't exceed LMUL=4.
+LMUL ChooseBlockLMUL(const KernelOptions& options) {
+    const auto lmul = ChooseLoopLMUL(options.vlenb, SEW::E32, 1, options.typical_size);
+    return lmul == LMUL::M8 ? LMUL::M4 : lmul;
+}
+
+// Loads `count` element groups from a0 into consecutive registers, starting at `first`.
+void EmitLoadElementGroups(Assembler& as, uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        as.VLE32(Vec{first + i}, a0);
+        as.ADDI(a0, a0, 16);
+    }
+}
+
+// Sets t0 to the number of elements (in a3) to process in this iteration.
+//
+// VSETVLI isn't used to pick vl on its own, since it may split the last two iterations
+// evenly, which can leave vl at a value that isn't a multiple of the element group size.
+void EmitBlockVL(Assembler& as, LMUL lmul, VMA vma) {
+    auto clamped = Label::Local();
+    as.MV(t0, t5);
+    as.BGEU(a3, t5, &clamped);
+    as.MV(t0, a3);
+    as.Bind(&clamped);
+    as.VSETVLI(x0, t0, SEW::E32, lmul, VTA::Yes, vma);
+}
+
+void EmitAESRounds(Assembler& as, Vec state, uint32_t rounds) {
+    as.VAESZ(state, Vec{first_round_key});
+    for (uint32_t round = 1; round < rounds; round++) {
+        as.VAESEM_VS(state, Vec{first_round_key + round});
+    }
+    as.VAESEF_VS(state, Vec{first_round_key + rounds});
+}
+
+// Folds the t0 / 4 blocks at `data` into the GHASH state.
+void EmitGHASHBlocks(Assembler& as, GPR data) {
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::No);
+    as.MV(t3, data);
+    as.SRLI(t4, t0, 2);
+
+    auto block = Label::Local();
+    as.Bind(&block);
+    as.VLE32(ghash_block, t3);
+    as.VGHSH(ghash_hash, ghash_subkey, ghash_block);
+    as.ADDI(t3, t3, 16);
+    as.ADDI(t4, t4, -1);
+    as.BNEZ(t4, &block);
+}
+
+// Shared between the CTR and GCM kernels. a0-a4 hold the arguments common to both.
+void EmitAESCTRBody(Assembler& as, AESKeySize key_size, std::optional<GCMDirection> gcm,
+                    const KernelOptions& options) {
+    const auto rounds = GetAESRounds(key_size);
+    const auto lmul = ChooseBlockLMUL(options);
+
+    // Masked operations only touch counter words, so inactive elements must be left undisturbed.
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::No);
+    EmitLoadElementGroups(as, first_round_key, rounds + 1);
+    as.VLE32(setup_group, a4);
+
+    // Broadcast the counter block to every element group, with the counter word of group i
+    // in native byte order and advanced by i. v0 selects the counter word of each group.
+    as.VSETVLI(t5, x0, SEW::E32, lmul, VTA::Yes, VMA::No);
+    as.VID(data_group);
+    as.VAND(keystream_group, data_group, 3);
+    as.VMSEQ(v0, keystream_group, 3);
+    as.VSRL(data_group, data_group, 2U);
+    as.VRGATHER(counter_group, setup_group, keystream_group);
+    as.VREV8(counter_group, counter_group, VecMask::Yes);
+    as.VADD(counter_group, counter_group, data_group, VecMask::Yes);
+
+    if (gcm) {
+        as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::No);
+        as.VLE32(ghash_hash, a5);
+        as.ADDI(t3, a5, 16);
+        as.VLE32(ghash_subkey, t3);
+    }
+
+    // Blocks are counted in elements from here on.
+    as.SLLI(a3, a3, 2);
+
+    auto loop = Label::Local();
+    auto done = Label::Local();
+    as.Bind(&loop);
+    as.BEQZ(a3, &done);
+    EmitBlockVL(as, lmul, VMA::No);
+
+    // Take the counter blocks for this iteration, then step every counter past them.
+    as.VMV(keystream_group, counter_group);
+    as.VREV8(keystream_group, counter_group, VecMask::Yes);
+    as.SRLI(t1, t0, 2);
+    as.VADD(counter_group, counter_group, t1, VecMask::Yes);
+    EmitAESRounds(as, keystream_group, rounds);
+
+    // The input may be overwritten by the output, so ciphertext is hashed before it is.
+    if (gcm == GCMDirection::Decrypt) {
+        EmitGHASHBlocks(as, a1);
+        as.VSETVLI(x0, t0, SEW::E32, lmul, VTA::Yes, VMA::No);
+    }
+
+    as.VLE32(data_group, a1);
+    as.VXOR(data_group, data_group, keystream_group);
+    as.VSE32(data_group, a2);
+
+    if (gcm == GCMDirection::Encrypt) {
+        EmitGHASHBlocks(as, a2);
+    }
+
+    as.SLLI(t2, t0, 2);
+    as.ADD(a1, a1, t2);
+    as.ADD(a2, a2, t2);
+    as.SUB(a3, a3, t0);
+    as.J(&loop);
+
+    // The first group's counter is the one following the last block processed.
+    as.Bind(&done);
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::No);
+    as.VMV(keystream_group, counter_group);
+    as.VREV8(keystream_group, counter_group, VecMask::Yes);
+    as.VSE32(keystream_group, a4);
+    if (gcm) {
+        as.VSE32(ghash_hash, a5);
+    }
+    as.RET();
+}
+} // Anonymous namespace
+
+std::optional<ptrdiff_t> EmitAESKeyExpansionKernel(Assembler& as, AESKeySize key_size) {
+    if (!as.GetExtensions().Has(Extension::Zvkned)) {
+        return std::nullopt;
+    }
+
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    as.VLE32(v1, a0);
+    as.VSE32(v1, a1);
+
+    if (key_size == AESKeySize::AES128) {
+        // Each round key is derived from the one before it.
+        Vec previous = v1;
+        Vec next = v2;
+        for (uint32_t round = 1; round <= 10; round++) {
+            as.VAESKF1(next, previous, round);
+            as.ADDI(a1, a1, 16);
+            as.VSE32(next, a1);
+            std::swap(previous, next);
+        }
+    } else {
+        // Each round key is derived from the two before it, with the
+        // older one being overwritten by VAESKF2 in the process.
+        as.ADDI(a0, a0, 16);
+        as.VLE32(v2, a0);
+        as.ADDI(a1, a1, 16);
+        as.VSE32(v2, a1);
+
+        Vec older = v1;
+        Vec newer = v2;
+        Vec next = v3;
+        for (uint32_t round = 2; round <= 14; round++) {
+            as.VMV(next, older);
+            as.VAESKF2(next, newer, round);
+            as.ADDI(a1, a1, 16);
+            as.VSE32(next, a1);
+
+            const auto free = older;
+            older = newer;
+            newer = next;
+            next = free;
+        }
+    }
+
+    as.RET();
+    return offset;
+}
+
+std::optional<ptrdiff_t> EmitAESCTRKernel(Assembler& as, AESKeySize key_size,
+                                          const KernelOptions& options) {
+    if (!as.GetExtensions().Has(Extension::Zvkned) || !HasByteSwap(as)) {
+        return std::nullopt;
+    }
+
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+    EmitAESCTRBody(as, key_size, std::nullopt, options);
+    return offset;
+}
+
+std::optional<ptrdiff_t> EmitAESGCMKernel(Assembler& as, AESKeySize key_size, GCMDirection direction,
+                                          const KernelOptions& options) {
+    const auto extensions = as.GetExtensions();
+    if (!extensions.Has(Extension::Zvkned) || !extensions.Has(Extension::Zvkg) || !HasByteSwap(as)) {
+        return std::nullopt;
+    }
+
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+    EmitAESCTRBody(as, key_size, direction, options);
+    return offset;
+}
+
+std::optional<ptrdiff_t> EmitGHASHKernel(Assembler& as) {
+    if (!as.GetExtensions().Has(Extension::Zvkg)) {
+        return std::nullopt;
+    }
+
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+
+    auto loop = Label::Local();
+    auto done = Label::Local();
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    as.VLE32(v1, a0);
+    as.VLE32(v2, a1);
+    as.Bind(&loop);
+    as.BEQZ(a3, &done);
+    as.VLE32(v3, a2);
+    as.VGHSH(v1, v2, v3);
+    as.ADDI(a2, a2, 16);
+    as.ADDI(a3, a3, -1);
+    as.J(&loop);
+
+    as.Bind(&done);
+    as.VSE32(v1, a0);
+    as.RET();
+
+    return offset;
+}
+
+std::optional<ptrdiff_t> EmitSHA256Kernel(Assembler& as) {
+    const auto extensions = as.GetExtensions();
+    const bool has_sha256 = extensions.Has(Extension::Zvknha) || extensions.Has(Extension::Zvknhb);
+    if (!has_sha256 || !HasByteSwap(as)) {
+        return std::nullopt;
+    }
+
+    // Register layout:
+    // - v0:      Mask selecting the first word of an element group
+    // - v1-v4:   Message schedule, four words per register
+    // - v5:      Message words with round constants added
+    // - v6, v7:  Working state as {f, e, b, a} and {h, g, d, c}
+    // - v10-v25: Round constants
+    // - v26:     Indices for gathering the state from memory
+    // - v30-v31: State at the start of the block
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+
+    auto constants = Label::Local();
+    auto loop = Label::Local();
+    auto done = Label::Local();
+
+    as.BEQZ(a2, &done);
+    as.LA(t0, &constants);
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    for (uint32_t i = 0; i < 16; i++) {
+        as.VLE32(Vec{10 + i}, t0);
+        as.ADDI(t0, t0, 16);
+    }
+
+    as.LI(t1, sha256_state_indices);
+    as.VSETIVLI(x0, 1, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    as.VMV(v26, t1);
+
+    as.ADDI(t2, a0, 8);
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    as.VLUXEI8(v6, a0, v26);
+    as.VLUXEI8(v7, t2, v26);
+
+    as.VSETIVLI(x0, 1, SEW::E8, LMUL::M1, VTA::Yes, VMA::Yes);
+    as.VMV(v0, 1);
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+
+    as.Bind(&loop);
+    as.ADDI(a2, a2, -1);
+    as.VMV(v30, v6);
+    as.VMV(v31, v7);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        const Vec words{1 + i};
+        as.VLE32(words, a1);
+        as.VREV8(words, words);
+        as.ADDI(a1, a1, 16);
+    }
+
+    // Each quad-round consumes the oldest four message words, while
+    // the last 12 of them are scheduled by the ones that came before.
+    for (uint32_t i = 0; i < 16; i++) {
+        const auto schedule = [](uint32_t index) { return Vec{1 + (index % 4)}; };
+        const auto words = schedule(i);
+
+        as.VADD(v5, Vec{10 + i}, words);
+        as.VSHA2CL(v7, v6, v5);
+        as.VSHA2CH(v6, v7, v5);
+
+        if (i < 12) {
+            as.VMERGE(v5, schedule(i + 2), schedule(i + 1));
+            as.VSHA2MS(words, v5, schedule(i + 3));
+        }
+    }
+
+    as.VADD(v6, v30, v6);
+    as.VADD(v7, v31, v7);
+    as.BNEZ(a2, &loop);
+
+    as.VSUXEI8(v6, a0, v26);
+    as.VSUXEI8(v7, t2, v26);
+    as.Bind(&done);
+    as.RET();
+
+    auto& buffer = as.GetCodeBuffer();
+    as.Bind(&constants);
+    for (const auto constant : sha256_round_constants) {
+        buffer.Emit32(constant);
+    }
+    as.SkipSchedule();
+
+    return offset;
+}
+
+std::optional<ptrdiff_t> EmitSM4KeyExpansionKernel(Assembler& as) {
+    if (!as.GetExtensions().Has(Extension::Zvksed) || !HasByteSwap(as)) {
+        return std::nullopt;
+    }
+
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+
+    auto fk = Label::Local();
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    as.VLE32(v1, a0);
+    as.VREV8(v1, v1);
+    as.LA(t0, &fk);
+    as.VLE32(v2, t0);
+    as.VXOR(v1, v1, v2);
+
+    // Each group of four round keys is derived from the group before it.
+    as.VSM4K(v1, v1, 0);
+    for (uint32_t group = 1; group < 8; group++) {
+        as.VSM4K(Vec{1 + group}, Vec{group}, group);
+    }
+    for (uint32_t group = 0; group < 8; group++) {
+        as.VSE32(Vec{1 + group}, a1);
+        as.ADDI(a1, a1, 16);
+    }
+    as.RET();
+
+    auto& buffer = as.GetCodeBuffer();
+    as.Bind(&fk);
+    for (const auto word : sm4_fk) {
+        buffer.Emit32(word);
+    }
+    as.SkipSchedule();
+
+    return offset;
+}
+
+std::optional<ptrdiff_t> EmitSM4Kernel(Assembler& as, const KernelOptions& options) {
+    if (!as.GetExtensions().Has(Extension::Zvksed) || !HasByteSwap(as)) {
+        return std::nullopt;
+    }
+
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+    const auto lmul = ChooseBlockLMUL(options);
+
+    // Round keys are kept in v8-v15, four to a register.
+    as.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    EmitLoadElementGroups(as, 8, 8);
+
+    // SM4 outputs its words in reverse order, which gathering
+    // with the indices (i ^ 3) undoes within each block.
+    constexpr Vec state = counter_group;
+    constexpr Vec output = keystream_group;
+    constexpr Vec indices = data_group;
+    as.VSETVLI(t5, x0, SEW::E32, lmul, VTA::Yes, VMA::Yes);
+    as.VID(indices);
+    as.VXOR(indices, indices, 3);
+    as.SLLI(a3, a3, 2);
+
+    auto loop = Label::Local();
+    auto done = Label::Local();
+    as.Bind(&loop);
+    as.BEQZ(a3, &done);
+    EmitBlockVL(as, lmul, VMA::Yes);
+
+    as.VLE32(state, a1);
+    as.VREV8(state, state);
+    for (uint32_t group = 0; group < 8; group++) {
+        as.VSM4R_VS(state, Vec{8 + group});
+    }
+    as.VRGATHER(output, state, indices);
+    as.VREV8(output, output);
+    as.VSE32(output, a2);
+
+    as.SLLI(t2, t0, 2);
+    as.ADD(a1, a1, t2);
+    as.ADD(a2, a2, t2);
+    as.SUB(a3, a3, t0);
+    as.J(&loop);
+
+    as.Bind(&done);
+    as.RET();
+
+    return offset;
+}
+
+} // namespace biscuit
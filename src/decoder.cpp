@@ -0,0 +1,1857 @@
+#include <biscuit/decoder.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+namespace biscuit {
+namespace {
+
+// How the operands of an instruction are laid out within its encoding.
+enum class Layout : uint8_t {
+    // 32-bit layouts
+    R,
+    R4,
+    I,
+    CSR,
+    Prefetch,
+    S,
+    B,
+    U,
+    J,
+    VArith,
+    VArithSImm,
+    VArithUImm,
+    VArithUImm6,
+    VLoad,
+    VStore,
+    VSetVLI,
+    VSetIVLI,
+    VSetVL,
+
+    // 16-bit layouts
+    CR,
+    CI,
+    CILui,
+    CIAddi16sp,
+    CIShift,
+    CILwsp,
+    CILdsp,
+    CILqsp,
+    CSSwsp,
+    CSSdsp,
+    CSSqsp,
+    CIW,
+    CLW,
+    CLD,
+    CLQ,
+    CSW,
+    CSD,
+    CSQ,
+    CA,
+    CBShift,
+    CBImm,
+    CBBranch,
+    CJ,
+    CLB,
+    CLH,
+    CSB,
+    CSH,
+    CU,
+    CMPP,
+    CMMV,
+    CMJT,
+};
+
+// Variants of the ISA an entry applies to.
+constexpr uint8_t variant_rv32 = 1U << 0;
+constexpr uint8_t variant_rv64 = 1U << 1;
+constexpr uint8_t variant_rv128 = 1U << 2;
+constexpr uint8_t variant_zcmp = 1U << 3;     // Only when Zcmp is present.
+constexpr uint8_t variant_zcmt = 1U << 4;     // Only when Zcmt is present.
+constexpr uint8_t variant_not_zcm = 1U << 5;  // Only when neither Zcmp nor Zcmt are present.
+
+constexpr uint8_t variant_xlen_mask = variant_rv32 | variant_rv64 | variant_rv128;
+constexpr uint8_t any_xlen = variant_xlen_mask;
+constexpr uint8_t rv32 = variant_rv32;
+constexpr uint8_t rv64 = variant_rv64 | variant_rv128;
+constexpr uint8_t rv32_or_rv64 = variant_rv32 | variant_rv64;
+constexpr uint8_t rv128 = variant_rv128;
+
+// Major opcodes.
+constexpr uint32_t LOAD = 0b0000011;
+constexpr uint32_t LOAD_FP = 0b0000111;
+constexpr uint32_t MISC_MEM = 0b0001111;
+constexpr uint32_t OP_IMM = 0b0010011;
+constexpr uint32_t AUIPC = 0b0010111;
+constexpr uint32_t OP_IMM_32 = 0b0011011;
+constexpr uint32_t STORE = 0b0100011;
+constexpr uint32_t STORE_FP = 0b0100111;
+constexpr uint32_t AMO = 0b0101111;
+constexpr uint32_t OP = 0b0110011;
+constexpr uint32_t LUI = 0b0110111;
+constexpr uint32_t OP_32 = 0b0111011;
+constexpr uint32_t MADD = 0b1000011;
+constexpr uint32_t MSUB = 0b1000111;
+constexpr uint32_t NMSUB = 0b1001011;
+constexpr uint32_t NMADD = 0b1001111;
+constexpr uint32_t OP_FP = 0b1010011;
+constexpr uint32_t OP_V = 0b1010111;
+constexpr uint32_t BRANCH = 0b1100011;
+constexpr uint32_t JALR = 0b1100111;
+constexpr uint32_t JAL = 0b1101111;
+constexpr uint32_t SYSTEM = 0b1110011;
+constexpr uint32_t OP_VE = 0b1110111;
+
+// Vector arithmetic categories (funct3 of OP-V).
+constexpr uint32_t OPIVV = 0b000;
+constexpr uint32_t OPFVV = 0b001;
+constexpr uint32_t OPMVV = 0b010;
+constexpr uint32_t OPIVI = 0b011;
+constexpr uint32_t OPIVX = 0b100;
+constexpr uint32_t OPFVF = 0b101;
+constexpr uint32_t OPMVX = 0b110;
+constexpr uint32_t OPCFG = 0b111;
+
+// Vector memory addressing modes.
+constexpr uint32_t mop_unit_stride = 0b00;
+constexpr uint32_t mop_indexed_unordered = 0b01;
+constexpr uint32_t mop_strided = 0b10;
+constexpr uint32_t mop_indexed_ordered = 0b11;
+
+// Vector memory element widths.
+constexpr uint32_t width_e8 = 0b000;
+constexpr uint32_t width_e16 = 0b101;
+constexpr uint32_t width_e32 = 0b110;
+constexpr uint32_t width_e64 = 0b111;
+
+// Floating-point formats.
+constexpr uint32_t fmt_s = 0b00;
+constexpr uint32_t fmt_d = 0b01;
+constexpr uint32_t fmt_h = 0b10;
+constexpr uint32_t fmt_q = 0b11;
+
+// The bits that identify an instruction, and the values they must have.
+struct Pattern {
+    uint32_t mask;
+    uint32_t match;
+};
+
+struct Entry {
+    std::string_view mnemonic;
+    Layout layout;
+    uint32_t mask;
+    uint32_t match;
+    uint8_t variants;
+};
+
+constexpr Pattern With(Pattern pattern, uint32_t hi, uint32_t lo, uint32_t value) {
+    const auto field = ((uint32_t{1} << (hi - lo + 1)) - 1) << lo;
+    return {pattern.mask | field, (pattern.match & ~field) | ((value << lo) & field)};
+}
+
+constexpr Pattern Opcode(uint32_t opcode) {
+    return {0x7F, opcode};
+}
+
+constexpr Pattern Funct3(uint32_t opcode, uint32_t funct3) {
+    return With(Opcode(opcode), 14, 12, funct3);
+}
+
+constexpr Pattern Funct7(uint32_t opcode, uint32_t funct3, uint32_t funct7) {
+    return With(Funct3(opcode, funct3), 31, 25, funct7);
+}
+
+constexpr Pattern Exact(uint32_t encoding) {
+    return {0xFFFFFFFF, encoding};
+}
+
+// R-type floating-point operations with a rounding mode.
+constexpr Pattern FP(uint32_t funct5, uint32_t fmt) {
+    return With(With(Opcode(OP_FP), 31, 27, funct5), 26, 25, fmt);
+}
+
+// R-type floating-point operations with a fixed funct3.
+constexpr Pattern FP(uint32_t funct5, uint32_t fmt, uint32_t funct3) {
+    return With(FP(funct5, fmt), 14, 12, funct3);
+}
+
+// Floating-point operations that use rs2 as part of the opcode.
+constexpr Pattern FPUnary(uint32_t funct5, uint32_t fmt, uint32_t rs2) {
+    return With(FP(funct5, fmt), 24, 20, rs2);
+}
+
+constexpr Pattern FPUnary(uint32_t funct5, uint32_t fmt, uint32_t rs2, uint32_t funct3) {
+    return With(FP(funct5, fmt, funct3), 24, 20, rs2);
+}
+
+constexpr Pattern FMA(uint32_t opcode, uint32_t fmt) {
+    return With(Opcode(opcode), 26, 25, fmt);
+}
+
+// AMOs, with the ordering bits left free.
+constexpr Pattern Atomic(uint32_t funct5, uint32_t funct3) {
+    return With(Funct3(AMO, funct3), 31, 27, funct5);
+}
+
+// Vector arithmetic, with the masking bit left free.
+constexpr Pattern Vector(uint32_t category, uint32_t funct6, uint32_t opcode = OP_V) {
+    return With(Funct3(opcode, category), 31, 26, funct6);
+}
+
+// Compressed instructions, identified by quadrant and funct3.
+constexpr Pattern Compressed(uint32_t quadrant, uint32_t funct3) {
+    return {0xE003, (funct3 << 13) | quadrant};
+}
+
+constexpr Pattern CompressedExact(uint32_t encoding) {
+    return {0xFFFF, encoding};
+}
+
+constexpr Entry E(std::string_view mnemonic, Layout layout, Pattern pattern,
+                  uint8_t variants = any_xlen) {
+    return {mnemonic, layout, pattern.mask, pattern.match, variants};
+}
+
+// Vector arithmetic entries.
+constexpr Entry V(std::string_view mnemonic, uint32_t category, uint32_t funct6) {
+    Layout layout = Layout::VArith;
+    if (category == OPIVI) {
+        layout = Layout::VArithSImm;
+    }
+    return E(mnemonic, layout, Vector(category, funct6));
+}
+
+// Vector arithmetic with an unsigned immediate.
+constexpr Entry VUImm(std::string_view mnemonic, uint32_t funct6) {
+    return E(mnemonic, Layout::VArithUImm, Vector(OPIVI, funct6));
+}
+
+// Vector arithmetic that uses vs1 as part of the opcode.
+constexpr Entry VUnary(std::string_view mnemonic, uint32_t category, uint32_t funct6, uint32_t vs1) {
+    return E(mnemonic, Layout::VArith, With(Vector(category, funct6), 19, 15, vs1));
+}
+
+// Vector arithmetic with a fixed masking bit.
+constexpr Entry VMasked(std::string_view mnemonic, uint32_t category, uint32_t funct6, uint32_t vm) {
+    auto entry = V(mnemonic, category, funct6);
+    const auto pattern = With({entry.mask, entry.match}, 25, 25, vm);
+    entry.mask = pattern.mask;
+    entry.match = pattern.match;
+    return entry;
+}
+
+// Vector cryptography instructions, which always have vm set.
+constexpr Entry VCrypto(std::string_view mnemonic, Layout layout, uint32_t funct6) {
+    return E(mnemonic, layout, With(Vector(OPMVV, funct6, OP_VE), 25, 25, 1));
+}
+
+constexpr Entry VCrypto(std::string_view mnemonic, uint32_t funct6, uint32_t vs1) {
+    return E(mnemonic, Layout::VArith, With(With(Vector(OPMVV, funct6, OP_VE), 25, 25, 1), 19, 15, vs1));
+}
+
+// Vector loads and stores. A negative umop indicates that bits 24:20 hold a register.
+constexpr Entry VMem(std::string_view mnemonic, Layout layout, uint32_t opcode,
+                     uint32_t mop, int32_t umop, uint32_t width, uint32_t nf) {
+    auto pattern = With(With(With(Funct3(opcode, width), 31, 29, nf), 28, 26, mop), 14, 12, width);
+    if (umop >= 0) {
+        pattern = With(pattern, 24, 20, static_cast<uint32_t>(umop));
+    }
+    return E(mnemonic, layout, pattern);
+}
+
+constexpr Entry VLoad(std::string_view mnemonic, uint32_t mop, int32_t umop, uint32_t width, uint32_t nf = 0) {
+    return VMem(mnemonic, Layout::VLoad, LOAD_FP, mop, umop, width, nf);
+}
+
+constexpr Entry VStore(std::string_view mnemonic, uint32_t mop, int32_t umop, uint32_t width, uint32_t nf = 0) {
+    return VMem(mnemonic, Layout::VStore, STORE_FP, mop, umop, width, nf);
+}
+
+// Whole register loads and stores. These also have vm set.
+constexpr Entry VWholeReg(std::string_view mnemonic, Layout layout, uint32_t opcode,
+                          uint32_t width, uint32_t nf) {
+    auto entry = VMem(mnemonic, layout, opcode, mop_unit_stride, 0b01000, width, nf);
+    const auto pattern = With({entry.mask, entry.match}, 25, 25, 1);
+    entry.mask = pattern.mask;
+    entry.match = pattern.match;
+    return entry;
+}
+
+// Expands to an entry for each segment count of a segmented vector load or store.
+#define BISCUIT_VSEG(prefix, suffix, kind, mop, umop, width)  \
+    kind(prefix "2" suffix, mop, umop, width, 1),             \
+    kind(prefix "3" suffix, mop, umop, width, 2),             \
+    kind(prefix "4" suffix, mop, umop, width, 3),             \
+    kind(prefix "5" suffix, mop, umop, width, 4),             \
+    kind(prefix "6" suffix, mop, umop, width, 5),             \
+    kind(prefix "7" suffix, mop, umop, width, 6),             \
+    kind(prefix "8" suffix, mop, umop, width, 7)
+
+// Expands to an entry for each floating-point format.
+#define BISCUIT_FP(name, layout, pattern_fn, ...)                           \
+    E(name ".s", layout, pattern_fn(__VA_ARGS__ __VA_OPT__(,) fmt_s)),       \
+    E(name ".d", layout, pattern_fn(__VA_ARGS__ __VA_OPT__(,) fmt_d)),       \
+    E(name ".h", layout, pattern_fn(__VA_ARGS__ __VA_OPT__(,) fmt_h)),       \
+    E(name ".q", layout, pattern_fn(__VA_ARGS__ __VA_OPT__(,) fmt_q))
+
+#define BISCUIT_FP_ARITH(name, funct5) \
+    BISCUIT_FP(name, Layout::R, FP, funct5)
+
+#define BISCUIT_FP_F3(name, funct5, funct3)                                \
+    E(name ".s", Layout::R, FP(funct5, fmt_s, funct3)),                    \
+    E(name ".d", Layout::R, FP(funct5, fmt_d, funct3)),                    \
+    E(name ".h", Layout::R, FP(funct5, fmt_h, funct3)),                    \
+    E(name ".q", Layout::R, FP(funct5, fmt_q, funct3))
+
+#define BISCUIT_FP_UNARY(name, funct5, rs2)                                \
+    E(name ".s", Layout::R, FPUnary(funct5, fmt_s, rs2)),                  \
+    E(name ".d", Layout::R, FPUnary(funct5, fmt_d, rs2)),                  \
+    E(name ".h", Layout::R, FPUnary(funct5, fmt_h, rs2)),                  \
+    E(name ".q", Layout::R, FPUnary(funct5, fmt_q, rs2))
+
+#define BISCUIT_FMA(name, opcode)                                          \
+    E(name ".s", Layout::R4, FMA(opcode, fmt_s)),                          \
+    E(name ".d", Layout::R4, FMA(opcode, fmt_d)),                          \
+    E(name ".h", Layout::R4, FMA(opcode, fmt_h)),                          \
+    E(name ".q", Layout::R4, FMA(opcode, fmt_q))
+
+// Conversions between integers and a floating-point format.
+#define BISCUIT_FCVT_INT(suffix, fmt)                                                \
+    E("fcvt.w" suffix, Layout::R, FPUnary(0b11000, fmt, 0b00000)),                  \
+    E("fcvt.wu" suffix, Layout::R, FPUnary(0b11000, fmt, 0b00001)),                 \
+    E("fcvt.l" suffix, Layout::R, FPUnary(0b11000, fmt, 0b00010), rv64),            \
+    E("fcvt.lu" suffix, Layout::R, FPUnary(0b11000, fmt, 0b00011), rv64),           \
+    E("fcvt" suffix ".w", Layout::R, FPUnary(0b11010, fmt, 0b00000)),               \
+    E("fcvt" suffix ".wu", Layout::R, FPUnary(0b11010, fmt, 0b00001)),              \
+    E("fcvt" suffix ".l", Layout::R, FPUnary(0b11010, fmt, 0b00010), rv64),         \
+    E("fcvt" suffix ".lu", Layout::R, FPUnary(0b11010, fmt, 0b00011), rv64)
+
+// clang-format off
+constexpr std::array entries{
+    // RV32I/RV64I
+    E("lui",   Layout::U, Opcode(LUI)),
+    E("auipc", Layout::U, Opcode(AUIPC)),
+    E("jal",   Layout::J, Opcode(JAL)),
+    E("jalr",  Layout::I, Funct3(JALR, 0b000)),
+
+    E("beq",  Layout::B, Funct3(BRANCH, 0b000)),
+    E("bne",  Layout::B, Funct3(BRANCH, 0b001)),
+    E("blt",  Layout::B, Funct3(BRANCH, 0b100)),
+    E("bge",  Layout::B, Funct3(BRANCH, 0b101)),
+    E("bltu", Layout::B, Funct3(BRANCH, 0b110)),
+    E("bgeu", Layout::B, Funct3(BRANCH, 0b111)),
+
+    E("lb",  Layout::I, Funct3(LOAD, 0b000)),
+    E("lh",  Layout::I, Funct3(LOAD, 0b001)),
+    E("lw",  Layout::I, Funct3(LOAD, 0b010)),
+    E("ld",  Layout::I, Funct3(LOAD, 0b011), rv64),
+    E("lbu", Layout::I, Funct3(LOAD, 0b100)),
+    E("lhu", Layout::I, Funct3(LOAD, 0b101)),
+    E("lwu", Layout::I, Funct3(LOAD, 0b110), rv64),
+
+    E("sb", Layout::S, Funct3(STORE, 0b000)),
+    E("sh", Layout::S, Funct3(STORE, 0b001)),
+    E("sw", Layout::S, Funct3(STORE, 0b010)),
+    E("sd", Layout::S, Funct3(STORE, 0b011), rv64),
+
+    E("addi",  Layout::I, Funct3(OP_IMM, 0b000)),
+    E("slti",  Layout::I, Funct3(OP_IMM, 0b010)),
+    E("sltiu", Layout::I, Funct3(OP_IMM, 0b011)),
+    E("xori",  Layout::I, Funct3(OP_IMM, 0b100)),
+    E("ori",   Layout::I, Funct3(OP_IMM, 0b110)),
+    E("andi",  Layout::I, Funct3(OP_IMM, 0b111)),
+    E("slli",  Layout::I, Funct7(OP_IMM, 0b001, 0b0000000), rv32),
+    E("srli",  Layout::I, Funct7(OP_IMM, 0b101, 0b0000000), rv32),
+    E("srai",  Layout::I, Funct7(OP_IMM, 0b101, 0b0100000), rv32),
+    E("slli",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 26, 0b000000), rv64),
+    E("srli",  Layout::I, With(Funct3(OP_IMM, 0b101), 31, 26, 0b000000), rv64),
+    E("srai",  Layout::I, With(Funct3(OP_IMM, 0b101), 31, 26, 0b010000), rv64),
+
+    E("add",  Layout::R, Funct7(OP, 0b000, 0b0000000)),
+    E("sub",  Layout::R, Funct7(OP, 0b000, 0b0100000)),
+    E("sll",  Layout::R, Funct7(OP, 0b001, 0b0000000)),
+    E("slt",  Layout::R, Funct7(OP, 0b010, 0b0000000)),
+    E("sltu", Layout::R, Funct7(OP, 0b011, 0b0000000)),
+    E("xor",  Layout::R, Funct7(OP, 0b100, 0b0000000)),
+    E("srl",  Layout::R, Funct7(OP, 0b101, 0b0000000)),
+    E("sra",  Layout::R, Funct7(OP, 0b101, 0b0100000)),
+    E("or",   Layout::R, Funct7(OP, 0b110, 0b0000000)),
+    E("and",  Layout::R, Funct7(OP, 0b111, 0b0000000)),
+
+    E("addiw", Layout::I, Funct3(OP_IMM_32, 0b000), rv64),
+    E("slliw", Layout::I, Funct7(OP_IMM_32, 0b001, 0b0000000), rv64),
+    E("srliw", Layout::I, Funct7(OP_IMM_32, 0b101, 0b0000000), rv64),
+    E("sraiw", Layout::I, Funct7(OP_IMM_32, 0b101, 0b0100000), rv64),
+    E("addw",  Layout::R, Funct7(OP_32, 0b000, 0b0000000), rv64),
+    E("subw",  Layout::R, Funct7(OP_32, 0b000, 0b0100000), rv64),
+    E("sllw",  Layout::R, Funct7(OP_32, 0b001, 0b0000000), rv64),
+    E("srlw",  Layout::R, Funct7(OP_32, 0b101, 0b0000000), rv64),
+    E("sraw",  Layout::R, Funct7(OP_32, 0b101, 0b0100000), rv64),
+
+    E("fence",     Layout::I, Funct3(MISC_MEM, 0b000)),
+    E("fence.tso", Layout::I, Exact(0x8330000F)),
+    E("pause",     Layout::I, Exact(0x0100000F)),
+    E("fence.i",   Layout::I, Funct3(MISC_MEM, 0b001)),
+    E("ecall",     Layout::I, Exact(0x00000073)),
+    E("ebreak",    Layout::I, Exact(0x00100073)),
+
+    // Zihintntl
+    E("ntl.p1",   Layout::R, Exact(0x00200033)),
+    E("ntl.pall", Layout::R, Exact(0x00300033)),
+    E("ntl.s1",   Layout::R, Exact(0x00400033)),
+    E("ntl.all",  Layout::R, Exact(0x00500033)),
+
+    // Zicbom, Zicbop and Zicboz
+    E("cbo.inval",  Layout::I, With(With(Funct3(MISC_MEM, 0b010), 31, 20, 0b000), 11, 7, 0)),
+    E("cbo.clean",  Layout::I, With(With(Funct3(MISC_MEM, 0b010), 31, 20, 0b001), 11, 7, 0)),
+    E("cbo.flush",  Layout::I, With(With(Funct3(MISC_MEM, 0b010), 31, 20, 0b010), 11, 7, 0)),
+    E("cbo.zero",   Layout::I, With(With(Funct3(MISC_MEM, 0b010), 31, 20, 0b100), 11, 7, 0)),
+    E("prefetch.i", Layout::Prefetch, With(With(Funct3(OP_IMM, 0b110), 24, 20, 0b00000), 11, 7, 0)),
+    E("prefetch.r", Layout::Prefetch, With(With(Funct3(OP_IMM, 0b110), 24, 20, 0b00001), 11, 7, 0)),
+    E("prefetch.w", Layout::Prefetch, With(With(Funct3(OP_IMM, 0b110), 24, 20, 0b00011), 11, 7, 0)),
+
+    // Zicsr
+    E("csrrw",  Layout::CSR, Funct3(SYSTEM, 0b001)),
+    E("csrrs",  Layout::CSR, Funct3(SYSTEM, 0b010)),
+    E("csrrc",  Layout::CSR, Funct3(SYSTEM, 0b011)),
+    E("csrrwi", Layout::CSR, Funct3(SYSTEM, 0b101)),
+    E("csrrsi", Layout::CSR, Funct3(SYSTEM, 0b110)),
+    E("csrrci", Layout::CSR, Funct3(SYSTEM, 0b111)),
+
+    // Zawrs
+    E("wrs.nto", Layout::I, Exact(0x00D00073)),
+    E("wrs.sto", Layout::I, Exact(0x01D00073)),
+
+    // Privileged instructions
+    E("uret",            Layout::I, Exact(0x00200073)),
+    E("sret",            Layout::I, Exact(0x10200073)),
+    E("mret",            Layout::I, Exact(0x30200073)),
+    E("wfi",             Layout::I, Exact(0x10500073)),
+    E("sfence.w.inval",  Layout::I, Exact(0x18000073)),
+    E("sfence.inval.ir", Layout::I, Exact(0x18100073)),
+    E("sfence.vma",      Layout::R, With(Funct7(SYSTEM, 0b000, 0b0001001), 11, 7, 0)),
+    E("sinval.vma",      Layout::R, With(Funct7(SYSTEM, 0b000, 0b0001011), 11, 7, 0)),
+    E("hfence.vvma",     Layout::R, With(Funct7(SYSTEM, 0b000, 0b0010001), 11, 7, 0)),
+    E("hfence.gvma",     Layout::R, With(Funct7(SYSTEM, 0b000, 0b0110001), 11, 7, 0)),
+    E("hinval.vvma",     Layout::R, With(Funct7(SYSTEM, 0b000, 0b0010011), 11, 7, 0)),
+    E("hinval.gvma",     Layout::R, With(Funct7(SYSTEM, 0b000, 0b0110011), 11, 7, 0)),
+    E("hlv.b",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110000), 24, 20, 0b00000)),
+    E("hlv.bu",          Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110000), 24, 20, 0b00001)),
+    E("hlv.h",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110010), 24, 20, 0b00000)),
+    E("hlv.hu",          Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110010), 24, 20, 0b00001)),
+    E("hlvx.hu",         Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110010), 24, 20, 0b00011)),
+    E("hlv.w",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110100), 24, 20, 0b00000)),
+    E("hlv.wu",          Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110100), 24, 20, 0b00001), rv64),
+    E("hlvx.wu",         Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110100), 24, 20, 0b00011)),
+    E("hlv.d",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110110), 24, 20, 0b00000), rv64),
+    E("hsv.b",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110001), 11, 7, 0)),
+    E("hsv.h",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110011), 11, 7, 0)),
+    E("hsv.w",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110101), 11, 7, 0)),
+    E("hsv.d",           Layout::R, With(Funct7(SYSTEM, 0b100, 0b0110111), 11, 7, 0), rv64),
+
+    // M
+    E("mul",    Layout::R, Funct7(OP, 0b000, 0b0000001)),
+    E("mulh",   Layout::R, Funct7(OP, 0b001, 0b0000001)),
+    E("mulhsu", Layout::R, Funct7(OP, 0b010, 0b0000001)),
+    E("mulhu",  Layout::R, Funct7(OP, 0b011, 0b0000001)),
+    E("div",    Layout::R, Funct7(OP, 0b100, 0b0000001)),
+    E("divu",   Layout::R, Funct7(OP, 0b101, 0b0000001)),
+    E("rem",    Layout::R, Funct7(OP, 0b110, 0b0000001)),
+    E("remu",   Layout::R, Funct7(OP, 0b111, 0b0000001)),
+    E("mulw",   Layout::R, Funct7(OP_32, 0b000, 0b0000001), rv64),
+    E("divw",   Layout::R, Funct7(OP_32, 0b100, 0b0000001), rv64),
+    E("divuw",  Layout::R, Funct7(OP_32, 0b101, 0b0000001), rv64),
+    E("remw",   Layout::R, Funct7(OP_32, 0b110, 0b0000001), rv64),
+    E("remuw",  Layout::R, Funct7(OP_32, 0b111, 0b0000001), rv64),
+
+    // A, Zabha and Zacas
+    E("lr.w",      Layout::R, With(Atomic(0b00010, 0b010), 24, 20, 0)),
+    E("sc.w",      Layout::R, Atomic(0b00011, 0b010)),
+    E("lr.d",      Layout::R, With(Atomic(0b00010, 0b011), 24, 20, 0), rv64),
+    E("sc.d",      Layout::R, Atomic(0b00011, 0b011), rv64),
+    E("amoswap.b", Layout::R, Atomic(0b00001, 0b000)),
+    E("amoswap.h", Layout::R, Atomic(0b00001, 0b001)),
+    E("amoswap.w", Layout::R, Atomic(0b00001, 0b010)),
+    E("amoswap.d", Layout::R, Atomic(0b00001, 0b011), rv64),
+    E("amoadd.b",  Layout::R, Atomic(0b00000, 0b000)),
+    E("amoadd.h",  Layout::R, Atomic(0b00000, 0b001)),
+    E("amoadd.w",  Layout::R, Atomic(0b00000, 0b010)),
+    E("amoadd.d",  Layout::R, Atomic(0b00000, 0b011), rv64),
+    E("amoxor.b",  Layout::R, Atomic(0b00100, 0b000)),
+    E("amoxor.h",  Layout::R, Atomic(0b00100, 0b001)),
+    E("amoxor.w",  Layout::R, Atomic(0b00100, 0b010)),
+    E("amoxor.d",  Layout::R, Atomic(0b00100, 0b011), rv64),
+    E("amoand.b",  Layout::R, Atomic(0b01100, 0b000)),
+    E("amoand.h",  Layout::R, Atomic(0b01100, 0b001)),
+    E("amoand.w",  Layout::R, Atomic(0b01100, 0b010)),
+    E("amoand.d",  Layout::R, Atomic(0b01100, 0b011), rv64),
+    E("amoor.b",   Layout::R, Atomic(0b01000, 0b000)),
+    E("amoor.h",   Layout::R, Atomic(0b01000, 0b001)),
+    E("amoor.w",   Layout::R, Atomic(0b01000, 0b010)),
+    E("amoor.d",   Layout::R, Atomic(0b01000, 0b011), rv64),
+    E("amomin.b",  Layout::R, Atomic(0b10000, 0b000)),
+    E("amomin.h",  Layout::R, Atomic(0b10000, 0b001)),
+    E("amomin.w",  Layout::R, Atomic(0b10000, 0b010)),
+    E("amomin.d",  Layout::R, Atomic(0b10000, 0b011), rv64),
+    E("amomax.b",  Layout::R, Atomic(0b10100, 0b000)),
+    E("amomax.h",  Layout::R, Atomic(0b10100, 0b001)),
+    E("amomax.w",  Layout::R, Atomic(0b10100, 0b010)),
+    E("amomax.d",  Layout::R, Atomic(0b10100, 0b011), rv64),
+    E("amominu.b", Layout::R, Atomic(0b11000, 0b000)),
+    E("amominu.h", Layout::R, Atomic(0b11000, 0b001)),
+    E("amominu.w", Layout::R, Atomic(0b11000, 0b010)),
+    E("amominu.d", Layout::R, Atomic(0b11000, 0b011), rv64),
+    E("amomaxu.b", Layout::R, Atomic(0b11100, 0b000)),
+    E("amomaxu.h", Layout::R, Atomic(0b11100, 0b001)),
+    E("amomaxu.w", Layout::R, Atomic(0b11100, 0b010)),
+    E("amomaxu.d", Layout::R, Atomic(0b11100, 0b011), rv64),
+    E("amocas.b",  Layout::R, Atomic(0b00101, 0b000)),
+    E("amocas.h",  Layout::R, Atomic(0b00101, 0b001)),
+    E("amocas.w",  Layout::R, Atomic(0b00101, 0b010)),
+    E("amocas.d",  Layout::R, Atomic(0b00101, 0b011)),
+    E("amocas.q",  Layout::R, Atomic(0b00101, 0b100), rv64),
+
+    // F, D, Q, Zfh and Zfa
+    E("flh", Layout::I, Funct3(LOAD_FP, 0b001)),
+    E("flw", Layout::I, Funct3(LOAD_FP, 0b010)),
+    E("fld", Layout::I, Funct3(LOAD_FP, 0b011)),
+    E("flq", Layout::I, Funct3(LOAD_FP, 0b100)),
+    E("fsh", Layout::S, Funct3(STORE_FP, 0b001)),
+    E("fsw", Layout::S, Funct3(STORE_FP, 0b010)),
+    E("fsd", Layout::S, Funct3(STORE_FP, 0b011)),
+    E("fsq", Layout::S, Funct3(STORE_FP, 0b100)),
+
+    BISCUIT_FMA("fmadd", MADD),
+    BISCUIT_FMA("fmsub", MSUB),
+    BISCUIT_FMA("fnmsub", NMSUB),
+    BISCUIT_FMA("fnmadd", NMADD),
+
+    BISCUIT_FP_ARITH("fadd", 0b00000),
+    BISCUIT_FP_ARITH("fsub", 0b00001),
+    BISCUIT_FP_ARITH("fmul", 0b00010),
+    BISCUIT_FP_ARITH("fdiv", 0b00011),
+    BISCUIT_FP_UNARY("fsqrt", 0b01011, 0b00000),
+    BISCUIT_FP_F3("fsgnj", 0b00100, 0b000),
+    BISCUIT_FP_F3("fsgnjn", 0b00100, 0b001),
+    BISCUIT_FP_F3("fsgnjx", 0b00100, 0b010),
+    BISCUIT_FP_F3("fmin", 0b00101, 0b000),
+    BISCUIT_FP_F3("fmax", 0b00101, 0b001),
+    BISCUIT_FP_F3("fminm", 0b00101, 0b010),
+    BISCUIT_FP_F3("fmaxm", 0b00101, 0b011),
+    BISCUIT_FP_F3("fle", 0b10100, 0b000),
+    BISCUIT_FP_F3("flt", 0b10100, 0b001),
+    BISCUIT_FP_F3("feq", 0b10100, 0b010),
+    BISCUIT_FP_F3("fleq", 0b10100, 0b100),
+    BISCUIT_FP_F3("fltq", 0b10100, 0b101),
+    BISCUIT_FP_UNARY("fround", 0b01000, 0b00100),
+    BISCUIT_FP_UNARY("froundnx", 0b01000, 0b00101),
+
+    E("fclass.s", Layout::R, FPUnary(0b11100, fmt_s, 0b00000, 0b001)),
+    E("fclass.d", Layout::R, FPUnary(0b11100, fmt_d, 0b00000, 0b001)),
+    E("fclass.h", Layout::R, FPUnary(0b11100, fmt_h, 0b00000, 0b001)),
+    E("fclass.q", Layout::R, FPUnary(0b11100, fmt_q, 0b00000, 0b001)),
+
+    E("fli.s", Layout::R, FPUnary(0b11110, fmt_s, 0b00001, 0b000)),
+    E("fli.d", Layout::R, FPUnary(0b11110, fmt_d, 0b00001, 0b000)),
+    E("fli.h", Layout::R, FPUnary(0b11110, fmt_h, 0b00001, 0b000)),
+    E("fli.q", Layout::R, FPUnary(0b11110, fmt_q, 0b00001, 0b000)),
+
+    E("fmv.x.w",  Layout::R, FPUnary(0b11100, fmt_s, 0b00000, 0b000)),
+    E("fmv.x.d",  Layout::R, FPUnary(0b11100, fmt_d, 0b00000, 0b000), rv64),
+    E("fmv.x.h",  Layout::R, FPUnary(0b11100, fmt_h, 0b00000, 0b000)),
+    E("fmv.w.x",  Layout::R, FPUnary(0b11110, fmt_s, 0b00000, 0b000)),
+    E("fmv.d.x",  Layout::R, FPUnary(0b11110, fmt_d, 0b00000, 0b000), rv64),
+    E("fmv.h.x",  Layout::R, FPUnary(0b11110, fmt_h, 0b00000, 0b000)),
+    E("fmvh.x.d", Layout::R, FPUnary(0b11100, fmt_d, 0b00001, 0b000), rv32),
+    E("fmvh.x.q", Layout::R, FPUnary(0b11100, fmt_q, 0b00001, 0b000), rv64),
+    E("fmvp.d.x", Layout::R, FP(0b10110, fmt_d, 0b000), rv32),
+    E("fmvp.q.x", Layout::R, FP(0b10110, fmt_q, 0b000), rv64),
+
+    E("fcvt.s.d",    Layout::R, FPUnary(0b01000, fmt_s, fmt_d)),
+    E("fcvt.s.h",    Layout::R, FPUnary(0b01000, fmt_s, fmt_h)),
+    E("fcvt.s.q",    Layout::R, FPUnary(0b01000, fmt_s, fmt_q)),
+    E("fcvt.d.s",    Layout::R, FPUnary(0b01000, fmt_d, fmt_s)),
+    E("fcvt.d.h",    Layout::R, FPUnary(0b01000, fmt_d, fmt_h)),
+    E("fcvt.d.q",    Layout::R, FPUnary(0b01000, fmt_d, fmt_q)),
+    E("fcvt.h.s",    Layout::R, FPUnary(0b01000, fmt_h, fmt_s)),
+    E("fcvt.h.d",    Layout::R, FPUnary(0b01000, fmt_h, fmt_d)),
+    E("fcvt.h.q",    Layout::R, FPUnary(0b01000, fmt_h, fmt_q)),
+    E("fcvt.q.s",    Layout::R, FPUnary(0b01000, fmt_q, fmt_s)),
+    E("fcvt.q.d",    Layout::R, FPUnary(0b01000, fmt_q, fmt_d)),
+    E("fcvt.q.h",    Layout::R, FPUnary(0b01000, fmt_q, fmt_h)),
+    E("fcvt.bf16.s", Layout::R, FPUnary(0b01000, fmt_h, 0b01000)),
+    E("fcvt.s.bf16", Layout::R, FPUnary(0b01000, fmt_s, 0b00110)),
+    E("fcvtmod.w.d", Layout::R, FPUnary(0b11000, fmt_d, 0b01000, 0b001)),
+
+    BISCUIT_FCVT_INT(".s", fmt_s),
+    BISCUIT_FCVT_INT(".d", fmt_d),
+    BISCUIT_FCVT_INT(".h", fmt_h),
+    BISCUIT_FCVT_INT(".q", fmt_q),
+
+    // Zba
+    E("sh1add",    Layout::R, Funct7(OP, 0b010, 0b0010000)),
+    E("sh2add",    Layout::R, Funct7(OP, 0b100, 0b0010000)),
+    E("sh3add",    Layout::R, Funct7(OP, 0b110, 0b0010000)),
+    E("add.uw",    Layout::R, Funct7(OP_32, 0b000, 0b0000100), rv64),
+    E("sh1add.uw", Layout::R, Funct7(OP_32, 0b010, 0b0010000), rv64),
+    E("sh2add.uw", Layout::R, Funct7(OP_32, 0b100, 0b0010000), rv64),
+    E("sh3add.uw", Layout::R, Funct7(OP_32, 0b110, 0b0010000), rv64),
+    E("slli.uw",   Layout::I, With(Funct3(OP_IMM_32, 0b001), 31, 26, 0b000010), rv64),
+
+    // Zbb and Zbkb
+    E("andn",   Layout::R, Funct7(OP, 0b111, 0b0100000)),
+    E("orn",    Layout::R, Funct7(OP, 0b110, 0b0100000)),
+    E("xnor",   Layout::R, Funct7(OP, 0b100, 0b0100000)),
+    E("clz",    Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b011000000000)),
+    E("ctz",    Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b011000000001)),
+    E("cpop",   Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b011000000010)),
+    E("sext.b", Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b011000000100)),
+    E("sext.h", Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b011000000101)),
+    E("clzw",   Layout::I, With(Funct3(OP_IMM_32, 0b001), 31, 20, 0b011000000000), rv64),
+    E("ctzw",   Layout::I, With(Funct3(OP_IMM_32, 0b001), 31, 20, 0b011000000001), rv64),
+    E("cpopw",  Layout::I, With(Funct3(OP_IMM_32, 0b001), 31, 20, 0b011000000010), rv64),
+    E("max",    Layout::R, Funct7(OP, 0b110, 0b0000101)),
+    E("maxu",   Layout::R, Funct7(OP, 0b111, 0b0000101)),
+    E("min",    Layout::R, Funct7(OP, 0b100, 0b0000101)),
+    E("minu",   Layout::R, Funct7(OP, 0b101, 0b0000101)),
+    E("zext.h", Layout::R, With(Funct7(OP, 0b100, 0b0000100), 24, 20, 0), rv32),
+    E("zext.h", Layout::R, With(Funct7(OP_32, 0b100, 0b0000100), 24, 20, 0), rv64),
+    E("rol",    Layout::R, Funct7(OP, 0b001, 0b0110000)),
+    E("ror",    Layout::R, Funct7(OP, 0b101, 0b0110000)),
+    E("rolw",   Layout::R, Funct7(OP_32, 0b001, 0b0110000), rv64),
+    E("rorw",   Layout::R, Funct7(OP_32, 0b101, 0b0110000), rv64),
+    E("rori",   Layout::I, Funct7(OP_IMM, 0b101, 0b0110000), rv32),
+    E("rori",   Layout::I, With(Funct3(OP_IMM, 0b101), 31, 26, 0b011000), rv64),
+    E("roriw",  Layout::I, Funct7(OP_IMM_32, 0b101, 0b0110000), rv64),
+    E("orc.b",  Layout::I, With(Funct3(OP_IMM, 0b101), 31, 20, 0b001010000111)),
+    E("rev8",   Layout::I, With(Funct3(OP_IMM, 0b101), 31, 20, 0b011010011000), rv32),
+    E("rev8",   Layout::I, With(Funct3(OP_IMM, 0b101), 31, 20, 0b011010111000), rv64),
+    E("brev8",  Layout::I, With(Funct3(OP_IMM, 0b101), 31, 20, 0b011010000111)),
+    E("zip",    Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000010001111), rv32),
+    E("unzip",  Layout::I, With(Funct3(OP_IMM, 0b101), 31, 20, 0b000010001111), rv32),
+    E("pack",   Layout::R, Funct7(OP, 0b100, 0b0000100)),
+    E("packh",  Layout::R, Funct7(OP, 0b111, 0b0000100)),
+    E("packw",  Layout::R, Funct7(OP_32, 0b100, 0b0000100), rv64),
+
+    // Zbc and Zbkc
+    E("clmul",  Layout::R, Funct7(OP, 0b001, 0b0000101)),
+    E("clmulr", Layout::R, Funct7(OP, 0b010, 0b0000101)),
+    E("clmulh", Layout::R, Funct7(OP, 0b011, 0b0000101)),
+
+    // Zbkx
+    E("xperm4", Layout::R, Funct7(OP, 0b010, 0b0010100)),
+    E("xperm8", Layout::R, Funct7(OP, 0b100, 0b0010100)),
+
+    // Zbs
+    E("bclr",  Layout::R, Funct7(OP, 0b001, 0b0100100)),
+    E("bext",  Layout::R, Funct7(OP, 0b101, 0b0100100)),
+    E("binv",  Layout::R, Funct7(OP, 0b001, 0b0110100)),
+    E("bset",  Layout::R, Funct7(OP, 0b001, 0b0010100)),
+    E("bclri", Layout::I, Funct7(OP_IMM, 0b001, 0b0100100), rv32),
+    E("bexti", Layout::I, Funct7(OP_IMM, 0b101, 0b0100100), rv32),
+    E("binvi", Layout::I, Funct7(OP_IMM, 0b001, 0b0110100), rv32),
+    E("bseti", Layout::I, Funct7(OP_IMM, 0b001, 0b0010100), rv32),
+    E("bclri", Layout::I, With(Funct3(OP_IMM, 0b001), 31, 26, 0b010010), rv64),
+    E("bexti", Layout::I, With(Funct3(OP_IMM, 0b101), 31, 26, 0b010010), rv64),
+    E("binvi", Layout::I, With(Funct3(OP_IMM, 0b001), 31, 26, 0b011010), rv64),
+    E("bseti", Layout::I, With(Funct3(OP_IMM, 0b001), 31, 26, 0b001010), rv64),
+
+    // Zicond
+    E("czero.eqz", Layout::R, Funct7(OP, 0b101, 0b0000111)),
+    E("czero.nez", Layout::R, Funct7(OP, 0b111, 0b0000111)),
+
+    // Zknd, Zkne, Zknh, Zksed and Zksh
+    E("aes32esi",    Layout::R, With(Funct3(OP, 0b000), 29, 25, 0b10001), rv32),
+    E("aes32esmi",   Layout::R, With(Funct3(OP, 0b000), 29, 25, 0b10011), rv32),
+    E("aes32dsi",    Layout::R, With(Funct3(OP, 0b000), 29, 25, 0b10101), rv32),
+    E("aes32dsmi",   Layout::R, With(Funct3(OP, 0b000), 29, 25, 0b10111), rv32),
+    E("aes64es",     Layout::R, Funct7(OP, 0b000, 0b0011001), rv64),
+    E("aes64esm",    Layout::R, Funct7(OP, 0b000, 0b0011011), rv64),
+    E("aes64ds",     Layout::R, Funct7(OP, 0b000, 0b0011101), rv64),
+    E("aes64dsm",    Layout::R, Funct7(OP, 0b000, 0b0011111), rv64),
+    E("aes64ks2",    Layout::R, Funct7(OP, 0b000, 0b0111111), rv64),
+    E("aes64im",     Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b001100000000), rv64),
+    E("aes64ks1i",   Layout::I, With(Funct3(OP_IMM, 0b001), 31, 24, 0b00110001), rv64),
+    E("sha256sum0",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000000)),
+    E("sha256sum1",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000001)),
+    E("sha256sig0",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000010)),
+    E("sha256sig1",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000011)),
+    E("sha512sum0",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000100), rv64),
+    E("sha512sum1",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000101), rv64),
+    E("sha512sig0",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000110), rv64),
+    E("sha512sig1",  Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100000111), rv64),
+    E("sm3p0",       Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100001000)),
+    E("sm3p1",       Layout::I, With(Funct3(OP_IMM, 0b001), 31, 20, 0b000100001001)),
+    E("sha512sum0r", Layout::R, Funct7(OP, 0b000, 0b0101000), rv32),
+    E("sha512sum1r", Layout::R, Funct7(OP, 0b000, 0b0101001), rv32),
+    E("sha512sig0l", Layout::R, Funct7(OP, 0b000, 0b0101010), rv32),
+    E("sha512sig1l", Layout::R, Funct7(OP, 0b000, 0b0101011), rv32),
+    E("sha512sig0h", Layout::R, Funct7(OP, 0b000, 0b0101110), rv32),
+    E("sha512sig1h", Layout::R, Funct7(OP, 0b000, 0b0101111), rv32),
+    E("sm4ed",       Layout::R, With(Funct3(OP, 0b000), 29, 25, 0b11000)),
+    E("sm4ks",       Layout::R, With(Funct3(OP, 0b000), 29, 25, 0b11010)),
+
+    // V: Configuration
+    E("vsetvli",  Layout::VSetVLI,  With(Funct3(OP_V, OPCFG), 31, 31, 0b0)),
+    E("vsetivli", Layout::VSetIVLI, With(Funct3(OP_V, OPCFG), 31, 30, 0b11)),
+    E("vsetvl",   Layout::VSetVL,   Funct7(OP_V, OPCFG, 0b1000000)),
+
+    // V: Integer arithmetic
+    V("vadd.vv", OPIVV, 0b000000),
+    V("vadd.vx", OPIVX, 0b000000),
+    V("vadd.vi", OPIVI, 0b000000),
+    V("vandn.vv", OPIVV, 0b000001),
+    V("vandn.vx", OPIVX, 0b000001),
+    V("vsub.vv", OPIVV, 0b000010),
+    V("vsub.vx", OPIVX, 0b000010),
+    V("vrsub.vx", OPIVX, 0b000011),
+    V("vrsub.vi", OPIVI, 0b000011),
+    V("vminu.vv", OPIVV, 0b000100),
+    V("vminu.vx", OPIVX, 0b000100),
+    V("vmin.vv", OPIVV, 0b000101),
+    V("vmin.vx", OPIVX, 0b000101),
+    V("vmaxu.vv", OPIVV, 0b000110),
+    V("vmaxu.vx", OPIVX, 0b000110),
+    V("vmax.vv", OPIVV, 0b000111),
+    V("vmax.vx", OPIVX, 0b000111),
+    V("vand.vv", OPIVV, 0b001001),
+    V("vand.vx", OPIVX, 0b001001),
+    V("vand.vi", OPIVI, 0b001001),
+    V("vor.vv", OPIVV, 0b001010),
+    V("vor.vx", OPIVX, 0b001010),
+    V("vor.vi", OPIVI, 0b001010),
+    V("vxor.vv", OPIVV, 0b001011),
+    V("vxor.vx", OPIVX, 0b001011),
+    V("vxor.vi", OPIVI, 0b001011),
+    V("vrgather.vv", OPIVV, 0b001100),
+    V("vrgather.vx", OPIVX, 0b001100),
+    VUImm("vrgather.vi", 0b001100),
+    V("vrgatherei16.vv", OPIVV, 0b001110),
+    V("vslideup.vx", OPIVX, 0b001110),
+    VUImm("vslideup.vi", 0b001110),
+    V("vslidedown.vx", OPIVX, 0b001111),
+    VUImm("vslidedown.vi", 0b001111),
+    VMasked("vadc.vvm", OPIVV, 0b010000, 0),
+    VMasked("vadc.vxm", OPIVX, 0b010000, 0),
+    VMasked("vadc.vim", OPIVI, 0b010000, 0),
+    VMasked("vmadc.vvm", OPIVV, 0b010001, 0),
+    VMasked("vmadc.vxm", OPIVX, 0b010001, 0),
+    VMasked("vmadc.vim", OPIVI, 0b010001, 0),
+    VMasked("vmadc.vv", OPIVV, 0b010001, 1),
+    VMasked("vmadc.vx", OPIVX, 0b010001, 1),
+    VMasked("vmadc.vi", OPIVI, 0b010001, 1),
+    VMasked("vsbc.vvm", OPIVV, 0b010010, 0),
+    VMasked("vsbc.vxm", OPIVX, 0b010010, 0),
+    VMasked("vmsbc.vvm", OPIVV, 0b010011, 0),
+    VMasked("vmsbc.vxm", OPIVX, 0b010011, 0),
+    VMasked("vmsbc.vv", OPIVV, 0b010011, 1),
+    VMasked("vmsbc.vx", OPIVX, 0b010011, 1),
+    V("vror.vv", OPIVV, 0b010100),
+    V("vror.vx", OPIVX, 0b010100),
+    E("vror.vi", Layout::VArithUImm6, With(Funct3(OP_V, OPIVI), 31, 27, 0b01010)),
+    V("vrol.vv", OPIVV, 0b010101),
+    V("vrol.vx", OPIVX, 0b010101),
+    VMasked("vmerge.vvm", OPIVV, 0b010111, 0),
+    VMasked("vmerge.vxm", OPIVX, 0b010111, 0),
+    VMasked("vmerge.vim", OPIVI, 0b010111, 0),
+    E("vmv.v.v", Layout::VArith, With(With(Vector(OPIVV, 0b010111), 25, 25, 1), 24, 20, 0)),
+    E("vmv.v.x", Layout::VArith, With(With(Vector(OPIVX, 0b010111), 25, 25, 1), 24, 20, 0)),
+    E("vmv.v.i", Layout::VArithSImm, With(With(Vector(OPIVI, 0b010111), 25, 25, 1), 24, 20, 0)),
+    V("vmseq.vv", OPIVV, 0b011000),
+    V("vmseq.vx", OPIVX, 0b011000),
+    V("vmseq.vi", OPIVI, 0b011000),
+    V("vmsne.vv", OPIVV, 0b011001),
+    V("vmsne.vx", OPIVX, 0b011001),
+    V("vmsne.vi", OPIVI, 0b011001),
+    V("vmsltu.vv", OPIVV, 0b011010),
+    V("vmsltu.vx", OPIVX, 0b011010),
+    V("vmslt.vv", OPIVV, 0b011011),
+    V("vmslt.vx", OPIVX, 0b011011),
+    V("vmsleu.vv", OPIVV, 0b011100),
+    V("vmsleu.vx", OPIVX, 0b011100),
+    V("vmsleu.vi", OPIVI, 0b011100),
+    V("vmsle.vv", OPIVV, 0b011101),
+    V("vmsle.vx", OPIVX, 0b011101),
+    V("vmsle.vi", OPIVI, 0b011101),
+    V("vmsgtu.vx", OPIVX, 0b011110),
+    V("vmsgtu.vi", OPIVI, 0b011110),
+    V("vmsgt.vx", OPIVX, 0b011111),
+    V("vmsgt.vi", OPIVI, 0b011111),
+    V("vsaddu.vv", OPIVV, 0b100000),
+    V("vsaddu.vx", OPIVX, 0b100000),
+    V("vsaddu.vi", OPIVI, 0b100000),
+    V("vsadd.vv", OPIVV, 0b100001),
+    V("vsadd.vx", OPIVX, 0b100001),
+    V("vsadd.vi", OPIVI, 0b100001),
+    V("vssubu.vv", OPIVV, 0b100010),
+    V("vssubu.vx", OPIVX, 0b100010),
+    V("vssub.vv", OPIVV, 0b100011),
+    V("vssub.vx", OPIVX, 0b100011),
+    V("vsll.vv", OPIVV, 0b100101),
+    V("vsll.vx", OPIVX, 0b100101),
+    VUImm("vsll.vi", 0b100101),
+    V("vsmul.vv", OPIVV, 0b100111),
+    V("vsmul.vx", OPIVX, 0b100111),
+    E("vmv1r.v", Layout::VArith, With(With(Vector(OPIVI, 0b100111), 25, 25, 1), 19, 15, 0)),
+    E("vmv2r.v", Layout::VArith, With(With(Vector(OPIVI, 0b100111), 25, 25, 1), 19, 15, 1)),
+    E("vmv4r.v", Layout::VArith, With(With(Vector(OPIVI, 0b100111), 25, 25, 1), 19, 15, 3)),
+    E("vmv8r.v", Layout::VArith, With(With(Vector(OPIVI, 0b100111), 25, 25, 1), 19, 15, 7)),
+    V("vsrl.vv", OPIVV, 0b101000),
+    V("vsrl.vx", OPIVX, 0b101000),
+    VUImm("vsrl.vi", 0b101000),
+    V("vsra.vv", OPIVV, 0b101001),
+    V("vsra.vx", OPIVX, 0b101001),
+    VUImm("vsra.vi", 0b101001),
+    V("vssrl.vv", OPIVV, 0b101010),
+    V("vssrl.vx", OPIVX, 0b101010),
+    VUImm("vssrl.vi", 0b101010),
+    V("vssra.vv", OPIVV, 0b101011),
+    V("vssra.vx", OPIVX, 0b101011),
+    VUImm("vssra.vi", 0b101011),
+    V("vnsrl.wv", OPIVV, 0b101100),
+    V("vnsrl.wx", OPIVX, 0b101100),
+    VUImm("vnsrl.wi", 0b101100),
+    V("vnsra.wv", OPIVV, 0b101101),
+    V("vnsra.wx", OPIVX, 0b101101),
+    VUImm("vnsra.wi", 0b101101),
+    V("vnclipu.wv", OPIVV, 0b101110),
+    V("vnclipu.wx", OPIVX, 0b101110),
+    VUImm("vnclipu.wi", 0b101110),
+    V("vnclip.wv", OPIVV, 0b101111),
+    V("vnclip.wx", OPIVX, 0b101111),
+    VUImm("vnclip.wi", 0b101111),
+    V("vwredsumu.vs", OPIVV, 0b110000),
+    V("vwredsum.vs", OPIVV, 0b110001),
+    V("vwsll.vv", OPIVV, 0b110101),
+    V("vwsll.vx", OPIVX, 0b110101),
+    VUImm("vwsll.vi", 0b110101),
+
+    // V: Integer multiply, divide and reductions
+    V("vredsum.vs", OPMVV, 0b000000),
+    V("vredand.vs", OPMVV, 0b000001),
+    V("vredor.vs", OPMVV, 0b000010),
+    V("vredxor.vs", OPMVV, 0b000011),
+    V("vredminu.vs", OPMVV, 0b000100),
+    V("vredmin.vs", OPMVV, 0b000101),
+    V("vredmaxu.vs", OPMVV, 0b000110),
+    V("vredmax.vs", OPMVV, 0b000111),
+    V("vaaddu.vv", OPMVV, 0b001000),
+    V("vaaddu.vx", OPMVX, 0b001000),
+    V("vaadd.vv", OPMVV, 0b001001),
+    V("vaadd.vx", OPMVX, 0b001001),
+    V("vasubu.vv", OPMVV, 0b001010),
+    V("vasubu.vx", OPMVX, 0b001010),
+    V("vasub.vv", OPMVV, 0b001011),
+    V("vasub.vx", OPMVX, 0b001011),
+    V("vclmul.vv", OPMVV, 0b001100),
+    V("vclmul.vx", OPMVX, 0b001100),
+    V("vclmulh.vv", OPMVV, 0b001101),
+    V("vclmulh.vx", OPMVX, 0b001101),
+    V("vslide1up.vx", OPMVX, 0b001110),
+    V("vslide1down.vx", OPMVX, 0b001111),
+    VUnary("vmv.x.s", OPMVV, 0b010000, 0b00000),
+    VUnary("vcpop.m", OPMVV, 0b010000, 0b10000),
+    VUnary("vfirst.m", OPMVV, 0b010000, 0b10001),
+    E("vmv.s.x", Layout::VArith, With(With(Vector(OPMVX, 0b010000), 25, 25, 1), 24, 20, 0)),
+    VUnary("vzext.vf8", OPMVV, 0b010010, 0b00010),
+    VUnary("vsext.vf8", OPMVV, 0b010010, 0b00011),
+    VUnary("vzext.vf4", OPMVV, 0b010010, 0b00100),
+    VUnary("vsext.vf4", OPMVV, 0b010010, 0b00101),
+    VUnary("vzext.vf2", OPMVV, 0b010010, 0b00110),
+    VUnary("vsext.vf2", OPMVV, 0b010010, 0b00111),
+    VUnary("vbrev8.v", OPMVV, 0b010010, 0b01000),
+    VUnary("vrev8.v", OPMVV, 0b010010, 0b01001),
+    VUnary("vbrev.v", OPMVV, 0b010010, 0b01010),
+    VUnary("vclz.v", OPMVV, 0b010010, 0b01100),
+    VUnary("vctz.v", OPMVV, 0b010010, 0b01101),
+    VUnary("vcpop.v", OPMVV, 0b010010, 0b01110),
+    VUnary("vmsbf.m", OPMVV, 0b010100, 0b00001),
+    VUnary("vmsof.m", OPMVV, 0b010100, 0b00010),
+    VUnary("vmsif.m", OPMVV, 0b010100, 0b00011),
+    VUnary("viota.m", OPMVV, 0b010100, 0b10000),
+    E("vid.v", Layout::VArith, With(With(Vector(OPMVV, 0b010100), 19, 15, 0b10001), 24, 20, 0)),
+    VMasked("vcompress.vm", OPMVV, 0b010111, 1),
+    VMasked("vmandn.mm", OPMVV, 0b011000, 1),
+    VMasked("vmand.mm", OPMVV, 0b011001, 1),
+    VMasked("vmor.mm", OPMVV, 0b011010, 1),
+    VMasked("vmxor.mm", OPMVV, 0b011011, 1),
+    VMasked("vmorn.mm", OPMVV, 0b011100, 1),
+    VMasked("vmnand.mm", OPMVV, 0b011101, 1),
+    VMasked("vmnor.mm", OPMVV, 0b011110, 1),
+    VMasked("vmxnor.mm", OPMVV, 0b011111, 1),
+    V("vdivu.vv", OPMVV, 0b100000),
+    V("vdivu.vx", OPMVX, 0b100000),
+    V("vdiv.vv", OPMVV, 0b100001),
+    V("vdiv.vx", OPMVX, 0b100001),
+    V("vremu.vv", OPMVV, 0b100010),
+    V("vremu.vx", OPMVX, 0b100010),
+    V("vrem.vv", OPMVV, 0b100011),
+    V("vrem.vx", OPMVX, 0b100011),
+    V("vmulhu.vv", OPMVV, 0b100100),
+    V("vmulhu.vx", OPMVX, 0b100100),
+    V("vmul.vv", OPMVV, 0b100101),
+    V("vmul.vx", OPMVX, 0b100101),
+    V("vmulhsu.vv", OPMVV, 0b100110),
+    V("vmulhsu.vx", OPMVX, 0b100110),
+    V("vmulh.vv", OPMVV, 0b100111),
+    V("vmulh.vx", OPMVX, 0b100111),
+    V("vmadd.vv", OPMVV, 0b101001),
+    V("vmadd.vx", OPMVX, 0b101001),
+    V("vnmsub.vv", OPMVV, 0b101011),
+    V("vnmsub.vx", OPMVX, 0b101011),
+    V("vmacc.vv", OPMVV, 0b101101),
+    V("vmacc.vx", OPMVX, 0b101101),
+    V("vnmsac.vv", OPMVV, 0b101111),
+    V("vnmsac.vx", OPMVX, 0b101111),
+    V("vwaddu.vv", OPMVV, 0b110000),
+    V("vwaddu.vx", OPMVX, 0b110000),
+    V("vwadd.vv", OPMVV, 0b110001),
+    V("vwadd.vx", OPMVX, 0b110001),
+    V("vwsubu.vv", OPMVV, 0b110010),
+    V("vwsubu.vx", OPMVX, 0b110010),
+    V("vwsub.vv", OPMVV, 0b110011),
+    V("vwsub.vx", OPMVX, 0b110011),
+    V("vwaddu.wv", OPMVV, 0b110100),
+    V("vwaddu.wx", OPMVX, 0b110100),
+    V("vwadd.wv", OPMVV, 0b110101),
+    V("vwadd.wx", OPMVX, 0b110101),
+    V("vwsubu.wv", OPMVV, 0b110110),
+    V("vwsubu.wx", OPMVX, 0b110110),
+    V("vwsub.wv", OPMVV, 0b110111),
+    V("vwsub.wx", OPMVX, 0b110111),
+    V("vwmulu.vv", OPMVV, 0b111000),
+    V("vwmulu.vx", OPMVX, 0b111000),
+    V("vwmulsu.vv", OPMVV, 0b111010),
+    V("vwmulsu.vx", OPMVX, 0b111010),
+    V("vwmul.vv", OPMVV, 0b111011),
+    V("vwmul.vx", OPMVX, 0b111011),
+    V("vwmaccu.vv", OPMVV, 0b111100),
+    V("vwmaccu.vx", OPMVX, 0b111100),
+    V("vwmacc.vv", OPMVV, 0b111101),
+    V("vwmacc.vx", OPMVX, 0b111101),
+    V("vwmaccus.vx", OPMVX, 0b111110),
+    V("vwmaccsu.vv", OPMVV, 0b111111),
+    V("vwmaccsu.vx", OPMVX, 0b111111),
+
+    // V: Floating-point arithmetic
+    V("vfadd.vv", OPFVV, 0b000000),
+    V("vfadd.vf", OPFVF, 0b000000),
+    V("vfredusum.vs", OPFVV, 0b000001),
+    V("vfsub.vv", OPFVV, 0b000010),
+    V("vfsub.vf", OPFVF, 0b000010),
+    V("vfredosum.vs", OPFVV, 0b000011),
+    V("vfmin.vv", OPFVV, 0b000100),
+    V("vfmin.vf", OPFVF, 0b000100),
+    V("vfredmin.vs", OPFVV, 0b000101),
+    V("vfmax.vv", OPFVV, 0b000110),
+    V("vfmax.vf", OPFVF, 0b000110),
+    V("vfredmax.vs", OPFVV, 0b000111),
+    V("vfsgnj.vv", OPFVV, 0b001000),
+    V("vfsgnj.vf", OPFVF, 0b001000),
+    V("vfsgnjn.vv", OPFVV, 0b001001),
+    V("vfsgnjn.vf", OPFVF, 0b001001),
+    V("vfsgnjx.vv", OPFVV, 0b001010),
+    V("vfsgnjx.vf", OPFVF, 0b001010),
+    V("vfslide1up.vf", OPFVF, 0b001110),
+    V("vfslide1down.vf", OPFVF, 0b001111),
+    VUnary("vfmv.f.s", OPFVV, 0b010000, 0b00000),
+    E("vfmv.s.f", Layout::VArith, With(With(Vector(OPFVF, 0b010000), 25, 25, 1), 24, 20, 0)),
+    VUnary("vfcvt.xu.f.v", OPFVV, 0b010010, 0b00000),
+    VUnary("vfcvt.x.f.v", OPFVV, 0b010010, 0b00001),
+    VUnary("vfcvt.f.xu.v", OPFVV, 0b010010, 0b00010),
+    VUnary("vfcvt.f.x.v", OPFVV, 0b010010, 0b00011),
+    VUnary("vfcvt.rtz.xu.f.v", OPFVV, 0b010010, 0b00110),
+    VUnary("vfcvt.rtz.x.f.v", OPFVV, 0b010010, 0b00111),
+    VUnary("vfwcvt.xu.f.v", OPFVV, 0b010010, 0b01000),
+    VUnary("vfwcvt.x.f.v", OPFVV, 0b010010, 0b01001),
+    VUnary("vfwcvt.f.xu.v", OPFVV, 0b010010, 0b01010),
+    VUnary("vfwcvt.f.x.v", OPFVV, 0b010010, 0b01011),
+    VUnary("vfwcvt.f.f.v", OPFVV, 0b010010, 0b01100),
+    VUnary("vfwcvtbf16.f.f.v", OPFVV, 0b010010, 0b01101),
+    VUnary("vfwcvt.rtz.xu.f.v", OPFVV, 0b010010, 0b01110),
+    VUnary("vfwcvt.rtz.x.f.v", OPFVV, 0b010010, 0b01111),
+    VUnary("vfncvt.xu.f.w", OPFVV, 0b010010, 0b10000),
+    VUnary("vfncvt.x.f.w", OPFVV, 0b010010, 0b10001),
+    VUnary("vfncvt.f.xu.w", OPFVV, 0b010010, 0b10010),
+    VUnary("vfncvt.f.x.w", OPFVV, 0b010010, 0b10011),
+    VUnary("vfncvt.f.f.w", OPFVV, 0b010010, 0b10100),
+    VUnary("vfncvt.rod.f.f.w", OPFVV, 0b010010, 0b10101),
+    VUnary("vfncvt.rtz.xu.f.w", OPFVV, 0b010010, 0b10110),
+    VUnary("vfncvt.rtz.x.f.w", OPFVV, 0b010010, 0b10111),
+    VUnary("vfncvtbf16.f.f.w", OPFVV, 0b010010, 0b11101),
+    VUnary("vfsqrt.v", OPFVV, 0b010011, 0b00000),
+    VUnary("vfrsqrt7.v", OPFVV, 0b010011, 0b00100),
+    VUnary("vfrec7.v", OPFVV, 0b010011, 0b00101),
+    VUnary("vfclass.v", OPFVV, 0b010011, 0b10000),
+    VMasked("vfmerge.vfm", OPFVF, 0b010111, 0),
+    E("vfmv.v.f", Layout::VArith, With(With(Vector(OPFVF, 0b010111), 25, 25, 1), 24, 20, 0)),
+    V("vmfeq.vv", OPFVV, 0b011000),
+    V("vmfeq.vf", OPFVF, 0b011000),
+    V("vmfle.vv", OPFVV, 0b011001),
+    V("vmfle.vf", OPFVF, 0b011001),
+    V("vmflt.vv", OPFVV, 0b011011),
+    V("vmflt.vf", OPFVF, 0b011011),
+    V("vmfne.vv", OPFVV, 0b011100),
+    V("vmfne.vf", OPFVF, 0b011100),
+    V("vmfgt.vf", OPFVF, 0b011101),
+    V("vmfge.vf", OPFVF, 0b011111),
+    V("vfdiv.vv", OPFVV, 0b100000),
+    V("vfdiv.vf", OPFVF, 0b100000),
+    V("vfrdiv.vf", OPFVF, 0b100001),
+    V("vfmul.vv", OPFVV, 0b100100),
+    V("vfmul.vf", OPFVF, 0b100100),
+    V("vfrsub.vf", OPFVF, 0b100111),
+    V("vfmadd.vv", OPFVV, 0b101000),
+    V("vfmadd.vf", OPFVF, 0b101000),
+    V("vfnmadd.vv", OPFVV, 0b101001),
+    V("vfnmadd.vf", OPFVF, 0b101001),
+    V("vfmsub.vv", OPFVV, 0b101010),
+    V("vfmsub.vf", OPFVF, 0b101010),
+    V("vfnmsub.vv", OPFVV, 0b101011),
+    V("vfnmsub.vf", OPFVF, 0b101011),
+    V("vfmacc.vv", OPFVV, 0b101100),
+    V("vfmacc.vf", OPFVF, 0b101100),
+    V("vfnmacc.vv", OPFVV, 0b101101),
+    V("vfnmacc.vf", OPFVF, 0b101101),
+    V("vfmsac.vv", OPFVV, 0b101110),
+    V("vfmsac.vf", OPFVF, 0b101110),
+    V("vfnmsac.vv", OPFVV, 0b101111),
+    V("vfnmsac.vf", OPFVF, 0b101111),
+    V("vfwadd.vv", OPFVV, 0b110000),
+    V("vfwadd.vf", OPFVF, 0b110000),
+    V("vfwredusum.vs", OPFVV, 0b110001),
+    V("vfwsub.vv", OPFVV, 0b110010),
+    V("vfwsub.vf", OPFVF, 0b110010),
+    V("vfwredosum.vs", OPFVV, 0b110011),
+    V("vfwadd.wv", OPFVV, 0b110100),
+    V("vfwadd.wf", OPFVF, 0b110100),
+    V("vfwsub.wv", OPFVV, 0b110110),
+    V("vfwsub.wf", OPFVF, 0b110110),
+    V("vfwmul.vv", OPFVV, 0b111000),
+    V("vfwmul.vf", OPFVF, 0b111000),
+    V("vfwmaccbf16.vv", OPFVV, 0b111011),
+    V("vfwmaccbf16.vf", OPFVF, 0b111011),
+    V("vfwmacc.vv", OPFVV, 0b111100),
+    V("vfwmacc.vf", OPFVF, 0b111100),
+    V("vfwnmacc.vv", OPFVV, 0b111101),
+    V("vfwnmacc.vf", OPFVF, 0b111101),
+    V("vfwmsac.vv", OPFVV, 0b111110),
+    V("vfwmsac.vf", OPFVF, 0b111110),
+    V("vfwnmsac.vv", OPFVV, 0b111111),
+    V("vfwnmsac.vf", OPFVF, 0b111111),
+
+    // V: Cryptography
+    VCrypto("vaesdm.vv", 0b101000, 0b00000),
+    VCrypto("vaesdf.vv", 0b101000, 0b00001),
+    VCrypto("vaesem.vv", 0b101000, 0b00010),
+    VCrypto("vaesef.vv", 0b101000, 0b00011),
+    VCrypto("vsm4r.vv", 0b101000, 0b10000),
+    VCrypto("vgmul.vv", 0b101000, 0b10001),
+    VCrypto("vaesdm.vs", 0b101001, 0b00000),
+    VCrypto("vaesdf.vs", 0b101001, 0b00001),
+    VCrypto("vaesem.vs", 0b101001, 0b00010),
+    VCrypto("vaesef.vs", 0b101001, 0b00011),
+    VCrypto("vaesz.vs", 0b101001, 0b00111),
+    VCrypto("vsm4r.vs", 0b101001, 0b10000),
+    VCrypto("vsm3me.vv", Layout::VArith, 0b100000),
+    VCrypto("vsm4k.vi", Layout::VArithUImm, 0b100001),
+    VCrypto("vaeskf1.vi", Layout::VArithUImm, 0b100010),
+    VCrypto("vaeskf2.vi", Layout::VArithUImm, 0b101010),
+    VCrypto("vsm3c.vi", Layout::VArithUImm, 0b101011),
+    VCrypto("vghsh.vv", Layout::VArith, 0b101100),
+    VCrypto("vsha2ms.vv", Layout::VArith, 0b101101),
+    VCrypto("vsha2ch.vv", Layout::VArith, 0b101110),
+    VCrypto("vsha2cl.vv", Layout::VArith, 0b101111),
+
+    // V: Loads
+    VLoad("vle8.v", mop_unit_stride, 0b00000, width_e8),
+    VLoad("vle16.v", mop_unit_stride, 0b00000, width_e16),
+    VLoad("vle32.v", mop_unit_stride, 0b00000, width_e32),
+    VLoad("vle64.v", mop_unit_stride, 0b00000, width_e64),
+    VLoad("vle8ff.v", mop_unit_stride, 0b10000, width_e8),
+    VLoad("vle16ff.v", mop_unit_stride, 0b10000, width_e16),
+    VLoad("vle32ff.v", mop_unit_stride, 0b10000, width_e32),
+    VLoad("vle64ff.v", mop_unit_stride, 0b10000, width_e64),
+    VLoad("vlm.v", mop_unit_stride, 0b01011, width_e8),
+    VLoad("vlse8.v", mop_strided, -1, width_e8),
+    VLoad("vlse16.v", mop_strided, -1, width_e16),
+    VLoad("vlse32.v", mop_strided, -1, width_e32),
+    VLoad("vlse64.v", mop_strided, -1, width_e64),
+    VLoad("vluxei8.v", mop_indexed_unordered, -1, width_e8),
+    VLoad("vluxei16.v", mop_indexed_unordered, -1, width_e16),
+    VLoad("vluxei32.v", mop_indexed_unordered, -1, width_e32),
+    VLoad("vluxei64.v", mop_indexed_unordered, -1, width_e64),
+    VLoad("vloxei8.v", mop_indexed_ordered, -1, width_e8),
+    VLoad("vloxei16.v", mop_indexed_ordered, -1, width_e16),
+    VLoad("vloxei32.v", mop_indexed_ordered, -1, width_e32),
+    VLoad("vloxei64.v", mop_indexed_ordered, -1, width_e64),
+    BISCUIT_VSEG("vlseg", "e8.v", VLoad, mop_unit_stride, 0b00000, width_e8),
+    BISCUIT_VSEG("vlseg", "e16.v", VLoad, mop_unit_stride, 0b00000, width_e16),
+    BISCUIT_VSEG("vlseg", "e32.v", VLoad, mop_unit_stride, 0b00000, width_e32),
+    BISCUIT_VSEG("vlseg", "e64.v", VLoad, mop_unit_stride, 0b00000, width_e64),
+    BISCUIT_VSEG("vlsseg", "e8.v", VLoad, mop_strided, -1, width_e8),
+    BISCUIT_VSEG("vlsseg", "e16.v", VLoad, mop_strided, -1, width_e16),
+    BISCUIT_VSEG("vlsseg", "e32.v", VLoad, mop_strided, -1, width_e32),
+    BISCUIT_VSEG("vlsseg", "e64.v", VLoad, mop_strided, -1, width_e64),
+    BISCUIT_VSEG("vluxseg", "ei8.v", VLoad, mop_indexed_unordered, -1, width_e8),
+    BISCUIT_VSEG("vluxseg", "ei16.v", VLoad, mop_indexed_unordered, -1, width_e16),
+    BISCUIT_VSEG("vluxseg", "ei32.v", VLoad, mop_indexed_unordered, -1, width_e32),
+    BISCUIT_VSEG("vluxseg", "ei64.v", VLoad, mop_indexed_unordered, -1, width_e64),
+    BISCUIT_VSEG("vloxseg", "ei8.v", VLoad, mop_indexed_ordered, -1, width_e8),
+    BISCUIT_VSEG("vloxseg", "ei16.v", VLoad, mop_indexed_ordered, -1, width_e16),
+    BISCUIT_VSEG("vloxseg", "ei32.v", VLoad, mop_indexed_ordered, -1, width_e32),
+    BISCUIT_VSEG("vloxseg", "ei64.v", VLoad, mop_indexed_ordered, -1, width_e64),
+    VWholeReg("vl1re8.v", Layout::VLoad, LOAD_FP, width_e8, 0),
+    VWholeReg("vl1re16.v", Layout::VLoad, LOAD_FP, width_e16, 0),
+    VWholeReg("vl1re32.v", Layout::VLoad, LOAD_FP, width_e32, 0),
+    VWholeReg("vl1re64.v", Layout::VLoad, LOAD_FP, width_e64, 0),
+    VWholeReg("vl2re8.v", Layout::VLoad, LOAD_FP, width_e8, 1),
+    VWholeReg("vl2re16.v", Layout::VLoad, LOAD_FP, width_e16, 1),
+    VWholeReg("vl2re32.v", Layout::VLoad, LOAD_FP, width_e32, 1),
+    VWholeReg("vl2re64.v", Layout::VLoad, LOAD_FP, width_e64, 1),
+    VWholeReg("vl4re8.v", Layout::VLoad, LOAD_FP, width_e8, 3),
+    VWholeReg("vl4re16.v", Layout::VLoad, LOAD_FP, width_e16, 3),
+    VWholeReg("vl4re32.v", Layout::VLoad, LOAD_FP, width_e32, 3),
+    VWholeReg("vl4re64.v", Layout::VLoad, LOAD_FP, width_e64, 3),
+    VWholeReg("vl8re8.v", Layout::VLoad, LOAD_FP, width_e8, 7),
+    VWholeReg("vl8re16.v", Layout::VLoad, LOAD_FP, width_e16, 7),
+    VWholeReg("vl8re32.v", Layout::VLoad, LOAD_FP, width_e32, 7),
+    VWholeReg("vl8re64.v", Layout::VLoad, LOAD_FP, width_e64, 7),
+
+    // V: Stores
+    VStore("vse8.v", mop_unit_stride, 0b00000, width_e8),
+    VStore("vse16.v", mop_unit_stride, 0b00000, width_e16),
+    VStore("vse32.v", mop_unit_stride, 0b00000, width_e32),
+    VStore("vse64.v", mop_unit_stride, 0b00000, width_e64),
+    VStore("vsm.v", mop_unit_stride, 0b01011, width_e8),
+    VStore("vsse8.v", mop_strided, -1, width_e8),
+    VStore("vsse16.v", mop_strided, -1, width_e16),
+    VStore("vsse32.v", mop_strided, -1, width_e32),
+    VStore("vsse64.v", mop_strided, -1, width_e64),
+    VStore("vsuxei8.v", mop_indexed_unordered, -1, width_e8),
+    VStore("vsuxei16.v", mop_indexed_unordered, -1, width_e16),
+    VStore("vsuxei32.v", mop_indexed_unordered, -1, width_e32),
+    VStore("vsuxei64.v", mop_indexed_unordered, -1, width_e64),
+    VStore("vsoxei8.v", mop_indexed_ordered, -1, width_e8),
+    VStore("vsoxei16.v", mop_indexed_ordered, -1, width_e16),
+    VStore("vsoxei32.v", mop_indexed_ordered, -1, width_e32),
+    VStore("vsoxei64.v", mop_indexed_ordered, -1, width_e64),
+    BISCUIT_VSEG("vsseg", "e8.v", VStore, mop_unit_stride, 0b00000, width_e8),
+    BISCUIT_VSEG("vsseg", "e16.v", VStore, mop_unit_stride, 0b00000, width_e16),
+    BISCUIT_VSEG("vsseg", "e32.v", VStore, mop_unit_stride, 0b00000, width_e32),
+    BISCUIT_VSEG("vsseg", "e64.v", VStore, mop_unit_stride, 0b00000, width_e64),
+    BISCUIT_VSEG("vssseg", "e8.v", VStore, mop_strided, -1, width_e8),
+    BISCUIT_VSEG("vssseg", "e16.v", VStore, mop_strided, -1, width_e16),
+    BISCUIT_VSEG("vssseg", "e32.v", VStore, mop_strided, -1, width_e32),
+    BISCUIT_VSEG("vssseg", "e64.v", VStore, mop_strided, -1, width_e64),
+    BISCUIT_VSEG("vsuxseg", "ei8.v", VStore, mop_indexed_unordered, -1, width_e8),
+    BISCUIT_VSEG("vsuxseg", "ei16.v", VStore, mop_indexed_unordered, -1, width_e16),
+    BISCUIT_VSEG("vsuxseg", "ei32.v", VStore, mop_indexed_unordered, -1, width_e32),
+    BISCUIT_VSEG("vsuxseg", "ei64.v", VStore, mop_indexed_unordered, -1, width_e64),
+    BISCUIT_VSEG("vsoxseg", "ei8.v", VStore, mop_indexed_ordered, -1, width_e8),
+    BISCUIT_VSEG("vsoxseg", "ei16.v", VStore, mop_indexed_ordered, -1, width_e16),
+    BISCUIT_VSEG("vsoxseg", "ei32.v", VStore, mop_indexed_ordered, -1, width_e32),
+    BISCUIT_VSEG("vsoxseg", "ei64.v", VStore, mop_indexed_ordered, -1, width_e64),
+    VWholeReg("vs1r.v", Layout::VStore, STORE_FP, width_e8, 0),
+    VWholeReg("vs2r.v", Layout::VStore, STORE_FP, width_e8, 1),
+    VWholeReg("vs4r.v", Layout::VStore, STORE_FP, width_e8, 3),
+    VWholeReg("vs8r.v", Layout::VStore, STORE_FP, width_e8, 7),
+
+    // C: Quadrant 0
+    E("c.addi4spn", Layout::CIW, Compressed(0b00, 0b000)),
+    E("c.fld",      Layout::CLD, Compressed(0b00, 0b001), rv32_or_rv64),
+    E("c.lq",       Layout::CLQ, Compressed(0b00, 0b001), rv128),
+    E("c.lw",       Layout::CLW, Compressed(0b00, 0b010)),
+    E("c.flw",      Layout::CLW, Compressed(0b00, 0b011), rv32),
+    E("c.ld",       Layout::CLD, Compressed(0b00, 0b011), rv64),
+    E("c.fsd",      Layout::CSD, Compressed(0b00, 0b101), rv32_or_rv64),
+    E("c.sq",       Layout::CSQ, Compressed(0b00, 0b101), rv128),
+    E("c.sw",       Layout::CSW, Compressed(0b00, 0b110)),
+    E("c.fsw",      Layout::CSW, Compressed(0b00, 0b111), rv32),
+    E("c.sd",       Layout::CSD, Compressed(0b00, 0b111), rv64),
+    E("c.lbu",      Layout::CLB, {0xFC03, 0x8000}),
+    E("c.lhu",      Layout::CLH, {0xFC43, 0x8400}),
+    E("c.lh",       Layout::CLH, {0xFC43, 0x8440}),
+    E("c.sb",       Layout::CSB, {0xFC03, 0x8800}),
+    E("c.sh",       Layout::CSH, {0xFC43, 0x8C00}),
+
+    // C: Quadrant 1
+    E("c.nop",      Layout::CI,         CompressedExact(0x0001)),
+    E("c.addi",     Layout::CI,         Compressed(0b01, 0b000)),
+    E("c.jal",      Layout::CJ,         Compressed(0b01, 0b001), rv32),
+    E("c.addiw",    Layout::CI,         Compressed(0b01, 0b001), rv64),
+    E("c.li",       Layout::CI,         Compressed(0b01, 0b010)),
+    E("c.lui",      Layout::CILui,      Compressed(0b01, 0b011)),
+    E("c.addi16sp", Layout::CIAddi16sp, {0xEF83, 0x6101}),
+    E("c.srli",     Layout::CBShift,    {0xEC03, 0x8001}),
+    E("c.srai",     Layout::CBShift,    {0xEC03, 0x8401}),
+    E("c.andi",     Layout::CBImm,      {0xEC03, 0x8801}),
+    E("c.sub",      Layout::CA,         {0xFC63, 0x8C01}),
+    E("c.xor",      Layout::CA,         {0xFC63, 0x8C21}),
+    E("c.or",       Layout::CA,         {0xFC63, 0x8C41}),
+    E("c.and",      Layout::CA,         {0xFC63, 0x8C61}),
+    E("c.subw",     Layout::CA,         {0xFC63, 0x9C01}, rv64),
+    E("c.addw",     Layout::CA,         {0xFC63, 0x9C21}, rv64),
+    E("c.mul",      Layout::CA,         {0xFC63, 0x9C41}),
+    E("c.zext.b",   Layout::CU,         {0xFC7F, 0x9C61}),
+    E("c.sext.b",   Layout::CU,         {0xFC7F, 0x9C65}),
+    E("c.zext.h",   Layout::CU,         {0xFC7F, 0x9C69}),
+    E("c.sext.h",   Layout::CU,         {0xFC7F, 0x9C6D}),
+    E("c.zext.w",   Layout::CU,         {0xFC7F, 0x9C71}, rv64),
+    E("c.not",      Layout::CU,         {0xFC7F, 0x9C75}),
+    E("c.j",        Layout::CJ,         Compressed(0b01, 0b101)),
+    E("c.beqz",     Layout::CBBranch,   Compressed(0b01, 0b110)),
+    E("c.bnez",     Layout::CBBranch,   Compressed(0b01, 0b111)),
+
+    // C: Quadrant 2
+    E("c.slli",      Layout::CIShift, Compressed(0b10, 0b000)),
+    E("c.fldsp",     Layout::CILdsp,  Compressed(0b10, 0b001), rv32_or_rv64),
+    E("c.lqsp",      Layout::CILqsp,  Compressed(0b10, 0b001), rv128),
+    E("c.lwsp",      Layout::CILwsp,  Compressed(0b10, 0b010)),
+    E("c.flwsp",     Layout::CILwsp,  Compressed(0b10, 0b011), rv32),
+    E("c.ldsp",      Layout::CILdsp,  Compressed(0b10, 0b011), rv64),
+    E("c.jr",        Layout::CR,      {0xF07F, 0x8002}),
+    E("c.mv",        Layout::CR,      {0xF003, 0x8002}),
+    E("c.ebreak",    Layout::CR,      CompressedExact(0x9002)),
+    E("c.jalr",      Layout::CR,      {0xF07F, 0x9002}),
+    E("c.add",       Layout::CR,      {0xF003, 0x9002}),
+    E("c.ntl.p1",    Layout::CR,      CompressedExact(0x900A)),
+    E("c.ntl.pall",  Layout::CR,      CompressedExact(0x900E)),
+    E("c.ntl.s1",    Layout::CR,      CompressedExact(0x9012)),
+    E("c.ntl.all",   Layout::CR,      CompressedExact(0x9016)),
+    E("c.fsdsp",     Layout::CSSdsp,  Compressed(0b10, 0b101), rv32_or_rv64 | variant_not_zcm),
+    E("c.sqsp",      Layout::CSSqsp,  Compressed(0b10, 0b101), rv128),
+    E("c.swsp",      Layout::CSSwsp,  Compressed(0b10, 0b110)),
+    E("c.fswsp",     Layout::CSSwsp,  Compressed(0b10, 0b111), rv32),
+    E("c.sdsp",      Layout::CSSdsp,  Compressed(0b10, 0b111), rv64),
+
+    // Zcmp and Zcmt
+    E("cm.push",    Layout::CMPP, {0xFF03, 0xB802}, any_xlen | variant_zcmp),
+    E("cm.pop",     Layout::CMPP, {0xFF03, 0xBA02}, any_xlen | variant_zcmp),
+    E("cm.popretz", Layout::CMPP, {0xFF03, 0xBC02}, any_xlen | variant_zcmp),
+    E("cm.popret",  Layout::CMPP, {0xFF03, 0xBE02}, any_xlen | variant_zcmp),
+    E("cm.mvsa01",  Layout::CMMV, {0xFC63, 0xAC22}, any_xlen | variant_zcmp),
+    E("cm.mva01s",  Layout::CMMV, {0xFC63, 0xAC62}, any_xlen | variant_zcmp),
+    E("cm.jt",      Layout::CMJT, {0xFF83, 0xA002}, any_xlen | variant_zcmt),
+    E("cm.jalt",    Layout::CMJT, {0xFC03, 0xA002}, any_xlen | variant_zcmt),
+};
+// clang-format on
+
+#undef BISCUIT_FCVT_INT
+#undef BISCUIT_FMA
+#undef BISCUIT_FP_UNARY
+#undef BISCUIT_FP_F3
+#undef BISCUIT_FP_ARITH
+#undef BISCUIT_FP
+#undef BISCUIT_VSEG
+
+constexpr bool IsCompressed(uint32_t encoding) {
+    return (encoding & 0b11) != 0b11;
+}
+
+// Entries are grouped into buckets by their quadrant and funct3 for compressed
+// instructions, or by their major opcode and funct3 for regular instructions.
+constexpr size_t compressed_bucket_count = 32;
+constexpr size_t bucket_count = compressed_bucket_count + 256;
+
+constexpr size_t GetBucket(uint32_t encoding) {
+    if (IsCompressed(encoding)) {
+        return (((encoding >> 13) & 0b111) << 2) | (encoding & 0b11);
+    }
+    return compressed_bucket_count + ((((encoding >> 12) & 0b111) << 5) | ((encoding >> 2) & 0b11111));
+}
+
+using Buckets = std::array<std::vector<const Entry*>, bucket_count>;
+
+Buckets BuildBuckets() {
+    Buckets buckets;
+
+    for (const auto& entry : entries) {
+        // Add the entry to every bucket it could match within.
+        for (uint32_t funct3 = 0; funct3 < 8; funct3++) {
+            if (IsCompressed(entry.match)) {
+                const auto candidate = (funct3 << 13) | (entry.match & 0b11);
+                if (((candidate ^ entry.match) & entry.mask & 0xE003) == 0) {
+                    buckets[GetBucket(candidate)].push_back(&entry);
+                }
+            } else {
+                const auto candidate = (funct3 << 12) | (entry.match & 0x7F);
+                if (((candidate ^ entry.match) & entry.mask & 0x707F) == 0) {
+                    buckets[GetBucket(candidate)].push_back(&entry);
+                }
+            }
+        }
+    }
+
+    // Check more specific encodings first, so that, for example,
+    // C.NOP takes precedence over C.ADDI.
+    for (auto& bucket : buckets) {
+        std::stable_sort(bucket.begin(), bucket.end(), [](const Entry* lhs, const Entry* rhs) {
+            return std::popcount(lhs->mask) > std::popcount(rhs->mask);
+        });
+    }
+
+    return buckets;
+}
+
+const Buckets& GetBuckets() {
+    static const Buckets buckets = BuildBuckets();
+    return buckets;
+}
+
+constexpr uint32_t Bits(uint32_t value, uint32_t hi, uint32_t lo) {
+    return (value >> lo) & ((uint32_t{1} << (hi - lo + 1)) - 1);
+}
+
+constexpr int64_t SignExtend(uint32_t value, uint32_t bits) {
+    const auto shift = 64 - bits;
+    return static_cast<int64_t>(static_cast<uint64_t>(value) << shift) >> shift;
+}
+
+// Expands a 3-bit compressed register field.
+constexpr uint32_t CompressedReg(uint32_t encoding, uint32_t lo) {
+    return Bits(encoding, lo + 2, lo) + 8;
+}
+
+// Expands a 3-bit Zcmp register field into s0-s7.
+constexpr uint32_t CompressedSReg(uint32_t encoding, uint32_t lo) {
+    const auto reg = Bits(encoding, lo + 2, lo);
+    return reg < 2 ? reg + 8 : reg + 16;
+}
+
+// Extracts the contiguous unmasked bits of a field, for encodings
+// that place additional function bits within their immediate.
+constexpr uint32_t UnmaskedBits(uint32_t encoding, uint32_t mask, uint32_t field) {
+    const auto free_bits = field & ~mask;
+    if (free_bits == 0) {
+        return 0;
+    }
+    return (encoding & free_bits) >> std::countr_zero(free_bits);
+}
+
+constexpr InstructionFormat GetLayoutFormat(Layout layout) {
+    switch (layout) {
+    case Layout::R:
+        return InstructionFormat::R;
+    case Layout::R4:
+        return InstructionFormat::R4;
+    case Layout::I:
+    case Layout::CSR:
+    case Layout::Prefetch:
+        return InstructionFormat::I;
+    case Layout::S:
+        return InstructionFormat::S;
+    case Layout::B:
+        return InstructionFormat::B;
+    case Layout::U:
+        return InstructionFormat::U;
+    case Layout::J:
+        return InstructionFormat::J;
+    case Layout::VArith:
+    case Layout::VArithSImm:
+    case Layout::VArithUImm:
+    case Layout::VArithUImm6:
+        return InstructionFormat::VArith;
+    case Layout::VLoad:
+        return InstructionFormat::VLoad;
+    case Layout::VStore:
+        return InstructionFormat::VStore;
+    case Layout::VSetVLI:
+    case Layout::VSetIVLI:
+    case Layout::VSetVL:
+        return InstructionFormat::VConfig;
+    case Layout::CR:
+        return InstructionFormat::CR;
+    case Layout::CI:
+    case Layout::CILui:
+    case Layout::CIAddi16sp:
+    case Layout::CIShift:
+    case Layout::CILwsp:
+    case Layout::CILdsp:
+    case Layout::CILqsp:
+        return InstructionFormat::CI;
+    case Layout::CSSwsp:
+    case Layout::CSSdsp:
+    case Layout::CSSqsp:
+        return InstructionFormat::CSS;
+    case Layout::CIW:
+        return InstructionFormat::CIW;
+    case Layout::CLW:
+    case Layout::CLD:
+    case Layout::CLQ:
+        return InstructionFormat::CL;
+    case Layout::CSW:
+    case Layout::CSD:
+    case Layout::CSQ:
+        return InstructionFormat::CS;
+    case Layout::CA:
+        return InstructionFormat::CA;
+    case Layout::CBShift:
+    case Layout::CBImm:
+    case Layout::CBBranch:
+        return InstructionFormat::CB;
+    case Layout::CJ:
+        return InstructionFormat::CJ;
+    case Layout::CLB:
+        return InstructionFormat::CLB;
+    case Layout::CLH:
+        return InstructionFormat::CLH;
+    case Layout::CSB:
+        return InstructionFormat::CSB;
+    case Layout::CSH:
+        return InstructionFormat::CSH;
+    case Layout::CU:
+        return InstructionFormat::CU;
+    case Layout::CMPP:
+        return InstructionFormat::CMPP;
+    case Layout::CMMV:
+        return InstructionFormat::CMMV;
+    case Layout::CMJT:
+        return InstructionFormat::CMJT;
+    }
+    return InstructionFormat::Unknown;
+}
+
+void DecodeOperands(DecodedInstruction& insn, const Entry& entry) {
+    const auto e = insn.encoding;
+
+    switch (entry.layout) {
+    case Layout::R:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.imm = UnmaskedBits(e, entry.mask, 0xFE000000);
+        break;
+    case Layout::R4:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.rs3 = Bits(e, 31, 27);
+        break;
+    case Layout::I:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        if ((entry.mask & 0xFFF00000) == 0) {
+            insn.imm = SignExtend(Bits(e, 31, 20), 12);
+        } else {
+            insn.imm = UnmaskedBits(e, entry.mask, 0xFFF00000);
+        }
+        break;
+    case Layout::CSR:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.imm = Bits(e, 31, 20);
+        break;
+    case Layout::Prefetch:
+        insn.rs1 = Bits(e, 19, 15);
+        insn.imm = SignExtend(Bits(e, 31, 25) << 5, 12);
+        break;
+    case Layout::S:
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.imm = SignExtend((Bits(e, 31, 25) << 5) | Bits(e, 11, 7), 12);
+        break;
+    case Layout::B:
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.imm = SignExtend((Bits(e, 31, 31) << 12) | (Bits(e, 7, 7) << 11) |
+                              (Bits(e, 30, 25) << 5) | (Bits(e, 11, 8) << 1), 13);
+        break;
+    case Layout::U:
+        insn.rd = Bits(e, 11, 7);
+        insn.imm = SignExtend(e & 0xFFFFF000, 32);
+        break;
+    case Layout::J:
+        insn.rd = Bits(e, 11, 7);
+        insn.imm = SignExtend((Bits(e, 31, 31) << 20) | (Bits(e, 19, 12) << 12) |
+                              (Bits(e, 20, 20) << 11) | (Bits(e, 30, 21) << 1), 21);
+        break;
+    case Layout::VArith:
+    case Layout::VSetVL:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        break;
+    case Layout::VArithSImm:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.imm = SignExtend(Bits(e, 19, 15), 5);
+        break;
+    case Layout::VArithUImm:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.imm = Bits(e, 19, 15);
+        break;
+    case Layout::VArithUImm6:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.imm = (Bits(e, 26, 26) << 5) | Bits(e, 19, 15);
+        break;
+    case Layout::VLoad:
+    case Layout::VStore:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.rs2 = Bits(e, 24, 20);
+        insn.imm = Bits(e, 31, 29);
+        break;
+    case Layout::VSetVLI:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.imm = Bits(e, 30, 20);
+        break;
+    case Layout::VSetIVLI:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = Bits(e, 19, 15);
+        insn.imm = Bits(e, 29, 20);
+        break;
+
+    case Layout::CR:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = insn.rd;
+        insn.rs2 = Bits(e, 6, 2);
+        break;
+    case Layout::CI:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = insn.rd;
+        insn.imm = SignExtend((Bits(e, 12, 12) << 5) | Bits(e, 6, 2), 6);
+        break;
+    case Layout::CILui:
+        insn.rd = Bits(e, 11, 7);
+        insn.imm = SignExtend((Bits(e, 12, 12) << 17) | (Bits(e, 6, 2) << 12), 18);
+        break;
+    case Layout::CIAddi16sp:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = insn.rd;
+        insn.imm = SignExtend((Bits(e, 12, 12) << 9) | (Bits(e, 6, 6) << 4) | (Bits(e, 5, 5) << 6) |
+                              (Bits(e, 4, 3) << 7) | (Bits(e, 2, 2) << 5), 10);
+        break;
+    case Layout::CIShift:
+        insn.rd = Bits(e, 11, 7);
+        insn.rs1 = insn.rd;
+        insn.imm = (Bits(e, 12, 12) << 5) | Bits(e, 6, 2);
+        break;
+    case Layout::CILwsp:
+        insn.rd = Bits(e, 11, 7);
+        insn.imm = (Bits(e, 12, 12) << 5) | (Bits(e, 6, 4) << 2) | (Bits(e, 3, 2) << 6);
+        break;
+    case Layout::CILdsp:
+        insn.rd = Bits(e, 11, 7);
+        insn.imm = (Bits(e, 12, 12) << 5) | (Bits(e, 6, 5) << 3) | (Bits(e, 4, 2) << 6);
+        break;
+    case Layout::CILqsp:
+        insn.rd = Bits(e, 11, 7);
+        insn.imm = (Bits(e, 12, 12) << 5) | (Bits(e, 6, 6) << 4) | (Bits(e, 5, 2) << 6);
+        break;
+    case Layout::CSSwsp:
+        insn.rs2 = Bits(e, 6, 2);
+        insn.imm = (Bits(e, 12, 9) << 2) | (Bits(e, 8, 7) << 6);
+        break;
+    case Layout::CSSdsp:
+        insn.rs2 = Bits(e, 6, 2);
+        insn.imm = (Bits(e, 12, 10) << 3) | (Bits(e, 9, 7) << 6);
+        break;
+    case Layout::CSSqsp:
+        insn.rs2 = Bits(e, 6, 2);
+        insn.imm = (Bits(e, 12, 11) << 4) | (Bits(e, 10, 7) << 6);
+        break;
+    case Layout::CIW:
+        insn.rd = CompressedReg(e, 2);
+        insn.imm = (Bits(e, 12, 11) << 4) | (Bits(e, 10, 7) << 6) | (Bits(e, 6, 6) << 2) | (Bits(e, 5, 5) << 3);
+        break;
+    case Layout::CLW:
+    case Layout::CSW:
+        insn.rs1 = CompressedReg(e, 7);
+        insn.imm = (Bits(e, 12, 10) << 3) | (Bits(e, 6, 6) << 2) | (Bits(e, 5, 5) << 6);
+        break;
+    case Layout::CLD:
+    case Layout::CSD:
+        insn.rs1 = CompressedReg(e, 7);
+        insn.imm = (Bits(e, 12, 10) << 3) | (Bits(e, 6, 5) << 6);
+        break;
+    case Layout::CLQ:
+    case Layout::CSQ:
+        insn.rs1 = CompressedReg(e, 7);
+        insn.imm = (Bits(e, 12, 11) << 4) | (Bits(e, 10, 10) << 8) | (Bits(e, 6, 5) << 6);
+        break;
+    case Layout::CA:
+        insn.rd = CompressedReg(e, 7);
+        insn.rs1 = insn.rd;
+        insn.rs2 = CompressedReg(e, 2);
+        break;
+    case Layout::CBShift:
+        insn.rd = CompressedReg(e, 7);
+        insn.rs1 = insn.rd;
+        insn.imm = (Bits(e, 12, 12) << 5) | Bits(e, 6, 2);
+        break;
+    case Layout::CBImm:
+        insn.rd = CompressedReg(e, 7);
+        insn.rs1 = insn.rd;
+        insn.imm = SignExtend((Bits(e, 12, 12) << 5) | Bits(e, 6, 2), 6);
+        break;
+    case Layout::CBBranch:
+        insn.rs1 = CompressedReg(e, 7);
+        insn.imm = SignExtend((Bits(e, 12, 12) << 8) | (Bits(e, 11, 10) << 3) | (Bits(e, 6, 5) << 6) |
+                              (Bits(e, 4, 3) << 1) | (Bits(e, 2, 2) << 5), 9);
+        break;
+    case Layout::CJ:
+        insn.imm = SignExtend((Bits(e, 12, 12) << 11) | (Bits(e, 11, 11) << 4) | (Bits(e, 10, 9) << 8) |
+                              (Bits(e, 8, 8) << 10) | (Bits(e, 7, 7) << 6) | (Bits(e, 6, 6) << 7) |
+                              (Bits(e, 5, 3) << 1) | (Bits(e, 2, 2) << 5), 12);
+        break;
+    case Layout::CLB:
+    case Layout::CSB:
+        insn.rs1 = CompressedReg(e, 7);
+        insn.imm = Bits(e, 6, 6) | (Bits(e, 5, 5) << 1);
+        break;
+    case Layout::CLH:
+    case Layout::CSH:
+        insn.rs1 = CompressedReg(e, 7);
+        insn.imm = Bits(e, 5, 5) << 1;
+        break;
+    case Layout::CU:
+        insn.rd = CompressedReg(e, 7);
+        insn.rs1 = insn.rd;
+        break;
+    case Layout::CMPP:
+        insn.rd = Bits(e, 7, 4);
+        insn.imm = Bits(e, 3, 2);
+        break;
+    case Layout::CMMV:
+        insn.rs1 = CompressedSReg(e, 7);
+        insn.rs2 = CompressedSReg(e, 2);
+        break;
+    case Layout::CMJT:
+        insn.imm = Bits(e, 9, 2);
+        break;
+    }
+
+    // The other register of compressed loads and stores lives in the same place.
+    switch (entry.layout) {
+    case Layout::CLW:
+    case Layout::CLD:
+    case Layout::CLQ:
+    case Layout::CLB:
+    case Layout::CLH:
+        insn.rd = CompressedReg(e, 2);
+        break;
+    case Layout::CSW:
+    case Layout::CSD:
+    case Layout::CSQ:
+    case Layout::CSB:
+    case Layout::CSH:
+        insn.rs2 = CompressedReg(e, 2);
+        break;
+    default:
+        break;
+    }
+}
+
+constexpr uint8_t GetXLENVariant(ArchFeature features) {
+    switch (features) {
+    case ArchFeature::RV32:
+        return variant_rv32;
+    case ArchFeature::RV64:
+        return variant_rv64;
+    case ArchFeature::RV128:
+        return variant_rv128;
+    }
+    return variant_rv64;
+}
+
+} // Anonymous namespace
+
+std::optional<DecodedInstruction> Decoder::Decode(uint32_t encoding) const noexcept {
+    if (IsCompressed(encoding)) {
+        encoding &= 0xFFFF;
+
+        // All zeroes is defined to be an illegal instruction.
+        if (encoding == 0) {
+            return std::nullopt;
+        }
+    }
+
+    const bool has_zcmp = m_extensions.Has(Extension::Zcmp);
+    const bool has_zcmt = m_extensions.Has(Extension::Zcmt);
+    const auto xlen = GetXLENVariant(m_features);
+
+    for (const Entry* entry : GetBuckets()[GetBucket(encoding)]) {
+        if ((encoding & entry->mask) != entry->match) {
+            continue;
+        }
+        if ((entry->variants & xlen) == 0) {
+            continue;
+        }
+        if (((entry->variants & variant_zcmp) != 0 && !has_zcmp) ||
+            ((entry->variants & variant_zcmt) != 0 && !has_zcmt) ||
+            ((entry->variants & variant_not_zcm) != 0 && (has_zcmp || has_zcmt))) {
+            continue;
+        }
+
+        DecodedInstruction insn{
+            .mnemonic = entry->mnemonic,
+            .format = GetLayoutFormat(entry->layout),
+            .encoding = encoding,
+            .length = IsCompressed(encoding) ? 2U : 4U,
+        };
+        DecodeOperands(insn, *entry);
+        return insn;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<DecodedInstruction> Decoder::Decode(std::span<const uint8_t> code) const noexcept {
+    if (code.size() < 2) {
+        return std::nullopt;
+    }
+
+    uint16_t parcel = 0;
+    std::memcpy(&parcel, code.data(), sizeof(parcel));
+
+    const auto length = GetInstructionLength(parcel);
+    if (length == 2) {
+        return Decode(uint32_t{parcel});
+    }
+    if (length != 4 || code.size() < 4) {
+        return std::nullopt;
+    }
+
+    uint32_t encoding = 0;
+    std::memcpy(&encoding, code.data(), sizeof(encoding));
+    return Decode(encoding);
+}
+
+InstructionFormat Decoder::GetFormat(uint32_t encoding) const noexcept {
+    const auto funct3 = Bits(encoding, 14, 12);
+
+    if (IsCompressed(encoding)) {
+        const auto c_funct3 = Bits(encoding, 15, 13);
+        const bool is_rv32 = m_features == ArchFeature::RV32;
+
+        switch ((c_funct3 << 2) | (encoding & 0b11)) {
+        // Quadrant 0
+        case 0b00000:
+            return InstructionFormat::CIW;
+        case 0b00100:
+        case 0b01000:
+        case 0b01100:
+            return InstructionFormat::CL;
+        case 0b10000:
+            switch (Bits(encoding, 12, 10)) {
+            case 0b000:
+                return InstructionFormat::CLB;
+            case 0b001:
+                return InstructionFormat::CLH;
+            case 0b010:
+                return InstructionFormat::CSB;
+            case 0b011:
+                return InstructionFormat::CSH;
+            default:
+                return InstructionFormat::Unknown;
+            }
+        case 0b10100:
+        case 0b11000:
+        case 0b11100:
+            return InstructionFormat::CS;
+
+        // Quadrant 1
+        case 0b00101:
+            return is_rv32 ? InstructionFormat::CJ : InstructionFormat::CI;
+        case 0b00001:
+        case 0b01001:
+        case 0b01101:
+            return InstructionFormat::CI;
+        case 0b10001:
+            if (Bits(encoding, 11, 10) != 0b11) {
+                return InstructionFormat::CB;
+            }
+            if (Bits(encoding, 12, 12) != 0 && Bits(encoding, 6, 5) == 0b11) {
+                return InstructionFormat::CU;
+            }
+            return InstructionFormat::CA;
+        case 0b10101:
+            return InstructionFormat::CJ;
+        case 0b11001:
+        case 0b11101:
+            return InstructionFormat::CB;
+
+        // Quadrant 2
+        case 0b00010:
+        case 0b00110:
+        case 0b01010:
+        case 0b01110:
+            return InstructionFormat::CI;
+        case 0b10010:
+            return InstructionFormat::CR;
+        case 0b10110:
+            if (m_extensions.Has(Extension::Zcmt) && Bits(encoding, 12, 10) == 0b000) {
+                return InstructionFormat::CMJT;
+            }
+            if (m_extensions.Has(Extension::Zcmp) && Bits(encoding, 12, 10) == 0b011) {
+                return InstructionFormat::CMMV;
+            }
+            if (m_extensions.Has(Extension::Zcmp) && Bits(encoding, 12, 11) == 0b11) {
+                return InstructionFormat::CMPP;
+            }
+            return InstructionFormat::CSS;
+        case 0b11010:
+        case 0b11110:
+            return InstructionFormat::CSS;
+        default:
+            return InstructionFormat::Unknown;
+        }
+    }
+
+    switch (encoding & 0x7F) {
+    case LOAD:
+    case MISC_MEM:
+    case OP_IMM:
+    case OP_IMM_32:
+    case JALR:
+        return InstructionFormat::I;
+    case LOAD_FP:
+        return funct3 == 0b000 || funct3 >= 0b101 ? InstructionFormat::VLoad : InstructionFormat::I;
+    case STORE:
+        return InstructionFormat::S;
+    case STORE_FP:
+        return funct3 == 0b000 || funct3 >= 0b101 ? InstructionFormat::VStore : InstructionFormat::S;
+    case AMO:
+    case OP:
+    case OP_32:
+    case OP_FP:
+        return InstructionFormat::R;
+    case MADD:
+    case MSUB:
+    case NMSUB:
+    case NMADD:
+        return InstructionFormat::R4;
+    case LUI:
+    case AUIPC:
+        return InstructionFormat::U;
+    case JAL:
+        return InstructionFormat::J;
+    case BRANCH:
+        return InstructionFormat::B;
+    case OP_V:
+        return funct3 == OPCFG ? InstructionFormat::VConfig : InstructionFormat::VArith;
+    case OP_VE:
+        return InstructionFormat::VArith;
+    case SYSTEM:
+        // Hypervisor loads and stores, along with the fences (which all have an odd
+        // funct7), are R-type. Everything else is I-type.
+        if (funct3 == 0b100 || (funct3 == 0b000 && Bits(encoding, 25, 25) != 0)) {
+            return InstructionFormat::R;
+        }
+        return InstructionFormat::I;
+    default:
+        return InstructionFormat::Unknown;
+    }
+}
+
+} // namespace biscuit
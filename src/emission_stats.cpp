@@ -0,0 +1,127 @@
+#include <biscuit/emission_stats.hpp>
+
+#include <algorithm>
+
+namespace biscuit {
+namespace {
+// Classifies instructions using the OP-IMM and OP-IMM-32 opcodes.
+InstructionClass ClassifyImmediateOp(uint32_t encoding) {
+    const auto funct3 = (encoding >> 12) & 0b111;
+    if (funct3 != 0b001 && funct3 != 0b101) {
+        return InstructionClass::Base;
+    }
+
+    // Only the plain shifts exist in the base ISA. Everything else in
+    // their encoding space is either bit-manipulation or scalar crypto.
+    const auto funct6 = encoding >> 26;
+    if (funct6 == 0 || (funct3 == 0b101 && funct6 == 0b010000)) {
+        return InstructionClass::Base;
+    }
+    return InstructionClass::BitManip;
+}
+
+// Classifies instructions using the OP and OP-32 opcodes.
+InstructionClass ClassifyRegisterOp(uint32_t encoding) {
+    const auto funct3 = (encoding >> 12) & 0b111;
+    const auto funct7 = encoding >> 25;
+
+    if (funct7 == 0b0000001) {
+        return InstructionClass::Multiply;
+    }
+    if (funct7 == 0 || (funct7 == 0b0100000 && (funct3 == 0b000 || funct3 == 0b101))) {
+        return InstructionClass::Base;
+    }
+    return InstructionClass::BitManip;
+}
+} // Anonymous namespace
+
+InstructionClass ClassifyInstruction(uint32_t encoding) noexcept {
+    if ((encoding & 0b11) != 0b11) {
+        return InstructionClass::Compressed;
+    }
+
+    switch (encoding & 0x7F) {
+    case 0b0000011: // LOAD
+    case 0b0001111: // MISC-MEM
+    case 0b0010111: // AUIPC
+    case 0b0100011: // STORE
+    case 0b0110111: // LUI
+    case 0b1100011: // BRANCH
+    case 0b1100111: // JALR
+    case 0b1101111: // JAL
+        return InstructionClass::Base;
+    case 0b0010011: // OP-IMM
+    case 0b0011011: // OP-IMM-32
+        return ClassifyImmediateOp(encoding);
+    case 0b0110011: // OP
+    case 0b0111011: // OP-32
+        return ClassifyRegisterOp(encoding);
+    case 0b0101111: // AMO
+        return InstructionClass::Atomic;
+    case 0b0000111:   // LOAD-FP
+    case 0b0100111: { // STORE-FP
+        // Vector loads and stores share the opcodes, and are told apart by their width.
+        const auto width = (encoding >> 12) & 0b111;
+        const bool is_scalar = width >= 0b001 && width <= 0b100;
+        return is_scalar ? InstructionClass::FloatingPoint : InstructionClass::Vector;
+    }
+    case 0b1000011: // MADD
+    case 0b1000111: // MSUB
+    case 0b1001011: // NMSUB
+    case 0b1001111: // NMADD
+    case 0b1010011: // OP-FP
+        return InstructionClass::FloatingPoint;
+    case 0b1010111: // OP-V
+        return InstructionClass::Vector;
+    case 0b1110111: // OP-VE
+        return InstructionClass::VectorCrypto;
+    case 0b1110011: { // SYSTEM
+        const auto funct3 = (encoding >> 12) & 0b111;
+        if (funct3 == 0b000 || funct3 == 0b100) {
+            return InstructionClass::Base;
+        }
+        return InstructionClass::CSR;
+    }
+    default:
+        return InstructionClass::Unknown;
+    }
+}
+
+void EmissionStats::RecordInstruction(uint32_t encoding, size_t length) noexcept {
+    const auto format = m_decoder.GetFormat(encoding);
+    m_totals.formats[static_cast<size_t>(format)]++;
+    m_totals.classes[static_cast<size_t>(ClassifyInstruction(encoding))]++;
+
+    if (length == 2) {
+        m_totals.compressed++;
+    } else {
+        m_totals.uncompressed++;
+    }
+    m_totals.bytes += length;
+}
+
+void EmissionStats::RecordLabel(ptrdiff_t offset, size_t fixups) {
+    m_totals.labels_bound++;
+    m_totals.label_fixups += fixups;
+    m_label_offsets.push_back(offset);
+}
+
+std::vector<CodeRange> EmissionStats::GetLabelRegions(ptrdiff_t end) const {
+    // Labels can be bound to locations behind the cursor, so they aren't necessarily in order.
+    auto boundaries = m_label_offsets;
+    boundaries.push_back(0);
+    boundaries.push_back(end);
+    std::sort(boundaries.begin(), boundaries.end());
+
+    std::vector<CodeRange> regions;
+    for (size_t i = 0; i + 1 < boundaries.size(); i++) {
+        const auto begin = boundaries[i];
+        const auto next = std::min(boundaries[i + 1], end);
+        if (next > begin) {
+            regions.push_back({begin, static_cast<size_t>(next - begin)});
+        }
+    }
+    return regions;
+}
+
+} // namespace biscuit
@@ -0,0 +1,260 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/frame.hpp>
+
+#include <algorithm>
+#include <bit>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+namespace {
+// Registers that can be saved by a frame, in the order they're laid out in
+// from the bottom of the register save area upwards.
+constexpr std::array<GPR, 13> saveable_regs{
+    ra, s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10, s11,
+};
+
+// Number of bytes in a slot of the register save area.
+uint32_t GetSlotSize(ArchFeature features) {
+    BISCUIT_ASSERT(IsRV32OrRV64(features));
+    return IsRV32(features) ? 4 : 8;
+}
+
+constexpr uint32_t AlignStack(uint32_t size) {
+    return (size + 15) & ~15U;
+}
+
+// Builds a bitmask of ra along with the first `count` s-registers.
+constexpr uint32_t GetSRegisterMask(uint32_t count) {
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i <= count; i++) {
+        mask |= 1U << saveable_regs[i].Index();
+    }
+    return mask;
+}
+
+PushPopList GetPushPopList(uint32_t s_count) {
+    if (s_count == 0) {
+        return {ra};
+    }
+    return {ra, {s0, saveable_regs[s_count]}};
+}
+
+// Stores a register to a stack slot, preferring the compressed form.
+void EmitSave(Assembler& as, GPR reg, uint32_t offset) {
+    const bool compress = as.GetExtensions().Has(Extension::C);
+    if (IsRV32(as.GetArchFeatures())) {
+        if (compress && offset <= 252) {
+            as.C_SWSP(reg, offset);
+        } else {
+            as.SW(reg, static_cast<int32_t>(offset), sp);
+        }
+    } else {
+        if (compress && offset <= 504) {
+            as.C_SDSP(reg, offset);
+        } else {
+            as.SD(reg, static_cast<int32_t>(offset), sp);
+        }
+    }
+}
+
+// Loads a register from a stack slot, preferring the compressed form.
+void EmitRestore(Assembler& as, GPR reg, uint32_t offset) {
+    const bool compress = as.GetExtensions().Has(Extension::C);
+    if (IsRV32(as.GetArchFeatures())) {
+        if (compress && offset <= 252) {
+            as.C_LWSP(reg, offset);
+        } else {
+            as.LW(reg, static_cast<int32_t>(offset), sp);
+        }
+    } else {
+        if (compress && offset <= 504) {
+            as.C_LDSP(reg, offset);
+        } else {
+            as.LD(reg, static_cast<int32_t>(offset), sp);
+        }
+    }
+}
+
+// Saves or restores every register in a mask, relative to the top of the save area.
+template <typename Func>
+void ForEachSlot(uint32_t mask, uint32_t top, uint32_t slot_size, Func&& func) {
+    for (auto iter = saveable_regs.rbegin(); iter != saveable_regs.rend(); ++iter) {
+        if ((mask & (1U << iter->Index())) == 0) {
+            continue;
+        }
+        top -= slot_size;
+        func(*iter, top);
+    }
+}
+
+void EmitStackAdjustment(Assembler& as, int32_t amount) {
+    if (amount == 0) {
+        return;
+    }
+
+    if (as.GetExtensions().Has(Extension::C) && amount >= -512 && amount <= 496) {
+        as.C_ADDI16SP(amount);
+    } else if (IsValidSigned12BitImm(amount)) {
+        as.ADDI(sp, sp, amount);
+    } else {
+        // t0 is free to clobber in both the prologue and epilogue.
+        as.LI(t0, static_cast<uint64_t>(static_cast<int64_t>(amount)));
+        as.ADD(sp, sp, t0);
+    }
+}
+} // Anonymous namespace
+
+void FrameStubs::Emit(Assembler& as) {
+    const auto slot_size = GetSlotSize(as.GetArchFeatures());
+
+    for (uint32_t count = 0; count < max_stubs; count++) {
+        const auto bit = 1U << count;
+        if ((m_referenced & bit) == 0 || (m_emitted & bit) != 0) {
+            continue;
+        }
+
+        const auto mask = GetSRegisterMask(count);
+        const auto size = AlignStack((count + 1) * slot_size);
+
+        as.Bind(&m_save[count]);
+        EmitStackAdjustment(as, -static_cast<int32_t>(size));
+        ForEachSlot(mask, size, slot_size, [&](GPR reg, uint32_t offset) {
+            EmitSave(as, reg, offset);
+        });
+        as.JR(t0);
+
+        as.Bind(&m_restore[count]);
+        ForEachSlot(mask, size, slot_size, [&](GPR reg, uint32_t offset) {
+            EmitRestore(as, reg, offset);
+        });
+        EmitStackAdjustment(as, static_cast<int32_t>(size));
+        as.RET();
+
+        m_emitted |= bit;
+    }
+}
+
+FrameBuilder::FrameBuilder(Assembler& as, std::span<const GPR> saved, uint32_t locals_size,
+                           FrameStrategy strategy, FrameStubs* stubs)
+    : m_assembler{as}, m_stubs{stubs}, m_strategy{strategy} {
+    const auto slot_size = GetSlotSize(as.GetArchFeatures());
+
+    if (m_strategy == FrameStrategy::Auto) {
+        if (as.GetExtensions().Has(Extension::Zcmp)) {
+            m_strategy = FrameStrategy::Push;
+        } else if (stubs != nullptr) {
+            m_strategy = FrameStrategy::Stubs;
+        } else {
+            m_strategy = FrameStrategy::Inline;
+        }
+    }
+    BISCUIT_ASSERT(m_strategy != FrameStrategy::Stubs || stubs != nullptr);
+
+    for (const GPR reg : saved) {
+        const auto iter = std::find(saveable_regs.begin(), saveable_regs.end(), reg);
+        BISCUIT_ASSERT(iter != saveable_regs.end());
+
+        m_saved |= 1U << reg.Index();
+        m_s_count = std::max(m_s_count, static_cast<uint32_t>(iter - saveable_regs.begin()));
+    }
+
+    if (m_strategy == FrameStrategy::Inline) {
+        const auto count = static_cast<uint32_t>(std::popcount(m_saved));
+        m_save_size = AlignStack(count * slot_size);
+    } else {
+        // s10 can only be pushed along with s11.
+        if (m_strategy == FrameStrategy::Push && m_s_count == 11) {
+            m_s_count = 12;
+        }
+        m_saved = GetSRegisterMask(m_s_count);
+        m_save_size = AlignStack((m_s_count + 1) * slot_size);
+    }
+
+    m_frame_size = AlignStack(m_save_size + locals_size);
+}
+
+std::optional<int32_t> FrameBuilder::GetSaveSlot(GPR reg) const noexcept {
+    std::optional<int32_t> slot;
+    ForEachSlot(m_saved, m_frame_size, GetSlotSize(m_assembler.GetArchFeatures()),
+                [&](GPR saved_reg, uint32_t offset) {
+        if (saved_reg == reg) {
+            slot = static_cast<int32_t>(offset);
+        }
+    });
+    return slot;
+}
+
+void FrameBuilder::EmitPrologue() {
+    const auto slot_size = GetSlotSize(m_assembler.GetArchFeatures());
+    const auto rest = m_frame_size - m_save_size;
+
+    switch (m_strategy) {
+    case FrameStrategy::Push: {
+        // Up to 48 bytes beyond the register save area can be allocated by CM.PUSH itself.
+        const auto extra = std::min(rest, 48U);
+        m_assembler.CM_PUSH(GetPushPopList(m_s_count), -static_cast<int32_t>(m_save_size + extra));
+        EmitStackAdjustment(m_assembler, -static_cast<int32_t>(rest - extra));
+        break;
+    }
+    case FrameStrategy::Stubs:
+        m_stubs->m_referenced |= 1U << m_s_count;
+        m_assembler.JAL(t0, &m_stubs->m_save[m_s_count]);
+        EmitStackAdjustment(m_assembler, -static_cast<int32_t>(rest));
+        break;
+    case FrameStrategy::Inline:
+    case FrameStrategy::Auto:
+        // Small frames are allocated all at once, so that slots are addressed relative
+        // to the final sp. Otherwise, the save area is allocated on its own first, to
+        // keep the slots within reach of a 12-bit offset.
+        if (IsValidSigned12BitImm(m_frame_size)) {
+            EmitStackAdjustment(m_assembler, -static_cast<int32_t>(m_frame_size));
+            ForEachSlot(m_saved, m_frame_size, slot_size, [&](GPR reg, uint32_t offset) {
+                EmitSave(m_assembler, reg, offset);
+            });
+        } else {
+            EmitStackAdjustment(m_assembler, -static_cast<int32_t>(m_save_size));
+            ForEachSlot(m_saved, m_save_size, slot_size, [&](GPR reg, uint32_t offset) {
+                EmitSave(m_assembler, reg, offset);
+            });
+            EmitStackAdjustment(m_assembler, -static_cast<int32_t>(rest));
+        }
+        break;
+    }
+}
+
+void FrameBuilder::EmitEpilogue() {
+    const auto slot_size = GetSlotSize(m_assembler.GetArchFeatures());
+    const auto rest = m_frame_size - m_save_size;
+
+    switch (m_strategy) {
+    case FrameStrategy::Push: {
+        const auto extra = std::min(rest, 48U);
+        EmitStackAdjustment(m_assembler, static_cast<int32_t>(rest - extra));
+        m_assembler.CM_POPRET(GetPushPopList(m_s_count), static_cast<int32_t>(m_save_size + extra));
+        break;
+    }
+    case FrameStrategy::Stubs:
+        EmitStackAdjustment(m_assembler, static_cast<int32_t>(rest));
+        m_assembler.J(&m_stubs->m_restore[m_s_count]);
+        break;
+    case FrameStrategy::Inline:
+    case FrameStrategy::Auto:
+        if (IsValidSigned12BitImm(m_frame_size)) {
+            ForEachSlot(m_saved, m_frame_size, slot_size, [&](GPR reg, uint32_t offset) {
+                EmitRestore(m_assembler, reg, offset);
+            });
+            EmitStackAdjustment(m_assembler, static_cast<int32_t>(m_frame_size));
+        } else {
+            EmitStackAdjustment(m_assembler, static_cast<int32_t>(rest));
+            ForEachSlot(m_saved, m_save_size, slot_size, [&](GPR reg, uint32_t offset) {
+                EmitRestore(m_assembler, reg, offset);
+            });
+            EmitStackAdjustment(m_assembler, static_cast<int32_t>(m_save_size));
+        }
+        m_assembler.RET();
+        break;
+    }
+}
+
+} // namespace biscuit
@@ -0,0 +1,89 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/csr.hpp>
+#include <biscuit/jump_vector_table.hpp>
+
+#include <algorithm>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+
+JumpVectorTable::JumpVectorTable(uint32_t entry_count)
+    : m_entries(entry_count), m_used(entry_count) {
+    BISCUIT_ASSERT(entry_count > 0 && entry_count <= max_entry_count);
+}
+
+std::optional<uint32_t> JumpVectorTable::AddJump(Label* target) {
+    BISCUIT_ASSERT(target != nullptr);
+    return AddEntry({.label = target}, 0, std::min(jump_entry_count, GetEntryCount()));
+}
+
+std::optional<uint32_t> JumpVectorTable::AddJump(uintptr_t target) {
+    return AddEntry({.address = target}, 0, std::min(jump_entry_count, GetEntryCount()));
+}
+
+std::optional<uint32_t> JumpVectorTable::AddCall(Label* target) {
+    BISCUIT_ASSERT(target != nullptr);
+    return AddEntry({.label = target}, jump_entry_count, GetEntryCount());
+}
+
+std::optional<uint32_t> JumpVectorTable::AddCall(uintptr_t target) {
+    return AddEntry({.address = target}, jump_entry_count, GetEntryCount());
+}
+
+std::optional<uint32_t> JumpVectorTable::AddEntry(const Entry& entry, uint32_t first, uint32_t last) {
+    BISCUIT_ASSERT(!m_label.IsBound());
+
+    std::optional<uint32_t> free_index;
+    for (uint32_t i = first; i < last; i++) {
+        if (!m_used[i]) {
+            if (!free_index) {
+                free_index = i;
+            }
+            continue;
+        }
+        if (m_entries[i].label == entry.label && m_entries[i].address == entry.address) {
+            return i;
+        }
+    }
+
+    if (free_index) {
+        m_entries[*free_index] = entry;
+        m_used[*free_index] = true;
+    }
+    return free_index;
+}
+
+void JumpVectorTable::EmitSetup(Assembler& as, GPR scratch) {
+    BISCUIT_ASSERT(scratch != x0);
+
+    // The table's alignment keeps jvt's mode bits clear, which selects jump table mode.
+    as.LA(scratch, &m_label);
+    as.CSWR(CSR::JVT, scratch);
+}
+
+void JumpVectorTable::Emit(Assembler& as) {
+    const bool is_rv32 = IsRV32(as.GetArchFeatures());
+    auto& buffer = as.GetCodeBuffer();
+
+    as.Align(table_alignment, AlignFill::Zero);
+    as.Bind(&m_label);
+
+    for (const auto& entry : m_entries) {
+        if (entry.label != nullptr) {
+            if (is_rv32) {
+                as.EmitAddress32(entry.label);
+            } else {
+                as.EmitAddress(entry.label);
+            }
+        } else if (is_rv32) {
+            buffer.Emit32(static_cast<uint32_t>(entry.address));
+            as.SkipSchedule();
+        } else {
+            buffer.Emit(uint64_t{entry.address});
+            as.SkipSchedule();
+        }
+    }
+}
+
+} // namespace biscuit
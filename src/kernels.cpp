@@ -0,0 +1,212 @@
+#include <biscuit/csr.hpp>
+#include <biscuit/kernels.hpp>
+#include <biscuit/label.hpp>
+#include <biscuit/vector_loop.hpp>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+namespace {
+// Reflected CRC-32 polynomial.
+constexpr uint64_t crc32_poly = 0xEDB88320;
+
+// floor(x^96 / P) for the reflected polynomial, i.e. the Barrett reduction quotient.
+constexpr uint64_t crc32_poly_quotient = 0x5A72D812FB808B20;
+
+LMUL ChooseKernelLMUL(const KernelOptions& options, uint32_t live_groups) {
+    return ChooseLoopLMUL(options.vlenb, SEW::E8, live_groups, options.typical_size);
+}
+
+// Folds the byte at a1 into the checksum in a0, one bit at a time.
+void EmitCRC32Byte(Assembler& as) {
+    as.LBU(t0, 0, a1);
+    as.XOR(a0, a0, t0);
+    as.LI(t1, 8);
+
+    auto bit = Label::Local();
+    as.Bind(&bit);
+    as.ANDI(t2, a0, 1);
+    as.NEG(t2, t2);
+    as.AND(t2, t2, t3);
+    as.SRLI(a0, a0, 1);
+    as.XOR(a0, a0, t2);
+    as.ADDI(t1, t1, -1);
+    as.BNEZ(t1, &bit);
+
+    as.ADDI(a1, a1, 1);
+    as.ADDI(a2, a2, -1);
+}
+} // Anonymous namespace
+
+ptrdiff_t EmitMemcpyKernel(Assembler& as, const KernelOptions& options) {
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+
+    // a0 is the return value, so the destination is walked with a3.
+    as.MV(a3, a0);
+
+    VectorLoopBuilder loop{as, SEW::E8, ChooseKernelLMUL(options, 1)};
+    loop.AddPointer(a3);
+    loop.AddPointer(a1);
+    loop.Emit(a2, t0, x0, [](Assembler& body, GPR) {
+        body.VLE8(v8, a1);
+        body.VSE8(v8, a3);
+    });
+    as.RET();
+
+    return offset;
+}
+
+ptrdiff_t EmitMemsetKernel(Assembler& as, const KernelOptions& options) {
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+    const auto lmul = ChooseKernelLMUL(options, 1);
+
+    // Splat the value across the whole group once, as stores only ever use a prefix of it.
+    as.MV(a3, a0);
+    as.VSETVLI(t0, x0, SEW::E8, lmul, VTA::Yes, VMA::Yes);
+    as.VMV(v8, a1);
+
+    VectorLoopBuilder loop{as, SEW::E8, lmul};
+    loop.AddPointer(a3);
+    loop.Emit(a2, t0, x0, [](Assembler& body, GPR) {
+        body.VSE8(v8, a3);
+    });
+    as.RET();
+
+    return offset;
+}
+
+ptrdiff_t EmitMemcmpKernel(Assembler& as, const KernelOptions& options) {
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+
+    auto mismatch = Label::Local();
+    VectorLoopBuilder loop{as, SEW::E8, ChooseKernelLMUL(options, 2)};
+    loop.AddPointer(a0);
+    loop.AddPointer(a1);
+    loop.Emit(a2, t0, x0, [&mismatch](Assembler& body, GPR) {
+        body.VLE8(v8, a0);
+        body.VLE8(v16, a1);
+        body.VMSNE(v0, v8, v16);
+        body.VFIRST(t1, v0);
+        body.BGEZ(t1, &mismatch);
+    });
+    as.LI(a0, 0);
+    as.RET();
+
+    // Only the first differing pair of bytes decides the result.
+    as.Bind(&mismatch);
+    as.ADD(a0, a0, t1);
+    as.ADD(a1, a1, t1);
+    as.LBU(t2, 0, a0);
+    as.LBU(t3, 0, a1);
+    as.SUB(a0, t2, t3);
+    as.RET();
+
+    return offset;
+}
+
+ptrdiff_t EmitStrlenKernel(Assembler& as, const KernelOptions& options) {
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+    const auto lmul = ChooseKernelLMUL(options, 1);
+
+    as.MV(a1, a0);
+
+    auto loop = Label::Local();
+    as.Bind(&loop);
+    as.VSETVLI(t0, x0, SEW::E8, lmul, VTA::Yes, VMA::Yes);
+    as.VLE8FF(v8, a1);
+    as.CSRR(t0, CSR::VL);
+    as.VMSEQ(v0, v8, 0);
+    as.VFIRST(t1, v0);
+    as.ADD(a1, a1, t0);
+    as.BLTZ(t1, &loop);
+
+    // a1 is past the last chunk read, and t1 is the terminator's index within it.
+    as.SUB(a0, a1, a0);
+    as.SUB(a0, a0, t0);
+    as.ADD(a0, a0, t1);
+    as.RET();
+
+    return offset;
+}
+
+std::optional<ptrdiff_t> EmitCRC32Kernel(Assembler& as) {
+    if (!as.GetExtensions().Has(Extension::Zvbc) || !IsRV64(as.GetArchFeatures())) {
+        return std::nullopt;
+    }
+
+    const auto offset = as.GetCodeBuffer().GetCursorOffset();
+
+    // Invert the incoming checksum, keeping it zero-extended (it's passed sign-extended).
+    as.NOT(a0, a0);
+    as.SLLI(a0, a0, 32);
+    as.SRLI(a0, a0, 32);
+
+    as.LI(t3, crc32_poly);
+    as.LI(t4, crc32_poly_quotient);
+    as.LI(t5, crc32_poly << 32);
+    as.LI(t6, 8);
+    as.VSETIVLI(x0, 1, SEW::E64, LMUL::M1, VTA::Yes, VMA::Yes);
+
+    // Fold in bytes until the data is aligned for 64-bit vector loads.
+    auto head = Label::Local();
+    auto words = Label::Local();
+    auto tail = Label::Local();
+    auto done = Label::Local();
+    as.Bind(&head);
+    as.ANDI(t0, a1, 7);
+    as.BEQZ(t0, &words);
+    as.BEQZ(a2, &done);
+    EmitCRC32Byte(as);
+    as.J(&head);
+
+    // With s = crc ^ data, the next checksum is the high half of
+    // (((s * q) << 1) ^ s) * (P << 32), shifted down into place.
+    as.Bind(&words);
+    as.BLTU(a2, t6, &tail);
+    as.VLE64(v8, a1);
+    as.VXOR(v8, v8, a0);
+    as.VCLMUL(v9, v8, t4);
+    as.VSLL(v9, v9, 1U);
+    as.VXOR(v9, v9, v8);
+    as.VCLMULH(v9, v9, t5);
+    as.VSRL(v9, v9, 31U);
+    as.VMV_XS(a0, v9);
+    as.ADDI(a1, a1, 8);
+    as.ADDI(a2, a2, -8);
+    as.J(&words);
+
+    as.Bind(&tail);
+    as.BEQZ(a2, &done);
+    EmitCRC32Byte(as);
+    as.J(&tail);
+
+    // The result is sign-extended, as the calling convention expects of 32-bit values.
+    as.Bind(&done);
+    as.NOT(a0, a0);
+    as.ADDIW(a0, a0, 0);
+    as.RET();
+
+    return offset;
+}
+
+RuntimeKernels EmitRuntimeKernels(Assembler& as, const KernelOptions& options) {
+    const auto memcpy_offset = EmitMemcpyKernel(as, options);
+    const auto memset_offset = EmitMemsetKernel(as, options);
+    const auto memcmp_offset = EmitMemcmpKernel(as, options);
+    const auto strlen_offset = EmitStrlenKernel(as, options);
+    const auto crc32_offset = EmitCRC32Kernel(as);
+
+    const auto& buffer = as.GetCodeBuffer();
+    RuntimeKernels kernels{
+        .memcpy = GetKernel<MemcpyKernel>(buffer, memcpy_offset),
+        .memset = GetKernel<MemsetKernel>(buffer, memset_offset),
+        .memcmp = GetKernel<MemcmpKernel>(buffer, memcmp_offset),
+        .strlen = GetKernel<StrlenKernel>(buffer, strlen_offset),
+    };
+    if (crc32_offset) {
+        kernels.crc32 = GetKernel<CRC32Kernel>(buffer, *crc32_offset);
+    }
+    return kernels;
+}
+
+} // namespace biscuit
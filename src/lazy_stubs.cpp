@@ -0,0 +1,173 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/encoding.hpp>
+#include <biscuit/lazy_stubs.hpp>
+
+#include <array>
+#include <utility>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+namespace {
+constexpr std::array<GPR, 8> argument_gprs{a0, a1, a2, a3, a4, a5, a6, a7};
+constexpr std::array<FPR, 8> argument_fprs{fa0, fa1, fa2, fa3, fa4, fa5, fa6, fa7};
+} // Anonymous namespace
+
+LazyStubs::LazyStubs(Assembler& as, CompileCallback compile)
+    : m_assembler{as}
+    , m_compile{std::move(compile)} {
+    BISCUIT_ASSERT(m_compile);
+}
+
+void LazyStubs::EmitResolver() {
+    BISCUIT_ASSERT(!m_resolver_offset);
+
+    // Stubs are patched by their offset, which relaxation could move out from under them.
+    BISCUIT_ASSERT(!m_assembler.IsBranchRelaxationEnabled());
+
+    auto& as = m_assembler;
+    const auto is_rv32 = IsRV32(as.GetArchFeatures());
+    const auto xlen = is_rv32 ? 4 : 8;
+    const auto extensions = as.GetExtensions();
+    const auto save_double = extensions.Has(Extension::D);
+    const auto save_single = !save_double && extensions.Has(Extension::F);
+
+    // ra and the argument registers, followed by the floating-point argument registers.
+    const auto fpr_base = xlen * static_cast<int32_t>(1 + argument_gprs.size());
+    const auto fpr_size = save_double || save_single ? 8 * static_cast<int32_t>(argument_fprs.size()) : 0;
+    const auto frame_size = (fpr_base + fpr_size + 15) & ~15;
+
+    const auto save_gpr = [&](GPR reg, int32_t offset) {
+        if (is_rv32) {
+            as.SW(reg, offset, sp);
+        } else {
+            as.SD(reg, offset, sp);
+        }
+    };
+    const auto restore_gpr = [&](GPR reg, int32_t offset) {
+        if (is_rv32) {
+            as.LW(reg, offset, sp);
+        } else {
+            as.LD(reg, offset, sp);
+        }
+    };
+
+    m_resolver_offset = as.GetCodeBuffer().GetCursorOffset();
+
+    // Stubs enter with t0 pointing at their ID, just past their AUIPC+JALR pair.
+    as.ADDI(sp, sp, -frame_size);
+    save_gpr(ra, 0);
+    for (size_t i = 0; i < argument_gprs.size(); i++) {
+        save_gpr(argument_gprs[i], xlen * static_cast<int32_t>(1 + i));
+    }
+    for (size_t i = 0; fpr_size != 0 && i < argument_fprs.size(); i++) {
+        const auto offset = fpr_base + 8 * static_cast<int32_t>(i);
+        if (save_double) {
+            as.FSD(argument_fprs[i], offset, sp);
+        } else {
+            as.FSW(argument_fprs[i], offset, sp);
+        }
+    }
+
+    as.LI(a0, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this)));
+    if (is_rv32) {
+        as.LW(a1, 0, t0);
+    } else {
+        as.LWU(a1, 0, t0);
+    }
+    as.LI(t1, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&ResolveThunk)));
+    as.JALR(ra, 0, t1);
+    as.MV(t1, a0);
+
+    restore_gpr(ra, 0);
+    for (size_t i = 0; i < argument_gprs.size(); i++) {
+        restore_gpr(argument_gprs[i], xlen * static_cast<int32_t>(1 + i));
+    }
+    for (size_t i = 0; fpr_size != 0 && i < argument_fprs.size(); i++) {
+        const auto offset = fpr_base + 8 * static_cast<int32_t>(i);
+        if (save_double) {
+            as.FLD(argument_fprs[i], offset, sp);
+        } else {
+            as.FLW(argument_fprs[i], offset, sp);
+        }
+    }
+    as.ADDI(sp, sp, frame_size);
+    as.JR(t1);
+}
+
+uint32_t LazyStubs::EmitStub(Label* entry) {
+    BISCUIT_ASSERT(m_resolver_offset);
+
+    auto& as = m_assembler;
+    auto& buffer = as.GetCodeBuffer();
+
+    // Stubs are retargeted with a single aligned store to their JALR.
+    as.Align(4);
+    if (entry != nullptr) {
+        as.Bind(entry);
+    }
+
+    const auto offset = buffer.GetCursorOffset();
+    const auto resolver = *m_resolver_offset - offset;
+    BISCUIT_ASSERT(IsValidPCRelPairImm(resolver));
+
+    const std::scoped_lock lock{m_mutex};
+    const auto id = static_cast<uint32_t>(m_stubs.size());
+    m_stubs.push_back({offset, 0});
+
+    // The JALR links through t0, so the resolver knows where it was entered
+    // from, and calls made through a retargeted stub leave ra untouched.
+    const auto resolver_offset = static_cast<int32_t>(resolver);
+    as.AUIPC(t0, static_cast<int32_t>(GetPCRelHi20(resolver_offset)));
+    buffer.Emit32(enc::JALR(t0, GetPCRelLo12(resolver_offset), t0));
+    buffer.Emit32(id);
+
+    // The ID is data, so it must not be moved around by a scheduler.
+    as.SkipSchedule();
+    return id;
+}
+
+uintptr_t LazyStubs::Resolve(uint32_t id) {
+    const std::scoped_lock lock{m_mutex};
+    BISCUIT_ASSERT(id < m_stubs.size());
+
+    if (m_stubs[id].target != 0) {
+        return m_stubs[id].target;
+    }
+
+    const auto target = m_compile(id);
+    BISCUIT_ASSERT(target != 0);
+
+    // The callback may have emitted further stubs, so the stub is looked up again.
+    auto& stub = m_stubs[id];
+    stub.target = target;
+    m_assembler.RetargetCall(stub.offset, target);
+    return target;
+}
+
+uintptr_t LazyStubs::ResolveThunk(LazyStubs* stubs, uint32_t id) {
+    return stubs->Resolve(id);
+}
+
+ptrdiff_t LazyStubs::GetStubOffset(uint32_t id) const {
+    const std::scoped_lock lock{m_mutex};
+    BISCUIT_ASSERT(id < m_stubs.size());
+    return m_stubs[id].offset;
+}
+
+std::optional<uintptr_t> LazyStubs::GetTarget(uint32_t id) const {
+    const std::scoped_lock lock{m_mutex};
+    BISCUIT_ASSERT(id < m_stubs.size());
+
+    if (m_stubs[id].target == 0) {
+        return std::nullopt;
+    }
+    return m_stubs[id].target;
+}
+
+size_t LazyStubs::GetStubCount() const {
+    const std::scoped_lock lock{m_mutex};
+    return m_stubs.size();
+}
+
+} // namespace biscuit
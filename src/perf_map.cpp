@@ -0,0 +1,357 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/label.hpp>
+#include <biscuit/perf_map.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace biscuit {
+namespace {
+// Values from perf's jitdump specification.
+constexpr uint32_t jitdump_magic = 0x4A695444;
+constexpr uint32_t jitdump_version = 1;
+constexpr uint32_t jitdump_code_load = 0;
+constexpr uint32_t jitdump_code_debug_info = 2;
+constexpr uint32_t jitdump_code_close = 3;
+
+// EM_RISCV, as elf.h isn't available everywhere.
+constexpr uint32_t elf_machine_riscv = 243;
+
+struct JitDumpHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+static_assert(sizeof(JitDumpHeader) == 40);
+
+struct JitDumpRecordHeader {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+};
+static_assert(sizeof(JitDumpRecordHeader) == 16);
+
+struct JitDumpCodeLoad {
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+};
+static_assert(sizeof(JitDumpCodeLoad) == 40);
+
+struct JitDumpDebugInfo {
+    uint64_t code_addr;
+    uint64_t nr_entry;
+};
+
+struct JitDumpDebugEntry {
+    uint64_t code_addr;
+    uint32_t line;
+    uint32_t discrim;
+};
+static_assert(sizeof(JitDumpDebugEntry) == 16);
+
+struct LabelLocation {
+    ptrdiff_t offset;
+    std::string_view name;
+};
+
+uint32_t GetProcessID() {
+#ifdef _WIN32
+    return static_cast<uint32_t>(_getpid());
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+uint32_t GetThreadID() {
+#ifdef __linux__
+    return static_cast<uint32_t>(syscall(SYS_gettid));
+#else
+    return GetProcessID();
+#endif
+}
+
+uint64_t GetTimestamp() {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+std::string GetDefaultPath(std::string_view prefix, std::string_view suffix) {
+    std::string path{prefix};
+    path += std::to_string(GetProcessID());
+    path += suffix;
+    return path;
+}
+
+// Gathers the labels bound within a range, ordered by location. Only the first of
+// several labels bound to the same location is kept, as the rest would be empty.
+std::vector<LabelLocation> GatherLabels(CodeRange range, std::span<const PerfLabel> labels) {
+    const auto end = range.offset + static_cast<ptrdiff_t>(range.size);
+
+    std::vector<LabelLocation> locations;
+    locations.reserve(labels.size());
+    for (const auto& [label, name] : labels) {
+        BISCUIT_ASSERT(label != nullptr);
+
+        const auto location = label->GetLocation();
+        if (!location || *location < range.offset || *location >= end) {
+            continue;
+        }
+        locations.push_back({*location, name});
+    }
+
+    std::stable_sort(locations.begin(), locations.end(),
+                     [](const auto& lhs, const auto& rhs) { return lhs.offset < rhs.offset; });
+    const auto last = std::unique(locations.begin(), locations.end(),
+                                  [](const auto& lhs, const auto& rhs) { return lhs.offset == rhs.offset; });
+    locations.erase(last, locations.end());
+
+    return locations;
+}
+
+template <typename T>
+void WriteValue(std::FILE* file, const T& value) {
+    std::fwrite(&value, sizeof(T), 1, file);
+}
+
+void WriteString(std::FILE* file, std::string_view str) {
+    std::fwrite(str.data(), 1, str.size(), file);
+    std::fputc('\0', file);
+}
+} // Anonymous namespace
+
+PerfMap::PerfMap()
+    : PerfMap(GetDefaultPath("/tmp/perf-", ".map")) {}
+
+PerfMap::PerfMap(std::string path)
+    : m_file{std::fopen(path.c_str(), "a")}, m_path{std::move(path)} {}
+
+PerfMap::PerfMap(PerfMap&& other) noexcept
+    : m_file{std::exchange(other.m_file, nullptr)}
+    , m_path{std::move(other.m_path)} {}
+
+PerfMap& PerfMap::operator=(PerfMap&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    std::swap(m_file, other.m_file);
+    std::swap(m_path, other.m_path);
+    return *this;
+}
+
+PerfMap::~PerfMap() noexcept {
+    if (m_file != nullptr) {
+        std::fclose(m_file);
+    }
+}
+
+void PerfMap::AddSymbol(uintptr_t address, size_t size, std::string_view name) {
+    if (m_file == nullptr || size == 0) {
+        return;
+    }
+
+    std::fprintf(m_file, "%llx %zx %.*s\n", static_cast<unsigned long long>(address), size,
+                 static_cast<int>(name.size()), name.data());
+}
+
+void PerfMap::AddSymbol(const CodeBuffer& buffer, CodeRange range, std::string_view name,
+                        std::span<const PerfLabel> labels) {
+    const auto end = range.offset + static_cast<ptrdiff_t>(range.size);
+    const auto locations = GatherLabels(range, labels);
+
+    const auto add_region = [&](ptrdiff_t begin, ptrdiff_t region_end, std::string_view region_name) {
+        AddSymbol(buffer.GetOffsetAddress(begin), static_cast<size_t>(region_end - begin), region_name);
+    };
+
+    const auto first_end = locations.empty() ? end : locations.front().offset;
+    add_region(range.offset, first_end, name);
+
+    std::string region_name;
+    for (size_t i = 0; i < locations.size(); i++) {
+        const auto region_end = i + 1 < locations.size() ? locations[i + 1].offset : end;
+
+        region_name.assign(name);
+        region_name += ':';
+        region_name += locations[i].name;
+        add_region(locations[i].offset, region_end, region_name);
+    }
+}
+
+void PerfMap::Flush() {
+    if (m_file != nullptr) {
+        std::fflush(m_file);
+    }
+}
+
+JitDump::JitDump()
+    : JitDump(GetDefaultPath("/tmp/jit-", ".dump")) {}
+
+JitDump::JitDump(std::string path)
+    : m_file{std::fopen(path.c_str(), "w+b")}, m_path{std::move(path)} {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    WriteHeader();
+    std::fflush(m_file);
+
+#ifdef __linux__
+    // perf record looks for the mapping of the dump to find it, so it must be executable.
+    m_marker_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    m_marker = mmap(nullptr, m_marker_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, fileno(m_file), 0);
+    if (m_marker == MAP_FAILED) {
+        m_marker = nullptr;
+        m_marker_size = 0;
+    }
+#endif
+}
+
+JitDump::JitDump(JitDump&& other) noexcept
+    : m_file{std::exchange(other.m_file, nullptr)}
+    , m_path{std::move(other.m_path)}
+    , m_code_index{std::exchange(other.m_code_index, uint64_t{0})}
+    , m_marker{std::exchange(other.m_marker, nullptr)}
+    , m_marker_size{std::exchange(other.m_marker_size, size_t{0})} {}
+
+JitDump& JitDump::operator=(JitDump&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    std::swap(m_file, other.m_file);
+    std::swap(m_path, other.m_path);
+    std::swap(m_code_index, other.m_code_index);
+    std::swap(m_marker, other.m_marker);
+    std::swap(m_marker_size, other.m_marker_size);
+    return *this;
+}
+
+JitDump::~JitDump() noexcept {
+    Close();
+}
+
+void JitDump::Close() noexcept {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    WriteValue(m_file, JitDumpRecordHeader{
+        .id = jitdump_code_close,
+        .total_size = sizeof(JitDumpRecordHeader),
+        .timestamp = GetTimestamp(),
+    });
+
+#ifdef __linux__
+    if (m_marker != nullptr) {
+        munmap(m_marker, m_marker_size);
+    }
+#endif
+
+    std::fclose(m_file);
+    m_file = nullptr;
+    m_marker = nullptr;
+    m_marker_size = 0;
+}
+
+void JitDump::WriteHeader() {
+    WriteValue(m_file, JitDumpHeader{
+        .magic = jitdump_magic,
+        .version = jitdump_version,
+        .total_size = sizeof(JitDumpHeader),
+        .elf_mach = elf_machine_riscv,
+        .pad1 = 0,
+        .pid = GetProcessID(),
+        .timestamp = GetTimestamp(),
+        .flags = 0,
+    });
+}
+
+void JitDump::AddSymbol(uintptr_t address, const uint8_t* code, size_t size, std::string_view name) {
+    if (m_file == nullptr || size == 0) {
+        return;
+    }
+
+    const auto total_size = sizeof(JitDumpRecordHeader) + sizeof(JitDumpCodeLoad) + name.size() + 1 + size;
+    WriteValue(m_file, JitDumpRecordHeader{
+        .id = jitdump_code_load,
+        .total_size = static_cast<uint32_t>(total_size),
+        .timestamp = GetTimestamp(),
+    });
+    WriteValue(m_file, JitDumpCodeLoad{
+        .pid = GetProcessID(),
+        .tid = GetThreadID(),
+        .vma = address,
+        .code_addr = address,
+        .code_size = size,
+        .code_index = m_code_index++,
+    });
+    WriteString(m_file, name);
+    std::fwrite(code, 1, size, m_file);
+}
+
+void JitDump::AddSymbol(const CodeBuffer& buffer, CodeRange range, std::string_view name,
+                        std::span<const PerfLabel> labels) {
+    if (m_file == nullptr || range.size == 0) {
+        return;
+    }
+
+    // Line tables have to precede the code they describe.
+    const auto locations = GatherLabels(range, labels);
+    if (!locations.empty()) {
+        size_t total_size = sizeof(JitDumpRecordHeader) + sizeof(JitDumpDebugInfo);
+        for (const auto& location : locations) {
+            total_size += sizeof(JitDumpDebugEntry) + location.name.size() + 1;
+        }
+
+        WriteValue(m_file, JitDumpRecordHeader{
+            .id = jitdump_code_debug_info,
+            .total_size = static_cast<uint32_t>(total_size),
+            .timestamp = GetTimestamp(),
+        });
+        WriteValue(m_file, JitDumpDebugInfo{
+            .code_addr = buffer.GetOffsetAddress(range.offset),
+            .nr_entry = locations.size(),
+        });
+        for (size_t i = 0; i < locations.size(); i++) {
+            WriteValue(m_file, JitDumpDebugEntry{
+                .code_addr = buffer.GetOffsetAddress(locations[i].offset),
+                .line = static_cast<uint32_t>(i + 1),
+                .discrim = 0,
+            });
+            WriteString(m_file, locations[i].name);
+        }
+    }
+
+    AddSymbol(buffer.GetOffsetAddress(range.offset), buffer.GetOffsetPointer(range.offset),
+              range.size, name);
+}
+
+void JitDump::Flush() {
+    if (m_file != nullptr) {
+        std::fflush(m_file);
+    }
+}
+
+} // namespace biscuit
@@ -0,0 +1,372 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/decoder.hpp>
+#include <biscuit/register_allocator.hpp>
+
+#include <algorithm>
+#include <bit>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+namespace {
+struct Loop {
+    ptrdiff_t begin;
+    ptrdiff_t end;
+};
+
+bool IsCalleeSaved(GPR reg) noexcept {
+    const auto index = reg.Index();
+    return index == 8 || index == 9 || (index >= 18 && index <= 27);
+}
+
+bool IsBranch(const DecodedInstruction& instruction) noexcept {
+    switch (instruction.format) {
+    case InstructionFormat::B:
+    case InstructionFormat::J:
+    case InstructionFormat::CJ:
+        return true;
+    case InstructionFormat::CB:
+        // Also used by immediate arithmetic.
+        return instruction.mnemonic == "c.beqz" || instruction.mnemonic == "c.bnez";
+    default:
+        return false;
+    }
+}
+
+// Finds loops by their backward branches. Data within the code may be mistaken
+// for branches, which only makes live ranges longer than they need to be.
+std::vector<Loop> FindLoops(const Assembler& as, ptrdiff_t begin, ptrdiff_t end) {
+    const Decoder decoder{as.GetArchFeatures(), as.GetExtensions()};
+
+    // Code before the body may have been released from the buffer (e.g. by a CodeStream),
+    // so it's only ever read relative to the start of the body.
+    const auto* const code = as.GetBufferPointer(begin);
+
+    std::vector<Loop> loops;
+    for (auto offset = begin; offset + 2 <= end;) {
+        const std::span<const uint8_t> remaining{code + (offset - begin), static_cast<size_t>(end - offset)};
+        const auto instruction = decoder.Decode(remaining);
+        if (!instruction) {
+            offset += 2;
+            continue;
+        }
+
+        if (IsBranch(*instruction) && instruction->imm < 0) {
+            const auto target = offset + static_cast<ptrdiff_t>(instruction->imm);
+            if (target >= begin) {
+                loops.push_back({target, offset});
+            }
+        }
+        offset += instruction->length;
+    }
+
+    return loops;
+}
+
+// Gets the index of the first operand accessing a register.
+size_t FindFirstOperand(std::span<const VRegOperand> operands, VReg reg) noexcept {
+    const auto iter = std::find_if(operands.begin(), operands.end(), [reg](const VRegOperand& op) {
+        return op.reg == reg;
+    });
+    return static_cast<size_t>(iter - operands.begin());
+}
+
+bool IsUsed(std::span<const VRegOperand> operands, VReg reg) noexcept {
+    return std::any_of(operands.begin(), operands.end(), [reg](const VRegOperand& op) {
+        return op.reg == reg && op.is_use;
+    });
+}
+
+bool IsDefined(std::span<const VRegOperand> operands, VReg reg) noexcept {
+    return std::any_of(operands.begin(), operands.end(), [reg](const VRegOperand& op) {
+        return op.reg == reg && op.is_def;
+    });
+}
+} // Anonymous namespace
+
+RegisterAllocator::RegisterAllocator(Assembler& as, std::span<const GPR> allocatable,
+                                     std::span<const GPR> scratch, int32_t spill_offset)
+    : m_assembler{as}
+    , m_allocatable(allocatable.begin(), allocatable.end())
+    , m_scratch(scratch.begin(), scratch.end())
+    , m_spill_offset{spill_offset} {
+    BISCUIT_ASSERT(!m_allocatable.empty());
+    BISCUIT_ASSERT(m_allocatable.size() <= 32);
+    BISCUIT_ASSERT(spill_offset >= 0);
+}
+
+VReg RegisterAllocator::NewVReg() {
+    BISCUIT_ASSERT(m_pass != Pass::None);
+
+    if (m_pass == Pass::Analyze) {
+        m_intervals.emplace_back();
+    } else {
+        // The generating run has to create the same registers as the analyzed one.
+        BISCUIT_ASSERT(m_vreg_count < m_intervals.size());
+    }
+
+    return VReg{m_vreg_count++};
+}
+
+void RegisterAllocator::BeginOperation(std::span<const VRegOperand> operands, std::span<GPR> regs) {
+    BISCUIT_ASSERT(m_pass != Pass::None);
+
+    if (m_pass == Pass::Analyze) {
+        m_operation_offsets.push_back(m_assembler.GetCodeBuffer().GetCursorOffset());
+
+        size_t placeholders = 0;
+        for (size_t i = 0; i < operands.size(); i++) {
+            const auto index = operands[i].reg.Index();
+            BISCUIT_ASSERT(index < m_intervals.size());
+
+            auto& interval = m_intervals[index];
+            interval.start = std::min(interval.start, m_operation);
+            interval.end = std::max(interval.end, m_operation);
+
+            // Nothing is assigned yet, so any register will do for now, as long as distinct
+            // virtual registers don't alias. Emitters may pick different sequences for aliased
+            // operands, which the generating run wouldn't reproduce.
+            const auto first_index = FindFirstOperand(operands, operands[i].reg);
+            if (first_index != i) {
+                regs[i] = regs[first_index];
+                continue;
+            }
+
+            // Operations with more operands than allocatable registers spill some of them
+            // into scratch registers, so there are always enough of both combined.
+            const auto placeholder = placeholders++;
+            BISCUIT_ASSERT(placeholder < m_allocatable.size() + m_scratch.size());
+            regs[i] = placeholder < m_allocatable.size() ? m_allocatable[placeholder]
+                                                         : m_scratch[placeholder - m_allocatable.size()];
+        }
+        return;
+    }
+
+    BISCUIT_ASSERT(m_operation < m_operation_offsets.size());
+
+    size_t scratch_used = 0;
+    for (size_t i = 0; i < operands.size(); i++) {
+        const auto& interval = m_intervals[operands[i].reg.Index()];
+        if (interval.reg) {
+            regs[i] = *interval.reg;
+            continue;
+        }
+
+        const auto first_index = FindFirstOperand(operands, operands[i].reg);
+        if (first_index != i) {
+            regs[i] = regs[first_index];
+            continue;
+        }
+
+        BISCUIT_ASSERT(scratch_used < m_scratch.size());
+        regs[i] = m_scratch[scratch_used++];
+
+        if (!IsUsed(operands, operands[i].reg)) {
+            continue;
+        }
+
+        const auto offset = GetSpillSlotOffset(interval.spill_slot);
+        if (IsRV32(m_assembler.GetArchFeatures())) {
+            m_assembler.LW(regs[i], offset, sp);
+        } else {
+            m_assembler.LD(regs[i], offset, sp);
+        }
+    }
+}
+
+void RegisterAllocator::EndOperation(std::span<const VRegOperand> operands, std::span<const GPR> regs) {
+    const auto operation = m_operation++;
+    if (m_pass != Pass::Generate) {
+        return;
+    }
+
+    for (size_t i = 0; i < operands.size(); i++) {
+        const auto& interval = m_intervals[operands[i].reg.Index()];
+        if (interval.reg) {
+            continue;
+        }
+
+        if (FindFirstOperand(operands, operands[i].reg) != i) {
+            continue;
+        }
+
+        // Nothing reads a value defined by the last operation using it.
+        if (!IsDefined(operands, operands[i].reg) || interval.end == operation) {
+            continue;
+        }
+
+        const auto offset = GetSpillSlotOffset(interval.spill_slot);
+        if (IsRV32(m_assembler.GetArchFeatures())) {
+            m_assembler.SW(regs[i], offset, sp);
+        } else {
+            m_assembler.SD(regs[i], offset, sp);
+        }
+    }
+}
+
+void RegisterAllocator::Analyze(const Body& body) {
+    BISCUIT_ASSERT(m_pass == Pass::None);
+
+    m_pass = Pass::Analyze;
+    m_vreg_count = 0;
+    m_operation = 0;
+    m_operation_offsets.clear();
+    m_intervals.clear();
+
+    const auto begin = m_assembler.GetCodeBuffer().GetCursorOffset();
+    body(m_assembler, *this);
+    const auto end = m_assembler.GetCodeBuffer().GetCursorOffset();
+
+    ExtendAcrossLoops(begin, end);
+    m_assembler.RewindBuffer(begin);
+    m_pass = Pass::None;
+
+    AssignRegisters();
+}
+
+void RegisterAllocator::Generate(const Body& body) {
+    BISCUIT_ASSERT(m_pass == Pass::None);
+
+    m_pass = Pass::Generate;
+    m_vreg_count = 0;
+    m_operation = 0;
+
+    body(m_assembler, *this);
+
+    // The body has to behave the same way it did when it was analyzed.
+    BISCUIT_ASSERT(m_vreg_count == m_intervals.size());
+    BISCUIT_ASSERT(m_operation == m_operation_offsets.size());
+    m_pass = Pass::None;
+}
+
+void RegisterAllocator::ExtendAcrossLoops(ptrdiff_t begin, ptrdiff_t end) {
+    const auto loops = FindLoops(m_assembler, begin, end);
+    if (loops.empty()) {
+        return;
+    }
+
+    // A value live on entry to a loop has to survive every iteration, so it's live
+    // up to the loop's backward branch. As extending one range may make it live into
+    // an enclosing loop, keep going until nothing changes.
+    for (bool changed = true; changed;) {
+        changed = false;
+
+        for (const auto& loop : loops) {
+            const auto first = std::lower_bound(m_operation_offsets.begin(), m_operation_offsets.end(), loop.begin);
+            const auto last = std::upper_bound(m_operation_offsets.begin(), m_operation_offsets.end(), loop.end);
+            if (first >= last) {
+                continue;
+            }
+
+            const auto loop_start = static_cast<uint32_t>(first - m_operation_offsets.begin());
+            const auto loop_end = static_cast<uint32_t>(last - m_operation_offsets.begin()) - 1;
+
+            for (auto& interval : m_intervals) {
+                if (interval.start < loop_start && interval.end >= loop_start && interval.end < loop_end) {
+                    interval.end = loop_end;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void RegisterAllocator::AssignRegisters() {
+    m_spill_count = 0;
+
+    std::vector<uint32_t> order;
+    order.reserve(m_intervals.size());
+    for (uint32_t i = 0; i < m_intervals.size(); i++) {
+        // Registers that are never used in an operation don't need anything.
+        if (m_intervals[i].start <= m_intervals[i].end) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+        return m_intervals[lhs].start < m_intervals[rhs].start;
+    });
+
+    // Free registers are tracked by their index within the allocatable set,
+    // so the lowest bit is always the most preferred free register.
+    uint32_t free = m_allocatable.size() == 32 ? UINT32_MAX : (1U << m_allocatable.size()) - 1;
+    std::vector<uint32_t> active;
+
+    const auto spill = [this](Interval& interval) {
+        interval.reg.reset();
+        interval.spill_slot = static_cast<uint32_t>(m_spill_count++);
+    };
+    const auto allocatable_index = [this](GPR reg) {
+        return static_cast<uint32_t>(std::find(m_allocatable.begin(), m_allocatable.end(), reg) -
+                                     m_allocatable.begin());
+    };
+
+    for (const auto index : order) {
+        auto& interval = m_intervals[index];
+
+        // Registers only become free after the last operation using them, since
+        // an operation may write its results before it's done reading its inputs.
+        while (!active.empty() && m_intervals[active.front()].end < interval.start) {
+            free |= 1U << allocatable_index(*m_intervals[active.front()].reg);
+            active.erase(active.begin());
+        }
+
+        const auto insert_active = [&](uint32_t new_index) {
+            const auto position = std::upper_bound(active.begin(), active.end(), new_index,
+                                                   [this](uint32_t lhs, uint32_t rhs) {
+                                                       return m_intervals[lhs].end < m_intervals[rhs].end;
+                                                   });
+            active.insert(position, new_index);
+        };
+
+        if (free != 0) {
+            const auto bit = static_cast<uint32_t>(std::countr_zero(free));
+            free &= ~(1U << bit);
+            interval.reg = m_allocatable[bit];
+            insert_active(index);
+            continue;
+        }
+
+        // Spill whichever range ends last, as that frees up a register for the longest.
+        const auto last = active.back();
+        if (m_intervals[last].end > interval.end) {
+            interval.reg = m_intervals[last].reg;
+            spill(m_intervals[last]);
+            active.pop_back();
+            insert_active(index);
+        } else {
+            spill(interval);
+        }
+    }
+}
+
+std::optional<GPR> RegisterAllocator::GetAssignment(VReg reg) const noexcept {
+    BISCUIT_ASSERT(reg.Index() < m_intervals.size());
+    return m_intervals[reg.Index()].reg;
+}
+
+uint32_t RegisterAllocator::GetSpillAreaSize() const noexcept {
+    const auto slot_size = IsRV32(m_assembler.GetArchFeatures()) ? 4U : 8U;
+    return static_cast<uint32_t>(m_spill_offset) + static_cast<uint32_t>(m_spill_count) * slot_size;
+}
+
+std::vector<GPR> RegisterAllocator::GetUsedCalleeSaved() const {
+    std::vector<GPR> saved;
+    for (const auto reg : m_allocatable) {
+        const auto is_assigned = std::any_of(m_intervals.begin(), m_intervals.end(), [reg](const Interval& interval) {
+            return interval.reg == reg;
+        });
+        if (IsCalleeSaved(reg) && is_assigned) {
+            saved.push_back(reg);
+        }
+    }
+    return saved;
+}
+
+int32_t RegisterAllocator::GetSpillSlotOffset(uint32_t slot) const noexcept {
+    const auto slot_size = IsRV32(m_assembler.GetArchFeatures()) ? 4 : 8;
+    const auto offset = m_spill_offset + static_cast<int32_t>(slot) * slot_size;
+    BISCUIT_ASSERT(IsValidSigned12BitImm(offset));
+    return offset;
+}
+
+} // namespace biscuit
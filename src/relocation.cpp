@@ -0,0 +1,147 @@
+#include <biscuit/assembler.hpp>
+#include <biscuit/assert.hpp>
+#include <biscuit/relocation.hpp>
+
+#include <cstring>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+namespace {
+template <typename T>
+T Read(const uint8_t* ptr) {
+    T value{};
+    std::memcpy(&value, ptr, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void Write(uint8_t* ptr, T value) {
+    std::memcpy(ptr, &value, sizeof(T));
+}
+
+// Computes the value encoded by a relocation applied to code at the given address.
+int64_t GetRelocationValue(uintptr_t code_address, const Relocation& relocation, uintptr_t target) noexcept {
+    const auto target_address = static_cast<int64_t>(target) + relocation.addend;
+    const auto location = static_cast<int64_t>(code_address) + relocation.offset;
+
+    switch (relocation.kind) {
+    case RelocationKind::Absolute32:
+    case RelocationKind::Absolute64:
+        return target_address;
+    case RelocationKind::JumpTableEntry:
+        return target_address - (static_cast<int64_t>(code_address) + relocation.base);
+    default:
+        return target_address - location;
+    }
+}
+} // Anonymous namespace
+
+bool IsValidRelocationValue(RelocationKind kind, int64_t value) noexcept {
+    switch (kind) {
+    case RelocationKind::BType:
+        return IsValidBTypeImm(static_cast<ptrdiff_t>(value));
+    case RelocationKind::JType:
+        return IsValidJTypeImm(static_cast<ptrdiff_t>(value));
+    case RelocationKind::CBType:
+        return IsValidCBTypeImm(static_cast<ptrdiff_t>(value));
+    case RelocationKind::CJType:
+        return IsValidCJTypeImm(static_cast<ptrdiff_t>(value));
+    case RelocationKind::PCRelPair:
+        return IsValidPCRelPairImm(static_cast<ptrdiff_t>(value));
+    case RelocationKind::Absolute64:
+        return true;
+    case RelocationKind::JumpTableEntry:
+        return value >= INT32_MIN && value <= INT32_MAX;
+    case RelocationKind::Absolute32:
+        return value >= 0 && value <= UINT32_MAX;
+    }
+    return false;
+}
+
+bool CanApplyRelocation(uintptr_t code_address, const Relocation& relocation, uintptr_t target) noexcept {
+    return IsValidRelocationValue(relocation.kind, GetRelocationValue(code_address, relocation, target));
+}
+
+void PatchRelocation(uint8_t* ptr, RelocationKind kind, int64_t value) {
+    // Verify that the value is going to be valid, mask out whatever
+    // was previously encoded and then OR the new value in.
+
+    switch (kind) {
+    case RelocationKind::BType: {
+        BISCUIT_ASSERT(IsValidBTypeImm(static_cast<ptrdiff_t>(value)));
+        auto instruction = Read<uint32_t>(ptr);
+        instruction &= ~0xFE000F80U;
+        instruction |= TransformToBTypeImm(static_cast<uint32_t>(value));
+        Write(ptr, instruction);
+        break;
+    }
+    case RelocationKind::JType: {
+        BISCUIT_ASSERT(IsValidJTypeImm(static_cast<ptrdiff_t>(value)));
+        auto instruction = Read<uint32_t>(ptr);
+        instruction &= ~0xFFFFF000U;
+        instruction |= TransformToJTypeImm(static_cast<uint32_t>(value));
+        Write(ptr, instruction);
+        break;
+    }
+    case RelocationKind::CBType: {
+        BISCUIT_ASSERT(IsValidCBTypeImm(static_cast<ptrdiff_t>(value)));
+        auto instruction = uint32_t{Read<uint16_t>(ptr)};
+        instruction &= ~0x1C7CU;
+        instruction |= TransformToCBTypeImm(static_cast<uint32_t>(value));
+        Write(ptr, static_cast<uint16_t>(instruction));
+        break;
+    }
+    case RelocationKind::CJType: {
+        BISCUIT_ASSERT(IsValidCJTypeImm(static_cast<ptrdiff_t>(value)));
+        auto instruction = uint32_t{Read<uint16_t>(ptr)};
+        instruction &= ~0x1FFCU;
+        instruction |= TransformToCJTypeImm(static_cast<uint32_t>(value));
+        Write(ptr, static_cast<uint16_t>(instruction));
+        break;
+    }
+    case RelocationKind::PCRelPair: {
+        BISCUIT_ASSERT(IsValidPCRelPairImm(static_cast<ptrdiff_t>(value)));
+        const auto offset = static_cast<int32_t>(value);
+
+        auto auipc = Read<uint32_t>(ptr);
+        auipc &= ~0xFFFFF000U;
+        auipc |= GetPCRelHi20(offset) << 12;
+        Write(ptr, auipc);
+
+        // Integer and floating-point stores make use of the S-type immediate encoding.
+        // Everything else that can be paired with an AUIPC is I-type.
+        auto pair = Read<uint32_t>(ptr + sizeof(uint32_t));
+        const auto opcode = pair & 0x7F;
+        const auto lo12 = static_cast<uint32_t>(GetPCRelLo12(offset)) & 0xFFF;
+        if (opcode == 0b0100011 || opcode == 0b0100111) {
+            pair &= ~0xFE000F80U;
+            pair |= ((lo12 & 0xFE0) << 20) | ((lo12 & 0x1F) << 7);
+        } else {
+            pair &= ~0xFFF00000U;
+            pair |= lo12 << 20;
+        }
+        Write(ptr + sizeof(uint32_t), pair);
+        break;
+    }
+    case RelocationKind::Absolute64:
+        Write(ptr, static_cast<uint64_t>(value));
+        break;
+    case RelocationKind::JumpTableEntry:
+        BISCUIT_ASSERT(value >= INT32_MIN && value <= INT32_MAX);
+        Write(ptr, static_cast<int32_t>(value));
+        break;
+    case RelocationKind::Absolute32:
+        BISCUIT_ASSERT(value >= 0 && value <= UINT32_MAX);
+        Write(ptr, static_cast<uint32_t>(value));
+        break;
+    }
+}
+
+void ApplyRelocation(uint8_t* code, uintptr_t code_address,
+                     const Relocation& relocation, uintptr_t target) {
+    PatchRelocation(code + relocation.offset, relocation.kind,
+                    GetRelocationValue(code_address, relocation, target));
+}
+
+} // namespace biscuit
@@ -0,0 +1,472 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/decoder.hpp>
+#include <biscuit/scheduler.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace biscuit {
+namespace {
+// Registers are numbered so that both register files share a single space.
+// Zero means no register, which conveniently also covers x0.
+constexpr uint8_t sp_reg = 2;
+
+constexpr uint8_t IntReg(uint32_t index) {
+    return static_cast<uint8_t>(index);
+}
+
+constexpr uint8_t FPReg(uint32_t index) {
+    return static_cast<uint8_t>(32 + index);
+}
+
+struct Operands {
+    SchedulingClass scheduling_class = SchedulingClass::ALU;
+    uint8_t def = 0;
+    std::array<uint8_t, 3> uses{};
+    bool writes_int = false;
+    bool is_barrier = false;
+};
+
+constexpr Operands Barrier() {
+    return {.is_barrier = true};
+}
+
+constexpr Operands IntOp(SchedulingClass scheduling_class, uint32_t rd, uint8_t use1 = 0,
+                         uint8_t use2 = 0, uint8_t use3 = 0) {
+    return {
+        .scheduling_class = scheduling_class,
+        .def = IntReg(rd),
+        .uses = {use1, use2, use3},
+        .writes_int = true,
+    };
+}
+
+constexpr Operands FPOp(SchedulingClass scheduling_class, uint32_t rd, uint8_t use1 = 0,
+                        uint8_t use2 = 0, uint8_t use3 = 0) {
+    return {
+        .scheduling_class = scheduling_class,
+        .def = FPReg(rd),
+        .uses = {use1, use2, use3},
+    };
+}
+
+constexpr Operands StoreOp(uint8_t base, uint8_t value) {
+    return {
+        .scheduling_class = SchedulingClass::Store,
+        .uses = {base, value, 0},
+    };
+}
+
+// Determines the operands of OP-FP instructions.
+Operands GetFPOperands(uint32_t encoding) {
+    const auto rd = (encoding >> 7) & 0x1F;
+    const auto rs1 = (encoding >> 15) & 0x1F;
+    const auto rs2 = (encoding >> 20) & 0x1F;
+
+    switch (encoding >> 27) {
+    case 0b00000: // FADD
+    case 0b00001: // FSUB
+    case 0b00010: // FMUL
+    case 0b00100: // FSGNJ(N/X)
+    case 0b00101: // FMIN(M) and FMAX(M)
+        return FPOp(SchedulingClass::FloatingPoint, rd, FPReg(rs1), FPReg(rs2));
+    case 0b00011: // FDIV
+    case 0b01011: // FSQRT
+        return FPOp(SchedulingClass::FloatingPointDivide, rd, FPReg(rs1), FPReg(rs2));
+    case 0b01000: // FCVT between formats and FROUND(NX)
+        return FPOp(SchedulingClass::FloatingPoint, rd, FPReg(rs1));
+    case 0b10100: // Comparisons
+        return IntOp(SchedulingClass::FloatingPoint, rd, FPReg(rs1), FPReg(rs2));
+    case 0b11000: // FCVT to integer
+    case 0b11100: // FMV to integer, FMVH and FCLASS
+        return IntOp(SchedulingClass::FloatingPoint, rd, FPReg(rs1));
+    case 0b11010: // FCVT from integer
+    case 0b11110: // FMV from integer and FLI
+        return FPOp(SchedulingClass::FloatingPoint, rd, IntReg(rs1));
+    case 0b10110: // FMVP
+        return FPOp(SchedulingClass::FloatingPoint, rd, IntReg(rs1), IntReg(rs2));
+    default:
+        return Barrier();
+    }
+}
+
+// Determines the operands of 32-bit instructions.
+Operands GetOperands32(uint32_t encoding) {
+    const auto rd = (encoding >> 7) & 0x1F;
+    const auto rs1 = (encoding >> 15) & 0x1F;
+    const auto rs2 = (encoding >> 20) & 0x1F;
+    const auto rs3 = encoding >> 27;
+    const auto funct3 = (encoding >> 12) & 0b111;
+
+    // Scalar floating-point loads and stores share their opcodes with vector ones.
+    const bool is_scalar_fp_width = funct3 >= 0b001 && funct3 <= 0b100;
+
+    switch (encoding & 0x7F) {
+    case 0b0110111: // LUI
+        return IntOp(SchedulingClass::ALU, rd);
+    case 0b0000011: // LOAD
+        return IntOp(SchedulingClass::Load, rd, IntReg(rs1));
+    case 0b0100011: // STORE
+        return StoreOp(IntReg(rs1), IntReg(rs2));
+    case 0b0010011: // OP-IMM
+    case 0b0011011: // OP-IMM-32
+        return IntOp(SchedulingClass::ALU, rd, IntReg(rs1));
+    case 0b0110011: // OP
+    case 0b0111011: { // OP-32
+        auto scheduling_class = SchedulingClass::ALU;
+        if ((encoding >> 25) == 0b0000001) {
+            scheduling_class = funct3 < 0b100 ? SchedulingClass::Multiply : SchedulingClass::Divide;
+        }
+        return IntOp(scheduling_class, rd, IntReg(rs1), IntReg(rs2));
+    }
+    case 0b0000111: // LOAD-FP
+        if (!is_scalar_fp_width) {
+            return Barrier();
+        }
+        return FPOp(SchedulingClass::Load, rd, IntReg(rs1));
+    case 0b0100111: // STORE-FP
+        if (!is_scalar_fp_width) {
+            return Barrier();
+        }
+        return StoreOp(IntReg(rs1), FPReg(rs2));
+    case 0b1000011: // FMADD
+    case 0b1000111: // FMSUB
+    case 0b1001011: // FNMSUB
+    case 0b1001111: // FNMADD
+        return FPOp(SchedulingClass::FloatingPoint, rd, FPReg(rs1), FPReg(rs2), FPReg(rs3));
+    case 0b1010011: // OP-FP
+        return GetFPOperands(encoding);
+    default:
+        return Barrier();
+    }
+}
+
+// Determines the operands of compressed instructions, including implicit uses of sp.
+Operands GetOperands16(uint32_t encoding, ArchFeature features) {
+    if (encoding == 0) {
+        return Barrier();
+    }
+
+    const auto funct3 = (encoding >> 13) & 0b111;
+    const auto rd = (encoding >> 7) & 0x1F;
+    const auto rs2 = (encoding >> 2) & 0x1F;
+    const auto rd_prime = 8 + ((encoding >> 7) & 0b111);
+    const auto rs2_prime = 8 + ((encoding >> 2) & 0b111);
+
+    // Some encodings change meaning depending on XLEN.
+    const bool is_rv32 = features == ArchFeature::RV32;
+    const bool is_rv64 = features == ArchFeature::RV64;
+
+    switch (encoding & 0b11) {
+    case 0b00:
+        switch (funct3) {
+        case 0b000: // C.ADDI4SPN
+            return IntOp(SchedulingClass::ALU, rs2_prime, sp_reg);
+        case 0b001: // C.FLD
+            if (!is_rv32 && !is_rv64) {
+                return Barrier();
+            }
+            return FPOp(SchedulingClass::Load, rs2_prime, IntReg(rd_prime));
+        case 0b010: // C.LW
+            return IntOp(SchedulingClass::Load, rs2_prime, IntReg(rd_prime));
+        case 0b011: // C.FLW on RV32, C.LD on RV64
+            if (is_rv32) {
+                return FPOp(SchedulingClass::Load, rs2_prime, IntReg(rd_prime));
+            }
+            if (is_rv64) {
+                return IntOp(SchedulingClass::Load, rs2_prime, IntReg(rd_prime));
+            }
+            return Barrier();
+        case 0b101: // C.FSD
+            if (!is_rv32 && !is_rv64) {
+                return Barrier();
+            }
+            return StoreOp(IntReg(rd_prime), FPReg(rs2_prime));
+        case 0b110: // C.SW
+            return StoreOp(IntReg(rd_prime), IntReg(rs2_prime));
+        case 0b111: // C.FSW on RV32, C.SD on RV64
+            if (is_rv32) {
+                return StoreOp(IntReg(rd_prime), FPReg(rs2_prime));
+            }
+            if (is_rv64) {
+                return StoreOp(IntReg(rd_prime), IntReg(rs2_prime));
+            }
+            return Barrier();
+        default: // Zcb loads and stores
+            return Barrier();
+        }
+    case 0b01:
+        switch (funct3) {
+        case 0b000: // C.ADDI
+            return IntOp(SchedulingClass::ALU, rd, IntReg(rd));
+        case 0b001: // C.JAL on RV32, C.ADDIW otherwise
+            if (is_rv32) {
+                return Barrier();
+            }
+            return IntOp(SchedulingClass::ALU, rd, IntReg(rd));
+        case 0b010: // C.LI
+            return IntOp(SchedulingClass::ALU, rd);
+        case 0b011: // C.LUI and C.ADDI16SP
+            return IntOp(SchedulingClass::ALU, rd, IntReg(rd));
+        case 0b100: { // Arithmetic on compressed registers, including Zcb's
+            const bool is_mul = (encoding & 0x1C60) == 0x1C40;
+            return IntOp(is_mul ? SchedulingClass::Multiply : SchedulingClass::ALU, rd_prime,
+                         IntReg(rd_prime), IntReg(rs2_prime));
+        }
+        default: // C.J, C.BEQZ and C.BNEZ
+            return Barrier();
+        }
+    case 0b10:
+        switch (funct3) {
+        case 0b000: // C.SLLI
+            return IntOp(SchedulingClass::ALU, rd, IntReg(rd));
+        case 0b001: // C.FLDSP
+            if (!is_rv32 && !is_rv64) {
+                return Barrier();
+            }
+            return FPOp(SchedulingClass::Load, rd, sp_reg);
+        case 0b010: // C.LWSP
+            return IntOp(SchedulingClass::Load, rd, sp_reg);
+        case 0b011: // C.FLWSP on RV32, C.LDSP on RV64
+            if (is_rv32) {
+                return FPOp(SchedulingClass::Load, rd, sp_reg);
+            }
+            if (is_rv64) {
+                return IntOp(SchedulingClass::Load, rd, sp_reg);
+            }
+            return Barrier();
+        case 0b100:
+            // C.JR, C.JALR and C.EBREAK
+            if (rs2 == 0) {
+                return Barrier();
+            }
+            // C.ADD
+            if ((encoding & 0x1000) != 0) {
+                return IntOp(SchedulingClass::ALU, rd, IntReg(rd), IntReg(rs2));
+            }
+            // C.MV
+            return IntOp(SchedulingClass::ALU, rd, IntReg(rs2));
+        case 0b110: // C.SWSP
+            return StoreOp(sp_reg, IntReg(rs2));
+        case 0b111: // C.FSWSP on RV32, C.SDSP on RV64
+            if (is_rv32) {
+                return StoreOp(sp_reg, FPReg(rs2));
+            }
+            if (is_rv64) {
+                return StoreOp(sp_reg, IntReg(rs2));
+            }
+            return Barrier();
+        default: // C.FSDSP, which shares its encoding space with Zcmp and Zcmt
+            return Barrier();
+        }
+    default:
+        return Barrier();
+    }
+}
+
+Operands GetOperands(uint32_t encoding, size_t length, ArchFeature features) {
+    auto operands = Barrier();
+    if (length == 2) {
+        operands = GetOperands16(encoding & 0xFFFF, features);
+    } else if (length == 4) {
+        operands = GetOperands32(encoding);
+    }
+
+    // Writing to x0 is how hints (including NOPs) are encoded. They usually
+    // have some purpose that depends on where they are, so they're left alone.
+    if (operands.writes_int && operands.def == 0) {
+        return Barrier();
+    }
+    return operands;
+}
+
+bool Contains(const std::array<uint8_t, 3>& uses, uint8_t reg) {
+    return reg != 0 && std::find(uses.begin(), uses.end(), reg) != uses.end();
+}
+
+bool IsMemoryOp(SchedulingClass scheduling_class) {
+    return scheduling_class == SchedulingClass::Load || scheduling_class == SchedulingClass::Store;
+}
+} // Anonymous namespace
+
+size_t InstructionScheduler::Schedule(std::span<uint8_t> code, ArchFeature features) {
+    BISCUIT_ASSERT(m_model.issue_width != 0);
+
+    m_nodes.clear();
+
+    bool follows_auipc = false;
+    for (size_t offset = 0; offset + sizeof(uint16_t) <= code.size();) {
+        uint16_t parcel = 0;
+        std::memcpy(&parcel, code.data() + offset, sizeof(parcel));
+
+        const auto length = GetInstructionLength(parcel);
+        if (length == 0 || offset + length > code.size()) {
+            break;
+        }
+
+        uint32_t encoding = parcel;
+        if (length == 4) {
+            std::memcpy(&encoding, code.data() + offset, sizeof(encoding));
+        }
+
+        const auto operands = GetOperands(encoding, length, features);
+        m_nodes.push_back({
+            .offset = static_cast<uint32_t>(offset),
+            .length = static_cast<uint32_t>(length),
+            .scheduling_class = operands.scheduling_class,
+            .def = operands.def,
+            .uses = operands.uses,
+            // The low half of an AUIPC pair must stay right after it to be patchable.
+            .is_barrier = operands.is_barrier || follows_auipc,
+        });
+
+        follows_auipc = length == 4 && (encoding & 0x7F) == 0b0010111;
+        offset += length;
+    }
+
+    // Runs of movable instructions between barriers are scheduled independently.
+    const std::span<const Node> nodes{m_nodes};
+    size_t moved = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].is_barrier) {
+            moved += ScheduleWindow(code.data(), nodes.subspan(begin, i - begin));
+            begin = i + 1;
+        } else if (i - begin == window_size) {
+            moved += ScheduleWindow(code.data(), nodes.subspan(begin, i - begin));
+            begin = i;
+        }
+    }
+    moved += ScheduleWindow(code.data(), nodes.subspan(begin));
+
+    return moved;
+}
+
+size_t InstructionScheduler::ScheduleWindow(uint8_t* code, std::span<const Node> nodes) {
+    const auto count = nodes.size();
+    if (count < 2) {
+        return 0;
+    }
+
+    // Build the dependency graph. Edges are generated in order of their destination.
+    m_edges.clear();
+    for (size_t to = 0; to < count; to++) {
+        const auto& node = nodes[to];
+
+        for (size_t from = 0; from < to; from++) {
+            const auto& prior = nodes[from];
+            int latency = -1;
+
+            // Read after write
+            if (prior.def != 0 && Contains(node.uses, prior.def)) {
+                latency = static_cast<int>(m_model.GetLatency(prior.scheduling_class));
+            }
+            // Write after write
+            if (prior.def != 0 && prior.def == node.def) {
+                latency = std::max(latency, 1);
+            }
+            // Write after read
+            if (Contains(prior.uses, node.def)) {
+                latency = std::max(latency, 0);
+            }
+            // Memory accesses keep their order relative to stores.
+            if (IsMemoryOp(prior.scheduling_class) && IsMemoryOp(node.scheduling_class) &&
+                (prior.scheduling_class == SchedulingClass::Store ||
+                 node.scheduling_class == SchedulingClass::Store)) {
+                latency = std::max(latency, 0);
+            }
+
+            if (latency >= 0) {
+                m_edges.push_back({
+                    .from = static_cast<uint8_t>(from),
+                    .to = static_cast<uint8_t>(to),
+                    .latency = static_cast<uint8_t>(std::min(latency, 255)),
+                });
+            }
+        }
+    }
+
+    // The height of an instruction is the length of the longest dependency chain
+    // starting at it, which is what's prioritized. Walking edges backwards visits
+    // every edge leaving an instruction before any edge entering it.
+    std::array<uint32_t, window_size> heights{};
+    for (size_t i = 0; i < count; i++) {
+        heights[i] = m_model.GetLatency(nodes[i].scheduling_class);
+    }
+    for (auto iter = m_edges.rbegin(); iter != m_edges.rend(); ++iter) {
+        heights[iter->from] = std::max(heights[iter->from], iter->latency + heights[iter->to]);
+    }
+
+    std::array<uint32_t, window_size> pending_preds{};
+    for (const auto& edge : m_edges) {
+        pending_preds[edge.to]++;
+    }
+
+    // Group edges by their source for quickly releasing successors.
+    std::stable_sort(m_edges.begin(), m_edges.end(),
+                     [](const Edge& lhs, const Edge& rhs) { return lhs.from < rhs.from; });
+    std::array<uint32_t, window_size + 1> first_edge{};
+    for (const auto& edge : m_edges) {
+        first_edge[edge.from + 1]++;
+    }
+    for (size_t i = 0; i < count; i++) {
+        first_edge[i + 1] += first_edge[i];
+    }
+
+    std::array<uint32_t, window_size> earliest_cycle{};
+    std::array<uint8_t, window_size> order{};
+    uint64_t scheduled = 0;
+    size_t scheduled_count = 0;
+
+    for (uint32_t cycle = 0; scheduled_count < count; cycle++) {
+        std::array<uint32_t, scheduling_class_count> units_used{};
+
+        for (uint32_t issued = 0; issued < m_model.issue_width; issued++) {
+            size_t best = count;
+            for (size_t i = 0; i < count; i++) {
+                const auto class_index = static_cast<size_t>(nodes[i].scheduling_class);
+                const bool is_ready = (scheduled & (uint64_t{1} << i)) == 0 && pending_preds[i] == 0 &&
+                                      earliest_cycle[i] <= cycle &&
+                                      units_used[class_index] < m_model.GetUnitsPerCycle(nodes[i].scheduling_class);
+
+                // Ties go to the earliest instruction, keeping the original order where possible.
+                if (is_ready && (best == count || heights[i] > heights[best])) {
+                    best = i;
+                }
+            }
+
+            if (best == count) {
+                break;
+            }
+
+            scheduled |= uint64_t{1} << best;
+            order[scheduled_count++] = static_cast<uint8_t>(best);
+            units_used[static_cast<size_t>(nodes[best].scheduling_class)]++;
+
+            for (auto e = first_edge[best]; e < first_edge[best + 1]; e++) {
+                const auto& edge = m_edges[e];
+                pending_preds[edge.to]--;
+                earliest_cycle[edge.to] = std::max(earliest_cycle[edge.to], cycle + edge.latency);
+            }
+        }
+    }
+
+    // Write the instructions back in their new order.
+    auto* const window = code + nodes.front().offset;
+    const auto window_end = nodes.back().offset + nodes.back().length;
+    m_scratch.resize(window_end - nodes.front().offset);
+
+    size_t moved = 0;
+    size_t position = 0;
+    for (size_t i = 0; i < count; i++) {
+        const auto& node = nodes[order[i]];
+        std::memcpy(m_scratch.data() + position, code + node.offset, node.length);
+        position += node.length;
+        moved += order[i] != i;
+    }
+    std::memcpy(window, m_scratch.data(), m_scratch.size());
+
+    return moved;
+}
+
+} // namespace biscuit
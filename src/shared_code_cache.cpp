@@ -0,0 +1,238 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/shared_code_cache.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "assembler_util.hpp"
+#include "code_memory.hpp"
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace biscuit {
+namespace {
+// Every location in a cache at its largest is within reach of every other one.
+static_assert(IsValidPCRelPairImm(static_cast<ptrdiff_t>(SharedCodeCache::max_capacity)));
+
+constexpr size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr bool IsPowerOfTwo(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+size_t GetPageSize(CodeBufferPages pages) {
+    if (pages == CodeBufferPages::Huge) {
+        return CodeBuffer::huge_page_size;
+    }
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    static const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page_size;
+#else
+    return 4096;
+#endif
+}
+} // Anonymous namespace
+
+SharedCodeCache::SharedCodeCache(size_t capacity, size_t stub_capacity, ArchFeature features,
+                                 [[maybe_unused]] CodeBufferPages pages)
+    : m_capacity{capacity}, m_stub_capacity{stub_capacity}, m_features{features} {
+    BISCUIT_ASSERT(capacity != 0);
+    BISCUIT_ASSERT(capacity <= max_capacity);
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    capacity = GetCodeMemorySize(capacity, pages);
+    BISCUIT_ASSERT(capacity <= max_capacity);
+    const auto page_size = GetPageSize(pages);
+#else
+    const auto page_size = GetPageSize(CodeBufferPages::Default);
+#endif
+    const auto table_size = AlignUp(stub_capacity * sizeof(uintptr_t), page_size);
+    const auto stubs_end = table_size + stub_capacity * stub_size;
+    m_code_start = table_size;
+    BISCUIT_ASSERT(stubs_end <= capacity);
+
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    // Only reserve the address space. Pages are only backed once they're touched.
+    int flags = 0;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+
+    const auto memory = MapCodeMemory(capacity, pages, flags);
+    m_region = memory.memory;
+    m_capacity = memory.size;
+#else
+    // Only the stub table has to start out zeroed, like fresh pages would be.
+    m_region = new uint8_t[capacity];
+    std::memset(m_region, 0, table_size);
+#endif
+
+    m_stub_code = m_region + table_size;
+    m_next.store(stubs_end, std::memory_order_relaxed);
+}
+
+SharedCodeCache::~SharedCodeCache() noexcept {
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    munmap(m_region, m_capacity);
+#else
+    delete[] m_region;
+#endif
+}
+
+std::optional<CodeBuffer> SharedCodeCache::Allocate(size_t size, size_t alignment) {
+    BISCUIT_ASSERT(size != 0);
+    BISCUIT_ASSERT(IsPowerOfTwo(alignment));
+
+    const auto base = reinterpret_cast<uintptr_t>(m_region);
+
+    auto current = m_next.load(std::memory_order_relaxed);
+    size_t offset = 0;
+    do {
+        offset = AlignUp(base + current, alignment) - base;
+        if (offset > m_capacity || size > m_capacity - offset) {
+            return std::nullopt;
+        }
+    } while (!m_next.compare_exchange_weak(current, offset + size, std::memory_order_relaxed));
+
+    return CodeBuffer{m_region + offset, size};
+}
+
+std::optional<SharedCodeCache::StubID> SharedCodeCache::CreateStub(uintptr_t target) {
+    // Stubs past the capacity are never handed out, so the count
+    // overshooting it once the table is full is harmless.
+    const auto index = m_stub_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= m_stub_capacity) {
+        return std::nullopt;
+    }
+
+    const auto stub = static_cast<StubID>(index);
+    SetStubTarget(stub, target);
+
+    // The stub loads its target from the table and jumps to it, clobbering only t1,
+    // which the calling convention already reserves for call linkage (as with PLTs).
+    auto* const code = m_stub_code + index * stub_size;
+    const auto slot_offset = static_cast<int32_t>(reinterpret_cast<uint8_t*>(&GetStubSlot(stub)) - code);
+
+    Assembler as{code, stub_size, m_features};
+    as.AUIPC(t1, static_cast<int32_t>(GetPCRelHi20(slot_offset)));
+    if (IsRV32(m_features)) {
+        as.LW(t1, GetPCRelLo12(slot_offset), t1);
+    } else {
+        as.LD(t1, GetPCRelLo12(slot_offset), t1);
+    }
+    as.JR(t1);
+    as.EBREAK();
+    as.GetCodeBuffer().FlushInstructionCache();
+
+    return stub;
+}
+
+void SharedCodeCache::SetStubTarget(StubID stub, uintptr_t target) noexcept {
+    BISCUIT_ASSERT(stub < m_stub_capacity);
+    std::atomic_ref<uintptr_t>{GetStubSlot(stub)}.store(target, std::memory_order_release);
+}
+
+uintptr_t SharedCodeCache::GetStubTarget(StubID stub) const noexcept {
+    BISCUIT_ASSERT(stub < m_stub_capacity);
+    return std::atomic_ref<uintptr_t>{GetStubSlot(stub)}.load(std::memory_order_acquire);
+}
+
+uintptr_t SharedCodeCache::GetStubAddress(StubID stub) const noexcept {
+    BISCUIT_ASSERT(stub < m_stub_capacity);
+    return reinterpret_cast<uintptr_t>(m_stub_code + stub * stub_size);
+}
+
+size_t SharedCodeCache::GetStubCount() const noexcept {
+    return std::min(m_stub_count.load(std::memory_order_relaxed), m_stub_capacity);
+}
+
+uintptr_t& SharedCodeCache::GetStubSlot(StubID stub) const noexcept {
+    return reinterpret_cast<uintptr_t*>(m_region)[stub];
+}
+
+void SharedCodeCache::SetExecutable() {
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    const auto result = mprotect(m_region + m_code_start, m_capacity - m_code_start, PROT_READ | PROT_EXEC);
+    BISCUIT_ASSERT(result == 0);
+#endif
+    // Memory from new can't have its protection changed, so there's nothing to do.
+}
+
+void SharedCodeCache::SetWritable() {
+#ifdef BISCUIT_CODE_BUFFER_MMAP
+    const auto result = mprotect(m_region + m_code_start, m_capacity - m_code_start, PROT_READ | PROT_WRITE);
+    BISCUIT_ASSERT(result == 0);
+#endif
+    // Memory from new can't have its protection changed, so there's nothing to do.
+}
+
+ThreadCodeArena::ThreadCodeArena(SharedCodeCache& cache, size_t chunk_size, ArchFeature features)
+    : m_cache{cache}, m_chunk_size{chunk_size}, m_assembler{0} {
+    BISCUIT_ASSERT(chunk_size != 0);
+    m_assembler.SetArchFeatures(features);
+}
+
+bool ThreadCodeArena::BeginFunction(size_t max_size, size_t alignment) {
+    BISCUIT_ASSERT(!IsInFunction());
+    BISCUIT_ASSERT(IsPowerOfTwo(alignment));
+
+    auto& buffer = m_assembler.GetCodeBuffer();
+    const auto cursor = buffer.GetCursorAddress();
+    const auto padding = AlignUp(cursor, alignment) - cursor;
+    const auto fits = buffer.GetCapacity() != 0 && buffer.GetRemainingBytes() >= padding + max_size;
+
+    if (!fits) {
+        auto chunk = m_cache.Allocate(std::max(m_chunk_size, max_size), alignment);
+        if (!chunk) {
+            return false;
+        }
+
+        // Keeps all of the assembler's settings, while starting afresh within the new chunk.
+        buffer = std::move(*chunk);
+        m_assembler.InvalidateVTypeState();
+        m_assembler.SkipSchedule();
+    } else {
+        m_assembler.Align(alignment, AlignFill::Zero);
+    }
+
+    m_function_start = buffer.GetCursorOffset();
+    return true;
+}
+
+uintptr_t ThreadCodeArena::EndFunction() {
+    BISCUIT_ASSERT(IsInFunction());
+    m_assembler.FlushSchedule();
+
+    auto& buffer = m_assembler.GetCodeBuffer();
+    const auto start = *std::exchange(m_function_start, std::nullopt);
+    const CodeRange range{start, static_cast<size_t>(buffer.GetCursorOffset() - start)};
+    buffer.FlushInstructionCache({&range, 1});
+
+    return buffer.GetOffsetAddress(start);
+}
+
+void ThreadCodeArena::CallStub(SharedCodeCache::StubID stub) {
+    m_assembler.CALL(GetStubOffset(stub));
+}
+
+void ThreadCodeArena::TailStub(SharedCodeCache::StubID stub) {
+    m_assembler.TAIL(GetStubOffset(stub));
+}
+
+int32_t ThreadCodeArena::GetStubOffset(SharedCodeCache::StubID stub) noexcept {
+    BISCUIT_ASSERT(IsInFunction());
+
+    const auto offset = static_cast<ptrdiff_t>(m_cache.GetStubAddress(stub) -
+                                               m_assembler.GetCodeBuffer().GetCursorAddress());
+    BISCUIT_ASSERT(IsValidPCRelPairImm(offset));
+    return static_cast<int32_t>(offset);
+}
+
+} // namespace biscuit
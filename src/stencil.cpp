@@ -0,0 +1,117 @@
+#include <biscuit/stencil.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+namespace {
+// Fills in a single hole of an already copied stencil.
+void PatchHole(uint8_t* ptr, ptrdiff_t location, StencilField field, int64_t value) {
+    if (field == StencilField::Target) {
+        PatchLabelReference(ptr, static_cast<ptrdiff_t>(value) - location);
+        return;
+    }
+
+    uint32_t instruction = 0;
+    std::memcpy(&instruction, ptr, sizeof(instruction));
+
+    const auto bits = static_cast<uint32_t>(value);
+    switch (field) {
+    case StencilField::Rd:
+        BISCUIT_ASSERT(value >= 0 && value <= 31);
+        instruction = (instruction & ~0x00000F80U) | (bits << 7);
+        break;
+    case StencilField::Rs1:
+        BISCUIT_ASSERT(value >= 0 && value <= 31);
+        instruction = (instruction & ~0x000F8000U) | (bits << 15);
+        break;
+    case StencilField::Rs2:
+        BISCUIT_ASSERT(value >= 0 && value <= 31);
+        instruction = (instruction & ~0x01F00000U) | (bits << 20);
+        break;
+    case StencilField::IImm:
+        BISCUIT_ASSERT(IsValidSigned12BitImm(static_cast<ptrdiff_t>(value)));
+        instruction = (instruction & ~0xFFF00000U) | ((bits & 0xFFF) << 20);
+        break;
+    case StencilField::SImm:
+        BISCUIT_ASSERT(IsValidSigned12BitImm(static_cast<ptrdiff_t>(value)));
+        instruction = (instruction & ~0xFE000F80U) | ((bits & 0xFE0) << 20) | ((bits & 0x1F) << 7);
+        break;
+    case StencilField::UImm:
+        instruction = (instruction & ~0xFFFFF000U) | ((bits & 0xFFFFF) << 12);
+        break;
+    case StencilField::Target:
+        break;
+    }
+
+    std::memcpy(ptr, &instruction, sizeof(instruction));
+}
+} // Anonymous namespace
+
+ptrdiff_t Stencil::Instantiate(CodeBuffer& buffer, std::span<const int64_t> args) const {
+    BISCUIT_ASSERT(args.size() >= m_argument_count);
+
+    const auto base = buffer.GetCursorOffset();
+    {
+        auto reservation = buffer.Reserve(m_code.size());
+        reservation.EmitBytes(m_code.data(), m_code.size());
+    }
+
+    for (const auto& hole : m_holes) {
+        const auto location = base + static_cast<ptrdiff_t>(hole.offset);
+        PatchHole(buffer.GetOffsetPointer(location), location, hole.field, args[hole.argument]);
+    }
+
+    return base;
+}
+
+StencilBuilder::StencilBuilder(ArchFeature features)
+    : m_assembler{CodeBuffer::default_capacity} {
+    m_assembler.SetArchFeatures(features);
+    m_assembler.GetCodeBuffer().SetGrowable(true);
+}
+
+void StencilBuilder::MarkHole(StencilField field, uint32_t argument) {
+    MarkHole(m_assembler.GetCodeBuffer().GetCursorOffset() - 4, field, argument);
+}
+
+void StencilBuilder::MarkHole(ptrdiff_t offset, StencilField field, uint32_t argument) {
+    auto& buffer = m_assembler.GetCodeBuffer();
+    BISCUIT_ASSERT(offset >= 0 && offset < buffer.GetCursorOffset());
+
+    m_holes.push_back({
+        .offset = static_cast<uint32_t>(offset),
+        .field = field,
+        .argument = argument,
+    });
+}
+
+Stencil StencilBuilder::Build() {
+    auto& buffer = m_assembler.GetCodeBuffer();
+    BISCUIT_ASSERT(buffer.GetBaseOffset() == 0);
+    const auto* const code = buffer.GetOffsetPointer(0);
+
+    // Anything else not finalized yet (e.g. references to unbound labels) would be copied unpatched.
+    m_assembler.FlushSchedule();
+    BISCUIT_ASSERT(m_assembler.GetFinalizedOffset() == buffer.GetCursorOffset());
+
+    Stencil stencil;
+    stencil.m_code.assign(code, code + buffer.GetSizeInBytes());
+    stencil.m_holes = m_holes;
+
+    // Keep holes in address order, so instantiation patches front to back.
+    std::stable_sort(stencil.m_holes.begin(), stencil.m_holes.end(),
+                     [](const StencilHole& lhs, const StencilHole& rhs) {
+                         return lhs.offset < rhs.offset;
+                     });
+
+    for (const auto& hole : stencil.m_holes) {
+        stencil.m_argument_count = std::max<size_t>(stencil.m_argument_count, hole.argument + 1);
+    }
+
+    return stencil;
+}
+
+} // namespace biscuit
@@ -0,0 +1,158 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/switch.hpp>
+
+#include <algorithm>
+#include <limits>
+
+#include "assembler_util.hpp"
+
+namespace biscuit {
+
+SwitchBuilder::SwitchBuilder(Label* default_target)
+    : m_default{default_target} {
+    BISCUIT_ASSERT(default_target != nullptr);
+}
+
+void SwitchBuilder::AddCase(int64_t value, Label* target) {
+    BISCUIT_ASSERT(target != nullptr);
+    m_cases.push_back({value, target});
+}
+
+uint64_t SwitchBuilder::GetRange() const noexcept {
+    if (m_cases.empty()) {
+        return 0;
+    }
+
+    const auto [min, max] = std::minmax_element(m_cases.begin(), m_cases.end(), [](const Case& lhs, const Case& rhs) {
+        return lhs.value < rhs.value;
+    });
+    const auto difference = static_cast<uint64_t>(max->value) - static_cast<uint64_t>(min->value);
+    return difference == std::numeric_limits<uint64_t>::max() ? difference : difference + 1;
+}
+
+SwitchStrategy SwitchBuilder::PickStrategy() const noexcept {
+    const auto range = GetRange();
+    const auto count = static_cast<uint64_t>(m_cases.size());
+
+    if (count >= min_table_cases && range <= max_table_entries &&
+        range <= count * max_table_entries_per_case) {
+        return SwitchStrategy::JumpTable;
+    }
+    return SwitchStrategy::BinarySearch;
+}
+
+SwitchStrategy SwitchBuilder::Emit(Assembler& as, GPR value, GPR scratch1, GPR scratch2,
+                                   SwitchStrategy strategy) {
+    BISCUIT_ASSERT(!m_table.IsBound());
+    BISCUIT_ASSERT(value != scratch1 && value != scratch2 && scratch1 != scratch2);
+
+    std::sort(m_cases.begin(), m_cases.end(), [](const Case& lhs, const Case& rhs) {
+        return lhs.value < rhs.value;
+    });
+    BISCUIT_ASSERT(std::adjacent_find(m_cases.begin(), m_cases.end(), [](const Case& lhs, const Case& rhs) {
+        return lhs.value == rhs.value;
+    }) == m_cases.end());
+    BISCUIT_ASSERT(!IsRV32(as.GetArchFeatures()) || m_cases.empty() ||
+                   (m_cases.front().value >= std::numeric_limits<int32_t>::min() &&
+                    m_cases.back().value <= std::numeric_limits<int32_t>::max()));
+
+    // Jump tables are data, which branch relaxation can't adjust when it moves code.
+    if (strategy == SwitchStrategy::Auto) {
+        strategy = as.IsBranchRelaxationEnabled() ? SwitchStrategy::BinarySearch : PickStrategy();
+    }
+    BISCUIT_ASSERT(strategy != SwitchStrategy::JumpTable || !as.IsBranchRelaxationEnabled());
+
+    if (m_cases.empty()) {
+        as.J(m_default);
+        return strategy;
+    }
+
+    if (strategy == SwitchStrategy::JumpTable) {
+        EmitJumpTable(as, value, scratch1, scratch2);
+    } else {
+        EmitBinarySearch(as, value, scratch1, m_cases);
+    }
+    return strategy;
+}
+
+void SwitchBuilder::EmitJumpTable(Assembler& as, GPR value, GPR scratch1, GPR scratch2) {
+    const auto base = m_cases.front().value;
+    const auto range = GetRange();
+    BISCUIT_ASSERT(range <= max_table_entries);
+
+    // Values below the base wrap around to large indices, so a single
+    // unsigned comparison takes care of both ends of the range.
+    GPR index = value;
+    if (base != 0) {
+        // The lowest value can't be negated.
+        if (base != std::numeric_limits<int64_t>::min() && IsValidSigned12BitImm(-base)) {
+            as.ADDI(scratch1, value, static_cast<int32_t>(-base));
+        } else {
+            as.LI(scratch2, static_cast<uint64_t>(base));
+            as.SUB(scratch1, value, scratch2);
+        }
+        index = scratch1;
+    }
+    as.LI(scratch2, range);
+    as.BGEU(index, scratch2, m_default);
+
+    as.LA(scratch2, &m_table);
+    if (as.GetExtensions().Has(Extension::Zba)) {
+        as.SH2ADD(scratch1, index, scratch2);
+    } else {
+        as.SLLI(scratch1, index, 2);
+        as.ADD(scratch1, scratch1, scratch2);
+    }
+    as.LW(scratch1, 0, scratch1);
+    as.ADD(scratch1, scratch1, scratch2);
+    as.JR(scratch1);
+
+    as.Align(4, AlignFill::Zero);
+    as.Bind(&m_table);
+
+    // Values in between cases go to the default target.
+    auto next = m_cases.begin();
+    for (uint64_t i = 0; i < range; i++) {
+        const auto entry_value = static_cast<int64_t>(static_cast<uint64_t>(base) + i);
+        if (next->value == entry_value) {
+            as.EmitJumpTableEntry(next->target, &m_table);
+            ++next;
+        } else {
+            as.EmitJumpTableEntry(m_default, &m_table);
+        }
+    }
+}
+
+void SwitchBuilder::EmitBinarySearch(Assembler& as, GPR value, GPR scratch, std::span<const Case> cases) {
+    if (cases.size() <= linear_search_cases) {
+        for (const auto& c : cases) {
+            as.BEQ(value, LoadCaseValue(as, scratch, c.value), c.target);
+        }
+        as.J(m_default);
+        return;
+    }
+
+    // Values above the pivot are handled out of line, while those below it fall through.
+    const auto middle = cases.size() / 2;
+    const auto& pivot = cases[middle];
+
+    auto upper = Label::Local();
+    const auto pivot_reg = LoadCaseValue(as, scratch, pivot.value);
+    as.BEQ(value, pivot_reg, pivot.target);
+    as.BLT(pivot_reg, value, &upper);
+    EmitBinarySearch(as, value, scratch, cases.first(middle));
+
+    as.Bind(&upper);
+    EmitBinarySearch(as, value, scratch, cases.subspan(middle + 1));
+}
+
+GPR SwitchBuilder::LoadCaseValue(Assembler& as, GPR scratch, int64_t value) {
+    if (value == 0) {
+        return x0;
+    }
+
+    as.LI(scratch, static_cast<uint64_t>(value));
+    return scratch;
+}
+
+} // namespace biscuit
@@ -0,0 +1,141 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/tuning.hpp>
+#include <biscuit/vector_loop.hpp>
+
+#include <array>
+#include <initializer_list>
+
+namespace biscuit {
+namespace {
+constexpr uint32_t Fusions(std::initializer_list<Fusion> fusions) noexcept {
+    uint32_t flags = 0;
+    for (const auto fusion : fusions) {
+        flags |= static_cast<uint32_t>(fusion);
+    }
+    return flags;
+}
+
+// Indexed by TuningCore. Latencies are ordered as SchedulingClass: ALU, Multiply,
+// Divide, Load, Store, FloatingPoint and FloatingPointDivide.
+constexpr std::array<TuningModel, 6> presets{{
+    {},
+    {
+        .name = "sifive-u74",
+        .scheduling{
+            .issue_width = 2,
+            .latencies{1, 3, 20, 3, 1, 5, 20},
+            .units_per_cycle{0, 1, 1, 1, 1, 1, 1},
+        },
+        .fusions = Fusions({Fusion::ShortForwardBranch}),
+        .misaligned_access = MisalignedAccess::Emulated,
+    },
+    {
+        .name = "sifive-p670",
+        .scheduling{
+            .issue_width = 4,
+            .latencies{1, 3, 12, 4, 1, 4, 12},
+            .units_per_cycle{0, 1, 1, 2, 1, 2, 1},
+        },
+        .fusions = Fusions({Fusion::LuiAddi, Fusion::AuipcAddi}),
+        .misaligned_access = MisalignedAccess::Fast,
+        .vlenb = 16,
+        .preferred_lmul = LMUL::M2,
+    },
+    {
+        .name = "thead-c910",
+        .scheduling{
+            .issue_width = 3,
+            .latencies{1, 4, 20, 3, 1, 4, 20},
+            .units_per_cycle{2, 1, 1, 1, 1, 2, 1},
+        },
+        .misaligned_access = MisalignedAccess::Fast,
+    },
+    {
+        .name = "thead-c920",
+        .scheduling{
+            .issue_width = 3,
+            .latencies{1, 4, 20, 3, 1, 4, 20},
+            .units_per_cycle{2, 1, 1, 1, 1, 2, 1},
+        },
+        .misaligned_access = MisalignedAccess::Fast,
+        .vlenb = 16,
+        .preferred_lmul = LMUL::M1,
+    },
+    {
+        .name = "spacemit-x60",
+        .scheduling{
+            .issue_width = 2,
+            .latencies{1, 3, 20, 3, 1, 4, 20},
+            .units_per_cycle{0, 1, 1, 1, 1, 1, 1},
+        },
+        .vlenb = 32,
+        .preferred_lmul = LMUL::M1,
+    },
+}};
+
+// mvendorid values, which are JEDEC manufacturer IDs.
+constexpr uint64_t vendor_sifive = 0x489;
+constexpr uint64_t vendor_thead = 0x5B7;
+constexpr uint64_t vendor_spacemit = 0x710;
+
+// marchid values. Commercial cores have the top bit set.
+constexpr uint64_t arch_sifive_u7 = 0x8000000000000007;
+constexpr uint64_t arch_spacemit_x60 = 0x8000000058000001;
+
+// The number of registers in a group, or 0 for fractional groups.
+constexpr uint32_t GroupRegisters(LMUL lmul) noexcept {
+    const auto value = static_cast<uint32_t>(lmul);
+    return value <= static_cast<uint32_t>(LMUL::M8) ? 1U << value : 0U;
+}
+} // Anonymous namespace
+
+const TuningModel& GetTuningModel(TuningCore core) noexcept {
+    const auto index = static_cast<size_t>(core);
+    BISCUIT_ASSERT(index < presets.size());
+    return presets[index];
+}
+
+TuningCore IdentifyTuningCore(const CPUSnapshot& snapshot) noexcept {
+    switch (snapshot.vendor_id) {
+    case vendor_sifive:
+        if (snapshot.arch_id == arch_sifive_u7) {
+            return TuningCore::SiFiveU74;
+        }
+        break;
+    case vendor_thead:
+        // The C9xx cores all report a marchid and mimpid of zero.
+        if (snapshot.arch_id == 0 && snapshot.impl_id == 0) {
+            return snapshot.vlenb != 0 ? TuningCore::THeadC920 : TuningCore::THeadC910;
+        }
+        break;
+    case vendor_spacemit:
+        if (snapshot.arch_id == arch_spacemit_x60) {
+            return TuningCore::SpacemiTX60;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return TuningCore::Generic;
+}
+
+TuningModel GetHostTuningModel(const CPUSnapshot& snapshot) noexcept {
+    auto model = GetTuningModel(IdentifyTuningCore(snapshot));
+    model.vlenb = snapshot.vlenb;
+    if (snapshot.misaligned_access != MisalignedAccess::Unknown) {
+        model.misaligned_access = snapshot.misaligned_access;
+    }
+    return model;
+}
+
+LMUL ChooseLoopLMUL(const TuningModel& model, SEW sew, uint32_t live_groups, size_t typical_count) noexcept {
+    const auto lmul = ChooseLoopLMUL(model.vlenb, sew, live_groups, typical_count);
+    const auto limit = GroupRegisters(model.preferred_lmul) == 0 ? LMUL::M1 : model.preferred_lmul;
+    if (GroupRegisters(limit) < GroupRegisters(lmul)) {
+        return limit;
+    }
+    return lmul;
+}
+
+} // namespace biscuit
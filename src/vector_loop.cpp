@@ -0,0 +1,114 @@
+#include <biscuit/assert.hpp>
+#include <biscuit/label.hpp>
+#include <biscuit/vector_loop.hpp>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace biscuit {
+namespace {
+// Register group multipliers from largest to smallest, along with their size in registers.
+constexpr std::array<std::pair<LMUL, uint32_t>, 4> lmul_sizes{{
+    {LMUL::M8, 8},
+    {LMUL::M4, 4},
+    {LMUL::M2, 2},
+    {LMUL::M1, 1},
+}};
+
+constexpr uint32_t vector_register_count = 32;
+} // Anonymous namespace
+
+LMUL ChooseLoopLMUL(uint32_t vlenb, SEW sew, uint32_t live_groups, size_t typical_count) noexcept {
+    BISCUIT_ASSERT(sew <= SEW::E64);
+    if (vlenb == 0 || live_groups == 0) {
+        return LMUL::M1;
+    }
+
+    const auto element_bytes = size_t{1} << static_cast<uint32_t>(sew);
+
+    size_t choice = lmul_sizes.size() - 1;
+    for (size_t i = 0; i < lmul_sizes.size(); i++) {
+        // Groups start at a register index that's a multiple of their size,
+        // so keeping v0 free takes away the whole group containing it.
+        const auto size = lmul_sizes[i].second;
+        if (vector_register_count / size - 1 >= live_groups || size == 1) {
+            choice = i;
+            break;
+        }
+    }
+
+    if (typical_count != 0) {
+        while (choice + 1 < lmul_sizes.size()) {
+            const auto smaller_vlmax = vlenb * lmul_sizes[choice + 1].second / element_bytes;
+            if (smaller_vlmax < typical_count) {
+                break;
+            }
+            choice++;
+        }
+    }
+
+    return lmul_sizes[choice].first;
+}
+
+void VectorLoopBuilder::AddPointer(GPR reg, SEW element_width) {
+    BISCUIT_ASSERT(element_width <= SEW::E64);
+    BISCUIT_ASSERT(std::none_of(m_pointers.begin(), m_pointers.end(),
+                                [reg](const auto& pointer) { return pointer.reg == reg; }));
+    m_pointers.push_back({reg, static_cast<uint32_t>(element_width)});
+}
+
+void VectorLoopBuilder::Emit(GPR count, GPR vl, GPR scratch, const Body& body) {
+    auto& as = m_assembler;
+    const bool has_zba = as.GetExtensions().Has(Extension::Zba);
+
+    BISCUIT_ASSERT(count != x0 && vl != x0);
+    BISCUIT_ASSERT(count != vl);
+    BISCUIT_ASSERT(scratch != count && scratch != vl);
+    for (const auto& pointer : m_pointers) {
+        BISCUIT_ASSERT(pointer.reg != count && pointer.reg != vl && pointer.reg != scratch);
+    }
+
+    auto loop = Label::Local();
+    as.Bind(&loop);
+    as.VSETVLI(vl, count, m_sew, m_lmul, m_vta, m_vma);
+    body(as, vl);
+    as.SUB(count, count, vl);
+
+    // Pointers walking over elements of the same width share a single shifted vl.
+    for (uint32_t shift = 0; shift <= 3; shift++) {
+        bool shifted = false;
+        for (const auto& pointer : m_pointers) {
+            if (pointer.shift != shift) {
+                continue;
+            }
+
+            if (shift == 0) {
+                as.ADD(pointer.reg, pointer.reg, vl);
+            } else if (has_zba) {
+                switch (shift) {
+                case 1:
+                    as.SH1ADD(pointer.reg, vl, pointer.reg);
+                    break;
+                case 2:
+                    as.SH2ADD(pointer.reg, vl, pointer.reg);
+                    break;
+                default:
+                    as.SH3ADD(pointer.reg, vl, pointer.reg);
+                    break;
+                }
+            } else {
+                BISCUIT_ASSERT(scratch != x0);
+                if (!shifted) {
+                    as.SLLI(scratch, vl, shift);
+                    shifted = true;
+                }
+                as.ADD(pointer.reg, pointer.reg, scratch);
+            }
+        }
+    }
+
+    as.BNEZ(count, &loop);
+}
+
+} // namespace biscuit
@@ -0,0 +1,200 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <biscuit/assembler.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+Assembler MakeCompressingAssembler64(std::array<uint8_t, 64>& buffer, ExtensionSet extensions) {
+    auto as = MakeAssembler64(buffer);
+    as.SetExtensions(extensions);
+    as.SetAutoCompression(true);
+    return as;
+}
+
+// Reads the 32-bit instruction at a given offset.
+uint32_t Read32(const std::array<uint8_t, 64>& buffer, size_t offset) {
+    uint32_t value = 0;
+    std::memcpy(&value, buffer.data() + offset, sizeof(value));
+    return value;
+}
+} // Anonymous namespace
+
+TEST_CASE("Auto-compression is opt-in", "[auto-compression]") {
+    std::array<uint8_t, 64> buffer{};
+    auto as = MakeAssembler64(buffer);
+    as.SetExtensions({Extension::C});
+
+    REQUIRE_FALSE(as.IsAutoCompressionEnabled());
+    as.ADD(x8, x8, x9);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 4);
+
+    // Enabling it without the C extension has no effect either.
+    as.RewindBuffer();
+    as.SetExtensions({});
+    as.SetAutoCompression(true);
+    REQUIRE(as.IsAutoCompressionEnabled());
+    as.ADD(x8, x8, x9);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 4);
+}
+
+TEST_CASE("Auto-compression of integer instructions", "[auto-compression]") {
+    std::array<uint8_t, 64> buffer{};
+    std::array<uint8_t, 64> expected{};
+    auto as = MakeCompressingAssembler64(buffer, {Extension::C});
+    auto ref = MakeAssembler64(expected);
+
+    as.ADD(x1, x1, x2);
+    ref.C_ADD(x1, x2);
+    as.ADD(x1, x2, x1);
+    ref.C_ADD(x1, x2);
+    as.MV(x5, x6);
+    ref.C_MV(x5, x6);
+    as.ADDI(x7, x7, -32);
+    ref.C_ADDI(x7, -32);
+    as.ADDI(x2, x2, -64);
+    ref.C_ADDI16SP(-64);
+    as.ADDI(x8, x2, 1020);
+    ref.C_ADDI4SPN(x8, 1020);
+    as.ADDI(x9, x0, 31);
+    ref.C_LI(x9, 31);
+    as.LUI(x10, 0xFFFFF);
+    ref.C_LUI(x10, 0x3F000);
+    as.SUB(x8, x8, x15);
+    ref.C_SUB(x8, x15);
+    as.AND(x9, x10, x9);
+    ref.C_AND(x9, x10);
+    as.ANDI(x11, x11, -1);
+    ref.C_ANDI(x11, 0x3F);
+    as.SLLI(x31, x31, 63);
+    ref.C_SLLI(x31, 63);
+    as.SRAI(x12, x12, 1);
+    ref.C_SRAI(x12, 1);
+    as.ADDIW(x13, x13, 5);
+    ref.C_ADDIW(x13, 5);
+    as.SUBW(x14, x14, x15);
+    ref.C_SUBW(x14, x15);
+    as.JR(x5);
+    ref.C_JR(x5);
+    as.JALR(x6);
+    ref.C_JALR(x6);
+
+    const auto size = ref.GetCodeBuffer().GetSizeInBytes();
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == size);
+    REQUIRE(std::memcmp(buffer.data(), expected.data(), size) == 0);
+}
+
+TEST_CASE("Auto-compression of loads and stores", "[auto-compression]") {
+    std::array<uint8_t, 64> buffer{};
+    std::array<uint8_t, 64> expected{};
+    auto as = MakeCompressingAssembler64(buffer, {Extension::C});
+    auto ref = MakeAssembler64(expected);
+
+    as.LD(x1, 504, x2);
+    ref.C_LDSP(x1, 504);
+    as.SD(x31, 8, x2);
+    ref.C_SDSP(x31, 8);
+    as.LW(x8, 124, x9);
+    ref.C_LW(x8, 124, x9);
+    as.SW(x10, 4, x11);
+    ref.C_SW(x10, 4, x11);
+    as.FLD(f8, 248, x15);
+    ref.C_FLD(f8, 248, x15);
+    as.FSD(f31, 16, x2);
+    ref.C_FSDSP(f31, 16);
+
+    const auto size = ref.GetCodeBuffer().GetSizeInBytes();
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == size);
+    REQUIRE(std::memcmp(buffer.data(), expected.data(), size) == 0);
+}
+
+TEST_CASE("Auto-compression with Zcb", "[auto-compression]") {
+    std::array<uint8_t, 64> buffer{};
+    std::array<uint8_t, 64> expected{};
+    auto as = MakeCompressingAssembler64(buffer, {Extension::C, Extension::Zcb});
+    auto ref = MakeAssembler64(expected);
+
+    as.LBU(x8, 3, x9);
+    ref.C_LBU(x8, 3, x9);
+    as.SH(x10, 2, x11);
+    ref.C_SH(x10, 2, x11);
+    as.NOT(x12, x12);
+    ref.C_NOT(x12);
+    as.ANDI(x13, x13, 0xFF);
+    ref.C_ZEXT_B(x13);
+    as.SEXTH(x14, x14);
+    ref.C_SEXT_H(x14);
+    as.ZEXTH(x15, x15);
+    ref.C_ZEXT_H(x15);
+    as.ZEXTW(x8, x8);
+    ref.C_ZEXT_W(x8);
+    as.MUL(x9, x10, x9);
+    ref.C_MUL(x9, x10);
+
+    const auto size = ref.GetCodeBuffer().GetSizeInBytes();
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == size);
+    REQUIRE(std::memcmp(buffer.data(), expected.data(), size) == 0);
+
+    // Without Zcb, none of these have a compressed form.
+    as.RewindBuffer();
+    as.SetExtensions({Extension::C});
+    as.LBU(x8, 3, x9);
+    as.NOT(x12, x12);
+    as.MUL(x9, x10, x9);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 12);
+}
+
+TEST_CASE("Auto-compression keeps operands that don't fit", "[auto-compression]") {
+    std::array<uint8_t, 64> buffer{};
+    auto as = MakeCompressingAssembler64(buffer, {Extension::C});
+
+    as.ADD(x8, x9, x10);       // Destination isn't a source
+    as.ADDI(x7, x7, 32);       // Immediate is out of range
+    as.LD(x8, 4, x9);          // Offset isn't a multiple of 8
+    as.SW(x16, 0, x9);         // Register isn't compressible
+    as.SRLI(x16, x16, 1);      // Register isn't compressible
+    as.LUI(x2, 1);             // SP can't be the destination of C.LUI
+    as.JALR(x5, 0, x6);        // Link register isn't RA
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 28);
+
+    // Zcmp takes over the encodings of double-precision stack loads and stores.
+    as.RewindBuffer();
+    as.SetExtensions({Extension::C, Extension::Zcmp});
+    as.FSD(f8, 16, x2);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 4);
+}
+
+TEST_CASE("Auto-compression never shrinks NOPs or hints", "[auto-compression]") {
+    std::array<uint8_t, 64> buffer{};
+    auto as = MakeCompressingAssembler64(buffer, {Extension::C});
+
+    as.NOP();
+    as.ADDI(x0, x0, 1);
+    as.ADD(x0, x1, x2);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 12);
+}
+
+TEST_CASE("Auto-compression leaves PC-relative pairs intact", "[auto-compression]") {
+    std::array<uint8_t, 64> buffer{};
+    auto as = MakeCompressingAssembler64(buffer, {Extension::C});
+
+    Label label;
+    as.LA(x8, &label);
+    as.LD(x9, &label);
+    as.SW(x9, &label, x8);
+    as.FLD(f8, &label, x8);
+    as.CALL(&label);
+    as.TAIL(&label);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 48);
+
+    // Binding the label patches every pair, as it would without compression.
+    as.Bind(&label);
+    REQUIRE(Read32(buffer, 4) == enc::ADDI(x8, x8, 48));
+    REQUIRE(Read32(buffer, 12) == enc::LD(x9, 40, x9));
+    REQUIRE(Read32(buffer, 36) == enc::JALR(x1, 16, x1));
+    REQUIRE(Read32(buffer, 44) == enc::JALR(x0, 8, x6));
+}
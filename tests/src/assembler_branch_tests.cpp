@@ -1,6 +1,10 @@
 #include <catch/catch.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cstring>
+#include <utility>
+#include <vector>
 #include <biscuit/assembler.hpp>
 
 #include "assembler_test_utils.hpp"
@@ -103,3 +107,625 @@ TEST_CASE("Branch with Instructions Between", "[branch]") {
         REQUIRE((data[0] & 0xFFFF) == 0xA0A1);
     }
 }
+
+TEST_CASE("Branch with Many Forward References", "[branch]") {
+    std::array<uint32_t, 12> data{};
+    auto as = MakeAssembler32(data);
+
+    // Exceeds the number of references a label keeps inline.
+    Label label;
+    for (size_t i = 0; i < data.size(); i++) {
+        as.J(&label);
+    }
+    Label moved{std::move(label)};
+    REQUIRE(label.IsResolved());
+    REQUIRE(moved.IsUnresolved());
+    as.Bind(&moved);
+
+    std::array<uint32_t, 12> expected{};
+    auto expected_as = MakeAssembler32(expected);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected_as.J(static_cast<int32_t>((expected.size() - i) * sizeof(uint32_t)));
+    }
+
+    REQUIRE(data == expected);
+}
+
+TEST_CASE("Assembler-owned Labels", "[branch]") {
+    std::array<uint32_t, 600> data{};
+    auto as = MakeAssembler32(data);
+
+    // Spans multiple blocks of label storage.
+    std::vector<Label*> labels;
+    for (size_t i = 0; i < 300; i++) {
+        labels.push_back(as.NewLabel());
+        as.J(labels.back());
+    }
+    REQUIRE(as.GetLabelCount() == 300);
+
+    for (auto* label : labels) {
+        as.Bind(label);
+    }
+    REQUIRE(data[0] == 0x4B00006F);
+    REQUIRE(data[299] == 0x0040006F);
+
+    // Labels with outstanding references are dropped on a full rewind.
+    auto* const first = labels[0];
+    as.RewindBuffer();
+    REQUIRE(as.GetLabelCount() == 0);
+
+    auto* const reused = as.NewLabel();
+    REQUIRE(reused == first);
+    REQUIRE(!reused->IsBound());
+    as.J(reused);
+    REQUIRE(reused->IsUnresolved());
+
+    as.ReleaseLabels();
+    REQUIRE(as.GetLabelCount() == 0);
+}
+
+TEST_CASE("PC-relative Label References (Forward)", "[branch]") {
+    std::array<uint32_t, 0x800> data{};
+    auto as = MakeAssembler64(data);
+
+    // Lower 12 bits of each offset are negative, exercising the rounding of the upper bits.
+    Label label;
+    as.LA(x5, &label);
+    as.LW(x6, &label);
+    as.SW(x7, &label, x28);
+    as.CALL(&label);
+    as.TAIL(&label);
+    as.FSD(f1, &label, x29);
+    while (as.GetCodeBuffer().GetSizeInBytes() < 0x1C00) {
+        as.NOP();
+    }
+    as.Bind(&label);
+
+    std::array<uint32_t, 0x800> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.AUIPC(x5, 2);
+    expected_as.ADDI(x5, x5, -0x400);
+    expected_as.AUIPC(x6, 2);
+    expected_as.LW(x6, -0x408, x6);
+    expected_as.AUIPC(x28, 2);
+    expected_as.SW(x7, -0x410, x28);
+    expected_as.CALL(0x1C00 - 24);
+    expected_as.TAIL(0x1C00 - 32);
+    expected_as.AUIPC(x29, 2);
+    expected_as.FSD(f1, -0x428, x29);
+
+    REQUIRE(std::equal(expected.begin(), expected.begin() + 12, data.begin()));
+}
+
+TEST_CASE("PC-relative Label References (Backward)", "[branch]") {
+    std::array<uint32_t, 0x10> data{};
+    auto as = MakeAssembler64(data);
+
+    Label label;
+    as.Bind(&label);
+    as.NOP();
+    as.LD(x10, &label);
+    as.FLD(f2, &label, x11);
+
+    std::array<uint32_t, 0x10> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.NOP();
+    expected_as.AUIPC(x10, 0);
+    expected_as.LD(x10, -4, x10);
+    expected_as.AUIPC(x11, 0);
+    expected_as.FLD(f2, -12, x11);
+
+    REQUIRE(data == expected);
+}
+
+TEST_CASE("PC-relative Label References (Relaxation Moves Code)", "[branch]") {
+    std::array<uint32_t, 0x800> data{};
+    auto as = MakeAssembler64(data);
+    as.SetBranchRelaxation(true);
+
+    Label target;
+    Label constant;
+    as.LA(x5, &constant);
+    as.BEQ(x6, x7, &target);
+    for (int i = 0; i < 0x400; i++) {
+        as.NOP();
+    }
+    as.Bind(&constant);
+    as.Bind(&target);
+
+    // The BEQ grows by 4 bytes, moving the constant along with it.
+    REQUIRE(*as.GetLabelLocation(&constant) == 0x1010);
+
+    std::array<uint32_t, 2> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.AUIPC(x5, 1);
+    expected_as.ADDI(x5, x5, 0x10);
+
+    REQUIRE(data[0] == expected[0]);
+    REQUIRE(data[1] == expected[1]);
+}
+
+TEST_CASE("Branch Relaxation (Forward Near)", "[branch]") {
+    std::vector<uint32_t> data(2048);
+    Assembler as{reinterpret_cast<uint8_t*>(data.data()), data.size() * sizeof(uint32_t)};
+    as.SetBranchRelaxation(true);
+
+    Label label;
+    as.BEQ(x1, x2, &label);
+    for (int i = 0; i < 1100; i++) {
+        as.NOP();
+    }
+    as.Bind(&label);
+
+    std::array<uint32_t, 2> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BNE(x1, x2, 8);
+    expected_as.J(4404);
+
+    REQUIRE(data[0] == expected[0]);
+    REQUIRE(data[1] == expected[1]);
+    REQUIRE(data[2] == 0x00000013);
+    REQUIRE(data[1101] == 0x00000013);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 4408);
+    REQUIRE(as.GetLabelLocation(&label) == 4408);
+}
+
+TEST_CASE("Branch Relaxation (Short Branches Stay Short)", "[branch]") {
+    std::array<uint32_t, 4> data{};
+    auto as = MakeAssembler64(data);
+    as.SetBranchRelaxation(true);
+
+    Label label;
+    as.BNE(x3, x4, &label);
+    as.NOP();
+    as.Bind(&label);
+    as.J(&label);
+
+    REQUIRE(data[0] == 0x00419463);
+    REQUIRE(data[1] == 0x00000013);
+    REQUIRE(data[2] == 0x0000006F);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 12);
+}
+
+TEST_CASE("Branch Relaxation (Moved Code Is Patched)", "[branch]") {
+    std::vector<uint32_t> data(2048);
+    Assembler as{reinterpret_cast<uint8_t*>(data.data()), data.size() * sizeof(uint32_t)};
+    as.SetBranchRelaxation(true);
+
+    Label top;
+    Label far;
+    Label later;
+
+    as.Bind(&top);
+    as.BEQ(x1, x2, &far);
+    as.NOP();
+    as.BNE(x3, x4, &top);
+    as.J(&later);
+    for (int i = 0; i < 1100; i++) {
+        as.NOP();
+    }
+    as.Bind(&far);
+    as.NOP();
+    as.Bind(&later);
+
+    std::array<uint32_t, 5> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BNE(x1, x2, 8);
+    expected_as.J(4416);
+    expected_as.NOP();
+    expected_as.BNE(x3, x4, -12);
+    expected_as.J(4408);
+
+    REQUIRE(data[0] == expected[0]);
+    REQUIRE(data[1] == expected[1]);
+    REQUIRE(data[2] == expected[2]);
+    REQUIRE(data[3] == expected[3]);
+    REQUIRE(data[4] == expected[4]);
+    REQUIRE(as.GetLabelLocation(&top) == 0);
+    REQUIRE(as.GetLabelLocation(&far) == 4420);
+    REQUIRE(as.GetLabelLocation(&later) == 4424);
+}
+
+TEST_CASE("Branch Relaxation (Alignment Is Kept)", "[branch]") {
+    std::vector<uint32_t> data(2048);
+    Assembler as{reinterpret_cast<uint8_t*>(data.data()), data.size() * sizeof(uint32_t)};
+    as.SetBranchRelaxation(true);
+
+    Label loop;
+    Label far;
+    as.BEQ(x1, x2, &far);
+    for (int i = 0; i < 1100; i++) {
+        as.NOP();
+    }
+    as.BindAligned(&loop, 16);
+    as.ADDI(x5, x5, 1);
+    as.Bind(&far);
+
+    // Growing the branch moves the loop, so its padding shrinks from 12 to 8 bytes.
+    std::array<uint32_t, 2> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BNE(x1, x2, 8);
+    expected_as.J(4416);
+
+    REQUIRE(data[0] == expected[0]);
+    REQUIRE(data[1] == expected[1]);
+    REQUIRE(data[1103] == 0x00000013);
+    REQUIRE(data[1104] == 0x00128293);
+    REQUIRE(as.GetLabelLocation(&loop) == 4416);
+    REQUIRE(as.GetLabelLocation(&far) == 4420);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 4420);
+}
+
+TEST_CASE("Branch Relaxation (Backward Far)", "[branch]") {
+    std::vector<uint32_t> data(0x50000);
+    Assembler as{reinterpret_cast<uint8_t*>(data.data()), data.size() * sizeof(uint32_t)};
+    as.SetBranchRelaxation(true, t6);
+
+    Label label;
+    as.Bind(&label);
+    for (int i = 0; i < 0x40000; i++) {
+        as.NOP();
+    }
+    as.BLT(x5, x6, &label);
+    as.JAL(x1, &label);
+
+    std::array<uint32_t, 5> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BGE(x5, x6, 12);
+    expected_as.AUIPC(t6, -256);
+    expected_as.JALR(x0, -4, t6);
+    expected_as.AUIPC(x1, -256);
+    expected_as.JALR(x1, -12, x1);
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(data[0x40000 + i] == expected[i]);
+    }
+}
+
+TEST_CASE("Branch Relaxation (Forward Far)", "[branch]") {
+    std::vector<uint32_t> data(0x50000);
+    Assembler as{reinterpret_cast<uint8_t*>(data.data()), data.size() * sizeof(uint32_t)};
+    as.SetBranchRelaxation(true, t6);
+
+    Label label;
+    as.BEQ(x1, x2, &label);
+    as.J(&label);
+    for (int i = 0; i < 0x40000; i++) {
+        as.NOP();
+    }
+    as.Bind(&label);
+
+    // The branch grows by 8 bytes and the jump grows by 4 bytes.
+    std::array<uint32_t, 5> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BNE(x1, x2, 12);
+    expected_as.AUIPC(t6, 256);
+    expected_as.JALR(x0, 16, t6);
+    expected_as.AUIPC(t6, 256);
+    expected_as.JALR(x0, 8, t6);
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(data[i] == expected[i]);
+    }
+    REQUIRE(as.GetLabelLocation(&label) == 0x100014);
+}
+
+TEST_CASE("Branch Compaction", "[branch]") {
+    std::array<uint32_t, 8> data{};
+    auto as = MakeAssembler64(data);
+    as.SetExtensions({Extension::C});
+    as.SetBranchRelaxation(true);
+
+    Label label;
+    as.BEQZ(x8, &label);
+    as.BNEZ(x15, &label);
+    as.BEQZ(x5, &label);
+    as.J(&label);
+    as.JAL(&label);
+    as.Bind(&label);
+    as.J(&label);
+
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.C_BEQZ(x8, 14);
+    expected_as.C_BNEZ(x15, 12);
+    expected_as.BEQ(x5, x0, 10);
+    expected_as.C_J(6);
+    expected_as.JAL(x1, 4);
+    expected_as.C_J(0);
+
+    REQUIRE(data == expected);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 16);
+}
+
+TEST_CASE("Branch Compaction (Grows When Out of Range)", "[branch]") {
+    std::array<uint32_t, 1024> data{};
+    auto as = MakeAssembler32(data);
+    as.SetExtensions({Extension::C});
+    as.SetBranchRelaxation(true);
+
+    Label label;
+    as.BNEZ(x9, &label);
+    as.JAL(&label);
+    for (int i = 0; i < 100; i++) {
+        as.NOP();
+    }
+    as.Bind(&label);
+    for (int i = 0; i < 600; i++) {
+        as.NOP();
+    }
+    as.JAL(&label);
+
+    // C.BNEZ can only reach 256 bytes, so it grows into BNE, while C.JAL still fits.
+    // The backwards jump doesn't fit within C.JAL, so it's emitted as a regular JAL.
+    std::array<uint32_t, 2> expected{};
+    auto expected_as = MakeAssembler32(expected);
+    expected_as.BNE(x0, x9, 406);
+    expected_as.C_JAL(402);
+
+    REQUIRE(data[0] == expected[0]);
+    REQUIRE((data[1] & 0xFFFF) == (expected[1] & 0xFFFF));
+
+    std::array<uint32_t, 1> expected_back{};
+    auto expected_back_as = MakeAssembler32(expected_back);
+    expected_back_as.JAL(x1, -2400);
+
+    uint32_t back = 0;
+    std::memcpy(&back, as.GetBufferPointer(406 + 2400), sizeof(back));
+    REQUIRE(back == expected_back[0]);
+}
+
+TEST_CASE("Patchable Slots", "[branch]") {
+    std::array<uint32_t, 8> data{};
+    auto as = MakeAssembler64(data);
+    as.SetPatchableSlots(true);
+    REQUIRE(as.IsPatchableSlotsEnabled());
+
+    Label label;
+    as.C_ADDI(x10, 1);
+    as.BEQ(x10, x11, &label);
+    as.C_ADDI(x10, 1);
+    as.CALL(&label);
+    as.Bind(&label);
+
+    // Each slot is preceded by a C.NOP to realign it.
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.C_ADDI(x10, 1);
+    expected_as.C_NOP();
+    expected_as.BEQ(x10, x11, 16);
+    expected_as.C_ADDI(x10, 1);
+    expected_as.C_NOP();
+    expected_as.CALL(8);
+
+    REQUIRE(data == expected);
+    REQUIRE(*label.GetLocation() == 20);
+}
+
+TEST_CASE("Retargeting Branches", "[branch]") {
+    std::array<uint32_t, 2> data{};
+    auto as = MakeAssembler64(data);
+    const auto base = as.GetCodeBuffer().GetOffsetAddress(0);
+
+    as.BNE(x1, x2, 8);
+    as.J(16);
+
+    REQUIRE(as.RetargetBranch(0, base - 4096));
+    REQUIRE(as.RetargetBranch(4, base + 4 + 0x7FFFE));
+
+    std::array<uint32_t, 2> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BNE(x1, x2, -4096);
+    expected_as.J(0x7FFFE);
+    REQUIRE(data == expected);
+
+    // Out of range targets leave the instruction as it was.
+    REQUIRE_FALSE(as.RetargetBranch(0, base + 4096));
+    REQUIRE_FALSE(as.RetargetBranch(4, base + 4 + 0x80000));
+    REQUIRE(data == expected);
+}
+
+TEST_CASE("Retargeting Calls", "[branch]") {
+    std::array<uint32_t, 2> data{};
+    auto as = MakeAssembler64(data);
+    const auto base = as.GetCodeBuffer().GetOffsetAddress(0);
+
+    as.CALL(0x12345678);
+
+    std::array<uint32_t, 2> expected{};
+    auto expected_as = MakeAssembler64(expected);
+
+    // Within reach of the AUIPC, only the JALR's offset changes.
+    REQUIRE(as.RetargetCall(0, base + 0x12345000));
+    expected_as.CALL(0x12345000);
+    REQUIRE(data == expected);
+
+    // Otherwise the JALR becomes a JAL relative to itself.
+    REQUIRE(as.RetargetCall(0, base + 0x1004));
+    expected_as.RewindBuffer();
+    expected_as.AUIPC(x1, 0x12345);
+    expected_as.JAL(x1, 0x1000);
+    REQUIRE(data == expected);
+
+    // And back again.
+    REQUIRE(as.RetargetCall(0, base + 0x123457FF));
+    expected_as.RewindBuffer();
+    expected_as.AUIPC(x1, 0x12345);
+    expected_as.JALR(x1, 0x7FF, x1);
+    REQUIRE(data == expected);
+
+    REQUIRE_FALSE(as.RetargetCall(0, base + 0x40000000));
+}
+
+TEST_CASE("Alignment", "[branch]") {
+    alignas(16) std::array<uint32_t, 8> data{};
+    auto as = MakeAssembler64(data);
+
+    // 2-byte gaps are filled with a C.NOP, and the rest with NOPs.
+    as.C_ADDI(x10, 1);
+    as.Align(16);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 16);
+    REQUIRE(data[0] == 0x00010505);
+    REQUIRE(data[1] == 0x00000013);
+    REQUIRE(data[2] == 0x00000013);
+    REQUIRE(data[3] == 0x00000013);
+
+    // Already aligned, so nothing is emitted.
+    as.Align(16);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 16);
+
+    Label label;
+    as.C_NOP();
+    as.BindAligned(&label, 8, AlignFill::Zero);
+    REQUIRE(*label.GetLocation() == 24);
+    REQUIRE(data[4] == 0x00000001);
+    REQUIRE(data[5] == 0x00000000);
+}
+
+TEST_CASE("Resetting", "[branch]") {
+    Assembler as{1024};
+    as.SetRelocationRecording(true);
+    as.SetLiteralPool(true);
+
+    const auto* const buffer = as.GetBufferPointer(0);
+
+    // Leave behind an unresolved label, a pending literal and recorded relocations.
+    auto* const label = as.NewLabel();
+    as.J(label);
+    as.LI(x5, 0x123456789ABCDEF0);
+    as.Cold([] {});
+    REQUIRE(as.GetLabelCount() == 1);
+    REQUIRE(as.GetPendingLiteralCount() == 1);
+    REQUIRE(as.GetPendingColdBlockCount() == 1);
+    REQUIRE(!as.GetRelocations().empty());
+
+    as.Reset();
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 0);
+    REQUIRE(as.GetBufferPointer(0) == buffer);
+    REQUIRE(as.GetLabelCount() == 0);
+    REQUIRE(as.GetPendingLiteralCount() == 0);
+    REQUIRE(as.GetPendingColdBlockCount() == 0);
+    REQUIRE(as.GetRelocations().empty());
+
+    // Settings are kept, and emission starts afresh.
+    REQUIRE(as.IsRecordingRelocations());
+    REQUIRE(as.IsLiteralPoolEnabled());
+
+    auto* const reused = as.NewLabel();
+    REQUIRE(reused == label);
+    as.J(reused);
+    as.Bind(reused);
+
+    uint32_t jump = 0;
+    std::memcpy(&jump, buffer, sizeof(jump));
+    REQUIRE(jump == 0x0040006F);
+}
+
+TEST_CASE("Resetting (Pending Relaxations)", "[branch]") {
+    Assembler as{1024};
+    as.SetBranchRelaxation(true);
+
+    as.BEQ(x1, x2, as.NewLabel());
+    as.Reset();
+
+    // Nothing from before the reset is left to be relaxed or patched.
+    Label target;
+    as.BEQ(x1, x2, &target);
+    as.Bind(&target);
+
+    uint32_t branch = 0;
+    std::memcpy(&branch, as.GetBufferPointer(0), sizeof(branch));
+    REQUIRE(branch == 0x00208263);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 4);
+}
+
+TEST_CASE("Cold Sections", "[branch]") {
+    std::array<uint32_t, 4> data{};
+    auto as = MakeAssembler64(data);
+
+    Label slow_path;
+    Label resume;
+    as.BNEZ(x10, &slow_path);
+    as.Cold([&] {
+        as.Bind(&slow_path);
+        as.LI(x10, 1);
+        as.J(&resume);
+    });
+    as.Bind(&resume);
+    as.RET();
+    REQUIRE(as.GetPendingColdBlockCount() == 1);
+
+    const auto range = as.FlushColdSection();
+    REQUIRE(range.offset == 8);
+    REQUIRE(range.size == 8);
+    REQUIRE(as.GetPendingColdBlockCount() == 0);
+
+    std::array<uint32_t, 4> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BNEZ(x10, 8);
+    expected_as.RET();
+    expected_as.LI(x10, 1);
+    expected_as.J(-8);
+    REQUIRE(data == expected);
+
+    // With nothing deferred, the section is empty.
+    const auto empty = as.FlushColdSection();
+    REQUIRE(empty.offset == 16);
+    REQUIRE(empty.size == 0);
+}
+
+TEST_CASE("Cold Sections (Nested Blocks)", "[branch]") {
+    std::array<uint32_t, 3> data{};
+    auto as = MakeAssembler64(data);
+
+    Label first;
+    Label second;
+    as.J(&first);
+    as.Cold([&] {
+        as.Bind(&first);
+        as.Cold([&] {
+            as.Bind(&second);
+            as.RET();
+        });
+        as.J(&second);
+    });
+
+    const auto range = as.FlushColdSection();
+    REQUIRE(range.offset == 4);
+    REQUIRE(range.size == 8);
+    REQUIRE(as.GetPendingColdBlockCount() == 0);
+
+    REQUIRE(data[0] == 0x0040006F);
+    REQUIRE(data[1] == 0x0040006F);
+    REQUIRE(data[2] == 0x00008067);
+}
+
+TEST_CASE("Cold Sections (Relaxed Far)", "[branch]") {
+    std::vector<uint32_t> data(0x50000);
+    Assembler as{reinterpret_cast<uint8_t*>(data.data()), data.size() * sizeof(uint32_t)};
+    as.SetBranchRelaxation(true, t6);
+
+    Label slow_path;
+    as.BNEZ(x10, &slow_path);
+    as.Cold([&] {
+        as.Bind(&slow_path);
+        as.RET();
+    });
+    for (int i = 0; i < 0x40000; i++) {
+        as.NOP();
+    }
+    as.RET();
+    as.FlushColdSection();
+
+    // The hot branch is relaxed to reach the cold section past all of the hot code.
+    std::array<uint32_t, 3> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BEQ(x0, x10, 12);
+    expected_as.AUIPC(t6, 256);
+    expected_as.JALR(x0, 12, t6);
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(data[i] == expected[i]);
+    }
+    REQUIRE(as.GetLabelLocation(&slow_path) == 0x100010);
+}
@@ -0,0 +1,171 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_blob.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Reserved regions start out as NOPs", "[region]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler64(value);
+
+    Label region_label;
+    as.NOP();
+    const auto region = as.ReserveRegion(&region_label, 16);
+    as.EBREAK();
+
+    REQUIRE(region.offset == 4);
+    REQUIRE(region.size == 16);
+    REQUIRE(*region_label.GetLocation() == 4);
+
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    for (size_t i = 0; i < 5; i++) {
+        expected_as.NOP();
+    }
+    expected_as.EBREAK();
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Reassembled regions reference labels on both sides", "[region]") {
+    std::array<uint32_t, 16> value{};
+    auto as = MakeAssembler64(value);
+
+    Label before;
+    Label after;
+    as.Bind(&before);
+    as.NOP();
+    const auto region = as.ReserveRegion(nullptr, 32);
+    as.Bind(&after);
+    as.J(&before);
+
+    as.ReassembleRegion(region, [&](Assembler& region_as) {
+        REQUIRE(region_as.GetCodeBuffer().GetCursorOffset() == 4);
+        REQUIRE(region_as.GetCodeBuffer().GetRemainingBytes() == 32);
+
+        Label local;
+        region_as.BEQ(a0, a1, &local);
+        region_as.BNE(a0, a1, &before);
+        region_as.Bind(&local);
+        region_as.J(&after);
+    });
+
+    std::array<uint32_t, 16> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.NOP();
+    expected_as.BEQ(a0, a1, 8);
+    expected_as.BNE(a0, a1, -8);
+    expected_as.J(24);
+    // The rest is jumped over.
+    expected_as.J(20);
+    for (size_t i = 0; i < 4; i++) {
+        expected_as.GetCodeBuffer().Emit32(0);
+    }
+    expected_as.J(-36);
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Reassembled regions can be filled with NOPs", "[region]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler64(value);
+    const auto region = as.ReserveRegion(nullptr, 16);
+    as.EBREAK();
+
+    // Reassembling again only sees the contents of the latest version.
+    as.ReassembleRegion(region, [](Assembler& region_as) {
+        region_as.ADDI(a0, a0, 1);
+        region_as.ADDI(a0, a0, 2);
+        region_as.ADDI(a0, a0, 3);
+    });
+    as.ReassembleRegion(
+        region, [](Assembler& region_as) { region_as.ADDI(a0, a0, 4); }, RegionFill::Nop);
+
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.ADDI(a0, a0, 4);
+    expected_as.NOP();
+    expected_as.NOP();
+    expected_as.NOP();
+    expected_as.EBREAK();
+    REQUIRE(value == expected);
+
+    // Too little room left for a jump to pay off.
+    as.ReassembleRegion(region, [](Assembler& region_as) {
+        region_as.ADDI(a0, a0, 1);
+        region_as.ADDI(a0, a0, 2);
+        region_as.ADDI(a0, a0, 3);
+    });
+
+    expected_as.RewindBuffer();
+    expected_as.ADDI(a0, a0, 1);
+    expected_as.ADDI(a0, a0, 2);
+    expected_as.ADDI(a0, a0, 3);
+    expected_as.NOP();
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Reassembled regions replace their relocations", "[region]") {
+    std::array<uint32_t, 16> value{};
+    auto as = MakeAssembler64(value);
+    as.SetRelocationRecording(true);
+
+    Label target;
+    as.Bind(&target);
+    as.NOP();
+    const auto region = as.ReserveRegion(nullptr, 16);
+    as.J(&target);
+
+    const auto emit = [&](Assembler& region_as) {
+        region_as.CALL(&target);
+    };
+    as.ReassembleRegion(region, emit);
+    as.ReassembleRegion(region, emit);
+
+    // The region's relocations stay in order with the rest.
+    const auto relocations = as.GetRelocations();
+    REQUIRE(relocations.size() == 2);
+    REQUIRE(relocations[0].kind == RelocationKind::PCRelPair);
+    REQUIRE(relocations[0].offset == 4);
+    REQUIRE(relocations[0].label == &target);
+    REQUIRE(relocations[1].kind == RelocationKind::JType);
+    REQUIRE(relocations[1].offset == 20);
+}
+
+TEST_CASE("Reassembled regions don't leak references to their own labels", "[region]") {
+    std::array<uint32_t, 16> value{};
+    auto as = MakeAssembler64(value);
+    as.SetRelocationRecording(true);
+
+    Label target;
+    const auto region = as.ReserveRegion(nullptr, 32);
+    as.Bind(&target);
+    as.RET();
+
+    as.ReassembleRegion(region, [&](Assembler& region_as) {
+        Label loop;
+        Label done;
+        region_as.Bind(&loop);
+        region_as.BEQZ(a0, &done);
+        region_as.ADDI(a0, a0, -1);
+        region_as.J(&loop);
+        region_as.Bind(&done);
+        region_as.EmitAddress(&target);
+    });
+
+    const auto relocations = as.GetRelocations();
+    REQUIRE(relocations.size() == 3);
+    REQUIRE(relocations[0].label == nullptr);
+    REQUIRE(relocations[0].target == 12);
+    REQUIRE(relocations[1].label == nullptr);
+    REQUIRE(relocations[1].target == 0);
+    REQUIRE(relocations[2].label == &target);
+
+    const auto blob = SerializeCode(as.GetCodeBuffer(), relocations);
+    CodeBuffer buffer(64);
+    REQUIRE(LoadCode(buffer, blob) == 0);
+    REQUIRE(std::memcmp(buffer.GetOffsetPointer(0), value.data(), 12) == 0);
+}
@@ -43,6 +43,17 @@ TEST_CASE("ADDI", "[rv32i]") {
     REQUIRE(value == 0xFFFF8793);
 }
 
+TEST_CASE("Instruction formats encode in constant expressions", "[rv32i]") {
+    // ADDI x15, x31, 1024
+    STATIC_REQUIRE(EncodeIType(1024, x31, 0b000, x15, 0b0010011) == 0x400F8793);
+    // ADD x7, x15, x31
+    STATIC_REQUIRE(EncodeRType(0b0000000, x31, x15, 0b000, x7, 0b0110011) == 0x01F783B3);
+    // SW x31, 1024(x15)
+    STATIC_REQUIRE(EncodeSType(1024, x31, x15, 0b010, 0b0100011) == 0x41F7A023);
+    // LUI x10, 0xFFFFF
+    STATIC_REQUIRE(EncodeUType(0xFFFFF, x10, 0b0110111) == 0xFFFFF537);
+}
+
 TEST_CASE("AND", "[rv32i]") {
     uint32_t value = 0;
     auto as = MakeAssembler32(value);
@@ -188,6 +199,15 @@ TEST_CASE("CALL", "[rv32i]") {
     compare_vals(0x00000097, 0xFFF080E7);
 }
 
+TEST_CASE("TAIL", "[rv32i]") {
+    std::array<uint32_t, 2> vals{};
+    auto as = MakeAssembler32(vals);
+
+    as.TAIL(-1);
+    REQUIRE(vals[0] == 0x00000317);
+    REQUIRE(vals[1] == 0xFFF30067);
+}
+
 TEST_CASE("EBREAK", "[rv32i]") {
     uint32_t value = 0;
     auto as = MakeAssembler32(value);
@@ -2,6 +2,8 @@
 
 #include <array>
 #include <biscuit/assembler.hpp>
+#include <random>
+#include <vector>
 
 #include "assembler_test_utils.hpp"
 
@@ -222,6 +224,204 @@ TEST_CASE("LI (RV64)", "[rv64i]") {
                  0x01009093U, 0x10108093U, 0x00F09093U, 0x0F108093U);
 }
 
+TEST_CASE("LI (RV64, Shortest Sequence)", "[rv64i]") {
+    std::array<uint32_t, 8> vals{};
+    std::array<uint32_t, 8> expected{};
+    auto as = MakeAssembler64(vals);
+    auto expected_as = MakeAssembler64(expected);
+
+    const auto check = [&] {
+        REQUIRE(vals == expected);
+        as.RewindBuffer();
+        expected_as.RewindBuffer();
+        vals = {};
+        expected = {};
+    };
+
+    // Shifting out leading zeros beats building the value up from the top.
+    as.LI(x5, 0x00000000FFFFFFFF);
+    expected_as.ADDIW(x5, x0, -1);
+    expected_as.SRLI(x5, x5, 32);
+    check();
+
+    as.SetExtensions({Extension::Zbs});
+    as.LI(x5, uint64_t{1} << 40);
+    expected_as.BSETI(x5, x0, 40);
+    check();
+
+    as.LI(x5, 0x8000000000000123);
+    expected_as.ADDIW(x5, x0, 0x123);
+    expected_as.BSETI(x5, x5, 63);
+    check();
+
+    as.SetExtensions({Extension::Zbb});
+    as.LI(x5, 0xF00000000000000F);
+    expected_as.ADDI(x5, x0, 0xFF);
+    expected_as.RORI(x5, x5, 4);
+    check();
+
+    as.SetExtensions({Extension::Zba});
+    as.LI(x5, 0x00000000FFFFF800);
+    expected_as.ADDIW(x5, x0, -2048);
+    expected_as.ADDUW(x5, x5, x0);
+    check();
+
+    as.SetExtensions({Extension::C});
+    as.LI(x10, 5);
+    expected_as.C_LI(x10, 5);
+    check();
+
+    as.LI(x10, 0x1F000);
+    expected_as.C_LUI(x10, 0x1F000);
+    check();
+
+    as.LI(x10, 0x00000000FFFFFFFF);
+    expected_as.C_LI(x10, -1);
+    expected_as.C_SRLI(x10, 32);
+    check();
+}
+
+TEST_CASE("LI (RV64, Randomized)", "[rv64i]") {
+    const std::array<ExtensionSet, 6> extension_sets{{
+        {},
+        {Extension::C},
+        {Extension::Zba},
+        {Extension::Zbb},
+        {Extension::Zbs},
+        {Extension::C, Extension::Zba, Extension::Zbb, Extension::Zbs},
+    }};
+
+    // Fully random constants rarely have the structure the shorter sequences rely on,
+    // so also mix in sparse values, runs of ones and small values shifted into place.
+    std::mt19937_64 rng{0x1234};
+    std::vector<uint64_t> constants;
+    for (uint32_t i = 0; i < 2048; i++) {
+        const auto value = rng();
+        const auto shift = value % 64;
+        constants.push_back(value);
+        constants.push_back(value & rng() & rng());
+        constants.push_back(~uint64_t{0} >> shift << (rng() % 64));
+        constants.push_back((value >> 52) << shift);
+        constants.push_back(static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(value))));
+    }
+
+    std::array<uint32_t, 16> buffer{};
+    auto as = MakeAssembler64(buffer);
+
+    for (const auto& extensions : extension_sets) {
+        as.SetExtensions(extensions);
+
+        for (const auto constant : constants) {
+            as.RewindBuffer();
+            as.LI(x10, constant);
+
+            std::array<uint64_t, 32> x{};
+            Interpret(GetEmittedCode(as), extensions, x);
+            REQUIRE(x[x10.Index()] == constant);
+        }
+    }
+}
+
+TEST_CASE("LI (RV64, Literal Pool)", "[rv64i]") {
+    constexpr uint64_t constant = 0x123456789ABCDEF0;
+
+    alignas(8) std::array<uint32_t, 16> vals{};
+    auto as = MakeAssembler64(vals);
+    as.SetLiteralPool(true);
+
+    // Long sequences are loaded from the pool, and identical constants share an entry.
+    as.LI(x5, constant);
+    as.LI(x6, constant);
+    as.LI(x7, 42);
+    REQUIRE(as.GetPendingLiteralCount() == 1);
+    as.RET();
+    as.FlushLiteralPool(false);
+    REQUIRE(as.GetPendingLiteralCount() == 0);
+
+    alignas(8) std::array<uint32_t, 16> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.AUIPC(x5, 0);
+    expected_as.LD(x5, 24, x5);
+    expected_as.AUIPC(x6, 0);
+    expected_as.LD(x6, 16, x6);
+    expected_as.ADDIW(x7, x0, 42);
+    expected_as.RET();
+    expected_as.GetCodeBuffer().Emit(constant);
+
+    REQUIRE(vals == expected);
+}
+
+TEST_CASE("LI (RV64, Literal Pool Branch Over and Reuse)", "[rv64i]") {
+    constexpr uint64_t constant = 0x123456789ABCDEF0;
+
+    alignas(8) std::array<uint32_t, 16> vals{};
+    auto as = MakeAssembler64(vals);
+    as.SetLiteralPool(true);
+
+    as.LI(x5, constant);
+    as.FlushLiteralPool();
+    as.LI(x6, constant);
+    REQUIRE(as.GetPendingLiteralCount() == 0);
+
+    alignas(8) std::array<uint32_t, 16> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.AUIPC(x5, 0);
+    expected_as.LD(x5, 16, x5);
+    expected_as.J(16);
+    expected_as.GetCodeBuffer().Emit32(0);
+    expected_as.GetCodeBuffer().Emit(constant);
+    expected_as.AUIPC(x6, 0);
+    expected_as.LD(x6, -8, x6);
+
+    REQUIRE(vals == expected);
+}
+
+TEST_CASE("LI (RV64, Literal Pool Automatic Flush)", "[rv64i]") {
+    constexpr uint64_t constant_a = 0x123456789ABCDEF0;
+    constexpr uint64_t constant_b = 0x0FEDCBA987654321;
+
+    alignas(8) std::array<uint32_t, 16> vals{};
+    auto as = MakeAssembler64(vals);
+    as.SetLiteralPool(true, Assembler::literal_pool_default_max_inline, 8);
+
+    as.LI(x5, constant_a);
+    as.NOP();
+    as.LI(x6, constant_b);
+    REQUIRE(as.GetPendingLiteralCount() == 1);
+    as.FlushLiteralPool(false);
+
+    alignas(8) std::array<uint32_t, 16> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.AUIPC(x5, 0);
+    expected_as.LD(x5, 16, x5);
+    expected_as.NOP();
+    expected_as.J(12);
+    expected_as.GetCodeBuffer().Emit(constant_a);
+    expected_as.AUIPC(x6, 0);
+    expected_as.LD(x6, 8, x6);
+    expected_as.GetCodeBuffer().Emit(constant_b);
+
+    REQUIRE(vals == expected);
+}
+
+TEST_CASE("LI (RV64, Literal Pool Limits)", "[rv64i]") {
+    std::array<uint32_t, 8> vals{};
+    auto as = MakeAssembler64(vals);
+
+    // Sequences within the limit are always emitted inline.
+    as.SetLiteralPool(true, 8);
+    as.LI(x5, 0x123456789ABCDEF0);
+    REQUIRE(as.GetPendingLiteralCount() == 0);
+
+    // Discarded references don't keep literals around.
+    as.RewindBuffer();
+    as.SetLiteralPool(true);
+    as.LI(x5, 0x123456789ABCDEF0);
+    REQUIRE(as.GetPendingLiteralCount() == 1);
+    as.RewindBuffer();
+    REQUIRE(as.GetPendingLiteralCount() == 0);
+}
+
 TEST_CASE("SD", "[rv64i]") {
     uint32_t value = 0;
     auto as = MakeAssembler64(value);
@@ -1,5 +1,7 @@
 #include <catch/catch.hpp>
 
+#include <array>
+#include <utility>
 #include <biscuit/assembler.hpp>
 
 #include "assembler_test_utils.hpp"
@@ -5332,3 +5334,87 @@ TEST_CASE("VSETVLI", "[rvv]") {
     as.VSETVLI(x15, x12, SEW::E32, LMUL::M4, VTA::No, VMA::No);
     REQUIRE(value == 0x012677D7);
 }
+
+TEST_CASE("VSETIVLI redundancy elimination", "[rvv]") {
+    std::array<uint32_t, 8> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetVTypeTracking(true);
+    REQUIRE(as.IsVTypeTrackingEnabled());
+
+    as.VSETIVLI(x0, 16, SEW::E32, LMUL::M1);
+    as.VSETIVLI(x0, 16, SEW::E32, LMUL::M1);
+    REQUIRE(code.GetSizeInBytes() == 4);
+
+    // Same SEW/LMUL ratio, so only vtype has to change.
+    as.VSETIVLI(x0, 16, SEW::E64, LMUL::M2);
+    REQUIRE(code.GetSizeInBytes() == 8);
+    REQUIRE(buffer[1] == 0x01907057);
+
+    // A different ratio or AVL needs a full reconfiguration.
+    as.VSETIVLI(x0, 16, SEW::E8, LMUL::M2);
+    as.VSETIVLI(x0, 8, SEW::E8, LMUL::M2);
+    REQUIRE(code.GetSizeInBytes() == 16);
+
+    // Writing vl to a register is never skipped.
+    as.VSETIVLI(x10, 8, SEW::E8, LMUL::M2);
+    REQUIRE(code.GetSizeInBytes() == 20);
+}
+
+TEST_CASE("VSETVLI redundancy elimination", "[rvv]") {
+    std::array<uint32_t, 8> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetVTypeTracking(true);
+
+    as.VSETVLI(x10, x11, SEW::E16, LMUL::M4);
+    as.VSETVLI(x0, x0, SEW::E16, LMUL::M4);
+    REQUIRE(code.GetSizeInBytes() == 4);
+
+    // vl isn't known, so VSETIVLI can't be skipped.
+    as.VSETIVLI(x0, 4, SEW::E16, LMUL::M4);
+    REQUIRE(code.GetSizeInBytes() == 8);
+
+    // Keeping vl with the same ratio keeps it known.
+    as.VSETVLI(x0, x0, SEW::E8, LMUL::M2);
+    as.VSETIVLI(x0, 4, SEW::E8, LMUL::M2);
+    REQUIRE(code.GetSizeInBytes() == 12);
+}
+
+TEST_CASE("Vector configuration invalidation", "[rvv]") {
+    std::array<uint32_t, 16> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetVTypeTracking(true);
+
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    Label label;
+    as.Bind(&label);
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    REQUIRE(code.GetSizeInBytes() == 8);
+
+    as.CALL(0x100);
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    REQUIRE(code.GetSizeInBytes() == 20);
+
+    as.VLE32FF(v8, x10);
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    REQUIRE(code.GetSizeInBytes() == 28);
+
+    as.InvalidateVTypeState();
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    REQUIRE(code.GetSizeInBytes() == 32);
+
+    // Code in another buffer may run with any configuration.
+    std::array<uint32_t, 4> other{};
+    auto old_buffer = as.SwapCodeBuffer(CodeBuffer{reinterpret_cast<uint8_t*>(other.data()), sizeof(other)});
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 4);
+    as.SwapCodeBuffer(std::move(old_buffer));
+
+    // Nothing is elided without tracking.
+    as.SetVTypeTracking(false);
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    as.VSETIVLI(x0, 8, SEW::E32, LMUL::M1);
+    REQUIRE(code.GetSizeInBytes() == 40);
+}
@@ -0,0 +1,250 @@
+#include <catch/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_blob.hpp>
+#include <biscuit/tuning.hpp>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+constexpr std::array extension_sets{
+    ExtensionSet{},
+    ExtensionSet{Extension::Zicond},
+    ExtensionSet{Extension::Zbb},
+    ExtensionSet{Extension::Zbb, Extension::Zicond},
+};
+
+// Without a model, and for a core that turns short forward branches into predicated moves.
+const std::array<const TuningModel*, 2> tuning_models{
+    nullptr,
+    &GetTuningModel(TuningCore::SiFiveU74),
+};
+
+// Operands are picked from a small pool of registers, so every way of aliasing them is covered.
+constexpr std::array operand_pool{x10, x11, x12};
+constexpr GPR scratch = x5;
+
+constexpr std::array<uint64_t, 6> test_values{
+    0,
+    1,
+    7,
+    std::numeric_limits<uint64_t>::max(),
+    uint64_t{1} << 63,
+    (uint64_t{1} << 63) - 1,
+};
+
+using Emitter = std::function<void(Assembler&, GPR, GPR, GPR, GPR)>;
+using Predicate = std::function<bool(uint64_t, uint64_t, uint64_t)>;
+using Evaluator = std::function<uint64_t(uint64_t, uint64_t, uint64_t)>;
+
+// Checks an operation against a reference for every aliasing of its
+// operands, with every combination of test values in them.
+void CheckOperation(size_t operand_count, const Emitter& emit, const Evaluator& expected,
+                    const Predicate& valid = [](uint64_t, uint64_t, uint64_t) { return true; }) {
+    size_t combinations = 1;
+    for (size_t i = 0; i < operand_count; i++) {
+        combinations *= operand_pool.size();
+    }
+
+    for (const auto* const tuning : tuning_models) {
+        for (const auto& extensions : extension_sets) {
+            for (size_t combination = 0; combination < combinations; combination++) {
+                std::array<GPR, 4> ops{x0, x0, x0, x0};
+                auto index = combination;
+                for (size_t i = 0; i < operand_count; i++) {
+                    ops[i] = operand_pool[index % operand_pool.size()];
+                    index /= operand_pool.size();
+                }
+
+                std::array<uint32_t, 32> buffer{};
+                auto as = MakeAssembler64(buffer);
+                as.SetExtensions(extensions);
+                as.SetTuningModel(tuning);
+                emit(as, ops[0], ops[1], ops[2], ops[3]);
+
+                const auto code = GetEmittedCode(as);
+
+                for (const auto v0 : test_values) {
+                    for (const auto v1 : test_values) {
+                        for (const auto v2 : test_values) {
+                            std::array<uint64_t, 32> x{};
+                            x[operand_pool[0].Index()] = v0;
+                            x[operand_pool[1].Index()] = v1;
+                            x[operand_pool[2].Index()] = v2;
+                            x[scratch.Index()] = 0xDEADBEEF;
+
+                            const auto in1 = x[ops[1].Index()];
+                            const auto in2 = x[ops[2].Index()];
+                            const auto in3 = x[ops[3].Index()];
+                            if (!valid(in1, in2, in3)) {
+                                continue;
+                            }
+
+                            REQUIRE(Interpret(code, extensions, x) == code.size());
+
+                            const auto result = x[ops[0].Index()];
+                            const auto want = expected(in1, in2, in3);
+                            if (result != want) {
+                                INFO("rd=" << ops[0].Index() << " ops=" << ops[1].Index() << "," << ops[2].Index()
+                                           << "," << ops[3].Index() << " inputs=" << in1 << "," << in2 << ","
+                                           << in3 << " Zicond=" << extensions.Has(Extension::Zicond)
+                                           << " Zbb=" << extensions.Has(Extension::Zbb)
+                                           << " tuning=" << (tuning != nullptr ? tuning->name : "none"));
+                                REQUIRE(result == want);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int64_t Signed(uint64_t value) {
+    return static_cast<int64_t>(value);
+}
+} // Anonymous namespace
+
+TEST_CASE("SELECT", "[select]") {
+    CheckOperation(
+        4, [](Assembler& as, GPR rd, GPR cond, GPR a, GPR b) { as.SELECT(rd, cond, a, b, scratch); },
+        [](uint64_t cond, uint64_t a, uint64_t b) { return cond != 0 ? a : b; });
+}
+
+TEST_CASE("SELECT_MIN/SELECT_MAX", "[select]") {
+    CheckOperation(
+        3, [](Assembler& as, GPR rd, GPR a, GPR b, GPR) { as.SELECT_MIN(rd, a, b, scratch); },
+        [](uint64_t a, uint64_t b, uint64_t) { return static_cast<uint64_t>(std::min(Signed(a), Signed(b))); });
+    CheckOperation(
+        3, [](Assembler& as, GPR rd, GPR a, GPR b, GPR) { as.SELECT_MAX(rd, a, b, scratch); },
+        [](uint64_t a, uint64_t b, uint64_t) { return static_cast<uint64_t>(std::max(Signed(a), Signed(b))); });
+    CheckOperation(
+        3, [](Assembler& as, GPR rd, GPR a, GPR b, GPR) { as.SELECT_MINU(rd, a, b, scratch); },
+        [](uint64_t a, uint64_t b, uint64_t) { return std::min(a, b); });
+    CheckOperation(
+        3, [](Assembler& as, GPR rd, GPR a, GPR b, GPR) { as.SELECT_MAXU(rd, a, b, scratch); },
+        [](uint64_t a, uint64_t b, uint64_t) { return std::max(a, b); });
+}
+
+TEST_CASE("CLAMP/CLAMPU", "[select]") {
+    CheckOperation(
+        4, [](Assembler& as, GPR rd, GPR rs, GPR lo, GPR hi) { as.CLAMP(rd, rs, lo, hi, scratch); },
+        [](uint64_t rs, uint64_t lo, uint64_t hi) {
+            return static_cast<uint64_t>(std::clamp(Signed(rs), Signed(lo), Signed(hi)));
+        },
+        [](uint64_t, uint64_t lo, uint64_t hi) { return Signed(lo) <= Signed(hi); });
+    CheckOperation(
+        4, [](Assembler& as, GPR rd, GPR rs, GPR lo, GPR hi) { as.CLAMPU(rd, rs, lo, hi, scratch); },
+        [](uint64_t rs, uint64_t lo, uint64_t hi) { return std::clamp(rs, lo, hi); },
+        [](uint64_t, uint64_t lo, uint64_t hi) { return lo <= hi; });
+}
+
+TEST_CASE("SATURATING_ADDU/SATURATING_SUBU", "[select]") {
+    CheckOperation(
+        3, [](Assembler& as, GPR rd, GPR a, GPR b, GPR) { as.SATURATING_ADDU(rd, a, b, scratch); },
+        [](uint64_t a, uint64_t b, uint64_t) { return a + b < a ? std::numeric_limits<uint64_t>::max() : a + b; });
+    CheckOperation(
+        3, [](Assembler& as, GPR rd, GPR a, GPR b, GPR) { as.SATURATING_SUBU(rd, a, b, scratch); },
+        [](uint64_t a, uint64_t b, uint64_t) { return a < b ? 0 : a - b; });
+}
+
+TEST_CASE("Branchless Sequence Selection", "[select]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler64(value);
+
+    // Zicond selects with a CZERO pair.
+    as.SetExtensions({Extension::Zicond});
+    as.SELECT(x10, x11, x12, x13, x5);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 12);
+
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.CZERO_EQZ(x5, x12, x11);
+    expected_as.CZERO_NEZ(x10, x13, x11);
+    expected_as.OR(x10, x10, x5);
+    REQUIRE(value == expected);
+
+    // Zbb covers min/max directly.
+    as.RewindBuffer();
+    expected_as.RewindBuffer();
+    value.fill(0);
+    expected.fill(0);
+
+    as.SetExtensions({Extension::Zbb});
+    as.SELECT_MINU(x10, x11, x12, x5);
+    as.CLAMP(x10, x10, x11, x12, x5);
+    expected_as.MINU(x10, x11, x12);
+    expected_as.MAX(x10, x10, x11);
+    expected_as.MIN(x10, x10, x12);
+    REQUIRE(value == expected);
+
+    // Selecting between a register and itself is just a move.
+    as.RewindBuffer();
+    as.SELECT(x10, x11, x10, x10, x5);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 0);
+}
+
+TEST_CASE("Short Forward Branch Selection", "[select]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler64(value);
+    as.SetTuningModel(&GetTuningModel(TuningCore::SiFiveU74));
+
+    // Branches are preferred over CZERO pairs, and skip the move that isn't wanted.
+    as.SetExtensions({Extension::Zicond});
+    as.SELECT(x10, x11, x12, x13, x5);
+    as.SELECT(x10, x11, x10, x13, x5);
+
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.MV(x10, x13);
+    expected_as.BEQZ(x11, 8);
+    expected_as.MV(x10, x12);
+    expected_as.BNEZ(x11, 8);
+    expected_as.MV(x10, x13);
+    REQUIRE(value == expected);
+
+    // Zbb's min/max are still shorter.
+    as.RewindBuffer();
+    as.SetExtensions({Extension::Zbb});
+    as.SELECT_MIN(x10, x11, x12, x5);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 4);
+
+    // Without the fusion, nothing branches.
+    as.RewindBuffer();
+    as.SetExtensions({});
+    as.SetTuningModel(&GetTuningModel(TuningCore::THeadC910));
+    as.SELECT(x10, x11, x12, x13, x5);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 20);
+}
+
+TEST_CASE("Short Forward Branch Selection (Relocations)", "[select]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler64(value);
+    as.SetTuningModel(&GetTuningModel(TuningCore::SiFiveU74));
+    as.SetRelocationRecording(true);
+
+    // The branches over the moves don't refer to anything that outlives the macro-op.
+    as.SELECT(x10, x11, x12, x13, x5);
+    as.SELECT(x10, x11, x10, x13, x5);
+
+    const auto relocations = as.GetRelocations();
+    REQUIRE(relocations.size() == 2);
+    REQUIRE(relocations[0].label == nullptr);
+    REQUIRE(relocations[0].target == 12);
+    REQUIRE(relocations[1].label == nullptr);
+    REQUIRE(relocations[1].target == 20);
+
+    const auto blob = SerializeCode(as.GetCodeBuffer(), relocations);
+    CodeBuffer buffer(64);
+    REQUIRE(LoadCode(buffer, blob) == 0);
+    REQUIRE(std::memcmp(buffer.GetOffsetPointer(0), value.data(), 20) == 0);
+}
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <catch/catch.hpp>
+
+#include <algorithm>
+#include <array>
 #include <biscuit/assembler.hpp>
+#include <biscuit/decoder.hpp>
 #include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
 
 namespace biscuit {
 
@@ -20,4 +28,169 @@ inline Assembler MakeAssembler128(T& buffer) {
     return Assembler{reinterpret_cast<uint8_t*>(&buffer), sizeof(buffer), ArchFeature::RV128};
 }
 
+/// Reads a value from possibly unaligned memory.
+template <typename T>
+inline T ReadValue(const uint8_t* ptr) {
+    T value{};
+    std::memcpy(&value, ptr, sizeof(T));
+    return value;
+}
+
+/// Reads a value at the given offset within a code buffer.
+template <typename T>
+inline T ReadValue(CodeBuffer& buffer, ptrdiff_t offset) {
+    return ReadValue<T>(buffer.GetOffsetPointer(offset));
+}
+
+/// Reads a value at the given offset within some bytes.
+template <typename T>
+inline T ReadValue(std::span<const uint8_t> data, size_t offset) {
+    REQUIRE(offset + sizeof(T) <= data.size());
+    return ReadValue<T>(data.data() + offset);
+}
+
+/// Reads a 32-bit word, with the same arguments as ReadValue().
+template <typename... Args>
+inline uint32_t ReadWord(Args&&... args) {
+    return ReadValue<uint32_t>(std::forward<Args>(args)...);
+}
+
+/**
+ * Just enough of an RV64 interpreter to run the code the macro-ops emit, with
+ * addresses being offsets into the code.
+ *
+ * Runs until it reaches an EBREAK or the end of the code, and returns the offset
+ * it stopped at. Registers are read from and left in `x`.
+ */
+inline size_t Interpret(std::span<const uint8_t> code, ExtensionSet extensions,
+                        std::array<uint64_t, 32>& x) {
+    const Decoder decoder{ArchFeature::RV64, extensions};
+
+    size_t pc = 0;
+    for (size_t steps = 0; steps < 1000; steps++) {
+        if (pc == code.size()) {
+            return pc;
+        }
+        if (pc > code.size()) {
+            FAIL("Control left the code at offset " << pc);
+        }
+
+        const auto insn = decoder.Decode(code.subspan(pc));
+        if (!insn) {
+            FAIL("Undecodable instruction at offset " << pc);
+        }
+
+        const auto lhs = x[insn->rs1];
+        const auto rhs = x[insn->rs2];
+        const auto slhs = static_cast<int64_t>(lhs);
+        const auto srhs = static_cast<int64_t>(rhs);
+        const auto imm = static_cast<uint64_t>(insn->imm);
+        const auto shamt = imm & 63;
+
+        uint64_t result = 0;
+        auto next = pc + insn->length;
+        const auto branch = [&](bool taken) {
+            if (taken) {
+                next = pc + imm;
+            }
+        };
+
+        const auto& m = insn->mnemonic;
+        if (m == "ebreak") {
+            return pc;
+        } else if (m == "lui" || m == "c.lui" || m == "c.li") {
+            result = imm;
+        } else if (m == "auipc") {
+            result = pc + imm;
+        } else if (m == "addi" || m == "c.addi") {
+            result = lhs + imm;
+        } else if (m == "addiw" || m == "c.addiw") {
+            result = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(lhs + imm)));
+        } else if (m == "slli" || m == "c.slli") {
+            result = lhs << shamt;
+        } else if (m == "srli" || m == "c.srli") {
+            result = lhs >> shamt;
+        } else if (m == "xori") {
+            result = lhs ^ imm;
+        } else if (m == "add") {
+            result = lhs + rhs;
+        } else if (m == "sub") {
+            result = lhs - rhs;
+        } else if (m == "and") {
+            result = lhs & rhs;
+        } else if (m == "or") {
+            result = lhs | rhs;
+        } else if (m == "xor") {
+            result = lhs ^ rhs;
+        } else if (m == "slt") {
+            result = slhs < srhs;
+        } else if (m == "sltu") {
+            result = lhs < rhs;
+        } else if (m == "min") {
+            result = static_cast<uint64_t>(std::min(slhs, srhs));
+        } else if (m == "max") {
+            result = static_cast<uint64_t>(std::max(slhs, srhs));
+        } else if (m == "minu") {
+            result = std::min(lhs, rhs);
+        } else if (m == "maxu") {
+            result = std::max(lhs, rhs);
+        } else if (m == "czero.eqz") {
+            result = rhs == 0 ? 0 : lhs;
+        } else if (m == "czero.nez") {
+            result = rhs != 0 ? 0 : lhs;
+        } else if (m == "add.uw") {
+            result = (lhs & 0xFFFFFFFF) + rhs;
+        } else if (m == "sh1add") {
+            result = (lhs << 1) + rhs;
+        } else if (m == "sh2add") {
+            result = (lhs << 2) + rhs;
+        } else if (m == "sh3add") {
+            result = (lhs << 3) + rhs;
+        } else if (m == "rori") {
+            result = shamt == 0 ? lhs : (lhs >> shamt) | (lhs << (64 - shamt));
+        } else if (m == "bseti") {
+            result = lhs | (uint64_t{1} << shamt);
+        } else if (m == "bclri") {
+            result = lhs & ~(uint64_t{1} << shamt);
+        } else if (m == "lw") {
+            int32_t word = 0;
+            REQUIRE(lhs + imm + sizeof(word) <= code.size());
+            std::memcpy(&word, code.data() + lhs + imm, sizeof(word));
+            result = static_cast<uint64_t>(static_cast<int64_t>(word));
+        } else if (m == "beq") {
+            branch(lhs == rhs);
+        } else if (m == "bne") {
+            branch(lhs != rhs);
+        } else if (m == "blt") {
+            branch(slhs < srhs);
+        } else if (m == "bge") {
+            branch(slhs >= srhs);
+        } else if (m == "bltu") {
+            branch(lhs < rhs);
+        } else if (m == "bgeu") {
+            branch(lhs >= rhs);
+        } else if (m == "jal") {
+            result = next;
+            next = pc + imm;
+        } else if (m == "jalr") {
+            result = next;
+            next = lhs + imm;
+        } else {
+            FAIL("Unexpected instruction " << m);
+        }
+
+        x[insn->rd] = result;
+        x[0] = 0;
+        pc = next;
+    }
+
+    FAIL("Code didn't terminate");
+    return 0;
+}
+
+/// Retrieves all code emitted by an assembler so far, for Interpret().
+inline std::span<const uint8_t> GetEmittedCode(Assembler& as) {
+    return {as.GetBufferPointer(0), static_cast<size_t>(as.GetCodeBuffer().GetCursorOffset())};
+}
+
 } // namespace biscuit
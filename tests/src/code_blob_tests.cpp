@@ -0,0 +1,199 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_blob.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+struct BlobSource {
+    std::array<uint32_t, 16> buffer{};
+    Assembler as = MakeAssembler64(buffer);
+    Label internal;
+    Label external;
+    std::vector<uint8_t> blob;
+
+    explicit BlobSource(uint64_t tag = 0) {
+        as.SetRelocationRecording(true);
+
+        as.BEQ(a0, a1, &internal);  // Internal and PC-relative. Not stored.
+        as.LA(a2, &external);       // External.
+        as.Bind(&internal);
+        as.RET();
+        as.NOP();
+        as.EmitAddress(&internal);  // Internal, but absolute.
+        as.Bind(&external);
+
+        blob = SerializeCode(as.GetCodeBuffer(), as.GetRelocations(),
+                             [this](const Label* label) -> std::optional<uint32_t> {
+                                 if (label == &external) {
+                                     return 7;
+                                 }
+                                 return std::nullopt;
+                             },
+                             tag);
+    }
+};
+} // Anonymous namespace
+
+TEST_CASE("Code blobs round trip", "[code_blob]") {
+    BlobSource source;
+
+    CodeBuffer buffer(256);
+    buffer.Emit32(0);
+
+    // Kept nearby, so it's within reach of the AUIPC pair.
+    const auto symbol_address = buffer.GetOffsetAddress(0) + 0x12345;
+
+    const auto offset = LoadCode(buffer, source.blob, [&](uint32_t id) -> uintptr_t {
+        REQUIRE(id == 7);
+        return symbol_address;
+    });
+
+    REQUIRE(offset == 4);
+    REQUIRE(buffer.GetSizeInBytes() == 4 + source.as.GetCodeBuffer().GetSizeInBytes());
+
+    const auto* code = buffer.GetOffsetPointer(4);
+    const auto code_address = buffer.GetOffsetAddress(4);
+
+    // The branch is copied as-is.
+    REQUIRE(ReadWord(code) == source.buffer[0]);
+
+    // The AUIPC pair now refers to the external symbol.
+    const auto auipc = ReadWord(code + 4);
+    const auto addi = ReadWord(code + 8);
+    const auto hi = static_cast<int64_t>(static_cast<int32_t>(auipc & 0xFFFFF000));
+    const auto lo = static_cast<int64_t>(static_cast<int32_t>(addi) >> 20);
+    REQUIRE(code_address + 4 + hi + lo == symbol_address);
+
+    // The absolute address now refers to the new location of the code.
+    uint64_t address = 0;
+    std::memcpy(&address, code + 20, sizeof(address));
+    REQUIRE(address == code_address + 12);
+}
+
+TEST_CASE("Code blobs without address-dependent relocations", "[code_blob]") {
+    std::array<uint32_t, 4> source_buffer{};
+    auto as = MakeAssembler64(source_buffer);
+    as.SetRelocationRecording(true);
+
+    Label label;
+    as.Bind(&label);
+    as.ADDI(a0, a0, 1);
+    as.J(&label);
+
+    const auto blob = SerializeCode(as.GetCodeBuffer(), as.GetRelocations());
+
+    CodeBuffer buffer(64);
+    REQUIRE(LoadCode(buffer, blob) == 0);
+    REQUIRE(buffer.GetSizeInBytes() == 8);
+    REQUIRE(std::memcmp(buffer.GetOffsetPointer(0), source_buffer.data(), 8) == 0);
+}
+
+TEST_CASE("Code blobs of code with library-internal labels", "[code_blob]") {
+    alignas(8) std::array<uint32_t, 128> buffer{};
+    auto as = MakeAssembler64(buffer);
+    as.SetRelocationRecording(true);
+    as.SetLiteralPool(true);
+
+    // Enough literals for the pool's storage to move around as it grows.
+    for (uint64_t i = 0; i < 16; i++) {
+        as.LI(a0, 0x123456789ABCDEF0 + i);
+    }
+    as.FlushLiteralPool();
+    as.RET();
+
+    const auto blob = SerializeCode(as.GetCodeBuffer(), as.GetRelocations());
+
+    CodeBuffer load(1024);
+    REQUIRE(LoadCode(load, blob) == 0);
+    REQUIRE(std::memcmp(load.GetOffsetPointer(0), buffer.data(), as.GetCodeBuffer().GetSizeInBytes()) == 0);
+}
+
+TEST_CASE("Code blobs ending in a compressed jump", "[code_blob]") {
+    std::array<uint16_t, 3> source_buffer{};
+    auto as = MakeAssembler64(source_buffer);
+    as.SetRelocationRecording(true);
+
+    // The C.J only occupies the last two bytes of the code.
+    Label external;
+    as.ADDI(a0, a0, 1);
+    as.C_J(&external);
+    as.Bind(&external);
+
+    const auto blob = SerializeCode(as.GetCodeBuffer(), as.GetRelocations(),
+                                    [&](const Label* label) -> std::optional<uint32_t> {
+                                        if (label == &external) {
+                                            return 0;
+                                        }
+                                        return std::nullopt;
+                                    });
+
+    CodeBuffer buffer(64);
+    const auto offset = LoadCode(buffer, blob, [&](uint32_t) -> uintptr_t {
+        return buffer.GetOffsetAddress(0) + 0x24;
+    });
+    REQUIRE(offset == 0);
+    REQUIRE(buffer.GetSizeInBytes() == 6);
+
+    std::array<uint16_t, 3> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.ADDI(a0, a0, 1);
+    expected_as.C_J(0x24 - 4);
+    REQUIRE(std::memcmp(buffer.GetOffsetPointer(0), expected.data(), 6) == 0);
+}
+
+TEST_CASE("Code blobs are rejected by fixed buffers without room for them", "[code_blob]") {
+    BlobSource source;
+
+    std::array<uint8_t, 16> storage{};
+    CodeBuffer buffer(storage.data(), storage.size());
+    const auto resolve = [&](uint32_t) -> uintptr_t { return buffer.GetOffsetAddress(0); };
+
+    REQUIRE_FALSE(LoadCode(buffer, source.blob, resolve));
+    REQUIRE(buffer.GetSizeInBytes() == 0);
+    REQUIRE(buffer.GetCapacity() == storage.size());
+    REQUIRE(buffer.GetOffsetPointer(0) == storage.data());
+}
+
+TEST_CASE("Invalid code blobs are rejected", "[code_blob]") {
+    BlobSource source(0xCAFE);
+
+    CodeBuffer buffer(256);
+    const auto resolve = [&](uint32_t) -> uintptr_t { return buffer.GetOffsetAddress(0); };
+
+    SECTION("Tag mismatch") {
+        REQUIRE_FALSE(LoadCode(buffer, source.blob, resolve, 0xBEEF));
+    }
+
+    SECTION("Version mismatch") {
+        auto blob = source.blob;
+        blob[4]++;
+        REQUIRE_FALSE(LoadCode(buffer, blob, resolve, 0xCAFE));
+    }
+
+    SECTION("Truncated") {
+        const std::span<const uint8_t> blob{source.blob.data(), source.blob.size() - 1};
+        REQUIRE_FALSE(LoadCode(buffer, blob, resolve, 0xCAFE));
+        REQUIRE_FALSE(LoadCode(buffer, blob.first(8), resolve, 0xCAFE));
+    }
+
+    SECTION("Missing resolver") {
+        REQUIRE_FALSE(LoadCode(buffer, source.blob, {}, 0xCAFE));
+    }
+
+    SECTION("External symbol out of reach") {
+        // The external symbol is referenced through an AUIPC pair, which only reaches +-2GiB.
+        const auto far = [&](uint32_t) -> uintptr_t {
+            return buffer.GetOffsetAddress(0) + (uintptr_t{1} << 32);
+        };
+        REQUIRE_FALSE(LoadCode(buffer, source.blob, far, 0xCAFE));
+    }
+
+    REQUIRE(buffer.GetSizeInBytes() == 0);
+    REQUIRE(LoadCode(buffer, source.blob, resolve, 0xCAFE) == 0);
+}
@@ -0,0 +1,322 @@
+#include <catch/catch.hpp>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_buffer.hpp>
+
+#include <array>
+#include <cstring>
+#include <utility>
+
+using namespace biscuit;
+
+TEST_CASE("Growable buffer grows geometrically", "[codebuffer]") {
+    CodeBuffer buffer{16};
+    buffer.SetGrowable(true);
+    REQUIRE(buffer.IsGrowable());
+
+    for (uint32_t i = 0; i < 5; i++) {
+        buffer.Emit32(i);
+    }
+
+    REQUIRE(buffer.GetSizeInBytes() == 20);
+    REQUIRE(buffer.GetRemainingBytes() == 12);
+
+    for (uint32_t i = 5; i < 100; i++) {
+        buffer.Emit32(i);
+    }
+
+    REQUIRE(buffer.GetSizeInBytes() == 400);
+    REQUIRE(buffer.GetRemainingBytes() == 112);
+
+    for (uint32_t i = 0; i < 100; i++) {
+        uint32_t value = 0;
+        std::memcpy(&value, buffer.GetOffsetPointer(static_cast<ptrdiff_t>(i * sizeof(uint32_t))), sizeof(value));
+        REQUIRE(value == i);
+    }
+}
+
+TEST_CASE("Growable buffer with no initial capacity", "[codebuffer]") {
+    CodeBuffer buffer{0};
+    buffer.SetGrowable(true);
+    buffer.Emit16(0xABCD);
+
+    REQUIRE(buffer.GetSizeInBytes() == 2);
+    REQUIRE(buffer.GetRemainingBytes() == CodeBuffer::default_capacity - 2);
+}
+
+TEST_CASE("Growable buffer keeps labels valid", "[codebuffer]") {
+    Assembler as{8};
+    as.GetCodeBuffer().SetGrowable(true);
+
+    Label label;
+    as.J(&label);
+    for (int i = 0; i < 1000; i++) {
+        as.NOP();
+    }
+    as.Bind(&label);
+
+    uint32_t jump = 0;
+    std::memcpy(&jump, as.GetBufferPointer(0), sizeof(jump));
+
+    std::array<uint32_t, 1> expected{};
+    Assembler expected_as{reinterpret_cast<uint8_t*>(expected.data()), sizeof(expected)};
+    expected_as.J(4004);
+
+    REQUIRE(jump == expected[0]);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 4004);
+}
+
+TEST_CASE("Dual-mapped buffer exposes written code through the executable view", "[codebuffer]") {
+    if (!CodeBuffer::IsDualMappingSupported()) {
+        return;
+    }
+
+    CodeBuffer buffer{4096, CodeBufferMapping::Dual};
+    REQUIRE(buffer.IsDualMapped());
+
+    buffer.Emit32(0x00000013);
+    buffer.SetExecutable();
+    buffer.Emit32(0x00008067);
+
+    const auto* rw = buffer.GetOffsetPointer(0);
+    const auto* rx = buffer.GetExecutableOffsetPointer(0);
+    REQUIRE(rw != rx);
+    REQUIRE(buffer.GetOffsetAddress(4) == reinterpret_cast<uintptr_t>(rx + 4));
+    REQUIRE(std::memcmp(rw, rx, 8) == 0);
+}
+
+TEST_CASE("Dual-mapped buffer keeps both views in sync when growing", "[codebuffer]") {
+    if (!CodeBuffer::IsDualMappingSupported()) {
+        return;
+    }
+
+    CodeBuffer buffer{4096, CodeBufferMapping::Dual};
+    buffer.SetGrowable(true);
+
+    for (uint32_t i = 0; i < 2048; i++) {
+        buffer.Emit32(i);
+    }
+
+    REQUIRE(buffer.GetCapacity() == 8192);
+    REQUIRE(std::memcmp(buffer.GetOffsetPointer(0),
+                        buffer.GetExecutableOffsetPointer(0),
+                        buffer.GetSizeInBytes()) == 0);
+
+    CodeBuffer moved{std::move(buffer)};
+    REQUIRE(moved.IsDualMapped());
+    REQUIRE(!buffer.IsDualMapped());
+}
+
+TEST_CASE("Single-mapped buffer executable view matches writable view", "[codebuffer]") {
+    CodeBuffer buffer{64};
+    REQUIRE(!buffer.IsDualMapped());
+    REQUIRE(buffer.GetExecutableOffsetPointer(0) == buffer.GetOffsetPointer(0));
+}
+
+TEST_CASE("Ranged protection changes keep the rest of the buffer writable", "[codebuffer]") {
+    CodeBuffer buffer{1U << 16};
+    for (uint32_t i = 0; i < 4096; i++) {
+        buffer.Emit32(0x00000013);
+    }
+
+    // Only the first page is flipped, writes past it must still succeed.
+    buffer.SetExecutable(0, 64);
+    std::memset(buffer.GetOffsetPointer(0x3000), 0, 4);
+    buffer.SetWritable(0, 64);
+    buffer.Emit32(0x00008067);
+
+    std::array<CodeRange, 2> ranges{{{0, 64}, {0x3000, 4}}};
+    buffer.FlushInstructionCache(ranges);
+    buffer.FlushInstructionCache();
+
+    REQUIRE(buffer.GetSizeInBytes() == 4097 * 4);
+}
+
+TEST_CASE("Reservations emit without moving the cursor until committed", "[codebuffer]") {
+    CodeBuffer buffer{64};
+    buffer.Emit32(0x00000013);
+
+    {
+        auto reservation = buffer.Reserve(12);
+        REQUIRE(reservation.GetRemainingBytes() == 12);
+        REQUIRE(reservation.GetCursorOffset() == 4);
+
+        reservation.Emit32(0x00100093);
+        reservation.Emit16(0x4505);
+        REQUIRE(buffer.GetCursorOffset() == 4);
+        REQUIRE(reservation.GetRemainingBytes() == 6);
+
+        reservation.Commit();
+        REQUIRE(buffer.GetCursorOffset() == 10);
+
+        reservation.Emit32(0x00008067);
+    }
+
+    REQUIRE(buffer.GetCursorOffset() == 14);
+
+    const auto* const data = buffer.GetOffsetPointer(0);
+    uint32_t word = 0;
+    std::memcpy(&word, data + 4, sizeof(word));
+    REQUIRE(word == 0x00100093);
+
+    uint16_t half = 0;
+    std::memcpy(&half, data + 8, sizeof(half));
+    REQUIRE(half == 0x4505);
+
+    std::memcpy(&word, data + 10, sizeof(word));
+    REQUIRE(word == 0x00008067);
+}
+
+TEST_CASE("Reservations grow growable buffers up front", "[codebuffer]") {
+    CodeBuffer buffer{16};
+    buffer.SetGrowable(true);
+
+    {
+        auto reservation = buffer.Reserve(256);
+        REQUIRE(buffer.GetCapacity() >= 256);
+
+        for (uint32_t i = 0; i < 64; i++) {
+            reservation.Emit32(i);
+        }
+        REQUIRE(reservation.GetRemainingBytes() == 0);
+    }
+
+    REQUIRE(buffer.GetSizeInBytes() == 256);
+
+    uint32_t word = 0;
+    std::memcpy(&word, buffer.GetOffsetPointer(63 * 4), sizeof(word));
+    REQUIRE(word == 63);
+}
+
+TEST_CASE("Patched instructions replace the whole instruction", "[codebuffer]") {
+    CodeBuffer buffer{64};
+    buffer.Emit32(0x00000013);
+    buffer.Emit32(0x00000013);
+
+    buffer.PatchInstruction(4, 0x0000006F);
+
+    uint32_t first = 0;
+    uint32_t second = 0;
+    std::memcpy(&first, buffer.GetOffsetPointer(0), sizeof(first));
+    std::memcpy(&second, buffer.GetOffsetPointer(4), sizeof(second));
+    REQUIRE(first == 0x00000013);
+    REQUIRE(second == 0x0000006F);
+    REQUIRE(buffer.GetSizeInBytes() == 8);
+}
+
+TEST_CASE("Released data is dropped while offsets stay the same", "[codebuffer]") {
+    CodeBuffer buffer{3 * CodeBuffer::release_granularity};
+    const auto words = static_cast<uint32_t>(CodeBuffer::release_granularity / 4 * 2 + 4);
+    for (uint32_t i = 0; i < words; i++) {
+        buffer.Emit32(i);
+    }
+    const auto cursor = buffer.GetCursorOffset();
+    const auto address = buffer.GetOffsetAddress(cursor);
+
+    // Less than the granularity is kept.
+    REQUIRE(buffer.ReleaseBefore(100) == 0);
+    REQUIRE(buffer.GetSizeInBytes() == words * 4);
+
+    const auto base = static_cast<ptrdiff_t>(CodeBuffer::release_granularity * 2);
+    REQUIRE(buffer.ReleaseBefore(base + 8) == base);
+    REQUIRE(buffer.GetBaseOffset() == base);
+    REQUIRE(buffer.GetCursorOffset() == cursor);
+    REQUIRE(buffer.GetSizeInBytes() == 16);
+    REQUIRE(buffer.GetRemainingBytes() == CodeBuffer::release_granularity * 3 - 16);
+
+    // The distance between addresses is kept, while the memory is reused.
+    REQUIRE(buffer.GetOffsetAddress(cursor) - buffer.GetOffsetAddress(0) == static_cast<uintptr_t>(cursor));
+    REQUIRE(buffer.GetOffsetPointer(base) == buffer.GetOffsetPointer(cursor) - 16);
+    REQUIRE(buffer.GetOffsetAddress(cursor) != address);
+
+    uint32_t word = 0;
+    std::memcpy(&word, buffer.GetOffsetPointer(base + 4), sizeof(word));
+    REQUIRE(word == words - 3);
+
+    buffer.RewindCursor(base + 4);
+    buffer.Emit32(0xAAAA);
+    std::memcpy(&word, buffer.GetOffsetPointer(base + 4), sizeof(word));
+    REQUIRE(word == 0xAAAA);
+    REQUIRE(buffer.GetCursorOffset() == base + 8);
+
+    // Resetting starts over from offset zero.
+    buffer.Reset();
+    REQUIRE(buffer.GetBaseOffset() == 0);
+    REQUIRE(buffer.GetCursorOffset() == 0);
+    REQUIRE(buffer.GetRemainingBytes() == buffer.GetCapacity());
+    REQUIRE(buffer.GetOffsetAddress(0) == buffer.GetCursorAddress());
+}
+
+TEST_CASE("Views share offsets and memory with their buffer", "[codebuffer]") {
+    CodeBuffer buffer{64};
+    for (uint32_t i = 0; i < 8; i++) {
+        buffer.Emit32(i);
+    }
+
+    auto view = buffer.CreateView({8, 12});
+    REQUIRE_FALSE(view.IsManaged());
+    REQUIRE(view.GetBaseOffset() == 8);
+    REQUIRE(view.GetCursorOffset() == 8);
+    REQUIRE(view.GetCapacity() == 12);
+    REQUIRE(view.GetOffsetAddress(0) == buffer.GetOffsetAddress(0));
+    REQUIRE(view.GetOffsetAddress(32) == buffer.GetOffsetAddress(32));
+
+    view.Emit32(0xAAAA);
+    view.Emit32(0xBBBB);
+    REQUIRE_FALSE(view.HasSpaceFor(8));
+
+    uint32_t word = 0;
+    std::memcpy(&word, buffer.GetOffsetPointer(12), sizeof(word));
+    REQUIRE(word == 0xBBBB);
+    std::memcpy(&word, buffer.GetOffsetPointer(16), sizeof(word));
+    REQUIRE(word == 4);
+    REQUIRE(buffer.GetCursorOffset() == 32);
+}
+
+TEST_CASE("Huge page backed buffers fall back gracefully", "[codebuffer]") {
+    CodeBuffer buffer{4096, CodeBufferMapping::Single, CodeBufferPages::Huge};
+    buffer.SetGrowable(true);
+
+    // Builds that map memory round the capacity up, while others use the capacity as-is.
+    const auto capacity = buffer.GetCapacity();
+    REQUIRE((capacity == 4096 || capacity % CodeBuffer::huge_page_size == 0));
+    REQUIRE((!buffer.IsHugePageBacked() || capacity % CodeBuffer::huge_page_size == 0));
+
+    buffer.Emit32(0x00000013);
+    buffer.SetExecutable(0, 4);
+    buffer.SetWritable(0, 4);
+
+    // Growing keeps the contents, whichever pages end up backing the new memory.
+    buffer.Grow(capacity + 1);
+    REQUIRE(buffer.GetCapacity() > capacity);
+    buffer.Emit32(0x00008067);
+
+    uint32_t words[2]{};
+    std::memcpy(words, buffer.GetOffsetPointer(0), sizeof(words));
+    REQUIRE(words[0] == 0x00000013);
+    REQUIRE(words[1] == 0x00008067);
+
+    CodeBuffer moved{std::move(buffer)};
+    REQUIRE(!buffer.IsHugePageBacked());
+    REQUIRE(moved.GetSizeInBytes() == 8);
+}
+
+TEST_CASE("Huge page backed dual-mapped buffers keep both views in sync", "[codebuffer]") {
+    if (!CodeBuffer::IsDualMappingSupported()) {
+        return;
+    }
+
+    CodeBuffer buffer{4096, CodeBufferMapping::Dual, CodeBufferPages::Huge};
+    REQUIRE(buffer.IsDualMapped());
+    REQUIRE(buffer.GetCapacity() % CodeBuffer::huge_page_size == 0);
+
+    buffer.SetGrowable(true);
+    buffer.Emit32(0x00000013);
+    buffer.Grow(buffer.GetCapacity() + 1);
+    buffer.Emit32(0x00008067);
+
+    REQUIRE(buffer.GetCapacity() % CodeBuffer::huge_page_size == 0);
+    REQUIRE(std::memcmp(buffer.GetOffsetPointer(0),
+                        buffer.GetExecutableOffsetPointer(0),
+                        buffer.GetSizeInBytes()) == 0);
+}
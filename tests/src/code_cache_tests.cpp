@@ -0,0 +1,105 @@
+#include <catch/catch.hpp>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_cache.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace biscuit;
+
+TEST_CASE("Allocations are aligned and disjoint", "[codecache]") {
+    CodeCache cache{4096};
+
+    auto a = cache.Allocate(10);
+    auto b = cache.Allocate(100, 64);
+    REQUIRE(a.has_value());
+    REQUIRE(b.has_value());
+
+    const auto a_addr = reinterpret_cast<uintptr_t>(a->GetOffsetPointer(0));
+    const auto b_addr = reinterpret_cast<uintptr_t>(b->GetOffsetPointer(0));
+    REQUIRE(a_addr % CodeCache::default_alignment == 0);
+    REQUIRE(b_addr % 64 == 0);
+    REQUIRE(b_addr >= a_addr + 10);
+    REQUIRE(a->GetCapacity() == 10);
+    REQUIRE(b->GetCapacity() == 100);
+    REQUIRE(cache.GetUsedBytes() == 110);
+    REQUIRE(cache.GetAllocationCount() == 2);
+}
+
+TEST_CASE("Caches can be published in every build", "[codecache]") {
+    CodeCache cache{4096};
+    auto buffer = cache.Allocate(4);
+    REQUIRE(buffer.has_value());
+    buffer->Emit32(0x00008067);
+
+    // Builds without mmap have nothing to protect, so these do nothing there.
+    cache.SetExecutable();
+    cache.SetWritable();
+    REQUIRE(cache.GetUsedBytes() == 4);
+}
+
+TEST_CASE("Freed ranges are reused and merged", "[codecache]") {
+    CodeCache cache{1024};
+
+    auto a = cache.Allocate(256);
+    auto b = cache.Allocate(256);
+    auto c = cache.Allocate(512);
+    REQUIRE(c.has_value());
+    REQUIRE(!cache.Allocate(16).has_value());
+
+    const auto* const a_ptr = a->GetOffsetPointer(0);
+    cache.Free(*a);
+    cache.Free(*b);
+    REQUIRE(cache.GetLargestFreeRange() == 512);
+
+    auto d = cache.Allocate(512);
+    REQUIRE(d.has_value());
+    REQUIRE(d->GetOffsetPointer(0) == a_ptr);
+}
+
+TEST_CASE("Compaction moves live slices down", "[codecache]") {
+    CodeCache cache{1024};
+
+    auto a = cache.Allocate(128);
+    auto b = cache.Allocate(128);
+    auto c = cache.Allocate(128);
+
+    Assembler as{c->GetOffsetPointer(0), c->GetCapacity()};
+    as.ADDI(x1, x1, 1);
+
+    auto* const b_ptr = b->GetOffsetPointer(0);
+    auto* const c_ptr = c->GetOffsetPointer(0);
+    cache.Free(*b);
+
+    std::vector<uint8_t*> moved_from;
+    std::vector<uint8_t*> moved_to;
+    cache.Compact([&](uint8_t* from, uint8_t* to, size_t size) {
+        REQUIRE(size == 128);
+        moved_from.push_back(from);
+        moved_to.push_back(to);
+    });
+
+    REQUIRE(moved_from.size() == 1);
+    REQUIRE(moved_from[0] == c_ptr);
+    REQUIRE(moved_to[0] == b_ptr);
+    REQUIRE(*reinterpret_cast<const uint32_t*>(b_ptr) == 0x00108093);
+    REQUIRE(cache.GetLargestFreeRange() == 1024 - 256);
+
+    cache.Free(moved_to[0]);
+    cache.Free(*a);
+    REQUIRE(cache.GetUsedBytes() == 0);
+    REQUIRE(cache.GetLargestFreeRange() == 1024);
+}
+
+TEST_CASE("Huge page backed caches hand out the whole region", "[codecache]") {
+    CodeCache cache{4096, CodeBufferPages::Huge};
+
+    const auto capacity = cache.GetCapacity();
+    REQUIRE((capacity == 4096 || capacity % CodeBuffer::huge_page_size == 0));
+    REQUIRE(cache.GetLargestFreeRange() == capacity);
+
+    auto a = cache.Allocate(capacity);
+    REQUIRE(a.has_value());
+    REQUIRE(!cache.Allocate(1).has_value());
+}
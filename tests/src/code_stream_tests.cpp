@@ -0,0 +1,237 @@
+#include <catch/catch.hpp>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_stream.hpp>
+
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+// Sinks that append everything they're handed to a vector.
+CodeStream::Sink MakeVectorSink(std::vector<uint8_t>& output) {
+    return [&output](std::span<const uint8_t> code) {
+        output.insert(output.end(), code.begin(), code.end());
+        return true;
+    };
+}
+
+// Emits a series of functions that each call back into the first one and branch
+// forwards within themselves, flushing the stream (if any) after each of them.
+void EmitFunctions(Assembler& as, CodeStream* stream, size_t count) {
+    Label first;
+    as.Bind(&first);
+    as.RET();
+
+    for (size_t i = 0; i < count; i++) {
+        Label skip;
+        as.Align(16);
+        as.BEQZ(a0, &skip);
+        for (size_t j = 0; j < i % 32; j++) {
+            as.ADDI(a0, a0, -1);
+        }
+        as.Bind(&skip);
+        as.CALL(&first);
+        as.J(&skip);
+
+        if (stream != nullptr) {
+            REQUIRE(stream->Flush());
+        }
+    }
+}
+} // Anonymous namespace
+
+TEST_CASE("Streamed code matches code emitted in one go", "[codestream]") {
+    constexpr size_t function_count = 20000;
+
+    Assembler expected_as{CodeBuffer::default_capacity};
+    expected_as.GetCodeBuffer().SetGrowable(true);
+    EmitFunctions(expected_as, nullptr, function_count);
+    const auto* const expected_code = expected_as.GetBufferPointer(0);
+    const std::vector<uint8_t> expected(expected_code, expected_code + expected_as.GetCodeBuffer().GetSizeInBytes());
+
+    std::vector<uint8_t> output;
+    Assembler as{CodeBuffer::default_capacity};
+    as.GetCodeBuffer().SetGrowable(true);
+    CodeStream stream{as, MakeVectorSink(output)};
+    EmitFunctions(as, &stream, function_count);
+
+    REQUIRE(stream.GetPendingSize() == 0);
+    REQUIRE(stream.GetFlushedOffset() == as.GetCodeBuffer().GetCursorOffset());
+    REQUIRE(output == expected);
+
+    // Only a window trailing the cursor was ever held.
+    REQUIRE(expected.size() > 1024 * 1024);
+    REQUIRE(as.GetCodeBuffer().GetCapacity() <= 2 * CodeBuffer::release_granularity);
+}
+
+TEST_CASE("Pending label references hold back streamed code", "[codestream]") {
+    std::vector<uint8_t> output;
+    Assembler as{CodeBuffer::default_capacity};
+    as.GetCodeBuffer().SetGrowable(true);
+    CodeStream stream{as, MakeVectorSink(output)};
+
+    as.NOP();
+    Label target;
+    as.J(&target);
+    for (size_t i = 0; i < 4096; i++) {
+        as.NOP();
+    }
+
+    REQUIRE(as.GetFinalizedOffset() == 4);
+    REQUIRE(stream.Flush());
+    REQUIRE(output.size() == 4);
+    REQUIRE(as.GetCodeBuffer().GetBaseOffset() == 0);
+
+    as.Bind(&target);
+    as.J(&target);
+    REQUIRE(stream.Flush());
+    REQUIRE(output.size() == 4 * 4099);
+    REQUIRE(as.GetCodeBuffer().GetBaseOffset() == 4 * 4096);
+
+    std::vector<uint32_t> expected(2);
+    Assembler expected_as{reinterpret_cast<uint8_t*>(expected.data()), expected.size() * sizeof(uint32_t)};
+    expected_as.J(4 * 4097);
+    expected_as.J(0);
+    REQUIRE(ReadWord(output, 4) == expected[0]);
+    REQUIRE(ReadWord(output, 4 * 4098) == expected[1]);
+}
+
+TEST_CASE("Pending data references hold back streamed code", "[codestream]") {
+    std::vector<uint8_t> output;
+    Assembler as{CodeBuffer::default_capacity};
+    as.GetCodeBuffer().SetGrowable(true);
+    CodeStream stream{as, MakeVectorSink(output)};
+
+    Label table;
+    Label target;
+    as.Bind(&table);
+    as.EmitJumpTableEntry(&target, &table);
+    for (size_t i = 0; i < 2048; i++) {
+        as.EmitJumpTableEntry(&table, &table);
+    }
+    REQUIRE(stream.Flush());
+    REQUIRE(output.empty());
+
+    as.Bind(&target);
+    REQUIRE(stream.Flush());
+    REQUIRE(output.size() == 4 * 2049);
+    REQUIRE(ReadWord(output, 0) == 4 * 2049);
+}
+
+TEST_CASE("Relaxed branches hold back streamed code", "[codestream]") {
+    const auto emit = [](Assembler& as, CodeStream* stream) {
+        as.SetBranchRelaxation(true);
+
+        for (size_t i = 0; i < 2048; i++) {
+            as.NOP();
+        }
+        Label far;
+        as.BEQ(a0, a1, &far);
+        for (size_t i = 0; i < 2048; i++) {
+            as.NOP();
+        }
+
+        if (stream != nullptr) {
+            REQUIRE(stream->Flush());
+            REQUIRE(stream->GetFlushedOffset() == 4 * 2048);
+        }
+
+        as.Bind(&far);
+        as.BEQ(a0, a1, &far);
+        if (stream != nullptr) {
+            REQUIRE(stream->Flush());
+        }
+    };
+
+    Assembler expected_as{CodeBuffer::default_capacity};
+    expected_as.GetCodeBuffer().SetGrowable(true);
+    emit(expected_as, nullptr);
+    const auto* const expected_code = expected_as.GetBufferPointer(0);
+    const std::vector<uint8_t> expected(expected_code, expected_code + expected_as.GetCodeBuffer().GetSizeInBytes());
+
+    std::vector<uint8_t> output;
+    Assembler as{CodeBuffer::default_capacity};
+    as.GetCodeBuffer().SetGrowable(true);
+    CodeStream stream{as, MakeVectorSink(output)};
+    emit(as, &stream);
+
+    // The branch grew into a longer form while held back.
+    REQUIRE(expected.size() > 4 * 4098);
+    REQUIRE(output == expected);
+}
+
+TEST_CASE("Failed writes are retried by the next flush", "[codestream]") {
+    std::vector<uint8_t> output;
+    bool fail = true;
+    Assembler as{CodeBuffer::default_capacity};
+    as.GetCodeBuffer().SetGrowable(true);
+    CodeStream stream{as, [&](std::span<const uint8_t> code) {
+        if (fail) {
+            return false;
+        }
+        output.insert(output.end(), code.begin(), code.end());
+        return true;
+    }};
+
+    for (size_t i = 0; i < 2048; i++) {
+        as.NOP();
+    }
+    REQUIRE_FALSE(stream.Flush());
+    REQUIRE(stream.GetPendingSize() == 4 * 2048);
+    REQUIRE(as.GetCodeBuffer().GetBaseOffset() == 0);
+
+    fail = false;
+    REQUIRE(stream.Flush());
+    REQUIRE(stream.GetPendingSize() == 0);
+    REQUIRE(output.size() == 4 * 2048);
+    REQUIRE(as.GetCodeBuffer().GetBaseOffset() == 4 * 2048);
+}
+
+TEST_CASE("Assemblers can be reset after streaming", "[codestream]") {
+    std::vector<uint8_t> output;
+    Assembler as{CodeBuffer::default_capacity};
+    as.GetCodeBuffer().SetGrowable(true);
+    {
+        CodeStream stream{as, MakeVectorSink(output)};
+        EmitFunctions(as, &stream, 1000);
+        REQUIRE(as.GetCodeBuffer().GetBaseOffset() != 0);
+    }
+
+    as.Reset();
+    REQUIRE(as.GetCodeBuffer().GetBaseOffset() == 0);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 0);
+    REQUIRE(as.GetFinalizedOffset() == 0);
+
+    // Code streamed after the reset is the same as the first time around.
+    std::vector<uint8_t> restreamed;
+    CodeStream stream{as, MakeVectorSink(restreamed)};
+    EmitFunctions(as, &stream, 1000);
+    REQUIRE(restreamed == output);
+}
+
+TEST_CASE("Streams write to files", "[codestream]") {
+    auto* const file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    Assembler as{CodeBuffer::default_capacity};
+    CodeStream stream{as, file};
+    as.NOP();
+    as.RET();
+    REQUIRE(stream.Flush());
+
+    std::array<uint32_t, 2> written{};
+    std::rewind(file);
+    REQUIRE(std::fread(written.data(), sizeof(uint32_t), written.size(), file) == written.size());
+    std::fclose(file);
+
+    std::array<uint32_t, 2> expected{};
+    Assembler expected_as{reinterpret_cast<uint8_t*>(expected.data()), sizeof(expected)};
+    expected_as.NOP();
+    expected_as.RET();
+    REQUIRE(written == expected);
+}
@@ -0,0 +1,205 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/crypto_kernels.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+constexpr ExtensionSet vector_crypto{
+    Extension::V, Extension::Zvkb, Extension::Zvkg, Extension::Zvkned, Extension::Zvknha, Extension::Zvksed,
+};
+
+// Finds the offset of the first instruction matching `word`, or -1 if there isn't one.
+ptrdiff_t FindWord(CodeBuffer& buffer, uint32_t word) {
+    for (ptrdiff_t offset = 0; offset < buffer.GetCursorOffset(); offset += 4) {
+        if (ReadWord(buffer, offset) == word) {
+            return offset;
+        }
+    }
+    return -1;
+}
+
+template <typename Emitter>
+uint32_t Encode(Emitter&& emitter) {
+    uint32_t word = 0;
+    auto as = MakeAssembler64(word);
+    emitter(as);
+    return word;
+}
+} // Anonymous namespace
+
+TEST_CASE("Crypto kernels require vector crypto extensions", "[crypto_kernels]") {
+    std::array<uint8_t, 256> buffer{};
+    auto as = MakeAssembler64(buffer);
+
+    REQUIRE_FALSE(EmitAESKeyExpansionKernel(as, AESKeySize::AES128));
+    REQUIRE_FALSE(EmitAESCTRKernel(as, AESKeySize::AES128, {}));
+    REQUIRE_FALSE(EmitAESGCMKernel(as, AESKeySize::AES128, GCMDirection::Encrypt, {}));
+    REQUIRE_FALSE(EmitGHASHKernel(as));
+    REQUIRE_FALSE(EmitSHA256Kernel(as));
+    REQUIRE_FALSE(EmitSM4KeyExpansionKernel(as));
+    REQUIRE_FALSE(EmitSM4Kernel(as, {}));
+
+    // Counters can't be byte-swapped without Zvkb or Zvbb.
+    as.SetExtensions({Extension::V, Extension::Zvkned, Extension::Zvkg});
+    REQUIRE(EmitAESKeyExpansionKernel(as, AESKeySize::AES128));
+    REQUIRE_FALSE(EmitAESCTRKernel(as, AESKeySize::AES128, {}));
+    REQUIRE_FALSE(EmitAESGCMKernel(as, AESKeySize::AES128, GCMDirection::Encrypt, {}));
+}
+
+TEST_CASE("AES-128 key expansion kernel", "[crypto_kernels]") {
+    std::array<uint32_t, 48> buffer{};
+    std::array<uint32_t, 48> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+    as.SetExtensions(vector_crypto);
+
+    REQUIRE(EmitAESKeyExpansionKernel(as, AESKeySize::AES128) == 0);
+
+    ref.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    ref.VLE32(v1, a0);
+    ref.VSE32(v1, a1);
+    for (uint32_t round = 1; round <= 10; round++) {
+        const bool odd = (round % 2) != 0;
+        ref.VAESKF1(odd ? v2 : v1, odd ? v1 : v2, round);
+        ref.ADDI(a1, a1, 16);
+        ref.VSE32(odd ? v2 : v1, a1);
+    }
+    ref.RET();
+
+    REQUIRE(buffer == expected);
+}
+
+TEST_CASE("AES-256 key expansion kernel", "[crypto_kernels]") {
+    std::array<uint8_t, 512> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetExtensions(vector_crypto);
+
+    REQUIRE(EmitAESKeyExpansionKernel(as, AESKeySize::AES256) == 0);
+
+    // The key schedule rotates through three registers.
+    const auto first = FindWord(code, Encode([](Assembler& e) { e.VAESKF2(v3, v2, 2); }));
+    REQUIRE(first >= 0);
+    REQUIRE(ReadWord(code, first - 4) == Encode([](Assembler& e) { e.VMV(v3, v1); }));
+    REQUIRE(ReadWord(code, first + 12) == Encode([](Assembler& e) { e.VMV(v1, v2); }));
+    REQUIRE(ReadWord(code, first + 16) == Encode([](Assembler& e) { e.VAESKF2(v1, v3, 3); }));
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VAESKF2(v3, v2, 14); })) >= 0);
+}
+
+TEST_CASE("AES-CTR kernel", "[crypto_kernels]") {
+    std::array<uint8_t, 1024> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetExtensions(vector_crypto);
+
+    REQUIRE(EmitAESCTRKernel(as, AESKeySize::AES256, {.vlenb = 16}) == 0);
+
+    // All 15 round keys are used, with block data in LMUL=4 groups.
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VAESZ(v20, v1); })) >= 0);
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VAESEM_VS(v20, v14); })) >= 0);
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VAESEF_VS(v20, v15); })) >= 0);
+    REQUIRE(FindWord(code, Encode([](Assembler& e) {
+        e.VSETVLI(t5, x0, SEW::E32, LMUL::M4, VTA::Yes, VMA::No);
+    })) >= 0);
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VGHSH(v28, v29, v30); })) == -1);
+
+    // Short inputs use smaller groups.
+    code.RewindCursor();
+    EmitAESCTRKernel(as, AESKeySize::AES128, {.vlenb = 16, .typical_size = 4});
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VAESEF_VS(v20, v11); })) >= 0);
+    REQUIRE(FindWord(code, Encode([](Assembler& e) {
+        e.VSETVLI(t5, x0, SEW::E32, LMUL::M1, VTA::Yes, VMA::No);
+    })) >= 0);
+}
+
+TEST_CASE("AES-GCM kernels", "[crypto_kernels]") {
+    std::array<uint8_t, 1024> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetExtensions(vector_crypto);
+
+    const auto ghash = Encode([](Assembler& e) { e.VGHSH(v28, v29, v30); });
+    const auto apply = Encode([](Assembler& e) { e.VXOR(v24, v24, v20); });
+
+    // Ciphertext is hashed after encrypting, and before decrypting.
+    REQUIRE(EmitAESGCMKernel(as, AESKeySize::AES128, GCMDirection::Encrypt, {.vlenb = 16}));
+    REQUIRE(FindWord(code, ghash) > FindWord(code, apply));
+
+    code.RewindCursor();
+    REQUIRE(EmitAESGCMKernel(as, AESKeySize::AES128, GCMDirection::Decrypt, {.vlenb = 16}));
+    REQUIRE(FindWord(code, ghash) < FindWord(code, apply));
+    REQUIRE(FindWord(code, ghash) >= 0);
+}
+
+TEST_CASE("GHASH kernel", "[crypto_kernels]") {
+    std::array<uint32_t, 16> buffer{};
+    std::array<uint32_t, 16> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+    as.SetExtensions({Extension::V, Extension::Zvkg});
+
+    REQUIRE(EmitGHASHKernel(as) == 0);
+
+    ref.VSETIVLI(x0, 4, SEW::E32, LMUL::M1, VTA::Yes, VMA::Yes);
+    ref.VLE32(v1, a0);
+    ref.VLE32(v2, a1);
+    ref.BEQZ(a3, 24);
+    ref.VLE32(v3, a2);
+    ref.VGHSH(v1, v2, v3);
+    ref.ADDI(a2, a2, 16);
+    ref.ADDI(a3, a3, -1);
+    ref.J(-20);
+    ref.VSE32(v1, a0);
+    ref.RET();
+
+    REQUIRE(buffer == expected);
+}
+
+TEST_CASE("SHA-256 kernel", "[crypto_kernels]") {
+    std::array<uint8_t, 2048> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetExtensions({Extension::V, Extension::Zvbb, Extension::Zvknhb});
+
+    REQUIRE(EmitSHA256Kernel(as) == 0);
+
+    // Round constants follow the code.
+    const auto end = code.GetCursorOffset();
+    REQUIRE(ReadWord(code, end - 256) == 0x428A2F98);
+    REQUIRE(ReadWord(code, end - 4) == 0xC67178F2);
+    REQUIRE(ReadWord(code, end - 260) == enc::JALR(x0, 0, ra));
+
+    // 12 of the 16 quad-rounds extend the message schedule.
+    size_t rounds = 0;
+    size_t schedules = 0;
+    for (ptrdiff_t offset = 0; offset < end - 256; offset += 4) {
+        const auto word = ReadWord(code, offset);
+        rounds += (word & 0xFC00707F) == 0xBC002077 ? 1 : 0;
+        schedules += (word & 0xFC00707F) == 0xB4002077 ? 1 : 0;
+    }
+    REQUIRE(rounds == 16);
+    REQUIRE(schedules == 12);
+}
+
+TEST_CASE("SM4 kernels", "[crypto_kernels]") {
+    std::array<uint8_t, 512> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+    as.SetExtensions(vector_crypto);
+
+    REQUIRE(EmitSM4KeyExpansionKernel(as) == 0);
+    const auto end = code.GetCursorOffset();
+    REQUIRE(ReadWord(code, end - 16) == 0xA3B1BAC6);
+    REQUIRE(ReadWord(code, end - 20) == enc::JALR(x0, 0, ra));
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VSM4K(v8, v7, 7); })) >= 0);
+
+    const auto kernel = EmitSM4Kernel(as, {.vlenb = 16});
+    REQUIRE(kernel == end);
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VSM4R_VS(v16, v15); })) > end);
+    REQUIRE(FindWord(code, Encode([](Assembler& e) { e.VRGATHER(v20, v16, v24); })) > end);
+}
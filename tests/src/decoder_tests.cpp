@@ -0,0 +1,298 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/decoder.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Instruction lengths", "[decoder]") {
+    STATIC_REQUIRE(GetInstructionLength(0x0001) == 2);
+    STATIC_REQUIRE(GetInstructionLength(0x4082) == 2);
+    STATIC_REQUIRE(GetInstructionLength(0x0013) == 4);
+    STATIC_REQUIRE(GetInstructionLength(0x001F) == 6);
+    STATIC_REQUIRE(GetInstructionLength(0x003F) == 8);
+    STATIC_REQUIRE(GetInstructionLength(0x007F) == 0);
+}
+
+TEST_CASE("Decoding base integer instructions", "[decoder]") {
+    uint32_t value = 0;
+    auto as = MakeAssembler64(value);
+    const Decoder decoder;
+
+    as.ADDI(x5, x6, -2048);
+    auto insn = decoder.Decode(value);
+    REQUIRE(insn);
+    REQUIRE(insn->mnemonic == "addi");
+    REQUIRE(insn->format == InstructionFormat::I);
+    REQUIRE(insn->length == 4);
+    REQUIRE(insn->rd == 5);
+    REQUIRE(insn->rs1 == 6);
+    REQUIRE(insn->imm == -2048);
+
+    as.RewindBuffer();
+    as.SLLI(x1, x2, 63);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "slli");
+    REQUIRE(insn->imm == 63);
+
+    as.RewindBuffer();
+    as.SW(x7, -4, x8);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "sw");
+    REQUIRE(insn->format == InstructionFormat::S);
+    REQUIRE(insn->rs1 == 8);
+    REQUIRE(insn->rs2 == 7);
+    REQUIRE(insn->imm == -4);
+
+    as.RewindBuffer();
+    as.BEQ(x1, x2, -4096);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "beq");
+    REQUIRE(insn->format == InstructionFormat::B);
+    REQUIRE(insn->imm == -4096);
+
+    as.RewindBuffer();
+    as.JAL(x1, 0x7FFFE);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "jal");
+    REQUIRE(insn->rd == 1);
+    REQUIRE(insn->imm == 0x7FFFE);
+
+    as.RewindBuffer();
+    as.LUI(x3, 0xFFFFF);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "lui");
+    REQUIRE(insn->imm == -4096);
+
+    as.RewindBuffer();
+    as.CSRRW(x4, CSR::FCSR, x5);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "csrrw");
+    REQUIRE(insn->imm == 0x003);
+
+    as.RewindBuffer();
+    as.AMOADD_W(Ordering::AQRL, x1, x2, x3);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "amoadd.w");
+    REQUIRE(insn->imm == 0b11);
+
+    as.RewindBuffer();
+    as.PREFETCH_W(x9, -32);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "prefetch.w");
+    REQUIRE(insn->rs1 == 9);
+    REQUIRE(insn->imm == -32);
+
+    as.RewindBuffer();
+    as.FMADD_S(f1, f2, f3, f4);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "fmadd.s");
+    REQUIRE(insn->format == InstructionFormat::R4);
+    REQUIRE(insn->rs3 == 4);
+}
+
+TEST_CASE("Decoding depends on the base ISA", "[decoder]") {
+    uint32_t value = 0;
+    auto as = MakeAssembler64(value);
+
+    as.C_ADDIW(x10, 5);
+
+    const Decoder rv32{ArchFeature::RV32};
+    const Decoder rv64{ArchFeature::RV64};
+
+    REQUIRE(rv64.Decode(value)->mnemonic == "c.addiw");
+    REQUIRE(rv32.Decode(value)->mnemonic == "c.jal");
+    REQUIRE(rv32.GetFormat(value) == InstructionFormat::CJ);
+    REQUIRE(rv64.GetFormat(value) == InstructionFormat::CI);
+
+    as.RewindBuffer();
+    as.LD(x1, 0, x2);
+    REQUIRE(rv64.Decode(value)->mnemonic == "ld");
+    REQUIRE_FALSE(rv32.Decode(value));
+}
+
+TEST_CASE("Decoding compressed instructions", "[decoder]") {
+    uint32_t value = 0;
+    auto as = MakeAssembler64(value);
+    const Decoder decoder;
+
+    as.C_ADDI4SPN(x8, 1020);
+    auto insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.addi4spn");
+    REQUIRE(insn->format == InstructionFormat::CIW);
+    REQUIRE(insn->length == 2);
+    REQUIRE(insn->rd == 8);
+    REQUIRE(insn->imm == 1020);
+
+    as.RewindBuffer();
+    as.C_LD(x9, 248, x15);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.ld");
+    REQUIRE(insn->rd == 9);
+    REQUIRE(insn->rs1 == 15);
+    REQUIRE(insn->imm == 248);
+
+    as.RewindBuffer();
+    as.C_SW(x14, 124, x8);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.sw");
+    REQUIRE(insn->rs1 == 8);
+    REQUIRE(insn->rs2 == 14);
+    REQUIRE(insn->imm == 124);
+
+    as.RewindBuffer();
+    as.C_ADDI16SP(-512);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.addi16sp");
+    REQUIRE(insn->imm == -512);
+
+    as.RewindBuffer();
+    as.C_LUI(x5, 0x3E000);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.lui");
+    REQUIRE(insn->imm == -0x2000);
+
+    as.RewindBuffer();
+    as.C_LWSP(x1, 252);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.lwsp");
+    REQUIRE(insn->imm == 252);
+
+    as.RewindBuffer();
+    as.C_SDSP(x31, 504);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.sdsp");
+    REQUIRE(insn->format == InstructionFormat::CSS);
+    REQUIRE(insn->rs2 == 31);
+    REQUIRE(insn->imm == 504);
+
+    as.RewindBuffer();
+    as.C_SRAI(x12, 63);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.srai");
+    REQUIRE(insn->rd == 12);
+    REQUIRE(insn->imm == 63);
+
+    as.RewindBuffer();
+    as.C_BEQZ(x10, -256);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.beqz");
+    REQUIRE(insn->format == InstructionFormat::CB);
+    REQUIRE(insn->rs1 == 10);
+    REQUIRE(insn->imm == -256);
+
+    as.RewindBuffer();
+    as.C_J(-2032);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.j");
+    REQUIRE(insn->imm == -2032);
+
+    as.RewindBuffer();
+    as.C_NOP();
+    REQUIRE(decoder.Decode(value)->mnemonic == "c.nop");
+
+    as.RewindBuffer();
+    as.C_LBU(x8, 3, x9);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "c.lbu");
+    REQUIRE(insn->format == InstructionFormat::CLB);
+    REQUIRE(insn->imm == 3);
+}
+
+TEST_CASE("Decoding Zcmp and Zcmt instructions", "[decoder]") {
+    uint32_t value = 0;
+    auto as = MakeAssembler64(value);
+
+    const Decoder with_zcm{ArchFeature::RV64, {Extension::Zcmp, Extension::Zcmt}};
+    const Decoder without_zcm{ArchFeature::RV64};
+
+    as.CM_MVSA01(x9, x18);
+    auto insn = with_zcm.Decode(value);
+    REQUIRE(insn->mnemonic == "cm.mvsa01");
+    REQUIRE(insn->format == InstructionFormat::CMMV);
+    REQUIRE(insn->rs1 == 9);
+    REQUIRE(insn->rs2 == 18);
+    REQUIRE(without_zcm.Decode(value)->mnemonic == "c.fsdsp");
+
+    as.RewindBuffer();
+    as.CM_JALT(64);
+    insn = with_zcm.Decode(value);
+    REQUIRE(insn->mnemonic == "cm.jalt");
+    REQUIRE(insn->imm == 64);
+
+    as.RewindBuffer();
+    as.CM_JT(31);
+    REQUIRE(with_zcm.Decode(value)->mnemonic == "cm.jt");
+    REQUIRE(with_zcm.GetFormat(value) == InstructionFormat::CMJT);
+}
+
+TEST_CASE("Decoding vector instructions", "[decoder]") {
+    uint32_t value = 0;
+    auto as = MakeAssembler64(value);
+    const Decoder decoder;
+
+    as.VADD(v1, v2, -16, VecMask::Yes);
+    auto insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "vadd.vi");
+    REQUIRE(insn->format == InstructionFormat::VArith);
+    REQUIRE(insn->rd == 1);
+    REQUIRE(insn->rs2 == 2);
+    REQUIRE(insn->imm == -16);
+    REQUIRE((insn->encoding & (1U << 25)) == 0);
+
+    as.RewindBuffer();
+    as.VROR(v4, v8, 63U);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "vror.vi");
+    REQUIRE(insn->imm == 63);
+
+    as.RewindBuffer();
+    as.VLSEGE32(4, v8, x10);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "vlseg4e32.v");
+    REQUIRE(insn->format == InstructionFormat::VLoad);
+    REQUIRE(insn->rd == 8);
+    REQUIRE(insn->rs1 == 10);
+    REQUIRE(insn->imm == 3);
+
+    as.RewindBuffer();
+    as.VSETIVLI(x5, 31, SEW::E64, LMUL::M8, VTA::Yes, VMA::Yes);
+    insn = decoder.Decode(value);
+    REQUIRE(insn->mnemonic == "vsetivli");
+    REQUIRE(insn->format == InstructionFormat::VConfig);
+    REQUIRE(insn->rd == 5);
+    REQUIRE(insn->rs1 == 31);
+    REQUIRE(insn->imm == 0b0011011011);
+}
+
+TEST_CASE("Decoding from a block of code", "[decoder]") {
+    std::array<uint8_t, 8> buffer{};
+    auto as = MakeAssembler64(buffer);
+    const Decoder decoder;
+
+    as.C_MV(x1, x2);
+    as.ADD(x3, x4, x5);
+
+    const std::span<const uint8_t> code{buffer};
+    const auto first = decoder.Decode(code);
+    REQUIRE(first->mnemonic == "c.mv");
+
+    const auto second = decoder.Decode(code.subspan(first->length));
+    REQUIRE(second->mnemonic == "add");
+    REQUIRE(second->length == 4);
+
+    // Too short to hold the whole instruction.
+    REQUIRE_FALSE(decoder.Decode(code.subspan(2, 3)));
+    REQUIRE_FALSE(decoder.Decode(code.first(1)));
+}
+
+TEST_CASE("Unrecognized encodings", "[decoder]") {
+    const Decoder decoder;
+
+    REQUIRE_FALSE(decoder.Decode(0x00000000));
+    REQUIRE_FALSE(decoder.Decode(0xFFFFFFFF));
+    REQUIRE(decoder.GetFormat(0x0000007B) == InstructionFormat::Unknown);
+}
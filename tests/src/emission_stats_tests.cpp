@@ -0,0 +1,134 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/emission_stats.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+template <typename Emitter>
+uint32_t Encode(Emitter&& emitter) {
+    uint32_t word = 0;
+    auto as = MakeAssembler64(word);
+    emitter(as);
+    return word;
+}
+} // Anonymous namespace
+
+TEST_CASE("Instruction classification", "[emission_stats]") {
+    const auto classify = [](auto&& emitter) { return ClassifyInstruction(Encode(emitter)); };
+
+    REQUIRE(classify([](Assembler& as) { as.ADDI(a0, a0, 1); }) == InstructionClass::Base);
+    REQUIRE(classify([](Assembler& as) { as.SRAI(a0, a0, 3); }) == InstructionClass::Base);
+    REQUIRE(classify([](Assembler& as) { as.SUB(a0, a0, a1); }) == InstructionClass::Base);
+    REQUIRE(classify([](Assembler& as) { as.ECALL(); }) == InstructionClass::Base);
+    REQUIRE(classify([](Assembler& as) { as.C_ADDI(a0, 1); }) == InstructionClass::Compressed);
+    REQUIRE(classify([](Assembler& as) { as.MULW(a0, a0, a1); }) == InstructionClass::Multiply);
+    REQUIRE(classify([](Assembler& as) { as.AMOADD_W(Ordering::None, a0, a1, a2); }) == InstructionClass::Atomic);
+    REQUIRE(classify([](Assembler& as) { as.FLD(f0, 8, sp); }) == InstructionClass::FloatingPoint);
+    REQUIRE(classify([](Assembler& as) { as.FADD_D(f0, f1, f2); }) == InstructionClass::FloatingPoint);
+    REQUIRE(classify([](Assembler& as) { as.SH1ADD(a0, a1, a2); }) == InstructionClass::BitManip);
+    REQUIRE(classify([](Assembler& as) { as.ANDN(a0, a1, a2); }) == InstructionClass::BitManip);
+    REQUIRE(classify([](Assembler& as) { as.RORI(a0, a1, 3); }) == InstructionClass::BitManip);
+    REQUIRE(classify([](Assembler& as) { as.CZERO_EQZ(a0, a1, a2); }) == InstructionClass::BitManip);
+    REQUIRE(classify([](Assembler& as) { as.CSRR(a0, CSR::Cycle); }) == InstructionClass::CSR);
+    REQUIRE(classify([](Assembler& as) { as.VLE32(v8, a0); }) == InstructionClass::Vector);
+    REQUIRE(classify([](Assembler& as) { as.VADD(v8, v8, v16); }) == InstructionClass::Vector);
+    REQUIRE(classify([](Assembler& as) { as.VGHSH(v1, v2, v3); }) == InstructionClass::VectorCrypto);
+    REQUIRE(ClassifyInstruction(0x0000000B) == InstructionClass::Unknown);
+}
+
+TEST_CASE("Recording instructions", "[emission_stats]") {
+    EmissionStats stats;
+    stats.RecordInstruction(Encode([](Assembler& as) { as.ADDI(a0, a0, 1); }), 4);
+    stats.RecordInstruction(Encode([](Assembler& as) { as.SD(a0, 8, sp); }), 4);
+    stats.RecordInstruction(Encode([](Assembler& as) { as.C_LI(a0, 1); }), 2);
+
+    const auto& totals = stats.GetTotals();
+    REQUIRE(totals.uncompressed == 2);
+    REQUIRE(totals.compressed == 1);
+    REQUIRE(totals.bytes == 10);
+    REQUIRE(totals.GetCount(InstructionFormat::I) == 1);
+    REQUIRE(totals.GetCount(InstructionFormat::S) == 1);
+    REQUIRE(totals.GetCount(InstructionFormat::CI) == 1);
+    REQUIRE(totals.GetCount(InstructionClass::Base) == 2);
+    REQUIRE(totals.GetCount(InstructionClass::Compressed) == 1);
+
+    stats.Reset();
+    REQUIRE(stats.GetTotals().bytes == 0);
+}
+
+TEST_CASE("Label regions", "[emission_stats]") {
+    EmissionStats stats;
+    stats.RecordLabel(16, 2);
+    stats.RecordLabel(8, 0);
+    stats.RecordLabel(16, 1);
+
+    REQUIRE(stats.GetTotals().labels_bound == 3);
+    REQUIRE(stats.GetTotals().label_fixups == 3);
+
+    const auto regions = stats.GetLabelRegions(40);
+    REQUIRE(regions.size() == 3);
+    REQUIRE(regions[0].offset == 0);
+    REQUIRE(regions[0].size == 8);
+    REQUIRE(regions[1].offset == 8);
+    REQUIRE(regions[1].size == 8);
+    REQUIRE(regions[2].offset == 16);
+    REQUIRE(regions[2].size == 24);
+}
+
+TEST_CASE("Recording emission through the assembler", "[emission_stats]") {
+    Assembler as{0};
+    auto& buffer = as.GetCodeBuffer();
+    buffer.SetGrowable(true);
+
+    EmissionStats stats;
+    buffer.SetEmissionStats(&stats);
+    if (!CodeBuffer::IsEmissionStatsSupported()) {
+        REQUIRE(buffer.GetEmissionStats() == nullptr);
+        return;
+    }
+    REQUIRE(buffer.GetEmissionStats() == &stats);
+
+    Label label;
+    as.BEQZ(a0, &label);
+    as.J(&label);
+    as.NOP();
+    as.Bind(&label);
+    as.C_NOP();
+    as.RET();
+
+    const auto& totals = stats.GetTotals();
+    REQUIRE(totals.uncompressed == 4);
+    REQUIRE(totals.compressed == 1);
+    REQUIRE(totals.GetCount(InstructionFormat::B) == 1);
+    REQUIRE(totals.GetCount(InstructionFormat::J) == 1);
+    REQUIRE(totals.grow_events == 1);
+    REQUIRE(totals.labels_bound == 1);
+    REQUIRE(totals.label_fixups == 2);
+
+    const auto regions = stats.GetLabelRegions(buffer.GetCursorOffset());
+    REQUIRE(regions.size() == 2);
+    REQUIRE(regions[0].size == 12);
+    REQUIRE(regions[1].size == 6);
+
+    // Nothing is recorded once the stats are detached.
+    buffer.SetEmissionStats(nullptr);
+    as.NOP();
+    REQUIRE(totals.uncompressed == 4);
+}
+
+TEST_CASE("Resetting the assembler resets attached stats", "[emission_stats]") {
+    Assembler as{64};
+
+    EmissionStats stats;
+    as.GetCodeBuffer().SetEmissionStats(&stats);
+    as.NOP();
+    as.Reset();
+
+    REQUIRE(stats.GetTotals().uncompressed == 0);
+    REQUIRE(stats.GetLabelRegions(0).empty());
+}
@@ -0,0 +1,101 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <biscuit/assembler.hpp>
+#include <biscuit/encoding.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Instruction encoders are usable in constant expressions", "[encoding]") {
+    STATIC_REQUIRE(enc::ADD(x7, x15, x31) == 0x01F783B3);
+    STATIC_REQUIRE(enc::ADDI(x15, x31, 1024) == 0x400F8793);
+    STATIC_REQUIRE(enc::LUI(x10, 0xFFFFF) == 0xFFFFF537);
+    STATIC_REQUIRE(enc::SW(x31, 1024, x15) == 0x41F7A023);
+    STATIC_REQUIRE(enc::NOP() == 0x00000013);
+    STATIC_REQUIRE(enc::RET() == 0x00008067);
+}
+
+TEST_CASE("Instruction encoders match the assembler", "[encoding]") {
+    std::array<uint32_t, 32> buffer{};
+    auto as = MakeAssembler64(buffer);
+
+    // The same operations, in the same order, as the encoded array below.
+    static constexpr std::array encoded{
+        enc::ADD(x1, x2, x3),     enc::ADDI(x5, x6, -1),     enc::AND(x7, x8, x9),
+        enc::ANDI(x10, x11, 0x7F), enc::AUIPC(x12, -1),      enc::BEQ(x1, x2, -8),
+        enc::BGE(x3, x4, 16),     enc::BGEU(x5, x6, 2048),   enc::BLT(x7, x8, -4096),
+        enc::BLTU(x9, x10, 4094), enc::BNE(x11, x12, 0),     enc::JAL(x1, -0x80000),
+        enc::JALR(x2, -2048, x3), enc::LB(x4, 5, x5),        enc::LBU(x6, -5, x7),
+        enc::LD(x8, 2047, x9),    enc::LH(x10, 8, x11),      enc::LHU(x12, 16, x13),
+        enc::LW(x14, -16, x15),   enc::LWU(x16, 32, x17),    enc::SB(x18, 1, x19),
+        enc::SD(x20, -8, x21),    enc::SH(x22, 2, x23),      enc::SW(x24, 4, x25),
+        enc::SLLI(x26, x27, 63),  enc::SRAI(x28, x29, 33),   enc::SRLIW(x30, x31, 31),
+        enc::MUL(x1, x2, x3),     enc::DIVUW(x4, x5, x6),    enc::REMU(x7, x8, x9),
+        enc::SUBW(x10, x11, x12), enc::NOT(x13, x14),
+    };
+
+    as.ADD(x1, x2, x3);
+    as.ADDI(x5, x6, -1);
+    as.AND(x7, x8, x9);
+    as.ANDI(x10, x11, 0x7F);
+    as.AUIPC(x12, -1);
+    as.BEQ(x1, x2, -8);
+    as.BGE(x3, x4, 16);
+    as.BGEU(x5, x6, 2048);
+    as.BLT(x7, x8, -4096);
+    as.BLTU(x9, x10, 4094);
+    as.BNE(x11, x12, 0);
+    as.JAL(x1, -0x80000);
+    as.JALR(x2, -2048, x3);
+    as.LB(x4, 5, x5);
+    as.LBU(x6, -5, x7);
+    as.LD(x8, 2047, x9);
+    as.LH(x10, 8, x11);
+    as.LHU(x12, 16, x13);
+    as.LW(x14, -16, x15);
+    as.LWU(x16, 32, x17);
+    as.SB(x18, 1, x19);
+    as.SD(x20, -8, x21);
+    as.SH(x22, 2, x23);
+    as.SW(x24, 4, x25);
+    as.SLLI(x26, x27, 63);
+    as.SRAI(x28, x29, 33);
+    as.SRLIW(x30, x31, 31);
+    as.MUL(x1, x2, x3);
+    as.DIVUW(x4, x5, x6);
+    as.REMU(x7, x8, x9);
+    as.SUBW(x10, x11, x12);
+    as.NOT(x13, x14);
+
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == sizeof(encoded));
+    for (size_t i = 0; i < encoded.size(); i++) {
+        INFO("index " << i);
+        REQUIRE(buffer[i] == encoded[i]);
+    }
+}
+
+TEST_CASE("Compile-time sequences can be copied into a code buffer", "[encoding]") {
+    // Loads a function pointer out of the structure pointed to by a0 and tail-calls it.
+    static constexpr std::array thunk{
+        enc::LD(t0, 8, a0),
+        enc::JR(t0),
+    };
+
+    CodeBuffer buffer{64};
+    {
+        auto reservation = buffer.Reserve(sizeof(thunk));
+        for (const auto word : thunk) {
+            reservation.Emit32(word);
+        }
+    }
+
+    std::array<uint32_t, 2> expected{};
+    auto as = MakeAssembler64(expected);
+    as.LD(t0, 8, a0);
+    as.JR(t0);
+
+    REQUIRE(std::memcmp(buffer.GetOffsetPointer(0), expected.data(), sizeof(expected)) == 0);
+}
@@ -0,0 +1,91 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/cpuinfo.hpp>
+#include <biscuit/extensions.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Extension set operations", "[extensions]") {
+    ExtensionSet set{Extension::C, Extension::Zba};
+    REQUIRE(set.Has(Extension::C));
+    REQUIRE(set.Has(Extension::Zba));
+    REQUIRE(!set.Has(Extension::Zbb));
+
+    set.Add(Extension::Zbb).Remove(Extension::C);
+    REQUIRE(!set.Has(Extension::C));
+    REQUIRE(set.HasAll({Extension::Zba, Extension::Zbb}));
+    REQUIRE(!set.HasAll({Extension::Zba, Extension::C}));
+
+    REQUIRE(ExtensionSet{}.IsEmpty());
+    REQUIRE(set.HasAll(ExtensionSet{}));
+}
+
+TEST_CASE("Extension profiles", "[extensions]") {
+    constexpr auto rva20 = ExtensionSet::RVA20U64();
+    constexpr auto rva22 = ExtensionSet::RVA22U64();
+    constexpr auto rva23 = ExtensionSet::RVA23U64();
+
+    static_assert(rva22.HasAll(rva20));
+    static_assert(rva23.HasAll(rva22));
+
+    STATIC_REQUIRE(rva20.HasAll({Extension::M, Extension::A, Extension::F,
+                                 Extension::D, Extension::C}));
+    STATIC_REQUIRE(rva22.HasAll({Extension::Zba, Extension::Zbb, Extension::Zbs}));
+    STATIC_REQUIRE(!rva22.Has(Extension::V));
+    STATIC_REQUIRE(rva23.HasAll({Extension::V, Extension::Zcb, Extension::Zicond}));
+}
+
+TEST_CASE("Extension profiles affect code generation", "[extensions]") {
+    std::array<uint32_t, 2> vals{};
+    auto as = MakeAssembler64(vals);
+    as.SetExtensions(ExtensionSet::RVA22U64());
+
+    // Compressible, and Zbs turns this into a single instruction.
+    as.LI(x10, 1);
+    as.LI(x11, uint64_t{1} << 40);
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == 6);
+}
+
+TEST_CASE("Detected extensions are consistent with CPUInfo", "[extensions]") {
+    const CPUInfo info;
+    const auto extensions = info.GetExtensions();
+
+    REQUIRE(extensions.Has(Extension::C) == info.Has(RISCVExtension::C));
+    REQUIRE(extensions.Has(Extension::V) == info.Has(RISCVExtension::V));
+}
+
+TEST_CASE("Host detection results are cached", "[extensions]") {
+    const CPUInfo info;
+    REQUIRE(info.GetExtensions() == CPUInfo{}.GetExtensions());
+    REQUIRE(info.GetMisalignedAccess() == CPUInfo{}.GetMisalignedAccess());
+
+#if !defined(__riscv)
+    // Nothing can be detected when not running on RISC-V.
+    REQUIRE(info.GetExtensions().IsEmpty());
+    REQUIRE(info.GetMisalignedAccess() == MisalignedAccess::Unknown);
+    REQUIRE(info.GetVendorID() == 0);
+#endif
+}
+
+TEST_CASE("CPUInfo snapshot matches individual queries", "[extensions]") {
+    const CPUInfo info;
+    const auto& snapshot = info.GetSnapshot();
+
+    // The snapshot is taken once and shared by every CPUInfo instance.
+    REQUIRE(&snapshot == &CPUInfo{}.GetSnapshot());
+
+    REQUIRE(snapshot.extensions == info.GetExtensions());
+    REQUIRE(snapshot.misaligned_access == info.GetMisalignedAccess());
+    REQUIRE(snapshot.vendor_id == info.GetVendorID());
+    REQUIRE(snapshot.arch_id == info.GetArchID());
+    REQUIRE(snapshot.impl_id == info.GetImplID());
+    REQUIRE(snapshot.vlenb == info.GetVlenb());
+
+    if (!info.Has(RISCVExtension::V)) {
+        REQUIRE(info.GetVlenb() == 0);
+    }
+}
@@ -0,0 +1,161 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <biscuit/assembler.hpp>
+#include <biscuit/frame.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Frames with Zcmp", "[frame]") {
+    std::array<uint8_t, 64> buffer{};
+    std::array<uint8_t, 64> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+    as.SetExtensions({Extension::C, Extension::Zcmp});
+
+    const std::array<GPR, 3> saved{ra, s0, s1};
+    FrameBuilder frame{as, saved, 32};
+    REQUIRE(frame.GetStrategy() == FrameStrategy::Push);
+    REQUIRE(frame.GetFrameSize() == 64);
+    REQUIRE(frame.GetSaveSlot(s1) == 56);
+    REQUIRE(frame.GetSaveSlot(s0) == 48);
+    REQUIRE(frame.GetSaveSlot(ra) == 40);
+    REQUIRE_FALSE(frame.GetSaveSlot(s2));
+
+    frame.EmitPrologue();
+    frame.EmitEpilogue();
+    ref.CM_PUSH({ra, {s0, s1}}, -64);
+    ref.CM_POPRET({ra, {s0, s1}}, 64);
+
+    // Locals that don't fit within CM.PUSH's adjustment are allocated separately.
+    FrameBuilder large{as, saved, 200};
+    REQUIRE(large.GetFrameSize() == 240);
+    large.EmitPrologue();
+    large.EmitEpilogue();
+    ref.CM_PUSH({ra, {s0, s1}}, -80);
+    ref.C_ADDI16SP(-160);
+    ref.C_ADDI16SP(160);
+    ref.CM_POPRET({ra, {s0, s1}}, 80);
+
+    const auto size = ref.GetCodeBuffer().GetSizeInBytes();
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == size);
+    REQUIRE(std::memcmp(buffer.data(), expected.data(), size) == 0);
+}
+
+TEST_CASE("Frames with Zcmp save s10 and s11 together", "[frame]") {
+    std::array<uint8_t, 16> buffer{};
+    auto as = MakeAssembler64(buffer);
+    as.SetExtensions({Extension::Zcmp});
+
+    const std::array<GPR, 1> saved{s10};
+    const FrameBuilder frame{as, saved, 0};
+    REQUIRE(frame.GetFrameSize() == 112);
+    REQUIRE(frame.GetSaveSlot(s11) == 104);
+    REQUIRE(frame.GetSaveSlot(s9) == 88);
+    REQUIRE(frame.GetSaveSlot(ra) == 8);
+}
+
+TEST_CASE("Frames with inline saves", "[frame]") {
+    std::array<uint8_t, 64> buffer{};
+    std::array<uint8_t, 64> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+    as.SetExtensions({Extension::C});
+
+    // Only the registers that are actually used are saved.
+    const std::array<GPR, 2> saved{s1, ra};
+    FrameBuilder frame{as, saved, 0};
+    REQUIRE(frame.GetStrategy() == FrameStrategy::Inline);
+    REQUIRE(frame.GetFrameSize() == 16);
+    REQUIRE(frame.GetSaveSlot(s1) == 8);
+    REQUIRE(frame.GetSaveSlot(ra) == 0);
+    REQUIRE_FALSE(frame.GetSaveSlot(s0));
+
+    frame.EmitPrologue();
+    frame.EmitEpilogue();
+    ref.C_ADDI16SP(-16);
+    ref.C_SDSP(s1, 8);
+    ref.C_SDSP(ra, 0);
+    ref.C_LDSP(s1, 8);
+    ref.C_LDSP(ra, 0);
+    ref.C_ADDI16SP(16);
+    ref.RET();
+
+    const auto size = ref.GetCodeBuffer().GetSizeInBytes();
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == size);
+    REQUIRE(std::memcmp(buffer.data(), expected.data(), size) == 0);
+}
+
+TEST_CASE("Frames with inline saves and large locals", "[frame]") {
+    std::array<uint8_t, 64> buffer{};
+    std::array<uint8_t, 64> expected{};
+    auto as = MakeAssembler32(buffer);
+    auto ref = MakeAssembler32(expected);
+
+    const std::array<GPR, 1> saved{ra};
+    FrameBuilder frame{as, saved, 4096};
+    REQUIRE(frame.GetFrameSize() == 4112);
+    REQUIRE(frame.GetSaveSlot(ra) == 4108);
+
+    frame.EmitPrologue();
+    frame.EmitEpilogue();
+    ref.ADDI(sp, sp, -16);
+    ref.SW(ra, 12, sp);
+    ref.LI(t0, static_cast<uint64_t>(-4096));
+    ref.ADD(sp, sp, t0);
+    ref.LI(t0, 4096);
+    ref.ADD(sp, sp, t0);
+    ref.LW(ra, 12, sp);
+    ref.ADDI(sp, sp, 16);
+    ref.RET();
+
+    const auto size = ref.GetCodeBuffer().GetSizeInBytes();
+    REQUIRE(as.GetCodeBuffer().GetSizeInBytes() == size);
+    REQUIRE(std::memcmp(buffer.data(), expected.data(), size) == 0);
+}
+
+TEST_CASE("Frames with shared stubs", "[frame]") {
+    std::array<uint8_t, 64> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+
+    FrameStubs stubs;
+    const std::array<GPR, 1> saved{s0};
+
+    FrameBuilder first{as, saved, 0, FrameStrategy::Auto, &stubs};
+    REQUIRE(first.GetStrategy() == FrameStrategy::Stubs);
+    REQUIRE(first.GetFrameSize() == 16);
+    REQUIRE(first.GetSaveSlot(s0) == 8);
+    REQUIRE(first.GetSaveSlot(ra) == 0);
+    first.EmitPrologue();
+    first.EmitEpilogue();
+
+    FrameBuilder second{as, saved, 0, FrameStrategy::Stubs, &stubs};
+    second.EmitPrologue();
+    second.EmitEpilogue();
+    REQUIRE(code.GetSizeInBytes() == 16);
+
+    // Both frames share the same pair of stubs.
+    stubs.Emit(as);
+    REQUIRE(code.GetSizeInBytes() == 48);
+    REQUIRE(ReadWord(code, 0) == enc::JAL(t0, 16));
+    REQUIRE(ReadWord(code, 4) == enc::JAL(x0, 28));
+    REQUIRE(ReadWord(code, 8) == enc::JAL(t0, 8));
+    REQUIRE(ReadWord(code, 12) == enc::JAL(x0, 20));
+
+    REQUIRE(ReadWord(code, 16) == enc::ADDI(sp, sp, -16));
+    REQUIRE(ReadWord(code, 20) == enc::SD(s0, 8, sp));
+    REQUIRE(ReadWord(code, 24) == enc::SD(ra, 0, sp));
+    REQUIRE(ReadWord(code, 28) == enc::JALR(x0, 0, t0));
+    REQUIRE(ReadWord(code, 32) == enc::LD(s0, 8, sp));
+    REQUIRE(ReadWord(code, 36) == enc::LD(ra, 0, sp));
+    REQUIRE(ReadWord(code, 40) == enc::ADDI(sp, sp, 16));
+    REQUIRE(ReadWord(code, 44) == enc::JALR(x0, 0, ra));
+
+    // Stubs are only ever emitted once.
+    stubs.Emit(as);
+    REQUIRE(code.GetSizeInBytes() == 48);
+}
@@ -0,0 +1,99 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/jump_vector_table.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Jump vector table indices", "[jvt]") {
+    JumpVectorTable table;
+    REQUIRE(table.GetEntryCount() == 64);
+
+    Label a;
+    Label b;
+    REQUIRE(table.AddJump(&a) == 0U);
+    REQUIRE(table.AddJump(0x1000) == 1U);
+    REQUIRE(table.AddCall(&b) == 32U);
+    REQUIRE(table.AddCall(0x2000) == 33U);
+
+    // Existing targets are reused.
+    REQUIRE(table.AddJump(&a) == 0U);
+    REQUIRE(table.AddCall(0x2000) == 33U);
+
+    // Jumps and calls are kept apart, since they're reached by different instructions.
+    REQUIRE(table.AddCall(&a) == 34U);
+
+    for (uintptr_t i = 2; i < JumpVectorTable::jump_entry_count; i++) {
+        REQUIRE(table.AddJump(0x3000 + i) == i);
+    }
+    REQUIRE_FALSE(table.AddJump(0x4000));
+
+    // Tables without call entries only support jumps.
+    JumpVectorTable small{16};
+    REQUIRE_FALSE(small.AddCall(0x1000));
+
+    std::array<uint8_t, 1024> buffer{};
+    auto as = MakeAssembler64(buffer);
+    as.Bind(&a);
+    as.Bind(&b);
+    table.Emit(as);
+    small.Emit(as);
+}
+
+TEST_CASE("Jump vector table emission", "[jvt]") {
+    alignas(64) std::array<uint8_t, 1024> buffer{};
+    auto as = MakeAssembler64(buffer);
+    auto& code = as.GetCodeBuffer();
+
+    JumpVectorTable table;
+    Label helper;
+    const auto jump = table.AddJump(0x12345678);
+    const auto call = table.AddCall(&helper);
+
+    table.EmitSetup(as, t0);
+    as.CM_JALT(*call);
+    as.CM_JT(*jump);
+
+    as.Bind(&helper);
+    as.RET();
+
+    table.Emit(as);
+    const auto table_offset = *table.GetLabel()->GetLocation();
+    REQUIRE(table_offset == 64);
+    REQUIRE(code.GetCursorOffset() == table_offset + 64 * 8);
+
+    REQUIRE(ReadValue<uint64_t>(code, table_offset) == 0x12345678);
+    REQUIRE(ReadValue<uint64_t>(code, table_offset + 8) == 0);
+    REQUIRE(ReadValue<uint64_t>(code, table_offset + 32 * 8) == code.GetOffsetAddress(16));
+
+    // jvt is pointed at the table, with its mode bits clear.
+    uint32_t csrw = 0;
+    auto ref = MakeAssembler64(csrw);
+    ref.CSWR(CSR::JVT, t0);
+    REQUIRE(ReadWord(code, 4) == enc::ADDI(t0, t0, 64));
+    REQUIRE(ReadWord(code, 8) == csrw);
+}
+
+TEST_CASE("Jump vector table emission on RV32", "[jvt]") {
+    alignas(64) std::array<uint8_t, 512> buffer{};
+    auto as = MakeAssembler32(buffer);
+    auto& code = as.GetCodeBuffer();
+
+    JumpVectorTable table;
+    as.RET();
+
+    table.AddJump(0x8000);
+    table.AddCall(0x9000);
+    table.Emit(as);
+
+    // Entries are XLEN-wide.
+    const auto table_offset = *table.GetLabel()->GetLocation();
+    REQUIRE(table_offset == 64);
+    REQUIRE(code.GetCursorOffset() == table_offset + 64 * 4);
+    REQUIRE(ReadWord(code, table_offset) == 0x8000);
+    REQUIRE(ReadWord(code, table_offset + 4) == 0);
+    REQUIRE(ReadWord(code, table_offset + 32 * 4) == 0x9000);
+}
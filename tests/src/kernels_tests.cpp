@@ -0,0 +1,142 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/kernels.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("memcpy kernel", "[kernels]") {
+    std::array<uint32_t, 16> buffer{};
+    std::array<uint32_t, 16> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+
+    REQUIRE(EmitMemcpyKernel(as, {.vlenb = 16}) == 0);
+
+    ref.MV(a3, a0);
+    ref.VSETVLI(t0, a2, SEW::E8, LMUL::M8, VTA::Yes, VMA::Yes);
+    ref.VLE8(v8, a1);
+    ref.VSE8(v8, a3);
+    ref.SUB(a2, a2, t0);
+    ref.ADD(a3, a3, t0);
+    ref.ADD(a1, a1, t0);
+    ref.BNEZ(a2, -24);
+    ref.RET();
+
+    REQUIRE(buffer == expected);
+}
+
+TEST_CASE("memset kernel", "[kernels]") {
+    std::array<uint32_t, 16> buffer{};
+    std::array<uint32_t, 16> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+
+    // Small typical sizes only need a group that covers them.
+    EmitMemsetKernel(as, {.vlenb = 16, .typical_size = 32});
+
+    ref.MV(a3, a0);
+    ref.VSETVLI(t0, x0, SEW::E8, LMUL::M2, VTA::Yes, VMA::Yes);
+    ref.VMV(v8, a1);
+    ref.VSETVLI(t0, a2, SEW::E8, LMUL::M2, VTA::Yes, VMA::Yes);
+    ref.VSE8(v8, a3);
+    ref.SUB(a2, a2, t0);
+    ref.ADD(a3, a3, t0);
+    ref.BNEZ(a2, -16);
+    ref.RET();
+
+    REQUIRE(buffer == expected);
+}
+
+TEST_CASE("memcmp kernel", "[kernels]") {
+    std::array<uint32_t, 32> buffer{};
+    std::array<uint32_t, 32> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+
+    EmitMemcmpKernel(as, {.vlenb = 32});
+
+    ref.VSETVLI(t0, a2, SEW::E8, LMUL::M8, VTA::Yes, VMA::Yes);
+    ref.VLE8(v8, a0);
+    ref.VLE8(v16, a1);
+    ref.VMSNE(v0, v8, v16);
+    ref.VFIRST(t1, v0);
+    ref.BGEZ(t1, 28);
+    ref.SUB(a2, a2, t0);
+    ref.ADD(a0, a0, t0);
+    ref.ADD(a1, a1, t0);
+    ref.BNEZ(a2, -36);
+    ref.LI(a0, 0);
+    ref.RET();
+    ref.ADD(a0, a0, t1);
+    ref.ADD(a1, a1, t1);
+    ref.LBU(t2, 0, a0);
+    ref.LBU(t3, 0, a1);
+    ref.SUB(a0, t2, t3);
+    ref.RET();
+
+    REQUIRE(buffer == expected);
+}
+
+TEST_CASE("strlen kernel", "[kernels]") {
+    std::array<uint32_t, 16> buffer{};
+    std::array<uint32_t, 16> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+
+    EmitStrlenKernel(as, {.vlenb = 16});
+
+    ref.MV(a1, a0);
+    ref.VSETVLI(t0, x0, SEW::E8, LMUL::M8, VTA::Yes, VMA::Yes);
+    ref.VLE8FF(v8, a1);
+    ref.CSRR(t0, CSR::VL);
+    ref.VMSEQ(v0, v8, 0);
+    ref.VFIRST(t1, v0);
+    ref.ADD(a1, a1, t0);
+    ref.BLTZ(t1, -24);
+    ref.SUB(a0, a1, a0);
+    ref.SUB(a0, a0, t0);
+    ref.ADD(a0, a0, t1);
+    ref.RET();
+
+    REQUIRE(buffer == expected);
+}
+
+TEST_CASE("CRC-32 kernel requirements", "[kernels]") {
+    std::array<uint32_t, 128> buffer{};
+    auto as64 = MakeAssembler64(buffer);
+    REQUIRE_FALSE(EmitCRC32Kernel(as64));
+
+    as64.SetExtensions({Extension::V, Extension::Zvbc});
+    const auto offset = EmitCRC32Kernel(as64);
+    REQUIRE(offset == 0);
+
+    // Returns with the checksum sign-extended.
+    const auto size = as64.GetCodeBuffer().GetSizeInBytes() / 4;
+    REQUIRE(buffer[size - 2] == enc::ADDIW(a0, a0, 0));
+    REQUIRE(buffer[size - 1] == enc::JALR(x0, 0, ra));
+
+    auto as32 = MakeAssembler32(buffer);
+    as32.SetExtensions({Extension::V, Extension::Zvbc});
+    REQUIRE_FALSE(EmitCRC32Kernel(as32));
+}
+
+TEST_CASE("Runtime kernel pointers", "[kernels]") {
+    Assembler as;
+    auto& code = as.GetCodeBuffer();
+
+    const auto kernels = EmitRuntimeKernels(as, {.vlenb = 16});
+    REQUIRE(reinterpret_cast<uintptr_t>(kernels.memcpy) == code.GetOffsetAddress(0));
+    REQUIRE(kernels.memset != nullptr);
+    REQUIRE(kernels.memcmp != nullptr);
+    REQUIRE(kernels.strlen != nullptr);
+    REQUIRE(kernels.crc32 == nullptr);
+
+    const auto strlen_offset = code.GetCursorOffset();
+    EmitStrlenKernel(as, {.vlenb = 16});
+    REQUIRE(GetKernel<StrlenKernel>(code, strlen_offset) ==
+            reinterpret_cast<StrlenKernel>(code.GetOffsetAddress(strlen_offset)));
+}
@@ -0,0 +1,168 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/decoder.hpp>
+#include <biscuit/encoding.hpp>
+#include <biscuit/lazy_stubs.hpp>
+#include <cstring>
+#include <string_view>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+template <size_t N>
+std::array<uint32_t, 3> ReadStub(const std::array<uint32_t, N>& code, ptrdiff_t offset) {
+    std::array<uint32_t, 3> stub{};
+    std::memcpy(stub.data(), reinterpret_cast<const uint8_t*>(code.data()) + offset, sizeof(stub));
+    return stub;
+}
+
+size_t CountMnemonic(const Assembler& as, ptrdiff_t begin, ptrdiff_t end, std::string_view mnemonic) {
+    const Decoder decoder{as.GetArchFeatures(), as.GetExtensions()};
+
+    size_t count = 0;
+    for (auto offset = begin; offset < end;) {
+        const std::span<const uint8_t> code{as.GetBufferPointer(offset), static_cast<size_t>(end - offset)};
+        const auto instruction = decoder.Decode(code);
+        REQUIRE(instruction);
+
+        count += instruction->mnemonic == mnemonic;
+        offset += instruction->length;
+    }
+    return count;
+}
+} // Anonymous namespace
+
+TEST_CASE("Lazy Stub Emission", "[lazy_stubs]") {
+    std::array<uint32_t, 128> code{};
+    auto as = MakeAssembler64(code);
+
+    LazyStubs stubs{as, [](uint32_t) -> uintptr_t { return 0; }};
+    stubs.EmitResolver();
+    REQUIRE(stubs.GetResolverOffset() == 0);
+
+    // Stubs call back into the resolver, with their ID following the pair.
+    Label entry;
+    as.C_NOP();
+    const auto first = stubs.EmitStub(&entry);
+    const auto second = stubs.EmitStub();
+    REQUIRE(first == 0);
+    REQUIRE(second == 1);
+    REQUIRE(stubs.GetStubCount() == 2);
+
+    const auto offset = stubs.GetStubOffset(first);
+    REQUIRE(offset % 4 == 0);
+    REQUIRE(*entry.GetLocation() == offset);
+    REQUIRE(stubs.GetStubOffset(second) == offset + static_cast<ptrdiff_t>(LazyStubs::stub_size));
+
+    const auto to_resolver = static_cast<int32_t>(-offset);
+    REQUIRE(ReadStub(code, offset) == std::array{
+        enc::AUIPC(t0, 0),
+        enc::JALR(t0, to_resolver, t0),
+        uint32_t{0},
+    });
+    REQUIRE(ReadStub(code, stubs.GetStubOffset(second))[2] == 1);
+    REQUIRE(!stubs.GetTarget(first));
+}
+
+TEST_CASE("Lazy Stub Resolution", "[lazy_stubs]") {
+    std::array<uint32_t, 128> code{};
+    auto as = MakeAssembler64(code);
+    auto& buffer = as.GetCodeBuffer();
+
+    // Functions are compiled into the same buffer, after the stubs.
+    size_t compilations = 0;
+    ptrdiff_t function_offset = 0;
+    LazyStubs stubs{as, [&](uint32_t id) {
+        compilations++;
+        function_offset = buffer.GetCursorOffset();
+        as.ADDI(a0, a0, static_cast<int32_t>(id));
+        as.RET();
+        return buffer.GetOffsetAddress(function_offset);
+    }};
+    stubs.EmitResolver();
+    const auto id = stubs.EmitStub();
+    const auto offset = stubs.GetStubOffset(id);
+
+    const auto target = stubs.Resolve(id);
+    REQUIRE(compilations == 1);
+    REQUIRE(target == buffer.GetOffsetAddress(function_offset));
+    REQUIRE(stubs.GetTarget(id) == target);
+
+    // Only the JALR is rewritten, keeping t0 as its link register so ra is untouched.
+    const auto to_function = static_cast<int32_t>(function_offset - offset);
+    REQUIRE(ReadStub(code, offset) == std::array{
+        enc::AUIPC(t0, 0),
+        enc::JALR(t0, to_function, t0),
+        id,
+    });
+
+    // Functions are only ever compiled once.
+    REQUIRE(stubs.Resolve(id) == target);
+    REQUIRE(compilations == 1);
+}
+
+TEST_CASE("Lazy Stub Resolution (Out of Range)", "[lazy_stubs]") {
+    std::array<uint32_t, 128> code{};
+    auto as = MakeAssembler64(code);
+
+    // A target that can't be reached from the stub's AUIPC, or with a JAL.
+    const auto far = as.GetCodeBuffer().GetOffsetAddress(0) + 0x10000000;
+    size_t compilations = 0;
+    LazyStubs stubs{as, [&](uint32_t) {
+        compilations++;
+        return far;
+    }};
+    stubs.EmitResolver();
+    const auto id = stubs.EmitStub();
+    const auto original = ReadStub(code, stubs.GetStubOffset(id));
+
+    // The stub keeps going through the resolver, which forwards to the compiled function.
+    REQUIRE(stubs.Resolve(id) == far);
+    REQUIRE(ReadStub(code, stubs.GetStubOffset(id)) == original);
+    REQUIRE(stubs.Resolve(id) == far);
+    REQUIRE(compilations == 1);
+}
+
+TEST_CASE("Lazy Stub Resolver", "[lazy_stubs]") {
+    SECTION("RV64 with D") {
+        std::array<uint32_t, 128> code{};
+        auto as = MakeAssembler64(code);
+        as.SetExtensions({Extension::F, Extension::D});
+
+        LazyStubs stubs{as, [](uint32_t) -> uintptr_t { return 0; }};
+        stubs.EmitResolver();
+        const auto end = as.GetCodeBuffer().GetCursorOffset();
+
+        // ra and a0-a7 are saved and restored, along with fa0-fa7.
+        REQUIRE(CountMnemonic(as, 0, end, "sd") == 9);
+        REQUIRE(CountMnemonic(as, 0, end, "ld") == 9);
+        REQUIRE(CountMnemonic(as, 0, end, "fsd") == 8);
+        REQUIRE(CountMnemonic(as, 0, end, "fld") == 8);
+        REQUIRE(CountMnemonic(as, 0, end, "lwu") == 1);
+
+        // The resolver frame is 16-byte aligned.
+        REQUIRE(code[0] == enc::ADDI(sp, sp, -144));
+        REQUIRE(code[end / 4 - 1] == enc::JALR(x0, 0, t1));
+    }
+
+    SECTION("RV32") {
+        std::array<uint32_t, 128> code{};
+        auto as = MakeAssembler32(code);
+
+        LazyStubs stubs{as, [](uint32_t) -> uintptr_t { return 0; }};
+        stubs.EmitResolver();
+        const auto end = as.GetCodeBuffer().GetCursorOffset();
+
+        // Without F or D, only integer registers are saved. The ID is read with an LW.
+        REQUIRE(CountMnemonic(as, 0, end, "sw") == 9);
+        REQUIRE(CountMnemonic(as, 0, end, "lw") == 10);
+        REQUIRE(CountMnemonic(as, 0, end, "fsw") == 0);
+
+        REQUIRE(code[0] == enc::ADDI(sp, sp, -48));
+        REQUIRE(code[end / 4 - 1] == enc::JALR(x0, 0, t1));
+    }
+}
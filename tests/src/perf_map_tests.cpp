@@ -0,0 +1,161 @@
+#include <catch/catch.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <biscuit/assembler.hpp>
+#include <biscuit/perf_map.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+std::string GetTestPath(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+std::string ToHex(uintptr_t value) {
+    std::ostringstream stream;
+    stream << std::hex << value;
+    return stream.str();
+}
+} // Anonymous namespace
+
+TEST_CASE("Perf map symbols", "[perf_map]") {
+    const auto path = GetTestPath("biscuit-perf-map-test.map");
+    std::filesystem::remove(path);
+
+    Assembler as{64};
+    auto& buffer = as.GetCodeBuffer();
+    as.NOP();
+    as.NOP();
+    as.RET();
+
+    {
+        PerfMap perf_map{path};
+        REQUIRE(perf_map.IsOpen());
+        perf_map.AddSymbol(buffer, {0, 12}, "function");
+    }
+
+    std::ifstream file{path};
+    std::string line;
+    REQUIRE(std::getline(file, line));
+    REQUIRE(line == ToHex(buffer.GetOffsetAddress(0)) + " c function");
+    REQUIRE(!std::getline(file, line));
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Perf map symbols broken down by labels", "[perf_map]") {
+    const auto path = GetTestPath("biscuit-perf-map-labels-test.map");
+    std::filesystem::remove(path);
+
+    Assembler as{64};
+    auto& buffer = as.GetCodeBuffer();
+
+    Label loop;
+    Label exit;
+    Label unbound;
+    Label also_exit;
+    as.NOP();
+    as.Bind(&loop);
+    as.ADDI(a0, a0, -1);
+    as.BNEZ(a0, &loop);
+    as.Bind(&exit);
+    as.Bind(&also_exit);
+    as.RET();
+
+    const PerfLabel labels[]{
+        {&exit, "exit"},
+        {&unbound, "unbound"},
+        {&loop, "loop"},
+        {&also_exit, "also_exit"},
+    };
+
+    {
+        PerfMap perf_map{path};
+        perf_map.AddSymbol(buffer, {0, 16}, "function", labels);
+    }
+
+    std::ifstream file{path};
+    std::string line;
+    REQUIRE(std::getline(file, line));
+    REQUIRE(line == ToHex(buffer.GetOffsetAddress(0)) + " 4 function");
+    REQUIRE(std::getline(file, line));
+    REQUIRE(line == ToHex(buffer.GetOffsetAddress(4)) + " 8 function:loop");
+    REQUIRE(std::getline(file, line));
+    REQUIRE(line == ToHex(buffer.GetOffsetAddress(12)) + " 4 function:exit");
+    REQUIRE(!std::getline(file, line));
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Jitdump records", "[perf_map]") {
+    const auto path = GetTestPath("biscuit-jitdump-test.dump");
+
+    Assembler as{64};
+    auto& buffer = as.GetCodeBuffer();
+
+    Label label;
+    as.NOP();
+    as.Bind(&label);
+    as.RET();
+
+    const PerfLabel labels[]{{&label, "ret"}};
+    {
+        JitDump dump{path};
+        REQUIRE(dump.IsOpen());
+        dump.AddSymbol(buffer, {0, 8}, "function", labels);
+    }
+
+    const auto data = ReadFile(path);
+    REQUIRE(data.size() >= 40);
+
+    // Header
+    REQUIRE(ReadValue<uint32_t>(data, 0) == 0x4A695444);
+    REQUIRE(ReadValue<uint32_t>(data, 4) == 1);
+    REQUIRE(ReadValue<uint32_t>(data, 8) == 40);
+    REQUIRE(ReadValue<uint32_t>(data, 12) == 243);
+
+    // Line table
+    size_t offset = 40;
+    REQUIRE(ReadValue<uint32_t>(data, offset) == 2);
+    const auto debug_size = ReadValue<uint32_t>(data, offset + 4);
+    REQUIRE(debug_size == 16 + 16 + 16 + 4);
+    REQUIRE(ReadValue<uint64_t>(data, offset + 16) == buffer.GetOffsetAddress(0));
+    REQUIRE(ReadValue<uint64_t>(data, offset + 24) == 1);
+    REQUIRE(ReadValue<uint64_t>(data, offset + 32) == buffer.GetOffsetAddress(4));
+    REQUIRE(ReadValue<uint32_t>(data, offset + 40) == 1);
+    REQUIRE(std::strcmp(reinterpret_cast<const char*>(data.data() + offset + 48), "ret") == 0);
+    offset += debug_size;
+
+    // Code load
+    REQUIRE(ReadValue<uint32_t>(data, offset) == 0);
+    const auto load_size = ReadValue<uint32_t>(data, offset + 4);
+    REQUIRE(load_size == 16 + 40 + 9 + 8);
+    REQUIRE(ReadValue<uint64_t>(data, offset + 24) == buffer.GetOffsetAddress(0));
+    REQUIRE(ReadValue<uint64_t>(data, offset + 32) == buffer.GetOffsetAddress(0));
+    REQUIRE(ReadValue<uint64_t>(data, offset + 40) == 8);
+    REQUIRE(ReadValue<uint64_t>(data, offset + 48) == 0);
+    REQUIRE(std::strcmp(reinterpret_cast<const char*>(data.data() + offset + 56), "function") == 0);
+    REQUIRE(std::memcmp(data.data() + offset + 65, buffer.GetOffsetPointer(0), 8) == 0);
+    offset += load_size;
+
+    // Close
+    REQUIRE(ReadValue<uint32_t>(data, offset) == 3);
+    REQUIRE(ReadValue<uint32_t>(data, offset + 4) == 16);
+    REQUIRE(data.size() == offset + 16);
+
+    std::filesystem::remove(path);
+}
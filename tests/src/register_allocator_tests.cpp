@@ -0,0 +1,333 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <vector>
+#include <biscuit/assembler.hpp>
+#include <biscuit/code_stream.hpp>
+#include <biscuit/frame.hpp>
+#include <biscuit/register_allocator.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+using RA = RegisterAllocator;
+
+TEST_CASE("Register Allocation", "[register_allocator]") {
+    std::array<uint32_t, 4> value{};
+    auto as = MakeAssembler64(value);
+
+    VReg a, b, c;
+    const auto body = [&](Assembler& as, RegisterAllocator& alloc) {
+        a = alloc.NewVReg();
+        b = alloc.NewVReg();
+        c = alloc.NewVReg();
+
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 1); }, RA::Def(a));
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 2); }, RA::Def(b));
+        alloc.Emit([&](GPR d, GPR s1, GPR s2) { as.ADD(d, s1, s2); }, RA::Def(c), RA::Use(a), RA::Use(b));
+    };
+
+    RegisterAllocator alloc{as};
+    alloc.Analyze(body);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == 0);
+    REQUIRE(alloc.GetVRegCount() == 3);
+    REQUIRE(alloc.GetSpillCount() == 0);
+    REQUIRE(alloc.GetSpillAreaSize() == 0);
+    REQUIRE(alloc.GetUsedCalleeSaved().empty());
+
+    // Everything is still live at the last operation, so nothing can be shared.
+    REQUIRE(alloc.GetAssignment(a) == t0);
+    REQUIRE(alloc.GetAssignment(b) == t1);
+    REQUIRE(alloc.GetAssignment(c) == t2);
+
+    alloc.Generate(body);
+
+    std::array<uint32_t, 4> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.ADDI(t0, x0, 1);
+    expected_as.ADDI(t1, x0, 2);
+    expected_as.ADD(t2, t0, t1);
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Register Allocation (Reuse)", "[register_allocator]") {
+    std::array<uint32_t, 4> value{};
+    auto as = MakeAssembler64(value);
+
+    VReg a, b, c;
+    const auto body = [&](Assembler& as, RegisterAllocator& alloc) {
+        a = alloc.NewVReg();
+        b = alloc.NewVReg();
+        c = alloc.NewVReg();
+
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 1); }, RA::Def(a));
+        alloc.Emit([&](GPR d, GPR s) { as.ADDI(d, s, 2); }, RA::Def(b), RA::Use(a));
+        alloc.Emit([&](GPR d, GPR s) { as.ADDI(d, s, 3); }, RA::Def(c), RA::Use(b));
+    };
+
+    // Each range ends where the next starts, so the two registers are enough.
+    constexpr std::array allocatable{t0, t1};
+    RegisterAllocator alloc{as, allocatable};
+    alloc.Analyze(body);
+    REQUIRE(alloc.GetSpillCount() == 0);
+    REQUIRE(alloc.GetAssignment(a) == t0);
+    REQUIRE(alloc.GetAssignment(b) == t1);
+    REQUIRE(alloc.GetAssignment(c) == t0);
+}
+
+TEST_CASE("Register Allocation (Distinct Placeholders)", "[register_allocator]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler64(value);
+
+    // Emitters may emit different code for aliased operands, so distinct registers
+    // mustn't alias while analyzing either, even with few allocatable registers.
+    bool aliased = false;
+    const auto body = [&](Assembler& as, RegisterAllocator& alloc) {
+        const auto a = alloc.NewVReg();
+        const auto b = alloc.NewVReg();
+        const auto c = alloc.NewVReg();
+
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 1); }, RA::Def(a));
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 2); }, RA::Def(b));
+        alloc.Emit(
+            [&](GPR d, GPR s1, GPR s2) {
+                aliased |= d == s1 || d == s2 || s1 == s2;
+                as.ADD(d, s1, s2);
+            },
+            RA::Def(c), RA::Use(a), RA::Use(b));
+        alloc.Emit([&](GPR s1, GPR s2) { as.ADD(a0, s1, s2); }, RA::Use(c), RA::Use(c));
+    };
+
+    constexpr std::array allocatable{t0, t1};
+    RegisterAllocator alloc{as, allocatable};
+    alloc.Analyze(body);
+    REQUIRE_FALSE(aliased);
+
+    alloc.Generate(body);
+    REQUIRE_FALSE(aliased);
+}
+
+TEST_CASE("Register Allocation (Spilling)", "[register_allocator]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler64(value);
+
+    VReg a, b, c;
+    const auto body = [&](Assembler& as, RegisterAllocator& alloc) {
+        a = alloc.NewVReg();
+        b = alloc.NewVReg();
+        c = alloc.NewVReg();
+
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 1); }, RA::Def(a));
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 2); }, RA::Def(b));
+        alloc.Emit([&](GPR d, GPR s1, GPR s2) { as.ADD(d, s1, s2); }, RA::Def(c), RA::Use(a), RA::Use(b));
+        alloc.Emit([&](GPR s) { as.MV(a0, s); }, RA::Use(c));
+    };
+
+    constexpr std::array allocatable{t0};
+    RegisterAllocator alloc{as, allocatable};
+    alloc.Analyze(body);
+    REQUIRE(alloc.GetSpillCount() == 2);
+    REQUIRE(alloc.GetSpillAreaSize() == 16);
+    REQUIRE(alloc.GetAssignment(a) == t0);
+    REQUIRE(!alloc.GetAssignment(b));
+    REQUIRE(!alloc.GetAssignment(c));
+
+    alloc.Generate(body);
+
+    // Spilled registers are stored after being defined and reloaded
+    // before being used, unless nothing reads them anymore.
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.ADDI(t0, x0, 1);
+    expected_as.ADDI(t4, x0, 2);
+    expected_as.SD(t4, 0, sp);
+    expected_as.LD(t5, 0, sp);
+    expected_as.ADD(t4, t0, t5);
+    expected_as.SD(t4, 8, sp);
+    expected_as.LD(t4, 8, sp);
+    expected_as.MV(a0, t4);
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Register Allocation (Spilling RV32)", "[register_allocator]") {
+    std::array<uint32_t, 8> value{};
+    auto as = MakeAssembler32(value);
+
+    VReg a, b;
+    const auto body = [&](Assembler& as, RegisterAllocator& alloc) {
+        a = alloc.NewVReg();
+        b = alloc.NewVReg();
+
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 1); }, RA::Def(a));
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 2); }, RA::Def(b));
+        alloc.Emit([&](GPR d) { as.ADDI(d, d, 3); }, RA::UseDef(b));
+        alloc.Emit([&](GPR s1, GPR s2) { as.ADD(a0, s1, s2); }, RA::Use(a), RA::Use(b));
+    };
+
+    // Both ranges end together, so the newer one is spilled, into a slot after 8 bytes of other locals.
+    constexpr std::array allocatable{t0};
+    RegisterAllocator alloc{as, allocatable, RA::default_scratch, 8};
+    alloc.Analyze(body);
+    REQUIRE(alloc.GetSpillCount() == 1);
+    REQUIRE(alloc.GetSpillAreaSize() == 12);
+    REQUIRE(alloc.GetAssignment(a) == t0);
+    REQUIRE(!alloc.GetAssignment(b));
+
+    alloc.Generate(body);
+
+    std::array<uint32_t, 8> expected{};
+    auto expected_as = MakeAssembler32(expected);
+    expected_as.ADDI(t0, x0, 1);
+    expected_as.ADDI(t4, x0, 2);
+    expected_as.SW(t4, 8, sp);
+    expected_as.LW(t4, 8, sp);
+    expected_as.ADDI(t4, t4, 3);
+    expected_as.SW(t4, 8, sp);
+    expected_as.LW(t4, 8, sp);
+    expected_as.ADD(a0, t0, t4);
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Register Allocation (Loops)", "[register_allocator]") {
+    std::array<uint32_t, 6> value{};
+    auto as = MakeAssembler64(value);
+
+    VReg a, b, c;
+    const auto body = [&](Assembler& as, RegisterAllocator& alloc) {
+        a = alloc.NewVReg();
+        b = alloc.NewVReg();
+        c = alloc.NewVReg();
+
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 5); }, RA::Def(a));
+
+        Label loop;
+        as.Bind(&loop);
+        alloc.Emit([&](GPR d, GPR s) { as.ADDI(d, s, 1); }, RA::Def(b), RA::Use(a));
+        alloc.Emit([&](GPR d) { as.LD(d, 0, a0); }, RA::Def(c));
+        alloc.Emit([&](GPR s1, GPR s2) { as.ADD(a1, s1, s2); }, RA::Use(b), RA::Use(c));
+        as.ADDI(a0, a0, 8);
+        as.BNE(a0, a2, &loop);
+    };
+
+    // a's last use is early in the loop, but it's read again on the next iteration,
+    // so its register can't be handed to c.
+    RegisterAllocator alloc{as};
+    alloc.Analyze(body);
+    REQUIRE(alloc.GetAssignment(a) == t0);
+    REQUIRE(alloc.GetAssignment(b) == t1);
+    REQUIRE(alloc.GetAssignment(c) == t2);
+
+    alloc.Generate(body);
+
+    std::array<uint32_t, 6> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.ADDI(t0, x0, 5);
+    expected_as.ADDI(t1, t0, 1);
+    expected_as.LD(t2, 0, a0);
+    expected_as.ADD(a1, t1, t2);
+    expected_as.ADDI(a0, a0, 8);
+    expected_as.BNE(a0, a2, -16);
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Register Allocation (Streamed Code)", "[register_allocator]") {
+    Assembler as{CodeBuffer::default_capacity};
+    as.GetCodeBuffer().SetGrowable(true);
+
+    std::vector<uint8_t> output;
+    CodeStream stream{as, [&output](std::span<const uint8_t> code) {
+        output.insert(output.end(), code.begin(), code.end());
+        return true;
+    }};
+
+    // Release the start of the buffer before the allocator looks at any code.
+    for (size_t i = 0; i < 2048; i++) {
+        as.NOP();
+    }
+    REQUIRE(stream.Flush());
+    REQUIRE(as.GetCodeBuffer().GetBaseOffset() != 0);
+
+    VReg a, b;
+    const auto body = [&](Assembler& as, RegisterAllocator& alloc) {
+        a = alloc.NewVReg();
+        b = alloc.NewVReg();
+
+        alloc.Emit([&](GPR d) { as.ADDI(d, x0, 5); }, RA::Def(a));
+
+        Label loop;
+        as.Bind(&loop);
+        alloc.Emit([&](GPR d, GPR s) { as.ADDI(d, s, 1); }, RA::Def(b), RA::Use(a));
+        alloc.Emit([&](GPR s) { as.ADD(a1, a1, s); }, RA::Use(b));
+        as.BNE(a0, a2, &loop);
+    };
+
+    // The loop keeps a live across the backward branch.
+    RegisterAllocator alloc{as};
+    alloc.Analyze(body);
+    REQUIRE(alloc.GetAssignment(a) == t0);
+    REQUIRE(alloc.GetAssignment(b) == t1);
+
+    const auto begin = as.GetCodeBuffer().GetCursorOffset();
+    alloc.Generate(body);
+
+    std::array<uint32_t, 4> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.ADDI(t0, x0, 5);
+    expected_as.ADDI(t1, t0, 1);
+    expected_as.ADD(a1, a1, t1);
+    expected_as.BNE(a0, a2, -8);
+    REQUIRE(std::memcmp(as.GetBufferPointer(begin), expected.data(), sizeof(expected)) == 0);
+}
+
+TEST_CASE("Register Allocation (Frames)", "[register_allocator]") {
+    std::array<uint32_t, 32> value{};
+    auto as = MakeAssembler64(value);
+
+    const auto body = [](Assembler& as, RegisterAllocator& alloc) {
+        const auto a = alloc.NewVReg();
+        const auto b = alloc.NewVReg();
+        const auto c = alloc.NewVReg();
+        const auto d = alloc.NewVReg();
+
+        alloc.Emit([&](GPR r) { as.ADDI(r, x0, 1); }, RA::Def(a));
+        alloc.Emit([&](GPR r) { as.ADDI(r, x0, 2); }, RA::Def(b));
+        alloc.Emit([&](GPR r) { as.ADDI(r, x0, 3); }, RA::Def(c));
+        alloc.Emit([&](GPR r) { as.ADDI(r, x0, 4); }, RA::Def(d));
+        alloc.Emit([&](GPR r1, GPR r2, GPR r3, GPR r4) {
+            as.ADD(a0, r1, r2);
+            as.ADD(a0, a0, r3);
+            as.ADD(a0, a0, r4);
+        }, RA::Use(a), RA::Use(b), RA::Use(c), RA::Use(d));
+    };
+
+    constexpr std::array allocatable{t0, s1, s2};
+    RegisterAllocator alloc{as, allocatable};
+    alloc.Analyze(body);
+
+    const auto saved = alloc.GetUsedCalleeSaved();
+    REQUIRE(saved == std::vector<GPR>{s1, s2});
+    REQUIRE(alloc.GetSpillCount() == 1);
+
+    FrameBuilder frame{as, saved, alloc.GetSpillAreaSize(), FrameStrategy::Inline};
+    frame.EmitPrologue();
+    alloc.Generate(body);
+    frame.EmitEpilogue();
+
+    std::array<uint32_t, 32> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    FrameBuilder expected_frame{expected_as, saved, 8, FrameStrategy::Inline};
+    expected_frame.EmitPrologue();
+    expected_as.ADDI(t0, x0, 1);
+    expected_as.ADDI(s1, x0, 2);
+    expected_as.ADDI(s2, x0, 3);
+    expected_as.ADDI(t4, x0, 4);
+    expected_as.SD(t4, 0, sp);
+    expected_as.LD(t4, 0, sp);
+    expected_as.ADD(a0, t0, s1);
+    expected_as.ADD(a0, a0, s2);
+    expected_as.ADD(a0, a0, t4);
+    expected_frame.EmitEpilogue();
+    REQUIRE(value == expected);
+}
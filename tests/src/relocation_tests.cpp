@@ -0,0 +1,227 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <biscuit/assembler.hpp>
+#include <biscuit/relocation.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Relocations are recorded for label references", "[relocation]") {
+    std::array<uint32_t, 16> buffer{};
+    auto as = MakeAssembler32(buffer);
+    as.SetRelocationRecording(true);
+
+    Label table;
+    Label target;
+
+    as.BEQ(a0, a1, &target);
+    as.JAL(&target);
+    as.C_J(&target);
+    as.C_BNEZ(a0, &target);
+    as.LA(a2, &target);
+    as.Bind(&table);
+    as.EmitJumpTableEntry(&target, &table);
+    as.Bind(&target);
+    as.EmitAddress(&target);
+
+    const auto relocations = as.GetRelocations();
+    REQUIRE(relocations.size() == 7);
+
+    const std::array<std::pair<RelocationKind, ptrdiff_t>, 7> expected{{
+        {RelocationKind::BType, 0},
+        {RelocationKind::JType, 4},
+        {RelocationKind::CJType, 8},
+        {RelocationKind::CBType, 10},
+        {RelocationKind::PCRelPair, 12},
+        {RelocationKind::JumpTableEntry, 20},
+        {RelocationKind::Absolute64, 24},
+    }};
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(relocations[i].kind == expected[i].first);
+        REQUIRE(relocations[i].offset == expected[i].second);
+        REQUIRE(relocations[i].label == &target);
+    }
+    REQUIRE(relocations[5].base == 20);
+
+    // The jump table entry holds the offset from the table to its target.
+    int32_t entry = 0;
+    std::memcpy(&entry, reinterpret_cast<uint8_t*>(buffer.data()) + 20, sizeof(entry));
+    REQUIRE(entry == 4);
+
+    // The address is patched in once the label is bound.
+    uint64_t address = 0;
+    std::memcpy(&address, reinterpret_cast<uint8_t*>(buffer.data()) + 24, sizeof(address));
+    REQUIRE(address == as.GetCodeBuffer().GetOffsetAddress(24));
+
+    as.RewindBuffer(12);
+    REQUIRE(as.GetRelocations().size() == 4);
+
+    as.ClearRelocations();
+    REQUIRE(as.GetRelocations().empty());
+}
+
+TEST_CASE("Relocations are only recorded when enabled", "[relocation]") {
+    std::array<uint32_t, 4> buffer{};
+    auto as = MakeAssembler64(buffer);
+
+    Label label;
+    as.Bind(&label);
+    as.J(&label);
+    REQUIRE(as.GetRelocations().empty());
+}
+
+TEST_CASE("References to local labels are recorded by location", "[relocation]") {
+    std::array<uint32_t, 16> buffer{};
+    auto as = MakeAssembler64(buffer);
+    as.SetRelocationRecording(true);
+
+    {
+        auto backward = Label::Local();
+        auto forward = Label::Local();
+
+        as.Bind(&backward);
+        as.BEQ(a0, a1, &forward);
+        as.J(&backward);
+        as.EmitAddress(&forward);
+        as.Bind(&forward);
+        as.LA(a2, &backward);
+        REQUIRE(as.GetRelocations().size() == 4);
+    }
+
+    const std::array<std::tuple<RelocationKind, ptrdiff_t, ptrdiff_t>, 4> expected{{
+        {RelocationKind::BType, 0, 16},
+        {RelocationKind::JType, 4, 0},
+        {RelocationKind::Absolute64, 8, 16},
+        {RelocationKind::PCRelPair, 16, 0},
+    }};
+
+    const auto relocations = as.GetRelocations();
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(relocations[i].kind == std::get<0>(expected[i]));
+        REQUIRE(relocations[i].offset == std::get<1>(expected[i]));
+        REQUIRE(relocations[i].target == std::get<2>(expected[i]));
+        REQUIRE(relocations[i].label == nullptr);
+    }
+}
+
+TEST_CASE("Patched relocations match freshly assembled code", "[relocation]") {
+    std::array<uint32_t, 2> patched{};
+    std::array<uint32_t, 2> expected{};
+    auto* const ptr = reinterpret_cast<uint8_t*>(patched.data());
+
+    SECTION("B-type") {
+        auto as = MakeAssembler64(patched);
+        as.BGE(a0, a1, 0);
+        PatchRelocation(ptr, RelocationKind::BType, -4096);
+
+        auto expected_as = MakeAssembler64(expected);
+        expected_as.BGE(a0, a1, -4096);
+    }
+    SECTION("J-type") {
+        auto as = MakeAssembler64(patched);
+        as.JAL(ra, 0);
+        PatchRelocation(ptr, RelocationKind::JType, 0x7FFFE);
+
+        auto expected_as = MakeAssembler64(expected);
+        expected_as.JAL(ra, 0x7FFFE);
+    }
+    SECTION("CB-type") {
+        auto as = MakeAssembler64(patched);
+        as.C_BEQZ(a0, 0);
+        PatchRelocation(ptr, RelocationKind::CBType, -256);
+
+        auto expected_as = MakeAssembler64(expected);
+        expected_as.C_BEQZ(a0, -256);
+    }
+    SECTION("CJ-type") {
+        auto as = MakeAssembler64(patched);
+        as.C_J(0);
+        PatchRelocation(ptr, RelocationKind::CJType, 2046);
+
+        auto expected_as = MakeAssembler64(expected);
+        expected_as.C_J(2046);
+    }
+    SECTION("AUIPC pair with a store") {
+        auto as = MakeAssembler64(patched);
+        as.AUIPC(t0, 0);
+        as.SD(a0, 0, t0);
+        PatchRelocation(ptr, RelocationKind::PCRelPair, 0x12345FFC);
+
+        auto expected_as = MakeAssembler64(expected);
+        expected_as.AUIPC(t0, static_cast<int32_t>((0x12345FFC + 0x800) >> 12));
+        expected_as.SD(a0, static_cast<int32_t>(0xFFC) - 0x1000, t0);
+    }
+
+    REQUIRE(patched == expected);
+}
+
+TEST_CASE("Relocations allow moving code", "[relocation]") {
+    Assembler as{256};
+    as.SetRelocationRecording(true);
+
+    // An external target, which stays put while the code moves.
+    Label external;
+    as.Bind(&external);
+    as.RET();
+
+    const auto block_start = as.GetCodeBuffer().GetCursorOffset();
+    Label local;
+    as.CALL(&external);
+    as.EmitAddress(&local);
+    as.Bind(&local);
+    as.RET();
+    const auto block_end = as.GetCodeBuffer().GetCursorOffset();
+
+    // Move the block further into the buffer.
+    auto& buffer = as.GetCodeBuffer();
+    for (int i = 0; i < 16; i++) {
+        as.NOP();
+    }
+    const auto moved_start = buffer.GetCursorOffset();
+    const auto block_size = static_cast<size_t>(block_end - block_start);
+    std::memcpy(buffer.GetCursorPointer(), buffer.GetOffsetPointer(block_start), block_size);
+
+    auto* const code = buffer.GetCursorPointer();
+    const auto code_address = buffer.GetCursorAddress();
+    for (auto relocation : as.GetRelocations()) {
+        if (relocation.offset < block_start || relocation.offset >= block_end) {
+            continue;
+        }
+
+        auto target = buffer.GetOffsetAddress(*relocation.label->GetLocation());
+        if (relocation.label == &local) {
+            target += static_cast<uintptr_t>(moved_start - block_start);
+        }
+
+        relocation.offset -= block_start;
+        ApplyRelocation(code, code_address, relocation, target);
+    }
+
+    std::array<uint32_t, 6> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.CALL(static_cast<int32_t>(*external.GetLocation() - moved_start));
+
+    REQUIRE(std::memcmp(code, expected.data(), 8) == 0);
+
+    uint64_t address = 0;
+    std::memcpy(&address, code + 8, sizeof(address));
+    REQUIRE(address == code_address + 16);
+}
+
+TEST_CASE("Relocations are checked for reach", "[relocation]") {
+    const Relocation branch{.kind = RelocationKind::BType, .offset = 8};
+    REQUIRE(CanApplyRelocation(0x1000, branch, 0x1008 + 4094));
+    REQUIRE_FALSE(CanApplyRelocation(0x1000, branch, 0x1008 + 4096));
+
+    const Relocation address{.kind = RelocationKind::Absolute32};
+    REQUIRE(CanApplyRelocation(0, address, UINT32_MAX));
+    REQUIRE_FALSE(CanApplyRelocation(0, address, uintptr_t{UINT32_MAX} + 1));
+
+    REQUIRE(IsValidRelocationValue(RelocationKind::Absolute64, INT64_MIN));
+    REQUIRE_FALSE(IsValidRelocationValue(RelocationKind::CJType, 2048));
+}
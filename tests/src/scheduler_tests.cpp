@@ -0,0 +1,184 @@
+#include <catch/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/scheduler.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+template <size_t N, typename Emitter>
+std::array<uint32_t, N> Emit(Emitter&& emitter) {
+    std::array<uint32_t, N> words{};
+    auto as = MakeAssembler64(words);
+    emitter(as);
+    return words;
+}
+
+template <size_t N>
+size_t Schedule(std::array<uint32_t, N>& words, const SchedulingModel& model = {}) {
+    InstructionScheduler scheduler{model};
+    return scheduler.Schedule({reinterpret_cast<uint8_t*>(words.data()), sizeof(words)});
+}
+} // Anonymous namespace
+
+TEST_CASE("Scheduling Load-Use Pairs", "[scheduler]") {
+    auto code = Emit<4>([](Assembler& as) {
+        as.LD(a0, 0, a1);
+        as.ADDI(a0, a0, 1);
+        as.LD(a2, 0, a3);
+        as.ADDI(a2, a2, 1);
+    });
+
+    // Both loads are started before either of their results are needed.
+    const auto expected = Emit<4>([](Assembler& as) {
+        as.LD(a0, 0, a1);
+        as.LD(a2, 0, a3);
+        as.ADDI(a0, a0, 1);
+        as.ADDI(a2, a2, 1);
+    });
+
+    REQUIRE(Schedule(code) == 2);
+    REQUIRE(code == expected);
+}
+
+TEST_CASE("Scheduling Independent Chains", "[scheduler]") {
+    auto code = Emit<4>([](Assembler& as) {
+        as.LUI(a0, 0x12345);
+        as.ADDIW(a0, a0, 0x678);
+        as.LUI(a1, 0x9ABCD);
+        as.ADDIW(a1, a1, 0x123);
+    });
+
+    // The chains are interleaved so each pair can dual-issue.
+    const auto expected = Emit<4>([](Assembler& as) {
+        as.LUI(a0, 0x12345);
+        as.LUI(a1, 0x9ABCD);
+        as.ADDIW(a0, a0, 0x678);
+        as.ADDIW(a1, a1, 0x123);
+    });
+
+    REQUIRE(Schedule(code) == 2);
+    REQUIRE(code == expected);
+
+    // A single-issue core gains nothing from interleaving ALU operations.
+    SchedulingModel single_issue;
+    single_issue.issue_width = 1;
+
+    auto unchanged = Emit<4>([](Assembler& as) {
+        as.LUI(a0, 0x12345);
+        as.ADDIW(a0, a0, 0x678);
+        as.LUI(a1, 0x9ABCD);
+        as.ADDIW(a1, a1, 0x123);
+    });
+    Schedule(unchanged, single_issue);
+    REQUIRE(unchanged[0] == expected[0]);
+}
+
+TEST_CASE("Scheduling Keeps Dependencies", "[scheduler]") {
+    // Stores stay ordered with respect to loads, and register
+    // anti-dependencies keep the original value readable.
+    auto code = Emit<4>([](Assembler& as) {
+        as.SD(a0, 0, a1);
+        as.LD(a2, 0, a3);
+        as.ADD(a4, a5, a6);
+        as.ADDI(a5, x0, 1);
+    });
+    const auto original = code;
+
+    Schedule(code);
+    REQUIRE(code[0] == original[0]);
+    REQUIRE(code[1] == original[1]);
+
+    const auto* const add = std::find(code.begin(), code.end(), original[2]);
+    const auto* const write = std::find(code.begin(), code.end(), original[3]);
+    REQUIRE(add < write);
+}
+
+TEST_CASE("Scheduling Barriers", "[scheduler]") {
+    // Loads would be hoisted if nothing stood in the way, but nothing
+    // is moved across branches, NOPs or system instructions.
+    auto code = Emit<7>([](Assembler& as) {
+        as.ADDI(a0, a0, 1);
+        as.BEQ(a3, a4, 8);
+        as.LD(a1, 0, a2);
+        as.NOP();
+        as.LD(a2, 0, a3);
+        as.FENCE();
+        as.LD(a3, 0, a4);
+    });
+    const auto original = code;
+
+    REQUIRE(Schedule(code) == 0);
+    REQUIRE(code == original);
+}
+
+TEST_CASE("Scheduling Compressed Instructions", "[scheduler]") {
+    // C.LWSP implicitly reads sp, so it can't be hoisted above the stack adjustment.
+    std::array<uint16_t, 4> code{};
+    auto as = MakeAssembler64(code);
+    as.C_ADDI(a1, 1);
+    as.C_ADDI16SP(-16);
+    as.C_LWSP(a0, 0);
+    as.C_ADD(a2, a0);
+    const auto original = code;
+
+    InstructionScheduler scheduler;
+    scheduler.Schedule({reinterpret_cast<uint8_t*>(code.data()), sizeof(code)});
+
+    const auto* const adjust = std::find(code.begin(), code.end(), original[1]);
+    const auto* const load = std::find(code.begin(), code.end(), original[2]);
+    REQUIRE(adjust < load);
+    REQUIRE(code[3] == original[3]);
+}
+
+TEST_CASE("Assembler Scheduling", "[scheduler]") {
+    std::array<uint32_t, 10> data{};
+    auto as = MakeAssembler64(data);
+
+    InstructionScheduler scheduler;
+    as.SetScheduler(&scheduler);
+    REQUIRE(as.GetScheduler() == &scheduler);
+
+    // Nothing is moved before the label, or across it.
+    Label label;
+    as.LD(a0, 0, a1);
+    as.ADDI(a0, a0, 1);
+    as.J(&label);
+    as.Bind(&label);
+    as.LD(a2, 0, a3);
+    as.ADDI(a2, a2, 1);
+    as.LD(a4, 0, a5);
+    as.ADDI(a4, a4, 1);
+
+    // Data emitted directly isn't scheduled.
+    as.FlushSchedule();
+    auto& buffer = as.GetCodeBuffer();
+    const auto first = Emit<1>([](Assembler& a) { a.LD(a6, 0, a7); })[0];
+    const auto second = Emit<1>([](Assembler& a) { a.ADDI(a6, a6, 1); })[0];
+    const auto third = Emit<1>([](Assembler& a) { a.LD(t0, 0, t1); })[0];
+    buffer.Emit32(first);
+    buffer.Emit32(second);
+    buffer.Emit32(third);
+    as.SkipSchedule();
+    as.FlushSchedule();
+
+    const auto expected = Emit<9>([](Assembler& a) {
+        a.LD(a0, 0, a1);
+        a.ADDI(a0, a0, 1);
+        a.J(4);
+        a.LD(a2, 0, a3);
+        a.LD(a4, 0, a5);
+        a.ADDI(a2, a2, 1);
+        a.ADDI(a4, a4, 1);
+    });
+    for (size_t i = 0; i < 7; i++) {
+        REQUIRE(data[i] == expected[i]);
+    }
+    REQUIRE(data[7] == first);
+    REQUIRE(data[8] == second);
+    REQUIRE(data[9] == third);
+}
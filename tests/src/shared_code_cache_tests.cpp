@@ -0,0 +1,167 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <biscuit/shared_code_cache.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Shared allocations are aligned and disjoint", "[shared_code_cache]") {
+    SharedCodeCache cache{1024 * 1024, 16};
+
+    auto a = cache.Allocate(100);
+    auto b = cache.Allocate(100, 64);
+    REQUIRE(a.has_value());
+    REQUIRE(b.has_value());
+    REQUIRE(!a->IsManaged());
+
+    const auto* const a_ptr = a->GetOffsetPointer(0);
+    const auto* const b_ptr = b->GetOffsetPointer(0);
+    REQUIRE(reinterpret_cast<uintptr_t>(a_ptr) % SharedCodeCache::default_alignment == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(b_ptr) % 64 == 0);
+    REQUIRE(b_ptr >= a_ptr + 100);
+    REQUIRE(cache.Contains(a_ptr));
+    REQUIRE(cache.Contains(b_ptr));
+}
+
+TEST_CASE("Shared allocations fail once the cache is exhausted", "[shared_code_cache]") {
+    SharedCodeCache cache{64 * 1024, 16};
+
+    const auto remaining = cache.GetCapacity() - cache.GetUsedBytes();
+    REQUIRE(cache.Allocate(remaining + 1) == std::nullopt);
+    REQUIRE(cache.Allocate(remaining, 1).has_value());
+    REQUIRE(cache.Allocate(1, 1) == std::nullopt);
+}
+
+TEST_CASE("Shared caches can be published in every build", "[shared_code_cache]") {
+    SharedCodeCache cache{64 * 1024, 16};
+    auto buffer = cache.Allocate(4);
+    REQUIRE(buffer.has_value());
+    buffer->Emit32(0x00008067);
+
+    // Builds without mmap have nothing to protect, so these do nothing there.
+    cache.SetExecutable();
+    cache.SetWritable();
+    REQUIRE(cache.Allocate(4).has_value());
+}
+
+TEST_CASE("Concurrent shared allocations never overlap", "[shared_code_cache]") {
+    constexpr size_t num_threads = 8;
+    constexpr size_t allocations_per_thread = 256;
+
+    SharedCodeCache cache{4 * 1024 * 1024, 16};
+    std::array<std::vector<const uint8_t*>, num_threads> allocations;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+        threads.emplace_back([&cache, &list = allocations[i]] {
+            // Catch's assertions aren't thread-safe, so results are only checked once joined.
+            for (size_t j = 0; j < allocations_per_thread; j++) {
+                if (auto buffer = cache.Allocate(64)) {
+                    list.push_back(buffer->GetOffsetPointer(0));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::set<const uint8_t*> starts;
+    for (const auto& list : allocations) {
+        starts.insert(list.begin(), list.end());
+    }
+    REQUIRE(starts.size() == num_threads * allocations_per_thread);
+
+    // Sorted starts that are at least one allocation apart can't overlap.
+    const uint8_t* previous = nullptr;
+    for (const auto* start : starts) {
+        REQUIRE((previous == nullptr || start >= previous + 64));
+        previous = start;
+    }
+}
+
+TEST_CASE("Stubs load their target from the stub table", "[shared_code_cache]") {
+    SharedCodeCache cache{1024 * 1024, 16};
+
+    const auto stub = cache.CreateStub(0x1234);
+    REQUIRE(stub.has_value());
+    REQUIRE(cache.GetStubCount() == 1);
+    REQUIRE(cache.GetStubTarget(*stub) == 0x1234);
+
+    cache.SetStubTarget(*stub, 0x5678);
+    REQUIRE(cache.GetStubTarget(*stub) == 0x5678);
+
+    std::array<uint32_t, 4> code{};
+    std::memcpy(code.data(), reinterpret_cast<const void*>(cache.GetStubAddress(*stub)), sizeof(code));
+
+    // AUIPC t1, hi; LD t1, lo(t1); JR t1; EBREAK
+    REQUIRE((code[0] & 0xFFF) == 0x317);
+    REQUIRE((code[1] & 0xFFFFF) == 0x33303);
+    REQUIRE(code[2] == 0x00030067);
+    REQUIRE(code[3] == 0x00100073);
+
+    // The pair has to resolve to the stub's slot, which is the first table entry.
+    const auto hi = static_cast<int64_t>(static_cast<int32_t>(code[0] & 0xFFFFF000));
+    const auto lo = static_cast<int64_t>(static_cast<int32_t>(code[1]) >> 20);
+    const auto slot = static_cast<int64_t>(cache.GetStubAddress(*stub)) + hi + lo;
+    REQUIRE(*reinterpret_cast<const uintptr_t*>(slot) == 0x5678);
+}
+
+TEST_CASE("Stub creation fails once the stub table is full", "[shared_code_cache]") {
+    SharedCodeCache cache{1024 * 1024, 2};
+
+    REQUIRE(cache.CreateStub(0).has_value());
+    REQUIRE(cache.CreateStub(0).has_value());
+    REQUIRE(cache.CreateStub(0) == std::nullopt);
+    REQUIRE(cache.GetStubCount() == 2);
+}
+
+TEST_CASE("Thread arenas sub-allocate functions from chunks", "[shared_code_cache]") {
+    SharedCodeCache cache{1024 * 1024, 16};
+    ThreadCodeArena arena{cache, 4096};
+    const auto stub = *cache.CreateStub(0);
+
+    REQUIRE(arena.BeginFunction(64));
+    const auto used = cache.GetUsedBytes();
+    arena.CallStub(stub);
+    arena.GetAssembler().RET();
+    const auto first = arena.EndFunction();
+
+    REQUIRE(arena.BeginFunction(64, 64));
+    arena.GetAssembler().RET();
+    const auto second = arena.EndFunction();
+
+    // Both functions come out of the same chunk.
+    REQUIRE(cache.GetUsedBytes() == used);
+    REQUIRE(first % SharedCodeCache::default_alignment == 0);
+    REQUIRE(second % 64 == 0);
+    REQUIRE(second >= first + 12);
+
+    // The call reaches the stub.
+    std::array<uint32_t, 2> call{};
+    std::memcpy(call.data(), reinterpret_cast<const void*>(first), sizeof(call));
+    const auto hi = static_cast<int64_t>(static_cast<int32_t>(call[0] & 0xFFFFF000));
+    const auto lo = static_cast<int64_t>(static_cast<int32_t>(call[1]) >> 20);
+    REQUIRE(static_cast<uintptr_t>(static_cast<int64_t>(first) + hi + lo) == cache.GetStubAddress(stub));
+
+    // Functions that don't fit into the rest of the chunk get a new one.
+    REQUIRE(arena.BeginFunction(8192));
+    arena.GetAssembler().RET();
+    arena.EndFunction();
+    REQUIRE(cache.GetUsedBytes() >= used + 8192);
+}
+
+TEST_CASE("Thread arenas fail to begin functions once the cache is exhausted", "[shared_code_cache]") {
+    SharedCodeCache cache{64 * 1024, 16};
+    ThreadCodeArena arena{cache, 4096};
+
+    REQUIRE(!arena.BeginFunction(cache.GetCapacity()));
+    REQUIRE(!arena.IsInFunction());
+}
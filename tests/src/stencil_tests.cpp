@@ -0,0 +1,117 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/stencil.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Stencil register and immediate holes", "[stencil]") {
+    StencilBuilder builder;
+    auto& as = builder.GetAssembler();
+
+    as.ADDI(x0, x0, 0);
+    builder.MarkHole(StencilField::Rd, 0);
+    builder.MarkHole(StencilField::Rs1, 1);
+    builder.MarkHole(StencilField::IImm, 2);
+    as.SD(x0, 0, sp);
+    builder.MarkHole(StencilField::Rs2, 0);
+    builder.MarkHole(StencilField::SImm, 3);
+    as.LUI(x0, 0);
+    builder.MarkHole(StencilField::Rd, 1);
+    builder.MarkHole(StencilField::UImm, 4);
+    as.RET();
+
+    const auto stencil = builder.Build();
+    REQUIRE(stencil.GetSize() == 16);
+    REQUIRE(stencil.GetArgumentCount() == 5);
+    REQUIRE(stencil.GetHoles().size() == 7);
+
+    CodeBuffer buffer{64};
+    buffer.Emit32(0x00000013);
+
+    const std::array<int64_t, 5> args{a0.Index(), a1.Index(), -2048, 2040, 0xABCDE};
+    REQUIRE(stencil.Instantiate(buffer, args) == 4);
+    REQUIRE(buffer.GetCursorOffset() == 20);
+
+    std::array<uint32_t, 4> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.ADDI(a0, a1, -2048);
+    expected_as.SD(a0, 2040, sp);
+    expected_as.LUI(a1, 0xABCDE);
+    expected_as.RET();
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(ReadWord(buffer, static_cast<ptrdiff_t>(4 + i * 4)) == expected[i]);
+    }
+}
+
+TEST_CASE("Stencil target holes are relative to where they're instantiated", "[stencil]") {
+    StencilBuilder builder;
+    auto& as = builder.GetAssembler();
+
+    // An internal branch stays as is, since it's position independent.
+    Label skip;
+    as.BEQ(a0, a1, &skip);
+    as.BNE(a0, x0, 0);
+    builder.MarkHole(StencilField::Target, 0);
+    as.Bind(&skip);
+    as.J(0);
+    builder.MarkHole(StencilField::Target, 1);
+
+    const auto stencil = builder.Build();
+
+    CodeBuffer buffer{256};
+    for (int i = 0; i < 8; i++) {
+        buffer.Emit32(0x00000013);
+    }
+
+    const std::array<int64_t, 2> first_args{0, 64};
+    const auto first = stencil.Instantiate(buffer, first_args);
+
+    const std::array<int64_t, 2> second_args{4, 0};
+    const auto second = stencil.Instantiate(buffer, second_args);
+
+    REQUIRE(first == 32);
+    REQUIRE(second == 44);
+
+    std::array<uint32_t, 6> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.BEQ(a0, a1, 8);
+    expected_as.BNE(a0, x0, 0 - 36);
+    expected_as.J(64 - 40);
+    expected_as.BEQ(a0, a1, 8);
+    expected_as.BNE(a0, x0, 4 - 48);
+    expected_as.J(0 - 52);
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(ReadWord(buffer, static_cast<ptrdiff_t>(32 + i * 4)) == expected[i]);
+    }
+}
+
+TEST_CASE("Stencil target holes patch AUIPC pairs", "[stencil]") {
+    StencilBuilder builder;
+    auto& as = builder.GetAssembler();
+
+    as.AUIPC(ra, 0);
+    builder.MarkHole(StencilField::Target, 0);
+    as.JALR(ra, 0, ra);
+
+    const auto stencil = builder.Build();
+
+    CodeBuffer buffer{1U << 16};
+    buffer.Emit32(0x00000013);
+
+    const std::array<int64_t, 1> args{0x9000};
+    const auto base = stencil.Instantiate(buffer, args);
+    REQUIRE(base == 4);
+
+    std::array<uint32_t, 2> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.CALL(0x9000 - 4);
+
+    REQUIRE(ReadWord(buffer, 4) == expected[0]);
+    REQUIRE(ReadWord(buffer, 8) == expected[1]);
+}
@@ -0,0 +1,194 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <biscuit/assembler.hpp>
+#include <biscuit/switch.hpp>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+namespace {
+// Runs the dispatch code, returning the offset of the EBREAK it stops at.
+ptrdiff_t Run(Assembler& as, int64_t value) {
+    std::array<uint64_t, 32> x{};
+    x[a0.Index()] = static_cast<uint64_t>(value);
+    return static_cast<ptrdiff_t>(Interpret(GetEmittedCode(as), as.GetExtensions(), x));
+}
+
+// Emits a switch over the given values, and checks every value
+// around each case lands on the right target.
+void CheckSwitch(const std::vector<int64_t>& values, SwitchStrategy strategy, SwitchStrategy expected,
+                 ExtensionSet extensions = {}, bool relax_branches = false) {
+    std::vector<uint32_t> code(4096);
+    Assembler as{reinterpret_cast<uint8_t*>(code.data()), code.size() * sizeof(uint32_t), ArchFeature::RV64};
+    as.SetExtensions(extensions);
+    as.SetBranchRelaxation(relax_branches);
+
+    Label default_target;
+    std::vector<Label> targets(values.size());
+    SwitchBuilder builder{&default_target};
+    for (size_t i = 0; i < values.size(); i++) {
+        builder.AddCase(values[i], &targets[i]);
+    }
+    REQUIRE(builder.GetCaseCount() == values.size());
+    REQUIRE(builder.Emit(as, a0, t0, t1, strategy) == expected);
+
+    for (auto& target : targets) {
+        as.Bind(&target);
+        as.EBREAK();
+    }
+    as.Bind(&default_target);
+    as.EBREAK();
+
+    const auto lands_on = [&](int64_t value) {
+        for (size_t i = 0; i < values.size(); i++) {
+            if (values[i] == value) {
+                return *targets[i].GetLocation();
+            }
+        }
+        return *default_target.GetLocation();
+    };
+
+    std::vector<int64_t> probes{
+        std::numeric_limits<int64_t>::min(),
+        std::numeric_limits<int64_t>::max(),
+    };
+    for (const auto value : values) {
+        const auto bits = static_cast<uint64_t>(value);
+        probes.push_back(static_cast<int64_t>(bits - 1));
+        probes.push_back(value);
+        probes.push_back(static_cast<int64_t>(bits + 1));
+    }
+    for (const auto probe : probes) {
+        INFO("value=" << probe);
+        REQUIRE(Run(as, probe) == lands_on(probe));
+    }
+}
+} // Anonymous namespace
+
+TEST_CASE("Switch Strategy Selection", "[switch]") {
+    Label target;
+    Label default_target;
+
+    // Too few cases for a table to pay off.
+    SwitchBuilder small{&default_target};
+    small.AddCase(0, &target);
+    small.AddCase(1, &target);
+    small.AddCase(2, &target);
+    REQUIRE(small.PickStrategy() == SwitchStrategy::BinarySearch);
+
+    // Dense enough.
+    SwitchBuilder dense{&default_target};
+    for (int64_t i = 0; i < 8; i++) {
+        dense.AddCase(i * 3, &target);
+    }
+    REQUIRE(dense.PickStrategy() == SwitchStrategy::JumpTable);
+
+    // Too sparse.
+    SwitchBuilder sparse{&default_target};
+    for (int64_t i = 0; i < 8; i++) {
+        sparse.AddCase(i * 4, &target);
+    }
+    REQUIRE(sparse.PickStrategy() == SwitchStrategy::BinarySearch);
+
+    // Covering the entire range doesn't overflow.
+    SwitchBuilder extremes{&default_target};
+    extremes.AddCase(std::numeric_limits<int64_t>::min(), &target);
+    extremes.AddCase(-1, &target);
+    extremes.AddCase(0, &target);
+    extremes.AddCase(std::numeric_limits<int64_t>::max(), &target);
+    REQUIRE(extremes.PickStrategy() == SwitchStrategy::BinarySearch);
+}
+
+TEST_CASE("Switch Jump Tables", "[switch]") {
+    const std::vector<int64_t> dense{10, 11, 12, 14, 15, 17, 18, 20};
+    CheckSwitch(dense, SwitchStrategy::Auto, SwitchStrategy::JumpTable);
+    CheckSwitch(dense, SwitchStrategy::JumpTable, SwitchStrategy::JumpTable, {Extension::Zba});
+
+    // Starting at zero, with cases added out of order.
+    CheckSwitch({3, 0, 2, 1, 5}, SwitchStrategy::JumpTable, SwitchStrategy::JumpTable);
+
+    // A base too large for an ADDI.
+    CheckSwitch({-100000, -99999, -99997, -99996}, SwitchStrategy::JumpTable, SwitchStrategy::JumpTable);
+
+    // A base that can't be negated.
+    constexpr auto min = std::numeric_limits<int64_t>::min();
+    CheckSwitch({min, min + 1, min + 2, min + 4}, SwitchStrategy::JumpTable, SwitchStrategy::JumpTable);
+}
+
+TEST_CASE("Switch With Branch Relaxation", "[switch]") {
+    // Tables can't be relaxed, so dense cases are searched for instead.
+    const std::vector<int64_t> dense{10, 11, 12, 14, 15, 17, 18, 20};
+    CheckSwitch(dense, SwitchStrategy::Auto, SwitchStrategy::BinarySearch, {}, true);
+}
+
+TEST_CASE("Switch Binary Search", "[switch]") {
+    CheckSwitch({-1000000, -5, 0, 3, 77, 1000, int64_t{1} << 40, 123456789}, SwitchStrategy::Auto,
+                SwitchStrategy::BinarySearch);
+    CheckSwitch({1, 2}, SwitchStrategy::Auto, SwitchStrategy::BinarySearch);
+    CheckSwitch({std::numeric_limits<int64_t>::min(), 0, std::numeric_limits<int64_t>::max()},
+                SwitchStrategy::BinarySearch, SwitchStrategy::BinarySearch);
+
+    // Dense cases can still be searched for.
+    std::vector<int64_t> many;
+    for (int64_t i = 0; i < 40; i++) {
+        many.push_back(i * 7 - 100);
+    }
+    CheckSwitch(many, SwitchStrategy::BinarySearch, SwitchStrategy::BinarySearch);
+}
+
+TEST_CASE("Switch Without Cases", "[switch]") {
+    std::array<uint32_t, 4> value{};
+    auto as = MakeAssembler64(value);
+
+    Label default_target;
+    SwitchBuilder builder{&default_target};
+    builder.Emit(as, a0, t0, t1);
+    as.Bind(&default_target);
+
+    std::array<uint32_t, 4> expected{};
+    auto expected_as = MakeAssembler64(expected);
+    expected_as.J(4);
+    REQUIRE(value == expected);
+}
+
+TEST_CASE("Switch Jump Table Layout", "[switch]") {
+    std::array<uint32_t, 32> value{};
+    auto as = MakeAssembler64(value);
+    as.SetRelocationRecording(true);
+
+    Label a, b, default_target;
+    SwitchBuilder builder{&default_target};
+    builder.AddCase(0, &a);
+    builder.AddCase(2, &b);
+    builder.Emit(as, a0, t0, t1, SwitchStrategy::JumpTable);
+
+    // One entry for every value in the range, holes included,
+    // each relative to the start of the table.
+    const auto table = *builder.GetTableLabel()->GetLocation();
+    REQUIRE(table % 4 == 0);
+    REQUIRE(as.GetCodeBuffer().GetCursorOffset() == table + 12);
+
+    as.Bind(&a);
+    as.EBREAK();
+    as.Bind(&b);
+    as.EBREAK();
+    as.Bind(&default_target);
+    as.EBREAK();
+
+    std::array<int32_t, 3> entries{};
+    std::memcpy(entries.data(), as.GetBufferPointer(table), sizeof(entries));
+    REQUIRE(entries[0] == *a.GetLocation() - table);
+    REQUIRE(entries[1] == *default_target.GetLocation() - table);
+    REQUIRE(entries[2] == *b.GetLocation() - table);
+
+    size_t table_relocations = 0;
+    for (const auto& relocation : as.GetRelocations()) {
+        table_relocations += relocation.kind == RelocationKind::JumpTableEntry;
+    }
+    REQUIRE(table_relocations == 3);
+}
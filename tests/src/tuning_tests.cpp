@@ -0,0 +1,95 @@
+#include <catch/catch.hpp>
+
+#include <biscuit/tuning.hpp>
+#include <biscuit/vector_loop.hpp>
+#include <cstring>
+
+using namespace biscuit;
+
+TEST_CASE("Tuning Model Presets", "[tuning]") {
+    const auto& generic = GetTuningModel(TuningCore::Generic);
+    REQUIRE(std::strcmp(generic.name, "generic") == 0);
+    REQUIRE(generic.fusions == 0);
+    REQUIRE(generic.vlenb == 0);
+    REQUIRE(generic.scheduling.issue_width == SchedulingModel{}.issue_width);
+
+    const auto& u74 = GetTuningModel(TuningCore::SiFiveU74);
+    REQUIRE(u74.HasFusion(Fusion::ShortForwardBranch));
+    REQUIRE_FALSE(u74.HasFusion(Fusion::LuiAddi));
+    REQUIRE_FALSE(u74.HasFastMisalignedAccess());
+    REQUIRE(u74.vlenb == 0);
+
+    const auto& p670 = GetTuningModel(TuningCore::SiFiveP670);
+    REQUIRE(p670.HasFusion(Fusion::LuiAddi));
+    REQUIRE(p670.HasFusion(Fusion::AuipcAddi));
+    REQUIRE(p670.HasFastMisalignedAccess());
+    REQUIRE(p670.vlenb == 16);
+
+    REQUIRE(GetTuningModel(TuningCore::THeadC910).vlenb == 0);
+    REQUIRE(GetTuningModel(TuningCore::THeadC920).vlenb == 16);
+    REQUIRE(GetTuningModel(TuningCore::SpacemiTX60).vlenb == 32);
+    REQUIRE(GetTuningModel(TuningCore::THeadC910).scheduling.GetUnitsPerCycle(SchedulingClass::ALU) == 2);
+}
+
+TEST_CASE("Tuning Core Identification", "[tuning]") {
+    CPUSnapshot snapshot;
+    REQUIRE(IdentifyTuningCore(snapshot) == TuningCore::Generic);
+
+    snapshot.vendor_id = 0x489;
+    snapshot.arch_id = 0x8000000000000007;
+    REQUIRE(IdentifyTuningCore(snapshot) == TuningCore::SiFiveU74);
+
+    // Other SiFive cores aren't recognized.
+    snapshot.arch_id = 0x8000000000000008;
+    REQUIRE(IdentifyTuningCore(snapshot) == TuningCore::Generic);
+
+    snapshot.vendor_id = 0x5B7;
+    snapshot.arch_id = 0;
+    REQUIRE(IdentifyTuningCore(snapshot) == TuningCore::THeadC910);
+    snapshot.vlenb = 16;
+    REQUIRE(IdentifyTuningCore(snapshot) == TuningCore::THeadC920);
+
+    snapshot.vendor_id = 0x710;
+    snapshot.arch_id = 0x8000000058000001;
+    snapshot.vlenb = 32;
+    REQUIRE(IdentifyTuningCore(snapshot) == TuningCore::SpacemiTX60);
+}
+
+TEST_CASE("Host Tuning Models", "[tuning]") {
+    CPUSnapshot snapshot;
+    snapshot.vendor_id = 0x710;
+    snapshot.arch_id = 0x8000000058000001;
+    snapshot.vlenb = 32;
+
+    // Unknown properties come from the preset.
+    auto model = GetHostTuningModel(snapshot);
+    REQUIRE(std::strcmp(model.name, "spacemit-x60") == 0);
+    REQUIRE(model.misaligned_access == GetTuningModel(TuningCore::SpacemiTX60).misaligned_access);
+    REQUIRE(model.vlenb == 32);
+
+    // Detected ones override it.
+    snapshot.misaligned_access = MisalignedAccess::Fast;
+    snapshot.vlenb = 0;
+    model = GetHostTuningModel(snapshot);
+    REQUIRE(model.misaligned_access == MisalignedAccess::Fast);
+    REQUIRE(model.vlenb == 0);
+}
+
+TEST_CASE("Tuned Loop LMUL Selection", "[tuning]") {
+    auto model = GetTuningModel(TuningCore::SiFiveP670);
+
+    // Capped at the preferred multiplier.
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 2) == LMUL::M8);
+    REQUIRE(ChooseLoopLMUL(model, SEW::E32, 2) == LMUL::M2);
+
+    // Smaller choices are left alone.
+    REQUIRE(ChooseLoopLMUL(model, SEW::E32, 20) == LMUL::M1);
+    REQUIRE(ChooseLoopLMUL(model, SEW::E32, 2, 4) == LMUL::M1);
+
+    // Fractional preferences don't go below a whole register.
+    model.preferred_lmul = LMUL::MF2;
+    REQUIRE(ChooseLoopLMUL(model, SEW::E32, 2) == LMUL::M1);
+
+    // No vector unit.
+    REQUIRE(ChooseLoopLMUL(GetTuningModel(TuningCore::SiFiveU74), SEW::E32, 2) == LMUL::M1);
+}
@@ -0,0 +1,89 @@
+#include <catch/catch.hpp>
+
+#include <array>
+#include <cstring>
+#include <biscuit/assembler.hpp>
+#include <biscuit/vector_loop.hpp>
+
+#include "assembler_test_utils.hpp"
+
+using namespace biscuit;
+
+TEST_CASE("Vector loop LMUL selection", "[vector_loop]") {
+    // Without a vector unit, there's nothing to choose from.
+    REQUIRE(ChooseLoopLMUL(0, SEW::E32, 2) == LMUL::M1);
+
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 1) == LMUL::M8);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 3) == LMUL::M8);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 4) == LMUL::M4);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 7) == LMUL::M4);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 8) == LMUL::M2);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 31) == LMUL::M1);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 40) == LMUL::M1);
+
+    // Short loops don't need more registers than a single iteration covers.
+    // With VLEN=128, M2 holds 8 32-bit elements.
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 1, 8) == LMUL::M2);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 1, 9) == LMUL::M4);
+    REQUIRE(ChooseLoopLMUL(16, SEW::E32, 1, 1000) == LMUL::M8);
+    REQUIRE(ChooseLoopLMUL(64, SEW::E8, 1, 16) == LMUL::M1);
+}
+
+TEST_CASE("Vector loop with Zba", "[vector_loop]") {
+    std::array<uint32_t, 16> buffer{};
+    std::array<uint32_t, 16> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+    as.SetExtensions({Extension::Zba});
+
+    VectorLoopBuilder loop{as, SEW::E32, LMUL::M4};
+    loop.AddPointer(a0);
+    loop.AddPointer(a1);
+    loop.AddPointer(a2, SEW::E64);
+    loop.Emit(a3, t0, x0, [](Assembler& body, GPR vl) {
+        REQUIRE(vl == t0);
+        body.VLE32(v8, a1);
+        body.VSE32(v8, a0);
+    });
+
+    ref.VSETVLI(t0, a3, SEW::E32, LMUL::M4, VTA::Yes, VMA::Yes);
+    ref.VLE32(v8, a1);
+    ref.VSE32(v8, a0);
+    ref.SUB(a3, a3, t0);
+    ref.SH2ADD(a0, t0, a0);
+    ref.SH2ADD(a1, t0, a1);
+    ref.SH3ADD(a2, t0, a2);
+    ref.BNEZ(a3, -28);
+
+    REQUIRE(buffer == expected);
+}
+
+TEST_CASE("Vector loop without Zba", "[vector_loop]") {
+    std::array<uint32_t, 16> buffer{};
+    std::array<uint32_t, 16> expected{};
+    auto as = MakeAssembler64(buffer);
+    auto ref = MakeAssembler64(expected);
+
+    VectorLoopBuilder loop{as, SEW::E16};
+    loop.SetPolicy(VTA::No, VMA::No);
+    loop.AddPointer(a0);
+    loop.AddPointer(a1);
+    loop.AddPointer(a2, SEW::E8);
+    loop.Emit(a3, t0, t1, [](Assembler& body, GPR) {
+        body.VLE16(v1, a1);
+        body.VSE16(v1, a0);
+    });
+
+    // The shifted vl is shared by every pointer that needs it.
+    ref.VSETVLI(t0, a3, SEW::E16, LMUL::M1, VTA::No, VMA::No);
+    ref.VLE16(v1, a1);
+    ref.VSE16(v1, a0);
+    ref.SUB(a3, a3, t0);
+    ref.ADD(a2, a2, t0);
+    ref.SLLI(t1, t0, 1);
+    ref.ADD(a0, a0, t1);
+    ref.ADD(a1, a1, t1);
+    ref.BNEZ(a3, -32);
+
+    REQUIRE(buffer == expected);
+}